@@ -0,0 +1,174 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib> //For malloc and free.
+#include <memory> //For unique_ptr.
+#include <new> //For bad_alloc.
+#include <sstream>
+
+#include "BenchmarkPolygons.h"
+#include "../src/Application.h"
+#include "../src/PrintFeature.h"
+#include "../src/Slice.h"
+#include "../src/communication/ArcusCommunicationPrivate.h" //To write g-code to the stream that gets flushed.
+#include "../src/settings/types/LayerIndex.h"
+#include "../src/settings/types/Velocity.h"
+#include "../tests/arcus/MockSocket.h" //To catch the messages instead of sending them.
+
+/*
+ * Sends layers to the front-end the way the g-code writer does, through a mock
+ * socket that keeps the messages instead of sending them. The counters report
+ * how many messages and bytes would be sent per second, and how many
+ * allocations each layer takes.
+ *
+ * The argument of the layer benchmark is the number of walls of the layer, of
+ * 64 vertices each. Every layer also has eight infill lines per wall.
+ */
+
+namespace
+{
+
+std::atomic<size_t> allocation_count(0); //!< How often memory was allocated in this process.
+
+} //Anonymous namespace.
+
+//Count every allocation. The array versions of new and delete call these.
+void* operator new(size_t size)
+{
+    allocation_count++;
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+namespace cura
+{
+
+/*
+ * An Arcus communication with a mock socket, and a slice with one extruder for
+ * the messages that need it. A friend of the communication, to be able to
+ * swap in the socket and to write g-code.
+ */
+class ArcusCommunicationBenchmark
+{
+public:
+    ArcusCommunicationBenchmark()
+    : slice(1)
+    , socket(new MockSocket())
+    , communication(new ArcusCommunication())
+    , message_count(0)
+    , byte_count(0)
+    {
+        slice.scene.extruders.emplace_back(0, &slice.scene.settings);
+        Application::getInstance().current_slice = &slice;
+        communication->setSocketMock(socket.get());
+    }
+
+    ~ArcusCommunicationBenchmark()
+    {
+        communication.reset(); //Closes the socket.
+        Application::getInstance().current_slice = nullptr;
+    }
+
+    std::ostringstream& getGCodeStream()
+    {
+        return communication->private_data->gcode_output_stream;
+    }
+
+    /*!
+     * Count and forget the messages that were sent so far, like a socket
+     * that serialises them.
+     */
+    void drainMessages()
+    {
+        for (const Arcus::MessagePtr& message : socket->sent_messages)
+        {
+            byte_count += message->ByteSizeLong();
+        }
+        message_count += socket->sent_messages.size();
+        socket->sent_messages.clear();
+    }
+
+    Slice slice;
+    std::unique_ptr<MockSocket> socket; //!< Still used by the communication when it closes, so it's destroyed after it.
+    std::unique_ptr<ArcusCommunication> communication;
+    size_t message_count; //!< The messages that were drained so far.
+    size_t byte_count; //!< The size of the messages that were drained so far, serialised.
+};
+
+static void BM_ArcusSendLayers(benchmark::State& state)
+{
+    ArcusCommunicationBenchmark fixture;
+    ArcusCommunication& communication = *fixture.communication;
+    const Polygons walls = makeBlobs(state.range(0), 64);
+    const Polygons infill = makeLines(state.range(0) * 8);
+    std::ostringstream layer_gcode; //About the g-code that the layer would get.
+    for (ConstPolygonRef line : infill)
+    {
+        layer_gcode << "G0 X" << INT2MM(line[0].X) << " Y" << INT2MM(line[0].Y) << "\nG1 X" << INT2MM(line[1].X) << " Y" << INT2MM(line[1].Y) << " E1.23456\n";
+    }
+    const std::string gcode = layer_gcode.str();
+
+    LayerIndex layer_nr = 0;
+    size_t allocations = 0;
+    for (auto _ : state)
+    {
+        const size_t allocations_before = allocation_count;
+        communication.setLayerForSend(layer_nr); //Sends the previous layer.
+        communication.sendCurrentPosition(walls[0][0]);
+        communication.sendPolygons(PrintFeatureType::OuterWall, walls, 400, 200, Velocity(30));
+        for (ConstPolygonRef line : infill)
+        {
+            communication.sendCurrentPosition(line[0]);
+            communication.sendLineTo(PrintFeatureType::Infill, line[1], 400, 200, Velocity(60));
+        }
+        fixture.getGCodeStream() << gcode;
+        communication.flushGCode();
+        allocations += allocation_count - allocations_before;
+        layer_nr++;
+
+        state.PauseTiming();
+        fixture.drainMessages();
+        state.ResumeTiming();
+    }
+    communication.sendOptimizedLayerData();
+    fixture.drainMessages();
+
+    state.SetItemsProcessed(state.iterations() * (walls.pointCount() + infill.size()));
+    state.SetBytesProcessed(fixture.byte_count);
+    state.counters["messages"] = benchmark::Counter(fixture.message_count, benchmark::Counter::kIsRate);
+    state.counters["allocations_per_layer"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ArcusSendLayers)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_ArcusSendPrintTimeMaterialEstimates(benchmark::State& state)
+{
+    ArcusCommunicationBenchmark fixture;
+    size_t allocations = 0;
+    for (auto _ : state)
+    {
+        const size_t allocations_before = allocation_count;
+        fixture.communication->sendPrintTimeMaterialEstimates();
+        allocations += allocation_count - allocations_before;
+
+        state.PauseTiming();
+        fixture.drainMessages();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed(fixture.byte_count);
+    state.counters["messages"] = benchmark::Counter(fixture.message_count, benchmark::Counter::kIsRate);
+    state.counters["allocations_per_message"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ArcusSendPrintTimeMaterialEstimates);
+
+} //namespace cura
@@ -0,0 +1,88 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef BENCHMARKS_BENCHMARK_POLYGONS_H
+#define BENCHMARKS_BENCHMARK_POLYGONS_H
+
+#include <cmath> //For cos and sin.
+#include <random>
+
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+/*
+ * Inputs for the benchmarks. They are generated from a fixed seed, so that
+ * every run of a benchmark processes the same geometry.
+ */
+
+constexpr coord_t benchmark_area_size = 200000; //!< The inputs lie within a square of 200 by 200mm, like a build plate.
+
+/*!
+ * Scattered irregular blobs, like the cross-sections of a plate full of small
+ * models. They may overlap each other.
+ * \param blob_count How many blobs to make.
+ * \param vertex_count How many vertices each blob has.
+ * \param seed The seed of the random generator, to make different sets.
+ */
+inline Polygons makeBlobs(const size_t blob_count, const size_t vertex_count, const unsigned int seed = 0)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<coord_t> centre_distribution(0, benchmark_area_size);
+    std::uniform_int_distribution<coord_t> radius_distribution(2000, 5000);
+    Polygons blobs;
+    for (size_t blob_idx = 0; blob_idx < blob_count; blob_idx++)
+    {
+        const Point centre(centre_distribution(random), centre_distribution(random));
+        PolygonRef blob = blobs.newPoly();
+        for (size_t vertex_idx = 0; vertex_idx < vertex_count; vertex_idx++)
+        {
+            const double angle = 2 * M_PI * vertex_idx / vertex_count;
+            const coord_t radius = radius_distribution(random);
+            blob.emplace_back(centre.X + radius * std::cos(angle), centre.Y + radius * std::sin(angle));
+        }
+    }
+    return blobs;
+}
+
+/*!
+ * Scattered short line segments, like the lines of sparse infill.
+ * \param line_count How many lines to make.
+ * \param seed The seed of the random generator, to make different sets.
+ */
+inline Polygons makeLines(const size_t line_count, const unsigned int seed = 0)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<coord_t> start_distribution(0, benchmark_area_size);
+    std::uniform_int_distribution<coord_t> offset_distribution(-10000, 10000);
+    Polygons lines;
+    for (size_t line_idx = 0; line_idx < line_count; line_idx++)
+    {
+        const Point start(start_distribution(random), start_distribution(random));
+        lines.addLine(start, start + Point(offset_distribution(random), offset_distribution(random)));
+    }
+    return lines;
+}
+
+/*!
+ * Scattered points.
+ * \param point_count How many points to make.
+ * \param seed The seed of the random generator, to make different sets.
+ */
+inline std::vector<Point> makePoints(const size_t point_count, const unsigned int seed = 0)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<coord_t> distribution(0, benchmark_area_size);
+    std::vector<Point> points;
+    points.reserve(point_count);
+    for (size_t point_idx = 0; point_idx < point_count; point_idx++)
+    {
+        points.emplace_back(distribution(random), distribution(random));
+    }
+    return points;
+}
+
+} //namespace cura
+
+#endif //BENCHMARKS_BENCHMARK_POLYGONS_H
@@ -0,0 +1,179 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib> //For malloc and free.
+#include <new> //For bad_alloc.
+#include <ostream>
+#include <streambuf>
+
+#include "BenchmarkPolygons.h"
+#include "../src/Application.h"
+#include "../src/gcodeExport.h"
+#include "../src/PrintFeature.h"
+#include "../src/RetractionConfig.h"
+#include "../src/Slice.h"
+#include "../src/communication/CommandLine.h" //Ignores the moves, like when slicing from the command line.
+#include "../src/settings/EnumSettings.h"
+#include "../src/settings/types/Velocity.h"
+
+/*
+ * Writes moves through the g-code export into a stream that only counts the
+ * bytes, to measure how fast g-code is formatted. The counters report the moves
+ * and bytes per second, and how many allocations each move takes. Writing a
+ * move shouldn't need to allocate memory, so that counter should stay near
+ * zero.
+ *
+ * The argument is the number of lines of infill per iteration. Every line is a
+ * travel and an extrusion, and every eighth travel retracts.
+ */
+
+namespace
+{
+
+std::atomic<size_t> allocation_count(0); //!< How often memory was allocated in this process.
+
+/*
+ * A stream buffer that throws away everything written to it, but counts the
+ * bytes.
+ */
+class CountingNullBuffer : public std::streambuf
+{
+public:
+    CountingNullBuffer()
+    : byte_count(0)
+    {
+    }
+
+    size_t byte_count; //!< The number of bytes written so far.
+
+protected:
+    int overflow(int character) override
+    {
+        byte_count++;
+        return traits_type::not_eof(character);
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override
+    {
+        byte_count += count;
+        return count;
+    }
+};
+
+} //Anonymous namespace.
+
+//Count every allocation. The array versions of new and delete call these.
+void* operator new(size_t size)
+{
+    allocation_count++;
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+namespace cura
+{
+
+/*
+ * A slice with one extruder and the settings that writing moves and
+ * retractions needs, and a communication that ignores the moves.
+ */
+class GCodeExportBenchmark
+{
+public:
+    GCodeExportBenchmark(const EGCodeFlavor flavor)
+    : slice(1)
+    , communication(std::vector<std::string>())
+    , output(&buffer)
+    {
+        slice.scene.extruders.emplace_back(0, &slice.scene.settings);
+        slice.scene.settings.add("machine_firmware_retract", "false");
+        slice.scene.current_mesh_group->settings.add("layer_height", "0.2");
+        Application::getInstance().current_slice = &slice;
+        Application::getInstance().communication = &communication;
+
+        output << std::fixed;
+        gcode.setOutputStream(&output);
+        gcode.setFlavor(flavor);
+        gcode.setFilamentDiameter(0, MM2INT(2.85));
+        gcode.setZ(MM2INT(0.2));
+
+        retraction.distance = 6.5;
+        retraction.speed = 25;
+        retraction.primeSpeed = 25;
+        retraction.prime_volume = 0;
+        retraction.zHop = 0;
+        retraction.retraction_min_travel_distance = 0;
+        retraction.retraction_extrusion_window = 0;
+        retraction.retraction_count_max = 100;
+    }
+
+    ~GCodeExportBenchmark()
+    {
+        Application::getInstance().communication = nullptr;
+        Application::getInstance().current_slice = nullptr;
+    }
+
+    Slice slice;
+    CommandLine communication;
+    CountingNullBuffer buffer;
+    std::ostream output; //!< Writes into the buffer.
+    GCodeExport gcode;
+    RetractionConfig retraction; //!< The retraction of every eighth travel move.
+};
+
+/*
+ * Write the same lines over and over with one flavour of g-code.
+ */
+static void writeMoves(benchmark::State& state, const EGCodeFlavor flavor)
+{
+    GCodeExportBenchmark fixture(flavor);
+    GCodeExport& gcode = fixture.gcode;
+    const Polygons lines = makeLines(state.range(0));
+
+    size_t allocations = 0;
+    for (auto _ : state)
+    {
+        const size_t allocations_before = allocation_count;
+        for (size_t line_idx = 0; line_idx < lines.size(); line_idx++)
+        {
+            ConstPolygonRef line = lines[line_idx];
+            if (line_idx % 8 == 0)
+            {
+                gcode.writeRetraction(fixture.retraction);
+            }
+            gcode.writeTravel(line[0], Velocity(150));
+            gcode.writeExtrusion(line[1], Velocity(60), 0.04, PrintFeatureType::Infill);
+        }
+        allocations += allocation_count - allocations_before;
+    }
+
+    const size_t move_count = state.iterations() * lines.size() * 2;
+    state.SetItemsProcessed(move_count);
+    state.SetBytesProcessed(fixture.buffer.byte_count);
+    state.counters["allocations_per_move"] = benchmark::Counter(move_count == 0 ? 0.0 : static_cast<double>(allocations) / move_count);
+}
+
+static void BM_GCodeExportMarlin(benchmark::State& state)
+{
+    writeMoves(state, EGCodeFlavor::MARLIN);
+}
+BENCHMARK(BM_GCodeExportMarlin)->RangeMultiplier(8)->Range(1024, 65536);
+
+static void BM_GCodeExportBinary(benchmark::State& state)
+{
+    writeMoves(state, EGCodeFlavor::BINARY);
+}
+BENCHMARK(BM_GCodeExportBinary)->RangeMultiplier(8)->Range(1024, 65536);
+
+} //namespace cura
@@ -0,0 +1,73 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkPolygons.h"
+#include "../src/utils/linearAlg2D.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of line segments that every
+ * iteration handles, so that the results show the effect of the cache.
+ */
+
+static void BM_GetDist2FromLineSegment(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0) * 3);
+    for (auto _ : state)
+    {
+        for (size_t point_idx = 0; point_idx + 2 < points.size(); point_idx += 3)
+        {
+            benchmark::DoNotOptimize(LinearAlg2D::getDist2FromLineSegment(points[point_idx], points[point_idx + 1], points[point_idx + 2]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetDist2FromLineSegment)->RangeMultiplier(16)->Range(16, 65536);
+
+static void BM_GetClosestOnLineSegment(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0) * 3);
+    for (auto _ : state)
+    {
+        for (size_t point_idx = 0; point_idx + 2 < points.size(); point_idx += 3)
+        {
+            benchmark::DoNotOptimize(LinearAlg2D::getClosestOnLineSegment(points[point_idx], points[point_idx + 1], points[point_idx + 2]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetClosestOnLineSegment)->RangeMultiplier(16)->Range(16, 65536);
+
+static void BM_GetDist2BetweenLineSegments(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0) * 4);
+    for (auto _ : state)
+    {
+        for (size_t point_idx = 0; point_idx + 3 < points.size(); point_idx += 4)
+        {
+            benchmark::DoNotOptimize(LinearAlg2D::getDist2BetweenLineSegments(points[point_idx], points[point_idx + 1], points[point_idx + 2], points[point_idx + 3]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetDist2BetweenLineSegments)->RangeMultiplier(16)->Range(16, 65536);
+
+static void BM_PointIsLeftOfLine(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0) * 3);
+    for (auto _ : state)
+    {
+        for (size_t point_idx = 0; point_idx + 2 < points.size(); point_idx += 3)
+        {
+            benchmark::DoNotOptimize(LinearAlg2D::pointIsLeftOfLine(points[point_idx], points[point_idx + 1], points[point_idx + 2]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PointIsLeftOfLine)->RangeMultiplier(16)->Range(16, 65536);
+
+} //namespace cura
@@ -0,0 +1,44 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkPolygons.h"
+#include "../src/pathOrderOptimizer.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of polygons or lines to order.
+ */
+
+static void BM_PathOrderOptimizer(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 16);
+    for (auto _ : state)
+    {
+        PathOrderOptimizer optimizer(Point(0, 0));
+        optimizer.addPolygons(blobs);
+        optimizer.optimize();
+        benchmark::DoNotOptimize(optimizer.polyOrder);
+    }
+    state.SetItemsProcessed(state.iterations() * blobs.size());
+}
+BENCHMARK(BM_PathOrderOptimizer)->RangeMultiplier(4)->Range(16, 4096);
+
+static void BM_LineOrderOptimizer(benchmark::State& state)
+{
+    Polygons lines = makeLines(state.range(0));
+    for (auto _ : state)
+    {
+        LineOrderOptimizer optimizer(Point(0, 0));
+        optimizer.addPolygons(lines);
+        optimizer.optimize();
+        benchmark::DoNotOptimize(optimizer.polyOrder);
+    }
+    state.SetItemsProcessed(state.iterations() * lines.size());
+}
+BENCHMARK(BM_LineOrderOptimizer)->RangeMultiplier(4)->Range(16, 4096);
+
+} //namespace cura
@@ -0,0 +1,60 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkPolygons.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of blobs, of 64 vertices each.
+ */
+
+static void BM_PolygonsOffset(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(blobs.offset(-400));
+    }
+    state.SetItemsProcessed(state.iterations() * blobs.pointCount());
+}
+BENCHMARK(BM_PolygonsOffset)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_PolygonsOffsetRound(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(blobs.offset(-400, ClipperLib::jtRound));
+    }
+    state.SetItemsProcessed(state.iterations() * blobs.pointCount());
+}
+BENCHMARK(BM_PolygonsOffsetRound)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_PolygonsDifference(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64, 0);
+    const Polygons holes = makeBlobs(state.range(0), 64, 1);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(blobs.difference(holes));
+    }
+    state.SetItemsProcessed(state.iterations() * (blobs.pointCount() + holes.pointCount()));
+}
+BENCHMARK(BM_PolygonsDifference)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_PolygonsUnion(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64);
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(blobs.unionPolygons());
+    }
+    state.SetItemsProcessed(state.iterations() * blobs.pointCount());
+}
+BENCHMARK(BM_PolygonsUnion)->RangeMultiplier(4)->Range(16, 1024);
+
+} //namespace cura
@@ -0,0 +1,49 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkPolygons.h"
+#include "../src/utils/polygonUtils.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of blobs, of 64 vertices each.
+ * Every iteration handles 256 query points.
+ */
+
+static void BM_MoveInside(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64).unionPolygons();
+    const std::vector<Point> queries = makePoints(256, 1);
+    for (auto _ : state)
+    {
+        for (const Point& query : queries)
+        {
+            Point moved = query;
+            benchmark::DoNotOptimize(PolygonUtils::moveInside(blobs, moved, 200));
+            benchmark::DoNotOptimize(moved);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_MoveInside)->RangeMultiplier(4)->Range(16, 1024);
+
+static void BM_FindClosest(benchmark::State& state)
+{
+    const Polygons blobs = makeBlobs(state.range(0), 64);
+    const std::vector<Point> queries = makePoints(256, 1);
+    for (auto _ : state)
+    {
+        for (const Point& query : queries)
+        {
+            benchmark::DoNotOptimize(PolygonUtils::findClosest(query, blobs));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_FindClosest)->RangeMultiplier(4)->Range(16, 1024);
+
+} //namespace cura
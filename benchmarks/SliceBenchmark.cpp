@@ -0,0 +1,495 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For find_if, count and mismatch.
+#include <cstdlib> //For atoi.
+#include <array>
+#include <cmath> //For the shapes of the models.
+#include <cstdio> //For remove.
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sys/resource.h> //For getrusage.
+#endif
+
+#include "../src/Application.h"
+#include "../src/FffProcessor.h"
+#include "../src/communication/CommandLine.h"
+#include "../src/utils/gettime.h"
+#include "../src/utils/logoutput.h"
+
+/*
+ * Slices a fixed corpus of reference models with pinned settings and reports
+ * the time of every stage, the peak memory use and the size of the g-code of
+ * each model as JSON, so that performance regressions of whole slices can be
+ * tracked.
+ *
+ * The models are generated, so that they are the same on every machine
+ * without keeping large mesh files in the repository. They are sliced through
+ * the command line interface, the same way CuraEngine slices them when run
+ * from the command line.
+ *
+ * Usage: SliceBenchmark [--compare-threads <N>] <settings file> <report file> [<model name>...]
+ * The settings file has one setting per line, as key=value. Without model
+ * names, all models are sliced.
+ *
+ * With --compare-threads, every model is sliced with one thread first and then
+ * with N threads, and the g-code of both must be exactly the same. The report
+ * has the measurements of the slice with N threads. The exit code is non-zero
+ * if any model differs, so that parallel stages that make the output depend on
+ * the number of threads are caught.
+ */
+
+namespace cura
+{
+
+/*!
+ * A triangle mesh that can be written as a binary STL file.
+ */
+class BenchmarkMesh
+{
+public:
+    using Vertex = std::array<float, 3>; //In millimetres.
+
+    /*!
+     * Add a triangle, with the vertices in counter-clockwise order when seen
+     * from the outside.
+     */
+    void addFace(const Vertex& a, const Vertex& b, const Vertex& c)
+    {
+        faces.push_back({a, b, c});
+    }
+
+    /*!
+     * Add a closed surface that is a deformed sphere.
+     * \param centre The centre of the sphere.
+     * \param ring_count How many rings of vertices there are from pole to
+     * pole.
+     * \param segment_count How many vertices each ring has.
+     * \param radius The radius for a polar angle (from the top) and an
+     * azimuth.
+     */
+    void addSphere(const Vertex& centre, const size_t ring_count, const size_t segment_count, const std::function<float (float, float)>& radius)
+    {
+        const auto vertex = [&](const size_t ring, const size_t segment) -> Vertex
+        {
+            const float polar = M_PI * ring / ring_count;
+            const float azimuth = 2 * M_PI * (segment % segment_count) / segment_count;
+            const float r = radius(polar, azimuth);
+            return {centre[0] + r * std::sin(polar) * std::cos(azimuth), centre[1] + r * std::sin(polar) * std::sin(azimuth), centre[2] + r * std::cos(polar)};
+        };
+        for (size_t ring = 0; ring < ring_count; ring++)
+        {
+            for (size_t segment = 0; segment < segment_count; segment++)
+            {
+                if (ring > 0) //The top ring is a single vertex.
+                {
+                    addFace(vertex(ring, segment), vertex(ring + 1, segment), vertex(ring, segment + 1));
+                }
+                if (ring + 1 < ring_count) //So is the bottom ring.
+                {
+                    addFace(vertex(ring, segment + 1), vertex(ring + 1, segment), vertex(ring + 1, segment + 1));
+                }
+            }
+        }
+    }
+
+    /*!
+     * Add a closed surface that is a deformed vertical cylinder.
+     * \param centre The centre of the bottom of the cylinder.
+     * \param height The height of the cylinder.
+     * \param ring_count How many rings of vertices the side has, minus one.
+     * \param segment_count How many vertices each ring has.
+     * \param radius The radius for a height above the bottom and an azimuth.
+     */
+    void addCylinder(const Vertex& centre, const float height, const size_t ring_count, const size_t segment_count, const std::function<float (float, float)>& radius)
+    {
+        const auto vertex = [&](const size_t ring, const size_t segment) -> Vertex
+        {
+            const float z = height * ring / ring_count;
+            const float azimuth = 2 * M_PI * (segment % segment_count) / segment_count;
+            const float r = radius(z, azimuth);
+            return {centre[0] + r * std::cos(azimuth), centre[1] + r * std::sin(azimuth), centre[2] + z};
+        };
+        const Vertex bottom = centre;
+        const Vertex top = {centre[0], centre[1], centre[2] + height};
+        for (size_t segment = 0; segment < segment_count; segment++)
+        {
+            addFace(bottom, vertex(0, segment + 1), vertex(0, segment));
+            addFace(top, vertex(ring_count, segment), vertex(ring_count, segment + 1));
+            for (size_t ring = 0; ring < ring_count; ring++)
+            {
+                addFace(vertex(ring, segment), vertex(ring, segment + 1), vertex(ring + 1, segment + 1));
+                addFace(vertex(ring, segment), vertex(ring + 1, segment + 1), vertex(ring + 1, segment));
+            }
+        }
+    }
+
+    /*!
+     * Damage the mesh like a bad scan: move the corners of every triangle
+     * independently, so that neighbouring triangles no longer share their
+     * vertices exactly, and leave out some of the triangles.
+     * \param jitter How far the corners may move, in millimetres.
+     * \param hole_chance Which part of the triangles to leave out.
+     */
+    void breakStitching(const float jitter, const float hole_chance)
+    {
+        std::mt19937 random(0);
+        std::uniform_real_distribution<float> move(-jitter, jitter);
+        std::uniform_real_distribution<float> chance(0, 1);
+        std::vector<std::array<Vertex, 3>> kept_faces;
+        for (std::array<Vertex, 3>& face : faces)
+        {
+            for (Vertex& corner : face)
+            {
+                for (float& coordinate : corner)
+                {
+                    coordinate += move(random);
+                }
+            }
+            if (chance(random) >= hole_chance)
+            {
+                kept_faces.push_back(face);
+            }
+        }
+        faces.swap(kept_faces);
+    }
+
+    size_t size() const
+    {
+        return faces.size();
+    }
+
+    /*!
+     * Write the mesh as a binary STL file.
+     * \return Whether writing succeeded.
+     */
+    bool write(const std::string& filename) const
+    {
+        std::ofstream file(filename, std::ios::binary);
+        const char header[80] = "CuraEngine slice benchmark";
+        file.write(header, sizeof(header));
+        const uint32_t face_count = faces.size();
+        file.write(reinterpret_cast<const char*>(&face_count), sizeof(face_count));
+        for (const std::array<Vertex, 3>& face : faces)
+        {
+            const float normal[3] = {0, 0, 0}; //Not used by CuraEngine.
+            file.write(reinterpret_cast<const char*>(normal), sizeof(normal));
+            for (const Vertex& corner : face)
+            {
+                file.write(reinterpret_cast<const char*>(corner.data()), 3 * sizeof(float));
+            }
+            const uint16_t attribute_count = 0;
+            file.write(reinterpret_cast<const char*>(&attribute_count), sizeof(attribute_count));
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    std::vector<std::array<Vertex, 3>> faces;
+};
+
+/*!
+ * A model of the corpus, with the settings that it needs on top of the pinned
+ * settings.
+ */
+struct BenchmarkModel
+{
+    std::string name; //!< Only letters, digits and underscores, so that it doesn't need to be escaped in the report.
+    std::function<BenchmarkMesh ()> generate;
+    std::vector<std::string> settings; //!< As key=value.
+};
+
+constexpr float plate_centre_x = 116.5; //The middle of the build plate of the pinned settings.
+constexpr float plate_centre_y = 107.5;
+
+std::vector<BenchmarkModel> getCorpus()
+{
+    std::vector<BenchmarkModel> corpus;
+
+    //A high-poly organic shape, with curved walls and skin everywhere.
+    corpus.push_back({"figurine", []()
+    {
+        BenchmarkMesh mesh;
+        mesh.addSphere({plate_centre_x, plate_centre_y, 28}, 300, 600, [](const float polar, const float azimuth)
+        {
+            return 25 * (1 + 0.1 * std::sin(9 * azimuth) * std::sin(7 * polar));
+        });
+        return mesh;
+    }, {}});
+
+    //Many small parts on one plate, which makes the layers consist of many islands.
+    corpus.push_back({"plate_of_parts", []()
+    {
+        BenchmarkMesh mesh;
+        for (int x = -5; x < 5; x++)
+        {
+            for (int y = -5; y < 5; y++)
+            {
+                mesh.addCylinder({plate_centre_x + 15 * x + 7.5f, plate_centre_y + 15 * y + 7.5f, 0}, 10, 1, 48, [](const float, const float)
+                {
+                    return 5;
+                });
+            }
+        }
+        return mesh;
+    }, {}});
+
+    //A tall vase, printed as a single spiralling wall.
+    corpus.push_back({"spiral_vase", []()
+    {
+        BenchmarkMesh mesh;
+        mesh.addCylinder({plate_centre_x, plate_centre_y, 0}, 180, 360, 256, [](const float z, const float azimuth)
+        {
+            return 35 + 10 * std::sin(z / 30) + 2 * std::sin(8 * azimuth + z / 20);
+        });
+        return mesh;
+    }, {"magic_spiralize=True"}});
+
+    //A scan of which the triangles don't connect, which needs stitching.
+    corpus.push_back({"broken_scan", []()
+    {
+        BenchmarkMesh mesh;
+        mesh.addSphere({plate_centre_x, plate_centre_y, 30}, 150, 300, [](const float polar, const float azimuth)
+        {
+            return 30 * (1 + 0.05 * std::sin(5 * azimuth) * std::sin(3 * polar));
+        });
+        mesh.breakStitching(0.05, 0.01);
+        return mesh;
+    }, {"meshfix_extensive_stitching=True"}});
+
+    //A mushroom with a wide overhanging cap, held up by tree support.
+    corpus.push_back({"tree_support", []()
+    {
+        BenchmarkMesh mesh;
+        mesh.addCylinder({plate_centre_x, plate_centre_y, 0}, 40, 1, 64, [](const float, const float)
+        {
+            return 5;
+        });
+        mesh.addCylinder({plate_centre_x, plate_centre_y, 40}, 6, 1, 128, [](const float, const float)
+        {
+            return 35;
+        });
+        return mesh;
+    }, {"support_enable=True", "support_tree_enable=True"}});
+
+    return corpus;
+}
+
+/*!
+ * Start measuring the peak memory use again, if the platform allows it.
+ */
+void resetPeakMemory()
+{
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5"; //Resets the peak resident set size.
+#endif
+}
+
+/*!
+ * The peak resident set size, in kilobytes, since \ref resetPeakMemory if the
+ * platform allows resetting it, or else since the start of the process. Zero
+ * if unknown.
+ */
+long getPeakMemory()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
+
+std::string readFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+} //namespace cura
+
+using namespace cura;
+
+/*!
+ * Get the line number of the first line where two files differ.
+ */
+size_t firstDifferentLine(const std::string& a, const std::string& b)
+{
+    const std::pair<std::string::const_iterator, std::string::const_iterator> difference = (a.size() < b.size()) ? std::mismatch(a.begin(), a.end(), b.begin()) : std::mismatch(b.begin(), b.end(), a.begin());
+    const std::string& shortest = (a.size() < b.size()) ? a : b;
+    return std::count(shortest.begin(), difference.first, '\n') + 1;
+}
+
+int main(int argc, char** argv)
+{
+    size_t compare_thread_count = 0; //Zero if the output isn't compared between thread counts.
+    if (argc > 2 && std::string(argv[1]) == "--compare-threads")
+    {
+        compare_thread_count = std::max(1, std::atoi(argv[2]));
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc < 3)
+    {
+        logError("Usage: %s [--compare-threads <N>] <settings file> <report file> [<model name>...]\n", argv[0]);
+        return 1;
+    }
+#ifndef _OPENMP
+    if (compare_thread_count > 0)
+    {
+        logWarning("Without OpenMP every slice uses one thread, so comparing thread counts can't find anything.\n");
+    }
+#endif // _OPENMP
+    std::vector<std::string> settings;
+    {
+        std::ifstream settings_file(argv[1]);
+        if (!settings_file)
+        {
+            logError("Failed to open the settings file %s.\n", argv[1]);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(settings_file, line))
+        {
+            if (!line.empty())
+            {
+                settings.push_back(line);
+            }
+        }
+    }
+    const std::string report_filename = argv[2];
+
+    std::ostringstream report;
+    report << "{\"models\":[";
+    bool first_model = true;
+    bool all_identical = true; //Whether every model gave the same g-code with all thread counts that were compared.
+    for (const BenchmarkModel& model : getCorpus())
+    {
+        if (argc > 3 && std::find_if(argv + 3, argv + argc, [&model](const char* name) { return model.name == name; }) == argv + argc)
+        {
+            continue;
+        }
+        log("Slicing %s.\n", model.name.c_str());
+        const BenchmarkMesh mesh = model.generate();
+        const std::string mesh_filename = report_filename + "." + model.name + ".stl";
+        const std::string gcode_filename = report_filename + "." + model.name + ".gcode";
+        const std::string stages_filename = report_filename + "." + model.name + ".stages.json";
+        if (!mesh.write(mesh_filename))
+        {
+            logError("Failed to write the model to %s.\n", mesh_filename.c_str());
+            return 1;
+        }
+
+        std::vector<std::string> arguments = {"CuraEngine", "slice"};
+        for (const std::string& setting : settings)
+        {
+            arguments.push_back("-s");
+            arguments.push_back(setting);
+        }
+        for (const std::string& setting : model.settings)
+        {
+            arguments.push_back("-s");
+            arguments.push_back(setting);
+        }
+        arguments.insert(arguments.end(), {"-s", "instrumentation_summary_file=" + stages_filename});
+        arguments.insert(arguments.end(), {"-e0", "-s", "extruder_nr=0", "-l", mesh_filename, "-o", gcode_filename});
+
+        const auto slice = [](const std::vector<std::string>& slice_arguments)
+        {
+            FffProcessor::getInstance()->reset(); //Don't continue the g-code of the previous model.
+            CommandLine* communication = new CommandLine(slice_arguments);
+            delete Application::getInstance().communication;
+            Application::getInstance().communication = communication;
+            while (communication->hasSlice())
+            {
+                communication->sliceNext();
+            }
+        };
+
+        std::string single_thread_gcode;
+#ifdef _OPENMP
+        if (compare_thread_count > 0)
+        {
+            std::vector<std::string> single_thread_arguments = arguments;
+            single_thread_arguments.insert(single_thread_arguments.begin() + 2, "-m1");
+            slice(single_thread_arguments);
+            single_thread_gcode = readFile(gcode_filename);
+            arguments.insert(arguments.begin() + 2, "-m" + std::to_string(compare_thread_count));
+        }
+#endif // _OPENMP
+
+        resetPeakMemory();
+        TimeKeeper time_keeper;
+        slice(arguments);
+        const double wall_time = time_keeper.restart();
+        const long peak_memory = getPeakMemory();
+
+        bool is_identical = true;
+        if (compare_thread_count > 0)
+        {
+            const std::string gcode = readFile(gcode_filename);
+            is_identical = (gcode == single_thread_gcode);
+            if (!is_identical)
+            {
+                logError("The g-code of %s with %zu threads differs from the g-code with one thread, from line %zu.\n", model.name.c_str(), compare_thread_count, firstDifferentLine(gcode, single_thread_gcode));
+                all_identical = false;
+            }
+        }
+
+        std::ifstream gcode(gcode_filename, std::ios::binary | std::ios::ate);
+        const long long output_size = gcode ? static_cast<long long>(gcode.tellg()) : -1;
+        gcode.close();
+        std::string stages = readFile(stages_filename);
+        if (stages.empty()) //Without instrumentation, or if it failed.
+        {
+            stages = "{\"stages\":[]}";
+        }
+        while (!stages.empty() && stages.back() == '\n')
+        {
+            stages.pop_back();
+        }
+        std::remove(mesh_filename.c_str());
+        std::remove(gcode_filename.c_str());
+        std::remove(stages_filename.c_str());
+
+        report << (first_model ? "\n" : ",\n");
+        first_model = false;
+        report << "{\"name\":\"" << model.name << "\",\"triangles\":" << mesh.size() << ",\"wall_time\":" << wall_time;
+        report << ",\"peak_rss_kb\":" << peak_memory << ",\"output_bytes\":" << output_size;
+        if (compare_thread_count > 0)
+        {
+            report << ",\"identical_across_threads\":" << (is_identical ? "true" : "false");
+        }
+        report << ",\"instrumentation\":" << stages << "}";
+    }
+    report << "\n]}\n";
+
+    std::ofstream report_file(report_filename);
+    report_file << report.str();
+    if (!report_file)
+    {
+        logError("Failed to write the report to %s.\n", report_filename.c_str());
+        return 1;
+    }
+    return all_identical ? 0 : 1;
+}
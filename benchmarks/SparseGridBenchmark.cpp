@@ -0,0 +1,54 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <benchmark/benchmark.h>
+
+#include "BenchmarkPolygons.h"
+#include "../src/utils/SparsePointGridInclusive.h"
+
+namespace cura
+{
+
+/*
+ * The argument of each benchmark is the number of points in the grid.
+ */
+
+constexpr coord_t grid_cell_size = 2000;
+
+static void BM_SparsePointGridInsert(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0));
+    for (auto _ : state)
+    {
+        SparsePointGridInclusive<size_t> grid(grid_cell_size, points.size());
+        for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+        {
+            grid.insert(points[point_idx], point_idx);
+        }
+        benchmark::DoNotOptimize(grid);
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_SparsePointGridInsert)->RangeMultiplier(8)->Range(64, 262144);
+
+static void BM_SparsePointGridGetNearby(benchmark::State& state)
+{
+    const std::vector<Point> points = makePoints(state.range(0));
+    SparsePointGridInclusive<size_t> grid(grid_cell_size, points.size());
+    for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+    {
+        grid.insert(points[point_idx], point_idx);
+    }
+    const std::vector<Point> queries = makePoints(256, 1);
+    for (auto _ : state)
+    {
+        for (const Point& query : queries)
+        {
+            benchmark::DoNotOptimize(grid.getNearbyVals(query, grid_cell_size));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_SparsePointGridGetNearby)->RangeMultiplier(8)->Range(64, 262144);
+
+} //namespace cura
@@ -4,14 +4,20 @@
 #ifdef _OPENMP
     #include <omp.h> // omp_get_num_threads
 #endif // _OPENMP
+#include <cstring> //For strlen.
 #include <string>
+#include <vector>
 #include "Application.h"
 #include "FffProcessor.h"
+#include "GCodeStitcher.h" //To join chunks of g-code that were sliced separately.
 #include "communication/ArcusCommunication.h" //To connect via Arcus to the front-end.
 #include "communication/CommandLine.h" //To use the command line to slice stuff.
+#include "Slice.h" //To resolve definitions for a snapshot.
 #include "progress/Progress.h"
+#include "utils/GeometryDump.h" //To convert geometry dumps to SVG.
 #include "utils/logoutput.h"
 #include "utils/string.h" //For stringcasecompare.
+#include "utils/ThreadAffinity.h" //To pin threads to processors.
 
 namespace cura
 {
@@ -19,6 +25,7 @@ namespace cura
 Application::Application()
 : communication(nullptr)
 , current_slice(0)
+, keep_warm_state(false)
 {
 }
 
@@ -33,6 +40,11 @@ Application& Application::getInstance()
     return instance;
 }
 
+bool Application::isSliceCancelled() const
+{
+    return communication && communication->isSliceCancelled();
+}
+
 #ifdef ARCUS
 void Application::connect()
 {
@@ -64,6 +76,9 @@ void Application::connect()
                 case 'v':
                     increaseVerboseLevel();
                     break;
+                case 'w':
+                    keep_warm_state = true;
+                    break;
 #ifdef _OPENMP
                 case 'm':
                     str++;
@@ -72,6 +87,15 @@ void Application::connect()
                     n_threads = std::max(1, n_threads);
                     omp_set_num_threads(n_threads);
                     break;
+                case 'a':
+                    str++;
+                    if (!ThreadAffinity::setPlacement(str))
+                    {
+                        logError("Unknown thread placement: %s\n", str);
+                    }
+                    str += strlen(str); //The rest of the argument is the placement.
+                    str--;
+                    break;
 #endif // _OPENMP
                 default:
                     logError("Unknown option: %c\n", *str);
@@ -110,15 +134,18 @@ void Application::printHelp() const
     logAlways("CuraEngine connect <host>[:<port>] [-j <settings.def.json>]\n");
     logAlways("  --connect <host>[:<port>]\n\tConnect to <host> via a command socket, \n\tinstead of passing information via the command line\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
+    logAlways("  -w\n\tKeep slicing after the first slice, and reuse the sliced meshes and \n\ttheir walls, skin and infill if the settings they depend on didn't \n\tchange for the next slices.\n");
 #ifdef _OPENMP
-    logAlways("  -m<thread_count>\n\tSet the desired number of threads. Supports only a single digit.\n");
+    logAlways("  -m<thread_count>\n\tSet the desired number of threads. The threads of single stages can \n\tbe limited or tuned with the settings parallel_stage_threads and \n\tparallel_stage_tuning_file.\n");
+    logAlways("  -a<placement>\n\tPin the threads to processors: \"compact\" fills one NUMA node \n\tbefore the next, \"spread\" distributes them over the nodes in turn.\n");
 #endif // _OPENMP
     logAlways("\n");
 #endif //ARCUS
     logAlways("CuraEngine slice [-v] [-p] [-j <settings.json>] [-s <settingkey>=<value>] [-g] [-e<extruder_nr>] [-o <output.gcode>] [-l <model.stl>] [--next]\n");
     logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
 #ifdef _OPENMP
-    logAlways("  -m<thread_count>\n\tSet the desired number of threads.\n");
+    logAlways("  -m<thread_count>\n\tSet the desired number of threads. The threads of single stages can \n\tbe limited or tuned with the settings parallel_stage_threads and \n\tparallel_stage_tuning_file.\n");
+    logAlways("  -a<placement>\n\tPin the threads to processors: \"compact\" fills one NUMA node \n\tbefore the next, \"spread\" distributes them over the nodes in turn.\n");
 #endif // _OPENMP
     logAlways("  -p\n\tLog progress information.\n");
     logAlways("  -j\n\tLoad settings.def.json file to register all settings and their defaults.\n");
@@ -128,10 +155,29 @@ void Application::printHelp() const
     logAlways("  -e<extruder_nr>\n\tSwitch setting focus to the extruder train with the given number.\n");
     logAlways("  --next\n\tGenerate gcode for the previously supplied mesh group and append that to \n\tthe gcode of further models for one-at-a-time printing.\n");
     logAlways("  -o <output_file>\n\tSpecify a file to which to write the generated gcode.\n");
+#ifdef GZIP
+    logAlways("\tIf the file name ends in .gz, the gcode is compressed with gzip.\n");
+#endif //GZIP
     logAlways("\n");
     logAlways("The settings are appended to the last supplied object:\n");
     logAlways("CuraEngine slice [general settings] \n\t-g [current group settings] \n\t-e0 [extruder train 0 settings] \n\t-l obj_inheriting_from_last_extruder_train.stl [object settings] \n\t--next [next group settings]\n\t... etc.\n");
     logAlways("\n");
+    logAlways("CuraEngine batch <manifest> [-v] [-w]\n");
+    logAlways("  <manifest>\n\tA file with the arguments of one slice per line, as they would follow \n\t\"CuraEngine slice\". Empty lines and lines starting with # are skipped. \n\tThe slices are done one after the other in this process, parsing each \n\tJSON file only once. Use -m in the lines to set the threads per slice, \n\tand run several batches side by side to slice several jobs at once.\n");
+    logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
+    logAlways("  -w\n\tReuse the sliced meshes and their walls, skin and infill of earlier \n\tslices if the settings they depend on didn't change.\n");
+    logAlways("\n");
+    logAlways("CuraEngine snapshot <definition.def.json> <output_file> [-v]\n");
+    logAlways("  <definition.def.json>\n\tResolve the definition with everything it inherits from and write the \n\tsettings of it and of its extruder trains to <output_file>. The snapshot \n\tcan be loaded with -j instead of the definition, without parsing the JSON \n\tfiles again. Make a new snapshot whenever the definitions change.\n");
+    logAlways("  -v\n\tIncrease the verbose level (show log messages).\n");
+    logAlways("\n");
+    logAlways("CuraEngine dumpsvg <dump_file> <output_prefix>\n");
+    logAlways("  <dump_file>\n\tA geometry dump, written when slicing with the setting \n\tgeometry_dump_file, optionally limited to some layers with \n\tgeometry_dump_layers (like \"0,10-12\") and to some of the stages outlines, \n\twalls, skin, infill and support with geometry_dump_stages.\n");
+    logAlways("  <output_prefix>\n\tThe start of the SVG files to write, one for every stage and layer.\n");
+    logAlways("\n");
+    logAlways("CuraEngine stitch <output.gcode> <chunk.gcode>...\n");
+    logAlways("  <chunk.gcode>\n\tThe g-code of a chunk of the layers of a print, sliced with the \n\tsettings gcode_chunk_start_layer and gcode_chunk_end_layer. Several \n\tprocesses or machines can each slice a chunk of a large print. The \n\tchunks are listed in the order of their layers, and are joined into \n\tthe g-code of the whole print with the estimates of all chunks in its \n\theader.\n");
+    logAlways("\n");
     logAlways("In order to load machine definitions from custom locations, you need to create the environment variable CURA_ENGINE_SEARCH_PATH, which should contain all search paths delimited by a (semi-)colon.\n");
     logAlways("\n");
 }
@@ -167,6 +213,114 @@ void Application::slice()
     communication = new CommandLine(arguments);
 }
 
+void Application::batch()
+{
+    if (argc < 3)
+    {
+        logError("Missing manifest file for the batch.\n");
+        printHelp();
+        exit(1);
+    }
+    for (size_t argument_index = 3; argument_index < argc; argument_index++)
+    {
+        const std::string argument(argv[argument_index]);
+        if (argument == "-v")
+        {
+            increaseVerboseLevel();
+        }
+        else if (argument == "-w")
+        {
+            keep_warm_state = true;
+        }
+        else
+        {
+            logError("Unknown option: %s\n", argument.c_str());
+            printCall();
+            printHelp();
+            exit(1);
+        }
+    }
+
+    std::vector<std::vector<std::string>> jobs;
+    if (!CommandLine::readManifest(argv[2], argv[0], jobs))
+    {
+        logError("Couldn't read the manifest file: %s\n", argv[2]);
+        exit(1);
+    }
+    log("Slicing a batch of %zu jobs.\n", jobs.size());
+    communication = new CommandLine(jobs);
+}
+
+void Application::snapshot()
+{
+    if (argc < 4)
+    {
+        logError("Missing definition file or output file for the snapshot.\n");
+        printHelp();
+        exit(1);
+    }
+    for (size_t argument_index = 4; argument_index < argc; argument_index++)
+    {
+        const std::string argument(argv[argument_index]);
+        if (argument == "-v")
+        {
+            increaseVerboseLevel();
+        }
+        else
+        {
+            logError("Unknown option: %s\n", argument.c_str());
+            printCall();
+            printHelp();
+            exit(1);
+        }
+    }
+
+    //The definitions are resolved in a slice of their own, which is never sliced.
+    Slice slice(1);
+    current_slice = &slice;
+    CommandLine command_line((std::vector<std::vector<std::string>>()));
+    const bool success = command_line.writeSnapshot(argv[2], argv[3]);
+    current_slice = nullptr;
+    if (!success)
+    {
+        exit(1);
+    }
+}
+
+void Application::dumpSVG()
+{
+    if (argc < 4)
+    {
+        logError("Missing dump file or output prefix to convert to SVG.\n");
+        printHelp();
+        exit(1);
+    }
+    std::vector<GeometryDump::Record> records;
+    if (!GeometryDump::read(argv[2], records))
+    {
+        logError("Couldn't read the geometry dump: %s\n", argv[2]);
+        exit(1);
+    }
+    const size_t file_count = GeometryDump::writeSVGs(records, argv[3]);
+    logAlways("Wrote %zu SVG files of %zu records.\n", file_count, records.size());
+}
+
+void Application::stitch()
+{
+    if (argc < 4)
+    {
+        logError("Missing output file or chunks to stitch.\n");
+        printHelp();
+        exit(1);
+    }
+    const std::vector<std::string> chunk_files(argv + 3, argv + argc);
+    if (!GCodeStitcher::stitch(chunk_files, argv[2]))
+    {
+        exit(1);
+    }
+    logAlways("Stitched %zu chunks into %s.\n", chunk_files.size(), argv[2]);
+}
+
 void Application::run(const size_t argc, char** argv)
 {
     this->argc = argc;
@@ -204,6 +358,22 @@ void Application::run(const size_t argc, char** argv)
     {
         slice();
     }
+    else if (stringcasecompare(argv[1], "batch") == 0)
+    {
+        batch();
+    }
+    else if (stringcasecompare(argv[1], "snapshot") == 0)
+    {
+        snapshot();
+    }
+    else if (stringcasecompare(argv[1], "dumpsvg") == 0)
+    {
+        dumpSVG();
+    }
+    else if (stringcasecompare(argv[1], "stitch") == 0)
+    {
+        stitch();
+    }
     else if (stringcasecompare(argv[1], "help") == 0)
     {
         printHelp();
@@ -40,11 +40,30 @@ public:
      */
     Slice* current_slice;
 
+    /*!
+     * \brief Whether to keep state between slices, so that the next slices of
+     * a long-running engine are faster.
+     *
+     * This is enabled with the -w option when connecting to a front-end or
+     * when slicing a batch.
+     */
+    bool keep_warm_state;
+
     /*!
      * Gets the instance of this application class.
      */
     static Application& getInstance();
 
+    /*!
+     * \brief Whether the current slice has been superseded, so that the
+     * remaining work of it may be skipped.
+     *
+     * The loops over the layers check this once per layer, so that the slice
+     * stops soon after a front-end sends a new one. Data that is computed while
+     * this holds may be incomplete and must not be cached.
+     */
+    bool isSliceCancelled() const;
+
     /*!
      * \brief Print to the stderr channel what the original call to the executable was.
      */
@@ -87,6 +106,28 @@ protected:
      */
     void slice();
 
+    /*!
+     * \brief Start slicing a batch of jobs that are listed in a manifest file.
+     */
+    void batch();
+
+    /*!
+     * \brief Write a snapshot of a resolved definition file, to load it faster
+     * in later slices.
+     */
+    void snapshot();
+
+    /*!
+     * \brief Convert a geometry dump of a slice to SVG files.
+     */
+    void dumpSVG();
+
+    /*!
+     * \brief Join chunks of g-code that were sliced separately into the g-code
+     * of the whole print.
+     */
+    void stitch();
+
 private:
     /*
      * \brief The number of arguments that the application was called with.
@@ -25,7 +25,7 @@ void ConicalOverhang::apply(Slicer* slicer, const Mesh& mesh)
             // below magic code solves that
             int safe_dist = 20;
             Polygons diff = layer_above.polygons.difference(layer.polygons.offset(-safe_dist));
-            layer.polygons = layer.polygons.unionPolygons(diff);
+            layer.polygons.unionInPlace(diff);
             layer.polygons = layer.polygons.smooth(safe_dist);
             layer.polygons.simplify(safe_dist, safe_dist * safe_dist / 4);
             // somehow layer.polygons get really jagged lines with a lot of vertices
@@ -33,7 +33,7 @@ void ConicalOverhang::apply(Slicer* slicer, const Mesh& mesh)
         }
         else
         {
-            layer.polygons = layer.polygons.unionPolygons(layer_above.polygons.offset(-max_dist_from_lower_layer));
+            layer.polygons.unionInPlace(layer_above.polygons.offset(-max_dist_from_lower_layer));
         }
     }
 }
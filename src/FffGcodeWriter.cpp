@@ -3,12 +3,16 @@
 
 #include <list>
 #include <limits> // numeric_limits
+#ifdef _OPENMP
+#include <omp.h> //To share the threads between the shards of the layers.
+#endif // _OPENMP
 
 #include "Application.h"
 #include "bridge.h"
 #include "ExtruderTrain.h"
 #include "FffGcodeWriter.h"
 #include "FffProcessor.h"
+#include "GCodeStitcher.h" //To join the shards of the layers.
 #include "GcodeLayerThreader.h"
 #include "infill.h"
 #include "InsetOrderOptimizer.h"
@@ -19,10 +23,12 @@
 #include "communication/Communication.h" //To send layer view data.
 #include "infill/SpaghettiInfillPathGenerator.h"
 #include "progress/Progress.h"
+#include "utils/Instrumentation.h"
+#include "utils/linearAlg2D.h"
+#include "utils/logoutput.h"
 #include "utils/math.h"
 #include "utils/orderOptimizer.h"
-
-#define OMP_MAX_ACTIVE_LAYERS_PROCESSED 30 // TODO: hardcoded-value for the max number of layers being in the pipeline while writing away and destroying layers in a multi-threaded context
+#include "utils/StageThreads.h"
 
 namespace cura
 {
@@ -30,6 +36,8 @@ namespace cura
 FffGcodeWriter::FffGcodeWriter()
 : max_object_height(0)
 , layer_plan_buffer(gcode)
+, shard_first_layer_nr(-1)
+, shard_last_layer_nr(-1)
 {
     for (unsigned int extruder_nr = 0; extruder_nr < MAX_EXTRUDERS; extruder_nr++)
     { // initialize all as max layer_nr, so that they get updated to the lowest layer on which they are used.
@@ -37,25 +45,131 @@ FffGcodeWriter::FffGcodeWriter()
     }
 }
 
+bool FffGcodeWriter::setTargetFile(const char* filename)
+{
+    output_file.close();
+#ifdef GZIP
+    const std::string name(filename);
+    const std::string gzip_extension = ".gz";
+    if (name.size() >= gzip_extension.size() && name.compare(name.size() - gzip_extension.size(), gzip_extension.size(), gzip_extension) == 0)
+    {
+        if (compressed_output_file.open(filename)) // closes the previous compressed file, if any
+        {
+            gcode.setOutputStream(&compressed_output_file);
+            return true;
+        }
+        return false;
+    }
+    compressed_output_file.close();
+#endif //GZIP
+
+    if (output_file.open(filename)) // closes the previous file, if any
+    {
+        gcode.setOutputStream(&output_file);
+        return true;
+    }
+    return false;
+}
+
 void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keeper)
 {
+    const ScopedTimer timer("gcode");
+    const ScopedStageThreads stage_threads("gcode");
     const size_t start_extruder_nr = getStartExtruder(storage);
     gcode.preSetup(start_extruder_nr);
 
     Scene& scene = Application::getInstance().current_slice->scene;
+    //Quoting a print only needs the estimates of the print time and the material usage, not the g-code itself.
+    const bool estimates_only = scene.settings.has("print_estimates_only") && scene.settings.get<bool>("print_estimates_only");
+    gcode.setEstimatesOnly(estimates_only);
+
+    size_t total_layers = 0;
+    for (SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (mesh.isPrinted()) //No need to process higher layers if the non-printed meshes are higher than the normal meshes.
+        {
+            total_layers = std::max(total_layers, mesh.layers.size());
+        }
+
+        setSkinAngles(mesh);
+    }
+
+    //The layers can be written in shards, each by a writer of its own, to write several layers to g-code at the same time.
+    const size_t shard_count = isShard() ? 1 : getShardCount(total_layers);
+    if (shard_count > 1)
+    {
+        writeShards(storage, time_keeper, total_layers, shard_count);
+        return;
+    }
+
+    //A large print can be sliced by several processes that each write a chunk of its layers, which "CuraEngine stitch" joins afterwards.
+    //These are engine-only settings which front-ends normally don't send, so they're optional.
+    bool is_chunk = false;
+    LayerIndex chunk_first_layer_nr = 0;
+    LayerIndex chunk_last_layer_nr = static_cast<int>(total_layers) - 1;
+    if (isShard())
+    {
+        is_chunk = true;
+        chunk_first_layer_nr = shard_first_layer_nr;
+        chunk_last_layer_nr = shard_last_layer_nr;
+    }
+    else if (!estimates_only && (scene.settings.has("gcode_chunk_start_layer") || scene.settings.has("gcode_chunk_end_layer")))
+    {
+        if (scene.settings.has("gcode_chunk_start_layer"))
+        {
+            chunk_first_layer_nr = scene.settings.get<size_t>("gcode_chunk_start_layer");
+        }
+        if (scene.settings.has("gcode_chunk_end_layer"))
+        {
+            chunk_last_layer_nr = std::min(chunk_last_layer_nr, LayerIndex(scene.settings.get<size_t>("gcode_chunk_end_layer")));
+        }
+        if (scene.mesh_groups.size() > 1)
+        {
+            logWarning("Only prints with a single mesh group can be sliced in chunks of layers. Writing all layers.\n");
+        }
+        else if (chunk_first_layer_nr > chunk_last_layer_nr)
+        {
+            logError("The chunk of layers %d to %d is not part of the print of %zu layers. Writing all layers.\n", static_cast<int>(chunk_first_layer_nr), static_cast<int>(chunk_last_layer_nr), total_layers);
+        }
+        else
+        {
+            is_chunk = true;
+        }
+    }
+    else if (checkpoints.isEnabled())
+    {
+        //The layers that an earlier run with the same inputs wrote are only planned, like the layers before a chunk.
+        is_chunk = true;
+        chunk_first_layer_nr = checkpoints.getResumeLayer();
+    }
     if (scene.current_mesh_group == scene.mesh_groups.begin()) //First mesh group.
     {
         gcode.resetTotalPrintTimeAndFilament();
         gcode.setInitialTemps(start_extruder_nr);
+        if (checkpoints.isEnabled())
+        {
+            checkpoints.start(gcode);
+        }
+        else if (is_chunk)
+        {
+            gcode.setLayerRange(chunk_first_layer_nr, chunk_last_layer_nr);
+        }
     }
 
     Application::getInstance().communication->beginGCode();
 
     setConfigFanSpeedLayerTime();
 
-    setConfigRetraction(storage);
+    if (!isShard()) //The shards share the storage, in which the writer of the whole print set these already.
+    {
+        setConfigRetraction(storage);
 
-    setConfigWipe(storage);
+        setConfigWipe(storage);
+
+        setSettingsSnapshots(storage);
+    }
+
+    layer_plan_buffer.setPreheatConfig();
 
     if (scene.current_mesh_group == scene.mesh_groups.begin())
     {
@@ -66,17 +180,6 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
         processNextMeshGroupCode(storage);
     }
 
-    size_t total_layers = 0;
-    for (SliceMeshStorage& mesh : storage.meshes)
-    {
-        if (mesh.isPrinted()) //No need to process higher layers if the non-printed meshes are higher than the normal meshes.
-        {
-            total_layers = std::max(total_layers, mesh.layers.size());
-        }
-
-        setInfillAndSkinAngles(mesh);
-    }
-    
     gcode.writeLayerCountComment(total_layers);
 
     { // calculate the mesh order for each extruder
@@ -111,34 +214,92 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
         }
     }
 
+    int process_layer_end_layer_nr = total_layers;
+    if (is_chunk)
+    {
+        //The state of the printer at the start of the chunk depends on the layers below it, so some of those are planned as well but not written.
+        //Layers above the chunk are planned as far as they insert preheat commands in the layers of the chunk.
+        constexpr int chunk_warm_up_layers = 2 * LayerPlanBuffer::buffer_size;
+        constexpr int chunk_look_ahead_layers = LayerPlanBuffer::buffer_size;
+        if (chunk_first_layer_nr > 0)
+        {
+            process_layer_starting_layer_nr = std::max(process_layer_starting_layer_nr, static_cast<int>(chunk_first_layer_nr) - chunk_warm_up_layers);
+        }
+        process_layer_end_layer_nr = std::min(process_layer_end_layer_nr, static_cast<int>(chunk_last_layer_nr) + 1 + chunk_look_ahead_layers);
+    }
+
+    // The layers can be kept on disk or compressed in memory until their g-code is generated, for prints whose geometry doesn't fit in memory.
+    // These are engine-only settings which front-ends normally don't send, so they're optional.
+    const std::string layer_spill_directory = scene.settings.has("layer_spill_directory") ? scene.settings.get<std::string>("layer_spill_directory") : "";
+    const bool compress_idle_layers = scene.settings.has("compress_idle_layers") && scene.settings.get<bool>("compress_idle_layers");
+    const LayerIndex layer_lookback = getLayerLookback(storage);
+    if (!layer_spill_directory.empty() || compress_idle_layers)
+    {
+        storage.spillLayers(layer_spill_directory); // without a directory they're compressed in memory
+    }
 
+    const bool spiralize = scene.current_mesh_group->settings.get<bool>("magic_spiralize");
     const std::function<LayerPlan* (int)>& produce_item =
-        [&storage, total_layers, this](int layer_nr)
+        [&storage, total_layers, layer_lookback, spiralize, this](int layer_nr)
         {
+            if (spiralize)
+            {
+                findSpiralizedSeamsUpTo(storage, layer_nr); // each seam continues from the one below, so they're found in order as the layers come in
+            }
+            // Bring back the layers that this layer looks at, which are the same as those kept in memory below.
+            for (LayerIndex page_in_layer_nr = std::max(0, layer_nr - layer_lookback); page_in_layer_nr <= std::max(0, layer_nr); page_in_layer_nr++)
+            {
+                storage.pageInLayer(page_in_layer_nr);
+            }
             LayerPlan& gcode_layer = processLayer(storage, layer_nr, total_layers);
+            gcode_layer.trackMemory();
             return &gcode_layer;
         };
+    // Layers are consumed in order, so when a layer is consumed all layers up to it have been processed.
+    // The geometry that none of the layers above it look at anymore can then be freed.
     const std::function<void (LayerPlan*)>& consume_item =
-        [this, total_layers](LayerPlan* gcode_layer)
+        [this, &storage, total_layers, layer_lookback](LayerPlan* gcode_layer)
         {
-            Progress::messageProgress(Progress::Stage::EXPORT, std::max(0, gcode_layer->getLayerNr()) + 1, total_layers);
+            const LayerIndex layer_nr = gcode_layer->getLayerNr();
+            if (!isShard()) //The progress of the shards is reported per shard.
+            {
+                Progress::messageProgress(Progress::Stage::EXPORT, std::max(0, gcode_layer->getLayerNr()) + 1, total_layers);
+            }
             layer_plan_buffer.handle(*gcode_layer, gcode);
+            if (layer_nr - layer_lookback >= 0 && !isShard()) //The other shards may still need the layer.
+            {
+                storage.releaseLayer(layer_nr - layer_lookback);
+            }
         };
-    const unsigned int max_task_count = OMP_MAX_ACTIVE_LAYERS_PROCESSED;
+    // The number of layers in the pipeline is limited to keep the memory usage down.
+    // These are engine-only settings which front-ends normally don't send, so they're optional.
+    const size_t max_task_count = scene.settings.has("gcode_pipeline_max_layers") ? scene.settings.get<size_t>("gcode_pipeline_max_layers") : 0; // 0 means a few layers per thread
+    const double memory_limit_mb = scene.settings.has("gcode_pipeline_memory_limit") ? scene.settings.get<double>("gcode_pipeline_memory_limit") : 0.0; // 0 means unlimited
     GcodeLayerThreader<LayerPlan> threader(
         process_layer_starting_layer_nr
-        , static_cast<int>(total_layers)
+        , process_layer_end_layer_nr
         , produce_item
         , consume_item
         , max_task_count
     );
+    if (memory_limit_mb > 0.0)
+    {
+        threader.setMemoryLimit(memory_limit_mb * 1024 * 1024, [](const LayerPlan* gcode_layer) { return gcode_layer->getMemoryUsage(); });
+    }
+    threader.setCancelCheck([]() { return Application::getInstance().isSliceCancelled(); }); // a superseded slice stops after the layers in the pipeline
 
     // process all layers, process buffer for preheating and minimal layer time etc, write layers to gcode:
+    gcode.setTaskScheduler(&threader.getScheduler()); // let idle threads help converting the layers to text
     threader.run();
+    gcode.setTaskScheduler(nullptr);
 
     layer_plan_buffer.flush();
+    if (!isShard())
+    {
+        storage.measureMemory("memory_after_gcode");
 
-    Progress::messageProgressStage(Progress::Stage::FINISH, &time_keeper);
+        Progress::messageProgressStage(Progress::Stage::FINISH, &time_keeper);
+    }
 
     //Store the object height for when we are printing multiple objects, as we need to clear every one of them when moving to the next position.
     max_object_height = std::max(max_object_height, storage.model_max.z);
@@ -148,12 +309,101 @@ void FffGcodeWriter::writeGCode(SliceDataStorage& storage, TimeKeeper& time_keep
     gcode.writeRetraction(storage.retraction_config_per_extruder[gcode.getExtruderNr()], force); // retract after finishing each meshgroup
 }
 
-unsigned int FffGcodeWriter::findSpiralizedLayerSeamVertexIndex(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const int layer_nr, const int last_layer_nr)
+size_t FffGcodeWriter::getShardCount(const size_t total_layers) const
+{
+    //These are engine-only settings which front-ends normally don't send, so they're optional.
+    const Scene& scene = Application::getInstance().current_slice->scene;
+    const size_t requested_count = scene.settings.has("gcode_shard_count") ? scene.settings.get<size_t>("gcode_shard_count") : 1;
+    if (requested_count <= 1)
+    {
+        return 1;
+    }
+    if (scene.mesh_groups.size() > 1 || scene.current_mesh_group->settings.get<bool>("magic_spiralize"))
+    {
+        logWarning("Only prints with a single mesh group and without spiralizing can be written in shards. Writing all layers at once.\n");
+        return 1;
+    }
+    if (!Application::getInstance().communication->isSequential() || checkpoints.isEnabled()
+        || scene.settings.has("gcode_chunk_start_layer") || scene.settings.has("gcode_chunk_end_layer")
+        || (scene.settings.has("print_estimates_only") && scene.settings.get<bool>("print_estimates_only")))
+    {
+        logWarning("Only complete prints sliced from the command line without checkpoints can be written in shards. Writing all layers at once.\n");
+        return 1;
+    }
+    if ((scene.settings.has("layer_spill_directory") && !scene.settings.get<std::string>("layer_spill_directory").empty())
+        || (scene.settings.has("compress_idle_layers") && scene.settings.get<bool>("compress_idle_layers")))
+    {
+        logWarning("Layers that are kept out of memory can't be written in shards. Writing all layers at once.\n");
+        return 1;
+    }
+    //Each shard plans up to three times the layer plan buffer of other layers, so a shard should have more layers than that.
+    constexpr size_t minimum_shard_layers = 4 * LayerPlanBuffer::buffer_size;
+    return std::max(size_t(1), std::min(requested_count, total_layers / minimum_shard_layers));
+}
+
+void FffGcodeWriter::writeShards(SliceDataStorage& storage, TimeKeeper& time_keeper, const size_t total_layers, const size_t shard_count)
+{
+    const ScopedTimer timer("gcode_shards");
+    log("Writing the layers in %zu shards.\n", shard_count);
+
+    //The writers of the shards only read the storage, so what they'd set in it is set here once.
+    setConfigRetraction(storage);
+    setConfigWipe(storage);
+    setSettingsSnapshots(storage);
+
+    std::vector<std::unique_ptr<FffGcodeWriter>> shard_writers;
+    shard_outputs.clear();
+    for (size_t shard_idx = 0; shard_idx < shard_count; shard_idx++)
+    {
+        shard_writers.emplace_back(new FffGcodeWriter());
+        FffGcodeWriter& shard_writer = *shard_writers.back();
+        shard_writer.shard_first_layer_nr = shard_idx * total_layers / shard_count;
+        shard_writer.shard_last_layer_nr = (shard_idx + 1) * total_layers / shard_count - 1;
+        shard_outputs.emplace_back(new std::stringstream());
+        shard_writer.setTargetStream(shard_outputs.back().get());
+    }
+
+#ifdef _OPENMP
+    const int thread_count = std::max(1, omp_get_max_threads());
+    const int parallel_shard_count = std::min(static_cast<int>(shard_count), thread_count);
+    const int max_active_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(std::max(2, max_active_levels)); //The pipeline of each shard runs its threads within those of the shards.
+#endif // _OPENMP
+    size_t finished_shard_count = 0;
+#pragma omp parallel for num_threads(parallel_shard_count) schedule(dynamic)
+    for (int shard_idx = 0; shard_idx < static_cast<int>(shard_count); shard_idx++)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(std::max(1, thread_count / parallel_shard_count)); //Share the threads between the shards that are written at the same time.
+#endif // _OPENMP
+        FffGcodeWriter& shard_writer = *shard_writers[shard_idx];
+        TimeKeeper shard_time_keeper;
+        shard_writer.writeGCode(storage, shard_time_keeper);
+        shard_writer.finalize();
+#pragma omp critical (gcode_shards)
+        {
+            finished_shard_count++;
+            Progress::messageProgress(Progress::Stage::EXPORT, finished_shard_count, shard_count);
+        }
+    }
+#ifdef _OPENMP
+    omp_set_max_active_levels(max_active_levels);
+#endif // _OPENMP
+
+    storage.measureMemory("memory_after_gcode");
+    Progress::messageProgressStage(Progress::Stage::FINISH, &time_keeper);
+    max_object_height = std::max(max_object_height, storage.model_max.z);
+}
+
+bool FffGcodeWriter::isShard() const
 {
-    const SliceLayer& layer = mesh.layers[layer_nr];
+    return shard_first_layer_nr >= 0;
+}
 
-    // last_layer_nr will be < 0 until we have processed the first non-empty layer
-    if (last_layer_nr < 0)
+unsigned int FffGcodeWriter::findSpiralizedLayerSeamVertexIndex(const SliceMeshStorage& mesh, ConstPolygonRef wall, const int layer_nr) const
+{
+    // has_last_seam will be false until we have processed the first non-empty layer
+    if (!spiralize_seams.has_last_seam)
     {
         // If the user has specified a z-seam location, use the vertex closest to that location for the seam vertex
         // in the first layer that has a part with insets. This allows the user to alter the seam start location which
@@ -163,17 +413,15 @@ unsigned int FffGcodeWriter::findSpiralizedLayerSeamVertexIndex(const SliceDataS
         {
             seam_pos = mesh.getZSeamHint();
         }
-        return PolygonUtils::findClosest(seam_pos, layer.parts[0].insets[0][0]).point_idx;
+        return PolygonUtils::findClosest(seam_pos, wall).point_idx;
     }
     else
     {
-        // note that the code below doesn't assume that last_layer_nr is one less than layer_nr but the print is going
+        // note that the code below doesn't assume that the last spiralized layer is one less than layer_nr but the print is going
         // to come out pretty weird if that isn't true as it implies that there are empty layers
 
-        ConstPolygonRef last_wall = (*storage.spiralize_wall_outlines[last_layer_nr])[0];
-        ConstPolygonRef wall = layer.parts[0].insets[0][0];
         const int n_points = wall.size();
-        Point last_wall_seam_vertex = last_wall[storage.spiralize_seam_vertex_indices[last_layer_nr]];
+        const Point last_wall_seam_vertex = spiralize_seams.last_seam_vertex;
 
         // seam_vertex_idx is going to be the index of the seam vertex in the current wall polygon
         // initially we choose the vertex that is closest to the seam vertex in the last spiralized layer processed
@@ -183,11 +431,8 @@ unsigned int FffGcodeWriter::findSpiralizedLayerSeamVertexIndex(const SliceDataS
         // now we check that the vertex following the seam vertex is to the left of the seam vertex in the last layer
         // and if it isn't, we move forward
 
-        // get the inward normal of the last layer seam vertex
-        Point last_wall_seam_vertex_inward_normal = PolygonUtils::getVertexInwardNormal(last_wall, storage.spiralize_seam_vertex_indices[last_layer_nr]);
-
-        // create a vector from the normal so that we can then test the vertex following the candidate seam vertex to make sure it is on the correct side
-        Point last_wall_seam_vertex_vector = last_wall_seam_vertex + last_wall_seam_vertex_inward_normal;
+        // create a vector from the inward normal of the last layer seam vertex so that we can then test the vertex following the candidate seam vertex to make sure it is on the correct side
+        Point last_wall_seam_vertex_vector = last_wall_seam_vertex + spiralize_seams.last_seam_inward_normal;
 
         // now test the vertex following the candidate seam vertex and if it lies to the left of the vector, it's good to use
         const int first_seam_vertex_idx = seam_vertex_idx;
@@ -217,19 +462,16 @@ void FffGcodeWriter::findLayerSeamsForSpiralize(SliceDataStorage& storage, size_
 
     // we track the seam position for each layer and ensure that the seam position for next layer continues in the right direction
 
-    storage.spiralize_wall_outlines.reserve(total_layers);
-    storage.spiralize_seam_vertex_indices.reserve(total_layers);
-
-    int last_layer_nr = -1; // layer number of the last non-empty layer processed (for any extruder or mesh)
+    storage.spiralize_wall_outlines.assign(total_layers, nullptr); // default is no information available
+    storage.spiralize_seam_vertex_indices.assign(total_layers, 0);
+    spiralize_seams.mesh_per_layer.assign(total_layers, nullptr);
+    spiralize_seams.next_layer_nr = 0;
+    spiralize_seams.has_last_seam = false;
 
     for (unsigned layer_nr = 0; layer_nr < total_layers; ++layer_nr)
     {
         bool done_this_layer = false;
 
-        // default is no information available
-        storage.spiralize_wall_outlines[layer_nr] = nullptr;
-        storage.spiralize_seam_vertex_indices[layer_nr] = 0;
-
         // iterate through extruders until we find a mesh that has a part with insets
         const std::vector<size_t>& extruder_order = extruder_order_per_layer[layer_nr];
         for (unsigned int extruder_idx = 0; !done_this_layer && extruder_idx < extruder_order.size(); ++extruder_idx)
@@ -244,14 +486,11 @@ void FffGcodeWriter::findLayerSeamsForSpiralize(SliceDataStorage& storage, size_
                 if (!done_this_layer && mesh.layers.size() > layer_nr)
                 {
                     SliceLayer& layer = mesh.layers[layer_nr];
-                    // if the first part in the layer (if any) has insets, process it
+                    // if the first part in the layer (if any) has insets, its outer wall is spiralized
                     if (layer.parts.size() != 0 && layer.parts[0].insets.size() != 0)
                     {
-                        // save the seam vertex index for this layer as we need it to determine the seam vertex index for the next layer
-                        storage.spiralize_seam_vertex_indices[layer_nr] = findSpiralizedLayerSeamVertexIndex(storage, mesh, layer_nr, last_layer_nr);
-                        // save the wall outline for this layer so it can be used in the spiralize interpolation calculation
-                        storage.spiralize_wall_outlines[layer_nr] = &layer.parts[0].insets[0];
-                        last_layer_nr = layer_nr;
+                        // the wall outline itself is looked up once the layer is in memory, see findSpiralizedSeamsUpTo
+                        spiralize_seams.mesh_per_layer[layer_nr] = &mesh;
                         // ignore any further meshes/extruders for this layer
                         done_this_layer = true;
                     }
@@ -261,6 +500,65 @@ void FffGcodeWriter::findLayerSeamsForSpiralize(SliceDataStorage& storage, size_
     }
 }
 
+void FffGcodeWriter::findSpiralizedSeamsUpTo(SliceDataStorage& storage, const LayerIndex layer_nr)
+{
+    std::lock_guard<std::mutex> lock(spiralize_seams.mutex);
+    const LayerIndex last_layer_nr = std::min(layer_nr, LayerIndex(spiralize_seams.mesh_per_layer.size()) - 1);
+    for (; spiralize_seams.next_layer_nr <= last_layer_nr; spiralize_seams.next_layer_nr++)
+    {
+        const LayerIndex seam_layer_nr = spiralize_seams.next_layer_nr;
+        SliceMeshStorage* mesh = spiralize_seams.mesh_per_layer[seam_layer_nr];
+        if (!mesh)
+        {
+            continue;
+        }
+        // the layer may have been spilled, so only once it's back its walls are where they stay until the layer is released
+        storage.pageInLayer(seam_layer_nr);
+        Polygons& wall_outline = mesh->layers[seam_layer_nr].parts[0].insets[0];
+        // save the wall outline for this layer so it can be used in the spiralize interpolation calculation
+        storage.spiralize_wall_outlines[seam_layer_nr] = &wall_outline;
+        // save the seam vertex index for this layer as we need it to determine the seam vertex index for the next layer
+        ConstPolygonRef wall = wall_outline[0];
+        const unsigned int seam_vertex_idx = findSpiralizedLayerSeamVertexIndex(*mesh, wall, seam_layer_nr);
+        storage.spiralize_seam_vertex_indices[seam_layer_nr] = seam_vertex_idx;
+        // the layers below are released while the layers above are processed, so keep what the next seam depends on
+        spiralize_seams.has_last_seam = true;
+        spiralize_seams.last_seam_vertex = wall[seam_vertex_idx];
+        spiralize_seams.last_seam_inward_normal = PolygonUtils::getVertexInwardNormal(wall, seam_vertex_idx);
+    }
+}
+
+LayerIndex FffGcodeWriter::getLayerLookback(const SliceDataStorage& storage)
+{
+    const LayerIndex max_bridge_layer = 3; //Bridge skins look at the outlines up to 3 layers below them.
+    LayerIndex lookback = max_bridge_layer;
+
+    //The skin looks at the support below the top distance, and the bridge skins up to 2 layers below that.
+    //The top distance is counted in the thickness of the layer itself, so take the thinnest layer to be safe.
+    coord_t min_layer_thickness = std::numeric_limits<coord_t>::max();
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        for (const SliceLayer& layer : mesh.layers)
+        {
+            if (layer.thickness > 0)
+            {
+                min_layer_thickness = std::min(min_layer_thickness, layer.thickness);
+            }
+        }
+    }
+    if (min_layer_thickness == std::numeric_limits<coord_t>::max())
+    {
+        return lookback;
+    }
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        const coord_t z_distance_top = mesh.settings.get<coord_t>("support_top_distance");
+        const LayerIndex z_distance_top_layers = round_up_divide(z_distance_top, min_layer_thickness) + 1;
+        lookback = std::max(lookback, z_distance_top_layers + max_bridge_layer - 1);
+    }
+    return lookback;
+}
+
 void FffGcodeWriter::setConfigFanSpeedLayerTime()
 {
     for (const ExtruderTrain& train : Application::getInstance().current_slice->scene.extruders)
@@ -343,6 +641,19 @@ void FffGcodeWriter::setConfigWipe(SliceDataStorage& storage)
     }
 }
 
+void FffGcodeWriter::setSettingsSnapshots(SliceDataStorage& storage)
+{
+    for (SliceMeshStorage& mesh : storage.meshes)
+    {
+        mesh.settings_snapshot = MeshSettingsSnapshot(mesh.settings);
+    }
+    storage.settings_snapshot_per_extruder.clear();
+    for (const ExtruderTrain& train : Application::getInstance().current_slice->scene.extruders)
+    {
+        storage.settings_snapshot_per_extruder.emplace_back(train.settings);
+    }
+}
+
 unsigned int FffGcodeWriter::getStartExtruder(const SliceDataStorage& storage)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
@@ -363,31 +674,8 @@ unsigned int FffGcodeWriter::getStartExtruder(const SliceDataStorage& storage)
     return start_extruder_nr;
 }
 
-void FffGcodeWriter::setInfillAndSkinAngles(SliceMeshStorage& mesh)
+void FffGcodeWriter::setSkinAngles(SliceMeshStorage& mesh)
 {
-    if (mesh.infill_angles.size() == 0)
-    {
-        mesh.infill_angles = mesh.settings.get<std::vector<AngleDegrees>>("infill_angles");
-        if (mesh.infill_angles.size() == 0)
-        {
-            // user has not specified any infill angles so use defaults
-            const EFillMethod infill_pattern = mesh.settings.get<EFillMethod>("infill_pattern");
-            if (infill_pattern == EFillMethod::CROSS || infill_pattern == EFillMethod::CROSS_3D)
-            {
-                mesh.infill_angles.push_back(22); // put most infill lines in between 45 and 0 degrees
-            }
-            else
-            {
-                mesh.infill_angles.push_back(45); // generally all infill patterns use 45 degrees
-                if (infill_pattern == EFillMethod::LINES || infill_pattern == EFillMethod::ZIG_ZAG)
-                {
-                    // lines and zig zag patterns default to also using 135 degrees
-                    mesh.infill_angles.push_back(135);
-                }
-            }
-        }
-    }
-
     if (mesh.roofing_angles.size() == 0)
     {
         mesh.roofing_angles = mesh.settings.get<std::vector<AngleDegrees>>("roofing_angles");
@@ -497,7 +785,7 @@ void FffGcodeWriter::processStartingCode(const SliceDataStorage& storage, const
     if (Application::getInstance().communication->isSequential()) //If we must output the g-code sequentially, we must already place the g-code header here even if we don't know the exact time/material usages yet.
     {
         std::string prefix = gcode.getFileHeader(extruder_is_used);
-        gcode.writeCode(prefix.c_str());
+        gcode.writeFileHeader(prefix); //Replaced in finalize() if the output is a file.
     }
 
     gcode.writeComment("Generated with Cura_SteamEngine " VERSION);
@@ -766,6 +1054,7 @@ void FffGcodeWriter::processRaft(const SliceDataStorage& storage)
 
 LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIndex layer_nr, const size_t total_layers) const
 {
+    const ScopedTimer timer("layer_plan", layer_nr);
     logDebug("GcodeWriter processing layer %i of %i\n", layer_nr, total_layers);
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
@@ -909,9 +1198,12 @@ LayerPlan& FffGcodeWriter::processLayer(const SliceDataStorage& storage, LayerIn
 
     if (!disable_path_optimisation)
     {
-        gcode_layer.optimizePaths(gcode.getPositionXY());
+        gcode_layer.optimizePaths(gcode.getPositionXY(), gcode.getTaskScheduler());
     }
 
+    // the layer is complete, so most of its time estimates can be computed here rather than in the (serial) layer plan buffer
+    gcode_layer.precomputeNaiveTimeEstimates();
+
     return gcode_layer;
 }
 
@@ -1196,8 +1488,8 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
         return;
     }
 
-    if (mesh.settings.get<bool>("anti_overhang_mesh")
-        || mesh.settings.get<bool>("support_mesh")
+    if (mesh.settings_snapshot.anti_overhang_mesh
+        || mesh.settings_snapshot.support_mesh
     )
     {
         return;
@@ -1210,12 +1502,10 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
         return;
     }
 
-    const ExtruderTrain& train = Application::getInstance().current_slice->scene.extruders[extruder_nr];
     gcode_layer.setMesh(mesh.mesh_name);
 
-    ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"));
-    const Point layer_start_position(train.settings.get<coord_t>("layer_start_x"), train.settings.get<coord_t>("layer_start_y"));
-    PathOrderOptimizer part_order_optimizer(layer_start_position, z_seam_config);
+    ZSeamConfig z_seam_config(mesh.settings_snapshot.z_seam_type, mesh.getZSeamHint(), mesh.settings_snapshot.z_seam_corner);
+    PathOrderOptimizer part_order_optimizer(storage.settings_snapshot_per_extruder[extruder_nr].layer_start_position, z_seam_config);
     for (unsigned int part_idx = 0; part_idx < layer.parts.size(); part_idx++)
     {
         const SliceLayerPart& part = layer.parts[part_idx];
@@ -1230,7 +1520,7 @@ void FffGcodeWriter::addMeshLayerToGCode(const SliceDataStorage& storage, const
         addMeshPartToGCode(storage, mesh, extruder_nr, mesh_config, part, gcode_layer);
     }
     processIroning(mesh, layer, mesh_config.ironing_config, gcode_layer);
-    if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+    if (mesh.settings_snapshot.magic_mesh_surface_mode != ESurfaceMode::NORMAL && extruder_nr == mesh.settings_snapshot.wall_0_extruder_nr)
     {
         addMeshOpenPolyLinesToGCode(mesh, mesh_config, gcode_layer);
     }
@@ -1243,7 +1533,7 @@ void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const S
 
     bool added_something = false;
 
-    if (mesh.settings.get<bool>("infill_before_walls"))
+    if (mesh.settings_snapshot.infill_before_walls)
     {
         added_something = added_something | processInfill(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
     }
@@ -1252,7 +1542,7 @@ void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const S
 
     processOutlineGaps(storage, gcode_layer, mesh, extruder_nr, mesh_config, part, added_something);
 
-    if (!mesh.settings.get<bool>("infill_before_walls"))
+    if (!mesh.settings_snapshot.infill_before_walls)
     {
         added_something = added_something | processInfill(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
     }
@@ -1260,14 +1550,9 @@ void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const S
     added_something = added_something | processSkinAndPerimeterGaps(storage, gcode_layer, mesh, extruder_nr, mesh_config, part);
 
     //After a layer part, make sure the nozzle is inside the comb boundary, so we do not retract on the perimeter.
-    if (added_something && (!mesh_group_settings.get<bool>("magic_spiralize") || gcode_layer.getLayerNr() < static_cast<LayerIndex>(mesh.settings.get<size_t>("bottom_layers"))))
+    if (added_something && (!mesh_group_settings.get<bool>("magic_spiralize") || gcode_layer.getLayerNr() < static_cast<LayerIndex>(mesh.settings_snapshot.bottom_layers)))
     {
-        coord_t innermost_wall_line_width = mesh.settings.get<coord_t>((mesh.settings.get<size_t>("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
-        if (gcode_layer.getLayerNr() == 0)
-        {
-            innermost_wall_line_width *= mesh.settings.get<Ratio>("initial_layer_line_width_factor");
-        }
-        gcode_layer.moveInsideCombBoundary(innermost_wall_line_width);
+        gcode_layer.moveInsideCombBoundary(mesh.settings_snapshot.getInnermostWallLineWidth(gcode_layer.getLayerNr()));
     }
 
     gcode_layer.setIsInside(false);
@@ -1275,11 +1560,11 @@ void FffGcodeWriter::addMeshPartToGCode(const SliceDataStorage& storage, const S
 
 bool FffGcodeWriter::processInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+    if (extruder_nr != mesh.settings_snapshot.infill_extruder_nr)
     {
         return false;
     }
-    if (mesh.settings.get<bool>("spaghetti_infill_enabled"))
+    if (mesh.settings_snapshot.spaghetti_infill_enabled)
     {
         return SpaghettiInfillPathGenerator::processSpaghettiInfill(storage, *this, gcode_layer, mesh, extruder_nr, mesh_config, part);
     }
@@ -1293,62 +1578,25 @@ bool FffGcodeWriter::processInfill(const SliceDataStorage& storage, LayerPlan& g
 
 bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+    if (extruder_nr != mesh.settings_snapshot.infill_extruder_nr)
     {
         return false;
     }
-    const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
+    const coord_t infill_line_distance = mesh.settings_snapshot.infill_line_distance;
     if (infill_line_distance <= 0)
     {
         return false;
     }
 
-    const coord_t infill_overlap = mesh.settings.get<coord_t>("infill_overlap_mm");
-    AngleDegrees infill_angle = 45; //Original default. This will get updated to an element from mesh->infill_angles.
-    if (!mesh.infill_angles.empty())
-    {
-        const size_t combined_infill_layers = std::max(unsigned(1), round_divide(mesh.settings.get<coord_t>("infill_sparse_thickness"), std::max(mesh.settings.get<coord_t>("layer_height"), coord_t(1))));
-        infill_angle = mesh.infill_angles.at((gcode_layer.getLayerNr() / combined_infill_layers) % mesh.infill_angles.size());
-    }
-    const Point3 mesh_middle = mesh.bounding_box.getMiddle();
-    const Point infill_origin(mesh_middle.x + mesh.settings.get<coord_t>("infill_offset_x"), mesh_middle.y + mesh.settings.get<coord_t>("infill_offset_y"));
-
     //Print the thicker infill lines first. (double or more layer thickness, infill combined with previous layers)
+    //The lines themselves are generated beforehand, see FffPolygonGenerator::processInfillLines.
     bool added_something = false;
-    for(unsigned int combine_idx = 1; combine_idx < part.infill_area_per_combine_per_density[0].size(); combine_idx++)
-    {
-        const coord_t infill_line_width = mesh_config.infill_config[combine_idx].getLineWidth();
-        const EFillMethod infill_pattern = mesh.settings.get<EFillMethod>("infill_pattern");
-        const bool zig_zaggify_infill = mesh.settings.get<bool>("zig_zaggify_infill") || infill_pattern == EFillMethod::ZIG_ZAG;
-        const bool connect_polygons = mesh.settings.get<bool>("connect_infill_polygons");
-        const size_t infill_multiplier = mesh.settings.get<size_t>("infill_multiplier");
-        Polygons infill_polygons;
-        Polygons infill_lines;
-        for (size_t density_idx = part.infill_area_per_combine_per_density.size() - 1; (int)density_idx >= 0; density_idx--)
-        { // combine different density infill areas (for gradual infill)
-            size_t density_factor = 2 << density_idx; // == pow(2, density_idx + 1)
-            coord_t infill_line_distance_here = infill_line_distance * density_factor; // the highest density infill combines with the next to create a grid with density_factor 1
-            coord_t infill_shift = infill_line_distance_here / 2;
-            if (density_idx == part.infill_area_per_combine_per_density.size() - 1 || infill_pattern == EFillMethod::CROSS || infill_pattern == EFillMethod::CROSS_3D)
-            {
-                infill_line_distance_here /= 2;
-            }
-
-            constexpr size_t wall_line_count = 0; // wall lines are always single layer
-            Polygons* perimeter_gaps = nullptr;
-            constexpr bool connected_zigzags = false;
-            constexpr bool use_endpieces = true;
-            constexpr bool skip_some_zags = false;
-            constexpr size_t zag_skip_count = 0;
-            const coord_t maximum_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
-
-            Infill infill_comp(infill_pattern, zig_zaggify_infill, connect_polygons, part.infill_area_per_combine_per_density[density_idx][combine_idx], /*outline_offset =*/ 0
-                , infill_line_width, infill_line_distance_here, infill_overlap, infill_multiplier, infill_angle, gcode_layer.z, infill_shift, wall_line_count, infill_origin
-                , perimeter_gaps, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count
-                , mesh.settings.get<coord_t>("cross_infill_pocket_size")
-                , maximum_resolution);
-            infill_comp.generate(infill_polygons, infill_lines, mesh.cross_fill_provider, &mesh);
-        }
+    for(unsigned int combine_idx = 1; combine_idx < part.infill_lines_per_combine.size(); combine_idx++)
+    {
+        const EFillMethod infill_pattern = mesh.settings_snapshot.infill_pattern;
+        const bool zig_zaggify_infill = mesh.settings_snapshot.zig_zaggify_infill || infill_pattern == EFillMethod::ZIG_ZAG;
+        const Polygons& infill_polygons = part.infill_polygons_per_combine[combine_idx];
+        const Polygons& infill_lines = part.infill_lines_per_combine[combine_idx];
         if (!infill_lines.empty() || !infill_polygons.empty())
         {
             added_something = true;
@@ -1360,7 +1608,7 @@ bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, La
                 gcode_layer.addTravel(infill_polygons[0][0], force_comb_retract);
                 gcode_layer.addPolygonsByOptimizer(infill_polygons, mesh_config.infill_config[combine_idx]);
             }
-            const bool enable_travel_optimization = mesh.settings.get<bool>("infill_enable_travel_optimization");
+            const bool enable_travel_optimization = mesh.settings_snapshot.infill_enable_travel_optimization;
             gcode_layer.addLinesByOptimizer(infill_lines, mesh_config.infill_config[combine_idx], zig_zaggify_infill ? SpaceFillType::PolyLines : SpaceFillType::Lines, enable_travel_optimization);
         }
     }
@@ -1369,95 +1617,23 @@ bool FffGcodeWriter::processMultiLayerInfill(const SliceDataStorage& storage, La
 
 bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+    if (extruder_nr != mesh.settings_snapshot.infill_extruder_nr)
     {
         return false;
     }
-    const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
-    if (infill_line_distance == 0 || part.infill_area_per_combine_per_density[0].size() == 0)
+    const coord_t infill_line_distance = mesh.settings_snapshot.infill_line_distance;
+    if (infill_line_distance == 0 || part.infill_lines_per_combine.size() == 0)
     {
         return false;
     }
     bool added_something = false;
-    const coord_t infill_line_width = mesh_config.infill_config[0].getLineWidth();
 
     //Combine the 1 layer thick infill with the top/bottom skin and print that as one thing.
-    Polygons infill_polygons;
-    Polygons infill_lines;
-
-    const EFillMethod pattern = mesh.settings.get<EFillMethod>("infill_pattern");
-    const bool zig_zaggify_infill = mesh.settings.get<bool>("zig_zaggify_infill") || pattern == EFillMethod::ZIG_ZAG;
-    const bool connect_polygons = mesh.settings.get<bool>("connect_infill_polygons");
-    const coord_t infill_overlap = mesh.settings.get<coord_t>("infill_overlap_mm");
-    const size_t infill_multiplier = mesh.settings.get<size_t>("infill_multiplier");
-    const size_t wall_line_count = mesh.settings.get<size_t>("infill_wall_line_count");
-    AngleDegrees infill_angle = 45; //Original default. This will get updated to an element from mesh->infill_angles.
-    if (mesh.infill_angles.size() > 0)
-    {
-        const size_t combined_infill_layers = std::max(unsigned(1), round_divide(mesh.settings.get<coord_t>("infill_sparse_thickness"), std::max(mesh.settings.get<coord_t>("layer_height"), coord_t(1))));
-        infill_angle = mesh.infill_angles.at((gcode_layer.getLayerNr() / combined_infill_layers) % mesh.infill_angles.size());
-    }
-    const Point3 mesh_middle = mesh.bounding_box.getMiddle();
-    const Point infill_origin(mesh_middle.x + mesh.settings.get<coord_t>("infill_offset_x"), mesh_middle.y + mesh.settings.get<coord_t>("infill_offset_y"));
-    for (unsigned int density_idx = part.infill_area_per_combine_per_density.size() - 1; (int)density_idx >= 0; density_idx--)
-    {
-        int infill_line_distance_here = infill_line_distance << (density_idx + 1); // the highest density infill combines with the next to create a grid with density_factor 1
-        int infill_shift = infill_line_distance_here / 2;
-        // infill shift explanation: [>]=shift ["]=line_dist
-// :       |       :       |       :       |       :       |         > furthest from top
-// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
-// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
-// >>"""""
-// :       |       :       |       :       |       :       |         > furthest from top
-// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
-// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
-// >>>>"""""""""
-// :       |       :       |       :       |       :       |         > furthest from top
-// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
-// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
-// >>>>>>>>"""""""""""""""""
-
-        const coord_t maximum_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
-
-        if (density_idx == part.infill_area_per_combine_per_density.size() - 1 || pattern == EFillMethod::CROSS || pattern == EFillMethod::CROSS_3D)
-        { // the least dense infill should fill up all remaining gaps
-// :       |       :       |       :       |       :       |       :  > furthest from top
-// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |   :  > further from top
-// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | | :  > near top
-//   .   .     .       .           .               .       .       .
-//   :   :     :       :           :               :       :       :
-//   `"""'     `"""""""'           `"""""""""""""""'       `"""""""'
-//                                                             ^   new line distance for lowest density infill
-//                                       ^ infill_line_distance_here for lowest density infill up till here
-//                 ^ middle density line dist
-//     ^   highest density line dist
-            
-            //All of that doesn't hold for the Cross patterns; they should just always be multiplied by 2 for every density index.
-            infill_line_distance_here /= 2;
-        }
-
-        Polygons in_outline = part.infill_area_per_combine_per_density[density_idx][0];
-        const coord_t circumference = in_outline.polygonLength();
-        //Originally an area of 0.4*0.4*2 (2 line width squares) was found to be a good threshold for removal.
-        //However we found that this doesn't scale well with polygons with larger circumference (https://github.com/Ultimaker/Cura/issues/3992).
-        //Given that the original test worked for approximately 2x2cm models, this scaling by circumference should make it work for any size.
-        const double minimum_small_area = 0.4 * 0.4 * circumference / 40000;
-        
-        // This is only for density infill, because after generating the infill might appear unnecessary infill on walls
-        // especially on vertical surfaces
-        in_outline.removeSmallAreas(minimum_small_area);
-        
-        Infill infill_comp(pattern, zig_zaggify_infill, connect_polygons, in_outline, /*outline_offset =*/ 0
-            , infill_line_width, infill_line_distance_here, infill_overlap, infill_multiplier, infill_angle, gcode_layer.z, infill_shift, wall_line_count, infill_origin
-            , /*Polygons* perimeter_gaps =*/ nullptr
-            , /*bool connected_zigzags =*/ false
-            , /*bool use_endpieces =*/ false
-            , /*bool skip_some_zags =*/ false
-            , /*int zag_skip_count =*/ 0
-            , mesh.settings.get<coord_t>("cross_infill_pocket_size")
-            , maximum_resolution);
-        infill_comp.generate(infill_polygons, infill_lines, mesh.cross_fill_provider, &mesh);
-    }
+    //The lines themselves are generated beforehand, see FffPolygonGenerator::processInfillLines.
+    const Polygons& infill_polygons = part.infill_polygons_per_combine[0];
+    const Polygons& infill_lines = part.infill_lines_per_combine[0];
+
+    const EFillMethod pattern = mesh.settings_snapshot.infill_pattern;
     if (infill_lines.size() > 0 || infill_polygons.size() > 0)
     {
         added_something = true;
@@ -1469,10 +1645,10 @@ bool FffGcodeWriter::processSingleLayerInfill(const SliceDataStorage& storage, L
             gcode_layer.addTravel(infill_polygons[0][0], force_comb_retract);
             gcode_layer.addPolygonsByOptimizer(infill_polygons, mesh_config.infill_config[0]);
         }
-        const bool enable_travel_optimization = mesh.settings.get<bool>("infill_enable_travel_optimization");
+        const bool enable_travel_optimization = mesh.settings_snapshot.infill_enable_travel_optimization;
         if (pattern == EFillMethod::GRID || pattern == EFillMethod::LINES || pattern == EFillMethod::TRIANGLES || pattern == EFillMethod::CUBIC || pattern == EFillMethod::TETRAHEDRAL || pattern == EFillMethod::QUARTER_CUBIC || pattern == EFillMethod::CUBICSUBDIV)
         {
-            gcode_layer.addLinesByOptimizer(infill_lines, mesh_config.infill_config[0], SpaceFillType::Lines, enable_travel_optimization, mesh.settings.get<coord_t>("infill_wipe_dist"));
+            gcode_layer.addLinesByOptimizer(infill_lines, mesh_config.infill_config[0], SpaceFillType::Lines, enable_travel_optimization, mesh.settings_snapshot.infill_wipe_dist);
         }
         else
         {
@@ -1510,15 +1686,15 @@ void FffGcodeWriter::processSpiralizedWall(const SliceDataStorage& storage, Laye
 
 bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    if (extruder_nr != mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr && extruder_nr != mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr)
+    if (extruder_nr != mesh.settings_snapshot.wall_0_extruder_nr && extruder_nr != mesh.settings_snapshot.wall_x_extruder_nr)
     {
         return false;
     }
     bool added_something = false;
-    const bool compensate_overlap_0 = mesh.settings.get<bool>("travel_compensate_overlapping_walls_0_enabled");
-    const bool compensate_overlap_x = mesh.settings.get<bool>("travel_compensate_overlapping_walls_x_enabled");
-    const bool retract_before_outer_wall = mesh.settings.get<bool>("travel_retract_before_outer_wall");
-    if (mesh.settings.get<size_t>("wall_line_count") > 0)
+    const bool compensate_overlap_0 = mesh.settings_snapshot.travel_compensate_overlapping_walls_0_enabled;
+    const bool compensate_overlap_x = mesh.settings_snapshot.travel_compensate_overlapping_walls_x_enabled;
+    const bool retract_before_outer_wall = mesh.settings_snapshot.travel_retract_before_outer_wall;
+    if (mesh.settings_snapshot.wall_line_count > 0)
     {
         bool spiralize = false;
         if(Application::getInstance().current_slice->scene.current_mesh_group->settings.get<bool>("magic_spiralize"))
@@ -1528,12 +1704,12 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
                 // nothing to do
                 return false;
             }
-            const size_t bottom_layers = mesh.settings.get<size_t>("bottom_layers");
+            const size_t bottom_layers = mesh.settings_snapshot.bottom_layers;
             if (gcode_layer.getLayerNr() >= static_cast<LayerIndex>(bottom_layers))
             {
                 spiralize = true;
             }
-            if (spiralize && gcode_layer.getLayerNr() == static_cast<LayerIndex>(bottom_layers) && !part.insets.empty() && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+            if (spiralize && gcode_layer.getLayerNr() == static_cast<LayerIndex>(bottom_layers) && !part.insets.empty() && extruder_nr == mesh.settings_snapshot.wall_0_extruder_nr)
             { // on the last normal layer first make the outer wall normally and then start a second outer wall from the same hight, but gradually moving upward
                 added_something = true;
                 setExtruder_addPrime(storage, gcode_layer, extruder_nr);
@@ -1554,12 +1730,10 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
             {
                 if (m.isPrinted())
                 {
-                    for (const SliceLayerPart& prevLayerPart : m.layers[gcode_layer.getLayerNr() - 1].parts)
+                    const SliceLayer& prev_layer = m.layers[gcode_layer.getLayerNr() - 1];
+                    for (const size_t prev_part_idx : prev_layer.getPartsHitting(boundaryBox))
                     {
-                        if (boundaryBox.hit(prevLayerPart.boundaryBox))
-                        {
-                            outlines_below.add(prevLayerPart.outline);
-                        }
+                        outlines_below.add(prev_layer.parts[prev_part_idx].outline);
                     }
                 }
             }
@@ -1607,7 +1781,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
 
             outlines_below = outlines_below.offset(-half_outer_wall_width).offset(half_outer_wall_width);
 
-            if (mesh.settings.get<bool>("bridge_settings_enabled"))
+            if (mesh.settings_snapshot.bridge_settings_enabled)
             {
                 // max_air_gap is the max allowed width of the unsupported region below the wall line
                 // if the unsupported region is wider than max_air_gap, the wall line will be printed using bridge settings
@@ -1631,7 +1805,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
                 gcode_layer.setBridgeWallMask(Polygons());
             }
 
-            const AngleDegrees overhang_angle = mesh.settings.get<AngleDegrees>("wall_overhang_angle");
+            const AngleDegrees overhang_angle = mesh.settings_snapshot.wall_overhang_angle;
             if (overhang_angle >= 90)
             {
                 // clear to disable overhang detection
@@ -1661,7 +1835,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         // one part higher up. Once all the parts have merged, layers above that level will be spiralized
         if (spiralize && &mesh.layers[gcode_layer.getLayerNr()].parts[0] == &part)
         {
-            if (part.insets.size() > 0 && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+            if (part.insets.size() > 0 && extruder_nr == mesh.settings_snapshot.wall_0_extruder_nr)
             {
                 added_something = true;
                 setExtruder_addPrime(storage, gcode_layer, extruder_nr);
@@ -1676,7 +1850,7 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
         }
         else
         {
-            const bool outer_inset_first = mesh.settings.get<bool>("outer_inset_first")
+            const bool outer_inset_first = mesh.settings_snapshot.outer_inset_first
                 || (gcode_layer.getLayerNr() == 0 && mesh.settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::BRIM);
             int processed_inset_number = -1;
             for (int inset_number = part.insets.size() - 1; inset_number > -1; inset_number--)
@@ -1690,33 +1864,32 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
                 if (processed_inset_number == 0)
                 {
                     constexpr float flow = 1.0;
-                    if (part.insets[0].size() > 0 && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+                    if (part.insets[0].size() > 0 && extruder_nr == mesh.settings_snapshot.wall_0_extruder_nr)
                     {
                         added_something = true;
                         setExtruder_addPrime(storage, gcode_layer, extruder_nr);
                         gcode_layer.setIsInside(true); // going to print stuff inside print object
-                        ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"));
-                        Polygons outer_wall = part.insets[0];
+                        ZSeamConfig z_seam_config(mesh.settings_snapshot.z_seam_type, mesh.getZSeamHint(), mesh.settings_snapshot.z_seam_corner);
                         if (!compensate_overlap_0)
                         {
                             WallOverlapComputation* wall_overlap_computation(nullptr);
-                            gcode_layer.addWalls(outer_wall, mesh, mesh_config.inset0_config, mesh_config.bridge_inset0_config, wall_overlap_computation, z_seam_config, mesh.settings.get<coord_t>("wall_0_wipe_dist"), flow, retract_before_outer_wall);
+                            gcode_layer.addWalls(part.insets[0], mesh, mesh_config.inset0_config, mesh_config.bridge_inset0_config, wall_overlap_computation, z_seam_config, mesh.settings_snapshot.wall_0_wipe_dist, flow, retract_before_outer_wall);
                         }
                         else
                         {
-                            WallOverlapComputation wall_overlap_computation(outer_wall, mesh_config.inset0_config.getLineWidth());
-                            gcode_layer.addWalls(outer_wall, mesh, mesh_config.inset0_config, mesh_config.bridge_inset0_config, &wall_overlap_computation, z_seam_config, mesh.settings.get<coord_t>("wall_0_wipe_dist"), flow, retract_before_outer_wall);
+                            const PolygonProximityLinker& overlap_linker = *part.wall_overlap_linkers[0];
+                            WallOverlapComputation wall_overlap_computation(overlap_linker);
+                            gcode_layer.addWalls(overlap_linker.getPolygons(), mesh, mesh_config.inset0_config, mesh_config.bridge_inset0_config, &wall_overlap_computation, z_seam_config, mesh.settings_snapshot.wall_0_wipe_dist, flow, retract_before_outer_wall);
                         }
                     }
                 }
                 // Inner walls are processed
-                else if (!part.insets[processed_inset_number].empty() && extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr)
+                else if (!part.insets[processed_inset_number].empty() && extruder_nr == mesh.settings_snapshot.wall_x_extruder_nr)
                 {
                     added_something = true;
                     setExtruder_addPrime(storage, gcode_layer, extruder_nr);
                     gcode_layer.setIsInside(true); // going to print stuff inside print object
-                    ZSeamConfig z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner"));
-                    Polygons inner_wall = part.insets[processed_inset_number];
+                    ZSeamConfig z_seam_config(mesh.settings_snapshot.z_seam_type, mesh.getZSeamHint(), mesh.settings_snapshot.z_seam_corner);
                     if (!compensate_overlap_x)
                     {
                         WallOverlapComputation* wall_overlap_computation(nullptr);
@@ -1724,8 +1897,9 @@ bool FffGcodeWriter::processInsets(const SliceDataStorage& storage, LayerPlan& g
                     }
                     else
                     {
-                        WallOverlapComputation wall_overlap_computation(inner_wall, mesh_config.insetX_config.getLineWidth());
-                        gcode_layer.addWalls(inner_wall, mesh, mesh_config.insetX_config, mesh_config.bridge_insetX_config, &wall_overlap_computation, z_seam_config);
+                        const PolygonProximityLinker& overlap_linker = *part.wall_overlap_linkers[processed_inset_number];
+                        WallOverlapComputation wall_overlap_computation(overlap_linker);
+                        gcode_layer.addWalls(overlap_linker.getPolygons(), mesh, mesh_config.insetX_config, mesh_config.bridge_insetX_config, &wall_overlap_computation, z_seam_config);
                     }
                 }
             }
@@ -1771,8 +1945,8 @@ std::optional<Point> FffGcodeWriter::getSeamAvoidingLocation(const Polygons& fil
 
 void FffGcodeWriter::processOutlineGaps(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part, bool& added_something) const
 {
-    size_t wall_0_extruder_nr = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr;
-    if (extruder_nr != wall_0_extruder_nr || !mesh.settings.get<bool>("fill_outline_gaps"))
+    size_t wall_0_extruder_nr = mesh.settings_snapshot.wall_0_extruder_nr;
+    if (extruder_nr != wall_0_extruder_nr || !mesh.settings_snapshot.fill_outline_gaps)
     {
         return;
     }
@@ -1799,7 +1973,7 @@ void FffGcodeWriter::processOutlineGaps(const SliceDataStorage& storage, LayerPl
     constexpr bool skip_some_zags = false;
     constexpr int zag_skip_count = 0;
     constexpr coord_t pocket_size = 0;
-    const coord_t maximum_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
+    const coord_t maximum_resolution = mesh.settings_snapshot.meshfix_maximum_resolution;
 
     Infill infill_comp(
         EFillMethod::LINES, zig_zaggify_infill, connect_polygons, part.outline_gaps, offset, perimeter_gaps_line_width, perimeter_gaps_line_width, outline_gap_overlap, infill_multiplier, skin_angle, gcode_layer.z, extra_infill_shift,
@@ -1819,17 +1993,17 @@ void FffGcodeWriter::processOutlineGaps(const SliceDataStorage& storage, LayerPl
 
 bool FffGcodeWriter::processSkinAndPerimeterGaps(const SliceDataStorage& storage, LayerPlan& gcode_layer, const SliceMeshStorage& mesh, const size_t extruder_nr, const PathConfigStorage::MeshPathConfigs& mesh_config, const SliceLayerPart& part) const
 {
-    const size_t top_bottom_extruder_nr = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr;
-    const size_t roofing_extruder_nr = mesh.settings.get<ExtruderTrain&>("roofing_extruder_nr").extruder_nr;
-    const size_t wall_0_extruder_nr = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr;
+    const size_t top_bottom_extruder_nr = mesh.settings_snapshot.top_bottom_extruder_nr;
+    const size_t roofing_extruder_nr = mesh.settings_snapshot.roofing_extruder_nr;
+    const size_t wall_0_extruder_nr = mesh.settings_snapshot.wall_0_extruder_nr;
     if (extruder_nr != top_bottom_extruder_nr && extruder_nr != wall_0_extruder_nr
-        && (extruder_nr != roofing_extruder_nr || mesh.settings.get<size_t>("roofing_layer_count") <= 0))
+        && (extruder_nr != roofing_extruder_nr || mesh.settings_snapshot.roofing_layer_count <= 0))
     {
         return false;
     }
     bool added_something = false;
 
-    const bool fill_perimeter_gaps = mesh.settings.get<FillPerimeterGapMode>("fill_perimeter_gaps") != FillPerimeterGapMode::NOWHERE
+    const bool fill_perimeter_gaps = mesh.settings_snapshot.fill_perimeter_gaps != FillPerimeterGapMode::NOWHERE
                             && !Application::getInstance().current_slice->scene.current_mesh_group->settings.get<bool>("magic_spiralize")
                             && extruder_nr == wall_0_extruder_nr;
 
@@ -1877,7 +2051,7 @@ bool FffGcodeWriter::processSkinPart(const SliceDataStorage& storage, LayerPlan&
     {
         Polygons perimeter_gaps = top_bottom_concentric_perimeter_gaps;
         perimeter_gaps.add(roofing_concentric_perimeter_gaps);
-        if (extruder_nr == mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+        if (extruder_nr == mesh.settings_snapshot.wall_0_extruder_nr)
         {
             perimeter_gaps.add(skin_part.perimeter_gaps);
         }
@@ -2012,7 +2186,7 @@ void FffGcodeWriter::processTopBottom(const SliceDataStorage& storage, LayerPlan
                 {
                     if (PolygonUtils::polygonsIntersect(skin_part.outline.outerPolygon(), other_skin_part.outline.outerPolygon()))
                     {
-                        skin_outline = skin_outline.unionPolygons(other_skin_part.outline);
+                        skin_outline.unionInPlace(other_skin_part.outline);
                     }
                 }
             }
@@ -2168,17 +2342,22 @@ void FffGcodeWriter::processSkinPrintFeature(const SliceDataStorage& storage, La
         }
 
         std::optional<Point> near_start_location;
-        const EFillMethod pattern = (gcode_layer.getLayerNr() == 0) ?
+        const EFillMethod top_bottom_fill = (gcode_layer.getLayerNr() == 0) ?
             mesh.settings.get<EFillMethod>("top_bottom_pattern_0") :
             mesh.settings.get<EFillMethod>("top_bottom_pattern");
-        if (pattern == EFillMethod::LINES || pattern == EFillMethod::ZIG_ZAG)
+        if (top_bottom_fill == EFillMethod::LINES || top_bottom_fill == EFillMethod::ZIG_ZAG)
         { // update near_start_location to a location which tries to avoid seams in skin
             near_start_location = getSeamAvoidingLocation(area, skin_angle, gcode_layer.getLastPlannedPositionOrStartingPosition());
         }
 
         constexpr bool enable_travel_optimization = false;
         constexpr float flow = 1.0;
-        if (pattern == EFillMethod::GRID || pattern == EFillMethod::LINES || pattern == EFillMethod::TRIANGLES || pattern == EFillMethod::CUBIC || pattern == EFillMethod::TETRAHEDRAL || pattern == EFillMethod::QUARTER_CUBIC || pattern == EFillMethod::CUBICSUBDIV)
+        if (pattern == EFillMethod::LINES)
+        {
+            // the lines are all parallel, so they can be ordered without the generic optimizer
+            gcode_layer.addParallelLines(skin_lines, config, SpaceFillType::Lines, mesh.settings.get<coord_t>("infill_wipe_dist"), flow, near_start_location, fan_speed);
+        }
+        else if (pattern == EFillMethod::GRID || pattern == EFillMethod::TRIANGLES || pattern == EFillMethod::CUBIC || pattern == EFillMethod::TETRAHEDRAL || pattern == EFillMethod::QUARTER_CUBIC || pattern == EFillMethod::CUBICSUBDIV)
         {
             gcode_layer.addLinesByOptimizer(skin_lines, config, SpaceFillType::Lines, enable_travel_optimization, mesh.settings.get<coord_t>("infill_wipe_dist"), flow, near_start_location, fan_speed);
         }
@@ -2397,7 +2576,7 @@ bool FffGcodeWriter::processSupportInfill(const SliceDataStorage& storage, Layer
                                    support_line_distance_here, current_support_infill_overlap, infill_multiplier, support_infill_angle, gcode_layer.z, support_shift, wall_line_count, infill_origin,
                                    perimeter_gaps, infill_extruder.settings.get<bool>("support_connect_zigzags"), use_endpieces,
                                    skip_some_zags, zag_skip_count, pocket_size, maximum_resolution);
-                infill_comp.generate(support_polygons, support_lines, storage.support.cross_fill_provider);
+                infill_comp.generate(support_polygons, support_lines, storage.support.cross_fill_provider.get());
             }
 
             if (support_lines.size() > 0 || support_polygons.size() > 0)
@@ -2641,6 +2820,26 @@ void FffGcodeWriter::addPrimeTower(const SliceDataStorage& storage, LayerPlan& g
 
 void FffGcodeWriter::finalize()
 {
+    if (checkpoints.isComplete()) //An earlier run wrote all layers, so they only have to be joined.
+    {
+        checkpoints.finish(gcode);
+        return;
+    }
+    if (!shard_outputs.empty()) //The shards were finalized by their own writers, so they only have to be joined.
+    {
+        std::vector<std::istream*> shards;
+        for (const std::unique_ptr<std::stringstream>& shard_output : shard_outputs)
+        {
+            shards.push_back(shard_output.get());
+        }
+        std::ostream* output = gcode.getOutputStream();
+        if (GCodeStitcher::stitch(shards, *output))
+        {
+            output->flush();
+        }
+        shard_outputs.clear();
+        return;
+    }
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     if (mesh_group_settings.get<bool>("machine_heated_bed"))
     {
@@ -2664,7 +2863,7 @@ void FffGcodeWriter::finalize()
     {
         Application::getInstance().communication->sendGCodePrefix(prefix);
     }
-    else
+    else if (!gcode.rewriteFileHeader(prefix) && !isShard()) //The output can't go back to the header at the start, e.g. because it's compressed or not a file. The header of the shards is made when joining them.
     {
         log("Gcode header after slicing:\n");
         log("%s", prefix.c_str());
@@ -2701,6 +2900,10 @@ void FffGcodeWriter::finalize()
     }
 
     gcode.writeComment("End of Gcode");
+    if (checkpoints.isEnabled())
+    {
+        checkpoints.finish(gcode);
+    }
     /*
     the profile string below can be executed since the M25 doesn't end the gcode on an UMO and when printing via USB.
     gcode.writeCode("M25 ;Stop reading from this point on.");
@@ -4,12 +4,19 @@
 #ifndef GCODE_WRITER_H
 #define GCODE_WRITER_H
 
-#include <fstream>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <sstream>
+
 #include "FanSpeedLayerTime.h"
+#include "GCodeCheckpoints.h"
 #include "gcodeExport.h"
 #include "LayerPlanBuffer.h"
 #include "settings/PathConfigStorage.h" //For the MeshPathConfigs subclass.
+#include "utils/AsyncFileStream.h"
+#include "utils/GzipFileStream.h"
 #include "utils/NoCopy.h"
+#include "utils/polygon.h"
 
 namespace std
 {
@@ -60,7 +67,36 @@ private:
     /*!
      * The gcode file to write to when using CuraEngine as command line tool.
      */
-    std::ofstream output_file;
+    AsyncFileStream output_file;
+
+#ifdef GZIP
+    /*!
+     * The compressed gcode file to write to when using CuraEngine as command
+     * line tool with a file name ending in ".gz".
+     */
+    GzipFileStream compressed_output_file;
+#endif //GZIP
+
+    /*!
+     * The g-code of the finished layers, kept on disk so that a slice that
+     * was stopped can continue where it was.
+     */
+    GCodeCheckpoints checkpoints;
+
+    /*!
+     * The first layer that this writer writes, if it writes one shard of the
+     * layers for \ref FffGcodeWriter::writeShards, or -1 if it writes the
+     * whole print.
+     */
+    LayerIndex shard_first_layer_nr;
+
+    LayerIndex shard_last_layer_nr; //!< The last layer that this writer writes, if it writes one shard of the layers.
+
+    /*!
+     * The g-code of each shard of the layers, if the layers were written in
+     * shards. They are joined into the output when finalizing.
+     */
+    std::vector<std::unique_ptr<std::stringstream>> shard_outputs;
 
     /*!
      * For each raft/filler layer, the extruders to be used in that layer in the order in which they are going to be used.
@@ -84,6 +120,23 @@ private:
 
     std::vector<FanSpeedLayerTimeSettings> fan_speed_layer_time_settings_per_extruder; //!< The settings used relating to minimal layer time and fan speeds. Configured for each extruder.
 
+    /*!
+     * \brief How far the seams of the spiralized layers have been found.
+     *
+     * Each seam continues from the seam of the spiralized layer below it, so
+     * they are found in order, while the layers are processed. See
+     * \ref FffGcodeWriter::findSpiralizedSeamsUpTo.
+     */
+    struct SpiralizeSeamProgress
+    {
+        std::mutex mutex; //!< Held while seams are being found.
+        LayerIndex next_layer_nr; //!< The first layer whose seam hasn't been found yet.
+        bool has_last_seam; //!< Whether any layer below next_layer_nr has a spiralized wall.
+        Point last_seam_vertex; //!< The seam of the highest spiralized wall below next_layer_nr.
+        Point last_seam_inward_normal; //!< The inward normal of that wall at its seam.
+        std::vector<SliceMeshStorage*> mesh_per_layer; //!< For each layer the mesh whose wall is spiralized, or nullptr if none.
+    } spiralize_seams;
+
 public:
     /*
      * \brief Construct a g-code writer.
@@ -98,18 +151,12 @@ public:
      * 
      * Used when CuraEngine is used as command line tool.
      * 
+     * If the file name ends in ".gz", the gcode is compressed with gzip while
+     * it's being written.
+     * 
      * \param filename The filename of the file to which to write the gcode.
      */
-    bool setTargetFile(const char* filename)
-    {
-        output_file.open(filename);
-        if (output_file.is_open())
-        {
-            gcode.setOutputStream(&output_file);
-            return true;
-        }
-        return false;
-    }
+    bool setTargetFile(const char* filename);
 
     /*!
      * Set the target to write gcode to: an output stream.
@@ -156,6 +203,42 @@ public:
     void writeGCode(SliceDataStorage& storage, TimeKeeper& timeKeeper);
 
 private:
+    /*!
+     * \brief Get the number of shards to write the layers of the current mesh
+     * group in, according to the engine-only setting gcode_shard_count.
+     *
+     * Writing in shards is only possible for a single mesh group, sliced from
+     * the command line, which isn't spiralized and whose layers aren't spilled.
+     * Every shard plans some layers below it again, so a print with few
+     * layers gets fewer shards than requested.
+     * \param total_layers The number of layers of the print.
+     * \return The number of shards, or 1 to write all layers at once.
+     */
+    size_t getShardCount(const size_t total_layers) const;
+
+    /*!
+     * \brief Write the layers in shards of consecutive layers, each with a
+     * writer of its own, several at the same time.
+     *
+     * Each shard is written like a chunk of \ref GCodeExport::setLayerRange:
+     * its writer plans a few layers below it again for the state of the
+     * printer at its start, and restates that state. The shards are kept in
+     * memory until \ref FffGcodeWriter::finalize joins them with
+     * \ref GCodeStitcher.
+     * \param[in] storage The data storage from which to get the polygons to
+     * print and the areas to fill.
+     * \param time_keeper The stop watch of the slicing process.
+     * \param total_layers The number of layers of the print.
+     * \param shard_count The number of shards to write.
+     */
+    void writeShards(SliceDataStorage& storage, TimeKeeper& time_keeper, const size_t total_layers, const size_t shard_count);
+
+    /*!
+     * \brief Whether this writer writes one shard of the layers for
+     * \ref FffGcodeWriter::writeShards.
+     */
+    bool isShard() const;
+
     /*!
      * \brief Set the FffGcodeWriter::fan_speed_layer_time_settings by
      * retrieving all settings from the global/per-meshgroup settings.
@@ -183,6 +266,15 @@ private:
      */
     void setConfigWipe(SliceDataStorage& storage);
 
+    /*!
+     * Resolve the settings that are read for every part, wall and travel move
+     * into \ref SliceMeshStorage::settings_snapshot and
+     * \ref SliceDataStorage::settings_snapshot_per_extruder.
+     *
+     * \param[out] storage The data storage to which to save the resolved settings.
+     */
+    void setSettingsSnapshots(SliceDataStorage& storage);
+
     /*!
      * Get the extruder with which to start the print.
      * 
@@ -194,13 +286,14 @@ private:
     unsigned int getStartExtruder(const SliceDataStorage& storage);
 
     /*!
-     * Set the infill angles and skin angles in the SliceDataStorage.
+     * Set the roofing angles and skin angles in the SliceDataStorage.
      * 
-     * These lists of angles are cycled through to get the infill angle of a specific layer.
+     * These lists of angles are cycled through to get the skin angle of a specific layer.
+     * The infill angles are set along with the infill lines, in FffPolygonGenerator::setInfillAngles.
      * 
-     * \param mesh The mesh for which to determine the infill and skin angles.
+     * \param mesh The mesh for which to determine the roofing and skin angles.
      */
-    void setInfillAndSkinAngles(SliceMeshStorage& mesh);
+    void setSkinAngles(SliceMeshStorage& mesh);
 
     /*!
     * Set temperatures for the initial layer. Called by 'processStartingCode' and whenever a new object is started at layer 0.
@@ -700,21 +793,46 @@ private:
     void finalize();
 
     /*!
-     * Calculate for each layer the index of the vertex that is considered to be the seam
+     * Find for each layer the wall outline that is spiralized. The seams on
+     * these outlines are found later, by
+     * \ref FffGcodeWriter::findSpiralizedSeamsUpTo.
      * \param storage where the slice data is stored.
      * \param total_layers The total number of layers
      */
     void findLayerSeamsForSpiralize(SliceDataStorage& storage, size_t total_layers);
 
     /*!
-     * Calculate the index of the vertex that is considered to be the seam for the given layer
+     * \brief Find the seams of the spiralized layers up to a layer, as far as
+     * they haven't been found yet.
+     *
+     * This is called before a layer is processed. It may be called from
+     * several threads at once; each seam is found only once, in order.
      * \param storage where the slice data is stored.
+     * \param layer_nr The highest layer of which the seam is needed.
+     */
+    void findSpiralizedSeamsUpTo(SliceDataStorage& storage, const LayerIndex layer_nr);
+
+    /*!
+     * Calculate the index of the vertex that is considered to be the seam for the given layer
      * \param mesh the mesh containing the layer of interest
+     * \param wall the spiralized wall of the layer
      * \param layer_nr layer number of the layer whose seam verted index is required
-     * \param last_layer_nr layer number of the previous layer
      * \return layer seam vertex index
      */
-    unsigned int findSpiralizedLayerSeamVertexIndex(const SliceDataStorage& storage, const SliceMeshStorage& mesh, const int layer_nr, const int last_layer_nr);
+    unsigned int findSpiralizedLayerSeamVertexIndex(const SliceMeshStorage& mesh, ConstPolygonRef wall, const int layer_nr) const;
+
+    /*!
+     * \brief How many layers below the layer being processed the processing
+     * of a layer may look at.
+     *
+     * The g-code of a layer looks at the layers below it for bridges, for the
+     * support below its skin and for the outline of the spiralized wall of the
+     * previous layer. Once the g-code of a layer has been generated, the
+     * geometry of the layer this many layers below it is no longer needed.
+     * \param storage Where the slice data is stored.
+     * \return The number of layers below the processed layer that are read.
+     */
+    static LayerIndex getLayerLookback(const SliceDataStorage& storage);
 };
 
 }//namespace cura
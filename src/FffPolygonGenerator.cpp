@@ -2,7 +2,11 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map> // multimap (ordered map allowing duplicate keys)
+#include <memory> //For unique_ptr.
+#include <unordered_map> //To find copies of meshes.
 #include <fstream> // ifstream.good()
 
 #ifdef _OPENMP
@@ -14,6 +18,7 @@
 #include "ExtruderTrain.h"
 #include "FffPolygonGenerator.h"
 #include "infill.h"
+#include "InsetOrderOptimizer.h" //To know which walls are printed together.
 #include "layerPart.h"
 #include "MeshGroup.h"
 #include "Mold.h"
@@ -21,6 +26,7 @@
 #include "PrintFeature.h"
 #include "raft.h"
 #include "skin.h"
+#include "SkinWallCache.h"
 #include "SkirtBrim.h"
 #include "Slice.h"
 #include "sliceDataStorage.h"
@@ -32,20 +38,26 @@
 #include "infill/DensityProvider.h"
 #include "infill/ImageBasedDensityProvider.h"
 #include "infill/SierpinskiFillProvider.h"
+#include "infill/SierpinskiFillProviderCache.h"
 #include "infill/SpaghettiInfill.h"
 #include "infill/SubDivCube.h"
 #include "infill/UniformDensityProvider.h"
 #include "progress/Progress.h"
-#include "progress/ProgressEstimator.h"
-#include "progress/ProgressEstimatorLinear.h"
-#include "progress/ProgressStageEstimator.h"
 #include "settings/AdaptiveLayerHeights.h"
+#include "settings/PathConfigStorage.h" //For the line width of the infill on the first layer.
+#include "settings/SettingsRecorder.h" //To record which settings the walls, skin and infill depend on.
 #include "settings/types/AngleRadians.h"
 #include "settings/types/LayerIndex.h"
 #include "utils/algorithm.h"
+#include "utils/DeterministicRandom.h" //For reproducible fuzzy skin.
+#include "utils/GeometryDump.h" //To dump the areas of selected layers.
 #include "utils/gettime.h"
+#include "utils/Instrumentation.h"
 #include "utils/logoutput.h"
 #include "utils/math.h"
+#include "utils/PolygonProximityLinker.h"
+#include "utils/StageThreads.h"
+#include "utils/TaskScheduler.h"
 
 
 namespace cura
@@ -54,16 +66,101 @@ namespace cura
 
 bool FffPolygonGenerator::generateAreas(SliceDataStorage& storage, MeshGroup* meshgroup, TimeKeeper& timeKeeper)
 {
+    prefetchDensityImages(*meshgroup);
     if (!sliceModel(meshgroup, timeKeeper, storage))
     {
+        ImageBasedDensityProvider::dropPrefetched();
         return false;
     }
+    storage.measureMemory("memory_after_slicing");
 
-    slices2polygons(storage, timeKeeper);
+    const bool generated = slices2polygons(storage, timeKeeper);
+    ImageBasedDensityProvider::dropPrefetched(); //The cross infill and cross support have their density providers by now.
+    if (!generated)
+    {
+        return false;
+    }
+    storage.measureMemory("memory_after_areas");
+
+    dumpGeometry(storage);
 
     return true;
 }
 
+void FffPolygonGenerator::dumpGeometry(const SliceDataStorage& storage) const
+{
+    GeometryDump& geometry_dump = GeometryDump::getInstance();
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        for (LayerIndex layer_nr = 0; layer_nr < LayerIndex(mesh.layers.size()); layer_nr++)
+        {
+            const SliceLayer& layer = mesh.layers[layer_nr];
+            if (geometry_dump.isDumping("outlines", layer_nr))
+            {
+                Polygons outlines;
+                for (const SliceLayerPart& part : layer.parts)
+                {
+                    outlines.add(part.outline);
+                }
+                geometry_dump.dump("outlines", layer_nr, mesh.mesh_name, outlines);
+            }
+            if (geometry_dump.isDumping("walls", layer_nr))
+            {
+                std::vector<Polygons> walls;
+                for (const SliceLayerPart& part : layer.parts)
+                {
+                    walls.resize(std::max(walls.size(), part.insets.size()));
+                    for (size_t inset_idx = 0; inset_idx < part.insets.size(); inset_idx++)
+                    {
+                        walls[inset_idx].add(part.insets[inset_idx]);
+                    }
+                }
+                for (size_t inset_idx = 0; inset_idx < walls.size(); inset_idx++)
+                {
+                    geometry_dump.dump("walls", layer_nr, mesh.mesh_name + "/wall_" + std::to_string(inset_idx), walls[inset_idx]);
+                }
+            }
+            if (geometry_dump.isDumping("skin", layer_nr))
+            {
+                Polygons skin;
+                for (const SliceLayerPart& part : layer.parts)
+                {
+                    for (const SkinPart& skin_part : part.skin_parts)
+                    {
+                        skin.add(skin_part.outline);
+                    }
+                }
+                geometry_dump.dump("skin", layer_nr, mesh.mesh_name, skin);
+            }
+            if (geometry_dump.isDumping("infill", layer_nr))
+            {
+                Polygons infill;
+                for (const SliceLayerPart& part : layer.parts)
+                {
+                    infill.add(part.getOwnInfillArea());
+                }
+                geometry_dump.dump("infill", layer_nr, mesh.mesh_name, infill);
+            }
+        }
+    }
+    for (LayerIndex layer_nr = 0; layer_nr < LayerIndex(storage.support.supportLayers.size()); layer_nr++)
+    {
+        if (!geometry_dump.isDumping("support", layer_nr))
+        {
+            continue;
+        }
+        const SupportLayer& support_layer = storage.support.supportLayers[layer_nr];
+        Polygons support_infill;
+        for (const SupportInfillPart& part : support_layer.support_infill_parts)
+        {
+            support_infill.add(part.outline);
+        }
+        geometry_dump.dump("support", layer_nr, "infill", support_infill);
+        geometry_dump.dump("support", layer_nr, "roof", support_layer.support_roof);
+        geometry_dump.dump("support", layer_nr, "bottom", support_layer.support_bottom);
+    }
+}
+
 size_t FffPolygonGenerator::getDraftShieldLayerCount(const size_t total_layers) const
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
@@ -83,8 +180,28 @@ size_t FffPolygonGenerator::getDraftShieldLayerCount(const size_t total_layers)
     }
 }
 
+void FffPolygonGenerator::prefetchDensityImages(const MeshGroup& meshgroup) const
+{
+    for (const Mesh& mesh : meshgroup.meshes)
+    {
+        const EFillMethod infill_pattern = mesh.settings.get<EFillMethod>("infill_pattern");
+        if (mesh.settings.get<coord_t>("infill_line_distance") > 0 && (infill_pattern == EFillMethod::CROSS || infill_pattern == EFillMethod::CROSS_3D))
+        {
+            ImageBasedDensityProvider::prefetch(mesh.settings.get<std::string>("cross_infill_density_image"));
+        }
+    }
+    const ExtruderTrain& support_infill_extruder = meshgroup.settings.get<ExtruderTrain&>("support_infill_extruder_nr");
+    const EFillMethod support_pattern = support_infill_extruder.settings.get<EFillMethod>("support_pattern");
+    if (support_pattern == EFillMethod::CROSS || support_pattern == EFillMethod::CROSS_3D)
+    {
+        ImageBasedDensityProvider::prefetch(support_infill_extruder.settings.get<std::string>("cross_support_density_image"));
+    }
+}
+
 bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeeper, SliceDataStorage& storage) /// slices the model
 {
+    const ScopedTimer timer("slice");
+    const ScopedStageThreads stage_threads("slice");
     Progress::messageProgressStage(Progress::Stage::SLICING, &timeKeeper);
 
     storage.model_min = meshgroup->min();
@@ -141,32 +258,141 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
         return true; // This is NOT an error state!
     }
 
-    std::vector<Slicer*> slicerList;
-    for(unsigned int mesh_idx = 0; mesh_idx < meshgroup->meshes.size(); mesh_idx++)
+    // Check if adaptive layers is populated to prevent accessing a method on NULL
+    std::vector<AdaptiveLayer>* adaptive_layer_height_values = {};
+    if (adaptive_layer_heights != nullptr)
+    {
+        adaptive_layer_height_values = adaptive_layer_heights->getLayers();
+    }
+
+    // A long-running engine may have sliced the same meshes with the same settings before, or another engine may have left them on disk.
+    const bool keep_warm_state = Application::getInstance().keep_warm_state;
+    const Settings& scene_settings = Application::getInstance().current_slice->scene.settings;
+    const std::string slicing_cache_directory = scene_settings.has("slicing_cache_directory") ? scene_settings.get<std::string>("slicing_cache_directory") : "";
+    const bool use_slicer_cache = keep_warm_state || !slicing_cache_directory.empty();
+    if (use_slicer_cache)
     {
-        // Check if adaptive layers is populated to prevent accessing a method on NULL
-        std::vector<AdaptiveLayer>* adaptive_layer_height_values = {};
-        if (adaptive_layer_heights != nullptr)
+        const Scene& scene = Application::getInstance().current_slice->scene;
+        if (scene.current_mesh_group == scene.mesh_groups.begin())
         {
-            adaptive_layer_height_values = adaptive_layer_heights->getLayers();
+            slicer_cache.beginSlice(keep_warm_state, slicing_cache_directory);
+            inset_skin_cache.beginSlice();
+            SierpinskiFillProviderCache::getInstance().beginSlice();
         }
+        slicer_cache.beginMeshGroup(layer_thickness, slice_layer_count, adaptive_layer_height_values);
+    }
 
+    const std::function<Slicer* (size_t)> slice_mesh = [&](const size_t mesh_idx)
+    {
         Mesh& mesh = meshgroup->meshes[mesh_idx];
-        Slicer* slicer = new Slicer(&mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
-
-        slicerList.push_back(slicer);
+        if (use_slicer_cache)
+        {
+            return slicer_cache.slice(mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
+        }
+        return new Slicer(&mesh, layer_thickness, slice_layer_count, use_variable_layer_heights, adaptive_layer_height_values);
+    };
+
+    const size_t mesh_count = meshgroup->meshes.size();
+    findMeshCopies(*meshgroup);
+    std::vector<Slicer*> slicerList(mesh_count, nullptr);
+    std::vector<size_t> concurrent_mesh_indices; //The meshes that are sliced concurrently, one mesh per thread.
+    if (!use_slicer_cache) //The cache records the settings that are read, which only works while slicing one mesh at a time.
+    {
+        // Meshes that are big compared to the whole plate are sliced one at a time, each of them slicing its layers in parallel.
+        // The other meshes are too small to use all threads on their own, so they are sliced concurrently.
+        size_t thread_count = 1;
+#ifdef _OPENMP
+        thread_count = std::max(1, omp_get_max_threads());
+#endif // _OPENMP
+        size_t total_face_count = 0;
+        for (const Mesh& mesh : meshgroup->meshes)
+        {
+            total_face_count += mesh.faces.size();
+        }
+        for (size_t mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++)
+        {
+            if (thread_count > 1 && meshgroup->meshes[mesh_idx].faces.size() * thread_count < total_face_count && mesh_copy_of[mesh_idx] == mesh_idx)
+            {
+                concurrent_mesh_indices.push_back(mesh_idx);
+            }
+        }
+    }
+    std::atomic<size_t> sliced_mesh_count(0);
+    size_t next_concurrent_idx = 0;
+    for (size_t mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++)
+    {
+        if (next_concurrent_idx < concurrent_mesh_indices.size() && concurrent_mesh_indices[next_concurrent_idx] == mesh_idx)
+        {
+            next_concurrent_idx++;
+            continue;
+        }
+        if (mesh_copy_of[mesh_idx] != mesh_idx) //Copies get the layers of their original once that is sliced.
+        {
+            continue;
+        }
+        slicerList[mesh_idx] = slice_mesh(mesh_idx);
+        Progress::messageProgress(Progress::Stage::SLICING, ++sliced_mesh_count, mesh_count);
+    }
+#pragma omp parallel for shared(slicerList, concurrent_mesh_indices, sliced_mesh_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int concurrent_idx = 0; concurrent_idx < static_cast<int>(concurrent_mesh_indices.size()); concurrent_idx++)
+    {
+        const size_t mesh_idx = concurrent_mesh_indices[concurrent_idx];
+        slicerList[mesh_idx] = slice_mesh(mesh_idx);
+        const size_t sliced = ++sliced_mesh_count;
+        Progress::messageProgress(Progress::Stage::SLICING, sliced, mesh_count);
+    }
+    for (size_t mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++)
+    {
+        const size_t original_idx = mesh_copy_of[mesh_idx];
+        if (original_idx == mesh_idx)
+        {
+            continue;
+        }
+        const Point translation = mesh_copy_translation[mesh_idx];
+        const std::vector<SlicerLayer>& original_layers = slicerList[original_idx]->layers;
+        std::vector<SlicerLayer> layers(original_layers.size());
+        for (size_t layer_nr = 0; layer_nr < layers.size(); layer_nr++)
+        {
+            //The segments refer to the faces of the original, and aren't used after slicing anyway.
+            layers[layer_nr].z = original_layers[layer_nr].z;
+            layers[layer_nr].polygons = original_layers[layer_nr].polygons;
+            layers[layer_nr].polygons.translate(translation);
+            layers[layer_nr].openPolylines = original_layers[layer_nr].openPolylines;
+            layers[layer_nr].openPolylines.translate(translation);
+        }
+        slicerList[mesh_idx] = new Slicer(&meshgroup->meshes[mesh_idx], layers);
+        Progress::messageProgress(Progress::Stage::SLICING, ++sliced_mesh_count, mesh_count);
+    }
+    if (Application::getInstance().isSliceCancelled()) //Some layers may not have been sliced.
+    {
+        for (Slicer* slicer : slicerList)
+        {
+            delete slicer;
+        }
+        return false;
+    }
 
-        /*
-        for(SlicerLayer& layer : slicer->layers)
+    if (Instrumentation::getInstance().isEnabled())
+    {
+        for (const Slicer* slicer : slicerList)
         {
-            //Reporting the outline here slows down the engine quite a bit, so only do so when debugging.
-            sendPolygons("outline", layer_nr, layer.z, layer.polygonList);
-            sendPolygons("openoutline", layer_nr, layer.openPolygonList);
+            for (const SlicerLayer& layer : slicer->layers)
+            {
+                ScopedTimer::count("polygons", layer.polygons.size());
+                ScopedTimer::count("points", layer.polygons.pointCount());
+            }
         }
-        */
+    }
 
-        Progress::messageProgress(Progress::Stage::SLICING, mesh_idx + 1, meshgroup->meshes.size());
+    /*
+    for(SlicerLayer& layer : slicer->layers)
+    {
+        //Reporting the outline here slows down the engine quite a bit, so only do so when debugging.
+        sendPolygons("outline", layer_nr, layer.z, layer.polygonList);
+        sendPolygons("openoutline", layer_nr, layer.openPolygonList);
     }
+    */
 
     // Clear the mesh face and vertex data, it is no longer needed after this point, and it saves a lot of memory.
     meshgroup->clear();
@@ -273,7 +499,152 @@ bool FffPolygonGenerator::sliceModel(MeshGroup* meshgroup, TimeKeeper& timeKeepe
     return true;
 }
 
-void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper& time_keeper)
+void FffPolygonGenerator::findMeshCopies(const MeshGroup& mesh_group)
+{
+    const size_t mesh_count = mesh_group.meshes.size();
+    mesh_copy_of.resize(mesh_count);
+    mesh_copy_translation.assign(mesh_count, Point(0, 0));
+    const Settings& scene_settings = Application::getInstance().current_slice->scene.settings;
+    const bool deduplicate = scene_settings.has("deduplicate_mesh_copies") ? scene_settings.get<bool>("deduplicate_mesh_copies") : false; //Opt-in, since the copies may end up a micron or two from where they would be sliced.
+    constexpr coord_t copy_max_deviation = 2; //Rounding a moved vertex to microns may be off by one, and so may the position of the mesh.
+    std::unordered_multimap<size_t, size_t> originals_by_face_count; //Most meshes have a different number of faces, so only few need to be compared.
+    size_t copy_count = 0;
+    for (size_t mesh_idx = 0; mesh_idx < mesh_count; mesh_idx++)
+    {
+        mesh_copy_of[mesh_idx] = mesh_idx;
+        if (!deduplicate)
+        {
+            continue;
+        }
+        const Mesh& mesh = mesh_group.meshes[mesh_idx];
+        const std::pair<std::unordered_multimap<size_t, size_t>::iterator, std::unordered_multimap<size_t, size_t>::iterator> candidates = originals_by_face_count.equal_range(mesh.faces.size());
+        for (std::unordered_multimap<size_t, size_t>::iterator candidate = candidates.first; candidate != candidates.second; candidate++)
+        {
+            const Mesh& original = mesh_group.meshes[candidate->second];
+            if (mesh.isHorizontalCopyOf(original, copy_max_deviation))
+            {
+                mesh_copy_of[mesh_idx] = candidate->second;
+                const Point3 offset = mesh.min() - original.min();
+                mesh_copy_translation[mesh_idx] = Point(offset.x, offset.y);
+                copy_count++;
+                break;
+            }
+        }
+        if (mesh_copy_of[mesh_idx] == mesh_idx)
+        {
+            originals_by_face_count.emplace(mesh.faces.size(), mesh_idx);
+        }
+    }
+    if (copy_count > 0)
+    {
+        log("%zu of %zu meshes are copies of other meshes. Reusing their layers.\n", copy_count, mesh_count);
+    }
+}
+
+bool FffPolygonGenerator::copyWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_idx) const
+{
+    if (mesh_idx >= mesh_copy_of.size() || mesh_copy_of[mesh_idx] == mesh_idx)
+    {
+        return false;
+    }
+    for (const SliceMeshStorage& other_mesh : storage.meshes)
+    {
+        if (other_mesh.settings.get<bool>("infill_mesh"))
+        {
+            return false;
+        }
+    }
+    SliceMeshStorage& mesh = storage.meshes[mesh_idx];
+    const SliceMeshStorage& original = storage.meshes[mesh_copy_of[mesh_idx]];
+    const Point translation = mesh_copy_translation[mesh_idx];
+    if (mesh.layers.size() != original.layers.size() || mesh.layer_nr_max_filled_layer != original.layer_nr_max_filled_layer)
+    {
+        return false;
+    }
+    for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        const std::vector<SliceLayerPart>& parts = mesh.layers[layer_nr].parts;
+        const std::vector<SliceLayerPart>& original_parts = original.layers[layer_nr].parts;
+        if (parts.size() != original_parts.size())
+        {
+            return false;
+        }
+        for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+        {
+            const PolygonsPart& outline = parts[part_idx].outline;
+            const PolygonsPart& original_outline = original_parts[part_idx].outline;
+            if (outline.size() != original_outline.size() || parts[part_idx].is_enclosed != original_parts[part_idx].is_enclosed)
+            {
+                return false;
+            }
+            for (size_t poly_idx = 0; poly_idx < outline.size(); poly_idx++)
+            {
+                ConstPolygonRef polygon = outline[poly_idx];
+                ConstPolygonRef original_polygon = original_outline[poly_idx];
+                if (polygon.size() != original_polygon.size())
+                {
+                    return false;
+                }
+                for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+                {
+                    if (polygon[point_idx] != original_polygon[point_idx] + translation)
+                    {
+                        return false; //Carved differently, for instance by a neighbour that overlaps it.
+                    }
+                }
+            }
+        }
+    }
+
+    logDebug("Copying the walls, skin and infill of mesh %i to mesh %i.\n", static_cast<int>(mesh_copy_of[mesh_idx]), static_cast<int>(mesh_idx));
+#pragma omp parallel for schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(mesh.layers.size()); layer_nr++)
+    {
+        SliceLayer& layer = mesh.layers[layer_nr];
+        layer.parts = original.layers[layer_nr].parts;
+        for (SliceLayerPart& part : layer.parts)
+        {
+            part.translate(translation);
+        }
+        layer.indexParts();
+        layer.top_surface.areas = original.layers[layer_nr].top_surface.areas;
+        layer.top_surface.areas.translate(translation);
+    }
+    return true;
+}
+
+/*!
+ * \brief The state that the tasks computing the walls, skin and infill of one
+ * mesh share, while they are scheduled.
+ */
+struct FffPolygonGenerator::WallsSkinInfillTasks
+{
+    // TODO: make progress more accurate!!
+    // note: estimated time for     insets : skins = 22.953 : 48.858
+    static constexpr size_t inset_progress_weight = 23;
+    static constexpr size_t skin_progress_weight = 49;
+    static constexpr size_t layer_progress_weight = inset_progress_weight + skin_progress_weight;
+
+    WallsSkinInfillTasks(const size_t mesh_idx, const size_t layer_count)
+    : mesh_idx(mesh_idx)
+    , unfinished_wall_counts(layer_count)
+    , unfinished_part_counts(layer_count)
+    , mesh_hash(0)
+    {
+    }
+
+    size_t mesh_idx; //!< The mesh of which the walls, skin and infill are computed.
+    std::vector<std::atomic<size_t>> unfinished_wall_counts; //!< For each layer, the number of layers which the skin depends on of which the walls aren't done yet.
+    std::vector<std::atomic<size_t>> unfinished_part_counts; //!< For each layer, the number of parts of which the walls aren't done yet.
+    std::vector<std::vector<size_t>> repeated_above; //!< See \ref FffPolygonGenerator::findPartsRepeatedAbove.
+    std::function<void (size_t)> process_skin; //!< Computes the skin and infill of a layer.
+    std::function<void (size_t)> finish_insets; //!< Finishes a layer once the walls of all its parts are done.
+    uint64_t mesh_hash; //!< The hash of the mesh for the cache of a long-running engine.
+    std::unique_ptr<SettingsRecorder> settings_recorder; //!< Records the settings for the cache of a long-running engine, if it is kept.
+};
+
+bool FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper& time_keeper)
 {
     // compute layer count and remove first empty layers
     // there is no separate progress stage for removeEmptyFisrtLayer (TODO)
@@ -286,14 +657,6 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
         }
     }
 
-    // handle meshes
-    std::vector<double> mesh_timings;
-    for (unsigned int mesh_idx = 0; mesh_idx < storage.meshes.size(); mesh_idx++)
-    {
-        mesh_timings.push_back(1.0); // TODO: have a more accurate estimate of the relative time it takes per mesh, based on the height and number of polygons
-    }
-    ProgressStageEstimator inset_skin_progress_estimate(mesh_timings);
-
     Progress::messageProgressStage(Progress::Stage::INSET_SKIN, &time_keeper);
     std::vector<size_t> mesh_order;
     { // compute mesh order
@@ -307,11 +670,58 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
             mesh_order.push_back(order_and_mesh_idx.second);
         }
     }
-    for (size_t mesh_order_idx = 0; mesh_order_idx < mesh_order.size(); ++mesh_order_idx)
+
+    // The tasks of several meshes run on the same threads, so that the threads don't go idle while the last layers of one mesh finish.
+    // Infill meshes change the meshes processed before them, and the cache of a long-running engine records the settings read for one mesh at a time,
+    // so then each mesh has to be done before the next starts. A copy of another mesh needs that mesh to be done.
+    bool has_infill_mesh = false;
+    size_t total_progress_weight = 0;
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        has_infill_mesh |= mesh.settings.get<bool>("infill_mesh");
+        total_progress_weight += mesh.layers.size() * WallsSkinInfillTasks::layer_progress_weight;
+    }
+    const bool meshes_together = !has_infill_mesh && !Application::getInstance().keep_warm_state;
+    std::atomic<size_t> processed_progress_weight(0);
+    const std::function<void (size_t)> report_progress = [&processed_progress_weight, total_progress_weight](const size_t progress_weight)
+    {
+        const size_t processed = processed_progress_weight += progress_weight;
+        Progress::messageProgress(Progress::Stage::INSET_SKIN, processed, std::max(total_progress_weight, size_t(1)));
+    };
+    for (size_t first_mesh_order_idx = 0; first_mesh_order_idx < mesh_order.size(); )
     {
-        processBasicWallsSkinInfill(storage, mesh_order_idx, mesh_order, inset_skin_progress_estimate);
-        Progress::messageProgress(Progress::Stage::INSET_SKIN, mesh_order_idx + 1, storage.meshes.size());
+        const ScopedTimer timer("walls_skin_infill");
+        const ScopedStageThreads stage_threads("walls_skin_infill");
+        TaskScheduler scheduler;
+        std::vector<std::unique_ptr<WallsSkinInfillTasks>> running;
+        std::vector<bool> is_running(storage.meshes.size(), false);
+        size_t mesh_order_idx = first_mesh_order_idx;
+        for (; mesh_order_idx < mesh_order.size(); mesh_order_idx++)
+        {
+            const size_t mesh_idx = mesh_order[mesh_order_idx];
+            if (mesh_order_idx > first_mesh_order_idx && (!meshes_together || is_running[mesh_copy_of[mesh_idx]]))
+            {
+                break;
+            }
+            is_running[mesh_idx] = true;
+            std::unique_ptr<WallsSkinInfillTasks> tasks = processBasicWallsSkinInfill(storage, mesh_order_idx, mesh_order, scheduler, report_progress);
+            if (tasks)
+            {
+                running.push_back(std::move(tasks));
+            }
+        }
+        scheduler.run();
+        for (std::unique_ptr<WallsSkinInfillTasks>& tasks : running)
+        {
+            finishBasicWallsSkinInfill(storage, *tasks);
+        }
+        first_mesh_order_idx = mesh_order_idx;
+        if (Application::getInstance().isSliceCancelled())
+        {
+            return false;
+        }
     }
+    storage.measureMemory("memory_after_walls_skin_infill");
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     if (isEmptyLayer(storage, 0) && !isEmptyLayer(storage, 1))
@@ -328,13 +738,24 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
 
     Progress::messageProgressStage(Progress::Stage::SUPPORT, &time_keeper);
 
-    AreaSupport::generateOverhangAreas(storage);
-    AreaSupport::generateSupportAreas(storage);
-    TreeSupport tree_support_generator(storage);
-    tree_support_generator.generateSupportAreas(storage);
+    {
+        const ScopedTimer timer("support");
+        const ScopedStageThreads stage_threads("support");
+        AreaSupport::generateOverhangAreas(storage);
+        AreaSupport::generateSupportAreas(storage);
+        storage.invalidateLayerOutlines(); //The layer outlines now include the support.
+        TreeSupport tree_support_generator(storage);
+        tree_support_generator.generateSupportAreas(storage);
+        storage.measureMemory("memory_after_support"); //While the volumes of the tree support are still cached.
+        storage.invalidateLayerOutlines();
+    }
+    if (Application::getInstance().isSliceCancelled())
+    {
+        return false;
+    }
 
     // we need to remove empty layers after we have processed the insets
-    // processInsets might throw away parts if they have no wall at all (cause it doesn't fit)
+    // removePartsWithoutInsets throws away parts if they have no wall at all (cause it doesn't fit)
     // brim depends on the first layer not being empty
     // only remove empty layers if we haven't generate support, because then support was added underneath the model.
     //   for some materials it's better to print on support than on the build plate.
@@ -345,7 +766,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     if (storage.print_layer_count == 0)
     {
         log("Stopping process because there are no non-empty layers.\n");
-        return;
+        return true;
     }
 
     computePrintHeightStatistics(storage);
@@ -354,6 +775,7 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     storage.primeTower.generateGroundpoly();
     storage.primeTower.generatePaths(storage);
     storage.primeTower.subtractFromSupport(storage);
+    storage.invalidateLayerOutlines(); //The layer outlines now include the prime tower.
 
     logDebug("Processing ooze shield\n");
     processOozeShield(storage);
@@ -367,11 +789,11 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
     {
         log("Processing platform adhesion\n");
         processPlatformAdhesion(storage);
+        storage.invalidateLayerOutlines(); //The outlines below the model now include the raft.
     }
 
     logDebug("Processing gaps\n");
-    processOutlineGaps(storage);
-    processPerimeterGaps(storage);
+    processGaps(storage);
 
     logDebug("Meshes post-processing\n");
     // meshes post processing
@@ -380,12 +802,26 @@ void FffPolygonGenerator::slices2polygons(SliceDataStorage& storage, TimeKeeper&
         processDerivedWallsSkinInfill(mesh);
     }
 
+    logDebug("Generating infill lines\n");
+    processInfillLines(storage);
+    if (Application::getInstance().isSliceCancelled())
+    {
+        return false;
+    }
+
+    logDebug("Computing wall overlaps\n");
+    processWallOverlaps(storage);
+
     logDebug("Processing gradual support\n");
     // generate gradual support
     AreaSupport::generateSupportInfillFeatures(storage);
+    storage.invalidateLayerOutlines(); //Don't keep outlines of intermediate stages around while writing g-code.
+
+    storage.computeExtrudersUsedPerLayer();
+    return true;
 }
 
-void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate)
+std::unique_ptr<FffPolygonGenerator::WallsSkinInfillTasks> FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, TaskScheduler& scheduler, const std::function<void (size_t)>& report_progress)
 {
     size_t mesh_idx = mesh_order[mesh_order_idx];
     SliceMeshStorage& mesh = storage.meshes[mesh_idx];
@@ -395,46 +831,6 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
         processInfillMesh(storage, mesh_order_idx, mesh_order);
     }
 
-    // TODO: make progress more accurate!!
-    // note: estimated time for     insets : skins = 22.953 : 48.858
-    std::vector<double> walls_vs_skin_timing({22.953, 48.858});
-    ProgressStageEstimator* mesh_inset_skin_progress_estimator = new ProgressStageEstimator(walls_vs_skin_timing);
-
-    inset_skin_progress_estimate.nextStage(mesh_inset_skin_progress_estimator); // the stage of this function call
-
-    ProgressEstimatorLinear* inset_estimator = new ProgressEstimatorLinear(mesh_layer_count);
-    mesh_inset_skin_progress_estimator->nextStage(inset_estimator);
-
-
-    // walls
-    size_t processed_layer_count = 0;
-#pragma omp parallel for default(none) shared(mesh_layer_count, storage, mesh, inset_skin_progress_estimate, processed_layer_count) schedule(dynamic)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_number = 0; layer_number < static_cast<int>(mesh.layers.size()); layer_number++)
-    {
-        logDebug("Processing insets for layer %i of %i\n", layer_number, mesh_layer_count);
-        processInsets(mesh, layer_number);
-#ifdef _OPENMP
-        if (omp_get_thread_num() == 0)
-#endif
-        { // progress estimation is done only in one thread so that no two threads message progress at the same time
-            int _processed_layer_count;
-#if _OPENMP < 201107
-#pragma omp critical
-#else
-#pragma omp atomic read
-#endif
-                _processed_layer_count = processed_layer_count;
-            double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
-            Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
-        }
-#pragma omp atomic
-        processed_layer_count++;
-    }
-
-    ProgressEstimatorLinear* skin_estimator = new ProgressEstimatorLinear(mesh_layer_count);
-    mesh_inset_skin_progress_estimator->nextStage(skin_estimator);
-
     bool process_infill = mesh.settings.get<coord_t>("infill_line_distance") > 0;
     if (!process_infill)
     { // do process infill anyway if it's modified by modifier meshes
@@ -454,176 +850,274 @@ void FffPolygonGenerator::processBasicWallsSkinInfill(SliceDataStorage& storage,
             }
         }
     }
-    // skin & infill
+
+    // Copies of a part elsewhere on the plate get the same walls, skin and infill.
+    if (copyWallsSkinInfill(storage, mesh_idx))
+    {
+        report_progress(mesh_layer_count * WallsSkinInfillTasks::layer_progress_weight);
+        return nullptr;
+    }
+
+    std::unique_ptr<WallsSkinInfillTasks> tasks(new WallsSkinInfillTasks(mesh_idx, mesh_layer_count));
+
+    // A long-running engine may have computed the walls, skin and infill of the same layer parts with the same settings before.
+    if (Application::getInstance().keep_warm_state)
+    {
+        tasks->mesh_hash = InsetSkinCache::hash(mesh, process_infill);
+        if (inset_skin_cache.restore(tasks->mesh_hash, mesh))
+        {
+            report_progress(mesh_layer_count * WallsSkinInfillTasks::layer_progress_weight);
+            return nullptr;
+        }
+        tasks->settings_recorder.reset(new SettingsRecorder());
+    }
 
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const bool magic_spiralize = mesh_group_settings.get<bool>("magic_spiralize");
     size_t mesh_max_bottom_layer_count = 0;
-    if (mesh_group_settings.get<bool>("magic_spiralize"))
+    if (magic_spiralize)
     {
         mesh_max_bottom_layer_count = std::max(mesh_max_bottom_layer_count, mesh.settings.get<size_t>("bottom_layers"));
     }
 
-    processed_layer_count = 0;
-#pragma omp parallel default(none) shared(mesh_layer_count, mesh, mesh_max_bottom_layer_count, process_infill, inset_skin_progress_estimate, processed_layer_count, mesh_group_settings)
+    // The skin of a layer is computed from the walls of the layers within its top and bottom layers (and roofing layers),
+    // and the top surface for ironing from the layer directly above. Instead of computing all walls before all skins,
+    // the skin of a layer is computed as soon as the walls it depends on are done.
+    const size_t roofing_layer_count = mesh.settings.get<size_t>("roofing_layer_count");
+    const size_t layers_below = std::max(mesh.settings.get<size_t>("bottom_layers"), static_cast<size_t>(roofing_layer_count > 0 ? 1 : 0));
+    const size_t layers_above = std::max({mesh.settings.get<size_t>("top_layers"), roofing_layer_count, static_cast<size_t>(mesh.settings.get<bool>("ironing_enabled") ? 1 : 0)});
+    for (size_t layer_nr = 0; layer_nr < mesh_layer_count; layer_nr++)
+    {
+        const size_t first_layer_nr = layer_nr - std::min(layer_nr, layers_below);
+        const size_t last_layer_nr = std::min(layer_nr + layers_above, mesh_layer_count - 1);
+        tasks->unfinished_wall_counts[layer_nr] = last_layer_nr - first_layer_nr + 1;
+    }
+
+    mesh.skin_wall_cache = std::make_shared<SkinWallCache>(mesh_layer_count);
+    WallsSkinInfillTasks* state = tasks.get(); // the tasks refer to the state, which lives until the scheduler is done
+    tasks->process_skin = [this, &mesh, report_progress, magic_spiralize, mesh_max_bottom_layer_count, process_infill, mesh_layer_count](const size_t layer_nr)
+    {
+        const ScopedTimer timer("skin_infill", layer_nr);
+        logDebug("Processing skins and infill layer %i of %i\n", static_cast<int>(layer_nr), static_cast<int>(mesh_layer_count));
+        if ((!magic_spiralize || layer_nr < mesh_max_bottom_layer_count) //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
+            && !Application::getInstance().isSliceCancelled())
+        {
+            processSkinsAndInfill(mesh, layer_nr, process_infill);
+        }
+        report_progress(WallsSkinInfillTasks::skin_progress_weight);
+    };
+    tasks->finish_insets = [this, &mesh, &scheduler, state, report_progress, layers_below, layers_above, mesh_layer_count](const size_t layer_nr)
     {
+        removePartsWithoutInsets(mesh, layer_nr);
+        report_progress(WallsSkinInfillTasks::inset_progress_weight);
 
-#pragma omp for schedule(dynamic)
-        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-        for (int layer_number = 0; layer_number < static_cast<int>(mesh.layers.size()); layer_number++)
+        // the skins of the layers which depend on the walls of this layer
+        const size_t first_skin_layer_nr = layer_nr - std::min(layer_nr, layers_above);
+        const size_t last_skin_layer_nr = std::min(layer_nr + layers_below, mesh_layer_count - 1);
+        for (size_t skin_layer_nr = first_skin_layer_nr; skin_layer_nr <= last_skin_layer_nr; skin_layer_nr++)
         {
-            logDebug("Processing skins and infill layer %i of %i\n", layer_number, mesh_layer_count);
-            if (!mesh_group_settings.get<bool>("magic_spiralize") || layer_number < static_cast<int>(mesh_max_bottom_layer_count))    //Only generate up/downskin and infill for the first X layers when spiralize is choosen.
+            if (--state->unfinished_wall_counts[skin_layer_nr] == 0)
             {
-                processSkinsAndInfill(mesh, layer_number, process_infill);
+                scheduler.schedule([state, skin_layer_nr]() { state->process_skin(skin_layer_nr); });
             }
-#ifdef _OPENMP
-            if (omp_get_thread_num() == 0)
-#endif
-            { // progress estimation is done only in one thread so that no two threads message progress at the same time
-                int _processed_layer_count;
-#if _OPENMP < 201107
-#pragma omp critical
-#else
-#pragma omp atomic read
-#endif
-                    _processed_layer_count = processed_layer_count;
-                double progress = inset_skin_progress_estimate.progress(_processed_layer_count);
-                Progress::messageProgress(Progress::Stage::INSET_SKIN, progress * 100, 100);
-            }
-#pragma omp atomic
-                processed_layer_count++;
         }
-    }
-}
-
-void FffPolygonGenerator::processOutlineGaps(SliceDataStorage& storage)
-{
-    for (SliceMeshStorage& mesh : storage.meshes)
+    };
+    // Layers with many small parts, like on a plate full of small models, would take much longer than the other layers,
+    // so the walls of every part are a task of their own. The last part of a layer to finish takes care of the layer.
+    // A part with the same outline as the part below it gets a copy of those walls instead, from the task of the lowest part with that outline.
+    tasks->repeated_above = findPartsRepeatedAbove(mesh);
+    for (size_t layer_nr = 0; layer_nr < mesh_layer_count; layer_nr++)
     {
-        constexpr int perimeter_gaps_extra_offset = 15; // extra offset so that the perimeter gaps aren't created everywhere due to rounding errors
-        const coord_t wall_0_inset = mesh.settings.get<coord_t>("wall_0_inset");
-        if (!mesh.settings.get<bool>("fill_outline_gaps") || mesh.settings.get<size_t>("wall_line_count") <= 0)
+        const size_t part_count = mesh.layers[layer_nr].parts.size();
+        if (part_count == 0)
         {
+            scheduler.schedule([state, layer_nr]() { state->finish_insets(layer_nr); });
             continue;
         }
-        for (unsigned int layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        tasks->unfinished_part_counts[layer_nr] = part_count;
+        for (size_t part_idx = 0; part_idx < part_count; part_idx++)
         {
-            SliceLayer& layer = mesh.layers[layer_nr];
-            coord_t wall_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
-            if (layer_nr == 0)
+            if (layer_nr > 0 && std::find(tasks->repeated_above[layer_nr - 1].begin(), tasks->repeated_above[layer_nr - 1].end(), part_idx) != tasks->repeated_above[layer_nr - 1].end())
             {
-                const ExtruderTrain& train = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
-                Ratio initial_layer_line_width_factor = train.settings.get<Ratio>("initial_layer_line_width_factor");
-                wall_line_width_0 *= initial_layer_line_width_factor;
+                continue; // gets the walls of the part below it
             }
-            for (SliceLayerPart& part : layer.parts)
+            scheduler.schedule([this, &mesh, state, layer_nr, part_idx, mesh_layer_count]()
             {
-                // handle outline gaps
-                if (mesh.settings.get<bool>("fill_outline_gaps"))
+                const ScopedTimer timer("walls", layer_nr);
+                logDebug("Processing insets for part %i of layer %i of %i\n", static_cast<int>(part_idx), static_cast<int>(layer_nr), static_cast<int>(mesh_layer_count));
+                if (!Application::getInstance().isSliceCancelled()) //The skins of the layers still get their turn, so they find the slice cancelled too.
+                {
+                    processInsets(mesh, layer_nr, mesh.layers[layer_nr].parts[part_idx]);
+                }
+                // This layer can't finish before the copies are made, since finishing it may remove parts.
+                const SliceLayerPart& part = mesh.layers[layer_nr].parts[part_idx];
+                size_t repeat_layer_nr = layer_nr;
+                size_t repeat_part_idx = state->repeated_above[layer_nr][part_idx];
+                while (repeat_part_idx != NO_INDEX)
                 {
-                    const Polygons& outer = part.outline;
-                    Polygons inner;
-                    if (part.insets.size() > 0)
+                    repeat_layer_nr++;
+                    SliceLayerPart& repeat = mesh.layers[repeat_layer_nr].parts[repeat_part_idx];
+                    repeat.insets = part.insets;
+                    repeat.print_outline = part.print_outline;
+                    repeat_part_idx = state->repeated_above[repeat_layer_nr][repeat_part_idx];
+                    if (--state->unfinished_part_counts[repeat_layer_nr] == 0)
                     {
-                        inner.add(part.insets[0].offset(wall_line_width_0 / 2 + perimeter_gaps_extra_offset + wall_0_inset));
+                        state->finish_insets(repeat_layer_nr);
                     }
-                    Polygons outline_gaps = outer.difference(inner);
-                    outline_gaps.removeSmallAreas(2 * INT2MM(wall_line_width_0) * INT2MM(wall_line_width_0)); // remove small outline gaps to reduce blobs on outside of model
-                    part.outline_gaps.add(outline_gaps);
                 }
-            }
+                if (--state->unfinished_part_counts[layer_nr] == 0)
+                {
+                    state->finish_insets(layer_nr);
+                }
+            });
         }
     }
+    return tasks;
 }
 
-void FffPolygonGenerator::processPerimeterGaps(SliceDataStorage& storage)
+void FffPolygonGenerator::finishBasicWallsSkinInfill(SliceDataStorage& storage, WallsSkinInfillTasks& tasks)
 {
-    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    SliceMeshStorage& mesh = storage.meshes[tasks.mesh_idx];
+    mesh.skin_wall_cache.reset(); // the walls aren't looked at anymore
+
+    if (tasks.settings_recorder && !Application::getInstance().isSliceCancelled()) //A cancelled slice may have skipped layers.
+    {
+        inset_skin_cache.store(tasks.mesh_hash, mesh, *tasks.settings_recorder);
+    }
+    tasks.settings_recorder.reset();
+}
+
+void FffPolygonGenerator::processGaps(SliceDataStorage& storage)
+{
+    TIME_FUNCTION();
+    TaskScheduler scheduler;
     for (SliceMeshStorage& mesh : storage.meshes)
     {
-        constexpr int perimeter_gaps_extra_offset = 15; // extra offset so that the perimeter gaps aren't created everywhere due to rounding errors
-        const bool fill_perimeter_gaps = mesh.settings.get<FillPerimeterGapMode>("fill_perimeter_gaps") != FillPerimeterGapMode::NOWHERE
-            && !mesh_group_settings.get<bool>("magic_spiralize");
-        bool filter_out_tiny_gaps = mesh.settings.get<bool>("filter_out_tiny_gaps");
+        for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(mesh.layers.size()); layer_nr++)
+        {
+            scheduler.schedule([this, &mesh, layer_nr]()
+            {
+                processOutlineGaps(mesh, layer_nr);
+                processPerimeterGaps(mesh, layer_nr);
+            });
+        }
+    }
+    scheduler.run();
+}
+
+void FffPolygonGenerator::processOutlineGaps(SliceMeshStorage& mesh, const LayerIndex layer_nr)
+{
+    constexpr int perimeter_gaps_extra_offset = 15; // extra offset so that the perimeter gaps aren't created everywhere due to rounding errors
+    const coord_t wall_0_inset = mesh.settings.get<coord_t>("wall_0_inset");
+    if (!mesh.settings.get<bool>("fill_outline_gaps") || mesh.settings.get<size_t>("wall_line_count") <= 0)
+    {
+        return;
+    }
+    SliceLayer& layer = mesh.layers[layer_nr];
+    coord_t wall_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
+    if (layer_nr == 0)
+    {
+        const ExtruderTrain& train = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
+        Ratio initial_layer_line_width_factor = train.settings.get<Ratio>("initial_layer_line_width_factor");
+        wall_line_width_0 *= initial_layer_line_width_factor;
+    }
+    for (SliceLayerPart& part : layer.parts)
+    {
+        // handle outline gaps
+        const Polygons& outer = part.outline;
+        Polygons inner;
+        if (part.insets.size() > 0)
+        {
+            inner.add(part.insets[0].offset(wall_line_width_0 / 2 + perimeter_gaps_extra_offset + wall_0_inset));
+        }
+        Polygons outline_gaps = outer.difference(inner);
+        outline_gaps.removeSmallAreas(2 * INT2MM(wall_line_width_0) * INT2MM(wall_line_width_0)); // remove small outline gaps to reduce blobs on outside of model
+        part.outline_gaps.add(outline_gaps);
+    }
+}
+
+void FffPolygonGenerator::processPerimeterGaps(SliceMeshStorage& mesh, const LayerIndex layer_nr)
+{
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    constexpr int perimeter_gaps_extra_offset = 15; // extra offset so that the perimeter gaps aren't created everywhere due to rounding errors
+    const bool fill_perimeter_gaps = mesh.settings.get<FillPerimeterGapMode>("fill_perimeter_gaps") != FillPerimeterGapMode::NOWHERE
+        && !mesh_group_settings.get<bool>("magic_spiralize");
+    bool filter_out_tiny_gaps = mesh.settings.get<bool>("filter_out_tiny_gaps");
 
-        if (!fill_perimeter_gaps)
+    if (!fill_perimeter_gaps)
+    {
+        return;
+    }
+    const ExtruderTrain& train_wall_x = mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr");
+    bool fill_gaps_between_inner_wall_and_skin_or_infill =
+        mesh.settings.get<coord_t>("infill_line_distance") > 0
+        && mesh.settings.get<coord_t>("infill_overlap_mm") >= 0
+        && !(mesh.settings.get<EFillMethod>("infill_pattern") == EFillMethod::CONCENTRIC
+            && (mesh.settings.get<bool>("alternate_extra_perimeter") || (layer_nr == 0 && train_wall_x.settings.get<Ratio>("initial_layer_line_width_factor") > 1.0))
+        );
+    SliceLayer& layer = mesh.layers[layer_nr];
+    coord_t wall_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
+    coord_t wall_line_width_x = mesh.settings.get<coord_t>("wall_line_width_x");
+    coord_t skin_line_width = mesh.settings.get<coord_t>("skin_line_width");
+    if (layer_nr == 0)
+    {
+        const ExtruderTrain& train_wall_0 = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
+        wall_line_width_0 *= train_wall_0.settings.get<Ratio>("initial_layer_line_width_factor");
+        const ExtruderTrain& train_wall_x = mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr");
+        wall_line_width_x *= train_wall_x.settings.get<Ratio>("initial_layer_line_width_factor");
+        const ExtruderTrain& train_skin = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr");
+        skin_line_width *= train_skin.settings.get<Ratio>("initial_layer_line_width_factor");
+    }
+    for (SliceLayerPart& part : layer.parts)
+    {
+         // handle perimeter gaps of normal insets
+        int line_width = wall_line_width_0;
+        for (unsigned int inset_idx = 0; static_cast<int>(inset_idx) < static_cast<int>(part.insets.size()) - 1; inset_idx++)
         {
-            continue;
+            const Polygons outer = part.insets[inset_idx].offset(-1 * line_width / 2 - perimeter_gaps_extra_offset);
+            line_width = wall_line_width_x;
+
+            Polygons inner = part.insets[inset_idx + 1].offset(line_width / 2);
+            part.perimeter_gaps.add(outer.difference(inner));
         }
-        for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(mesh.layers.size()); layer_nr++)
+
+        if (filter_out_tiny_gaps) {
+            part.perimeter_gaps.removeSmallAreas(2 * INT2MM(wall_line_width_0) * INT2MM(wall_line_width_0)); // remove small outline gaps to reduce blobs on outside of model
+        }
+
+        // gap between inner wall and skin/infill
+        if (fill_gaps_between_inner_wall_and_skin_or_infill && part.insets.size() > 0)
         {
-            const ExtruderTrain& train_wall_x = mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr");
-            bool fill_gaps_between_inner_wall_and_skin_or_infill =
-                mesh.settings.get<coord_t>("infill_line_distance") > 0
-                && mesh.settings.get<coord_t>("infill_overlap_mm") >= 0
-                && !(mesh.settings.get<EFillMethod>("infill_pattern") == EFillMethod::CONCENTRIC
-                    && (mesh.settings.get<bool>("alternate_extra_perimeter") || (layer_nr == 0 && train_wall_x.settings.get<Ratio>("initial_layer_line_width_factor") > 1.0))
-                );
-            SliceLayer& layer = mesh.layers[layer_nr];
-            coord_t wall_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
-            coord_t wall_line_width_x = mesh.settings.get<coord_t>("wall_line_width_x");
-            coord_t skin_line_width = mesh.settings.get<coord_t>("skin_line_width");
-            if (layer_nr == 0)
+            const Polygons outer = part.insets.back().offset(-1 * line_width / 2 - perimeter_gaps_extra_offset);
+
+            Polygons inner = part.infill_area;
+            for (const SkinPart& skin_part : part.skin_parts)
             {
-                const ExtruderTrain& train_wall_0 = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
-                wall_line_width_0 *= train_wall_0.settings.get<Ratio>("initial_layer_line_width_factor");
-                const ExtruderTrain& train_wall_x = mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr");
-                wall_line_width_x *= train_wall_x.settings.get<Ratio>("initial_layer_line_width_factor");
-                const ExtruderTrain& train_skin = mesh.settings.get<ExtruderTrain&>("top_bottom_extruder_nr");
-                skin_line_width *= train_skin.settings.get<Ratio>("initial_layer_line_width_factor");
+                inner.add(skin_part.outline);
             }
-            for (SliceLayerPart& part : layer.parts)
-            {
-                 // handle perimeter gaps of normal insets
-                int line_width = wall_line_width_0;
-                for (unsigned int inset_idx = 0; static_cast<int>(inset_idx) < static_cast<int>(part.insets.size()) - 1; inset_idx++)
-                {
-                    const Polygons outer = part.insets[inset_idx].offset(-1 * line_width / 2 - perimeter_gaps_extra_offset);
-                    line_width = wall_line_width_x;
+            inner.unionInPlace();
+            part.perimeter_gaps.add(outer.difference(inner));
+        }
 
-                    Polygons inner = part.insets[inset_idx + 1].offset(line_width / 2);
-                    part.perimeter_gaps.add(outer.difference(inner));
+        // add perimeter gaps for skin insets
+        for (SkinPart& skin_part : part.skin_parts)
+        {
+            if (skin_part.insets.size() > 0)
+            {
+                // add perimeter gaps between the outer skin inset and the innermost wall
+                const Polygons outer = skin_part.outline;
+                const Polygons inner = skin_part.insets[0].offset(skin_line_width / 2 + perimeter_gaps_extra_offset);
+                skin_part.perimeter_gaps.add(outer.difference(inner));
+
+                for (unsigned int inset_idx = 1; inset_idx < skin_part.insets.size(); inset_idx++)
+                { // add perimeter gaps between consecutive skin walls
+                    const Polygons outer = skin_part.insets[inset_idx - 1].offset(-1 * skin_line_width / 2 - perimeter_gaps_extra_offset);
+                    const Polygons inner = skin_part.insets[inset_idx].offset(skin_line_width / 2);
+                    skin_part.perimeter_gaps.add(outer.difference(inner));
                 }
 
                 if (filter_out_tiny_gaps) {
-                    part.perimeter_gaps.removeSmallAreas(2 * INT2MM(wall_line_width_0) * INT2MM(wall_line_width_0)); // remove small outline gaps to reduce blobs on outside of model
-                }
-
-                // gap between inner wall and skin/infill
-                if (fill_gaps_between_inner_wall_and_skin_or_infill && part.insets.size() > 0)
-                {
-                    const Polygons outer = part.insets.back().offset(-1 * line_width / 2 - perimeter_gaps_extra_offset);
-
-                    Polygons inner = part.infill_area;
-                    for (const SkinPart& skin_part : part.skin_parts)
-                    {
-                        inner.add(skin_part.outline);
-                    }
-                    inner = inner.unionPolygons();
-                    part.perimeter_gaps.add(outer.difference(inner));
-                }
-
-                // add perimeter gaps for skin insets
-                for (SkinPart& skin_part : part.skin_parts)
-                {
-                    if (skin_part.insets.size() > 0)
-                    {
-                        // add perimeter gaps between the outer skin inset and the innermost wall
-                        const Polygons outer = skin_part.outline;
-                        const Polygons inner = skin_part.insets[0].offset(skin_line_width / 2 + perimeter_gaps_extra_offset);
-                        skin_part.perimeter_gaps.add(outer.difference(inner));
-
-                        for (unsigned int inset_idx = 1; inset_idx < skin_part.insets.size(); inset_idx++)
-                        { // add perimeter gaps between consecutive skin walls
-                            const Polygons outer = skin_part.insets[inset_idx - 1].offset(-1 * skin_line_width / 2 - perimeter_gaps_extra_offset);
-                            const Polygons inner = skin_part.insets[inset_idx].offset(skin_line_width / 2);
-                            skin_part.perimeter_gaps.add(outer.difference(inner));
-                        }
-
-                        if (filter_out_tiny_gaps) {
-                            skin_part.perimeter_gaps.removeSmallAreas(2 * INT2MM(skin_line_width) * INT2MM(skin_line_width)); // remove small outline gaps to reduce blobs on outside of model
-                        }
-                    }
+                    skin_part.perimeter_gaps.removeSmallAreas(2 * INT2MM(skin_line_width) * INT2MM(skin_line_width)); // remove small outline gaps to reduce blobs on outside of model
                 }
             }
         }
@@ -634,10 +1128,16 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
 {
     size_t mesh_idx = mesh_order[mesh_order_idx];
     SliceMeshStorage& mesh = storage.meshes[mesh_idx];
-    mesh.layer_nr_max_filled_layer = -1;
-    for (LayerIndex layer_idx = 0; layer_idx < static_cast<LayerIndex>(mesh.layers.size()); layer_idx++)
+    //Each layer only changes the parts of this mesh and of the other meshes on the same layer, so the layers are independent.
+#pragma omp parallel for schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(mesh.layers.size()); layer_idx++)
     {
         SliceLayer& layer = mesh.layers[layer_idx];
+        if (layer.parts.empty())
+        {
+            continue;
+        }
         std::vector<PolygonsPart> new_parts;
 
         for (const size_t other_mesh_idx : mesh_order)
@@ -647,7 +1147,7 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
                 break; // all previous meshes have been processed
             }
             SliceMeshStorage& other_mesh = storage.meshes[other_mesh_idx];
-            if (layer_idx >= static_cast<LayerIndex>(other_mesh.layers.size()))
+            if (layer_idx >= static_cast<int>(other_mesh.layers.size()))
             { // there can be no interaction between the infill mesh and this other non-infill mesh
                 continue;
             }
@@ -656,12 +1156,9 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
 
             for (SliceLayerPart& part : layer.parts)
             {
-                for (SliceLayerPart& other_part : other_layer.parts)
+                for (const size_t other_part_idx : other_layer.getPartsHitting(part.boundaryBox))
                 { // limit the outline of each part of this infill mesh to the infill of parts of the other mesh with lower infill mesh order
-                    if (!part.boundaryBox.hit(other_part.boundaryBox))
-                    { // early out
-                        continue;
-                    }
+                    SliceLayerPart& other_part = other_layer.parts[other_part_idx];
                     Polygons new_outline = part.outline.intersection(other_part.getOwnInfillArea());
                     if (new_outline.size() == 1)
                     { // we don't have to call splitIntoParts, because a single polygon can only be a single part
@@ -692,10 +1189,18 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
             layer.parts.back().outline = part;
             layer.parts.back().boundaryBox.calculate(part);
         }
+        layer.indexParts();
+    }
 
-        if (layer.parts.size() > 0 || (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL && layer.openPolyLines.size() > 0) )
+    mesh.layer_nr_max_filled_layer = -1;
+    const bool is_surface_mode = mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL;
+    for (LayerIndex layer_idx = static_cast<LayerIndex>(mesh.layers.size()) - 1; layer_idx >= 0; layer_idx--)
+    {
+        const SliceLayer& layer = mesh.layers[layer_idx];
+        if (layer.parts.size() > 0 || (is_surface_mode && layer.openPolyLines.size() > 0))
         {
-            mesh.layer_nr_max_filled_layer = layer_idx; // last set by the highest non-empty layer
+            mesh.layer_nr_max_filled_layer = layer_idx; // the highest non-empty layer
+            break;
         }
     }
 
@@ -703,6 +1208,7 @@ void FffPolygonGenerator::processInfillMesh(SliceDataStorage& storage, const siz
 
 void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
 {
+    TIME_FUNCTION();
     // generate spaghetti infill filling areas and volumes
     if (mesh.settings.get<bool>("spaghetti_infill_enabled"))
     {
@@ -731,20 +1237,17 @@ void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
                 || mesh.settings.get<EFillMethod>("infill_pattern") == EFillMethod::CROSS_3D)
         )
         {
-            const std::string cross_subdisivion_spec_image_file = mesh.settings.get<std::string>("cross_infill_density_image");
+            std::string cross_subdisivion_spec_image_file = mesh.settings.get<std::string>("cross_infill_density_image");
             std::ifstream cross_fs(cross_subdisivion_spec_image_file.c_str());
-            if (cross_subdisivion_spec_image_file != "" && cross_fs.good())
+            if (cross_subdisivion_spec_image_file != "" && !cross_fs.good())
             {
-                mesh.cross_fill_provider = new SierpinskiFillProvider(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"), cross_subdisivion_spec_image_file);
-            }
-            else
-            {
-                if (cross_subdisivion_spec_image_file != "" && cross_subdisivion_spec_image_file != " ")
+                if (cross_subdisivion_spec_image_file != " ")
                 {
                     logError("Cannot find density image \'%s\'.", cross_subdisivion_spec_image_file.c_str());
                 }
-                mesh.cross_fill_provider = new SierpinskiFillProvider(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"));
+                cross_subdisivion_spec_image_file = "";
             }
+            mesh.cross_fill_provider = SierpinskiFillProviderCache::getInstance().get(mesh.bounding_box, mesh.settings.get<coord_t>("infill_line_distance"), mesh.settings.get<coord_t>("infill_line_width"), cross_subdisivion_spec_image_file);
         }
 
         // combine infill
@@ -758,28 +1261,401 @@ void FffPolygonGenerator::processDerivedWallsSkinInfill(SliceMeshStorage& mesh)
     }
 }
 
+void FffPolygonGenerator::setInfillAngles(SliceMeshStorage& mesh)
+{
+    if (mesh.infill_angles.size() == 0)
+    {
+        mesh.infill_angles = mesh.settings.get<std::vector<AngleDegrees>>("infill_angles");
+        if (mesh.infill_angles.size() == 0)
+        {
+            // user has not specified any infill angles so use defaults
+            const EFillMethod infill_pattern = mesh.settings.get<EFillMethod>("infill_pattern");
+            if (infill_pattern == EFillMethod::CROSS || infill_pattern == EFillMethod::CROSS_3D)
+            {
+                mesh.infill_angles.push_back(22); // put most infill lines in between 45 and 0 degrees
+            }
+            else
+            {
+                mesh.infill_angles.push_back(45); // generally all infill patterns use 45 degrees
+                if (infill_pattern == EFillMethod::LINES || infill_pattern == EFillMethod::ZIG_ZAG)
+                {
+                    // lines and zig zag patterns default to also using 135 degrees
+                    mesh.infill_angles.push_back(135);
+                }
+            }
+        }
+    }
+}
+
+void FffPolygonGenerator::processInfillLines(SliceDataStorage& storage)
+{
+    TIME_FUNCTION();
+    size_t total_layers = 0;
+    for (SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (mesh.isPrinted())
+        {
+            total_layers = std::max(total_layers, mesh.layers.size());
+        }
+        setInfillAngles(mesh);
+    }
+
+    // The height at which each layer is printed: that of the first mesh which is actually printed there, like the layer plans get it.
+    std::vector<coord_t> print_z_per_layer;
+    for (size_t layer_nr = 0; layer_nr < total_layers; layer_nr++)
+    {
+        coord_t z = (layer_nr < storage.meshes[0].layers.size()) ? storage.meshes[0].layers[layer_nr].printZ : 0;
+        for (const SliceMeshStorage& mesh : storage.meshes)
+        {
+            if (layer_nr >= mesh.layers.size()
+                || mesh.settings.get<bool>("support_mesh")
+                || mesh.settings.get<bool>("anti_overhang_mesh")
+                || mesh.settings.get<bool>("cutting_mesh")
+                || mesh.settings.get<bool>("infill_mesh"))
+            {
+                continue;
+            }
+            z = mesh.layers[layer_nr].printZ;
+            break;
+        }
+        print_z_per_layer.push_back(z);
+    }
+
+    // Parts take very different amounts of time depending on their size and the infill pattern,
+    // so every part is a task of its own, rather than every layer.
+    TaskScheduler scheduler;
+    for (SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (mesh.settings.get<bool>("anti_overhang_mesh")
+            || mesh.settings.get<bool>("support_mesh")
+            || mesh.settings.get<bool>("spaghetti_infill_enabled")
+            || mesh.settings.get<coord_t>("infill_line_distance") <= 0)
+        {
+            continue;
+        }
+        const size_t mesh_layer_count = std::min(mesh.layers.size(), print_z_per_layer.size());
+        for (size_t layer_nr = 0; layer_nr < mesh_layer_count; layer_nr++)
+        {
+            for (SliceLayerPart& part : mesh.layers[layer_nr].parts)
+            {
+                const coord_t z = print_z_per_layer[layer_nr];
+                scheduler.schedule([this, &mesh, layer_nr, z, &part]()
+                {
+                    if (!Application::getInstance().isSliceCancelled())
+                    {
+                        generateInfillLines(mesh, layer_nr, z, part);
+                    }
+                });
+            }
+        }
+    }
+    scheduler.run();
+}
+
+void FffPolygonGenerator::generateInfillLines(const SliceMeshStorage& mesh, const LayerIndex layer_nr, const coord_t z, SliceLayerPart& part)
+{
+    part.infill_polygons_per_combine.clear();
+    part.infill_lines_per_combine.clear();
+    if (part.infill_area_per_combine_per_density.empty() || part.infill_area_per_combine_per_density[0].empty())
+    {
+        return;
+    }
+    const size_t combine_count = part.infill_area_per_combine_per_density[0].size();
+    part.infill_polygons_per_combine.resize(combine_count);
+    part.infill_lines_per_combine.resize(combine_count);
+
+    const coord_t infill_line_distance = mesh.settings.get<coord_t>("infill_line_distance");
+    const EFillMethod pattern = mesh.settings.get<EFillMethod>("infill_pattern");
+    const bool zig_zaggify_infill = mesh.settings.get<bool>("zig_zaggify_infill") || pattern == EFillMethod::ZIG_ZAG;
+    const bool connect_polygons = mesh.settings.get<bool>("connect_infill_polygons");
+    const coord_t infill_overlap = mesh.settings.get<coord_t>("infill_overlap_mm");
+    const size_t infill_multiplier = mesh.settings.get<size_t>("infill_multiplier");
+    const coord_t maximum_resolution = mesh.settings.get<coord_t>("meshfix_maximum_resolution");
+    const coord_t cross_infill_pocket_size = mesh.settings.get<coord_t>("cross_infill_pocket_size");
+    const Ratio line_width_factor = PathConfigStorage::getLineWidthFactorPerExtruder(layer_nr)[mesh.settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr];
+    AngleDegrees infill_angle = 45; //Original default. This will get updated to an element from mesh->infill_angles.
+    if (!mesh.infill_angles.empty())
+    {
+        const size_t combined_infill_layers = std::max(unsigned(1), round_divide(mesh.settings.get<coord_t>("infill_sparse_thickness"), std::max(mesh.settings.get<coord_t>("layer_height"), coord_t(1))));
+        infill_angle = mesh.infill_angles.at((layer_nr / combined_infill_layers) % mesh.infill_angles.size());
+    }
+    const Point3 mesh_middle = mesh.bounding_box.getMiddle();
+    const Point infill_origin(mesh_middle.x + mesh.settings.get<coord_t>("infill_offset_x"), mesh_middle.y + mesh.settings.get<coord_t>("infill_offset_y"));
+
+    //The thicker infill lines. (double or more layer thickness, infill combined with previous layers)
+    for (size_t combine_idx = 1; combine_idx < combine_count; combine_idx++)
+    {
+        const coord_t infill_line_width = mesh.settings.get<coord_t>("infill_line_width") * (combine_idx + 1) * line_width_factor; //The same as the line width of the infill config.
+        for (size_t density_idx = part.infill_area_per_combine_per_density.size() - 1; (int)density_idx >= 0; density_idx--)
+        { // combine different density infill areas (for gradual infill)
+            size_t density_factor = 2 << density_idx; // == pow(2, density_idx + 1)
+            coord_t infill_line_distance_here = infill_line_distance * density_factor; // the highest density infill combines with the next to create a grid with density_factor 1
+            coord_t infill_shift = infill_line_distance_here / 2;
+            if (density_idx == part.infill_area_per_combine_per_density.size() - 1 || pattern == EFillMethod::CROSS || pattern == EFillMethod::CROSS_3D)
+            {
+                infill_line_distance_here /= 2;
+            }
+
+            constexpr size_t wall_line_count = 0; // wall lines are always single layer
+            Polygons* perimeter_gaps = nullptr;
+            constexpr bool connected_zigzags = false;
+            constexpr bool use_endpieces = true;
+            constexpr bool skip_some_zags = false;
+            constexpr size_t zag_skip_count = 0;
+
+            Infill infill_comp(pattern, zig_zaggify_infill, connect_polygons, part.infill_area_per_combine_per_density[density_idx][combine_idx], /*outline_offset =*/ 0
+                , infill_line_width, infill_line_distance_here, infill_overlap, infill_multiplier, infill_angle, z, infill_shift, wall_line_count, infill_origin
+                , perimeter_gaps, connected_zigzags, use_endpieces, skip_some_zags, zag_skip_count
+                , cross_infill_pocket_size
+                , maximum_resolution);
+            infill_comp.generate(part.infill_polygons_per_combine[combine_idx], part.infill_lines_per_combine[combine_idx], mesh.cross_fill_provider.get(), &mesh);
+        }
+    }
+
+    //The single layer thick infill.
+    const coord_t infill_line_width = mesh.settings.get<coord_t>("infill_line_width") * line_width_factor; //The same as the line width of the infill config.
+    const size_t wall_line_count = mesh.settings.get<size_t>("infill_wall_line_count");
+    for (unsigned int density_idx = part.infill_area_per_combine_per_density.size() - 1; (int)density_idx >= 0; density_idx--)
+    {
+        int infill_line_distance_here = infill_line_distance << (density_idx + 1); // the highest density infill combines with the next to create a grid with density_factor 1
+        int infill_shift = infill_line_distance_here / 2;
+        // infill shift explanation: [>]=shift ["]=line_dist
+// :       |       :       |       :       |       :       |         > furthest from top
+// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
+// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
+// >>"""""
+// :       |       :       |       :       |       :       |         > furthest from top
+// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
+// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
+// >>>>"""""""""
+// :       |       :       |       :       |       :       |         > furthest from top
+// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |     > further from top
+// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | |   > near top
+// >>>>>>>>"""""""""""""""""
+
+        if (density_idx == part.infill_area_per_combine_per_density.size() - 1 || pattern == EFillMethod::CROSS || pattern == EFillMethod::CROSS_3D)
+        { // the least dense infill should fill up all remaining gaps
+// :       |       :       |       :       |       :       |       :  > furthest from top
+// :   |   |   |   :   |   |   |   :   |   |   |   :   |   |   |   :  > further from top
+// : | | | | | | | : | | | | | | | : | | | | | | | : | | | | | | | :  > near top
+//   .   .     .       .           .               .       .       .
+//   :   :     :       :           :               :       :       :
+//   `"""'     `"""""""'           `"""""""""""""""'       `"""""""'
+//                                                             ^   new line distance for lowest density infill
+//                                       ^ infill_line_distance_here for lowest density infill up till here
+//                 ^ middle density line dist
+//     ^   highest density line dist
+
+            //All of that doesn't hold for the Cross patterns; they should just always be multiplied by 2 for every density index.
+            infill_line_distance_here /= 2;
+        }
+
+        Polygons in_outline = part.infill_area_per_combine_per_density[density_idx][0];
+        const coord_t circumference = in_outline.polygonLength();
+        //Originally an area of 0.4*0.4*2 (2 line width squares) was found to be a good threshold for removal.
+        //However we found that this doesn't scale well with polygons with larger circumference (https://github.com/Ultimaker/Cura/issues/3992).
+        //Given that the original test worked for approximately 2x2cm models, this scaling by circumference should make it work for any size.
+        const double minimum_small_area = 0.4 * 0.4 * circumference / 40000;
+
+        // This is only for density infill, because after generating the infill might appear unnecessary infill on walls
+        // especially on vertical surfaces
+        in_outline.removeSmallAreas(minimum_small_area);
+
+        Infill infill_comp(pattern, zig_zaggify_infill, connect_polygons, in_outline, /*outline_offset =*/ 0
+            , infill_line_width, infill_line_distance_here, infill_overlap, infill_multiplier, infill_angle, z, infill_shift, wall_line_count, infill_origin
+            , /*Polygons* perimeter_gaps =*/ nullptr
+            , /*bool connected_zigzags =*/ false
+            , /*bool use_endpieces =*/ false
+            , /*bool skip_some_zags =*/ false
+            , /*int zag_skip_count =*/ 0
+            , cross_infill_pocket_size
+            , maximum_resolution);
+        infill_comp.generate(part.infill_polygons_per_combine[0], part.infill_lines_per_combine[0], mesh.cross_fill_provider.get(), &mesh);
+    }
+}
+
+void FffPolygonGenerator::processWallOverlaps(SliceDataStorage& storage)
+{
+    TIME_FUNCTION();
+    TaskScheduler scheduler;
+    for (SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (!mesh.settings.get<bool>("travel_compensate_overlapping_walls_0_enabled") && !mesh.settings.get<bool>("travel_compensate_overlapping_walls_x_enabled"))
+        {
+            continue;
+        }
+        // The spiralized layers are printed without compensation.
+        const bool spiralize = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<bool>("magic_spiralize");
+        const size_t bottom_layers = mesh.settings.get<size_t>("bottom_layers");
+        for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        {
+            std::vector<SliceLayerPart>& parts = mesh.layers[layer_nr].parts;
+            for (size_t part_idx = (spiralize && layer_nr >= bottom_layers) ? 1 : 0; part_idx < parts.size(); part_idx++)
+            {
+                SliceLayerPart& part = parts[part_idx];
+                scheduler.schedule([this, &mesh, layer_nr, &part]()
+                {
+                    generateWallOverlaps(mesh, layer_nr, part);
+                });
+            }
+        }
+    }
+    scheduler.run();
+}
+
+void FffPolygonGenerator::generateWallOverlaps(const SliceMeshStorage& mesh, const LayerIndex layer_nr, SliceLayerPart& part)
+{
+    part.wall_overlap_linkers.clear();
+    if (part.insets.empty())
+    {
+        return;
+    }
+    // The same line widths as the wall configs of the layer, see PathConfigStorage::MeshPathConfigs.
+    const std::vector<Ratio> line_width_factor_per_extruder = PathConfigStorage::getLineWidthFactorPerExtruder(layer_nr);
+    const coord_t line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr];
+    const coord_t line_width_x = mesh.settings.get<coord_t>("wall_line_width_x") * line_width_factor_per_extruder[mesh.settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr];
+    const bool compensate_overlap_0 = mesh.settings.get<bool>("travel_compensate_overlapping_walls_0_enabled");
+    const bool compensate_overlap_x = mesh.settings.get<bool>("travel_compensate_overlapping_walls_x_enabled");
+
+    if (compensate_overlap_0)
+    {
+        part.wall_overlap_linkers.push_back(std::make_shared<const PolygonProximityLinker>(part.insets[0], line_width_0));
+    }
+    else
+    {
+        part.wall_overlap_linkers.push_back(nullptr);
+    }
+    if (InsetOrderOptimizer::optimizingInsetsIsWorthwhile(mesh, part))
+    {
+        // All inner walls are printed together.
+        if (compensate_overlap_x)
+        {
+            Polygons wall_x_polys;
+            for (size_t inset_idx = 1; inset_idx < part.insets.size(); inset_idx++)
+            {
+                wall_x_polys.add(part.insets[inset_idx]);
+            }
+            // use a slightly reduced line width so that compensation only occurs between insets at the same level (and not between insets in adjacent levels)
+            part.wall_overlap_linkers.push_back(std::make_shared<const PolygonProximityLinker>(wall_x_polys, line_width_x - 1));
+        }
+        else
+        {
+            part.wall_overlap_linkers.push_back(nullptr);
+        }
+        return;
+    }
+    for (size_t inset_idx = 1; inset_idx < part.insets.size(); inset_idx++)
+    {
+        if (compensate_overlap_x)
+        {
+            part.wall_overlap_linkers.push_back(std::make_shared<const PolygonProximityLinker>(part.insets[inset_idx], line_width_x));
+        }
+        else
+        {
+            part.wall_overlap_linkers.push_back(nullptr);
+        }
+    }
+}
+
 /*
- * This function is executed in a parallel region based on layer_nr.
+ * This function is executed in a parallel region based on layer_nr and part.
  * When modifying make sure any changes does not introduce data races.
  *
- * processInsets only reads and writes data for the current layer
+ * processInsets only reads and writes data for the current part
  */
-void FffPolygonGenerator::processInsets(SliceMeshStorage& mesh, size_t layer_nr)
+void FffPolygonGenerator::processInsets(const SliceMeshStorage& mesh, const size_t layer_nr, SliceLayerPart& part)
 {
-    SliceLayer* layer = &mesh.layers[layer_nr];
     if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
     {
         WallsComputation walls_computation(mesh.settings, layer_nr);
-        walls_computation.generateInsets(layer);
+        walls_computation.generateInsets(&part);
     }
     else
     {
-        for (SliceLayerPart& part : layer->parts)
+        part.insets.push_back(part.outline); // Fake an inset
+        part.print_outline = part.outline;
+    }
+}
+
+void FffPolygonGenerator::removePartsWithoutInsets(SliceMeshStorage& mesh, const size_t layer_nr)
+{
+    if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::SURFACE)
+    {
+        WallsComputation walls_computation(mesh.settings, layer_nr);
+        walls_computation.removePartsWithoutInsets(&mesh.layers[layer_nr]);
+    }
+}
+
+std::vector<std::vector<size_t>> FffPolygonGenerator::findPartsRepeatedAbove(const SliceMeshStorage& mesh) const
+{
+    std::vector<std::vector<size_t>> repeated_above(mesh.layers.size());
+    for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        repeated_above[layer_nr].assign(mesh.layers[layer_nr].parts.size(), NO_INDEX);
+    }
+    if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE || mesh.settings.get<bool>("alternate_extra_perimeter"))
+    {
+        return repeated_above;
+    }
+    // The initial layer has wider lines, and spiralized bottom layers get extra walls every other layer (see WallsComputation::generateInsets).
+    size_t first_layer_nr = 1;
+    if (mesh.settings.get<bool>("magic_spiralize"))
+    {
+        first_layer_nr = std::max(first_layer_nr, mesh.settings.get<size_t>("bottom_layers"));
+    }
+
+    std::vector<std::vector<uint64_t>> outline_hashes(mesh.layers.size());
+#pragma omp parallel for schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = first_layer_nr; layer_nr < static_cast<int>(mesh.layers.size()); layer_nr++)
+    {
+        for (const SliceLayerPart& part : mesh.layers[layer_nr].parts)
         {
-            part.insets.push_back(part.outline); // Fake an inset
-            part.print_outline = part.outline;
+            uint64_t hash = part.outline.size();
+            for (ConstPolygonRef polygon : part.outline)
+            {
+                hash_combine(hash, polygon.size());
+                for (const Point& point : polygon)
+                {
+                    hash_combine(hash, point.X);
+                    hash_combine(hash, point.Y);
+                }
+            }
+            outline_hashes[layer_nr].push_back(hash);
         }
     }
+
+#pragma omp parallel for schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = first_layer_nr; layer_nr < static_cast<int>(mesh.layers.size()) - 1; layer_nr++)
+    {
+        const std::vector<SliceLayerPart>& parts = mesh.layers[layer_nr].parts;
+        const std::vector<SliceLayerPart>& parts_above = mesh.layers[layer_nr + 1].parts;
+        for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+        {
+            for (size_t above_idx = 0; above_idx < parts_above.size(); above_idx++)
+            {
+                if (outline_hashes[layer_nr][part_idx] != outline_hashes[layer_nr + 1][above_idx])
+                {
+                    continue;
+                }
+                const PolygonsPart& outline = parts[part_idx].outline;
+                const PolygonsPart& outline_above = parts_above[above_idx].outline;
+                bool same = outline.size() == outline_above.size();
+                for (size_t poly_idx = 0; same && poly_idx < outline.size(); poly_idx++)
+                {
+                    same = outline[poly_idx].size() == outline_above[poly_idx].size()
+                        && std::equal(outline[poly_idx].begin(), outline[poly_idx].end(), outline_above[poly_idx].begin());
+                }
+                if (same)
+                {
+                    repeated_above[layer_nr][part_idx] = above_idx;
+                    break;
+                }
+            }
+        }
+    }
+    return repeated_above;
 }
 
 bool FffPolygonGenerator::isEmptyLayer(SliceDataStorage& storage, const unsigned int layer_idx)
@@ -846,6 +1722,7 @@ void FffPolygonGenerator::removeEmptyFirstLayers(SliceDataStorage& storage, size
         storage.support.layer_nr_max_filled_layer -= n_empty_first_layers;
         std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
         support_layers.erase(support_layers.begin(), support_layers.begin() + n_empty_first_layers);
+        storage.invalidateLayerOutlines();
     }
 }
 
@@ -943,6 +1820,7 @@ void FffPolygonGenerator::computePrintHeightStatistics(SliceDataStorage& storage
 
 void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
 {
+    TIME_FUNCTION();
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     if (!mesh_group_settings.get<bool>("ooze_shield_enabled"))
     {
@@ -951,20 +1829,29 @@ void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
 
     const coord_t ooze_shield_dist = mesh_group_settings.get<coord_t>("ooze_shield_dist");
 
+    // The outlines of the layers are independent, so they are offset in parallel.
+    storage.oozeShield.resize(std::max(0, storage.max_print_height_second_to_last_extruder + 1));
+    TaskScheduler outline_scheduler;
     for (int layer_nr = 0; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
     {
-        constexpr bool around_support = true;
-        constexpr bool around_prime_tower = false;
-        storage.oozeShield.push_back(storage.getLayerOutlines(layer_nr, around_support, around_prime_tower).offset(ooze_shield_dist, ClipperLib::jtRound));
+        outline_scheduler.schedule([&storage, ooze_shield_dist, layer_nr]()
+        {
+            constexpr bool around_support = true;
+            constexpr bool around_prime_tower = false;
+            storage.oozeShield[layer_nr] = storage.getLayerOutlines(layer_nr, around_support, around_prime_tower).offset(ooze_shield_dist, ClipperLib::jtRound);
+        });
     }
+    outline_scheduler.run();
 
+    // Each layer depends on the one below and the one above, so the slope is limited layer by layer.
+    // Shrinking the union of two layers isn't the same as the union of the shrunk layers, so this can't be split into independent windows.
     const AngleDegrees angle = mesh_group_settings.get<AngleDegrees>("ooze_shield_angle");
     if (angle <= 89)
     {
         const coord_t allowed_angle_offset = tan(mesh_group_settings.get<AngleRadians>("ooze_shield_angle")) * mesh_group_settings.get<coord_t>("layer_height"); // Allow for a 60deg angle in the oozeShield.
         for (LayerIndex layer_nr = 1; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
         {
-            storage.oozeShield[layer_nr] = storage.oozeShield[layer_nr].unionPolygons(storage.oozeShield[layer_nr - 1].offset(-allowed_angle_offset));
+            storage.oozeShield[layer_nr].unionInPlace(storage.oozeShield[layer_nr - 1].offset(-allowed_angle_offset));
         }
         for (LayerIndex layer_nr = storage.max_print_height_second_to_last_extruder; layer_nr > 0; layer_nr--)
         {
@@ -973,14 +1860,20 @@ void FffPolygonGenerator::processOozeShield(SliceDataStorage& storage)
     }
 
     const float largest_printed_area = 1.0; // TODO: make var a parameter, and perhaps even a setting?
+    TaskScheduler small_area_scheduler;
     for (LayerIndex layer_nr = 0; layer_nr <= storage.max_print_height_second_to_last_extruder; layer_nr++)
     {
-        storage.oozeShield[layer_nr].removeSmallAreas(largest_printed_area);
+        small_area_scheduler.schedule([&storage, largest_printed_area, layer_nr]()
+        {
+            storage.oozeShield[layer_nr].removeSmallAreas(largest_printed_area);
+        });
     }
+    small_area_scheduler.run();
 }
 
 void FffPolygonGenerator::processDraftShield(SliceDataStorage& storage)
 {
+    TIME_FUNCTION();
     const size_t draft_shield_layers = getDraftShieldLayerCount(storage.print_layer_count);
     if (draft_shield_layers <= 0)
     {
@@ -991,20 +1884,32 @@ void FffPolygonGenerator::processDraftShield(SliceDataStorage& storage)
 
     const unsigned int layer_skip = 500 / layer_height + 1;
 
-    Polygons& draft_shield = storage.draft_protection_shield;
-    for (unsigned int layer_nr = 0; layer_nr < storage.print_layer_count && layer_nr < draft_shield_layers; layer_nr += layer_skip)
+    // The shield is the convex hull of the outlines, so they don't need to be unioned first. They are collected in parallel.
+    std::vector<Polygons> outlines((std::min(storage.print_layer_count, draft_shield_layers) + layer_skip - 1) / layer_skip);
+    TaskScheduler scheduler;
+    for (size_t outline_idx = 0; outline_idx < outlines.size(); outline_idx++)
     {
-        constexpr bool around_support = true;
-        constexpr bool around_prime_tower = false;
-        draft_shield = draft_shield.unionPolygons(storage.getLayerOutlines(layer_nr, around_support, around_prime_tower));
+        scheduler.schedule([&storage, &outlines, outline_idx, layer_skip]()
+        {
+            constexpr bool around_support = true;
+            constexpr bool around_prime_tower = false;
+            outlines[outline_idx] = storage.getLayerOutlines(outline_idx * layer_skip, around_support, around_prime_tower);
+        });
     }
+    scheduler.run();
 
+    Polygons draft_shield;
+    for (Polygons& outline : outlines)
+    {
+        draft_shield.add(std::move(outline));
+    }
     const int draft_shield_dist = mesh_group_settings.get<coord_t>("draft_shield_dist");
     storage.draft_protection_shield = draft_shield.approxConvexHull(draft_shield_dist);
 }
 
 void FffPolygonGenerator::processPlatformAdhesion(SliceDataStorage& storage)
 {
+    TIME_FUNCTION();
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     ExtruderTrain& train = mesh_group_settings.get<ExtruderTrain&>("adhesion_extruder_nr");
 
@@ -1052,59 +1957,76 @@ void FffPolygonGenerator::processFuzzyWalls(SliceMeshStorage& mesh)
     const coord_t avg_dist_between_points = mesh.settings.get<coord_t>("magic_fuzzy_skin_point_dist");
     const coord_t min_dist_between_points = avg_dist_between_points * 3 / 4; // hardcoded: the point distance may vary between 3/4 and 5/4 the supplied value
     const coord_t range_random_point_dist = avg_dist_between_points / 2;
+    const bool surface_mode = mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE;
     unsigned int start_layer_nr = (mesh.settings.get<EPlatformAdhesion>("adhesion_type") == EPlatformAdhesion::BRIM)? 1 : 0; // don't make fuzzy skin on first layer if there's a brim
-    for (unsigned int layer_nr = start_layer_nr; layer_nr < mesh.layers.size(); layer_nr++)
+
+    const auto fuzz_part = [fuzziness, min_dist_between_points, range_random_point_dist, surface_mode](SliceLayerPart& part, DeterministicRandom random)
     {
-        SliceLayer& layer = mesh.layers[layer_nr];
-        for (SliceLayerPart& part : layer.parts)
+        Polygons results;
+        Polygons& skin = surface_mode ? part.outline : part.insets[0];
+        for (PolygonRef poly : skin)
         {
-            Polygons results;
-            Polygons& skin = (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE)? part.outline : part.insets[0];
-            for (PolygonRef poly : skin)
-            {
-                // generate points in between p0 and p1
-                PolygonRef result = results.newPoly();
-
-                int64_t dist_left_over = rand() % (min_dist_between_points / 2); // the distance to be traversed on the line before making the first new point
-                Point* p0 = &poly.back();
-                for (Point& p1 : poly)
-                { // 'a' is the (next) new point between p0 and p1
-                    Point p0p1 = p1 - *p0;
-                    int64_t p0p1_size = vSize(p0p1);
-                    int64_t dist_last_point = dist_left_over + p0p1_size * 2; // so that p0p1_size - dist_last_point evaulates to dist_left_over - p0p1_size
-                    for (int64_t p0pa_dist = dist_left_over; p0pa_dist < p0p1_size; p0pa_dist += min_dist_between_points + rand() % range_random_point_dist)
-                    {
-                        int r = rand() % (fuzziness * 2) - fuzziness;
-                        Point perp_to_p0p1 = turn90CCW(p0p1);
-                        Point fuzz = normal(perp_to_p0p1, r);
-                        Point pa = *p0 + normal(p0p1, p0pa_dist) + fuzz;
-                        result.add(pa);
-                        dist_last_point = p0pa_dist;
-                    }
-                    dist_left_over = p0p1_size - dist_last_point;
-
-                    p0 = &p1;
-                }
-                while (result.size() < 3)
+            // generate points in between p0 and p1
+            PolygonRef result = results.newPoly();
+            result.reserve(poly.polygonLength() / min_dist_between_points + 3);
+
+            int64_t dist_left_over = random.below(min_dist_between_points / 2); // the distance to be traversed on the line before making the first new point
+            Point* p0 = &poly.back();
+            for (Point& p1 : poly)
+            { // 'a' is the (next) new point between p0 and p1
+                Point p0p1 = p1 - *p0;
+                int64_t p0p1_size = vSize(p0p1);
+                int64_t dist_last_point = dist_left_over + p0p1_size * 2; // so that p0p1_size - dist_last_point evaulates to dist_left_over - p0p1_size
+                for (int64_t p0pa_dist = dist_left_over; p0pa_dist < p0p1_size; p0pa_dist += min_dist_between_points + random.below(range_random_point_dist))
                 {
-                    size_t point_idx = poly.size() - 2;
-                    result.add(poly[point_idx]);
-                    if (point_idx == 0)
-                    {
-                        break;
-                    }
-                    point_idx--;
+                    int r = random.below(fuzziness * 2) - fuzziness;
+                    Point perp_to_p0p1 = turn90CCW(p0p1);
+                    Point fuzz = normal(perp_to_p0p1, r);
+                    Point pa = *p0 + normal(p0p1, p0pa_dist) + fuzz;
+                    result.add(pa);
+                    dist_last_point = p0pa_dist;
                 }
-                if (result.size() < 3)
+                dist_left_over = p0p1_size - dist_last_point;
+
+                p0 = &p1;
+            }
+            while (result.size() < 3)
+            {
+                size_t point_idx = poly.size() - 2;
+                result.add(poly[point_idx]);
+                if (point_idx == 0)
                 {
-                    result.clear();
-                    for (Point& p : poly)
-                        result.add(p);
+                    break;
                 }
+                point_idx--;
+            }
+            if (result.size() < 3)
+            {
+                result.clear();
+                for (Point& p : poly)
+                    result.add(p);
             }
-            skin = results;
+        }
+        skin = std::move(results);
+    };
+
+    // Every part draws its own random numbers, seeded by where it is, so that the result doesn't depend on the threads.
+    TaskScheduler scheduler;
+    for (unsigned int layer_nr = start_layer_nr; layer_nr < mesh.layers.size(); layer_nr++)
+    {
+        SliceLayer& layer = mesh.layers[layer_nr];
+        for (size_t part_idx = 0; part_idx < layer.parts.size(); part_idx++)
+        {
+            uint64_t seed = layer_nr;
+            hash_combine(seed, part_idx);
+            SliceLayerPart& part = layer.parts[part_idx];
+            scheduler.schedule([&fuzz_part, &part, seed]()
+            {
+                fuzz_part(part, DeterministicRandom(seed));
+            });
         }
     }
+    scheduler.run();
 }
 
 
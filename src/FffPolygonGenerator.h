@@ -4,6 +4,12 @@
 #ifndef FFF_POLYGON_GENERATOR_H
 #define FFF_POLYGON_GENERATOR_H
 
+#include <functional>
+#include <memory> //For unique_ptr.
+#include <vector>
+
+#include "InsetSkinCache.h"
+#include "SlicerCache.h"
 #include "utils/NoCopy.h"
 
 namespace cura
@@ -11,17 +17,19 @@ namespace cura
 
 struct LayerIndex;
 class MeshGroup;
-class ProgressStageEstimator;
 class SliceDataStorage;
+class SliceLayerPart;
 class SliceMeshStorage;
+class TaskScheduler;
 class TimeKeeper;
 
 /*!
  * Primary stage in Fused Filament Fabrication processing: Polygons are generated.
  * The model is sliced and each slice consists of polygons representing the outlines: the boundaries between inside and outside the object.
  * After slicing, the layers are processed; for example the wall insets are generated, and the areas which are to be filled with support and infill, which are all represented by polygons.
- * In this stage nothing other than areas and circular paths are generated, which are both represented by polygons.
- * No infill lines or support pattern etc. is generated.
+ * In this stage mostly areas and circular paths are generated, which are both represented by polygons.
+ * The only lines generated are those of the sparse infill, so that they can be computed for all layers in parallel.
+ * No support pattern etc. is generated.
  * 
  * The main function of this class is FffPolygonGenerator::generateAreas().
  */
@@ -51,6 +59,23 @@ private:
      */
     size_t getDraftShieldLayerCount(const size_t total_layers) const;
 
+    /*!
+     * \brief Dump the areas of the layers that were selected with the
+     * geometry_dump_* settings, see \ref GeometryDump.
+     * 
+     * \param storage The slice data with the generated areas.
+     */
+    void dumpGeometry(const SliceDataStorage& storage) const;
+
+    /*!
+     * \brief Start loading the density images of the cross infill and cross
+     * support in the background, so that they are loaded while the meshes are
+     * sliced.
+     *
+     * \param meshgroup The mesh group that is about to be sliced.
+     */
+    void prefetchDensityImages(const MeshGroup& meshgroup) const;
+
     /*!
      * Slice the \p object and store the outlines in the \p storage.
      * 
@@ -58,43 +83,108 @@ private:
      * \param timeKeeper Object which keeps track of timings of each stage.
      * \param storage Output parameter: where the outlines are stored. See SliceLayerPart::outline.
      * 
-     * \return Whether the process succeeded (always true).
+     * \return Whether the process succeeded, i.e. the settings are valid and
+     * the slice wasn't cancelled.
      */
     bool sliceModel(MeshGroup* object, TimeKeeper& timeKeeper, SliceDataStorage& storage); /// slices the model
 
+    /*!
+     * \brief Find the meshes that are moved copies of earlier meshes in the
+     * mesh group, see \ref Mesh::isHorizontalCopyOf.
+     *
+     * Plates often hold many copies of the same part. Each of them only needs
+     * to be sliced once, and gets the same walls, skin and infill, moved along.
+     * Only done if the scene setting deduplicate_mesh_copies is enabled, since
+     * the copies may then be up to 2 microns off, which can change how the
+     * support and brim connect to them.
+     * This fills in \ref FffPolygonGenerator::mesh_copy_of and
+     * \ref FffPolygonGenerator::mesh_copy_translation.
+     * \param mesh_group The meshes to look for copies in, before slicing.
+     */
+    void findMeshCopies(const MeshGroup& mesh_group);
+
+    /*!
+     * \brief Give a mesh the walls, skin and infill of the mesh it is a copy
+     * of, moved to its own position.
+     *
+     * This is only possible if the layer parts of both meshes are the same
+     * apart from their position. That's not the case if the meshes were carved
+     * differently by other meshes, for instance. If the mesh group has infill
+     * meshes, the infill areas of the original may have been changed since it
+     * was processed, so then nothing is copied either.
+     * \param storage The slice data with the original mesh.
+     * \param mesh_idx The mesh to fill in.
+     * \return Whether the walls, skin and infill were copied.
+     */
+    bool copyWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_idx) const;
+
     /*!
      * Processes the outline information as stored in the \p storage: generates inset perimeter polygons, support area polygons, etc. 
      * 
      * \param storage Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      * \param timeKeeper Object which keeps track of timings of each stage.
+     * \return Whether the process succeeded, i.e. the slice wasn't cancelled.
      */
-    void slices2polygons(SliceDataStorage& storage, TimeKeeper& timeKeeper);
+    bool slices2polygons(SliceDataStorage& storage, TimeKeeper& timeKeeper);
     
+    /*!
+     * \brief The state that the tasks computing the walls, skin and infill of
+     * one mesh share while they are scheduled.
+     */
+    struct WallsSkinInfillTasks;
+
     /*!
      * Processes the outline information as stored in the \p storage: generates inset perimeter polygons, skin and infill
-     * 
+     *
+     * The work is scheduled as tasks on \p scheduler, so that the tasks of
+     * several meshes can run at the same time. Once the scheduler has run, the
+     * mesh needs to be finished with finishBasicWallsSkinInfill.
+     *
      * \param storage Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      * \param mesh_order_idx The index of the mesh_idx in \p mesh_order to process in the vector of meshes in \p storage
      * \param mesh_order The order in which the meshes are processed (used for infill meshes)
-     * \param inset_skin_progress_estimate The progress stage estimate calculator
+     * \param scheduler The scheduler to run the tasks on.
+     * \param report_progress Reports the progress of the walls, skin and
+     * infill of all meshes, given the weight of the work that was just done.
+     * \return The state of the scheduled tasks, or nullptr if the walls, skin
+     * and infill were copied without any tasks.
+     */
+    std::unique_ptr<WallsSkinInfillTasks> processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, TaskScheduler& scheduler, const std::function<void (size_t)>& report_progress);
+
+    /*!
+     * \brief Clean up after the tasks of processBasicWallsSkinInfill are done,
+     * and store the result in the cache of a long-running engine.
+     * \param storage The slice data with the mesh.
+     * \param tasks The state of the tasks, which are all done.
+     */
+    void finishBasicWallsSkinInfill(SliceDataStorage& storage, WallsSkinInfillTasks& tasks);
+
+    /*!
+     * Generate the outline gaps and perimeter gaps of all meshes.
+     * 
+     * The layers are independent of each other, so every layer of every mesh is processed in parallel.
+     * 
+     * \param[in,out] storage The meshes to generate the gaps of.
      */
-    void processBasicWallsSkinInfill(SliceDataStorage& storage, const size_t mesh_order_idx, const std::vector<size_t>& mesh_order, ProgressStageEstimator& inset_skin_progress_estimate);
+    void processGaps(SliceDataStorage& storage);
 
     /*!
      * Generate areas for the gaps between outer wall and the outline where the first wall doesn't fit.
      * These areas should be filled with a skin-like pattern, so that these skin lines get combined into one line with gradual changing width.
      * 
-     * \param[in,out] storage fetches the SliceLayerPart::insets and SliceLayerPart::outline and generates the outline_gaps in SliceLayerPart
+     * \param[in,out] mesh fetches the SliceLayerPart::insets and SliceLayerPart::outline and generates the outline_gaps in SliceLayerPart
+     * \param layer_nr The layer to generate the outline gaps of.
      */
-    void processOutlineGaps(SliceDataStorage& storage);
+    void processOutlineGaps(SliceMeshStorage& mesh, const LayerIndex layer_nr);
 
     /*!
      * Generate areas for the gaps between walls where the next inset doesn't fit.
      * These areas should be filled with a skin-like pattern, so that these skin lines get combined into one line with gradual changing width.
      * 
-     * \param[in,out] storage fetches the perimeter information (see SliceLayerPart::insets and SkinPart::insets) and generates the other perimeter_gaps in SliceLayerPart and SkinPart
+     * \param[in,out] mesh fetches the perimeter information (see SliceLayerPart::insets and SkinPart::insets) and generates the other perimeter_gaps in SliceLayerPart and SkinPart
+     * \param layer_nr The layer to generate the perimeter gaps of.
      */
-    void processPerimeterGaps(SliceDataStorage& storage);
+    void processPerimeterGaps(SliceMeshStorage& mesh, const LayerIndex layer_nr);
 
     /*!
      * Process the mesh to be an infill mesh: limit all outlines to within the infill of normal meshes and subtract their volume from the infill of those meshes
@@ -112,6 +202,52 @@ private:
      * \param mesh Input and Output parameter: fetches the outline information (see SliceLayerPart::outline) and generates the other reachable field of the \p storage
      */
     void processDerivedWallsSkinInfill(SliceMeshStorage& mesh);
+
+    /*!
+     * Set the infill angles of a mesh, see SliceMeshStorage::infill_angles.
+     * 
+     * This list of angles is cycled through to get the infill angle of a specific layer.
+     * 
+     * \param mesh The mesh for which to determine the infill angles.
+     */
+    void setInfillAngles(SliceMeshStorage& mesh);
+
+    /*!
+     * Generate the sparse infill lines of all layer parts of all meshes, see SliceLayerPart::infill_lines_per_combine.
+     *
+     * The parts are processed in parallel.
+     * 
+     * \param storage Input and Output parameter: fetches the infill areas (see SliceLayerPart::infill_area_per_combine_per_density) and stores the infill paths in the layer parts.
+     */
+    void processInfillLines(SliceDataStorage& storage);
+
+    /*!
+     * Generate the sparse infill lines of a single layer part.
+     * 
+     * \param mesh The mesh of the layer part.
+     * \param layer_nr The layer of the layer part.
+     * \param z The height at which the layer is printed.
+     * \param part Input and Output parameter: fetches the infill areas and stores the infill paths.
+     */
+    void generateInfillLines(const SliceMeshStorage& mesh, const LayerIndex layer_nr, const coord_t z, SliceLayerPart& part);
+
+    /*!
+     * Compute the overlaps between the walls of all layer parts of all meshes, see SliceLayerPart::wall_overlap_linkers.
+     *
+     * The parts are processed in parallel.
+     *
+     * \param storage Input and Output parameter: fetches the insets and stores the overlaps in the layer parts.
+     */
+    void processWallOverlaps(SliceDataStorage& storage);
+
+    /*!
+     * Compute the overlaps between the walls of a single layer part.
+     *
+     * \param mesh The mesh of the layer part.
+     * \param layer_nr The layer of the layer part.
+     * \param part Input and Output parameter: fetches the insets and stores the overlaps.
+     */
+    void generateWallOverlaps(const SliceMeshStorage& mesh, const LayerIndex layer_nr, SliceLayerPart& part);
     
     /*!
      * Checks whether a layer is empty or not
@@ -141,10 +277,39 @@ private:
     void computePrintHeightStatistics(SliceDataStorage& storage);
 
     /*!
-     * \brief Generate the inset polygons which form the walls.
-     * \param layer_nr The layer for which to generate the insets.
+     * \brief Generate the inset polygons which form the walls of a single layer part.
+     *
+     * The parts of a layer can be processed in parallel. Afterwards the parts
+     * without walls need to be removed with removePartsWithoutInsets.
+     * \param mesh The mesh of the layer part.
+     * \param layer_nr The layer of the layer part.
+     * \param part Input and Output parameter: fetches the outline and stores the insets.
      */
-    void processInsets(SliceMeshStorage& mesh, size_t layer_nr);
+    void processInsets(const SliceMeshStorage& mesh, const size_t layer_nr, SliceLayerPart& part);
+
+    /*!
+     * \brief Remove the parts of a layer which got no walls at all because they
+     * are too small, once the walls of all parts of the layer are generated.
+     * \param mesh The mesh of the layer.
+     * \param layer_nr The layer of which to remove the parts.
+     */
+    void removePartsWithoutInsets(SliceMeshStorage& mesh, const size_t layer_nr);
+
+    /*!
+     * \brief Find the layer parts that are repeated in the layer above them,
+     * with exactly the same outline.
+     *
+     * Prismatic parts have long runs of layers with the same outline. The walls
+     * of such a run only need to be computed once and can be copied to the
+     * other layers of the run. Layers of which the walls are different anyway,
+     * such as the initial layer or layers with alternating extra walls, are
+     * never considered repeated.
+     * \param mesh The mesh of which the layer parts are sliced, but of which
+     * the walls aren't generated yet.
+     * \return For each part of each layer, the index of the part in the layer
+     * above that has the same outline, or NO_INDEX if there is none.
+     */
+    std::vector<std::vector<size_t>> findPartsRepeatedAbove(const SliceMeshStorage& mesh) const;
 
     /*!
      * Generate the outline of the ooze shield.
@@ -178,11 +343,36 @@ private:
      * 
      * Introduce new vertices and move existing vertices in or out by a random distance, based on the fuzzy skin settings.
      * 
-     * This only changes the outer wall.
+     * This only changes the outer wall. The parts are processed in parallel,
+     * and the random distances are the same for every slice of the same mesh.
      * 
      * \param[in,out] mesh where the outer wall is retrieved and stored in.
      */
     void processFuzzyWalls(SliceMeshStorage& mesh);
+
+    /*!
+     * \brief The sliced meshes of previous slices, used if the engine keeps
+     * warm state between slices.
+     */
+    SlicerCache slicer_cache;
+
+    /*!
+     * \brief The walls, skin and infill of meshes of previous slices, used if
+     * the engine keeps warm state between slices.
+     */
+    InsetSkinCache inset_skin_cache;
+
+    /*!
+     * \brief For each mesh of the current mesh group, the index of the earlier
+     * mesh that it's a moved copy of, or its own index if it isn't a copy.
+     */
+    std::vector<size_t> mesh_copy_of;
+
+    /*!
+     * \brief For each mesh of the current mesh group, how far it is moved with
+     * respect to the mesh that it's a copy of.
+     */
+    std::vector<Point> mesh_copy_translation;
 };
 
 }//namespace cura
@@ -4,6 +4,8 @@
 #ifndef FFF_PROCESSOR_H
 #define FFF_PROCESSOR_H
 
+#include <memory> //For unique_ptr.
+
 #include "FffGcodeWriter.h"
 #include "FffPolygonGenerator.h"
 #include "utils/gettime.h"
@@ -36,7 +38,7 @@ public:
     /*!
      * The gcode writer, which generates paths in layer plans in a buffer, which converts these paths into gcode commands.
      */
-    FffGcodeWriter gcode_writer;
+    std::unique_ptr<FffGcodeWriter> gcode_writer;
 
     /*!
      * The polygon generator, which slices the models and generates all polygons to be printed and areas to be filled.
@@ -48,6 +50,21 @@ public:
      */
     TimeKeeper time_keeper; // TODO: use singleton time keeper
 
+    FffProcessor()
+    : gcode_writer(new FffGcodeWriter())
+    {
+    }
+
+    /*!
+     * Start over with a new gcode writer, forgetting the state of the previous slice.
+     * 
+     * Used when the engine slices multiple times in one run.
+     */
+    void reset()
+    {
+        gcode_writer.reset(new FffGcodeWriter());
+    }
+
     /*!
      * Set the target to write gcode to: to a file.
      * 
@@ -57,7 +74,7 @@ public:
      */
     bool setTargetFile(const char* filename)
     {
-        return gcode_writer.setTargetFile(filename);
+        return gcode_writer->setTargetFile(filename);
     }
 
     /*!
@@ -69,7 +86,7 @@ public:
      */
     void setTargetStream(std::ostream* stream)
     {
-        return gcode_writer.setTargetStream(stream);
+        return gcode_writer->setTargetStream(stream);
     }
 
     /*!
@@ -82,7 +99,7 @@ public:
      */
     double getTotalFilamentUsed(int extruder_nr)
     {
-        return gcode_writer.getTotalFilamentUsed(extruder_nr);
+        return gcode_writer->getTotalFilamentUsed(extruder_nr);
     }
 
     /*!
@@ -92,7 +109,7 @@ public:
      */
     std::vector<Duration> getTotalPrintTimePerFeature()
     {
-        return gcode_writer.getTotalPrintTimePerFeature();
+        return gcode_writer->getTotalPrintTimePerFeature();
     }
 
     /*!
@@ -100,7 +117,7 @@ public:
      */
     void finalize()
     {
-        gcode_writer.finalize();
+        gcode_writer->finalize();
     }
 };
 
@@ -0,0 +1,293 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For rename, remove and snprintf.
+#include <memory> //For unique_ptr.
+#include <vector>
+
+#include "Application.h"
+#include "GCodeCheckpoints.h"
+#include "GCodeStitcher.h"
+#include "gcodeExport.h"
+#include "Scene.h"
+#include "communication/Communication.h"
+#include "utils/BinaryBuffer.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * \brief FNV-1a hash of some data.
+ */
+uint64_t hashData(const std::string& data, uint64_t hash = 14695981039346656037ull)
+{
+    for (const char byte : data)
+    {
+        hash = (hash ^ static_cast<unsigned char>(byte)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/*!
+ * \brief Hash of everything that the g-code depends on: the engine version,
+ * the settings and the meshes.
+ */
+uint64_t hashInputs(const Scene& scene)
+{
+    BinaryWriter writer;
+    writer.writeString(VERSION);
+    scene.settings.serialise(writer);
+    for (const ExtruderTrain& extruder : scene.extruders)
+    {
+        extruder.settings.serialise(writer);
+    }
+    uint64_t hash = 0;
+    for (const MeshGroup& mesh_group : scene.mesh_groups)
+    {
+        mesh_group.settings.serialise(writer);
+        for (const Mesh& mesh : mesh_group.meshes)
+        {
+            mesh.settings.serialise(writer);
+            writer.writeUnsigned(mesh.vertices.size());
+            for (const MeshVertex& vertex : mesh.vertices)
+            {
+                writer.writeSigned(vertex.p.x);
+                writer.writeSigned(vertex.p.y);
+                writer.writeSigned(vertex.p.z);
+            }
+            writer.writeUnsigned(mesh.faces.size());
+            for (const MeshFace& face : mesh.faces)
+            {
+                writer.writeUnsigned(face.vertex_index[0]);
+                writer.writeUnsigned(face.vertex_index[1]);
+                writer.writeUnsigned(face.vertex_index[2]);
+            }
+            //Hash each mesh separately, so that the serialised meshes don't all have to be in memory at once.
+            hash = hashData(writer.getData(), hash);
+            writer = BinaryWriter();
+        }
+    }
+    return hashData(writer.getData(), hash);
+}
+
+/*!
+ * \brief Whether a file exists and can be read.
+ */
+bool fileExists(const std::string& filename)
+{
+    return std::ifstream(filename).good();
+}
+
+} //Anonymous namespace.
+
+GCodeCheckpoints::GCodeCheckpoints()
+: enabled(false)
+, layers_per_chunk(0)
+, inputs_hash(0)
+, resume_layer_nr(0)
+, complete(false)
+, output(nullptr)
+, chunk_first_layer_nr(0)
+{
+}
+
+GCodeCheckpoints::~GCodeCheckpoints()
+{
+}
+
+bool GCodeCheckpoints::begin(const Scene& scene)
+{
+    enabled = false;
+    complete = false;
+    resume_layer_nr = 0;
+    output = nullptr;
+
+    //These are engine-only settings which front-ends normally don't send, so they're optional.
+    const Settings& settings = scene.settings;
+    directory = settings.has("gcode_checkpoint_directory") ? settings.get<std::string>("gcode_checkpoint_directory") : "";
+    if (directory.empty())
+    {
+        return false;
+    }
+    layers_per_chunk = settings.has("gcode_checkpoint_interval") ? settings.get<size_t>("gcode_checkpoint_interval") : 100;
+    if (layers_per_chunk <= 0)
+    {
+        logWarning("The checkpoints must be at least one layer apart. Not writing checkpoints.\n");
+        return false;
+    }
+    if (scene.mesh_groups.size() > 1 || scene.mesh_groups.front().settings.get<bool>("wireframe_enabled"))
+    {
+        logWarning("Only prints with a single mesh group and without wireframe printing can have checkpoints. Not writing checkpoints.\n");
+        return false;
+    }
+    if (!Application::getInstance().communication->isSequential()
+        || settings.has("gcode_chunk_start_layer") || settings.has("gcode_chunk_end_layer")
+        || (settings.has("print_estimates_only") && settings.get<bool>("print_estimates_only")))
+    {
+        logWarning("Only complete prints sliced from the command line can have checkpoints. Not writing checkpoints.\n");
+        return false;
+    }
+
+    enabled = true;
+    inputs_hash = hashInputs(scene);
+    //The chunks of an earlier run are kept from the start of the print up to the first one that it didn't finish.
+    while (true)
+    {
+        if (fileExists(getFilename(resume_layer_nr, true)))
+        {
+            complete = true;
+            break;
+        }
+        if (!fileExists(getFilename(resume_layer_nr, false)))
+        {
+            break;
+        }
+        resume_layer_nr += layers_per_chunk;
+    }
+    if (complete)
+    {
+        log("All layers were written before by a slice with the same inputs. Joining them.\n");
+    }
+    else if (resume_layer_nr > 0)
+    {
+        log("Layers up to %d were written before by a slice with the same inputs. Continuing from there.\n", static_cast<int>(resume_layer_nr));
+    }
+    return true;
+}
+
+bool GCodeCheckpoints::isEnabled() const
+{
+    return enabled;
+}
+
+bool GCodeCheckpoints::isComplete() const
+{
+    return complete;
+}
+
+LayerIndex GCodeCheckpoints::getResumeLayer() const
+{
+    return resume_layer_nr;
+}
+
+void GCodeCheckpoints::start(GCodeExport& gcode)
+{
+    std::ostream* first_chunk = beginChunk(resume_layer_nr);
+    if (!first_chunk)
+    {
+        enabled = false; //Just write the print to the output instead.
+        return;
+    }
+    output = gcode.getOutputStream();
+    gcode.setLayerRange(resume_layer_nr, resume_layer_nr + layers_per_chunk - 1);
+    gcode.setOutputStream(first_chunk);
+    gcode.setChunkOutput(layers_per_chunk, [this](const LayerIndex first_layer_nr)
+        {
+            return keepChunk(false) ? beginChunk(first_layer_nr) : nullptr;
+        });
+}
+
+bool GCodeCheckpoints::finish(GCodeExport& gcode)
+{
+    if (output)
+    {
+        gcode.setChunkOutput(0, nullptr);
+        gcode.setOutputStream(output);
+        if (!chunk_file.is_open()) //Writing a chunk failed, after which the layers were only planned.
+        {
+            logError("The checkpoints couldn't be written, so the g-code is incomplete.\n");
+            return false;
+        }
+        if (!keepChunk(true))
+        {
+            return false;
+        }
+    }
+    std::ostream* const target = gcode.getOutputStream();
+
+    //Collect the chunks up to the last one.
+    std::vector<std::string> chunk_filenames;
+    for (LayerIndex first_layer_nr = 0; ; first_layer_nr += layers_per_chunk)
+    {
+        const std::string last_filename = getFilename(first_layer_nr, true);
+        if (fileExists(last_filename))
+        {
+            chunk_filenames.push_back(last_filename);
+            break;
+        }
+        const std::string filename = getFilename(first_layer_nr, false);
+        if (!fileExists(filename))
+        {
+            logError("The checkpoint of layer %d is missing, so the g-code can't be joined.\n", static_cast<int>(first_layer_nr));
+            return false;
+        }
+        chunk_filenames.push_back(filename);
+    }
+    std::vector<std::unique_ptr<std::ifstream>> chunk_files;
+    std::vector<std::istream*> chunks;
+    for (const std::string& filename : chunk_filenames)
+    {
+        chunk_files.emplace_back(new std::ifstream(filename, std::ios_base::binary));
+        chunks.push_back(chunk_files.back().get());
+    }
+    if (!GCodeStitcher::stitch(chunks, *target))
+    {
+        return false;
+    }
+    target->flush();
+
+    chunk_files.clear();
+    for (const std::string& filename : chunk_filenames)
+    {
+        std::remove(filename.c_str());
+    }
+    enabled = false;
+    complete = false;
+    output = nullptr;
+    return true;
+}
+
+std::string GCodeCheckpoints::getFilename(const LayerIndex first_layer_nr, const bool is_last) const
+{
+    char hash_string[17];
+    snprintf(hash_string, sizeof(hash_string), "%016llx", static_cast<unsigned long long>(inputs_hash));
+    return directory + "/" + hash_string + "-" + std::to_string(first_layer_nr) + (is_last ? "-last" : "") + ".gcode";
+}
+
+bool GCodeCheckpoints::keepChunk(const bool is_last)
+{
+    const std::string temporary_filename = getFilename(chunk_first_layer_nr, false) + ".tmp";
+    chunk_file.close();
+    if (chunk_file.fail())
+    {
+        logError("Couldn't write checkpoint file %s.\n", temporary_filename.c_str());
+        return false;
+    }
+    //Only complete chunks get their final name, so that a chunk that was being written when the engine stopped is written again.
+    if (std::rename(temporary_filename.c_str(), getFilename(chunk_first_layer_nr, is_last).c_str()) != 0)
+    {
+        logError("Couldn't keep checkpoint file %s.\n", temporary_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::ostream* GCodeCheckpoints::beginChunk(const LayerIndex first_layer_nr)
+{
+    chunk_first_layer_nr = first_layer_nr;
+    const std::string temporary_filename = getFilename(first_layer_nr, false) + ".tmp";
+    chunk_file.clear();
+    chunk_file.open(temporary_filename, std::ios_base::binary | std::ios_base::trunc);
+    if (!chunk_file.is_open())
+    {
+        logError("Couldn't create checkpoint file %s.\n", temporary_filename.c_str());
+        return nullptr;
+    }
+    return &chunk_file;
+}
+
+} //namespace cura
@@ -0,0 +1,138 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef GCODE_CHECKPOINTS_H
+#define GCODE_CHECKPOINTS_H
+
+#include <cstdint> //For uint64_t.
+#include <fstream>
+#include <string>
+
+#include "settings/types/LayerIndex.h"
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+class GCodeExport;
+class Scene;
+
+/*!
+ * \brief Keeps the g-code of the finished layers of a slice on disk, so that
+ * a slice that was stopped halfway, e.g. because its machine was taken away,
+ * can continue where it was when it's started again with the same inputs.
+ *
+ * The g-code is written in chunks of a fixed number of layers, each to a file
+ * of its own in the directory of the scene setting
+ * gcode_checkpoint_directory. A chunk file only gets its final name once its
+ * last layer and the summary of its estimates are written, so files with that
+ * name are always complete. When all layers are written, the chunks are joined
+ * into the actual output by \ref GCodeStitcher and the files are removed.
+ *
+ * A run with the same meshes, settings and engine version finds the chunks of
+ * the earlier run by the hash of those inputs. All geometry is computed again,
+ * since the layers look at each other, but the g-code of the layers that were
+ * written before is only planned as far as needed to know the state of the
+ * printer at the first layer that wasn't written. If all chunks were written,
+ * nothing is computed and the chunks are only joined. The sliced layers can be
+ * kept between the runs as well, with the scene setting
+ * slicing_cache_directory.
+ *
+ * This only works for command line slices of a single mesh group that write a
+ * complete print, see \ref GCodeCheckpoints::begin.
+ */
+class GCodeCheckpoints : NoCopy
+{
+public:
+    GCodeCheckpoints();
+
+    ~GCodeCheckpoints();
+
+    /*!
+     * \brief Look for the chunks that an earlier run with the same inputs
+     * wrote, if checkpoints are enabled for this slice.
+     *
+     * This must be called before the meshes are sliced, since their vertices
+     * and faces are part of the inputs, and those are dropped after slicing.
+     * \param scene The scene to slice.
+     * \return Whether checkpoints are written for this slice.
+     */
+    bool begin(const Scene& scene);
+
+    /*!
+     * \brief Whether checkpoints are written for this slice.
+     */
+    bool isEnabled() const;
+
+    /*!
+     * \brief Whether an earlier run wrote all layers already, so that the
+     * chunks only have to be joined.
+     */
+    bool isComplete() const;
+
+    /*!
+     * \brief The first layer that no earlier run wrote.
+     */
+    LayerIndex getResumeLayer() const;
+
+    /*!
+     * \brief Write the g-code from the first layer that no earlier run wrote
+     * to chunk files, instead of to the output.
+     *
+     * This must be called at the start of the g-code, after the estimates are
+     * reset, just like \ref GCodeExport::setLayerRange.
+     * \param gcode The g-code to write to chunk files.
+     */
+    void start(GCodeExport& gcode);
+
+    /*!
+     * \brief Join all chunks into the output and remove their files, after the
+     * whole print was written.
+     *
+     * If the g-code was written to chunk files in this run, it's written to the
+     * output again afterwards.
+     * \param gcode The g-code that was written to chunk files.
+     * \return Whether the chunks could be joined. If not, an error was logged
+     * and the chunk files are kept.
+     */
+    bool finish(GCodeExport& gcode);
+
+private:
+    /*!
+     * \brief Get the file of the chunk that starts at a layer.
+     * \param first_layer_nr The first layer of the chunk.
+     * \param is_last Whether the chunk is the last one of the print.
+     */
+    std::string getFilename(const LayerIndex first_layer_nr, const bool is_last) const;
+
+    /*!
+     * \brief Give the file of the chunk being written its final name.
+     * \param is_last Whether the chunk is the last one of the print.
+     * \return Whether the chunk was written completely.
+     */
+    bool keepChunk(const bool is_last);
+
+    /*!
+     * \brief Start writing the chunk that starts at a layer.
+     *
+     * The chunk before it must be complete, with its summary.
+     * \param first_layer_nr The first layer of the chunk.
+     * \return The stream to write the chunk to, or nullptr if its file
+     * couldn't be created.
+     */
+    std::ostream* beginChunk(const LayerIndex first_layer_nr);
+
+    bool enabled; //!< Whether checkpoints are written for this slice.
+    std::string directory; //!< The directory to keep the chunk files in.
+    LayerIndex layers_per_chunk; //!< The number of layers of each chunk.
+    uint64_t inputs_hash; //!< Hash of the meshes, the settings and the engine version, to recognise the chunks of an earlier run with the same inputs.
+    LayerIndex resume_layer_nr; //!< The first layer that no earlier run wrote.
+    bool complete; //!< Whether an earlier run wrote all layers.
+    std::ostream* output; //!< Where the g-code goes once the chunks are joined, or nullptr if nothing was written to chunk files.
+    std::ofstream chunk_file; //!< The file of the chunk being written.
+    LayerIndex chunk_first_layer_nr; //!< The first layer of the chunk being written.
+};
+
+} //namespace cura
+
+#endif //GCODE_CHECKPOINTS_H
@@ -0,0 +1,291 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For min and max.
+#include <cstdio> //For sscanf.
+#include <cstdlib> //For atof.
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "GCodeStitcher.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+GCodeStitcher::ChunkSummary::ChunkSummary()
+: has_start(false)
+, first_layer_nr(0)
+, start_extruder_nr(0)
+, has_end(false)
+, last_layer_nr(0)
+, end_extruder_nr(0)
+, time(0.0)
+, min(std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max(), std::numeric_limits<coord_t>::max())
+, max(std::numeric_limits<coord_t>::min(), std::numeric_limits<coord_t>::min(), std::numeric_limits<coord_t>::min())
+{
+}
+
+bool GCodeStitcher::stitch(const std::vector<std::istream*>& chunks, std::ostream& output)
+{
+    if (chunks.empty())
+    {
+        logError("There are no chunks to stitch.\n");
+        return false;
+    }
+
+    //First read the summaries, to check that the chunks fit together and to make the header.
+    std::vector<ChunkSummary> summaries(chunks.size());
+    ChunkSummary total;
+    for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+    {
+        ChunkSummary& summary = summaries[chunk_idx];
+        readSummary(*chunks[chunk_idx], summary);
+        if (!summary.has_end)
+        {
+            logError("Chunk %zu has no summary at its end. Was it sliced as a chunk of layers, and completely?\n", chunk_idx);
+            return false;
+        }
+        if (chunk_idx == 0 && summary.has_start)
+        {
+            logError("The first chunk starts at layer %d rather than at the start of the print.\n", summary.first_layer_nr);
+            return false;
+        }
+        if (chunk_idx > 0)
+        {
+            const ChunkSummary& previous = summaries[chunk_idx - 1];
+            if (!summary.has_start || summary.first_layer_nr != previous.last_layer_nr + 1)
+            {
+                logError("Chunk %zu doesn't start at layer %d, right after the chunk before it.\n", chunk_idx, previous.last_layer_nr + 1);
+                return false;
+            }
+            if (summary.start_extruder_nr != previous.end_extruder_nr)
+            {
+                logWarning("Chunk %zu starts with extruder %d, but the chunk before it ends with extruder %d.\n", chunk_idx, summary.start_extruder_nr, previous.end_extruder_nr);
+            }
+        }
+
+        total.time += summary.time;
+        total.volumes.resize(std::max(total.volumes.size(), summary.volumes.size()), 0.0);
+        total.lengths.resize(std::max(total.lengths.size(), summary.lengths.size()), 0.0);
+        for (size_t extruder_nr = 0; extruder_nr < summary.volumes.size(); extruder_nr++)
+        {
+            total.volumes[extruder_nr] += summary.volumes[extruder_nr];
+        }
+        for (size_t extruder_nr = 0; extruder_nr < summary.lengths.size(); extruder_nr++)
+        {
+            total.lengths[extruder_nr] += summary.lengths[extruder_nr];
+        }
+        total.min = Point3(std::min(total.min.x, summary.min.x), std::min(total.min.y, summary.min.y), std::min(total.min.z, summary.min.z));
+        total.max = Point3(std::max(total.max.x, summary.max.x), std::max(total.max.y, summary.max.y), std::max(total.max.z, summary.max.z));
+    }
+
+    //Then copy the chunks, leaving out the summaries.
+    const std::string chunk_prefix = ";CHUNK.";
+    const std::string time_prefix = ";TIME_ELAPSED:";
+    const std::string layer_prefix = ";LAYER:";
+    double time_offset = 0.0;
+    for (size_t chunk_idx = 0; chunk_idx < chunks.size(); chunk_idx++)
+    {
+        std::istream& chunk = *chunks[chunk_idx];
+        chunk.clear();
+        chunk.seekg(0);
+        bool in_header = chunk_idx == 0;
+        bool has_print_time = false; //Whether the Griffin header has the print time.
+        int initial_temperature_extruder_nr = -1; //The extruder whose initial temperature was the previous line of the Griffin header.
+        std::string line;
+        while (std::getline(chunk, line))
+        {
+            std::string line_ending = "\n";
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+                line_ending = "\r\n";
+            }
+
+            if (line.compare(0, chunk_prefix.size(), chunk_prefix) == 0)
+            {
+                continue;
+            }
+            if (line.compare(0, layer_prefix.size(), layer_prefix) == 0)
+            {
+                in_header = false;
+            }
+            if (line.compare(0, time_prefix.size(), time_prefix) == 0)
+            {
+                std::ostringstream time_line;
+                time_line << std::fixed << time_prefix << (std::atof(line.c_str() + time_prefix.size()) + time_offset);
+                line = time_line.str();
+            }
+            else if (in_header)
+            {
+                //A Griffin header that wasn't rewritten with the estimates at the end of its chunk lacks them, so add them.
+                int extruder_nr;
+                if (initial_temperature_extruder_nr >= 0 && line.compare(0, 16, ";EXTRUDER_TRAIN.") == 0 && line.find(".MATERIAL.VOLUME_USED:") == std::string::npos)
+                {
+                    output << rewriteHeaderLine(";EXTRUDER_TRAIN." + std::to_string(initial_temperature_extruder_nr) + ".MATERIAL.VOLUME_USED:", total) << line_ending;
+                }
+                initial_temperature_extruder_nr = -1;
+                if (std::sscanf(line.c_str(), ";EXTRUDER_TRAIN.%d.INITIAL_TEMPERATURE:", &extruder_nr) == 1 && line.find(".INITIAL_TEMPERATURE:") != std::string::npos)
+                {
+                    initial_temperature_extruder_nr = extruder_nr;
+                }
+                has_print_time = has_print_time || line.compare(0, 12, ";PRINT.TIME:") == 0;
+                if (!has_print_time && line.compare(0, 14, ";PRINT.GROUPS:") == 0)
+                {
+                    output << rewriteHeaderLine(";PRINT.TIME:", total) << line_ending;
+                    has_print_time = true;
+                }
+                line = rewriteHeaderLine(line, total);
+            }
+            output << line << line_ending;
+        }
+        time_offset += summaries[chunk_idx].time;
+    }
+    output.flush();
+    return true;
+}
+
+bool GCodeStitcher::stitch(const std::vector<std::string>& chunk_files, const std::string& output_file)
+{
+    std::vector<std::ifstream> chunk_streams(chunk_files.size());
+    std::vector<std::istream*> chunks;
+    for (size_t chunk_idx = 0; chunk_idx < chunk_files.size(); chunk_idx++)
+    {
+        chunk_streams[chunk_idx].open(chunk_files[chunk_idx], std::ios::binary);
+        if (!chunk_streams[chunk_idx].is_open())
+        {
+            logError("Couldn't open the chunk %s.\n", chunk_files[chunk_idx].c_str());
+            return false;
+        }
+        chunks.push_back(&chunk_streams[chunk_idx]);
+    }
+    std::ofstream output(output_file, std::ios::binary);
+    if (!output.is_open())
+    {
+        logError("Couldn't open %s for writing.\n", output_file.c_str());
+        return false;
+    }
+    return stitch(chunks, output);
+}
+
+void GCodeStitcher::readSummary(std::istream& chunk, ChunkSummary& summary)
+{
+    std::string line;
+    while (std::getline(chunk, line))
+    {
+        if (line.compare(0, 7, ";CHUNK.") != 0)
+        {
+            continue;
+        }
+        int extruder_nr;
+        double value;
+        long long x, y, z;
+        if (std::sscanf(line.c_str(), ";CHUNK.START:%d", &summary.first_layer_nr) == 1)
+        {
+            summary.has_start = true;
+            summary.has_end = false; //The extruder line that follows belongs to the start.
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.END:%d", &summary.last_layer_nr) == 1)
+        {
+            summary.has_end = true;
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.EXTRUDER:%d", &extruder_nr) == 1)
+        {
+            (summary.has_end ? summary.end_extruder_nr : summary.start_extruder_nr) = extruder_nr;
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.TIME:%lf", &value) == 1)
+        {
+            summary.time = value;
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.VOLUME.%d:%lf", &extruder_nr, &value) == 2 && extruder_nr >= 0)
+        {
+            summary.volumes.resize(std::max(summary.volumes.size(), size_t(extruder_nr + 1)), 0.0);
+            summary.volumes[extruder_nr] = value;
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.LENGTH.%d:%lf", &extruder_nr, &value) == 2 && extruder_nr >= 0)
+        {
+            summary.lengths.resize(std::max(summary.lengths.size(), size_t(extruder_nr + 1)), 0.0);
+            summary.lengths[extruder_nr] = value;
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.MIN:%lld,%lld,%lld", &x, &y, &z) == 3)
+        {
+            summary.min = Point3(x, y, z);
+        }
+        else if (std::sscanf(line.c_str(), ";CHUNK.MAX:%lld,%lld,%lld", &x, &y, &z) == 3)
+        {
+            summary.max = Point3(x, y, z);
+        }
+    }
+}
+
+std::string GCodeStitcher::rewriteHeaderLine(const std::string& line, const ChunkSummary& total)
+{
+    const size_t colon_pos = line.find(':');
+    if (line.empty() || line[0] != ';' || colon_pos == std::string::npos)
+    {
+        return line;
+    }
+    const std::string key = line.substr(0, colon_pos + 1);
+    std::ostringstream value;
+    int extruder_nr;
+    if (key == ";TIME:" || key == ";PRINT.TIME:")
+    {
+        value << static_cast<int>(total.time);
+    }
+    else if (key == ";MATERIAL:" || key == ";MATERIAL2:")
+    {
+        const size_t index = (key == ";MATERIAL:") ? 0 : 1;
+        value << static_cast<int>((index < total.volumes.size()) ? total.volumes[index] : 0.0);
+    }
+    else if (std::sscanf(key.c_str(), ";EXTRUDER_TRAIN.%d.MATERIAL.VOLUME_USED:", &extruder_nr) == 1 && key.find("VOLUME_USED") != std::string::npos)
+    {
+        value << static_cast<int>((extruder_nr >= 0 && size_t(extruder_nr) < total.volumes.size()) ? total.volumes[extruder_nr] : 0.0);
+    }
+    else if (key == ";Filament used:")
+    {
+        const bool volumetric = line.find("mm3") != std::string::npos;
+        const std::vector<double>& amounts = volumetric ? total.volumes : total.lengths;
+        value << " ";
+        for (size_t index = 0; index < amounts.size(); index++)
+        {
+            value << ((index > 0) ? ", " : "") << amounts[index] << (volumetric ? "mm3" : "m");
+        }
+    }
+    else if (total.min.x > total.max.x) //No moves at all, so keep the bounding box of the header.
+    {
+        return line;
+    }
+    else if (key == ";MINX:" || key == ";PRINT.SIZE.MIN.X:")
+    {
+        value << INT2MM(total.min.x);
+    }
+    else if (key == ";MINY:" || key == ";PRINT.SIZE.MIN.Y:")
+    {
+        value << INT2MM(total.min.y);
+    }
+    else if (key == ";MINZ:" || key == ";PRINT.SIZE.MIN.Z:")
+    {
+        value << INT2MM(total.min.z);
+    }
+    else if (key == ";MAXX:" || key == ";PRINT.SIZE.MAX.X:")
+    {
+        value << INT2MM(total.max.x);
+    }
+    else if (key == ";MAXY:" || key == ";PRINT.SIZE.MAX.Y:")
+    {
+        value << INT2MM(total.max.y);
+    }
+    else if (key == ";MAXZ:" || key == ";PRINT.SIZE.MAX.Z:")
+    {
+        value << INT2MM(total.max.z);
+    }
+    else
+    {
+        return line;
+    }
+    return key + value.str();
+}
+
+} //namespace cura
@@ -0,0 +1,92 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef GCODE_STITCHER_H
+#define GCODE_STITCHER_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils/Point3.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Joins the chunks of g-code that several processes wrote for the
+ * layers of one print into the g-code of the whole print.
+ *
+ * Each chunk is sliced with the settings gcode_chunk_start_layer and
+ * gcode_chunk_end_layer, see \ref GCodeExport::setLayerRange. The first chunk
+ * has the header and the start code, the last one the end code. Every chunk
+ * ends with a summary of its estimates, from which the header of the whole
+ * print is made. The time comments of each chunk count from the start of the
+ * chunk, so the time of the chunks before it is added to them.
+ *
+ * This is what "CuraEngine stitch" does.
+ */
+class GCodeStitcher
+{
+public:
+    /*!
+     * \brief Join chunks of g-code into the g-code of the whole print.
+     * \param chunks The chunks, in the order of their layers. They are read
+     * twice, so they must be able to seek back to the start.
+     * \param output The stream to write the print to.
+     * \return Whether the chunks could be joined. If not, an error was logged
+     * and nothing was written.
+     */
+    static bool stitch(const std::vector<std::istream*>& chunks, std::ostream& output);
+
+    /*!
+     * \brief Join the chunks of g-code in some files into one file.
+     * \param chunk_files The files of the chunks, in the order of their layers.
+     * \param output_file The file to write the print to.
+     * \return Whether the chunks could be joined.
+     */
+    static bool stitch(const std::vector<std::string>& chunk_files, const std::string& output_file);
+
+private:
+    /*!
+     * \brief What the summary at the end of a chunk says, see
+     * \ref GCodeExport::writeChunkEnd.
+     */
+    struct ChunkSummary
+    {
+        ChunkSummary();
+
+        bool has_start; //!< Whether the chunk continues after an earlier chunk, rather than starting the print.
+        int first_layer_nr; //!< If the chunk continues after an earlier chunk, the first layer of the chunk.
+        int start_extruder_nr; //!< If the chunk continues after an earlier chunk, the extruder that the chunk starts with.
+        bool has_end; //!< Whether the summary was found.
+        int last_layer_nr; //!< The last layer of the chunk.
+        int end_extruder_nr; //!< The extruder that the chunk ends with.
+        double time; //!< The estimated print time of the chunk, in seconds.
+        std::vector<double> volumes; //!< For each extruder the material that the chunk uses, in mm^3.
+        std::vector<double> lengths; //!< For each extruder the filament that the chunk uses, in meters.
+        Point3 min; //!< The lowest coordinates of the moves, in microns.
+        Point3 max; //!< The highest coordinates of the moves, in microns.
+    };
+
+    /*!
+     * \brief Read the summary of a chunk.
+     * \param chunk The chunk to read. Afterwards it is at its end.
+     * \param[out] summary The summary.
+     */
+    static void readSummary(std::istream& chunk, ChunkSummary& summary);
+
+    /*!
+     * \brief Replace the estimates in a line of the header of the first chunk
+     * with those of the whole print.
+     * \param line The line of the header, without its line ending.
+     * \param total The summary of the whole print.
+     * \return The line to write instead.
+     */
+    static std::string rewriteHeaderLine(const std::string& line, const ChunkSummary& total);
+};
+
+} //namespace cura
+
+#endif //GCODE_STITCHER_H
@@ -2,14 +2,15 @@
 #ifndef GCODE_LAYER_THREADER_H
 #define GCODE_LAYER_THREADER_H
 
-#include <queue> // priority_queue
+#include <algorithm> // max
+#include <cassert>
 #include <functional> // function
-#include <thread> // sleep
-#include <chrono> // milliseconds
+#include <mutex>
+#include <vector>
 
-#include "utils/logoutput.h"
-#include "utils/optional.h"
-#include "utils/Lock.h"
+#include "utils/Instrumentation.h"
+#include "utils/MemoryBudget.h"
+#include "utils/TaskScheduler.h"
 
 namespace cura
 {
@@ -18,14 +19,15 @@ namespace cura
  * Producer Consumer construct for when:
  * - production can occur in parallel
  * - consumption must be ordered and not multithreaded
- * 
+ *
  * A layer_nr index is passed to the item producer in order to produce the different items.
- * 
- * Each thread does production and consumption, giving priority to consumption if some is available.
- * 
+ *
+ * Each item is produced as a task on a \ref TaskScheduler. Whichever thread
+ * produces the item that is next in line to be consumed also consumes it,
+ * followed by any items after it that are ready by then. Meanwhile the other
+ * threads keep producing, so consumption never waits for a polling interval.
+ *
  * If there is only one thread, it consumes every time it has produced one item.
- * 
- * \warning This class is only adequate when the expected production time of an item is more than (n_threads - 1) times as much as the expected consumption time of an item
  */
 template <typename T>
 class GcodeLayerThreader
@@ -36,7 +38,7 @@ public:
      * \param end_item_argument_index The last value with which to produce an item
      * \param produce_item The function with which to produce an item
      * \param consume_item The function with which to consume an item
-     * \param max_task_count The maximum number of items (being) produced without having been consumed
+     * \param max_task_count The maximum number of items (being) produced without having been consumed, or 0 to allow \ref GcodeLayerThreader::default_tasks_per_thread items for every thread
      */
     GcodeLayerThreader(
         int start_item_argument_index,
@@ -46,59 +48,106 @@ public:
         const unsigned int max_task_count
     );
 
+    /*!
+     * Limit the number of items (being) produced without having been consumed
+     * by how much memory they take.
+     *
+     * The number of active items is then at most \p memory_limit divided by
+     * the size of the largest item that was produced so far, but at least one.
+     * Until the first item is produced, one item per thread is started.
+     *
+     * \param memory_limit The maximum number of bytes that the active items should take
+     * \param item_memory The function with which to get the number of bytes that an item takes
+     */
+    void setMemoryLimit(const size_t memory_limit, const std::function<size_t (const T*)>& item_memory);
+
+    /*!
+     * Stop producing items early when they aren't wanted anymore.
+     *
+     * Once \p is_cancelled returns true, no more items are started. The items
+     * which are being produced by then are still consumed, in order, so that
+     * none of them is left over.
+     *
+     * \param is_cancelled The function which tells whether to stop. It is
+     * called before starting items, from several threads.
+     */
+    void setCancelCheck(const std::function<bool ()>& is_cancelled);
+
+    /*!
+     * Get the number of threads that produce items.
+     */
+    size_t getThreadCount() const;
+
+    /*!
+     * Get the scheduler that executes the production of the items.
+     *
+     * Consuming an item may schedule tasks on it, for the threads that have
+     * no items to produce.
+     */
+    TaskScheduler& getScheduler();
+
     /*!
      * Produce all items and consume them.
      */
     void run();
 private:
     /*!
-     * Produce an item and put it in \ref GcodeLayerThreader::produced
-     * 
-     * \param item_argument_index The parameter with which to call \ref GcodeLayerThreader::produce_item
+     * Produce an item and put it in \ref GcodeLayerThreader::produced.
+     *
+     * If it is the next item to be consumed and no other thread is consuming,
+     * consume it and whatever is ready after it.
+     *
+     * \param item_idx The index into \ref GcodeLayerThreader::produced
      */
-    void produce(int item_argument_index);
+    void produce(int item_idx);
 
     /*!
-     * Consume an item from \ref GcodeLayerThreader::produced
-     * 
-     * \param item_idx The index into \ref GcodeLayerThreader::produced
+     * Consume items in order for as long as the next one has been produced.
+     *
+     * Only one thread at a time may call this, which is tracked by
+     * \ref GcodeLayerThreader::consuming.
      */
-    void consume(int item_idx);
+    void consumeReady();
 
     /*!
-     * Consume if possible, otherwise
-     * Produce if possible, otherwise
-     * wait half a second
+     * Get the maximum number of active items, given the memory limit (if any) and the items produced so far.
+     * While the memory budget is exceeded, only one item at a time is active.
+     *
+     * Must be called while holding \ref GcodeLayerThreader::mutex.
      */
-    void act();
+    int getMaxActiveCount() const;
 
     /*!
-     * Check whether no tasks are left for a thread to pick up
+     * Schedule the production of the next items, as far as the maximum number of active items allows.
+     *
+     * Must be called while holding \ref GcodeLayerThreader::mutex.
      */
-    bool finished();
+    void scheduleProduction();
 
 private:
+    static constexpr int default_tasks_per_thread = 4; //!< The maximum number of active items per thread if no maximum is given. Enough to keep every thread busy while one thread consumes.
+
     // algorithm parameters
     const int start_item_argument_index; //!< The first index with which \ref GcodeLayerThreader::produce_item will be called
-    const int end_item_argument_index; //!< The end index with which \ref GcodeLayerThreader::produce_item will not be called any more
-    const unsigned int item_count; //!< The number of items to produce and consume
+    const int item_count; //!< The number of items to produce and consume
 
-    const int max_task_count; //!< The maximum amount of items active in the system
+    int max_task_count; //!< The maximum amount of items active in the system
 
     const std::function<T* (int)>& produce_item; //!< The function to produce an item
     const std::function<void (T*)>& consume_item; //!< The function to consume an item
 
+    size_t memory_limit = 0; //!< The maximum number of bytes for all active items together, or 0 if unlimited
+    std::function<size_t (const T*)> item_memory; //!< The function to get the number of bytes that an item takes
+    std::function<bool ()> is_cancelled; //!< The function to tell whether to stop starting items, if any
+
     // variables which change throughout the computation of the algorithm
+    TaskScheduler scheduler; //!< Executes the production of the items
+    std::mutex mutex; //!< Protects the variables below
     std::vector<T*> produced; //!< ordered list for every item to be produced; contains pointers to produced items which aren't consumed yet; rest is nullptr
-    int last_produced_argument_index; //!< Counter to see which item next to produce
-
-    std::optional<int> to_be_consumed_item_idx; //!< The index into \ref GcodeLayerThreader::produced where to find the next item ready to be consumed (if any)
-    Lock consume_lock; //!< Lock to make sure no two threads consume at the same time
-    int last_consumed_idx = -1; //!< The index into \ref GcodeLayerThreader::produced for the last item consumed
-
-    // statistics
-    int active_task_count = 0; //!< Number of items active in this system.
-
+    int next_produced_idx = 0; //!< The index into \ref GcodeLayerThreader::produced of the next item to schedule for production
+    int next_consumed_idx = 0; //!< The index into \ref GcodeLayerThreader::produced of the next item to consume
+    bool consuming = false; //!< Whether some thread is currently consuming items
+    size_t largest_item_memory = 0; //!< The number of bytes of the largest item produced so far, if there is a memory limit
 };
 
 template <typename T>
@@ -110,124 +159,130 @@ GcodeLayerThreader<T>::GcodeLayerThreader(
     const unsigned int max_task_count
 )
 : start_item_argument_index(start_item_argument_index)
-, end_item_argument_index(end_item_argument_index)
-, item_count(end_item_argument_index - start_item_argument_index)
+, item_count(std::max(0, end_item_argument_index - start_item_argument_index))
 , max_task_count(max_task_count)
 , produce_item(produce_item)
 , consume_item(consume_item)
-, last_produced_argument_index(start_item_argument_index - 1)
 {
+    if (this->max_task_count == 0)
+    {
+        this->max_task_count = default_tasks_per_thread * scheduler.getThreadCount();
+    }
     produced.resize(item_count, nullptr);
 }
 
+template <typename T>
+void GcodeLayerThreader<T>::setMemoryLimit(const size_t memory_limit, const std::function<size_t (const T*)>& item_memory)
+{
+    this->memory_limit = memory_limit;
+    this->item_memory = item_memory;
+}
+
+template <typename T>
+void GcodeLayerThreader<T>::setCancelCheck(const std::function<bool ()>& is_cancelled)
+{
+    this->is_cancelled = is_cancelled;
+}
+
+template <typename T>
+size_t GcodeLayerThreader<T>::getThreadCount() const
+{
+    return scheduler.getThreadCount();
+}
+
+template <typename T>
+TaskScheduler& GcodeLayerThreader<T>::getScheduler()
+{
+    return scheduler;
+}
+
 template <typename T>
 void GcodeLayerThreader<T>::run()
 {
-    #pragma omp parallel
+    const ScopedTimer timer("layer_threader");
     {
-#ifdef _OPENMP
-        #pragma omp master
-        log("Multithreading GcodeLayerThreader with %i threads.\n", omp_get_num_threads());
-#endif // _OPENMP
-        while (true)
-        {
-            if (finished())
-            {
-                break;
-            }
-            act();
-        }
+        std::lock_guard<std::mutex> lock(mutex);
+        scheduleProduction();
     }
+    scheduler.run();
+    assert((next_consumed_idx == next_produced_idx && (next_consumed_idx == item_count || is_cancelled)) && "All items must have been consumed.");
 }
 
 template <typename T>
-void GcodeLayerThreader<T>::produce(int item_argument_index)
+void GcodeLayerThreader<T>::produce(int item_idx)
 {
-    T* produced_item = produce_item(item_argument_index);
-    int item_idx = item_argument_index - start_item_argument_index;
-    #pragma omp critical
+    T* produced_item = produce_item(start_item_argument_index + item_idx);
+    const size_t produced_item_memory = memory_limit ? item_memory(produced_item) : 0;
     {
+        std::lock_guard<std::mutex> lock(mutex);
         produced[item_idx] = produced_item;
-        if (item_idx == last_consumed_idx + 1 && item_idx < end_item_argument_index - start_item_argument_index)
+        largest_item_memory = std::max(largest_item_memory, produced_item_memory);
+        if (consuming || item_idx != next_consumed_idx)
         {
-            assert(!to_be_consumed_item_idx && "the just produced item shouldn't be consumable already!");
-            to_be_consumed_item_idx = item_idx;
+            return; // some other thread will consume it once it's this item's turn
         }
+        consuming = true;
     }
+    consumeReady();
 }
 
 template <typename T>
-void GcodeLayerThreader<T>::consume(int item_idx)
+void GcodeLayerThreader<T>::consumeReady()
 {
-    consume_item(produced[item_idx]);
-    produced[item_idx] = nullptr;
-    #pragma omp critical
+    while (true)
     {
-        assert(item_idx == last_consumed_idx + 1);
-        last_consumed_idx = item_idx;
-        if (last_consumed_idx + 1 < end_item_argument_index - start_item_argument_index && produced[last_consumed_idx + 1])
+        T* item;
+        int item_idx;
         {
-            assert(!to_be_consumed_item_idx && "The next produced item shouldn't already be noted as being consumable because of the lock!");
-            to_be_consumed_item_idx = last_consumed_idx + 1;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next_consumed_idx >= item_count || !produced[next_consumed_idx])
+            {
+                consuming = false;
+                return;
+            }
+            item_idx = next_consumed_idx;
+            item = produced[item_idx];
+            produced[item_idx] = nullptr;
+            next_consumed_idx++;
+            scheduleProduction(); // let the other threads start on the next item while this one is being consumed
         }
-        active_task_count--;
-        assert(active_task_count >= 0);
+        const ScopedTimer timer("consume_layer", start_item_argument_index + item_idx);
+        consume_item(item);
     }
 }
 
 template <typename T>
-void GcodeLayerThreader<T>::act()
+int GcodeLayerThreader<T>::getMaxActiveCount() const
 {
+    if (MemoryBudget::getInstance().isExceeded())
     {
-        int item_idx = -1;
-        #pragma omp critical
-        {
-            if (to_be_consumed_item_idx && consume_lock.test_lock())
-            {
-                item_idx = *to_be_consumed_item_idx;
-                to_be_consumed_item_idx = nullptr;
-            }
-        }
-        if (item_idx >= 0)
-        {
-            consume(item_idx);
-            consume_lock.unlock();
-            return;
-        }
+        return 1;
     }
-
+    if (!memory_limit)
     {
-        std::optional<int> item_argument_index;
-        #pragma omp critical
-        {
-            if (active_task_count < max_task_count)
-            {
-                item_argument_index = ++last_produced_argument_index;
-                active_task_count++;
-            }
-        }
-        if (item_argument_index && *item_argument_index < end_item_argument_index)
-        {
-            produce(*item_argument_index);
-            return;
-        }
+        return max_task_count;
     }
-#ifdef _OPENMP
-    // thread is blocked by too many items being processed
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-#endif
+    if (largest_item_memory == 0) // nothing measured yet
+    {
+        return std::min(max_task_count, static_cast<int>(scheduler.getThreadCount()));
+    }
+    const size_t fitting_item_count = memory_limit / largest_item_memory;
+    return std::max(1, static_cast<int>(std::min(fitting_item_count, static_cast<size_t>(max_task_count))));
 }
 
 template <typename T>
-bool GcodeLayerThreader<T>::finished()
+void GcodeLayerThreader<T>::scheduleProduction()
 {
-    bool finished;
-    #pragma omp critical
+    if (is_cancelled && is_cancelled())
+    {
+        return;
+    }
+    const int max_active_count = getMaxActiveCount();
+    while (next_produced_idx < item_count && next_produced_idx - next_consumed_idx < max_active_count)
     {
-        finished = last_produced_argument_index >= end_item_argument_index - 1
-            && !to_be_consumed_item_idx;
+        const int item_idx = next_produced_idx++;
+        scheduler.schedule([this, item_idx]() { produce(item_idx); });
     }
-    return finished;
 }
 
 } // namespace cura
@@ -1,6 +1,8 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <memory> //For unique_ptr.
+
 #include "ExtruderTrain.h"
 #include "FffGcodeWriter.h"
 #include "InsetOrderOptimizer.h"
@@ -11,14 +13,43 @@
 namespace cura
 {
 
-static int findAdjacentEnclosingPoly(const ConstPolygonRef& enclosed_inset, const std::vector<ConstPolygonPointer>& possible_enclosing_polys, const coord_t max_gap)
+bool InsetOrderOptimizer::insetsIntersect(const ConstPolygonPointer& poly_a, const ConstPolygonPointer& poly_b)
+{
+    // only do the full intersection when the polys' BBs overlap
+    if (!inset_aabbs.at(poly_a.operator->()).hit(inset_aabbs.at(poly_b.operator->())))
+    {
+        return false;
+    }
+    const SymmetricPair<const ClipperLib::Path*> key(poly_a.operator->(), poly_b.operator->());
+    std::unordered_map<SymmetricPair<const ClipperLib::Path*>, bool>::const_iterator found = insets_intersect.find(key);
+    if (found == insets_intersect.end())
+    {
+        found = insets_intersect.emplace(key, (*poly_a).intersection(*poly_b).size() > 0).first;
+    }
+    return found->second;
+}
+
+bool InsetOrderOptimizer::insetOutlinesAdjacent(const ConstPolygonPointer& inner_poly, const ConstPolygonPointer& outer_poly, const coord_t max_gap) const
+{
+    AABB inner_aabb = inset_aabbs.at(inner_poly.operator->());
+    inner_aabb.max += Point(max_gap, max_gap);
+    inner_aabb.min -= Point(max_gap, max_gap);
+    if (!inner_aabb.hit(inset_aabbs.at(outer_poly.operator->())))
+    {
+        return false;
+    }
+    return PolygonUtils::polygonOutlinesAdjacent(*inner_poly, *outer_poly, max_gap);
+}
+
+int InsetOrderOptimizer::findAdjacentEnclosingPoly(const ConstPolygonPointer& enclosed_inset, const std::vector<ConstPolygonPointer>& possible_enclosing_polys, const coord_t max_gap)
 {
     // given an inset, search a collection of insets for the adjacent enclosing inset
     for (unsigned int enclosing_poly_idx = 0; enclosing_poly_idx < possible_enclosing_polys.size(); ++enclosing_poly_idx)
     {
-        const ConstPolygonRef& enclosing = *possible_enclosing_polys[enclosing_poly_idx];
+        const ConstPolygonPointer& enclosing = possible_enclosing_polys[enclosing_poly_idx];
         // as holes don't overlap, if the insets intersect, it is safe to assume that the enclosed inset is inside the enclosing inset
-        if (PolygonUtils::polygonsIntersect(enclosing, enclosed_inset) && PolygonUtils::polygonOutlinesAdjacent(enclosed_inset, enclosing, max_gap))
+        // (the adjacency is tested first, as it rules out most insets at a fraction of the cost of the intersection)
+        if (insetOutlinesAdjacent(enclosed_inset, enclosing, max_gap) && insetsIntersect(enclosing, enclosed_inset))
         {
             return enclosing_poly_idx;
         }
@@ -30,11 +61,16 @@ void InsetOrderOptimizer::moveInside()
 {
     const coord_t outer_wall_line_width = mesh_config.inset0_config.getLineWidth();
     Point p = gcode_layer.getLastPlannedPositionOrStartingPosition();
+    if (!inside_outer_wall_computed)
+    {
+        inside_outer_wall = part.insets[0].offset(-outer_wall_line_width);
+        inside_outer_wall_computed = true;
+    }
     // try to move p inside the outer wall by 1.1 times the outer wall line width
     if (PolygonUtils::moveInside(part.insets[0], p, outer_wall_line_width * 1.1f) != NO_INDEX)
     {
         // move to p if it is not closer than a line width from the centre line of the outer wall
-        if (part.insets[0].offset(-outer_wall_line_width).inside(p))
+        if (inside_outer_wall.inside(p))
         {
             gcode_layer.addTravel_simple(p);
             gcode_layer.forceNewPathStart();
@@ -47,7 +83,7 @@ void InsetOrderOptimizer::moveInside()
             if (PolygonUtils::moveInside(part.insets[0], p, outer_wall_line_width * 1.1f) != NO_INDEX)
             {
                 // move to p if it is not closer than a line width from the centre line of the outer wall
-                if (part.insets[0].offset(-outer_wall_line_width).inside(p))
+                if (inside_outer_wall.inside(p))
                 {
                     gcode_layer.addTravel_simple(p);
                     gcode_layer.forceNewPathStart();
@@ -87,24 +123,22 @@ void InsetOrderOptimizer::processHoleInsets()
             Polygons insets_that_do_not_surround_holes;
             for (unsigned inset_idx = 0; inset_idx < inset_polys[0].size() && inset_idx < inset_polys[inset_level].size(); ++inset_idx)
             {
-                const ConstPolygonRef& inner_wall = *inset_polys[inset_level][inset_idx];
-                const ConstPolygonRef& outer_wall = *inset_polys[0][inset_idx];
+                const ConstPolygonPointer& inner_wall = inset_polys[inset_level][inset_idx];
                 // little subtlety here, don't test first inset against inset_polys[0][0] as it will always intersect
-                bool inset_surrounds_hole = inset_idx > 0 && PolygonUtils::polygonsIntersect(inner_wall, outer_wall);
+                bool inset_surrounds_hole = inset_idx > 0 && insetsIntersect(inner_wall, inset_polys[0][inset_idx]);
                 if (!inset_surrounds_hole)
                 {
                     // the inset didn't surround the level 0 inset with the same inset_idx but maybe it surrounds another hole
                     // start this loop at 1 not 0 as everything is surrounded by the part outline!
                     for (unsigned hole_idx = 1; !inset_surrounds_hole && hole_idx < inset_polys[0].size(); ++hole_idx)
                     {
-                        const ConstPolygonRef& outer_wall = *inset_polys[0][hole_idx];
-                        inset_surrounds_hole = PolygonUtils::polygonsIntersect(inner_wall, outer_wall);
+                        inset_surrounds_hole = insetsIntersect(inner_wall, inset_polys[0][hole_idx]);
                     }
                 }
                 if (!inset_surrounds_hole)
                 {
                     // consume this inset
-                    insets_that_do_not_surround_holes.add(inner_wall);
+                    insets_that_do_not_surround_holes.add(*inner_wall);
                     inset_polys[inset_level].erase(inset_polys[inset_level].begin() + inset_idx);
                     --inset_idx; // we've shortened the vector so decrement the index otherwise, we'll skip an element
                 }
@@ -157,13 +191,14 @@ void InsetOrderOptimizer::processHoleInsets()
     // this will consume all of the insets that surround holes but not the insets next to the outermost wall of the model
     for (unsigned int outer_poly_order_idx = 0; outer_poly_order_idx < order_optimizer.polyOrder.size(); ++outer_poly_order_idx)
     {
+        const ConstPolygonPointer& hole_outer_wall_poly = inset_polys[0][order_optimizer.polyOrder[outer_poly_order_idx] + 1]; // +1 because first element (part outer wall) wasn't included
         Polygons hole_outer_wall; // the outermost wall of a hole
-        hole_outer_wall.add(*inset_polys[0][order_optimizer.polyOrder[outer_poly_order_idx] + 1]); // +1 because first element (part outer wall) wasn't included
+        hole_outer_wall.add(*hole_outer_wall_poly);
         std::vector<unsigned int> hole_level_1_wall_indices; // the indices of the walls that touch the hole's outer wall
         if (inset_polys.size() > 1)
         {
             // find the adjacent poly in the level 1 insets that encloses the hole
-            int adjacent_enclosing_poly_idx = findAdjacentEnclosingPoly(hole_outer_wall[0], inset_polys[1], max_gap);
+            int adjacent_enclosing_poly_idx = findAdjacentEnclosingPoly(hole_outer_wall_poly, inset_polys[1], max_gap);
             if (adjacent_enclosing_poly_idx >= 0)
             {
                 // now test for the case where we are printing the outer walls first and this level 1 inset also touches other outer walls
@@ -171,11 +206,10 @@ void InsetOrderOptimizer::processHoleInsets()
                 if (outer_inset_first)
                 {
                     // does the level 1 inset touch more than one outline?
-                    Polygons inset;
-                    inset.add(*inset_polys[1][adjacent_enclosing_poly_idx]);
+                    const ConstPolygonPointer& inset = inset_polys[1][adjacent_enclosing_poly_idx];
                     int num_future_outlines_touched = 0; // number of outlines that have yet to be output that are touched by this level 1 inset
                     // does it touch the outer wall?
-                    if (PolygonUtils::polygonOutlinesAdjacent(inset[0], *inset_polys[0][0], max_gap))
+                    if (insetOutlinesAdjacent(inset, inset_polys[0][0], max_gap))
                     {
                         // yes, the level 1 inset touches the part's outer wall
                         ++num_future_outlines_touched;
@@ -187,8 +221,8 @@ void InsetOrderOptimizer::processHoleInsets()
                         // as we don't know the shape of the outlines (straight, concave, convex, etc.) and the
                         // adjacency test assumes that the poly's are arranged so that the first has smaller
                         // radius curves than the second (it's "inside" the second) we need to test both combinations
-                        if (PolygonUtils::polygonOutlinesAdjacent(inset[0], *inset_polys[0][outline_index], max_gap) ||
-                            PolygonUtils::polygonOutlinesAdjacent(*inset_polys[0][outline_index], inset[0], max_gap))
+                        if (insetOutlinesAdjacent(inset, inset_polys[0][outline_index], max_gap) ||
+                            insetOutlinesAdjacent(inset_polys[0][outline_index], inset, max_gap))
                         {
                             // yes, it touches this yet to be processed hole outline
                             ++num_future_outlines_touched;
@@ -211,7 +245,14 @@ void InsetOrderOptimizer::processHoleInsets()
                 // we didn't find a level 1 inset that encloses this hole so now look to see if there is one or more level 1 insets that simply touch
                 // this hole and use those instead - however, as the level 1 insets will also touch other holes and/or the outer wall we don't want
                 // to do this when printing the outer walls first
-                PolygonUtils::findAdjacentPolygons(hole_level_1_wall_indices, hole_outer_wall[0], inset_polys[1], max_gap);
+                for (unsigned int level_1_wall_idx = 0; level_1_wall_idx < inset_polys[1].size(); ++level_1_wall_idx)
+                {
+                    if (insetOutlinesAdjacent(hole_outer_wall_poly, inset_polys[1][level_1_wall_idx], max_gap) ||
+                        insetOutlinesAdjacent(inset_polys[1][level_1_wall_idx], hole_outer_wall_poly, max_gap))
+                    {
+                        hole_level_1_wall_indices.push_back(level_1_wall_idx);
+                    }
+                }
             }
         }
 
@@ -238,7 +279,7 @@ void InsetOrderOptimizer::processHoleInsets()
             // now find all the insets that immediately surround the level 1 wall and consume them
             for (unsigned int inset_level = 2; inset_level < num_insets && inset_polys[inset_level].size(); ++inset_level)
             {
-                int i = findAdjacentEnclosingPoly(ConstPolygonRef(*last_inset), inset_polys[inset_level], wall_line_width_x * 1.1f);
+                int i = findAdjacentEnclosingPoly(last_inset, inset_polys[inset_level], wall_line_width_x * 1.1f);
                 if (i >= 0)
                 {
                     // we have found an enclosing inset
@@ -247,12 +288,12 @@ void InsetOrderOptimizer::processHoleInsets()
                         // when printing outer insets first we don't want to print this enclosing inset
                         // if it also encloses other holes that haven't yet been processed so check the holes
                         // that haven't yet been processed to see if they are also enclosed by this enclosing inset
-                        const ConstPolygonRef& enclosing_inset = *inset_polys[inset_level][i];
+                        const ConstPolygonPointer& enclosing_inset = inset_polys[inset_level][i];
                         bool encloses_future_hole = false; // set true if this inset also encloses another hole that hasn't yet been processed
                         for (unsigned int hole_order_index = outer_poly_order_idx + 1; !encloses_future_hole && hole_order_index < order_optimizer.polyOrder.size(); ++hole_order_index)
                         {
-                            const ConstPolygonRef& enclosed_inset = *inset_polys[0][order_optimizer.polyOrder[hole_order_index] + 1]; // +1 because first element (part outer wall) wasn't included
-                            encloses_future_hole = PolygonUtils::polygonsIntersect(enclosing_inset, enclosed_inset);
+                            const ConstPolygonPointer& enclosed_inset = inset_polys[0][order_optimizer.polyOrder[hole_order_index] + 1]; // +1 because first element (part outer wall) wasn't included
+                            encloses_future_hole = insetsIntersect(enclosing_inset, enclosed_inset);
                         }
                         if (encloses_future_hole)
                         {
@@ -293,7 +334,7 @@ void InsetOrderOptimizer::processHoleInsets()
 
                 // detect special case where where the z-seam is located on the sharpest corner and there is only 1 hole and
                 // the gap between the walls is just a few line widths
-                if (z_seam_config.type == EZSeamType::SHARPEST_CORNER && inset_polys[0].size() == 2 && PolygonUtils::polygonOutlinesAdjacent(*inset_polys[0][1], *inset_polys[0][0], max_gap * 4))
+                if (z_seam_config.type == EZSeamType::SHARPEST_CORNER && inset_polys[0].size() == 2 && insetOutlinesAdjacent(inset_polys[0][1], inset_polys[0][0], max_gap * 4))
                 {
                     // align z-seam of hole with z-seam of outer wall - makes a nicer job when printing tubes
                     outer_poly_start_idx = PolygonUtils::findNearestVert(start_point, hole_outer_wall.back());
@@ -321,7 +362,7 @@ void InsetOrderOptimizer::processHoleInsets()
 
             // detect special case where where the z-seam is located on the sharpest corner and there is only 1 hole and
             // the gap between the walls is just a few line widths
-            if (z_seam_config.type == EZSeamType::SHARPEST_CORNER && inset_polys[0].size() == 2 && PolygonUtils::polygonOutlinesAdjacent(*inset_polys[0][1], *inset_polys[0][0], max_gap * 2))
+            if (z_seam_config.type == EZSeamType::SHARPEST_CORNER && inset_polys[0].size() == 2 && insetOutlinesAdjacent(inset_polys[0][1], inset_polys[0][0], max_gap * 2))
             {
                 // align z-seam of hole with z-seam of outer wall - makes a nicer job when printing tubes
                 const unsigned point_idx = PolygonUtils::findNearestVert(start_point, hole_outer_wall.back());
@@ -350,7 +391,7 @@ void InsetOrderOptimizer::processOuterWallInsets(const bool include_outer, const
 
     // process the part's outer wall and the level 1 insets that it surrounds
 
-    ConstPolygonRef outer_wall = *inset_polys[0][0];
+    const ConstPolygonPointer outer_wall = inset_polys[0][0];
     Polygons part_inner_walls;
     int num_level_1_insets = 0;
 
@@ -359,31 +400,31 @@ void InsetOrderOptimizer::processOuterWallInsets(const bool include_outer, const
         // find the level 1 insets that are inside the outer wall and consume them
         for (unsigned int level_1_wall_idx = 0; inset_polys.size() > 1 && level_1_wall_idx < inset_polys[1].size(); ++level_1_wall_idx)
         {
-            ConstPolygonRef inner = *inset_polys[1][level_1_wall_idx];
-            if (PolygonUtils::polygonsIntersect(inner, outer_wall))
+            const ConstPolygonPointer inner = inset_polys[1][level_1_wall_idx];
+            if (insetsIntersect(inner, outer_wall))
             {
                 ++num_level_1_insets;
-                part_inner_walls.add(inner);
+                part_inner_walls.add(*inner);
                 // consume the level 1 inset
                 inset_polys[1].erase(inset_polys[1].begin() + level_1_wall_idx);
                 --level_1_wall_idx; // we've shortened the vector so decrement the index otherwise, we'll skip an element
 
                 // now find all the insets that immediately fill the level 1 inset and consume them also
-                Polygons enclosing_insets; // the set of insets that we are trying to "fill in"
-                enclosing_insets.add(inner);
-                Polygons next_level_enclosing_insets;
+                std::vector<ConstPolygonPointer> enclosing_insets; // the set of insets that we are trying to "fill in"
+                enclosing_insets.push_back(inner);
+                std::vector<ConstPolygonPointer> next_level_enclosing_insets;
                 for (unsigned int inset_level = 2; inset_level < num_insets && inset_polys[inset_level].size(); ++inset_level)
                 {
                     // test the level N insets to see if they are adjacent to any of the level N-1 insets
                     for (unsigned int level_n_wall_idx = 0; level_n_wall_idx < inset_polys[inset_level].size(); ++level_n_wall_idx)
                     {
-                        for (ConstPolygonRef enclosing_inset : enclosing_insets)
+                        for (const ConstPolygonPointer& enclosing_inset : enclosing_insets)
                         {
-                            ConstPolygonRef level_n_inset = *inset_polys[inset_level][level_n_wall_idx];
-                            if (PolygonUtils::polygonOutlinesAdjacent(level_n_inset, enclosing_inset, wall_line_width_x * 1.1f))
+                            const ConstPolygonPointer level_n_inset = inset_polys[inset_level][level_n_wall_idx];
+                            if (insetOutlinesAdjacent(level_n_inset, enclosing_inset, wall_line_width_x * 1.1f))
                             {
-                                next_level_enclosing_insets.add(level_n_inset);
-                                part_inner_walls.add(level_n_inset);
+                                next_level_enclosing_insets.push_back(level_n_inset);
+                                part_inner_walls.add(*level_n_inset);
                                 inset_polys[inset_level].erase(inset_polys[inset_level].begin() + level_n_wall_idx);
                                 --level_n_wall_idx; // we've shortened the vector so decrement the index otherwise, we'll skip an element
                                 break;
@@ -466,25 +507,22 @@ bool InsetOrderOptimizer::processInsetsWithOptimizedOrdering()
     added_something = false;
     const unsigned int num_insets = part.insets.size();
 
-    // if overlap compensation is enabled, gather all the level 0 and/or level X walls together
-    // and initialise the respective overlap computers
+    // if overlap compensation is enabled, the level 0 and/or level X walls have been gathered together
+    // and their overlaps computed beforehand, see FffPolygonGenerator::processWallOverlaps
     // NOTE: this code assumes that the overlap computers do not alter the order or number of the polys!
-    Polygons wall_0_polys;
-    if (mesh.settings.get<bool>("travel_compensate_overlapping_walls_0_enabled"))
+    const PolygonProximityLinker* wall_0_linker = (part.wall_overlap_linkers.size() > 0) ? part.wall_overlap_linkers[0].get() : nullptr;
+    const PolygonProximityLinker* wall_x_linker = (part.wall_overlap_linkers.size() > 1) ? part.wall_overlap_linkers[1].get() : nullptr;
+    std::unique_ptr<WallOverlapComputation> wall_overlapper_0_holder;
+    if (wall_0_linker)
     {
-        wall_0_polys = part.insets[0];
-        wall_overlapper_0 = new WallOverlapComputation(wall_0_polys, mesh_config.inset0_config.getLineWidth());
+        wall_overlapper_0_holder.reset(new WallOverlapComputation(*wall_0_linker));
+        wall_overlapper_0 = wall_overlapper_0_holder.get();
     }
-
-    Polygons wall_x_polys;
-    if (mesh.settings.get<bool>("travel_compensate_overlapping_walls_x_enabled"))
+    std::unique_ptr<WallOverlapComputation> wall_overlapper_x_holder;
+    if (wall_x_linker)
     {
-        for (unsigned int inset_level = 1; inset_level < num_insets; ++inset_level)
-        {
-            wall_x_polys.add(part.insets[inset_level]);
-        }
-        // use a slightly reduced line width so that compensation only occurs between insets at the same level (and not between insets in adjacent levels)
-        wall_overlapper_x = new WallOverlapComputation(wall_x_polys, mesh_config.insetX_config.getLineWidth() - 1);
+        wall_overlapper_x_holder.reset(new WallOverlapComputation(*wall_x_linker));
+        wall_overlapper_x = wall_overlapper_x_holder.get();
     }
 
     // create a vector of vectors containing all the inset polys
@@ -498,7 +536,7 @@ bool InsetOrderOptimizer::processInsetsWithOptimizedOrdering()
     {
         if (wall_overlapper_0)
         {
-            inset_polys[0].push_back(wall_0_polys[poly_idx]);
+            inset_polys[0].push_back(wall_0_linker->getPolygons()[poly_idx]);
         }
         else
         {
@@ -514,7 +552,7 @@ bool InsetOrderOptimizer::processInsetsWithOptimizedOrdering()
         {
             if (wall_overlapper_x)
             {
-                inset_polys[inset_level].push_back(wall_x_polys[wall_x_polys_index++]);
+                inset_polys[inset_level].push_back(wall_x_linker->getPolygons()[wall_x_polys_index++]);
             }
             else
             {
@@ -523,6 +561,17 @@ bool InsetOrderOptimizer::processInsetsWithOptimizedOrdering()
         }
     }
 
+    // the insets are tested against each other many times, so compute their bounding boxes only once
+    inset_aabbs.clear();
+    insets_intersect.clear();
+    for (const std::vector<ConstPolygonPointer>& level_polys : inset_polys)
+    {
+        for (const ConstPolygonPointer& poly : level_polys)
+        {
+            inset_aabbs.emplace(poly.operator->(), AABB(*poly));
+        }
+    }
+
     // if the print has thin walls due to the distance from a hole to the outer wall being smaller than a line width, it will produce a nicer finish on
     // the outer wall if it is printed before the holes because the outer wall does not get flow reduced but the hole walls will get flow reduced where
     // they are close to the outer wall. However, we only want to do this if the level 0 insets are being printed before the higher level insets.
@@ -571,16 +620,8 @@ bool InsetOrderOptimizer::processInsetsWithOptimizedOrdering()
             added_something = true;
         }
     }
-    if (wall_overlapper_0)
-    {
-        delete wall_overlapper_0;
-        wall_overlapper_0 = nullptr;
-    }
-    if (wall_overlapper_x)
-    {
-        delete wall_overlapper_x;
-        wall_overlapper_x = nullptr;
-    }
+    wall_overlapper_0 = nullptr;
+    wall_overlapper_x = nullptr;
     return added_something;
 }
 
@@ -4,8 +4,13 @@
 #ifndef INSET_ORDER_OPTIMIZER_H
 #define INSET_ORDER_OPTIMIZER_H
 
+#include <unordered_map>
+
 #include "pathOrderOptimizer.h"
+#include "settings/PathConfigStorage.h" //For MeshPathConfigs.
 #include "sliceDataStorage.h" //For SliceMeshStorage, which is used here at implementation in the header.
+#include "utils/AABB.h"
+#include "utils/SymmetricPair.h"
 
 namespace cura
 {
@@ -40,7 +45,8 @@ public:
     z_seam_config(mesh.settings.get<EZSeamType>("z_seam_type"), mesh.getZSeamHint(), mesh.settings.get<EZSeamCornerPrefType>("z_seam_corner")),
     added_something(false),
     wall_overlapper_0(nullptr),
-    wall_overlapper_x(nullptr)
+    wall_overlapper_x(nullptr),
+    inside_outer_wall_computed(false)
     {
     }
 private:
@@ -58,6 +64,44 @@ private:
     WallOverlapComputation* wall_overlapper_0;
     WallOverlapComputation* wall_overlapper_x;
     std::vector<std::vector<ConstPolygonPointer>> inset_polys; // vector of vectors holding the inset polygons
+    std::unordered_map<const ClipperLib::Path*, AABB> inset_aabbs; //!< The bounding box of each of the inset polygons, so that most pairs of insets are ruled out without looking at their points.
+    std::unordered_map<SymmetricPair<const ClipperLib::Path*>, bool> insets_intersect; //!< Whether two inset polygons intersect, for each pair that has been tested with a full intersection.
+    Polygons inside_outer_wall; //!< The area that is more than a line width inside the outer wall, used by moveInside.
+    bool inside_outer_wall_computed; //!< Whether #inside_outer_wall has been computed yet.
+
+    /*!
+     * Test whether two of the inset polygons intersect.
+     *
+     * The same as PolygonUtils::polygonsIntersect, but using the bounding boxes
+     * in #inset_aabbs and computing the intersection of each pair only once.
+     * \param poly_a The one inset polygon, from #inset_polys.
+     * \param poly_b The other inset polygon, from #inset_polys.
+     */
+    bool insetsIntersect(const ConstPolygonPointer& poly_a, const ConstPolygonPointer& poly_b);
+
+    /*!
+     * Test whether the outline of one inset polygon is within a distance of
+     * the outline of another.
+     *
+     * The same as PolygonUtils::polygonOutlinesAdjacent, but using the
+     * bounding boxes in #inset_aabbs.
+     * \param inner_poly The inset polygon of which to test the points, from
+     * #inset_polys.
+     * \param outer_poly The inset polygon of which to test the line segments,
+     * from #inset_polys.
+     * \param max_gap The maximum distance between the outlines.
+     */
+    bool insetOutlinesAdjacent(const ConstPolygonPointer& inner_poly, const ConstPolygonPointer& outer_poly, const coord_t max_gap) const;
+
+    /*!
+     * Given an inset, search a collection of insets for the adjacent inset
+     * that encloses it.
+     * \param enclosed_inset The inset that is enclosed, from #inset_polys.
+     * \param possible_enclosing_polys The insets that could enclose it.
+     * \param max_gap The maximum distance between adjacent insets.
+     * \return The index of the enclosing inset, or -1 if there is none.
+     */
+    int findAdjacentEnclosingPoly(const ConstPolygonPointer& enclosed_inset, const std::vector<ConstPolygonPointer>& possible_enclosing_polys, const coord_t max_gap);
 
     /*!
      * Generate the insets for the holes of a given layer part after optimizing the ordering.
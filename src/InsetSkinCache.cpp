@@ -0,0 +1,94 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "InsetSkinCache.h"
+#include "settings/SettingsRecorder.h"
+#include "utils/logoutput.h"
+#include "utils/math.h" //For hash_combine.
+
+namespace cura
+{
+
+void InsetSkinCache::beginSlice()
+{
+    for (std::unordered_multimap<uint64_t, Entry>::iterator entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.used)
+        {
+            entry->second.used = false;
+            entry++;
+        }
+        else
+        {
+            entry = entries.erase(entry);
+        }
+    }
+}
+
+uint64_t InsetSkinCache::hash(const SliceMeshStorage& mesh, const bool process_infill)
+{
+    uint64_t result = process_infill;
+    hash_combine(result, mesh.layer_nr_max_filled_layer);
+    hash_combine(result, mesh.layers.size());
+    for (const SliceLayer& layer : mesh.layers)
+    {
+        hash_combine(result, layer.printZ);
+        hash_combine(result, layer.thickness);
+        hash_combine(result, layer.parts.size());
+        for (const SliceLayerPart& part : layer.parts)
+        {
+            for (ConstPolygonRef polygon : part.outline)
+            {
+                hash_combine(result, polygon.size());
+                for (const Point& point : polygon)
+                {
+                    hash_combine(result, point.X);
+                    hash_combine(result, point.Y);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+bool InsetSkinCache::restore(const uint64_t mesh_hash, SliceMeshStorage& mesh)
+{
+    const std::pair<std::unordered_multimap<uint64_t, Entry>::iterator, std::unordered_multimap<uint64_t, Entry>::iterator> candidates = entries.equal_range(mesh_hash);
+    for (std::unordered_multimap<uint64_t, Entry>::iterator cached = candidates.first; cached != candidates.second; cached++)
+    {
+        if (cached->second.parts.size() != mesh.layers.size() || !cached->second.dependencies.match(mesh.settings))
+        {
+            continue;
+        }
+        log("Reusing the walls, skin and infill of mesh %s from a previous slice.\n", mesh.mesh_name.c_str());
+        for (size_t layer_nr = 0; layer_nr < mesh.layers.size(); layer_nr++)
+        {
+            mesh.layers[layer_nr].parts = cached->second.parts[layer_nr];
+            mesh.layers[layer_nr].indexParts();
+            mesh.layers[layer_nr].top_surface.areas = cached->second.top_surfaces[layer_nr];
+        }
+        cached->second.used = true;
+        return true;
+    }
+    return false;
+}
+
+void InsetSkinCache::store(const uint64_t mesh_hash, const SliceMeshStorage& mesh, const SettingsRecorder& recorder)
+{
+    Entry entry;
+    if (!entry.dependencies.record(recorder, mesh.settings))
+    {
+        return;
+    }
+    entry.parts.reserve(mesh.layers.size());
+    entry.top_surfaces.reserve(mesh.layers.size());
+    for (const SliceLayer& layer : mesh.layers)
+    {
+        entry.parts.push_back(layer.parts);
+        entry.top_surfaces.push_back(layer.top_surface.areas);
+    }
+    entry.used = true;
+    entries.emplace(mesh_hash, std::move(entry));
+}
+
+} //namespace cura
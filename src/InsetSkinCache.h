@@ -0,0 +1,85 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef INSET_SKIN_CACHE_H
+#define INSET_SKIN_CACHE_H
+
+#include <cstdint> //For uint64_t.
+#include <unordered_map>
+#include <vector>
+
+#include "sliceDataStorage.h"
+#include "settings/SettingDependencies.h"
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+class SettingsRecorder;
+
+/*!
+ * \brief The walls, skin and infill areas of meshes, kept between slices.
+ *
+ * When only settings of later stages change, such as the speeds, the layer
+ * parts of a mesh come out the same as in the previous slice and so would
+ * their walls, skin and infill. The cache recognises such a mesh by a hash of
+ * the outlines of its layer parts, and by the values of the settings that were
+ * read while computing its walls, skin and infill.
+ *
+ * Like the \ref SlicerCache, it drops the meshes that weren't used in a slice
+ * at the start of the next slice.
+ */
+class InsetSkinCache : NoCopy
+{
+public:
+    /*!
+     * \brief Start a new slice.
+     *
+     * This drops the meshes that weren't used since the previous call.
+     */
+    void beginSlice();
+
+    /*!
+     * \brief Compute the hash of everything that the walls, skin and infill of
+     * a mesh are computed from, other than its settings.
+     * \param mesh The mesh, with its layer parts but no walls yet.
+     * \param process_infill Whether infill areas are computed for the mesh.
+     */
+    static uint64_t hash(const SliceMeshStorage& mesh, const bool process_infill);
+
+    /*!
+     * \brief Fill in the walls, skin and infill of a mesh from a previous
+     * slice, if they were computed with the same settings.
+     * \param mesh_hash The hash of the mesh, see \ref InsetSkinCache::hash.
+     * \param mesh The mesh to fill in.
+     * \return Whether the mesh was filled in from the cache.
+     */
+    bool restore(const uint64_t mesh_hash, SliceMeshStorage& mesh);
+
+    /*!
+     * \brief Keep the walls, skin and infill of a mesh for later slices.
+     * \param mesh_hash The hash of the mesh before its walls, skin and infill
+     * were computed, see \ref InsetSkinCache::hash.
+     * \param mesh The mesh with its walls, skin and infill.
+     * \param recorder The recorder that was active while computing them.
+     */
+    void store(const uint64_t mesh_hash, const SliceMeshStorage& mesh, const SettingsRecorder& recorder);
+
+private:
+    /*!
+     * \brief The walls, skin and infill of a mesh from a previous slice.
+     */
+    struct Entry
+    {
+        SettingDependencies dependencies; //!< The settings that were read while computing them.
+        std::vector<std::vector<SliceLayerPart>> parts; //!< For each layer, the layer parts with their walls, skin and infill.
+        std::vector<Polygons> top_surfaces; //!< For each layer, the top surface to iron.
+        bool used; //!< Whether the mesh was used since the last \ref InsetSkinCache::beginSlice.
+    };
+
+    std::unordered_multimap<uint64_t, Entry> entries; //!< The meshes by their hash.
+};
+
+} //namespace cura
+
+#endif //INSET_SKIN_CACHE_H
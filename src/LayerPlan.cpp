@@ -15,16 +15,23 @@
 #include "pathPlanning/Comb.h"
 #include "pathPlanning/CombPaths.h"
 #include "settings/types/Ratio.h"
+#include "utils/Instrumentation.h"
 #include "utils/logoutput.h"
+#include "utils/MemoryBudget.h"
 #include "utils/polygonUtils.h"
+#include "utils/TaskScheduler.h"
 #include "WipeScriptConfig.h"
 
 namespace cura {
 
 
 ExtruderPlan::ExtruderPlan(const size_t extruder, const LayerIndex layer_nr, const bool is_initial_layer, const bool is_raft_layer, const coord_t layer_thickness, const FanSpeedLayerTimeSettings& fan_speed_layer_time_settings, const RetractionConfig& retraction_config)
-: heated_pre_travel_time(0)
+: next_insert_idx(0)
+, heated_pre_travel_time(0)
 , required_start_temperature(-1)
+, precomputed_estimates_start(0)
+, precomputed_estimates_end(0)
+, precomputed_estimates_end_position(0, 0)
 , extruder_nr(extruder)
 , layer_nr(layer_nr)
 , is_initial_layer(is_initial_layer)
@@ -80,7 +87,8 @@ void LayerPlan::forceNewPathStart()
 
 LayerPlan::LayerPlan(const SliceDataStorage& storage, LayerIndex layer_nr, coord_t z, coord_t layer_thickness, size_t start_extruder, const std::vector<FanSpeedLayerTimeSettings>& fan_speed_layer_time_settings_per_extruder, coord_t comb_boundary_offset, coord_t comb_move_inside_distance, coord_t travel_avoid_distance)
 : storage(storage)
-, configs_storage(storage, layer_nr, layer_thickness)
+, shared_configs_storage(storage.getPathConfigs(layer_nr, layer_thickness))
+, configs_storage(*shared_configs_storage)
 , z(z)
 , mode_skip_agressive_merge(false)
 , layer_nr(layer_nr)
@@ -88,12 +96,12 @@ LayerPlan::LayerPlan(const SliceDataStorage& storage, LayerIndex layer_nr, coord
 , is_raft_layer(layer_nr < 0 - static_cast<LayerIndex>(Raft::getFillerLayerCount()))
 , layer_thickness(layer_thickness)
 , has_prime_tower_planned_per_extruder(Application::getInstance().current_slice->scene.extruders.size(), false)
-, current_mesh("NONMESH")
+, current_mesh(std::make_shared<const std::string>("NONMESH"))
 , last_extruder_previous_layer(start_extruder)
 , last_planned_extruder(&Application::getInstance().current_slice->scene.extruders[start_extruder])
 , first_travel_destination_is_inside(false) // set properly when addTravel is called for the first time (otherwise not set properly)
 , comb_boundary_inside1(computeCombBoundaryInside(1))
-, comb_boundary_inside2(computeCombBoundaryInside(2))
+, comb_boundary_inside2(combBoundaryDependsOnInset() ? computeCombBoundaryInside(2) : comb_boundary_inside1)
 , comb_move_inside_distance(comb_move_inside_distance)
 , fan_speed_layer_time_settings_per_extruder(fan_speed_layer_time_settings_per_extruder)
 {
@@ -125,6 +133,10 @@ LayerPlan::~LayerPlan()
 {
     if (comb)
         delete comb;
+    if (tracked_memory)
+    {
+        MemoryBudget::getInstance().subtract(MemoryAccount::LAYER_PLANS, tracked_memory);
+    }
 }
 
 ExtruderTrain* LayerPlan::getLastPlannedExtruderTrain()
@@ -133,6 +145,27 @@ ExtruderTrain* LayerPlan::getLastPlannedExtruderTrain()
 }
 
 
+bool LayerPlan::combBoundaryDependsOnInset() const
+{
+    if (layer_nr < 0 || Application::getInstance().current_slice->scene.current_mesh_group->settings.get<CombingMode>("retraction_combing") == CombingMode::OFF)
+    {
+        return false;
+    }
+    for (const SliceMeshStorage& mesh : storage.meshes)
+    {
+        if (mesh.settings_snapshot.infill_mesh)
+        {
+            continue;
+        }
+        const CombingMode combing_mode = mesh.settings_snapshot.retraction_combing;
+        if (combing_mode != CombingMode::NO_SKIN && combing_mode != CombingMode::INFILL) //Only combing within the innermost walls looks at the inset index.
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 Polygons LayerPlan::computeCombBoundaryInside(const size_t max_inset)
 {
     const CombingMode combing_mode = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<CombingMode>("retraction_combing");
@@ -157,15 +190,15 @@ Polygons LayerPlan::computeCombBoundaryInside(const size_t max_inset)
         for (const SliceMeshStorage& mesh : storage.meshes)
         {
             const SliceLayer& layer = mesh.layers[layer_nr];
-            if (mesh.settings.get<bool>("infill_mesh")) {
+            if (mesh.settings_snapshot.infill_mesh) {
                 continue;
             }
-            const CombingMode combing_mode = mesh.settings.get<CombingMode>("retraction_combing");
+            const CombingMode combing_mode = mesh.settings_snapshot.retraction_combing;
             if (combing_mode == CombingMode::NO_SKIN)
             {
                 // we need to include the walls in the comb boundary otherwise it's not possible to tell if a travel move crosses a skin region
 
-                const coord_t line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
+                const coord_t line_width_0 = mesh.settings_snapshot.wall_line_width_0;
 
                 for (const SliceLayerPart& part : layer.parts)
                 {
@@ -225,13 +258,13 @@ Polygons LayerPlan::computeCombBoundaryInside(const size_t max_inset)
                         }
                         else
                         {
-                            inner = part.insets[num_insets - 1].offset(-10 - mesh.settings.get<coord_t>("wall_line_width_x") / 2);
+                            inner = part.insets[num_insets - 1].offset(-10 - mesh.settings_snapshot.wall_line_width_x / 2);
                         }
 
                         Polygons infill(part.infill_area);
                         if (part.perimeter_gaps.size() > 0)
                         {
-                            infill = infill.unionPolygons(part.perimeter_gaps.offset(10)); // ensure polygons overlap slightly
+                            infill.unionInPlace(part.perimeter_gaps.offset(10)); // ensure polygons overlap slightly
                         }
 
                         // combine the wall combing region (outer - inner) with the infill (if any)
@@ -318,7 +351,10 @@ bool LayerPlan::setExtruder(const size_t extruder_nr)
 }
 void LayerPlan::setMesh(const std::string mesh_id)
 {
-    current_mesh = mesh_id;
+    if (*current_mesh != mesh_id) //Keep sharing the same ID, so that paths of the same mesh can still be merged.
+    {
+        current_mesh = std::make_shared<const std::string>(mesh_id);
+    }
 }
 
 void LayerPlan::moveInsideCombBoundary(const coord_t distance)
@@ -359,6 +395,34 @@ std::optional<std::pair<Point, bool>> LayerPlan::getFirstTravelDestinationState(
     return ret;
 }
 
+size_t LayerPlan::getMemoryUsage() const
+{
+    size_t bytes = sizeof(LayerPlan) + extruder_plans.capacity() * sizeof(ExtruderPlan);
+    for (const ExtruderPlan& extruder_plan : extruder_plans)
+    {
+        bytes += extruder_plan.paths.capacity() * sizeof(GCodePath);
+        for (const GCodePath& path : extruder_plan.paths)
+        {
+            if (!path.points.isInline())
+            {
+                bytes += path.points.capacity() * sizeof(Point);
+            }
+        }
+    }
+    return bytes;
+}
+
+void LayerPlan::trackMemory()
+{
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    if (tracked_memory || !budget.isTracking())
+    {
+        return;
+    }
+    tracked_memory = getMemoryUsage();
+    budget.add(MemoryAccount::LAYER_PLANS, tracked_memory);
+}
+
 GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
 {
     const GCodePathConfig& travel_config = configs_storage.travel_config_per_extruder[getExtruder()];
@@ -369,11 +433,12 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
     bool combed = false;
 
     const ExtruderTrain* extruder = getLastPlannedExtruderTrain();
+    const ExtruderSettingsSnapshot& extruder_settings = storage.settings_snapshot_per_extruder[extruder->extruder_nr];
 
-    const coord_t maximum_travel_resolution = extruder->settings.get<coord_t>("meshfix_maximum_travel_resolution");
+    const coord_t maximum_travel_resolution = extruder_settings.meshfix_maximum_travel_resolution;
 
     const bool is_first_travel_of_extruder_after_switch = extruder_plans.back().paths.size() == 1 && (extruder_plans.size() > 1 || last_extruder_previous_layer != getExtruder());
-    bool bypass_combing = is_first_travel_of_extruder_after_switch && extruder->settings.get<bool>("retraction_hop_after_extruder_switch");
+    bool bypass_combing = is_first_travel_of_extruder_after_switch && extruder_settings.retraction_hop_after_extruder_switch;
 
     const bool is_first_travel_of_layer = !static_cast<bool>(last_planned_position);
     if (is_first_travel_of_layer)
@@ -389,7 +454,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
         path->retract = true;
         if (comb == nullptr)
         {
-            path->perform_z_hop = extruder->settings.get<bool>("retraction_hop_enabled");
+            path->perform_z_hop = extruder_settings.retraction_hop_enabled;
         }
     }
 
@@ -399,7 +464,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
 
         // Divide by 2 to get the radius
         // Multiply by 2 because if two lines start and end points places very close then will be applied combing with retractions. (Ex: for brim)
-        const coord_t max_distance_ignored = extruder->settings.get<coord_t>("machine_nozzle_tip_outer_diameter") / 2 * 2;
+        const coord_t max_distance_ignored = extruder_settings.machine_nozzle_tip_outer_diameter / 2 * 2;
 
         combed = comb->calc(*extruder, *last_planned_position, p, combPaths, was_inside, is_inside, max_distance_ignored);
         if (combed)
@@ -425,7 +490,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
                 if (combPaths.size() == 1)
                 {
                     CombPath comb_path = combPaths[0];
-                    if (extruder->settings.get<bool>("limit_support_retractions") &&
+                    if (extruder_settings.limit_support_retractions &&
                         combPaths.throughAir && !comb_path.cross_boundary && comb_path.size() == 2 && comb_path[0] == *last_planned_position && comb_path[1] == p)
                     { // limit the retractions from support to support, which didn't cross anything
                         retract = false;
@@ -452,7 +517,7 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
                 }
                 last_planned_position = combPath.back();
                 distance += vSize(last_point - p);
-                const coord_t retract_threshold = extruder->settings.get<coord_t>("retraction_combing_max_distance");
+                const coord_t retract_threshold = extruder_settings.retraction_combing_max_distance;
                 path->retract = retract || (retract_threshold > 0 && distance > retract_threshold);
                 // don't perform a z-hop
             }
@@ -464,16 +529,10 @@ GCodePath& LayerPlan::addTravel(Point p, bool force_comb_retract)
     {
         if (was_inside) // when the previous location was from printing something which is considered inside (not support or prime tower etc)
         {               // then move inside the printed part, so that we don't ooze on the outer wall while retraction, but on the inside of the print.
-            assert (extruder != nullptr);
-            coord_t innermost_wall_line_width = extruder->settings.get<coord_t>((extruder->settings.get<size_t>("wall_line_count") > 1) ? "wall_line_width_x" : "wall_line_width_0");
-            if (layer_nr == 0)
-            {
-                innermost_wall_line_width *= extruder->settings.get<Ratio>("initial_layer_line_width_factor");
-            }
-            moveInsideCombBoundary(innermost_wall_line_width);
+            moveInsideCombBoundary(extruder_settings.getInnermostWallLineWidth(layer_nr));
         }
         path->retract = true;
-        path->perform_z_hop = extruder->settings.get<bool>("retraction_hop_enabled");
+        path->perform_z_hop = extruder_settings.retraction_hop_enabled;
     }
 
     GCodePath& ret = addTravel_simple(p, path);
@@ -521,19 +580,42 @@ void LayerPlan::addPolygon(ConstPolygonRef polygon, int start_idx, const GCodePa
 {
     Point p0 = polygon[start_idx];
     addTravel(p0, always_retract);
-    for (unsigned int point_idx = 1; point_idx < polygon.size(); point_idx++)
-    {
-        Point p1 = polygon[(start_idx + point_idx) % polygon.size()];
-        const Ratio flow = (wall_overlap_computation) ? flow_ratio * wall_overlap_computation->getFlow(p0, p1) : flow_ratio;
-        addExtrusionMove(p1, config, SpaceFillType::Polygons, flow, spiralize);
-        p0 = p1;
+    if (!wall_overlap_computation && polygon.size() > 1)
+    { // All moves have the same flow and so go into the same path. Copy the vertices into it in one go.
+        GCodePath* path = getLatestPathWithConfig(config, SpaceFillType::Polygons, flow_ratio, spiralize);
+        SmallVector<Point, 2>& points = path->points;
+        points.reserve(points.size() + polygon.size());
+        points.insert(points.end(), polygon.begin() + start_idx + 1, polygon.end());
+        points.insert(points.end(), polygon.begin(), polygon.begin() + start_idx + (polygon.size() > 2)); //Close the polygon, unless it's a single line.
+        path->setFanSpeed(GCodePathConfig::FAN_SPEED_DEFAULT);
+        last_planned_position = points.back();
+    }
+    else
+    { // The flow may differ per move. Consecutive moves with the same flow still go into the same path, so only look up the path when the flow changes.
+        GCodePath* path = nullptr;
+        const auto add_move = [&](const Point& p1)
+        {
+            const Ratio flow = (wall_overlap_computation) ? flow_ratio * wall_overlap_computation->getFlow(p0, p1) : flow_ratio;
+            if (!path || path->flow != flow)
+            {
+                path = getLatestPathWithConfig(config, SpaceFillType::Polygons, flow, spiralize);
+                path->setFanSpeed(GCodePathConfig::FAN_SPEED_DEFAULT);
+            }
+            path->points.push_back(p1);
+            p0 = p1;
+        };
+        for (unsigned int point_idx = 1; point_idx < polygon.size(); point_idx++)
+        {
+            add_move(polygon[(start_idx + point_idx) % polygon.size()]);
+        }
+        if (polygon.size() > 2)
+        {
+            add_move(polygon[start_idx]);
+        }
+        last_planned_position = p0;
     }
     if (polygon.size() > 2)
     {
-        const Point& p1 = polygon[start_idx];
-        const Ratio flow = (wall_overlap_computation) ? flow_ratio * wall_overlap_computation->getFlow(p0, p1) : flow_ratio;
-        addExtrusionMove(p1, config, SpaceFillType::Polygons, flow, spiralize);
-
         if (wall_0_wipe_dist > 0)
         { // apply outer wall wipe
             p0 = polygon[start_idx];
@@ -572,10 +654,7 @@ void LayerPlan::addPolygonsByOptimizer(const Polygons& polygons, const GCodePath
         return;
     }
     PathOrderOptimizer orderOptimizer(getLastPlannedPositionOrStartingPosition(), z_seam_config);
-    for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
-    {
-        orderOptimizer.addPolygon(polygons[poly_idx]);
-    }
+    orderOptimizer.addPolygons(polygons);
     orderOptimizer.optimize();
     
     if(reverse_order == false)
@@ -604,9 +683,9 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const SliceMeshSto
     const double acceleration_factor = 0.85; // must be < 1, the larger the value, the slower the acceleration
     const bool spiralize = false;
 
-    const coord_t min_bridge_line_len = mesh.settings.get<coord_t>("bridge_wall_min_length");
-    const Ratio bridge_wall_coast = mesh.settings.get<Ratio>("bridge_wall_coast");
-    const Ratio overhang_speed_factor = mesh.settings.get<Ratio>("wall_overhang_speed_factor");
+    const coord_t min_bridge_line_len = mesh.settings_snapshot.bridge_wall_min_length;
+    const Ratio bridge_wall_coast = mesh.settings_snapshot.bridge_wall_coast;
+    const Ratio overhang_speed_factor = mesh.settings_snapshot.wall_overhang_speed_factor;
 
     Point cur_point = p0;
 
@@ -661,7 +740,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const SliceMeshSto
                 {
                     // no coasting required, just normal segment using non-bridge config
                     addExtrusionMove(segment_end, non_bridge_config, SpaceFillType::Polygons, segment_flow, spiralize,
-                        (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? speed_factor : overhang_speed_factor);
+                        (overhang_mask.empty() || (!overhang_mask_tester.inside(p0, true) && !overhang_mask_tester.inside(p1, true))) ? speed_factor : overhang_speed_factor);
                 }
 
                 distance_to_bridge_start -= len;
@@ -670,7 +749,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const SliceMeshSto
             {
                 // no coasting required, just normal segment using non-bridge config
                 addExtrusionMove(segment_end, non_bridge_config, SpaceFillType::Polygons, segment_flow, spiralize,
-                    (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? speed_factor : overhang_speed_factor);
+                    (overhang_mask.empty() || (!overhang_mask_tester.inside(p0, true) && !overhang_mask_tester.inside(p1, true))) ? speed_factor : overhang_speed_factor);
             }
             non_bridge_line_volume += vSize(cur_point - segment_end) * segment_flow * speed_factor * non_bridge_config.getSpeed();
             cur_point = segment_end;
@@ -683,7 +762,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const SliceMeshSto
     {
         // no bridges required
         addExtrusionMove(p1, non_bridge_config, SpaceFillType::Polygons, flow, spiralize,
-            (overhang_mask.empty() || (!overhang_mask.inside(p0, true) && !overhang_mask.inside(p1, true))) ? 1.0_r : overhang_speed_factor);
+            (overhang_mask.empty() || (!overhang_mask_tester.inside(p0, true) && !overhang_mask_tester.inside(p1, true))) ? 1.0_r : overhang_speed_factor);
     }
     else
     {
@@ -763,7 +842,7 @@ void LayerPlan::addWallLine(const Point& p0, const Point& p1, const SliceMeshSto
             // if we haven't yet reached p1, fill the gap with non_bridge_config line
             addNonBridgeLine(p1);
         }
-        else if (bridge_wall_mask.inside(p0, true) && vSize(p0 - p1) >= min_bridge_line_len)
+        else if (bridge_wall_mask_tester.inside(p0, true) && vSize(p0 - p1) >= min_bridge_line_len)
         {
             // both p0 and p1 must be above air (the result will be ugly!)
             addExtrusionMove(p1, bridge_config, SpaceFillType::Polygons, flow);
@@ -786,9 +865,9 @@ void LayerPlan::addWall(ConstPolygonRef wall, int start_idx, const SliceMeshStor
     double speed_factor = 1.0; // start first line at normal speed
     coord_t distance_to_bridge_start = 0; // will be updated before each line is processed
 
-    const coord_t min_bridge_line_len = mesh.settings.get<coord_t>("bridge_wall_min_length");
-    const Ratio wall_min_flow = mesh.settings.get<Ratio>("wall_min_flow");
-    const bool wall_min_flow_retract = mesh.settings.get<bool>("wall_min_flow_retract");
+    const coord_t min_bridge_line_len = mesh.settings_snapshot.bridge_wall_min_length;
+    const Ratio wall_min_flow = mesh.settings_snapshot.wall_min_flow;
+    const bool wall_min_flow_retract = mesh.settings_snapshot.wall_min_flow_retract;
 
     // helper function to calculate the distance from the start of the current wall line to the first bridge segment
 
@@ -860,7 +939,7 @@ void LayerPlan::addWall(ConstPolygonRef wall, int start_idx, const SliceMeshStor
                         line_polys.remove(nearest);
                     }
                 }
-                else if (!bridge_wall_mask.inside(p0, true))
+                else if (!bridge_wall_mask_tester.inside(p0, true))
                 {
                     // none of the line is over air
                     distance_to_bridge_start += vSize(p1 - p0);
@@ -1029,22 +1108,58 @@ void LayerPlan::addLinesByOptimizer(const Polygons& polygons, const GCodePathCon
         boundary.simplify(100, 100);
     }
     LineOrderOptimizer orderOptimizer(near_start_location.value_or(getLastPlannedPositionOrStartingPosition()), &boundary);
-    for (unsigned int line_idx = 0; line_idx < polygons.size(); line_idx++)
-    {
-        orderOptimizer.addPolygon(polygons[line_idx]);
-    }
+    orderOptimizer.addPolygons(polygons);
     orderOptimizer.optimize();
 
-    for (unsigned int order_idx = 0; order_idx < orderOptimizer.polyOrder.size(); order_idx++)
+    addLinesInOrder(polygons, orderOptimizer, config, space_fill_type, wipe_dist, flow_ratio, fan_speed);
+}
+
+void LayerPlan::addParallelLines(const Polygons& lines, const GCodePathConfig& config, SpaceFillType space_fill_type, int wipe_dist, float flow_ratio, std::optional<Point> near_start_location, double fan_speed)
+{
+    LineOrderOptimizer orderOptimizer(near_start_location.value_or(getLastPlannedPositionOrStartingPosition()));
+    orderOptimizer.addPolygons(lines);
+    orderOptimizer.optimizeParallel();
+
+    addLinesInOrder(lines, orderOptimizer, config, space_fill_type, wipe_dist, flow_ratio, fan_speed);
+}
+
+void LayerPlan::addLinesInOrder(const Polygons& polygons, const LineOrderOptimizer& orderOptimizer, const GCodePathConfig& config, SpaceFillType space_fill_type, int wipe_dist, float flow_ratio, double fan_speed)
+{
+    // Measure the travels from the end of each line to the start of the next all at once, since most of them are short and don't need combing.
+    const size_t line_count = orderOptimizer.polyOrder.size();
+    std::vector<Point> line_starts(line_count);
+    std::vector<Point> line_ends(line_count);
+    for (size_t order_idx = 0; order_idx < line_count; order_idx++)
     {
         const unsigned int poly_idx = orderOptimizer.polyOrder[order_idx];
-        ConstPolygonRef polygon = polygons[poly_idx];
         const size_t start = orderOptimizer.polyStart[poly_idx];
-        const size_t end = 1 - start;
-        const Point& p0 = polygon[start];
-        addTravel(p0);
-        const Point& p1 = polygon[end];
+        line_starts[order_idx] = polygons[poly_idx][start];
+        line_ends[order_idx] = polygons[poly_idx][1 - start];
+    }
+    std::vector<int64_t> travel_distances2(line_count, 0); //The squared length of the travel to each line from the end of the line before it.
+    for (size_t order_idx = 1; order_idx < line_count; order_idx++)
+    {
+        travel_distances2[order_idx] = vSize2(line_starts[order_idx] - line_ends[order_idx - 1]);
+    }
+    const int64_t straight_travel_distance = getStraightTravelDistance();
+    const int64_t straight_travel_distance2 = straight_travel_distance * straight_travel_distance;
+
+    bool wiped = false; //Whether the nozzle was moved away from the end of the previous line.
+    for (unsigned int order_idx = 0; order_idx < line_count; order_idx++)
+    {
+        const Point& p0 = line_starts[order_idx];
+        if (order_idx > 0 && !wiped && travel_distances2[order_idx] <= straight_travel_distance2)
+        { // addTravel would only move straight there
+            addTravel_simple(p0);
+            was_inside = is_inside;
+        }
+        else
+        {
+            addTravel(p0);
+        }
+        const Point& p1 = line_ends[order_idx];
         addExtrusionMove(p1, config, space_fill_type, flow_ratio, false, 1.0, fan_speed);
+        wiped = false;
 
         // Wipe
         if (wipe_dist != 0)
@@ -1059,13 +1174,9 @@ void LayerPlan::addLinesByOptimizer(const Polygons& polygons, const GCodePathCon
             }
 
             // Don't wipe if next starting point is very near
-            if (wipe && (order_idx < orderOptimizer.polyOrder.size() - 1))
+            if (wipe && (order_idx < line_count - 1))
             {
-                const unsigned int next_poly_idx = orderOptimizer.polyOrder[order_idx + 1];
-                ConstPolygonRef next_polygon = polygons[next_poly_idx];
-                const size_t next_start = orderOptimizer.polyStart[next_poly_idx];
-                const Point& next_p0 = next_polygon[next_start];
-                if (vSize2(next_p0 - p1) <= line_width * line_width * 4)
+                if (travel_distances2[order_idx + 1] <= line_width * line_width * 4)
                 {
                     wipe = false;
                 }
@@ -1074,11 +1185,24 @@ void LayerPlan::addLinesByOptimizer(const Polygons& polygons, const GCodePathCon
             if (wipe)
             {
                 addExtrusionMove(p1 + normal(p1-p0, wipe_dist), config, space_fill_type, 0.0, false, 1.0, fan_speed);
+                wiped = true;
             }
         }
     }
 }
 
+coord_t LayerPlan::getStraightTravelDistance() const
+{
+    const ExtruderSettingsSnapshot& extruder_settings = storage.settings_snapshot_per_extruder[last_planned_extruder->extruder_nr];
+    const coord_t retraction_min_travel_distance = storage.retraction_config_per_extruder[getExtruder()].retraction_min_travel_distance;
+    if (comb == nullptr)
+    {
+        return retraction_min_travel_distance;
+    }
+    const coord_t max_distance_ignored = extruder_settings.machine_nozzle_tip_outer_diameter / 2 * 2; //Same as in addTravel.
+    return std::min(max_distance_ignored, retraction_min_travel_distance); //The travel may bypass combing if it's the first after an extruder switch.
+}
+
 void LayerPlan::spiralizeWallSlice(const GCodePathConfig& config, ConstPolygonRef wall, ConstPolygonRef last_wall, const int seam_vertex_idx, const int last_seam_vertex_idx)
 {
     const Point origin = (last_seam_vertex_idx >= 0) ? last_wall[last_seam_vertex_idx] : wall[seam_vertex_idx];
@@ -1187,59 +1311,98 @@ void ExtruderPlan::forceMinimalLayerTime(double minTime, double minimalSpeed, do
 }
 TimeMaterialEstimates ExtruderPlan::computeNaiveTimeEstimates(Point starting_position)
 {
-    TimeMaterialEstimates ret;
     Point p0 = starting_position;
+    size_t path_idx = 0;
+    for (; path_idx < paths.size() && path_idx < precomputed_estimates_start; path_idx++)
+    {
+        addNaiveTimeEstimates(paths[path_idx], p0);
+        estimates += paths[path_idx].estimates;
+    }
+    if (precomputed_estimates_end > precomputed_estimates_start)
+    { // already computed while planning the layer, so only the paths around them are left for the (serial) layer plan buffer
+        estimates += precomputed_estimates;
+        p0 = precomputed_estimates_end_position;
+        path_idx = precomputed_estimates_end;
+    }
+    for (; path_idx < paths.size(); path_idx++)
+    {
+        addNaiveTimeEstimates(paths[path_idx], p0);
+        estimates += paths[path_idx].estimates;
+    }
+    return estimates;
+}
 
-    bool was_retracted = false; // wrong assumption; won't matter that much. (TODO)
-    for (GCodePath& path : paths)
+void ExtruderPlan::precomputeNaiveTimeEstimates()
+{
+    // up to the first path with any points, the estimates depend on where the head was before this extruder plan
+    size_t first_path_with_points = 0;
+    while (first_path_with_points < paths.size() && paths[first_path_with_points].points.empty())
     {
-        bool is_extrusion_path = false;
-        double* path_time_estimate;
-        double& material_estimate = path.estimates.material;
-        if (!path.isTravelPath())
+        first_path_with_points++;
+    }
+    if (first_path_with_points == paths.size())
+    {
+        return;
+    }
+    Point p0 = paths[first_path_with_points].points.back();
+    precomputed_estimates = TimeMaterialEstimates();
+    for (size_t path_idx = first_path_with_points + 1; path_idx < paths.size(); path_idx++)
+    {
+        addNaiveTimeEstimates(paths[path_idx], p0);
+        precomputed_estimates += paths[path_idx].estimates;
+    }
+    precomputed_estimates_start = first_path_with_points + 1;
+    precomputed_estimates_end = paths.size();
+    precomputed_estimates_end_position = p0;
+}
+
+void ExtruderPlan::addNaiveTimeEstimates(GCodePath& path, Point& p0) const
+{
+    constexpr bool was_retracted = false; // wrong assumption; won't matter that much. (TODO)
+    bool is_extrusion_path = false;
+    double* path_time_estimate;
+    double& material_estimate = path.estimates.material;
+    if (!path.isTravelPath())
+    {
+        is_extrusion_path = true;
+        path_time_estimate = &path.estimates.extrude_time;
+    }
+    else 
+    {
+        if (path.retract)
         {
-            is_extrusion_path = true;
-            path_time_estimate = &path.estimates.extrude_time;
+            path_time_estimate = &path.estimates.retracted_travel_time;
         }
         else 
         {
+            path_time_estimate = &path.estimates.unretracted_travel_time;
+        }
+        if (path.retract != was_retracted)
+        { // handle retraction times
+            double retract_unretract_time;
             if (path.retract)
             {
-                path_time_estimate = &path.estimates.retracted_travel_time;
+                retract_unretract_time = retraction_config.distance / retraction_config.speed;
             }
             else 
             {
-                path_time_estimate = &path.estimates.unretracted_travel_time;
-            }
-            if (path.retract != was_retracted)
-            { // handle retraction times
-                double retract_unretract_time;
-                if (path.retract)
-                {
-                    retract_unretract_time = retraction_config.distance / retraction_config.speed;
-                }
-                else 
-                {
-                    retract_unretract_time = retraction_config.distance / retraction_config.primeSpeed;
-                }
-                path.estimates.retracted_travel_time += 0.5 * retract_unretract_time;
-                path.estimates.unretracted_travel_time += 0.5 * retract_unretract_time;
+                retract_unretract_time = retraction_config.distance / retraction_config.primeSpeed;
             }
+            path.estimates.retracted_travel_time += 0.5 * retract_unretract_time;
+            path.estimates.unretracted_travel_time += 0.5 * retract_unretract_time;
         }
-        for(Point& p1 : path.points)
+    }
+    for(Point& p1 : path.points)
+    {
+        double length = vSizeMM(p0 - p1);
+        if (is_extrusion_path)
         {
-            double length = vSizeMM(p0 - p1);
-            if (is_extrusion_path)
-            {
-                material_estimate += length * INT2MM(layer_thickness) * INT2MM(path.config->getLineWidth());
-            }
-            double thisTime = length / path.config->getSpeed();
-            *path_time_estimate += thisTime;
-            p0 = p1;
+            material_estimate += length * INT2MM(layer_thickness) * INT2MM(path.config->getLineWidth());
         }
-        estimates += path.estimates;
+        double thisTime = length / path.config->getSpeed();
+        *path_time_estimate += thisTime;
+        p0 = p1;
     }
-    return estimates;
 }
 
 void ExtruderPlan::processFanSpeedAndMinimalLayerTime(bool force_minimal_layer_time, Point starting_position)
@@ -1326,12 +1489,22 @@ void LayerPlan::processFanSpeedAndMinimalLayerTime(Point starting_position)
 
 
 
+void LayerPlan::precomputeNaiveTimeEstimates()
+{
+    for (ExtruderPlan& extruder_plan : extruder_plans)
+    {
+        extruder_plan.precomputeNaiveTimeEstimates();
+    }
+}
+
 void LayerPlan::writeGCode(GCodeExport& gcode)
 {
+    const ScopedTimer timer("layer_gcode", layer_nr);
     Communication* communication = Application::getInstance().communication;
     communication->setLayerForSend(layer_nr);
     communication->sendCurrentPosition(gcode.getPositionXY());
     gcode.setLayerNr(layer_nr);
+    gcode.beginLayerBuffer(); // the moves are converted to text in parallel once the whole layer is known
     
     gcode.writeLayerComment(layer_nr);
 
@@ -1420,11 +1593,9 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
         }
         gcode.writeFanCommand(extruder_plan.getFanSpeed());
         std::vector<GCodePath>& paths = extruder_plan.paths;
+        ScopedTimer::count("paths", paths.size());
 
-        extruder_plan.inserts.sort([](const NozzleTempInsert& a, const NozzleTempInsert& b) -> bool
-            {
-                return  a.path_idx < b.path_idx; 
-            });
+        extruder_plan.sortInserts();
 
         const ExtruderTrain& extruder = Application::getInstance().current_slice->scene.extruders[extruder_nr];
         if (extruder.settings.get<Velocity>("max_feedrate_z_override") > 0)
@@ -1433,6 +1604,7 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
         }
 
         bool update_extrusion_offset = true;
+        const bool coasting_enabled = extruder.settings.get<bool>("coasting_enable");
 
         for(unsigned int path_idx = 0; path_idx < paths.size(); path_idx++)
         {
@@ -1507,9 +1679,9 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                 speed *= extruder_plan.getExtrudeSpeedFactor();
             }
             //This seems to be the best location to place this, but still not ideal.
-            if (path.mesh_id != current_mesh)
+            if (*path.mesh_id != current_mesh)
             {
-                current_mesh = path.mesh_id;
+                current_mesh = *path.mesh_id;
                 std::stringstream ss;
                 ss << "MESH:" << current_mesh;
                 gcode.writeComment(ss.str());
@@ -1530,17 +1702,20 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                 const double path_fan_speed = path.getFanSpeed();
                 gcode.writeFanCommand(path_fan_speed != GCodePathConfig::FAN_SPEED_DEFAULT ? path_fan_speed : extruder_plan.getFanSpeed());
 
-                bool coasting = extruder.settings.get<bool>("coasting_enable");
+                bool coasting = coasting_enabled;
                 if (coasting)
                 {
                     coasting = writePathWithCoasting(gcode, extruder_plan_idx, path_idx, layer_thickness);
                 }
                 if (!coasting) // not same as 'else', cause we might have changed [coasting] in the line above...
                 { // normal path to gcode algorithm
+                    const coord_t line_width = path.getLineWidthForLayerView();
+                    const coord_t line_thickness = path.config->getLayerThickness();
+                    const double extrusion_mm3_per_mm = path.getExtrusionMM3perMM();
                     for(unsigned int point_idx = 0; point_idx < path.points.size(); point_idx++)
                     {
-                        communication->sendLineTo(path.config->type, path.points[point_idx], path.getLineWidthForLayerView(), path.config->getLayerThickness(), speed);
-                        gcode.writeExtrusion(path.points[point_idx], speed, path.getExtrusionMM3perMM(), path.config->type, update_extrusion_offset);
+                        communication->sendLineTo(path.config->type, path.points[point_idx], line_width, line_thickness, speed);
+                        gcode.writeExtrusion(path.points[point_idx], speed, extrusion_mm3_per_mm, path.config->type, update_extrusion_offset);
                     }
                 }
             }
@@ -1565,6 +1740,9 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                 for (; path_idx < paths.size() && paths[path_idx].spiralize; path_idx++)
                 { // handle all consecutive spiralized paths > CHANGES path_idx!
                     GCodePath& path = paths[path_idx];
+                    const coord_t line_width = path.getLineWidthForLayerView();
+                    const coord_t line_thickness = path.config->getLayerThickness();
+                    const double extrusion_mm3_per_mm = path.getExtrusionMM3perMM();
 
                     for (unsigned int point_idx = 0; point_idx < path.points.size(); point_idx++)
                     {
@@ -1572,8 +1750,8 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                         length += vSizeMM(p0 - p1);
                         p0 = p1;
                         gcode.setZ(z + layer_thickness * length / totalLength);
-                        communication->sendLineTo(path.config->type, path.points[point_idx], path.getLineWidthForLayerView(), path.config->getLayerThickness(), speed);
-                        gcode.writeExtrusion(path.points[point_idx], speed, path.getExtrusionMM3perMM(), path.config->type, update_extrusion_offset);
+                        communication->sendLineTo(path.config->type, path.points[point_idx], line_width, line_thickness, speed);
+                        gcode.writeExtrusion(path.points[point_idx], speed, extrusion_mm3_per_mm, path.config->type, update_extrusion_offset);
                     }
                     // for layer display only - the loop finished at the seam vertex but as we started from
                     // the location of the previous layer's seam vertex the loop may have a gap if this layer's
@@ -1584,7 +1762,7 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
                     // vertex would not be shifted (as it's the last vertex in the sequence). The smoother the model,
                     // the less the vertices are shifted and the less obvious is the ridge. If the layer display
                     // really displayed a spiral rather than slices of a spiral, this would not be required.
-                    communication->sendLineTo(path.config->type, path.points[0], path.getLineWidthForLayerView(), path.config->getLayerThickness(), speed);
+                    communication->sendLineTo(path.config->type, path.points[0], line_width, line_thickness, speed);
                 }
                 path_idx--; // the last path_idx didnt spiralize, so it's not part of the current spiralize path
             }
@@ -1613,6 +1791,7 @@ void LayerPlan::writeGCode(GCodeExport& gcode)
     } // extruder plans /\  .
     
     gcode.updateTotalPrintTime();
+    gcode.flushLayerBuffer();
 }
 
 void LayerPlan::overrideFanSpeeds(double speed)
@@ -1653,8 +1832,8 @@ bool LayerPlan::makeRetractSwitchRetract(unsigned int extruder_plan_idx, unsigne
 bool LayerPlan::writePathWithCoasting(GCodeExport& gcode, const size_t extruder_plan_idx, const size_t path_idx, const coord_t layer_thickness)
 {
     ExtruderPlan& extruder_plan = extruder_plans[extruder_plan_idx];
-    const ExtruderTrain& extruder = Application::getInstance().current_slice->scene.extruders[extruder_plan.extruder_nr];
-    const double coasting_volume = extruder.settings.get<double>("coasting_volume");
+    const ExtruderSettingsSnapshot& extruder_settings = storage.settings_snapshot_per_extruder[extruder_plan.extruder_nr];
+    const double coasting_volume = extruder_settings.coasting_volume;
     if (coasting_volume <= 0)
     { 
         return false; 
@@ -1674,7 +1853,7 @@ bool LayerPlan::writePathWithCoasting(GCodeExport& gcode, const size_t extruder_
     double extrude_speed = path.config->getSpeed() * extruder_plan.getExtrudeSpeedFactor() * path.speed_factor; // travel speed
     
     const coord_t coasting_dist = MM2INT(MM2_2INT(coasting_volume) / layer_thickness) / path.config->getLineWidth(); // closing brackets of MM2INT at weird places for precision issues
-    const double coasting_min_volume = extruder.settings.get<double>("coasting_min_volume");
+    const double coasting_min_volume = extruder_settings.coasting_min_volume;
     const coord_t coasting_min_dist = MM2INT(MM2_2INT(coasting_min_volume + coasting_volume) / layer_thickness) / path.config->getLineWidth(); // closing brackets of MM2INT at weird places for precision issues
     //           /\ the minimal distance when coasting will coast the full coasting volume instead of linearly less with linearly smaller paths
 
@@ -1742,37 +1921,42 @@ bool LayerPlan::writePathWithCoasting(GCodeExport& gcode, const size_t extruder_
         start = b + normal(a - b, residual_dist);
     }
 
+    const coord_t line_width = path.getLineWidthForLayerView();
+    const coord_t line_thickness = path.config->getLayerThickness();
+    const double extrusion_mm3_per_mm = path.getExtrusionMM3perMM();
     { // write normal extrude path:
         Communication* communication = Application::getInstance().communication;
         for(size_t point_idx = 0; point_idx <= point_idx_before_start; point_idx++)
         {
-            communication->sendLineTo(path.config->type, path.points[point_idx], path.getLineWidthForLayerView(), path.config->getLayerThickness(), extrude_speed);
-            gcode.writeExtrusion(path.points[point_idx], extrude_speed, path.getExtrusionMM3perMM(), path.config->type);
+            communication->sendLineTo(path.config->type, path.points[point_idx], line_width, line_thickness, extrude_speed);
+            gcode.writeExtrusion(path.points[point_idx], extrude_speed, extrusion_mm3_per_mm, path.config->type);
         }
-        communication->sendLineTo(path.config->type, start, path.getLineWidthForLayerView(), path.config->getLayerThickness(), extrude_speed);
-        gcode.writeExtrusion(start, extrude_speed, path.getExtrusionMM3perMM(), path.config->type);
+        communication->sendLineTo(path.config->type, start, line_width, line_thickness, extrude_speed);
+        gcode.writeExtrusion(start, extrude_speed, extrusion_mm3_per_mm, path.config->type);
     }
 
     // write coasting path
+    const Ratio coasting_speed_modifier = extruder_settings.coasting_speed;
+    const Velocity coasting_speed = Velocity(coasting_speed_modifier * path.config->getSpeed() * extruder_plan.getExtrudeSpeedFactor());
     for (size_t point_idx = point_idx_before_start + 1; point_idx < path.points.size(); point_idx++)
     {
-        const Ratio coasting_speed_modifier = extruder.settings.get<Ratio>("coasting_speed");
-        const Velocity speed = Velocity(coasting_speed_modifier * path.config->getSpeed() * extruder_plan.getExtrudeSpeedFactor());
-        gcode.writeTravel(path.points[point_idx], speed);
+        gcode.writeTravel(path.points[point_idx], coasting_speed);
     }
 
-    gcode.addLastCoastedVolume(path.getExtrusionMM3perMM() * INT2MM(actual_coasting_dist));
+    gcode.addLastCoastedVolume(extrusion_mm3_per_mm * INT2MM(actual_coasting_dist));
     return true;
 }
 
-void LayerPlan::optimizePaths(const Point& starting_position)
+void LayerPlan::optimizePaths(const Point& starting_position, TaskScheduler* task_scheduler)
 {
-    for (ExtruderPlan& extr_plan : extruder_plans)
+    const std::function<void (size_t)> optimize_extruder_plan = [this, &starting_position](const size_t extruder_plan_idx)
     {
+        ExtruderPlan& extr_plan = extruder_plans[extruder_plan_idx];
         //Merge paths whose endpoints are very close together into one line.
         MergeInfillLines merger(extr_plan);
         merger.mergeInfillLines(extr_plan.paths, starting_position);
-    }
+    };
+    TaskScheduler::processShared((extruder_plans.size() > 1) ? task_scheduler : nullptr, extruder_plans.size(), optimize_extruder_plan);
 }
 
 }//namespace cura
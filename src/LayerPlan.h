@@ -4,6 +4,8 @@
 #ifndef LAYER_PLAN_H
 #define LAYER_PLAN_H
 
+#include <algorithm> //For stable_sort.
+#include <memory> //For shared_ptr.
 #include <vector>
 
 #include "FanSpeedLayerTime.h"
@@ -17,6 +19,7 @@
 #include "settings/types/LayerIndex.h"
 #include "utils/optional.h"
 #include "utils/polygon.h"
+#include "utils/PolygonsInsideTester.h"
 
 namespace cura 
 {
@@ -25,6 +28,7 @@ class Comb;
 class LayerPlan; // forward declaration so that ExtruderPlan can be a friend
 class LayerPlanBuffer; // forward declaration so that ExtruderPlan can be a friend
 class SliceDataStorage;
+class TaskScheduler;
 class WallOverlapComputation;
 
 /*!
@@ -38,7 +42,8 @@ class ExtruderPlan
     friend class LayerPlanBuffer; // TODO: LayerPlanBuffer handles paths directly
 protected:
     std::vector<GCodePath> paths; //!< The paths planned for this extruder
-    std::list<NozzleTempInsert> inserts; //!< The nozzle temperature command inserts, to be inserted in between paths
+    std::vector<NozzleTempInsert> inserts; //!< The nozzle temperature command inserts, to be inserted in between paths. Sorted by path index just before writing, see \ref ExtruderPlan::sortInserts.
+    size_t next_insert_idx; //!< The first of the inserts which isn't written yet, while writing the paths.
 
     double heated_pre_travel_time; //!< The time at the start of this ExtruderPlan during which the head travels and has a temperature of initial_print_temperature
 
@@ -56,10 +61,14 @@ protected:
      */
     double required_start_temperature;
     std::optional<double> extrusion_temperature; //!< The normal temperature for printing this extruder plan. That start and end of this extruder plan may deviate because of the initial and final print temp (none if extruder plan has no extrusion moves)
-    std::optional<std::list<NozzleTempInsert>::iterator> extrusion_temperature_command; //!< The command to heat from the printing temperature of this extruder plan to the printing temperature of the next extruder plan (if it has the same extruder).
+    std::optional<size_t> extrusion_temperature_command; //!< The index in \ref ExtruderPlan::inserts of the command to heat from the printing temperature of this extruder plan to the printing temperature of the next extruder plan (if it has the same extruder).
     std::optional<double> prev_extruder_standby_temp; //!< The temperature to which to set the previous extruder. Not used if the previous extruder plan was the same extruder.
 
     TimeMaterialEstimates estimates; //!< Accumulated time and material estimates for all planned paths within this extruder plan.
+    size_t precomputed_estimates_start; //!< The first path of which the naive estimates have been computed beforehand, see \ref precomputeNaiveTimeEstimates.
+    size_t precomputed_estimates_end; //!< The path after the last one of which the naive estimates have been computed beforehand.
+    TimeMaterialEstimates precomputed_estimates; //!< The sum of the naive estimates of the paths that have been computed beforehand.
+    Point precomputed_estimates_end_position; //!< Where the print head is after the paths of which the naive estimates have been computed beforehand.
 
 public:
     size_t extruder_nr; //!< The extruder used for this paths in the current plan.
@@ -89,18 +98,37 @@ public:
         inserts.emplace_back(contructor_args...);
     }
 
+    /*!
+     * Sort the inserts by the path before which they are inserted, so that
+     * they can be written in a single pass over the paths.
+     *
+     * Inserts before the same path keep the order in which they were added.
+     * This must be called after all inserts are added and before the paths
+     * are written.
+     */
+    void sortInserts()
+    {
+        std::stable_sort(inserts.begin(), inserts.end(), [](const NozzleTempInsert& a, const NozzleTempInsert& b) -> bool
+            {
+                return a.path_idx < b.path_idx;
+            });
+        next_insert_idx = 0;
+    }
+
     /*!
      * Insert the inserts into gcode which should be inserted before \p path_idx
      * 
+     * The inserts must be sorted with \ref ExtruderPlan::sortInserts.
+     * 
      * \param path_idx The index into ExtruderPlan::paths which is currently being consider for temperature command insertion
      * \param gcode The gcode exporter to which to write the temperature command.
      */
     void handleInserts(unsigned int& path_idx, GCodeExport& gcode)
     {
-        while ( ! inserts.empty() && path_idx >= inserts.front().path_idx)
+        while (next_insert_idx < inserts.size() && path_idx >= inserts[next_insert_idx].path_idx)
         { // handle the Insert to be inserted before this path_idx (and all inserts not handled yet)
-            inserts.front().write(gcode);
-            inserts.pop_front();
+            inserts[next_insert_idx].write(gcode);
+            next_insert_idx++;
         }
     }
 
@@ -115,13 +143,14 @@ public:
      */
     void handleAllRemainingInserts(GCodeExport& gcode)
     { 
-        while ( ! inserts.empty() )
+        for (; next_insert_idx < inserts.size(); next_insert_idx++)
         { // handle the Insert to be inserted before this path_idx (and all inserts not handled yet)
-            NozzleTempInsert& insert = inserts.front();
+            NozzleTempInsert& insert = inserts[next_insert_idx];
             assert(insert.path_idx == paths.size());
             insert.write(gcode);
-            inserts.pop_front();
         }
+        inserts.clear();
+        next_insert_idx = 0;
     }
 
     /*!
@@ -214,6 +243,27 @@ protected:
      * \return the total estimates of this layer
      */
     TimeMaterialEstimates computeNaiveTimeEstimates(Point starting_position);
+
+    /*!
+     * Compute the naive time and material estimates of the paths which don't
+     * depend on where the previous layer ended, i.e. all paths after the first
+     * one with any points.
+     *
+     * This can be done as soon as the extruder plan is complete, so that
+     * \ref computeNaiveTimeEstimates only has to handle the first few paths.
+     */
+    void precomputeNaiveTimeEstimates();
+
+private:
+    /*!
+     * Compute the naive time and material estimates of a single path and add
+     * them to the estimates of that path.
+     *
+     * \param path The path to compute the estimates of.
+     * \param[in,out] p0 The position of the head before the path, which is
+     * moved to the end of the path.
+     */
+    void addNaiveTimeEstimates(GCodePath& path, Point& p0) const;
 };
 
 class LayerPlanBuffer; // forward declaration to prevent circular dependency
@@ -233,9 +283,11 @@ class LayerPlan : public NoCopy
     friend class LayerPlanBuffer;
 private:
     const SliceDataStorage& storage; //!< The polygon data obtained from FffPolygonProcessor
+    size_t tracked_memory = 0; //!< The number of bytes counted for this plan in the memory budget, see LayerPlan::trackMemory.
+    const std::shared_ptr<const PathConfigStorage> shared_configs_storage; //!< The line configs, which are shared with the other layers of the same kind and thickness. See SliceDataStorage::getPathConfigs.
 
 public:
-    const PathConfigStorage configs_storage; //!< The line configs for this layer for each feature type
+    const PathConfigStorage& configs_storage; //!< The line configs for this layer for each feature type
     int z;
     bool mode_skip_agressive_merge; //!< Wheter to give every new path the 'skip_agressive_merge_hint' property (see GCodePath); default is false.
 
@@ -249,7 +301,7 @@ private:
     std::vector<bool> has_prime_tower_planned_per_extruder; //!< For each extruder, whether the prime tower is planned yet or not.
     std::optional<Point> last_planned_position; //!< The last planned XY position of the print head (if known)
 
-    std::string current_mesh; //<! A unique ID for the mesh of the last planned move.
+    std::shared_ptr<const std::string> current_mesh; //<! A unique ID for the mesh of the last planned move, shared with the paths planned for it.
 
     /*!
      * Whether the skirt or brim polygons have been processed into planned paths
@@ -272,6 +324,8 @@ private:
     coord_t comb_move_inside_distance;  //!< Whenever using the minimum boundary for combing it tries to move the coordinates inside by this distance after calculating the combing.
     Polygons bridge_wall_mask; //!< The regions of a layer part that are not supported, used for bridging
     Polygons overhang_mask; //!< The regions of a layer part where the walls overhang
+    PolygonsInsideTester bridge_wall_mask_tester; //!< For testing whether the points of walls are inside #bridge_wall_mask.
+    PolygonsInsideTester overhang_mask_tester; //!< For testing whether the points of walls are inside #overhang_mask.
 
     const std::vector<FanSpeedLayerTimeSettings> fan_speed_layer_time_settings_per_extruder;
 
@@ -343,6 +397,39 @@ private:
      */
     Polygons computeCombBoundaryInside(const size_t max_inset);
 
+    /*!
+     * \brief Add lines to the gcode in the order determined by an optimizer.
+     * \param polygons The lines
+     * \param orderOptimizer The optimizer that ordered the lines.
+     * \param config The config of the lines
+     * \param space_fill_type The type of space filling used to generate the line segments
+     * \param wipe_dist The distance wiped without extruding after laying down a line.
+     * \param flow_ratio The ratio with which to multiply the extrusion amount
+     * \param fan_speed Fan speed override for this path
+     */
+    void addLinesInOrder(const Polygons& polygons, const LineOrderOptimizer& orderOptimizer, const GCodePathConfig& config, SpaceFillType space_fill_type, int wipe_dist, float flow_ratio, double fan_speed);
+
+    /*!
+     * \brief Get the length up to which \ref LayerPlan::addTravel moves
+     * straight to its destination, without combing and without retracting.
+     *
+     * Travels up to this length are ignored by \ref Comb::calc and are too
+     * short to retract for, so they can be planned with
+     * \ref LayerPlan::addTravel_simple right away. This doesn't hold for the
+     * first travel of a layer.
+     */
+    coord_t getStraightTravelDistance() const;
+
+    /*!
+     * \brief Whether the boundary within which to comb is different for
+     * different inset indices.
+     *
+     * If not, the boundary is computed only once.
+     * \return Whether \ref LayerPlan::computeCombBoundaryInside depends on its
+     * inset index.
+     */
+    bool combBoundaryDependsOnInset() const;
+
 public:
     int getLayerNr() const
     {
@@ -398,6 +485,24 @@ public:
      */
     std::optional<std::pair<Point, bool>> getFirstTravelDestinationState() const;
 
+    /*!
+     * \brief Estimate how much memory the planned paths of this layer take.
+     *
+     * This only counts the paths themselves, which make up the bulk of a
+     * layer plan. It's meant to limit how many layer plans are kept in memory
+     * at the same time.
+     * \return The estimated number of bytes.
+     */
+    size_t getMemoryUsage() const;
+
+    /*!
+     * \brief Count the memory of the planned paths in the memory budget until
+     * this plan is destroyed, if memory use is being tracked.
+     *
+     * This is meant to be called once the layer is completely planned.
+     */
+    void trackMemory();
+
     /*!
     * Set whether the next destination is inside a layer part or not.
     * 
@@ -436,6 +541,7 @@ public:
     void setBridgeWallMask(const Polygons& polys)
     {
         bridge_wall_mask = polys;
+        bridge_wall_mask_tester = PolygonsInsideTester(polys);
     }
 
     /*!
@@ -446,6 +552,7 @@ public:
     void setOverhangMask(const Polygons& polys)
     {
         overhang_mask = polys;
+        overhang_mask_tester = PolygonsInsideTester(polys);
     }
 
     /*!
@@ -578,6 +685,23 @@ public:
      */
     void addLinesByOptimizer(const Polygons& polygons, const GCodePathConfig& config, SpaceFillType space_fill_type, bool enable_travel_optimization = false, int wipe_dist = 0, float flow_ratio = 1.0, std::optional<Point> near_start_location = std::optional<Point>(), double fan_speed = GCodePathConfig::FAN_SPEED_DEFAULT);
 
+    /*!
+     * Add straight, parallel lines to the gcode, such as the lines of the
+     * lines pattern, in strips across the lines.
+     *
+     * This is much faster than \ref LayerPlan::addLinesByOptimizer for many
+     * lines, but the lines must all be parallel. See
+     * \ref LineOrderOptimizer::optimizeParallel.
+     * \param lines The lines
+     * \param config The config of the lines
+     * \param space_fill_type The type of space filling used to generate the line segments (should be either Lines or PolyLines!)
+     * \param wipe_dist (optional) the distance wiped without extruding after laying down a line.
+     * \param flow_ratio The ratio with which to multiply the extrusion amount
+     * \param near_start_location Optional: Location near where to add the first line. If not provided the last position is used.
+     * \param fan_speed optional fan speed override for this path
+     */
+    void addParallelLines(const Polygons& lines, const GCodePathConfig& config, SpaceFillType space_fill_type, int wipe_dist = 0, float flow_ratio = 1.0, std::optional<Point> near_start_location = std::optional<Point>(), double fan_speed = GCodePathConfig::FAN_SPEED_DEFAULT);
+
     /*!
      * Add a spiralized slice of wall that is interpolated in X/Y between \p last_wall and \p wall.
      *
@@ -640,6 +764,17 @@ public:
      * \param starting_position The position of the print head when the first extruder plan of this layer starts
      */
     void processFanSpeedAndMinimalLayerTime(Point starting_position);
+
+    /*!
+     * Compute the naive time and material estimates of all paths which don't
+     * depend on where the previous layer ended.
+     *
+     * This is meant to be called as soon as the layer is planned, so that it
+     * happens in parallel for multiple layers, while
+     * \ref processFanSpeedAndMinimalLayerTime has to wait for the previous
+     * layer.
+     */
+    void precomputeNaiveTimeEstimates();
     
     /*!
      * Add a travel move to the layer plan to move inside the current layer part by a given distance away from the outline.
@@ -651,9 +786,12 @@ public:
 
     /*!
      * Having all extruder plans ready including travels, we can now optimize the final result by merging some lines together
+     * 
+     * The extruder plans are independent, so they're optimized at the same time when the layer has several of them.
      * \param starting_position Start from this coordinate.
+     * \param task_scheduler The scheduler whose idle threads may help optimizing the extruder plans, or nullptr to optimize them all on the calling thread.
      * */
-    void optimizePaths(const Point& starting_position);
+    void optimizePaths(const Point& starting_position, TaskScheduler* task_scheduler = nullptr);
 };
 
 }//namespace cura
@@ -17,6 +17,11 @@ namespace cura {
 
 constexpr Duration LayerPlanBuffer::extra_preheat_time;
 
+void LayerPlanBuffer::setPreheatConfig()
+{
+    preheat_config.setConfig();
+}
+
 void LayerPlanBuffer::push(LayerPlan& layer_plan)
 {
     buffer.push_back(&layer_plan);
@@ -282,7 +287,7 @@ void LayerPlanBuffer::insertTempCommands(std::vector<ExtruderPlan*>& extruder_pl
     if (prev_extruder == extruder)
     {
         insertPreheatCommand_singleExtrusion(*prev_extruder_plan, extruder, extruder_plan.required_start_temperature);
-        prev_extruder_plan->extrusion_temperature_command = --prev_extruder_plan->inserts.end();
+        prev_extruder_plan->extrusion_temperature_command = prev_extruder_plan->inserts.size() - 1;
     }
     else 
     {
@@ -422,7 +427,8 @@ void LayerPlanBuffer::insertFinalPrintTempCommand(std::vector<ExtruderPlan*>& ex
             precool_extruder_plan = extruder_plans[precool_extruder_plan_idx];
             if (precool_extruder_plan->extrusion_temperature_command)
             { // the precool command ends up before the command to go to the print temperature of the next extruder plan, so remove that print temp command
-                precool_extruder_plan->inserts.erase(*precool_extruder_plan->extrusion_temperature_command);
+                precool_extruder_plan->inserts.erase(precool_extruder_plan->inserts.begin() + *precool_extruder_plan->extrusion_temperature_command);
+                precool_extruder_plan->extrusion_temperature_command = nullptr;
             }
             double time_here = precool_extruder_plan->estimates.getTotalTime();
             if (cool_down_time < time_here)
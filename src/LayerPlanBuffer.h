@@ -34,9 +34,6 @@ class LayerPlanBuffer
 
     Preheat preheat_config; //!< the nozzle and material temperature settings for each extruder train.
 
-    static constexpr size_t buffer_size = 5; // should be as low as possible while still allowing enough time in the buffer to heat up from standby temp to printing temp // TODO: hardcoded value
-    // this value should be higher than 1, cause otherwise each layer is viewed as the first layer and no temp commands are inserted.
-
     static constexpr Duration extra_preheat_time = 1.0_s; //!< Time to start heating earlier than computed to avoid accummulative discrepancy between actual heating times and computed ones.
 
     std::vector<bool> extruder_used_in_meshgroup; //!< For each extruder whether it has already been planned once in this meshgroup. This is used to see whether we should heat to the initial_print_temp or to the extrusion_temperature
@@ -49,11 +46,20 @@ class LayerPlanBuffer
      */
     std::list<LayerPlan*> buffer;
 public:
+    static constexpr size_t buffer_size = 5; // should be as low as possible while still allowing enough time in the buffer to heat up from standby temp to printing temp // TODO: hardcoded value
+    // this value should be higher than 1, cause otherwise each layer is viewed as the first layer and no temp commands are inserted.
+
     LayerPlanBuffer(GCodeExport& gcode)
     : gcode(gcode)
     , extruder_used_in_meshgroup(MAX_EXTRUDERS, false)
     { }
 
+    /*!
+     * Read the temperature settings for the current mesh group.
+     * 
+     * This must be called before any layer plan of the mesh group is pushed
+     * into the buffer.
+     */
     void setPreheatConfig();
 
     /*!
@@ -0,0 +1,512 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For min.
+#include <cstring> //For memcpy.
+
+#ifndef _WIN32
+#include <cerrno> //To retry interrupted writes.
+#include <cstdlib> //For mkstemp.
+#include <sys/mman.h> //For mmap.
+#include <unistd.h> //For write, pread, close and unlink.
+#endif
+
+#include "LayerSpill.h"
+#include "sliceDataStorage.h"
+#include "utils/logoutput.h"
+#include "utils/MemoryBudget.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Write polygons, with each point relative to the point before it.
+ */
+static void writePolygons(BinaryWriter& writer, const Polygons& polygons, Point& last_point)
+{
+    writer.writeUnsigned(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        writer.writeUnsigned(polygon.size());
+        for (const Point& point : polygon)
+        {
+            writer.writeSigned(point.X - last_point.X);
+            writer.writeSigned(point.Y - last_point.Y);
+            last_point = point;
+        }
+    }
+}
+
+/*!
+ * \brief Read polygons that were written with \ref writePolygons.
+ */
+static bool readPolygons(BinaryReader& reader, Polygons& polygons, Point& last_point)
+{
+    uint64_t polygon_count;
+    if (!reader.readUnsigned(polygon_count))
+    {
+        return false;
+    }
+    for (uint64_t polygon_idx = 0; polygon_idx < polygon_count; polygon_idx++)
+    {
+        uint64_t point_count;
+        if (!reader.readUnsigned(point_count))
+        {
+            return false;
+        }
+        PolygonRef polygon = polygons.newPoly();
+        for (uint64_t point_idx = 0; point_idx < point_count; point_idx++)
+        {
+            int64_t delta_x;
+            int64_t delta_y;
+            if (!reader.readSigned(delta_x) || !reader.readSigned(delta_y))
+            {
+                return false;
+            }
+            last_point = Point(last_point.X + delta_x, last_point.Y + delta_y);
+            polygon.add(last_point);
+        }
+    }
+    return true;
+}
+
+static void writePolygonsList(BinaryWriter& writer, const std::vector<Polygons>& polygons_list, Point& last_point)
+{
+    writer.writeUnsigned(polygons_list.size());
+    for (const Polygons& polygons : polygons_list)
+    {
+        writePolygons(writer, polygons, last_point);
+    }
+}
+
+static bool readPolygonsList(BinaryReader& reader, std::vector<Polygons>& polygons_list, Point& last_point)
+{
+    uint64_t size;
+    if (!reader.readUnsigned(size))
+    {
+        return false;
+    }
+    polygons_list.resize(size);
+    for (Polygons& polygons : polygons_list)
+    {
+        if (!readPolygons(reader, polygons, last_point))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writePolygonsLists(BinaryWriter& writer, const std::vector<std::vector<Polygons>>& polygons_lists, Point& last_point)
+{
+    writer.writeUnsigned(polygons_lists.size());
+    for (const std::vector<Polygons>& polygons_list : polygons_lists)
+    {
+        writePolygonsList(writer, polygons_list, last_point);
+    }
+}
+
+static bool readPolygonsLists(BinaryReader& reader, std::vector<std::vector<Polygons>>& polygons_lists, Point& last_point)
+{
+    uint64_t size;
+    if (!reader.readUnsigned(size))
+    {
+        return false;
+    }
+    polygons_lists.resize(size);
+    for (std::vector<Polygons>& polygons_list : polygons_lists)
+    {
+        if (!readPolygonsList(reader, polygons_list, last_point))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeAABB(BinaryWriter& writer, const AABB& box)
+{
+    writer.writeSigned(box.min.X);
+    writer.writeSigned(box.min.Y);
+    writer.writeSigned(box.max.X);
+    writer.writeSigned(box.max.Y);
+}
+
+static bool readAABB(BinaryReader& reader, AABB& box)
+{
+    int64_t min_x, min_y, max_x, max_y;
+    if (!reader.readSigned(min_x) || !reader.readSigned(min_y) || !reader.readSigned(max_x) || !reader.readSigned(max_y))
+    {
+        return false;
+    }
+    box.min = Point(min_x, min_y);
+    box.max = Point(max_x, max_y);
+    return true;
+}
+
+/*!
+ * \brief Write a floating point number exactly, as its bits.
+ */
+static void writeDouble(BinaryWriter& writer, const double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    writer.writeUnsigned(bits);
+}
+
+static bool readDouble(BinaryReader& reader, double& value)
+{
+    uint64_t bits;
+    if (!reader.readUnsigned(bits))
+    {
+        return false;
+    }
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+LayerSpill::LayerSpill()
+: is_in_memory(false)
+, file_descriptor(-1)
+, file_size(0)
+, mapped_data(nullptr)
+{
+}
+
+LayerSpill::~LayerSpill()
+{
+    if (is_in_memory)
+    {
+        size_t bytes = 0;
+        for (const Record& record : records)
+        {
+            bytes += record.data.size();
+        }
+        MemoryBudget& budget = MemoryBudget::getInstance();
+        budget.subtract(MemoryAccount::COMPRESSED_LAYERS, std::min(bytes, budget.get(MemoryAccount::COMPRESSED_LAYERS)));
+    }
+#ifndef _WIN32
+    if (mapped_data)
+    {
+        munmap(const_cast<char*>(mapped_data), file_size);
+    }
+    if (file_descriptor >= 0)
+    {
+        close(file_descriptor);
+    }
+#endif
+}
+
+bool LayerSpill::open(const std::string& directory)
+{
+#ifdef _WIN32
+    logError("Spilling layers to %s isn't supported on this platform.\n", directory.c_str());
+    return false;
+#else
+    std::string filename = directory + "/CuraEngine-layers-XXXXXX";
+    file_descriptor = mkstemp(&filename[0]);
+    if (file_descriptor < 0)
+    {
+        logError("Couldn't create a file in %s to spill layers to.\n", directory.c_str());
+        return false;
+    }
+    unlink(filename.c_str()); //The file stays until it's closed, but nobody else can find it.
+    return true;
+#endif
+}
+
+void LayerSpill::keepInMemory()
+{
+    is_in_memory = true;
+}
+
+bool LayerSpill::write(const LayerIndex layer_nr, const std::string& record)
+{
+    if (mapped_data || layer_nr != static_cast<LayerIndex>(records.size()))
+    {
+        return false;
+    }
+    if (is_in_memory)
+    {
+        records.push_back({0, record.size(), false, record});
+        MemoryBudget::getInstance().add(MemoryAccount::COMPRESSED_LAYERS, record.size());
+        return true;
+    }
+#ifndef _WIN32
+    if (file_descriptor < 0)
+    {
+        return false;
+    }
+    size_t written = 0;
+    while (written < record.size())
+    {
+        const ssize_t result = ::write(file_descriptor, record.data() + written, record.size() - written);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            logError("Couldn't spill layer %d to disk. Is the disk full?\n", static_cast<int>(layer_nr));
+            return false; //The part of the record that was written is never read.
+        }
+        written += result;
+    }
+    records.push_back({file_size, record.size(), false, std::string()});
+    file_size += record.size();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LayerSpill::map()
+{
+    record_mutexes.reset(new std::mutex[records.size()]);
+#ifndef _WIN32
+    if (file_descriptor < 0 || file_size == 0)
+    {
+        return true;
+    }
+    void* view = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (view == MAP_FAILED)
+    {
+        logWarning("Couldn't map the spilled layers into memory. Reading them from the file instead.\n");
+        return false;
+    }
+    mapped_data = static_cast<const char*>(view);
+#endif
+    return true;
+}
+
+void LayerSpill::pageIn(const LayerIndex layer_nr, const std::function<void (BinaryReader&)>& restore)
+{
+    if (layer_nr < 0 || layer_nr >= static_cast<LayerIndex>(records.size()) || !record_mutexes)
+    {
+        return;
+    }
+    Record& record = records[layer_nr];
+    std::lock_guard<std::mutex> lock(record_mutexes[layer_nr]);
+    if (record.is_paged_in)
+    {
+        return;
+    }
+    record.is_paged_in = true;
+    if (is_in_memory)
+    {
+        BinaryReader reader(record.data);
+        restore(reader);
+        MemoryBudget& budget = MemoryBudget::getInstance();
+        budget.subtract(MemoryAccount::COMPRESSED_LAYERS, std::min(record.data.size(), budget.get(MemoryAccount::COMPRESSED_LAYERS)));
+        std::string().swap(record.data);
+        return;
+    }
+#ifndef _WIN32
+    if (mapped_data)
+    {
+        BinaryReader reader(mapped_data + record.offset, record.size);
+        restore(reader);
+        //The pages of the record are read only once, so let the system drop them rather than something else.
+        const size_t page_size = sysconf(_SC_PAGESIZE);
+        const size_t first_page = record.offset / page_size * page_size;
+        madvise(const_cast<char*>(mapped_data) + first_page, record.offset + record.size - first_page, MADV_DONTNEED);
+        return;
+    }
+    std::string data(record.size, '\0');
+    size_t read = 0;
+    while (read < record.size)
+    {
+        const ssize_t result = pread(file_descriptor, &data[read], record.size - read, record.offset + read);
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (result <= 0)
+        {
+            break;
+        }
+        read += result;
+    }
+    data.resize(read); //A short read is reported as a corrupt record by the one restoring it.
+    BinaryReader reader(data);
+    restore(reader);
+#endif
+}
+
+void LayerSpill::writeLayer(BinaryWriter& writer, const SliceLayer& layer)
+{
+    Point last_point(0, 0);
+    writePolygons(writer, layer.openPolyLines, last_point);
+    writePolygons(writer, layer.top_surface.areas, last_point);
+    writer.writeUnsigned(layer.parts.size());
+    for (const SliceLayerPart& part : layer.parts)
+    {
+        writeAABB(writer, part.boundaryBox);
+        writePolygons(writer, part.outline, last_point);
+        writePolygons(writer, part.print_outline, last_point);
+        writePolygonsList(writer, part.insets, last_point);
+        writePolygons(writer, part.perimeter_gaps, last_point);
+        writePolygons(writer, part.outline_gaps, last_point);
+        writer.writeUnsigned(part.skin_parts.size());
+        for (const SkinPart& skin_part : part.skin_parts)
+        {
+            writePolygons(writer, skin_part.outline, last_point);
+            writePolygonsList(writer, skin_part.insets, last_point);
+            writePolygons(writer, skin_part.perimeter_gaps, last_point);
+            writePolygons(writer, skin_part.inner_infill, last_point);
+            writePolygons(writer, skin_part.roofing_fill, last_point);
+        }
+        writer.writeUnsigned(part.is_enclosed);
+        writePolygons(writer, part.infill_area, last_point);
+        writer.writeUnsigned(static_cast<bool>(part.infill_area_own));
+        if (part.infill_area_own)
+        {
+            writePolygons(writer, *part.infill_area_own, last_point);
+        }
+        writePolygonsLists(writer, part.infill_area_per_combine_per_density, last_point);
+        writePolygonsList(writer, part.infill_polygons_per_combine, last_point);
+        writePolygonsList(writer, part.infill_lines_per_combine, last_point);
+        writer.writeUnsigned(part.spaghetti_infill_volumes.size());
+        for (const std::pair<Polygons, double>& volume : part.spaghetti_infill_volumes)
+        {
+            writePolygons(writer, volume.first, last_point);
+            writeDouble(writer, volume.second);
+        }
+    }
+}
+
+bool LayerSpill::readLayer(BinaryReader& reader, SliceLayer& layer)
+{
+    Point last_point(0, 0);
+    uint64_t part_count;
+    if (!readPolygons(reader, layer.openPolyLines, last_point) || !readPolygons(reader, layer.top_surface.areas, last_point) || !reader.readUnsigned(part_count))
+    {
+        return false;
+    }
+    layer.parts.resize(part_count);
+    for (SliceLayerPart& part : layer.parts)
+    {
+        SliceLayerPart read_part;
+        read_part.wall_overlap_linkers = std::move(part.wall_overlap_linkers);
+        uint64_t skin_part_count;
+        if (!readAABB(reader, read_part.boundaryBox)
+            || !readPolygons(reader, read_part.outline, last_point)
+            || !readPolygons(reader, read_part.print_outline, last_point)
+            || !readPolygonsList(reader, read_part.insets, last_point)
+            || !readPolygons(reader, read_part.perimeter_gaps, last_point)
+            || !readPolygons(reader, read_part.outline_gaps, last_point)
+            || !reader.readUnsigned(skin_part_count))
+        {
+            return false;
+        }
+        read_part.skin_parts.resize(skin_part_count);
+        for (SkinPart& skin_part : read_part.skin_parts)
+        {
+            if (!readPolygons(reader, skin_part.outline, last_point)
+                || !readPolygonsList(reader, skin_part.insets, last_point)
+                || !readPolygons(reader, skin_part.perimeter_gaps, last_point)
+                || !readPolygons(reader, skin_part.inner_infill, last_point)
+                || !readPolygons(reader, skin_part.roofing_fill, last_point))
+            {
+                return false;
+            }
+        }
+        uint64_t is_enclosed;
+        uint64_t has_infill_area_own;
+        if (!reader.readUnsigned(is_enclosed) || !readPolygons(reader, read_part.infill_area, last_point) || !reader.readUnsigned(has_infill_area_own))
+        {
+            return false;
+        }
+        read_part.is_enclosed = is_enclosed;
+        if (has_infill_area_own)
+        {
+            read_part.infill_area_own.emplace();
+            if (!readPolygons(reader, *read_part.infill_area_own, last_point))
+            {
+                return false;
+            }
+        }
+        uint64_t volume_count;
+        if (!readPolygonsLists(reader, read_part.infill_area_per_combine_per_density, last_point)
+            || !readPolygonsList(reader, read_part.infill_polygons_per_combine, last_point)
+            || !readPolygonsList(reader, read_part.infill_lines_per_combine, last_point)
+            || !reader.readUnsigned(volume_count))
+        {
+            return false;
+        }
+        read_part.spaghetti_infill_volumes.resize(volume_count);
+        for (std::pair<Polygons, double>& volume : read_part.spaghetti_infill_volumes)
+        {
+            if (!readPolygons(reader, volume.first, last_point) || !readDouble(reader, volume.second))
+            {
+                return false;
+            }
+        }
+        part = std::move(read_part);
+    }
+    layer.indexParts();
+    return true;
+}
+
+void LayerSpill::writeLayer(BinaryWriter& writer, const SupportLayer& layer)
+{
+    Point last_point(0, 0);
+    writer.writeUnsigned(layer.support_infill_parts.size());
+    for (const SupportInfillPart& part : layer.support_infill_parts)
+    {
+        writePolygons(writer, part.outline, last_point);
+        writePolygonsList(writer, part.insets, last_point);
+        writeAABB(writer, part.outline_boundary_box);
+        writer.writeSigned(part.support_line_width);
+        writer.writeSigned(part.inset_count_to_generate);
+        writePolygonsLists(writer, part.infill_area_per_combine_per_density, last_point);
+        writePolygons(writer, part.infill_area, last_point);
+    }
+    writePolygons(writer, layer.support_bottom, last_point);
+    writePolygons(writer, layer.support_roof, last_point);
+    writePolygons(writer, layer.support_mesh_drop_down, last_point);
+    writePolygons(writer, layer.support_mesh, last_point);
+    writePolygons(writer, layer.anti_overhang, last_point);
+}
+
+bool LayerSpill::readLayer(BinaryReader& reader, SupportLayer& layer)
+{
+    Point last_point(0, 0);
+    uint64_t part_count;
+    if (!reader.readUnsigned(part_count))
+    {
+        return false;
+    }
+    layer.support_infill_parts.clear();
+    layer.support_infill_parts.reserve(part_count);
+    for (uint64_t part_idx = 0; part_idx < part_count; part_idx++)
+    {
+        PolygonsPart outline;
+        if (!readPolygons(reader, outline, last_point))
+        {
+            return false;
+        }
+        layer.support_infill_parts.emplace_back(outline, 0);
+        SupportInfillPart& part = layer.support_infill_parts.back();
+        int64_t support_line_width;
+        int64_t inset_count_to_generate;
+        if (!readPolygonsList(reader, part.insets, last_point)
+            || !readAABB(reader, part.outline_boundary_box)
+            || !reader.readSigned(support_line_width)
+            || !reader.readSigned(inset_count_to_generate)
+            || !readPolygonsLists(reader, part.infill_area_per_combine_per_density, last_point)
+            || !readPolygons(reader, part.infill_area, last_point))
+        {
+            return false;
+        }
+        part.support_line_width = support_line_width;
+        part.inset_count_to_generate = inset_count_to_generate;
+    }
+    return readPolygons(reader, layer.support_bottom, last_point)
+        && readPolygons(reader, layer.support_roof, last_point)
+        && readPolygons(reader, layer.support_mesh_drop_down, last_point)
+        && readPolygons(reader, layer.support_mesh, last_point)
+        && readPolygons(reader, layer.anti_overhang, last_point);
+}
+
+} //namespace cura
@@ -0,0 +1,148 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef LAYER_SPILL_H
+#define LAYER_SPILL_H
+
+#include <functional>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "settings/types/LayerIndex.h"
+#include "utils/BinaryBuffer.h"
+
+namespace cura
+{
+
+class SliceLayer;
+class SupportLayer;
+
+/*!
+ * \brief Keeps the geometry of layers in a compact form while they aren't
+ * needed, so that the geometry of a giant print doesn't all have to fit in
+ * memory at once.
+ *
+ * Each layer is written as a single record in which the coordinates are delta
+ * encoded, which takes a third or less of the memory of the polygons. The
+ * records are either kept in memory or written to a scratch file one after
+ * another. Once all layers are written, the file is mapped into memory and
+ * the layers are read back when they are needed, each at most once. The file
+ * is removed as soon as it's created, so it disappears when the spill is
+ * destroyed, also if the engine crashes.
+ *
+ * See \ref SliceDataStorage::spillLayers for what is kept in the records.
+ */
+class LayerSpill
+{
+public:
+    LayerSpill();
+
+    ~LayerSpill();
+
+    /*!
+     * \brief Create the scratch file.
+     * \param directory The directory to create the file in.
+     * \return Whether the file could be created. If not, an error was logged.
+     */
+    bool open(const std::string& directory);
+
+    /*!
+     * \brief Keep the records in memory instead of in a file.
+     *
+     * This is called instead of \ref LayerSpill::open. The memory that the
+     * records take is counted in the memory budget.
+     */
+    void keepInMemory();
+
+    /*!
+     * \brief Add the record of the next layer.
+     *
+     * The layers must be written in order, starting at layer 0.
+     * \param layer_nr The layer that the record is of.
+     * \param record The geometry of the layer.
+     * \return Whether the record could be written. If not, an error was
+     * logged and the layer must be kept in memory.
+     */
+    bool write(const LayerIndex layer_nr, const std::string& record);
+
+    /*!
+     * \brief Map the file into memory, once all records are written.
+     *
+     * Only after this the layers can be read back.
+     * \return Whether the file could be mapped. If not, a warning was logged
+     * and the layers are read from the file instead.
+     */
+    bool map();
+
+    /*!
+     * \brief Read back the record of a layer, unless it was read already.
+     *
+     * This may be called from several threads at once. If another thread
+     * reads the same layer, this waits until it's done, so that the layer is
+     * complete when this returns.
+     * \param layer_nr The layer to read.
+     * \param restore Function that puts the geometry in the record back.
+     */
+    void pageIn(const LayerIndex layer_nr, const std::function<void (BinaryReader&)>& restore);
+
+    /*!
+     * \brief Write the geometry of a layer of a mesh.
+     *
+     * The height and thickness of the layer and the wall overlap linkers of
+     * its parts are not written. Those are kept in memory.
+     * \param writer The record to write to.
+     * \param layer The layer to write.
+     */
+    static void writeLayer(BinaryWriter& writer, const SliceLayer& layer);
+
+    /*!
+     * \brief Read the geometry of a layer of a mesh, written with
+     * \ref LayerSpill::writeLayer.
+     * \param reader The record to read from.
+     * \param[out] layer The layer to fill in, which has no geometry yet. The
+     * parts that it already has keep their wall overlap linkers.
+     * \return Whether the geometry could be read.
+     */
+    static bool readLayer(BinaryReader& reader, SliceLayer& layer);
+
+    /*!
+     * \brief Write the geometry of a layer of support.
+     * \param writer The record to write to.
+     * \param layer The layer to write.
+     */
+    static void writeLayer(BinaryWriter& writer, const SupportLayer& layer);
+
+    /*!
+     * \brief Read the geometry of a layer of support, written with
+     * \ref LayerSpill::writeLayer.
+     * \param reader The record to read from.
+     * \param[out] layer The layer to fill in, which has no geometry yet.
+     * \return Whether the geometry could be read.
+     */
+    static bool readLayer(BinaryReader& reader, SupportLayer& layer);
+
+private:
+    /*!
+     * \brief Where the record of a layer is in the file.
+     */
+    struct Record
+    {
+        size_t offset; //!< The position of the record in the file, in bytes.
+        size_t size; //!< The size of the record, in bytes.
+        bool is_paged_in; //!< Whether the layer was read back already.
+        std::string data; //!< The record itself, if the records are kept in memory, until it's read back.
+    };
+
+    bool is_in_memory; //!< Whether the records are kept in memory rather than in a file.
+    int file_descriptor; //!< The scratch file, or -1 if it isn't open.
+    size_t file_size; //!< The number of bytes written to the file so far.
+    const char* mapped_data; //!< The file mapped into memory, or nullptr if it isn't.
+    std::vector<Record> records; //!< For each layer where its record is.
+    std::unique_ptr<std::mutex[]> record_mutexes; //!< For each layer a lock that's held while it's read back. Made by \ref LayerSpill::map.
+};
+
+} //namespace cura
+
+#endif //LAYER_SPILL_H
@@ -1,6 +1,9 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For max.
+#include <utility> //For move.
+
 #include "Application.h" //To get settings.
 #include "ExtruderTrain.h"
 #include "LayerPlan.h"
@@ -233,9 +236,8 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
             1c. If they are merged, check next that the first line can be merged
                 with the line after the second line.
             2. Do a second iteration over all paths to remove the tombstones. */
-        std::vector<size_t> remove_path_indices;
-        std::set<size_t> is_merged;
-        std::set<size_t> removed;  // keep track of what we already removed, so don't remove it again
+        std::vector<size_t> remove_path_indices; // in increasing order
+        bool first_is_already_merged = false; // whether anything has been merged into the current first path
 
         //For each two adjacent lines, see if they can be merged.
         size_t first_path_index = 0;
@@ -274,6 +276,7 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
             {
                 first_path_index = second_path_index;
                 first_path_start = second_path_start;
+                first_is_already_merged = false;
                 has_first_path = true;
                 continue;
             }
@@ -301,7 +304,6 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
             {
                 allow_try_merge = false;
             }
-            const bool first_is_already_merged = is_merged.find(first_path_index) != is_merged.end();
             if ((!first_is_already_merged && first_path.points.size() > 1) || second_path.points.size() > 1)
             {
                 // For now we only merge simple lines, not polylines, to keep it simple.
@@ -319,15 +321,14 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
                 }
                 /* If we combine two lines, the next path may also be merged into the fist line, so we do NOT update
                 first_path_index. */
-                for (size_t to_delete_index = first_path_index + 1; to_delete_index <= second_path_index; to_delete_index++)
+                // if there are line(s) between first and second, then those lines are already marked as to be deleted, only add the new line(s)
+                // the paths are marked in increasing order, so those are all paths up to the last one that is marked
+                const size_t first_to_delete_index = remove_path_indices.empty() ? first_path_index + 1 : std::max(first_path_index + 1, remove_path_indices.back() + 1);
+                for (size_t to_delete_index = first_to_delete_index; to_delete_index <= second_path_index; to_delete_index++)
                 {
-                    if (removed.find(to_delete_index) == removed.end())  // if there are line(s) between first and second, then those lines are already marked as to be deleted, only add the new line(s)
-                    {
-                        remove_path_indices.push_back(to_delete_index);
-                        removed.insert(to_delete_index);
-                    }
+                    remove_path_indices.push_back(to_delete_index);
                 }
-                is_merged.insert(first_path_index);
+                first_is_already_merged = true;
             }
             else
             {
@@ -335,6 +336,7 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
                 second path with the line after it. */
                 first_path_index = second_path_index;
                 first_path_start = second_path_start;
+                first_is_already_merged = false;
             }
         }
 
@@ -346,12 +348,12 @@ MergeInfillLines::MergeInfillLines(ExtruderPlan& plan)
             {
                 for (; path_index < remove_path_indices[removed_position] - removed_position; path_index++)
                 {
-                    paths[path_index] = paths[path_index + removed_position]; //Shift all paths.
+                    paths[path_index] = std::move(paths[path_index + removed_position]); //Shift all paths.
                 }
             }
             for (; path_index < paths.size() - remove_path_indices.size(); path_index++) //Remaining shifts at the end.
             {
-                paths[path_index] = paths[path_index + remove_path_indices.size()];
+                paths[path_index] = std::move(paths[path_index + remove_path_indices.size()]);
             }
             paths.erase(paths.begin() + path_index, paths.end());
             return true;
@@ -4,6 +4,14 @@
 #include <string.h>
 #include <stdio.h>
 #include <limits>
+#include <vector>
+
+#ifndef _WIN32
+    #include <fcntl.h> //open
+    #include <sys/mman.h> //mmap
+    #include <sys/stat.h> //fstat
+    #include <unistd.h> //close
+#endif // _WIN32
 
 #include "MeshGroup.h"
 #include "utils/floatpoint.h"
@@ -112,58 +120,126 @@ bool loadMeshSTL_ascii(Mesh* mesh, const char* filename, const FMatrix3x3& matri
     FILE* f = fopen(filename, "rt");
     char buffer[1024];
     FPoint3 vertex;
-    int n = 0;
-    Point3 v0(0,0,0), v1(0,0,0), v2(0,0,0);
+    std::vector<FPoint3> float_corners;
     while(fgets_(buffer, sizeof(buffer), f))
     {
         if (sscanf(buffer, " vertex %f %f %f", &vertex.x, &vertex.y, &vertex.z) == 3)
         {
-            n++;
-            switch(n)
-            {
-            case 1:
-                v0 = matrix.apply(vertex);
-                break;
-            case 2:
-                v1 = matrix.apply(vertex);
-                break;
-            case 3:
-                v2 = matrix.apply(vertex);
-                mesh->addFace(v0, v1, v2);
-                n = 0;
-                break;
-            }
+            float_corners.push_back(vertex);
         }
     }
     fclose(f);
+
+    //Transform all corners in one go and add them as a whole, like the binary files.
+    std::vector<Point3> corners(float_corners.size());
+    #pragma omp parallel for schedule(static)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (long long corner_idx = 0; corner_idx < static_cast<long long>(corners.size()); corner_idx++)
+    {
+        corners[corner_idx] = matrix.apply(float_corners[corner_idx]);
+    }
+    mesh->addFaces(corners); //Ignores the corners of an incomplete face at the end.
     mesh->finish();
     return true;
 }
 
-bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
+/*!
+ * A read-only view on the complete contents of a file.
+ *
+ * Where possible the file is memory-mapped, so that it doesn't need to be
+ * copied. Otherwise it is read into memory in one go.
+ */
+class FileContents
 {
-    FILE* f = fopen(filename, "rb");
+public:
+    FileContents(const char* filename)
+    : contents(nullptr)
+    , length(0)
+    {
+#ifndef _WIN32
+        const int file_descriptor = open(filename, O_RDONLY);
+        if (file_descriptor < 0)
+        {
+            return;
+        }
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) == 0 && file_status.st_size > 0)
+        {
+            void* mapped = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            if (mapped != MAP_FAILED)
+            {
+                contents = static_cast<const char*>(mapped);
+                length = file_status.st_size;
+            }
+        }
+        close(file_descriptor); //The mapping stays valid after closing.
+        if (contents)
+        {
+            return;
+        }
+#endif // _WIN32
+        FILE* f = fopen(filename, "rb");
+        if (!f)
+        {
+            return;
+        }
+        fseek(f, 0L, SEEK_END);
+        const long long file_size = ftell(f); //The file size is the position of the cursor after seeking to the end.
+        rewind(f); //Seek back to start.
+        if (file_size > 0)
+        {
+            buffer.resize(file_size);
+            if (fread(&buffer[0], file_size, 1, f) == 1)
+            {
+                contents = buffer.data();
+                length = file_size;
+            }
+        }
+        fclose(f);
+    }
 
-    fseek(f, 0L, SEEK_END);
-    long long file_size = ftell(f); //The file size is the position of the cursor after seeking to the end.
-    rewind(f); //Seek back to start.
-    size_t face_count = (file_size - 80 - sizeof(uint32_t)) / 50; //Subtract the size of the header. Every face uses exactly 50 bytes.
+    ~FileContents()
+    {
+#ifndef _WIN32
+        if (contents && buffer.empty())
+        {
+            munmap(const_cast<char*>(contents), length);
+        }
+#endif // _WIN32
+    }
 
-    char buffer[80];
-    //Skip the header
-    if (fread(buffer, 80, 1, f) != 1)
+    const char* data() const
     {
-        fclose(f);
-        return false;
+        return contents;
     }
 
-    uint32_t reported_face_count;
-    //Read the face count. We'll use it as a sort of redundancy code to check for file corruption.
-    if (fread(&reported_face_count, sizeof(uint32_t), 1, f) != 1)
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const char* contents; //!< The start of the file contents, or nullptr if the file couldn't be read.
+    size_t length; //!< The number of bytes in the file.
+    std::vector<char> buffer; //!< Holds the contents if the file couldn't be memory-mapped.
+
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+};
+
+bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix3x3& matrix)
+{
+    const FileContents file(filename);
+    constexpr size_t header_size = 80 + sizeof(uint32_t); //The header and the face count.
+    if (file.size() < header_size)
     {
-        fclose(f);
         return false;
     }
+    const size_t face_count = (file.size() - header_size) / 50; //Subtract the size of the header. Every face uses exactly 50 bytes.
+
+    uint32_t reported_face_count;
+    //Read the face count. We'll use it as a sort of redundancy code to check for file corruption.
+    memcpy(&reported_face_count, file.data() + 80, sizeof(uint32_t));
     if (reported_face_count != face_count)
     {
         logWarning("Face count reported by file (%s) is not equal to actual face count (%s). File could be corrupt!\n", std::to_string(reported_face_count).c_str(), std::to_string(face_count).c_str());
@@ -172,23 +248,21 @@ bool loadMeshSTL_binary(Mesh* mesh, const char* filename, const FMatrix3x3& matr
     //For each face read:
     //float(x,y,z) = normal, float(X,Y,Z)*3 = vertexes, uint16_t = flags
     // Every Face is 50 Bytes: Normal(3*float), Vertices(9*float), 2 Bytes Spacer
-    mesh->faces.reserve(face_count);
-    mesh->vertices.reserve(face_count);
-    for (unsigned int i = 0; i < face_count; i++)
+    //The faces are independent, so they can be converted in parallel.
+    std::vector<Point3> corners(face_count * 3);
+    const char* const face_data = file.data() + header_size;
+    #pragma omp parallel for schedule(static)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (long long face_idx = 0; face_idx < static_cast<long long>(face_count); face_idx++)
     {
-        if (fread(buffer, 50, 1, f) != 1)
-        {
-            fclose(f);
-            return false;
-        }
-        float *v= ((float*)buffer)+3;
+        float v[9];
+        memcpy(v, face_data + face_idx * 50 + 3 * sizeof(float), sizeof(v)); //The floats in the file are not aligned.
 
-        Point3 v0 = matrix.apply(FPoint3(v[0], v[1], v[2]));
-        Point3 v1 = matrix.apply(FPoint3(v[3], v[4], v[5]));
-        Point3 v2 = matrix.apply(FPoint3(v[6], v[7], v[8]));
-        mesh->addFace(v0, v1, v2);
+        corners[face_idx * 3] = matrix.apply(FPoint3(v[0], v[1], v[2]));
+        corners[face_idx * 3 + 1] = matrix.apply(FPoint3(v[3], v[4], v[5]));
+        corners[face_idx * 3 + 2] = matrix.apply(FPoint3(v[6], v[7], v[8]));
     }
-    fclose(f);
+    mesh->addFaces(corners);
     mesh->finish();
     return true;
 }
@@ -45,78 +45,103 @@ void Mold::process(std::vector<Slicer*>& slicer_list)
     }
 
     const coord_t layer_height = scene.current_mesh_group->settings.get<coord_t>("layer_height");
-    std::vector<Polygons> mold_outline_above_per_mesh; // the outer outlines of the layer above without the original model(s) being cut out
-    mold_outline_above_per_mesh.resize(slicer_list.size());
-    for (int layer_nr = layer_count - 1; layer_nr >= 0; layer_nr--)
+    std::vector<std::vector<Polygons>> model_outlines_per_mesh(slicer_list.size()); // per layer the outlines of the model for which to generate a mold (inside of the mold)
+    for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
     {
-        Polygons all_original_mold_outlines; // outlines of all models for which to generate a mold (insides of all molds)
-
-        // first generate outlines
-        for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
+        const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
+        if (!mesh.settings.get<bool>("mold_enabled"))
         {
-            const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
-            Slicer& slicer = *slicer_list[mesh_idx];
-            if (!mesh.settings.get<bool>("mold_enabled") || layer_nr >= static_cast<int>(slicer.layers.size()))
-            {
-                continue;
-            }
-            coord_t width = mesh.settings.get<coord_t>("mold_width");
-            coord_t open_polyline_width = mesh.settings.get<coord_t>("wall_line_width_0");
+            continue;
+        }
+        Slicer& slicer = *slicer_list[mesh_idx];
+        const coord_t width = mesh.settings.get<coord_t>("mold_width");
+        const coord_t wall_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0");
+        const ExtruderTrain& train_wall_0 = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
+        const Ratio initial_layer_line_width_factor = train_wall_0.settings.get<Ratio>("initial_layer_line_width_factor");
+        const AngleDegrees angle = mesh.settings.get<AngleDegrees>("mold_angle");
+        const coord_t roof_height = mesh.settings.get<coord_t>("mold_roof_height");
+
+        const coord_t inset = tan(angle / 180 * M_PI) * layer_height;
+        const size_t roof_layer_count = roof_height / layer_height;
+
+        // Only the outside of the mold depends on the layer above. Everything else only depends on the sliced layers, so compute it in parallel first.
+        std::vector<Polygons>& model_outlines = model_outlines_per_mesh[mesh_idx];
+        model_outlines.resize(slicer.layers.size());
+        std::vector<Polygons> widened_model_outlines(slicer.layers.size()); // the model outlines offset by the mold width
+        std::vector<Polygons> roofs(slicer.layers.size());
+#pragma omp parallel for shared(slicer, model_outlines, widened_model_outlines, roofs) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_nr = 0; layer_nr < static_cast<int>(slicer.layers.size()); layer_nr++)
+        {
+            coord_t open_polyline_width = wall_line_width_0;
             if (layer_nr == 0)
             {
-                const ExtruderTrain& train_wall_0 = mesh.settings.get<ExtruderTrain&>("wall_0_extruder_nr");
-                open_polyline_width *= train_wall_0.settings.get<Ratio>("initial_layer_line_width_factor");
+                open_polyline_width *= initial_layer_line_width_factor;
             }
-            const AngleDegrees angle = mesh.settings.get<AngleDegrees>("mold_angle");
-            const coord_t roof_height = mesh.settings.get<coord_t>("mold_roof_height");
-
-            const coord_t inset = tan(angle / 180 * M_PI) * layer_height;
-            const size_t roof_layer_count = roof_height / layer_height;
-
-
             SlicerLayer& layer = slicer.layers[layer_nr];
-            Polygons model_outlines = layer.polygons.unionPolygons(layer.openPolylines.offsetPolyLine(open_polyline_width / 2));
+            model_outlines[layer_nr] = layer.polygons.unionPolygons(layer.openPolylines.offsetPolyLine(open_polyline_width / 2));
             layer.openPolylines.clear();
-            all_original_mold_outlines.add(model_outlines);
+            widened_model_outlines[layer_nr] = model_outlines[layer_nr].offset(width, ClipperLib::jtRound);
+
+            if (roof_layer_count > 0 && layer_nr > 0)
+            {
+                // The layer below isn't changed until the layers above it are done, so this is still the sliced layer.
+                unsigned int layer_nr_below = std::max(0, static_cast<int>(layer_nr - roof_layer_count));
+                roofs[layer_nr] = slicer.layers[layer_nr_below].polygons.offset(width, ClipperLib::jtRound); // TODO: don't compute offset twice!
+            }
+        }
 
+        Polygons mold_outline_above; // the outside of the mold on the layer above, without the original model(s) being cut out
+        for (int layer_nr = slicer.layers.size() - 1; layer_nr >= 0; layer_nr--)
+        {
+            SlicerLayer& layer = slicer.layers[layer_nr];
             if (angle >= 90)
             {
-                layer.polygons = model_outlines.offset(width, ClipperLib::jtRound);
+                layer.polygons = std::move(widened_model_outlines[layer_nr]);
             }
             else
             {
-                Polygons& mold_outline_above = mold_outline_above_per_mesh[mesh_idx]; // the outside of the mold on the layer above
-                layer.polygons = mold_outline_above.offset(-inset).unionPolygons(model_outlines.offset(width, ClipperLib::jtRound));
+                layer.polygons = mold_outline_above.offset(-inset).unionPolygons(widened_model_outlines[layer_nr]);
             }
 
             // add roofs
             if (roof_layer_count > 0 && layer_nr > 0)
             {
-                unsigned int layer_nr_below = std::max(0, static_cast<int>(layer_nr - roof_layer_count));
-                Polygons roofs = slicer.layers[layer_nr_below].polygons.offset(width, ClipperLib::jtRound); // TODO: don't compute offset twice!
-                layer.polygons = layer.polygons.unionPolygons(roofs);
+                layer.polygons.unionInPlace(roofs[layer_nr]);
             }
 
-            mold_outline_above_per_mesh[mesh_idx] = layer.polygons;
+            mold_outline_above = layer.polygons;
         }
-        all_original_mold_outlines = all_original_mold_outlines.unionPolygons();
+    }
 
-        // cut out molds from all objects after generating mold outlines for all objects so that molds won't overlap into the casting cutout of another mold
+    // cut out molds from all objects after generating mold outlines for all objects so that molds won't overlap into the casting cutout of another mold
+#pragma omp parallel for shared(slicer_list, scene, model_outlines_per_mesh) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        Polygons all_original_mold_outlines; // outlines of all models for which to generate a mold (insides of all molds)
+        for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
+        {
+            if (layer_nr < static_cast<int>(model_outlines_per_mesh[mesh_idx].size()))
+            {
+                all_original_mold_outlines.add(model_outlines_per_mesh[mesh_idx][layer_nr]);
+            }
+        }
+        all_original_mold_outlines.unionInPlace();
 
         // carve molds out of all other models
         for (unsigned int mesh_idx = 0; mesh_idx < slicer_list.size(); mesh_idx++)
         {
             const Mesh& mesh = scene.current_mesh_group->meshes[mesh_idx];
-            if (!mesh.settings.get<bool>("mold_enabled"))
+            Slicer& slicer = *slicer_list[mesh_idx];
+            if (!mesh.settings.get<bool>("mold_enabled") || layer_nr >= static_cast<int>(slicer.layers.size()))
             {
                 continue; // only cut original models out of all molds
             }
-            Slicer& slicer = *slicer_list[mesh_idx];
             SlicerLayer& layer = slicer.layers[layer_nr];
-            layer.polygons = layer.polygons.difference(all_original_mold_outlines);
+            layer.polygons.differenceInPlace(all_original_mold_outlines);
         }
     }
-
 }
 
 
@@ -0,0 +1,454 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "OpenCLSlicer.h"
+#include "slicer.h"
+
+#ifdef OPENCL
+
+#include <algorithm> //For min.
+#include <limits> //For numeric_limits.
+#include <memory> //For unique_ptr.
+#include <type_traits> //For remove_pointer.
+
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+    #include <OpenCL/opencl.h>
+#else
+    #include <CL/cl.h>
+#endif
+
+#include "mesh.h"
+#include "utils/Instrumentation.h"
+#include "utils/logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * The kernels that cut the faces. Each work item cuts one face at all layers
+ * between its lowest and highest vertex, first to count the segments and then
+ * to write them. The cases and rounding are the same as those of
+ * Slicer::sliceFace and Slicer::interpolate, so that the segments are exactly
+ * the same as when they are cut on the CPU.
+ */
+const char* kernel_source = R"CL(
+typedef struct
+{
+    long start_x;
+    long start_y;
+    long end_x;
+    long end_y;
+    int layer_nr;
+    int face_idx;
+    int end_edge_idx;
+    int end_vertex;
+} Segment;
+
+long interpolate(const long x, const long x0, const long x1, const long y0, const long y1)
+{
+    const long dx_01 = x1 - x0;
+    long num = (y1 - y0) * (x - x0);
+    num += num > 0 ? dx_01 / 2 : -dx_01 / 2;
+    return y0 + num / dx_01;
+}
+
+bool sliceFace(__global const long* vertices, __global const int* faces, const int face_idx, const long z, Segment* segment)
+{
+    __global const int* face = faces + face_idx * 6; //The three vertex indices, then the three connected faces.
+    __global const long* p0 = vertices + face[0] * 3;
+    __global const long* p1 = vertices + face[1] * 3;
+    __global const long* p2 = vertices + face[2] * 3;
+    __global const long* corners[3] = {p0, p1, p2};
+
+    int lone; //The vertex on the other side of the layer than the other two.
+    int start; //The other vertex of the edge that the segment starts on.
+    int end; //The other vertex of the edge that the segment ends on.
+    segment->end_vertex = -1;
+    if (p0[2] < z && p1[2] >= z && p2[2] >= z)
+    {
+        lone = 0; start = 2; end = 1;
+        segment->end_edge_idx = 0;
+        if (p1[2] == z)
+        {
+            segment->end_vertex = 1;
+        }
+    }
+    else if (p0[2] > z && p1[2] < z && p2[2] < z)
+    {
+        lone = 0; start = 1; end = 2;
+        segment->end_edge_idx = 2;
+    }
+    else if (p1[2] < z && p0[2] >= z && p2[2] >= z)
+    {
+        lone = 1; start = 0; end = 2;
+        segment->end_edge_idx = 1;
+        if (p2[2] == z)
+        {
+            segment->end_vertex = 2;
+        }
+    }
+    else if (p1[2] > z && p0[2] < z && p2[2] < z)
+    {
+        lone = 1; start = 2; end = 0;
+        segment->end_edge_idx = 0;
+    }
+    else if (p2[2] < z && p1[2] >= z && p0[2] >= z)
+    {
+        lone = 2; start = 1; end = 0;
+        segment->end_edge_idx = 2;
+        if (p0[2] == z)
+        {
+            segment->end_vertex = 0;
+        }
+    }
+    else if (p2[2] > z && p1[2] < z && p0[2] < z)
+    {
+        lone = 2; start = 0; end = 1;
+        segment->end_edge_idx = 1;
+    }
+    else
+    {
+        return false;
+    }
+
+    __global const long* a = corners[lone];
+    __global const long* b = corners[start];
+    __global const long* c = corners[end];
+    segment->start_x = interpolate(z, a[2], b[2], a[0], b[0]);
+    segment->start_y = interpolate(z, a[2], b[2], a[1], b[1]);
+    segment->end_x = interpolate(z, a[2], c[2], a[0], c[0]);
+    segment->end_y = interpolate(z, a[2], c[2], a[1], c[1]);
+    segment->face_idx = face_idx;
+    return true;
+}
+
+int firstLayerAbove(__global const long* layer_z, const int layer_count, const long z)
+{
+    int first = 0;
+    int last = layer_count;
+    while (first < last)
+    {
+        const int middle = (first + last) / 2;
+        if (layer_z[middle] > z)
+        {
+            last = middle;
+        }
+        else
+        {
+            first = middle + 1;
+        }
+    }
+    return first;
+}
+
+int sliceFaceAtLayers(__global const long* vertices, __global const int* faces, __global const long* layer_z, const int layer_count, const int face_idx, __global Segment* segments)
+{
+    __global const int* face = faces + face_idx * 6;
+    const long z0 = vertices[face[0] * 3 + 2];
+    const long z1 = vertices[face[1] * 3 + 2];
+    const long z2 = vertices[face[2] * 3 + 2];
+    const long min_z = min(z0, min(z1, z2));
+    const long max_z = max(z0, max(z1, z2));
+
+    //Only the layers above the lowest vertex and at or below the highest can cut the face.
+    int segment_count = 0;
+    for (int layer_nr = firstLayerAbove(layer_z, layer_count, min_z); layer_nr < layer_count && layer_z[layer_nr] <= max_z; layer_nr++)
+    {
+        Segment segment;
+        if (sliceFace(vertices, faces, face_idx, layer_z[layer_nr], &segment))
+        {
+            if (segments)
+            {
+                segment.layer_nr = layer_nr;
+                segments[segment_count] = segment;
+            }
+            segment_count++;
+        }
+    }
+    return segment_count;
+}
+
+__kernel void countSegments(__global const long* vertices, __global const int* faces, __global const long* layer_z, const int layer_count, const int first_face, __global int* counts)
+{
+    const int idx = get_global_id(0);
+    counts[idx] = sliceFaceAtLayers(vertices, faces, layer_z, layer_count, first_face + idx, 0);
+}
+
+__kernel void writeSegments(__global const long* vertices, __global const int* faces, __global const long* layer_z, const int layer_count, const int first_face, __global const int* offsets, __global Segment* segments)
+{
+    const int idx = get_global_id(0);
+    sliceFaceAtLayers(vertices, faces, layer_z, layer_count, first_face + idx, segments + offsets[idx]);
+}
+)CL";
+
+/*!
+ * A segment as the kernels write it.
+ */
+struct GPUSegment
+{
+    cl_long start_x;
+    cl_long start_y;
+    cl_long end_x;
+    cl_long end_y;
+    cl_int layer_nr;
+    cl_int face_idx;
+    cl_int end_edge_idx;
+    cl_int end_vertex; //!< Which vertex of the face the segment ends on, or -1 if it ends in the middle of an edge.
+};
+
+static_assert(sizeof(MeshVertex) == 3 * sizeof(cl_long), "The vertices are copied to the GPU as they are, as three coordinates each.");
+static_assert(sizeof(MeshFace) == 6 * sizeof(cl_int), "The faces are copied to the GPU as they are, as three vertex indices and three connected faces each.");
+
+constexpr size_t faces_per_batch = 1 << 20; //!< How many faces to cut at once. The segments of a batch must fit in the memory of the GPU at once.
+
+/*!
+ * Releases an OpenCL object when it goes out of scope.
+ */
+template<typename Handle>
+using OpenCLObject = std::unique_ptr<typename std::remove_pointer<Handle>::type, cl_int (CL_API_CALL *)(Handle)>;
+
+/*!
+ * Check the result of an OpenCL call, and log a warning if it failed.
+ * \return Whether the call succeeded.
+ */
+bool check(const cl_int error, const char* what)
+{
+    if (error != CL_SUCCESS)
+    {
+        logWarning("Cutting the faces on the GPU failed to %s (OpenCL error %d). Cutting them on the CPU instead.\n", what, static_cast<int>(error));
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Find the first OpenCL device that is a GPU.
+ * \return Whether there is one.
+ */
+bool findGPU(cl_device_id& device)
+{
+    cl_uint platform_count = 0;
+    if (clGetPlatformIDs(0, nullptr, &platform_count) != CL_SUCCESS || platform_count == 0)
+    {
+        return false;
+    }
+    std::vector<cl_platform_id> platforms(platform_count);
+    if (clGetPlatformIDs(platform_count, platforms.data(), nullptr) != CL_SUCCESS)
+    {
+        return false;
+    }
+    for (const cl_platform_id platform : platforms)
+    {
+        if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, nullptr) == CL_SUCCESS)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * Cut the faces on a device. See \ref OpenCLSlicer::slice.
+ */
+bool sliceOnDevice(const cl_device_id device, const Mesh& mesh, std::vector<SlicerLayer>& layers)
+{
+    cl_int error = CL_SUCCESS;
+    OpenCLObject<cl_context> context(clCreateContext(nullptr, 1, &device, nullptr, nullptr, &error), clReleaseContext);
+    if (!check(error, "create a context"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_command_queue> queue(clCreateCommandQueue(context.get(), device, 0, &error), clReleaseCommandQueue);
+    if (!check(error, "create a command queue"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_program> program(clCreateProgramWithSource(context.get(), 1, &kernel_source, nullptr, &error), clReleaseProgram);
+    if (!check(error, "create the program"))
+    {
+        return false;
+    }
+    if (!check(clBuildProgram(program.get(), 1, &device, nullptr, nullptr, nullptr), "build the program"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_kernel> count_kernel(clCreateKernel(program.get(), "countSegments", &error), clReleaseKernel);
+    if (!check(error, "create the kernel that counts the segments"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_kernel> write_kernel(clCreateKernel(program.get(), "writeSegments", &error), clReleaseKernel);
+    if (!check(error, "create the kernel that writes the segments"))
+    {
+        return false;
+    }
+
+    //The mesh and the heights of the layers stay on the device for all batches.
+    std::vector<cl_long> layer_z;
+    layer_z.reserve(layers.size());
+    for (const SlicerLayer& layer : layers)
+    {
+        layer_z.push_back(layer.z);
+    }
+    OpenCLObject<cl_mem> vertices_buffer(clCreateBuffer(context.get(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, mesh.vertices.size() * sizeof(MeshVertex), const_cast<MeshVertex*>(mesh.vertices.data()), &error), clReleaseMemObject);
+    if (!check(error, "copy the vertices"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_mem> faces_buffer(clCreateBuffer(context.get(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, mesh.faces.size() * sizeof(MeshFace), const_cast<MeshFace*>(mesh.faces.data()), &error), clReleaseMemObject);
+    if (!check(error, "copy the faces"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_mem> layer_z_buffer(clCreateBuffer(context.get(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, layer_z.size() * sizeof(cl_long), layer_z.data(), &error), clReleaseMemObject);
+    if (!check(error, "copy the heights of the layers"))
+    {
+        return false;
+    }
+    const size_t batch_size = std::min(faces_per_batch, mesh.faces.size());
+    OpenCLObject<cl_mem> counts_buffer(clCreateBuffer(context.get(), CL_MEM_READ_WRITE, batch_size * sizeof(cl_int), nullptr, &error), clReleaseMemObject);
+    if (!check(error, "allocate the segment counts"))
+    {
+        return false;
+    }
+    OpenCLObject<cl_mem> segments_buffer(nullptr, clReleaseMemObject);
+    size_t segments_capacity = 0;
+
+    const cl_int layer_count = layers.size();
+    const cl_mem vertices_arg = vertices_buffer.get();
+    const cl_mem faces_arg = faces_buffer.get();
+    const cl_mem layer_z_arg = layer_z_buffer.get();
+    const cl_mem counts_arg = counts_buffer.get();
+    for (const cl_kernel kernel : {count_kernel.get(), write_kernel.get()})
+    {
+        if (!check(clSetKernelArg(kernel, 0, sizeof(cl_mem), &vertices_arg), "pass the vertices")
+            || !check(clSetKernelArg(kernel, 1, sizeof(cl_mem), &faces_arg), "pass the faces")
+            || !check(clSetKernelArg(kernel, 2, sizeof(cl_mem), &layer_z_arg), "pass the heights of the layers")
+            || !check(clSetKernelArg(kernel, 3, sizeof(cl_int), &layer_count), "pass the number of layers")
+            || !check(clSetKernelArg(kernel, 5, sizeof(cl_mem), &counts_arg), "pass the segment counts"))
+        {
+            return false;
+        }
+    }
+
+    std::vector<cl_int> offsets(batch_size);
+    std::vector<GPUSegment> segments;
+    for (size_t first_face = 0; first_face < mesh.faces.size(); first_face += batch_size)
+    {
+        const size_t face_count = std::min(batch_size, mesh.faces.size() - first_face);
+        const cl_int first_face_arg = first_face;
+
+        //Count the segments of each face, to know where to write them.
+        if (!check(clSetKernelArg(count_kernel.get(), 4, sizeof(cl_int), &first_face_arg), "pass the first face")
+            || !check(clEnqueueNDRangeKernel(queue.get(), count_kernel.get(), 1, nullptr, &face_count, nullptr, 0, nullptr, nullptr), "count the segments")
+            || !check(clEnqueueReadBuffer(queue.get(), counts_arg, CL_TRUE, 0, face_count * sizeof(cl_int), offsets.data(), 0, nullptr, nullptr), "read the segment counts"))
+        {
+            return false;
+        }
+        size_t segment_count = 0;
+        for (size_t face_idx = 0; face_idx < face_count; face_idx++)
+        {
+            const cl_int face_segment_count = offsets[face_idx];
+            offsets[face_idx] = segment_count;
+            segment_count += face_segment_count;
+        }
+        if (segment_count == 0)
+        {
+            continue;
+        }
+
+        if (segment_count > segments_capacity)
+        {
+            segments_buffer.reset(clCreateBuffer(context.get(), CL_MEM_WRITE_ONLY, segment_count * sizeof(GPUSegment), nullptr, &error));
+            if (!check(error, "allocate the segments"))
+            {
+                return false;
+            }
+            segments_capacity = segment_count;
+        }
+        const cl_mem segments_buffer_arg = segments_buffer.get();
+        segments.resize(segment_count);
+        if (!check(clEnqueueWriteBuffer(queue.get(), counts_arg, CL_FALSE, 0, face_count * sizeof(cl_int), offsets.data(), 0, nullptr, nullptr), "pass the segment offsets")
+            || !check(clSetKernelArg(write_kernel.get(), 4, sizeof(cl_int), &first_face_arg), "pass the first face")
+            || !check(clSetKernelArg(write_kernel.get(), 6, sizeof(cl_mem), &segments_buffer_arg), "pass the segments")
+            || !check(clEnqueueNDRangeKernel(queue.get(), write_kernel.get(), 1, nullptr, &face_count, nullptr, 0, nullptr, nullptr), "write the segments")
+            || !check(clEnqueueReadBuffer(queue.get(), segments_buffer_arg, CL_TRUE, 0, segment_count * sizeof(GPUSegment), segments.data(), 0, nullptr, nullptr), "read the segments"))
+        {
+            return false;
+        }
+
+        //The segments are in the order of their faces, so adding them in this order keeps the segments of each layer in the order of their faces too.
+        for (const GPUSegment& gpu_segment : segments)
+        {
+            const MeshFace& face = mesh.faces[gpu_segment.face_idx];
+            SlicerSegment segment;
+            segment.start = Point(gpu_segment.start_x, gpu_segment.start_y);
+            segment.end = Point(gpu_segment.end_x, gpu_segment.end_y);
+            segment.faceIndex = gpu_segment.face_idx;
+            segment.endOtherFaceIdx = face.connected_face_index[gpu_segment.end_edge_idx];
+            segment.endVertex = (gpu_segment.end_vertex >= 0) ? &mesh.vertices[face.vertex_index[gpu_segment.end_vertex]] : nullptr;
+            SlicerLayer& layer = layers[gpu_segment.layer_nr];
+            layer.segments.push_back(segment);
+            layer.segment_face_indices.push_back(gpu_segment.face_idx);
+        }
+    }
+    return true;
+}
+
+} //Anonymous namespace.
+
+bool OpenCLSlicer::slice(const Mesh& mesh, std::vector<SlicerLayer>& layers)
+{
+    const ScopedTimer timer("slice_faces_on_gpu");
+    if (mesh.faces.empty() || mesh.faces.size() > static_cast<size_t>(std::numeric_limits<cl_int>::max()))
+    {
+        return false;
+    }
+    for (size_t layer_nr = 1; layer_nr < layers.size(); layer_nr++)
+    {
+        if (layers[layer_nr].z < layers[layer_nr - 1].z)
+        {
+            return false; //The kernels find the layers that cut a face with a binary search.
+        }
+    }
+    cl_device_id device;
+    if (!findGPU(device))
+    {
+        logWarning("No GPU was found to cut the faces on. Cutting them on the CPU instead.\n");
+        return false;
+    }
+    if (!sliceOnDevice(device, mesh, layers))
+    {
+        for (SlicerLayer& layer : layers)
+        {
+            layer.segments.clear();
+            layer.segment_face_indices.clear();
+        }
+        return false;
+    }
+    for (const SlicerLayer& layer : layers)
+    {
+        ScopedTimer::count("segments", layer.segments.size());
+    }
+    return true;
+}
+
+} //namespace cura
+
+#else //OPENCL
+
+namespace cura
+{
+
+bool OpenCLSlicer::slice(const Mesh&, std::vector<SlicerLayer>&)
+{
+    return false; //Built without OpenCL.
+}
+
+} //namespace cura
+
+#endif //OPENCL
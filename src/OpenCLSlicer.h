@@ -0,0 +1,52 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef OPENCL_SLICER_H
+#define OPENCL_SLICER_H
+
+#include <vector>
+
+namespace cura
+{
+
+class Mesh;
+class SlicerLayer;
+
+/*!
+ * \brief Cuts the faces of a mesh at the heights of the layers on the GPU,
+ * with OpenCL.
+ *
+ * This is for meshes with many millions of faces, such as from CT scans,
+ * where even cutting the faces on all cores takes long. Only the segments are
+ * made on the GPU. Stitching them into polygons stays on the CPU, see
+ * \ref SlicerLayer::makePolygons.
+ *
+ * The segments are the same as when slicing on the CPU: every face that
+ * \ref Slicer::sliceFace cuts gives the same segment, and the segments of each
+ * layer are in the order of their faces.
+ *
+ * This is only available if the engine is built with ``ENABLE_OPENCL`` and
+ * the computer has an OpenCL device that is a GPU.
+ */
+class OpenCLSlicer
+{
+public:
+    /*!
+     * \brief Cut the faces of a mesh at the heights of the layers.
+     *
+     * If anything goes wrong, for instance if there is no GPU or it doesn't
+     * have enough memory, a warning is logged and the layers are left without
+     * segments, so that the caller can cut the faces on the CPU instead.
+     * \param mesh The mesh to cut the faces of.
+     * \param[in,out] layers The layers, of which the Z coordinates must be
+     * in increasing order. Their segments are added to
+     * \ref SlicerLayer::segments and their faces to
+     * \ref SlicerLayer::segment_face_indices.
+     * \return Whether the faces were cut on the GPU.
+     */
+    static bool slice(const Mesh& mesh, std::vector<SlicerLayer>& layers);
+};
+
+} //namespace cura
+
+#endif //OPENCL_SLICER_H
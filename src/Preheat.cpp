@@ -5,7 +5,6 @@
 #include "ExtruderTrain.h"
 #include "Preheat.h"
 #include "Slice.h"
-#include "settings/FlowTempGraph.h"
 #include "settings/types/Ratio.h"
 #include "utils/logoutput.h"
 
@@ -37,6 +36,16 @@ Duration Preheat::getTimeToGoFromTempToTemp(const size_t extruder, const Tempera
     return std::max(0.0_s, time);
 }
 
+void Preheat::setConfig()
+{
+    const std::vector<ExtruderTrain>& extruders = Application::getInstance().current_slice->scene.extruders;
+    flow_temp_graphs.clear();
+    for (const ExtruderTrain& extruder : extruders)
+    {
+        flow_temp_graphs.push_back(extruder.settings.get<FlowTempGraph>("material_flow_temp_graph"));
+    }
+}
+
 Temperature Preheat::getTemp(const size_t extruder, const Ratio& flow, const bool is_initial_layer)
 {
     const Settings& extruder_settings = Application::getInstance().current_slice->scene.extruders[extruder].settings;
@@ -44,7 +53,13 @@ Temperature Preheat::getTemp(const size_t extruder, const Ratio& flow, const boo
     {
         return extruder_settings.get<Temperature>("material_print_temperature_layer_0");
     }
-    return extruder_settings.get<FlowTempGraph>("material_flow_temp_graph").getTemp(flow, extruder_settings.get<Temperature>("material_print_temperature"), extruder_settings.get<bool>("material_flow_dependent_temperature"));
+    const Temperature material_print_temperature = extruder_settings.get<Temperature>("material_print_temperature");
+    const bool flow_dependent_temperature = extruder_settings.get<bool>("material_flow_dependent_temperature");
+    if (extruder < flow_temp_graphs.size())
+    {
+        return flow_temp_graphs[extruder].getTemp(flow, material_print_temperature, flow_dependent_temperature);
+    }
+    return extruder_settings.get<FlowTempGraph>("material_flow_temp_graph").getTemp(flow, material_print_temperature, flow_dependent_temperature); //Not configured yet.
 }
 
 Preheat::WarmUpResult Preheat::getWarmUpPointAfterCoolDown(double time_window, unsigned int extruder, double temp_start, double temp_mid, double temp_end, bool during_printing)
@@ -6,7 +6,9 @@
 
 #include <cassert>
 #include <algorithm> // max
+#include <vector>
 
+#include "settings/FlowTempGraph.h"
 #include "settings/types/Duration.h"
 #include "settings/types/Temperature.h"
 
@@ -41,6 +43,14 @@ public:
         Temperature highest_temperature; //!< The upper temperature from which cooling starts.
     };
 
+    /*!
+     * Read the flow-temperature graphs of all extruders of the current slice.
+     * 
+     * The graphs are stored as text in the settings, so they are parsed once
+     * here rather than for every extruder plan.
+     */
+    void setConfig();
+
     /*!
      * Get the optimal temperature corresponding to a given average flow,
      * or the initial layer temperature.
@@ -109,6 +119,9 @@ public:
      * \return The time needed
      */
     Duration getTimeToGoFromTempToTemp(const size_t extruder, const Temperature& temp_before, const Temperature& temp_after, const bool during_printing);
+
+private:
+    std::vector<FlowTempGraph> flow_temp_graphs; //!< The flow-temperature graph of each extruder, as read by \ref setConfig.
 };
 
 } // namespace cura 
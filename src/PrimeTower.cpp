@@ -151,7 +151,7 @@ void PrimeTower::generatePaths_denseInfill()
         while (!inset.empty())
         {
             pattern_layer0.polygons.add(inset);
-            inset = inset.offset(-line_width_layer0);
+            inset.offsetInPlace(-line_width_layer0);
         }
     }
 }
@@ -9,6 +9,10 @@
 #include "Wireframe2gcode.h"
 #include "communication/Communication.h" //To flush g-code and layer view when we're done.
 #include "progress/Progress.h"
+#include "utils/GeometryDump.h"
+#include "utils/Instrumentation.h"
+#include "utils/MemoryBudget.h"
+#include "utils/StageThreads.h"
 #include "utils/logoutput.h"
 
 namespace cura
@@ -64,6 +68,50 @@ const std::string Scene::getAllSettingsString() const
 
 void Scene::processMeshGroup(MeshGroup& mesh_group)
 {
+    //Timings and counters of the stages, to find performance regressions in production without a profiler.
+    Instrumentation& instrumentation = Instrumentation::getInstance();
+    if (settings.has("instrumentation_trace_file"))
+    {
+        instrumentation.addSink(std::unique_ptr<InstrumentationSink>(new ChromeTraceSink(settings.get<std::string>("instrumentation_trace_file"))));
+    }
+    if (settings.has("instrumentation_summary_file"))
+    {
+        instrumentation.addSink(std::unique_ptr<InstrumentationSink>(new InstrumentationSummarySink(settings.get<std::string>("instrumentation_summary_file"))));
+    }
+    if (settings.has("instrumentation_slowest_layers"))
+    {
+        instrumentation.addSink(std::unique_ptr<InstrumentationSink>(new SlowestLayersSink(settings.get<size_t>("instrumentation_slowest_layers"))));
+    }
+    //A soft limit on the memory of the slice data, which makes the caches evict more when it's exceeded.
+    if (settings.has("memory_budget"))
+    {
+        MemoryBudget::getInstance().setLimit(settings.get<double>("memory_budget") * 1024 * 1024);
+    }
+    //The geometry of selected layers, to diagnose a slice without rebuilding the engine.
+    if (settings.has("geometry_dump_file"))
+    {
+        GeometryDump::getInstance().start(settings.get<std::string>("geometry_dump_file"),
+            settings.has("geometry_dump_layers") ? settings.get<std::string>("geometry_dump_layers") : "",
+            settings.has("geometry_dump_stages") ? settings.get<std::string>("geometry_dump_stages") : "");
+    }
+    //The threads of the stages that don't scale to all threads, or tuning them for this host.
+    if (settings.has("parallel_stage_threads") || settings.has("parallel_stage_tuning_file"))
+    {
+        StageThreads::getInstance().start(settings.has("parallel_stage_threads") ? settings.get<std::string>("parallel_stage_threads") : "",
+            settings.has("parallel_stage_tuning_file") ? settings.get<std::string>("parallel_stage_tuning_file") : "");
+    }
+    struct FinishInstrumentation
+    {
+        ~FinishInstrumentation()
+        {
+            Instrumentation::getInstance().finish();
+            MemoryBudget::getInstance().reset();
+            GeometryDump::getInstance().finish();
+            StageThreads::getInstance().finish();
+        }
+    } finish_instrumentation; //Hands the events to the sinks when returning, after the timer below has recorded the whole mesh group.
+    const ScopedTimer timer("mesh_group");
+
     FffProcessor* fff_processor = FffProcessor::getInstance();
     fff_processor->time_keeper.restart();
 
@@ -85,7 +133,14 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         return;
     }
 
-    if (mesh_group.settings.get<bool>("wireframe_enabled"))
+    //A slice that was stopped can continue from the layers that it wrote before, if it has the same inputs.
+    GCodeCheckpoints& checkpoints = fff_processor->gcode_writer->checkpoints;
+    checkpoints.begin(*this);
+    if (checkpoints.isComplete())
+    {
+        //Nothing to compute. The layers are joined when finalizing.
+    }
+    else if (mesh_group.settings.get<bool>("wireframe_enabled"))
     {
         log("Starting Neith Weaver...\n");
 
@@ -93,7 +148,7 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         weaver.weave(&mesh_group);
         
         log("Starting Neith Gcode generation...\n");
-        Wireframe2gcode gcoder(weaver, fff_processor->gcode_writer.gcode);
+        Wireframe2gcode gcoder(weaver, fff_processor->gcode_writer->gcode);
         gcoder.writeGCode();
         log("Finished Neith Gcode generation...\n");
     }
@@ -107,7 +162,11 @@ void Scene::processMeshGroup(MeshGroup& mesh_group)
         }
         
         Progress::messageProgressStage(Progress::Stage::EXPORT, &fff_processor->time_keeper);
-        fff_processor->gcode_writer.writeGCode(storage, fff_processor->time_keeper);
+        fff_processor->gcode_writer->writeGCode(storage, fff_processor->time_keeper);
+        if (Application::getInstance().isSliceCancelled()) //Don't send the g-code of a slice that was superseded.
+        {
+            return;
+        }
     }
 
     Progress::messageProgress(Progress::Stage::FINISH, 1, 1); // 100% on this meshgroup
@@ -25,8 +25,11 @@ public:
     /*
      * \brief Which extruder to evaluate each setting on, if different from the
      * normal extruder of the object it's evaluated for.
+     *
+     * This is indexed by the interned ID of the setting (see
+     * \ref SettingKey::getId).
      */
-    std::unordered_map<std::string, ExtruderTrain*> limit_to_extruder;
+    std::unordered_map<size_t, ExtruderTrain*> limit_to_extruder;
 
     /*
      * \brief The mesh groups in the scene.
@@ -0,0 +1,55 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "SkinWallCache.h"
+#include "sliceDataStorage.h"
+
+namespace cura
+{
+
+SkinWallCache::SkinWallCache(const size_t layer_count)
+{
+    layers.reserve(layer_count);
+    for (size_t layer_nr = 0; layer_nr < layer_count; layer_nr++)
+    {
+        layers.emplace_back(new LayerWalls());
+    }
+}
+
+const Polygons& SkinWallCache::getOffsetWall(const SliceLayer& layer, const LayerIndex layer_nr, const size_t part_idx, const size_t wall_idx, const coord_t offset)
+{
+    LayerWalls& layer_walls = *layers[layer_nr];
+    std::lock_guard<std::mutex> lock(layer_walls.mutex);
+    for (const OffsetWalls& offset_walls : layer_walls.offset_walls)
+    {
+        if (offset_walls.wall_idx == wall_idx && offset_walls.offset == offset)
+        {
+            return offset_walls.part_walls[part_idx];
+        }
+    }
+
+    // Not computed yet. Offset the walls of all parts at once, since whoever looks at one part of the layer typically looks at the rest too.
+    layer_walls.offset_walls.emplace_back();
+    OffsetWalls& offset_walls = layer_walls.offset_walls.back();
+    offset_walls.wall_idx = wall_idx;
+    offset_walls.offset = offset;
+    offset_walls.part_walls.reserve(layer.parts.size());
+    for (const SliceLayerPart& part : layer.parts)
+    {
+        if (wall_idx <= 0)
+        {
+            offset_walls.part_walls.push_back(part.outline.offset(offset));
+        }
+        else if (wall_idx <= part.insets.size())
+        {
+            offset_walls.part_walls.push_back(part.insets[wall_idx - 1].offset(offset)); // -1 because it's a 1-based index
+        }
+        else
+        {
+            offset_walls.part_walls.emplace_back();
+        }
+    }
+    return offset_walls.part_walls[part_idx];
+}
+
+} //namespace cura
@@ -0,0 +1,86 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SKIN_WALL_CACHE_H
+#define SKIN_WALL_CACHE_H
+
+#include <list>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <vector>
+
+#include "settings/types/LayerIndex.h"
+#include "utils/Coord_t.h"
+#include "utils/NoCopy.h"
+#include "utils/polygon.h"
+
+namespace cura
+{
+
+class SliceLayer;
+
+/*!
+ * \brief The walls of the parts of a mesh as the skin computation of other
+ * layers looks at them.
+ *
+ * The skin of a layer is found by intersecting a wall of each of the layers
+ * within the top and bottom layers, offset by the skin preshrink. The next
+ * layer intersects almost the same walls again, so every layer would offset
+ * the same wall about top_layers + bottom_layers times. This cache offsets the
+ * wall of each part once and hands out the result to every layer that needs
+ * it.
+ *
+ * The walls of a layer must be finished before they are requested from the
+ * cache. The cache may be used from multiple threads at the same time.
+ */
+class SkinWallCache : NoCopy
+{
+public:
+    /*!
+     * \brief Creates an empty cache for a mesh with the given number of
+     * layers.
+     * \param layer_count The number of layers of the mesh.
+     */
+    SkinWallCache(const size_t layer_count);
+
+    /*!
+     * \brief Get a wall of a part, offset by some distance.
+     *
+     * The offset wall is computed on the first request and returned from the
+     * cache on subsequent requests.
+     * \param layer The layer that the part is in.
+     * \param layer_nr The index of that layer.
+     * \param part_idx The index of the part in the layer.
+     * \param wall_idx The 1-based index of the wall, or 0 for the outline.
+     * \param offset The distance by which to offset the wall.
+     * \return The offset wall. It remains valid as long as the cache exists.
+     */
+    const Polygons& getOffsetWall(const SliceLayer& layer, const LayerIndex layer_nr, const size_t part_idx, const size_t wall_idx, const coord_t offset);
+
+private:
+    /*!
+     * \brief The walls of all parts of a layer for one combination of wall
+     * index and offset.
+     */
+    struct OffsetWalls
+    {
+        size_t wall_idx; //!< The 1-based index of the wall, or 0 for the outline.
+        coord_t offset; //!< The distance by which the walls are offset.
+        std::vector<Polygons> part_walls; //!< The offset wall of every part of the layer.
+    };
+
+    /*!
+     * \brief The cached walls of one layer.
+     */
+    struct LayerWalls
+    {
+        std::mutex mutex; //!< Protects the list of offset walls while walls are being added.
+        std::list<OffsetWalls> offset_walls; //!< A list, so that the references we hand out stay valid when other offsets are added.
+    };
+
+    std::vector<std::unique_ptr<LayerWalls>> layers; //!< The cached walls of each layer.
+};
+
+} //namespace cura
+
+#endif //SKIN_WALL_CACHE_H
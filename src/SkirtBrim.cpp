@@ -9,10 +9,65 @@
 #include "support.h"
 #include "settings/types/Ratio.h"
 #include "utils/logoutput.h"
+#include "utils/TaskScheduler.h"
 
 namespace cura 
 {
 
+namespace
+{
+
+/*!
+ * \brief Remove the holes of a skirt or brim line that are too small to print
+ * a line in.
+ * \param line The skirt or brim line.
+ * \param line_width The width of the line.
+ */
+void removeSmallHoles(Polygons& line, const coord_t line_width)
+{
+    constexpr coord_t brim_area_minimum_hole_size_multiplier = 100;
+
+    //Remove small inner skirt and brim holes. Holes have a negative area, remove anything smaller then multiplier x extrusion "area"
+    for (size_t n = 0; n < line.size(); n++)
+    {
+        const double area = line[n].area();
+        if (area < 0 && area > -line_width * line_width * brim_area_minimum_hole_size_multiplier)
+        {
+            line.remove(n--);
+        }
+    }
+}
+
+/*!
+ * \brief Schedule a task for every skirt or brim line, which offsets the
+ * outline to that line.
+ *
+ * Every line is offset from the outline itself rather than from the previous
+ * line. Offsetting a rounded line again would add an arc at each of its
+ * vertices, doubling the number of vertices with every line.
+ * \param scheduler The scheduler to add the tasks to.
+ * \param outline The outline to offset. It must stay alive until the tasks
+ * have finished.
+ * \param first_distance The offset of the first line.
+ * \param spacing The difference between the offsets of consecutive lines.
+ * \param line_width The width of the lines, to remove holes that are too small
+ * to print in.
+ * \param[out] lines The lines. Its size determines the number of lines.
+ */
+void scheduleLines(TaskScheduler& scheduler, const Polygons& outline, const coord_t first_distance, const coord_t spacing, const coord_t line_width, std::vector<Polygons>& lines)
+{
+    for (size_t line_idx = 0; line_idx < lines.size(); line_idx++)
+    {
+        scheduler.schedule([&outline, first_distance, spacing, line_width, &lines, line_idx]()
+        {
+            lines[line_idx] = outline.offset(first_distance + spacing * static_cast<coord_t>(line_idx), ClipperLib::jtRound);
+            removeSmallHoles(lines[line_idx], line_width);
+        });
+    }
+}
+
+} //Anonymous namespace.
+
 void SkirtBrim::getFirstLayerOutline(SliceDataStorage& storage, const size_t primary_line_count, const bool is_skirt, Polygons& first_layer_outline)
 {
     const ExtruderTrain& train = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("adhesion_extruder_nr");
@@ -32,7 +87,7 @@ void SkirtBrim::getFirstLayerOutline(SliceDataStorage& storage, const size_t pri
         constexpr bool include_prime_tower = false; //Include manually below.
         constexpr bool external_outlines_only = false; //Remove manually below.
         first_layer_outline = storage.getLayerOutlines(layer_nr, include_support, include_prime_tower, external_outlines_only);
-        first_layer_outline = first_layer_outline.unionPolygons(); //To guard against overlapping outlines, which would produce holes according to the even-odd rule.
+        first_layer_outline.unionInPlace(); //To guard against overlapping outlines, which would produce holes according to the even-odd rule.
         Polygons first_layer_empty_holes;
         if (external_only)
         {
@@ -83,34 +138,30 @@ void SkirtBrim::getFirstLayerOutline(SliceDataStorage& storage, const size_t pri
     }
 }
 
-int SkirtBrim::generatePrimarySkirtBrimLines(const coord_t start_distance, size_t primary_line_count, const coord_t primary_extruder_minimal_length, const Polygons& first_layer_outline, Polygons& skirt_brim_primary_extruder)
+int SkirtBrim::addPrimarySkirtBrimLines(const coord_t start_distance, const std::vector<Polygons>& lines, const coord_t primary_extruder_minimal_length, const Polygons& first_layer_outline, Polygons& skirt_brim_primary_extruder)
 {
     const Settings& adhesion_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<ExtruderTrain&>("adhesion_extruder_nr").settings;
     const coord_t primary_extruder_skirt_brim_line_width = adhesion_settings.get<coord_t>("skirt_brim_line_width") * adhesion_settings.get<Ratio>("initial_layer_line_width_factor");
-    coord_t offset_distance = start_distance - primary_extruder_skirt_brim_line_width / 2;
-    for (unsigned int skirt_brim_number = 0; skirt_brim_number < primary_line_count; skirt_brim_number++)
+    coord_t offset_distance = start_distance - primary_extruder_skirt_brim_line_width / 2 + primary_extruder_skirt_brim_line_width * static_cast<coord_t>(lines.size());
+    for (const Polygons& outer_skirt_brim_line : lines)
+    {
+        skirt_brim_primary_extruder.add(outer_skirt_brim_line);
+    }
+    if (lines.empty())
+    {
+        return offset_distance;
+    }
+
+    int length = skirt_brim_primary_extruder.polygonLength();
+    while (length > 0 && length < primary_extruder_minimal_length) //Make brim or skirt have more lines when total length is too small.
     {
         offset_distance += primary_extruder_skirt_brim_line_width;
 
         Polygons outer_skirt_brim_line = first_layer_outline.offset(offset_distance, ClipperLib::jtRound);
-
-        //Remove small inner skirt and brim holes. Holes have a negative area, remove anything smaller then 100x extrusion "area"
-        for (unsigned int n = 0; n < outer_skirt_brim_line.size(); n++)
-        {
-            double area = outer_skirt_brim_line[n].area();
-            if (area < 0 && area > -primary_extruder_skirt_brim_line_width * primary_extruder_skirt_brim_line_width * 100)
-            {
-                outer_skirt_brim_line.remove(n--);
-            }
-        }
-
+        removeSmallHoles(outer_skirt_brim_line, primary_extruder_skirt_brim_line_width);
         skirt_brim_primary_extruder.add(outer_skirt_brim_line);
 
-        int length = skirt_brim_primary_extruder.polygonLength();
-        if (skirt_brim_number + 1 >= primary_line_count && length > 0 && length < primary_extruder_minimal_length) //Make brim or skirt have more lines when total length is too small.
-        {
-            primary_line_count++;
-        }
+        length = skirt_brim_primary_extruder.polygonLength();
     }
     return offset_distance;
 }
@@ -135,19 +186,34 @@ void SkirtBrim::generate(SliceDataStorage& storage, Polygons first_layer_outline
         first_layer_outline = first_layer_outline.offset(start_distance - primary_extruder_skirt_brim_line_width / 2, ClipperLib::jtRound).unionPolygons(storage.draft_protection_shield);
         if (has_ooze_shield)
         {
-            first_layer_outline = first_layer_outline.unionPolygons(storage.oozeShield[0]);
+            first_layer_outline.unionInPlace(storage.oozeShield[0]);
         }
         first_layer_outline = first_layer_outline.approxConvexHull();
         start_distance = primary_extruder_skirt_brim_line_width / 2;
     }
 
-    int offset_distance = generatePrimarySkirtBrimLines(start_distance, primary_line_count, primary_extruder_minimal_length, first_layer_outline, skirt_brim_primary_extruder);
+    // All skirt/brim lines are offset from their outline independently, so the lines around the model and around the support are computed concurrently.
+    TaskScheduler scheduler;
+    std::vector<Polygons> primary_lines(primary_line_count);
+    scheduleLines(scheduler, first_layer_outline, start_distance - primary_extruder_skirt_brim_line_width / 2 + primary_extruder_skirt_brim_line_width, primary_extruder_skirt_brim_line_width, primary_extruder_skirt_brim_line_width, primary_lines);
 
     // handle support-brim
     const ExtruderTrain& support_infill_extruder = scene.current_mesh_group->settings.get<ExtruderTrain&>("support_infill_extruder_nr");
-    if (support_infill_extruder.settings.get<bool>("support_brim_enable"))
+    const coord_t support_brim_line_width = support_infill_extruder.settings.get<coord_t>("skirt_brim_line_width") * support_infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
+    Polygons support_outline;
+    std::vector<Polygons> support_brim_lines;
+    if (support_infill_extruder.settings.get<bool>("support_brim_enable") && getSupportBrimOutline(storage, support_outline))
+    {
+        support_brim_lines.resize(support_infill_extruder.settings.get<size_t>("support_brim_line_count"));
+        scheduleLines(scheduler, support_outline, -support_brim_line_width / 2, -support_brim_line_width, support_brim_line_width, support_brim_lines);
+    }
+
+    scheduler.run();
+
+    int offset_distance = addPrimarySkirtBrimLines(start_distance, primary_lines, primary_extruder_minimal_length, first_layer_outline, skirt_brim_primary_extruder);
+    if (!support_brim_lines.empty())
     {
-        generateSupportBrim(storage);
+        addSupportBrim(storage, support_outline, support_brim_lines);
     }
 
     // generate brim for ooze shield and draft shield
@@ -170,16 +236,16 @@ void SkirtBrim::generate(SliceDataStorage& storage, Polygons first_layer_outline
         }
         if (has_draft_shield)
         {
-            shield_brim = shield_brim.unionPolygons(storage.draft_protection_shield.difference(storage.draft_protection_shield.offset(-primary_skirt_brim_width - primary_extruder_skirt_brim_line_width)));
+            shield_brim.unionInPlace(storage.draft_protection_shield.difference(storage.draft_protection_shield.offset(-primary_skirt_brim_width - primary_extruder_skirt_brim_line_width)));
         }
         const Polygons outer_primary_brim = first_layer_outline.offset(offset_distance, ClipperLib::jtRound);
-        shield_brim = shield_brim.difference(outer_primary_brim.offset(primary_extruder_skirt_brim_line_width));
+        shield_brim.differenceInPlace(outer_primary_brim.offset(primary_extruder_skirt_brim_line_width));
 
         // generate brim within shield_brim
         skirt_brim_primary_extruder.add(shield_brim);
         while (shield_brim.size() > 0)
         {
-            shield_brim = shield_brim.offset(-primary_extruder_skirt_brim_line_width);
+            shield_brim.offsetInPlace(-primary_extruder_skirt_brim_line_width);
             skirt_brim_primary_extruder.add(shield_brim);
         }
 
@@ -187,11 +253,11 @@ void SkirtBrim::generate(SliceDataStorage& storage, Polygons first_layer_outline
         first_layer_outline = outer_primary_brim;
         if (has_draft_shield)
         {
-            first_layer_outline = first_layer_outline.unionPolygons(storage.draft_protection_shield);
+            first_layer_outline.unionInPlace(storage.draft_protection_shield);
         }
         if (has_ooze_shield)
         {
-            first_layer_outline = first_layer_outline.unionPolygons(storage.oozeShield[0]);
+            first_layer_outline.unionInPlace(storage.oozeShield[0]);
         }
 
         offset_distance = 0;
@@ -220,63 +286,67 @@ void SkirtBrim::generate(SliceDataStorage& storage, Polygons first_layer_outline
     }
 }
 
-void SkirtBrim::generateSupportBrim(SliceDataStorage& storage)
+bool SkirtBrim::getSupportBrimOutline(SliceDataStorage& storage, Polygons& support_outline)
 {
-    constexpr coord_t brim_area_minimum_hole_size_multiplier = 100;
-
     Scene& scene = Application::getInstance().current_slice->scene;
     const ExtruderTrain& support_infill_extruder = scene.current_mesh_group->settings.get<ExtruderTrain&>("support_infill_extruder_nr");
     const coord_t brim_line_width = support_infill_extruder.settings.get<coord_t>("skirt_brim_line_width") * support_infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
-    size_t line_count = support_infill_extruder.settings.get<size_t>("support_brim_line_count");
-    const coord_t minimal_length = support_infill_extruder.settings.get<coord_t>("skirt_brim_minimal_length");
+    const size_t line_count = support_infill_extruder.settings.get<size_t>("support_brim_line_count");
     if (!storage.support.generated || line_count <= 0 || storage.support.supportLayers.empty())
     {
-        return;
+        return false;
     }
 
     const coord_t brim_width = brim_line_width * line_count;
-    Polygons& skirt_brim = storage.skirt_brim[support_infill_extruder.extruder_nr];
 
     SupportLayer& support_layer = storage.support.supportLayers[0];
 
-    Polygons support_outline;
     for (SupportInfillPart& part : support_layer.support_infill_parts)
     {
         support_outline.add(part.outline);
     }
     const Polygons brim_area = support_outline.difference(support_outline.offset(-brim_width));
     support_layer.excludeAreasFromSupportInfillAreas(brim_area, AABB(brim_area));
+    return true;
+}
+
+void SkirtBrim::addSupportBrim(SliceDataStorage& storage, const Polygons& support_outline, const std::vector<Polygons>& lines)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    const ExtruderTrain& support_infill_extruder = scene.current_mesh_group->settings.get<ExtruderTrain&>("support_infill_extruder_nr");
+    const coord_t brim_line_width = support_infill_extruder.settings.get<coord_t>("skirt_brim_line_width") * support_infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
+    const coord_t minimal_length = support_infill_extruder.settings.get<coord_t>("skirt_brim_minimal_length");
+
+    Polygons& skirt_brim = storage.skirt_brim[support_infill_extruder.extruder_nr];
 
     Polygons support_brim;
 
     coord_t offset_distance = brim_line_width / 2;
-    for (size_t skirt_brim_number = 0; skirt_brim_number < line_count; skirt_brim_number++)
+    for (const Polygons& brim_line : lines)
     {
         offset_distance -= brim_line_width;
-
-        Polygons brim_line = support_outline.offset(offset_distance, ClipperLib::jtRound);
-
-        //Remove small inner skirt and brim holes. Holes have a negative area, remove anything smaller then multiplier x extrusion "area"
-        for (size_t n = 0; n < brim_line.size(); n++)
-        {
-            const double area = brim_line[n].area();
-            if (area < 0 && area > -brim_line_width * brim_line_width * brim_area_minimum_hole_size_multiplier)
-            {
-                brim_line.remove(n--);
-            }
+        if (brim_line.empty())
+        { // the fist layer of support is fully filled with brim
+            break;
         }
-
         support_brim.add(brim_line);
+    }
 
-        const coord_t length = skirt_brim.polygonLength() + support_brim.polygonLength();
-        if (skirt_brim_number + 1 >= line_count && length > 0 && length < minimal_length) //Make brim or skirt have more lines when total length is too small.
-        {
-            line_count++;
-        }
+    //Make brim have more lines when total length is too small, unless the first layer of support is already fully filled with brim.
+    coord_t length = skirt_brim.polygonLength() + support_brim.polygonLength();
+    while (!lines.back().empty() && length > 0 && length < minimal_length)
+    {
+        offset_distance -= brim_line_width;
+
+        Polygons brim_line = support_outline.offset(offset_distance, ClipperLib::jtRound);
         if (brim_line.empty())
-        { // the fist layer of support is fully filled with brim
+        {
             break;
         }
+        removeSmallHoles(brim_line, brim_line_width);
+        support_brim.add(brim_line);
+
+        length = skirt_brim.polygonLength() + support_brim.polygonLength();
     }
 
     if (support_brim.size())
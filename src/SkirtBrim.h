@@ -4,6 +4,8 @@
 #ifndef SKIRT_BRIM_H
 #define SKIRT_BRIM_H
 
+#include <vector>
+
 #include "utils/Coord_t.h"
 
 namespace cura 
@@ -45,25 +47,46 @@ public:
     static void getFirstLayerOutline(SliceDataStorage& storage, const size_t primary_line_count, const bool is_skirt, Polygons& first_layer_outline);
 
 private:
-    static void generateSupportBrim(SliceDataStorage& storage);
+    /*!
+     * \brief Get the outline of the support on the first layer to generate
+     * the support brim around, and remove the area of the support brim from
+     * the support infill.
+     *
+     * \param storage Storage containing the support on the first layer.
+     * \param[out] support_outline The outline of the support.
+     * \return Whether a support brim needs to be generated.
+     */
+    static bool getSupportBrimOutline(SliceDataStorage& storage, Polygons& support_outline);
+
+    /*!
+     * \brief Add the support brim lines in front of the skirt/brim lines of
+     * the support infill extruder, with more lines if the skirt/brim lines
+     * together are too short.
+     *
+     * \param storage Storage to add the support brim lines to.
+     * \param support_outline The outline from which to offset inward to
+     * generate more support brim lines.
+     * \param lines The support brim lines, from the outside inward.
+     */
+    static void addSupportBrim(SliceDataStorage& storage, const Polygons& support_outline, const std::vector<Polygons>& lines);
 
     /*!
-     * \brief Generate the skirt/brim lines around the model.
+     * \brief Add the skirt/brim lines around the model.
      * 
      * \param start_distance The distance of the first outset from the parts at
      * the first line.
-     * \param primary_line_count Number of offsets / brim lines of the primary
-     * extruder.
+     * \param lines The skirt/brim lines of the primary extruder, from the
+     * inside outward.
      * \param primary_extruder_minimal_length The minimal total length of the
      * skirt/brim lines of the primary extruder.
      * \param first_layer_outline The reference polygons from which to offset
-     * outward to generate skirt/brim lines.
+     * outward to generate more skirt/brim lines.
      * \param[out] skirt_brim_primary_extruder Where to store the resulting
      * brim/skirt lines.
      * \return The offset of the last brim/skirt line from the reference polygon
      * \p first_layer_outline.
      */
-    static int generatePrimarySkirtBrimLines(const coord_t start_distance, size_t primary_line_count, const coord_t primary_extruder_minimal_length, const Polygons& first_layer_outline, Polygons& skirt_brim_primary_extruder);
+    static int addPrimarySkirtBrimLines(const coord_t start_distance, const std::vector<Polygons>& lines, const coord_t primary_extruder_minimal_length, const Polygons& first_layer_outline, Polygons& skirt_brim_primary_extruder);
 };
 }//namespace cura
 
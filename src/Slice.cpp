@@ -1,6 +1,7 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include "Application.h" //To stop when the slice is cancelled.
 #include "ExtruderTrain.h"
 #include "Slice.h"
 #include "utils/logoutput.h"
@@ -15,6 +16,7 @@ Slice::Slice(const size_t num_mesh_groups)
 void Slice::compute()
 {
     logWarning("%s", scene.getAllSettingsString().c_str());
+    //Not in parallel: the settings of the current mesh group are global state for the whole engine.
     for (std::vector<MeshGroup>::iterator mesh_group = scene.mesh_groups.begin(); mesh_group != scene.mesh_groups.end(); mesh_group++)
     {
         scene.current_mesh_group = mesh_group;
@@ -23,6 +25,10 @@ void Slice::compute()
             extruder.settings.setParent(&scene.current_mesh_group->settings);
         }
         scene.processMeshGroup(*mesh_group);
+        if (Application::getInstance().isSliceCancelled())
+        {
+            break;
+        }
     }
 }
 
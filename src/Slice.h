@@ -33,6 +33,12 @@ public:
      *
      * The g-code output is sent through the currently active communication
      * channel.
+     *
+     * The mesh groups are processed one after the other. Their slice data
+     * can't be computed ahead while an earlier group is written, since the
+     * whole engine reads the settings of the mesh group that is being
+     * processed through \ref Scene::current_mesh_group, and the settings of
+     * the extruders inherit from that group.
      */
     void compute();
 
@@ -0,0 +1,329 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <chrono> //To name temporary files.
+#include <cstdio> //For rename and remove.
+#include <fstream>
+#include <iterator> //For istreambuf_iterator.
+
+#include "Application.h" //To not cache the layers of a cancelled slice.
+#include "mesh.h"
+#include "SlicerCache.h"
+#include "settings/AdaptiveLayerHeights.h"
+#include "settings/SettingsRecorder.h"
+#include "utils/BinaryBuffer.h"
+#include "utils/logoutput.h"
+#include "utils/math.h" //For hash_combine.
+
+namespace cura
+{
+
+constexpr size_t SlicerCache::max_variants_on_disk;
+
+//! Identifies the files of the cache and the version of their format.
+static const std::string file_magic("CuraEngine sliced layers 1");
+
+/*!
+ * \brief FNV-1a hash of some data, to check whether a file is intact.
+ */
+static uint64_t checksum(const std::string& data, const size_t size)
+{
+    uint64_t result = 14695981039346656037ull;
+    for (size_t byte_idx = 0; byte_idx < size; byte_idx++)
+    {
+        result = (result ^ static_cast<unsigned char>(data[byte_idx])) * 1099511628211ull;
+    }
+    return result;
+}
+
+/*!
+ * \brief Write polygons, with each point relative to the point before it.
+ */
+static void writePolygons(BinaryWriter& writer, const Polygons& polygons, Point& last_point)
+{
+    writer.writeUnsigned(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        writer.writeUnsigned(polygon.size());
+        for (const Point& point : polygon)
+        {
+            writer.writeSigned(point.X - last_point.X);
+            writer.writeSigned(point.Y - last_point.Y);
+            last_point = point;
+        }
+    }
+}
+
+/*!
+ * \brief Read polygons that were written with \ref writePolygons.
+ */
+static bool readPolygons(BinaryReader& reader, Polygons& polygons, Point& last_point)
+{
+    uint64_t polygon_count;
+    if (!reader.readUnsigned(polygon_count))
+    {
+        return false;
+    }
+    for (uint64_t polygon_idx = 0; polygon_idx < polygon_count; polygon_idx++)
+    {
+        uint64_t point_count;
+        if (!reader.readUnsigned(point_count))
+        {
+            return false;
+        }
+        PolygonRef polygon = polygons.newPoly();
+        for (uint64_t point_idx = 0; point_idx < point_count; point_idx++)
+        {
+            int64_t delta_x;
+            int64_t delta_y;
+            if (!reader.readSigned(delta_x) || !reader.readSigned(delta_y))
+            {
+                return false;
+            }
+            last_point = Point(last_point.X + delta_x, last_point.Y + delta_y);
+            polygon.add(last_point);
+        }
+    }
+    return true;
+}
+
+SlicerCache::SlicerCache()
+: keep_in_memory(true)
+, mesh_group_hash(0)
+{
+}
+
+void SlicerCache::beginSlice(const bool keep_in_memory, const std::string& directory)
+{
+    this->keep_in_memory = keep_in_memory;
+    this->directory = directory;
+
+    for (std::unordered_multimap<uint64_t, Entry>::iterator entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.used)
+        {
+            entry->second.used = false;
+            entry++;
+        }
+        else
+        {
+            entry = entries.erase(entry);
+        }
+    }
+}
+
+void SlicerCache::beginMeshGroup(const coord_t thickness, const size_t slice_layer_count, const std::vector<AdaptiveLayer>* adaptive_layers)
+{
+    mesh_group_hash = 0;
+    hash_combine(mesh_group_hash, thickness);
+    hash_combine(mesh_group_hash, slice_layer_count);
+    if (adaptive_layers)
+    {
+        for (const AdaptiveLayer& layer : *adaptive_layers)
+        {
+            hash_combine(mesh_group_hash, layer.z_position);
+        }
+    }
+}
+
+Slicer* SlicerCache::slice(Mesh& mesh, const coord_t thickness, const size_t slice_layer_count, const bool use_variable_layer_heights, std::vector<AdaptiveLayer>* adaptive_layers)
+{
+    const uint64_t mesh_hash = hash(mesh);
+    const std::pair<std::unordered_multimap<uint64_t, Entry>::iterator, std::unordered_multimap<uint64_t, Entry>::iterator> candidates = entries.equal_range(mesh_hash);
+    for (std::unordered_multimap<uint64_t, Entry>::iterator cached = candidates.first; cached != candidates.second; cached++)
+    {
+        if (cached->second.vertex_count == mesh.vertices.size() && cached->second.face_count == mesh.faces.size() && cached->second.dependencies.match(mesh.settings))
+        {
+            log("Reusing the layers of mesh %s from a previous slice.\n", mesh.mesh_name.c_str());
+            cached->second.used = true;
+            return new Slicer(&mesh, cached->second.layers);
+        }
+    }
+
+    size_t free_variant = max_variants_on_disk; //The first file on disk that's not used yet, if any.
+    if (!directory.empty())
+    {
+        for (size_t variant = 0; variant < max_variants_on_disk; variant++)
+        {
+            const std::string filename = getFilename(mesh_hash, variant);
+            Entry entry;
+            bool exists;
+            if (load(filename, entry, exists) && entry.vertex_count == mesh.vertices.size() && entry.face_count == mesh.faces.size() && entry.dependencies.match(mesh.settings))
+            {
+                log("Reusing the layers of mesh %s from %s.\n", mesh.mesh_name.c_str(), filename.c_str());
+                Slicer* slicer = new Slicer(&mesh, entry.layers);
+                if (keep_in_memory)
+                {
+                    entry.used = true;
+                    entries.emplace(mesh_hash, std::move(entry));
+                }
+                return slicer;
+            }
+            if (!exists)
+            {
+                free_variant = variant;
+                break;
+            }
+        }
+    }
+
+    Slicer* slicer;
+    Entry entry;
+    bool cacheable;
+    {
+        SettingsRecorder recorder;
+        slicer = new Slicer(&mesh, thickness, slice_layer_count, use_variable_layer_heights, adaptive_layers);
+        cacheable = entry.dependencies.record(recorder, mesh.settings) && !Application::getInstance().isSliceCancelled(); //A cancelled slice may have skipped layers.
+    }
+    if (!cacheable || (!keep_in_memory && free_variant == max_variants_on_disk))
+    {
+        return slicer;
+    }
+
+    entry.vertex_count = mesh.vertices.size();
+    entry.face_count = mesh.faces.size();
+    entry.layers.resize(slicer->layers.size());
+    for (size_t layer_nr = 0; layer_nr < slicer->layers.size(); layer_nr++)
+    {
+        //The segments refer to the vertices of this mesh, so they can't be kept. They're not used after slicing anyway.
+        entry.layers[layer_nr].z = slicer->layers[layer_nr].z;
+        entry.layers[layer_nr].polygons = slicer->layers[layer_nr].polygons;
+        entry.layers[layer_nr].openPolylines = slicer->layers[layer_nr].openPolylines;
+    }
+    if (free_variant < max_variants_on_disk)
+    {
+        save(getFilename(mesh_hash, free_variant), entry);
+    }
+    if (keep_in_memory)
+    {
+        entry.used = true;
+        entries.emplace(mesh_hash, std::move(entry));
+    }
+    return slicer;
+}
+
+std::string SlicerCache::getFilename(const uint64_t mesh_hash, const size_t variant) const
+{
+    char hash_string[17];
+    snprintf(hash_string, sizeof(hash_string), "%016llx", static_cast<unsigned long long>(mesh_hash));
+    return directory + "/" + hash_string + "-" + std::to_string(variant) + ".slices";
+}
+
+bool SlicerCache::load(const std::string& filename, Entry& entry, bool& exists) const
+{
+    std::ifstream file(filename, std::ios_base::binary);
+    exists = file.good();
+    if (!exists)
+    {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    //The file ends with a checksum of everything before it, to recognise truncated or garbled files.
+    constexpr size_t checksum_size = 8;
+    if (data.size() < checksum_size)
+    {
+        return false;
+    }
+    const size_t content_size = data.size() - checksum_size;
+    uint64_t stored_checksum = 0;
+    for (size_t byte_idx = 0; byte_idx < checksum_size; byte_idx++)
+    {
+        stored_checksum |= static_cast<uint64_t>(static_cast<unsigned char>(data[content_size + byte_idx])) << (byte_idx * 8);
+    }
+    if (stored_checksum != checksum(data, content_size))
+    {
+        logWarning("Ignoring corrupt slicing cache file %s.\n", filename.c_str());
+        return false;
+    }
+
+    const std::string content = data.substr(0, content_size);
+    BinaryReader reader(content);
+    std::string magic;
+    uint64_t vertex_count;
+    uint64_t face_count;
+    uint64_t layer_count;
+    if (!reader.readString(magic) || magic != file_magic
+        || !reader.readUnsigned(vertex_count) || !reader.readUnsigned(face_count)
+        || !entry.dependencies.deserialise(reader)
+        || !reader.readUnsigned(layer_count))
+    {
+        return false;
+    }
+    entry.vertex_count = vertex_count;
+    entry.face_count = face_count;
+    entry.layers.clear();
+    entry.layers.resize(layer_count);
+    Point last_point(0, 0);
+    for (SlicerLayer& layer : entry.layers)
+    {
+        int64_t z;
+        if (!reader.readSigned(z) || !readPolygons(reader, layer.polygons, last_point) || !readPolygons(reader, layer.openPolylines, last_point))
+        {
+            return false;
+        }
+        layer.z = z;
+    }
+    return reader.atEnd();
+}
+
+void SlicerCache::save(const std::string& filename, const Entry& entry) const
+{
+    BinaryWriter writer;
+    writer.writeString(file_magic);
+    writer.writeUnsigned(entry.vertex_count);
+    writer.writeUnsigned(entry.face_count);
+    entry.dependencies.serialise(writer);
+    writer.writeUnsigned(entry.layers.size());
+    Point last_point(0, 0);
+    for (const SlicerLayer& layer : entry.layers)
+    {
+        writer.writeSigned(layer.z);
+        writePolygons(writer, layer.polygons, last_point);
+        writePolygons(writer, layer.openPolylines, last_point);
+    }
+    std::string data = writer.getData();
+    const uint64_t data_checksum = checksum(data, data.size());
+    for (size_t byte_idx = 0; byte_idx < 8; byte_idx++)
+    {
+        data.push_back(static_cast<char>(data_checksum >> (byte_idx * 8)));
+    }
+
+    //Write to a temporary file first, so that other engines never read a half-written file.
+    const std::string temporary_filename = filename + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream file(temporary_filename, std::ios_base::binary);
+        file.write(data.data(), data.size());
+        if (!file.good())
+        {
+            logWarning("Couldn't write slicing cache file %s.\n", temporary_filename.c_str());
+            file.close();
+            std::remove(temporary_filename.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(temporary_filename.c_str()); //Another engine wrote the same file at the same time.
+    }
+}
+
+uint64_t SlicerCache::hash(const Mesh& mesh) const
+{
+    uint64_t result = mesh_group_hash;
+    for (const MeshVertex& vertex : mesh.vertices)
+    {
+        hash_combine(result, vertex.p.x);
+        hash_combine(result, vertex.p.y);
+        hash_combine(result, vertex.p.z);
+    }
+    for (const MeshFace& face : mesh.faces)
+    {
+        hash_combine(result, face.vertex_index[0]);
+        hash_combine(result, face.vertex_index[1]);
+        hash_combine(result, face.vertex_index[2]);
+    }
+    return result;
+}
+
+} //namespace cura
@@ -0,0 +1,139 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SLICER_CACHE_H
+#define SLICER_CACHE_H
+
+#include <cstdint> //For uint64_t.
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "slicer.h"
+#include "settings/SettingDependencies.h"
+#include "utils/Coord_t.h"
+#include "utils/NoCopy.h"
+
+namespace cura
+{
+
+class AdaptiveLayer;
+class Mesh;
+
+/*!
+ * \brief The sliced layers of meshes, kept between slices.
+ *
+ * When the engine slices repeatedly, most of the meshes are often the same as
+ * in the previous slice, with the same settings. Such meshes don't need to be
+ * sliced again. The cache recognises them by a hash of their vertices and
+ * faces and the heights of the layers, and by the values of the settings that
+ * were read while slicing them.
+ *
+ * Meshes that weren't used in a slice are dropped from the cache at the start
+ * of the next slice, so it holds at most the meshes of two slices.
+ *
+ * Optionally the sliced layers are also written to a directory on disk, so
+ * that other runs of the engine that slice the same meshes can read them
+ * instead. Each file holds the layers of one mesh sliced with one set of
+ * settings. It's named after the hash of the mesh, with a number to tell
+ * apart the files for different settings.
+ */
+class SlicerCache : NoCopy
+{
+    friend class SlicerCacheTest;
+public:
+    SlicerCache();
+
+    /*!
+     * \brief Start a new slice.
+     *
+     * This drops the meshes that weren't used since the previous call.
+     * \param keep_in_memory Whether to keep the sliced meshes in memory for
+     * the next slices.
+     * \param directory The directory to read and write the sliced meshes on
+     * disk, or an empty string to not use the disk.
+     */
+    void beginSlice(const bool keep_in_memory, const std::string& directory);
+
+    /*!
+     * \brief Start slicing the meshes of the current mesh group.
+     *
+     * The layer heights are the same for all meshes of the mesh group, so they
+     * are only hashed once.
+     * \param thickness The layer height.
+     * \param slice_layer_count The number of layers to slice.
+     * \param adaptive_layers The adaptive layers, if adaptive layer heights
+     * are used, or nullptr otherwise.
+     */
+    void beginMeshGroup(const coord_t thickness, const size_t slice_layer_count, const std::vector<AdaptiveLayer>* adaptive_layers);
+
+    /*!
+     * \brief Slice a mesh of the current mesh group, or get the layers that it
+     * was sliced into before.
+     *
+     * The parameters are the same as those of the \ref Slicer constructor,
+     * which must be the same as those given to \ref beginMeshGroup.
+     * \return A new slicer with the sliced layers of the mesh. The caller takes
+     * ownership.
+     */
+    Slicer* slice(Mesh& mesh, const coord_t thickness, const size_t slice_layer_count, const bool use_variable_layer_heights, std::vector<AdaptiveLayer>* adaptive_layers);
+
+private:
+    /*!
+     * \brief The layers of a mesh that was sliced before.
+     */
+    struct Entry
+    {
+        size_t vertex_count; //!< The number of vertices of the mesh, to guard against hash collisions.
+        size_t face_count; //!< The number of faces of the mesh, to guard against hash collisions.
+        SettingDependencies dependencies; //!< The settings that were read while slicing the mesh.
+        std::vector<SlicerLayer> layers; //!< The z and the polygons of the sliced layers, without the segments.
+        bool used; //!< Whether the mesh was used since the last \ref SlicerCache::beginSlice.
+    };
+
+    /*!
+     * \brief The most files to keep for the same mesh sliced with different
+     * settings.
+     */
+    static constexpr size_t max_variants_on_disk = 16;
+
+    /*!
+     * \brief Get the file that the layers of a mesh are kept in on disk.
+     * \param mesh_hash The hash of the mesh.
+     * \param variant Which of the files of the mesh to get, one for each set
+     * of settings that it was sliced with.
+     */
+    std::string getFilename(const uint64_t mesh_hash, const size_t variant) const;
+
+    /*!
+     * \brief Read the layers of a mesh from a file on disk.
+     * \param filename The file to read.
+     * \param[out] entry The layers and the settings they were sliced with.
+     * \param[out] exists Whether the file exists.
+     * \return Whether the file could be read. If not, it's missing, truncated
+     * or corrupt.
+     */
+    bool load(const std::string& filename, Entry& entry, bool& exists) const;
+
+    /*!
+     * \brief Write the layers of a mesh to a file on disk.
+     * \param filename The file to write.
+     * \param entry The layers and the settings they were sliced with.
+     */
+    void save(const std::string& filename, const Entry& entry) const;
+
+    /*!
+     * \brief Compute the hash of the vertices and faces of a mesh with the layer
+     * heights of the current mesh group.
+     */
+    uint64_t hash(const Mesh& mesh) const;
+
+    bool keep_in_memory; //!< Whether to keep the sliced meshes in memory for the next slices.
+    std::string directory; //!< The directory to keep the sliced meshes on disk, or empty to not use the disk.
+    uint64_t mesh_group_hash; //!< Hash of the layer heights, which are the same for all meshes of the current mesh group.
+    std::unordered_multimap<uint64_t, Entry> entries; //!< The sliced meshes by their hash. The same mesh may be sliced with different settings.
+};
+
+} //namespace cura
+
+#endif //SLICER_CACHE_H
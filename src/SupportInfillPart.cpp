@@ -2,7 +2,6 @@
 // CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include "SupportInfillPart.h"
-#include "support.h"
 
 using namespace cura;
 
@@ -18,10 +17,9 @@ SupportInfillPart::SupportInfillPart(const PolygonsPart& outline, coord_t suppor
     infill_area_per_combine_per_density.clear();
 }
 
-bool SupportInfillPart::generateInsetsAndInfillAreas()
+bool SupportInfillPart::generateInfillArea()
 {
-    // generate insets, use the first inset as the wall line, and the second as the infill area
-    AreaSupport::generateOutlineInsets(insets, outline, inset_count_to_generate, support_line_width);
+    // use the first inset as the wall line, and the area inside the last one as the infill area
     if (inset_count_to_generate > 0 && insets.empty())
     {
         return false;
@@ -35,15 +35,18 @@ public:
     SupportInfillPart(const PolygonsPart& outline, coord_t support_line_width, int inset_count_to_generate = 0);
 
     /*!
-     * Initializes this SupportInfillPart by generating its insets and infill area.
+     * Initializes this SupportInfillPart by generating its infill area, inside
+     * of the insets that \ref AreaSupport::generateOutlineInsets generated.
      *
      * \return false if the area is too small and no insets and infill area can be generated, otherwise true.
      */
-    bool generateInsetsAndInfillAreas();
+    bool generateInfillArea();
 
     const Polygons& getInfillArea() const;
 
 private:
+    friend class LayerSpill; //To spill the infill area to disk and read it back.
+
     Polygons infill_area;  //!< The support infill area for generating patterns
 };
 
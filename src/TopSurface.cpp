@@ -84,7 +84,16 @@ bool TopSurface::ironing(const SliceMeshStorage& mesh, const GCodePathConfig& li
     }
     if (!ironing_lines.empty())
     {
-        layer.addLinesByOptimizer(ironing_lines, line_config, SpaceFillType::PolyLines, false, 0, ironing_flow);
+        if (pattern == EFillMethod::LINES)
+        {
+            //The lines are all parallel, so they don't need the generic optimizer to find the order.
+            constexpr int wipe_dist = 0;
+            layer.addParallelLines(ironing_lines, line_config, SpaceFillType::PolyLines, wipe_dist, ironing_flow);
+        }
+        else
+        {
+            layer.addLinesByOptimizer(ironing_lines, line_config, SpaceFillType::PolyLines, false, 0, ironing_flow);
+        }
         added = true;
     }
 
@@ -1,6 +1,11 @@
 //Copyright (c) 2019 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::sort.
+#include <deque>
+#include <map>
+#include <unordered_set>
+
 #include "Application.h" //To get settings.
 #include "ExtruderTrain.h"
 #include "Slice.h"
@@ -15,15 +20,21 @@
 #include "utils/math.h" //For round_up_divide and PI.
 #include "utils/MinimumSpanningTree.h" //For connecting the correct nodes together to form an efficient tree.
 #include "utils/polygon.h" //For splitting polygons into parts.
+#include "utils/PolygonsOccupancyGrid.h" //For testing the grid points against the collision area.
 #include "utils/polygonUtils.h" //For moveInside.
 
 #define SQRT_2 1.4142135623730950488 //Square root of 2.
 #define CIRCLE_RESOLUTION 10 //The number of vertices in each circle.
+#define CIRCLE_CLUSTER_SIZE 10 //The size of the square areas whose circles are unioned together first, in branch diameters.
 
 //The various stages of the process can be weighted differently in the progress bar.
 //These weights are obtained experimentally.
+#define PROGRESS_WEIGHT_AVOIDANCE 10 //Precalculating the avoidance areas.
 #define PROGRESS_WEIGHT_DROPDOWN 50 //Dropping down support.
 #define PROGRESS_WEIGHT_AREAS 1 //Creating support areas.
+#define PROGRESS_WEIGHT_TOTAL (PROGRESS_WEIGHT_AVOIDANCE + PROGRESS_WEIGHT_DROPDOWN + PROGRESS_WEIGHT_AREAS)
+
+#define VOLUMES_CACHE_SIZE (1024 * 1024 * 1024) //Maximum memory taken up by the cached collision, avoidance and internal model volumes, in bytes.
 
 namespace cura
 {
@@ -39,7 +50,7 @@ TreeSupport::TreeSupport(const SliceDataStorage& storage)
         = (angle < TAU / 4) ? (coord_t)(tan(angle) * layer_height) : std::numeric_limits<coord_t>::max();
     const coord_t radius_sample_resolution = mesh_group_settings.get<coord_t>("support_tree_collision_resolution");
 
-    volumes_ = ModelVolumes(storage, xy_distance, maximum_move_distance, radius_sample_resolution);
+    volumes_ = ModelVolumes(storage, xy_distance, maximum_move_distance, radius_sample_resolution, VOLUMES_CACHE_SIZE);
 }
 
 void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
@@ -62,7 +73,7 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
         return;
     }
 
-    std::vector<std::unordered_set<Node*>> contact_nodes;
+    std::vector<std::vector<Node>> contact_nodes;
     contact_nodes.reserve(storage.support.supportLayers.size());
     for (size_t layer_nr = 0; layer_nr < storage.support.supportLayers.size(); layer_nr++) //Generate empty layers to store the points in.
     {
@@ -77,26 +88,21 @@ void TreeSupport::generateSupportAreas(SliceDataStorage& storage)
         generateContactPoints(mesh, contact_nodes);
     }
 
+    //Calculate the areas to avoid from the bottom up, before dropping nodes from the top down needs them.
+    precalculateAvoidance(contact_nodes);
+
     //Drop nodes to lower layers.
     dropNodes(contact_nodes);
 
     //Generate support areas.
     drawCircles(storage, contact_nodes);
 
-    for (auto& layer : contact_nodes)
-    {
-        for (Node* p_node : layer)
-        {
-            delete p_node;
-        }
-        layer.clear();
-    }
     contact_nodes.clear();
 
     storage.support.generated = true;
 }
 
-void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes)
+void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::vector<Node>>& contact_nodes)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     const coord_t branch_radius = mesh_group_settings.get<coord_t>("support_tree_branch_diameter") / 2;
@@ -115,55 +121,103 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
     const double diameter_angle_scale_factor = sin(mesh_group_settings.get<AngleRadians>("support_tree_branch_diameter_angle")) * layer_height / branch_radius; //Scale factor per layer to produce the desired angle.
     const coord_t line_width = mesh_group_settings.get<coord_t>("support_line_width");
     const coord_t resolution = mesh_group_settings.get<coord_t>("support_tree_collision_resolution");
+
+    //The shape of the circle of a node only depends on its distance to the top and, in the tip, on the skin direction. Pre-generate all shapes that occur.
+    size_t max_distance_to_top = 0;
+    for (const std::vector<Node>& layer : contact_nodes)
+    {
+        for (const Node& node : layer)
+        {
+            max_distance_to_top = std::max(max_distance_to_top, node.distance_to_top);
+        }
+    }
+    std::vector<Polygon> tip_circles[2]; //For each skin direction, the circle of each distance to the top within the tip.
+    for (size_t skin_direction = 0; skin_direction < 2; skin_direction++)
+    {
+        for (size_t distance_to_top = 0; distance_to_top < std::min(tip_layers, max_distance_to_top + 1); distance_to_top++)
+        {
+            Polygon circle;
+            const double scale = (double)(distance_to_top + 1) / tip_layers;
+            for (Point corner : branch_circle)
+            {
+                if (skin_direction)
+                {
+                    corner = Point(corner.X * (0.5 + scale / 2) + corner.Y * (0.5 - scale / 2), corner.X * (0.5 - scale / 2) + corner.Y * (0.5 + scale / 2));
+                }
+                else
+                {
+                    corner = Point(corner.X * (0.5 + scale / 2) - corner.Y * (0.5 - scale / 2), corner.X * (-0.5 + scale / 2) + corner.Y * (0.5 + scale / 2));
+                }
+                circle.add(corner);
+            }
+            tip_circles[skin_direction].push_back(circle);
+        }
+    }
+    std::vector<Polygon> branch_circles; //The circle of each distance to the top below the tip, starting at the bottom of the tip.
+    for (size_t distance_to_top = tip_layers; distance_to_top <= max_distance_to_top; distance_to_top++)
+    {
+        Polygon circle;
+        for (const Point corner : branch_circle)
+        {
+            circle.add(corner * (1 + (double)(distance_to_top - tip_layers) * diameter_angle_scale_factor));
+        }
+        branch_circles.push_back(circle);
+    }
+    const coord_t cluster_size = std::max(coord_t(1), CIRCLE_CLUSTER_SIZE * 2 * branch_radius);
+
     size_t completed = 0; //To track progress in a multi-threaded environment.
-#pragma omp parallel for shared(storage, contact_nodes)
+#pragma omp parallel for shared(storage, contact_nodes, tip_circles, branch_circles)
     // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
     for (int layer_nr = 0; layer_nr < static_cast<int>(contact_nodes.size()); layer_nr++)
     {
-        Polygons support_layer;
+        /* Union the circles in batches of nearby circles first. Most circles
+         * overlap only with their neighbours, so the unions of the batches
+         * already remove most of the vertices and intersections before the
+         * batches are unioned together.
+         */
+        std::unordered_map<Point, Polygons> support_clusters; //For each square area of the layer, the circles with their centre in it.
+        std::unordered_map<Point, Polygons> roof_clusters;
         Polygons& roof_layer = storage.support.supportLayers[layer_nr].support_roof;
 
         //Draw the support areas and add the roofs appropriately to the support roof instead of normal areas.
-        for (const Node* p_node : contact_nodes[layer_nr])
+        for (const Node& node : contact_nodes[layer_nr])
         {
-            const Node& node = *p_node;
+            if (node.pruned)
+            {
+                continue;
+            }
 
+            ConstPolygonRef circle_shape = (node.distance_to_top < tip_layers) ? tip_circles[node.skin_direction][node.distance_to_top] : branch_circles[node.distance_to_top - tip_layers];
             Polygon circle;
-            const double scale = (double)(node.distance_to_top + 1) / tip_layers;
-            for (Point corner : branch_circle)
+            for (const Point corner : circle_shape)
             {
-                if (node.distance_to_top < tip_layers) //We're in the tip.
-                {
-                    if (node.skin_direction)
-                    {
-                        corner = Point(corner.X * (0.5 + scale / 2) + corner.Y * (0.5 - scale / 2), corner.X * (0.5 - scale / 2) + corner.Y * (0.5 + scale / 2));
-                    }
-                    else
-                    {
-                        corner = Point(corner.X * (0.5 + scale / 2) - corner.Y * (0.5 - scale / 2), corner.X * (-0.5 + scale / 2) + corner.Y * (0.5 + scale / 2));
-                    }
-                }
-                else
-                {
-                    corner = corner * (1 + (double)(node.distance_to_top - tip_layers) * diameter_angle_scale_factor);
-                }
                 circle.add(node.position + corner);
             }
+            const Point cluster(node.position.X / cluster_size, node.position.Y / cluster_size);
             if (node.support_roof_layers_below >= 0)
             {
-                roof_layer.add(circle);
+                roof_clusters[cluster].add(circle);
             }
             else
             {
-                support_layer.add(circle);
+                support_clusters[cluster].add(circle);
             }
         }
-        support_layer = support_layer.unionPolygons();
-        roof_layer = roof_layer.unionPolygons();
-        support_layer = support_layer.difference(roof_layer);
+        Polygons support_layer;
+        for (const std::pair<const Point, Polygons>& cluster : support_clusters)
+        {
+            support_layer.add(cluster.second.unionPolygons());
+        }
+        support_layer.unionInPlace();
+        for (const std::pair<const Point, Polygons>& cluster : roof_clusters)
+        {
+            roof_layer.add(cluster.second.unionPolygons());
+        }
+        roof_layer.unionInPlace();
+        support_layer.differenceInPlace(roof_layer);
         const size_t z_collision_layer = static_cast<size_t>(std::max(0, static_cast<int>(layer_nr) - static_cast<int>(z_distance_bottom_layers) + 1)); //Layer to test against to create a Z-distance.
-        support_layer = support_layer.difference(volumes_.getCollision(0, z_collision_layer)); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
-        roof_layer = roof_layer.difference(volumes_.getCollision(0, z_collision_layer));
+        support_layer.differenceInPlace(*volumes_.getCollision(0, z_collision_layer)); //Subtract the model itself (sample 0 is with 0 diameter but proper X/Y offset).
+        roof_layer.differenceInPlace(*volumes_.getCollision(0, z_collision_layer));
         //We smooth this support as much as possible without altering single circles. So we remove any line less than the side length of those circles.
         const double diameter_angle_scale_factor_this_layer = (double)(storage.support.supportLayers.size() - layer_nr - tip_layers) * diameter_angle_scale_factor; //Maximum scale factor.
         support_layer.simplify(circle_side_length * (1 + diameter_angle_scale_factor_this_layer), resolution); //Don't deviate more than the collision resolution so that the lines still stack properly.
@@ -190,7 +244,7 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
                 floor_layer.add(support_layer.intersection(storage.getLayerOutlines(sample_layer, no_support, no_prime_tower)));
             }
             floor_layer.unionPolygons();
-            support_layer = support_layer.difference(floor_layer.offset(10)); //Subtract the support floor from the normal support.
+            support_layer.differenceInPlace(floor_layer.offset(10)); //Subtract the support floor from the normal support.
         }
 
         for (PolygonRef part : support_layer) //Convert every part into a PolygonsPart for the support.
@@ -212,13 +266,82 @@ void TreeSupport::drawCircles(SliceDataStorage& storage, const std::vector<std::
         {
             Progress::messageProgress(
                 Progress::Stage::SUPPORT,
-                contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + completed * PROGRESS_WEIGHT_AREAS,
-                contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
+                contact_nodes.size() * (PROGRESS_WEIGHT_AVOIDANCE + PROGRESS_WEIGHT_DROPDOWN) + completed * PROGRESS_WEIGHT_AREAS,
+                contact_nodes.size() * PROGRESS_WEIGHT_TOTAL);
+        }
+    }
+}
+
+void TreeSupport::precalculateAvoidance(const std::vector<std::vector<Node>>& contact_nodes)
+{
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const coord_t layer_height = mesh_group_settings.get<coord_t>("layer_height");
+    const coord_t branch_radius = mesh_group_settings.get<coord_t>("support_tree_branch_diameter") / 2;
+    const size_t tip_layers = branch_radius / layer_height; //The number of layers to be shrinking the circle to create a tip. This produces a 45 degree angle.
+    const double diameter_angle_scale_factor = sin(mesh_group_settings.get<AngleRadians>("support_tree_branch_diameter_angle")) * layer_height / branch_radius; //Scale factor per layer to produce the desired angle.
+
+    LayerIndex top_layer_nr = -1; //The highest layer with contact nodes.
+    for (LayerIndex layer_nr = static_cast<LayerIndex>(contact_nodes.size()) - 1; layer_nr >= 0; layer_nr--)
+    {
+        if (!contact_nodes[layer_nr].empty())
+        {
+            top_layer_nr = layer_nr;
+            break;
+        }
+    }
+    if (top_layer_nr <= 0)
+    {
+        return; //Nothing gets dropped.
+    }
+
+    //For every rounded radius, the highest layer at which a node could request the avoidance with that radius.
+    //A node that has dropped distance_to_top layers requests the avoidance of the layer below it with the radius of distance_to_top + 1, so the radius grows as the layer goes down.
+    std::map<coord_t, LayerIndex> max_layer_per_radius;
+    max_layer_per_radius[volumes_.ceilRadius(0)] = top_layer_nr; //For grouping the nodes into parts.
+    for (LayerIndex layer_nr = top_layer_nr - 1; layer_nr >= 0; layer_nr--)
+    {
+        const size_t distance_to_top = top_layer_nr - layer_nr; //The largest distance_to_top + 1 of a node that requests this layer.
+        const coord_t branch_radius_node = (distance_to_top > tip_layers) ? (branch_radius + branch_radius * distance_to_top * diameter_angle_scale_factor) : (branch_radius * distance_to_top / tip_layers);
+        const coord_t radius = volumes_.ceilRadius(branch_radius_node);
+        if (max_layer_per_radius.find(radius) == max_layer_per_radius.end())
+        {
+            max_layer_per_radius[radius] = layer_nr; //Smaller distances have smaller radii, so the first layer to need this radius is the highest.
+        }
+    }
+
+    //Start with the radii that need the most layers, so that the threads finish at about the same time.
+    std::vector<std::pair<coord_t, LayerIndex>> radii(max_layer_per_radius.begin(), max_layer_per_radius.end());
+    std::sort(radii.begin(), radii.end(), [](const std::pair<coord_t, LayerIndex>& a, const std::pair<coord_t, LayerIndex>& b) { return a.second > b.second; });
+    size_t total_layer_count = 0;
+    for (const std::pair<coord_t, LayerIndex>& radius : radii)
+    {
+        total_layer_count += radius.second + 1;
+    }
+
+    size_t completed = 0; //To track progress in a multi-threaded environment.
+#pragma omp parallel for shared(radii, total_layer_count, completed, contact_nodes) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int radius_idx = 0; radius_idx < static_cast<int>(radii.size()); radius_idx++)
+    {
+        const coord_t radius = radii[radius_idx].first;
+        const LayerIndex max_layer_nr = radii[radius_idx].second;
+        for (LayerIndex layer_nr = 0; layer_nr <= max_layer_nr; layer_nr++)
+        {
+            volumes_.getAvoidance(radius, layer_nr); //Only the layer below is needed to calculate this one, which was just calculated.
+#pragma omp atomic
+            completed++;
+#pragma omp critical (progress)
+            {
+                Progress::messageProgress(
+                    Progress::Stage::SUPPORT,
+                    contact_nodes.size() * PROGRESS_WEIGHT_AVOIDANCE * completed / total_layer_count,
+                    contact_nodes.size() * PROGRESS_WEIGHT_TOTAL);
+            }
         }
     }
 }
 
-void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_nodes)
+void TreeSupport::dropNodes(std::vector<std::vector<Node>>& contact_nodes)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     //Use Minimum Spanning Tree to connect the points on each layer and move them while dropping them down.
@@ -231,33 +354,29 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
     const coord_t radius_sample_resolution = mesh_group_settings.get<coord_t>("support_tree_collision_resolution");
     const bool support_rests_on_model = mesh_group_settings.get<ESupportType>("support_type") == ESupportType::EVERYWHERE;
 
-    std::unordered_set<Node*> to_free_node_set;
-
     for (size_t layer_nr = contact_nodes.size() - 1; layer_nr > 0; layer_nr--) //Skip layer 0, since we can't drop down the vertices there.
     {
         auto& layer_contact_nodes = contact_nodes[layer_nr];
-        std::deque<std::pair<size_t, Node*>> unsupported_branch_leaves; // All nodes that are leaves on this layer that would result in unsupported ('mid-air') branches.
+        std::deque<std::pair<size_t, size_t>> unsupported_branch_leaves; // All nodes (layer and index) that are leaves on this layer that would result in unsupported ('mid-air') branches.
 
         //Group together all nodes for each part.
-        std::vector<PolygonsPart> parts = volumes_.getAvoidance(0, layer_nr).splitIntoParts();
-        std::vector<std::unordered_map<Point, Node*>> nodes_per_part;
-        nodes_per_part.emplace_back(); //All nodes that aren't inside a part get grouped together in the 0th part.
-        for (size_t part_index = 0; part_index < parts.size(); part_index++)
-        {
-            nodes_per_part.emplace_back();
-        }
-        for (Node* p_node : layer_contact_nodes)
+        std::vector<PolygonsPart> parts = volumes_.getAvoidance(0, layer_nr)->splitIntoParts();
+        constexpr size_t no_part = std::numeric_limits<size_t>::max();
+        std::vector<size_t> group_per_node(layer_contact_nodes.size()); //For each node the index of the group it belongs to, or no_part if it's unsupported.
+#pragma omp parallel for shared(layer_contact_nodes, parts, group_per_node) schedule(dynamic, 64)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int node_idx = 0; node_idx < static_cast<int>(layer_contact_nodes.size()); node_idx++)
         {
-            const Node& node = *p_node;
+            const Node& node = layer_contact_nodes[node_idx];
 
             if (!support_rests_on_model && !node.to_buildplate) //Can't rest on model and unable to reach the build plate. Then we must drop the node and leave parts unsupported.
             {
-                unsupported_branch_leaves.push_front({ layer_nr, p_node });
+                group_per_node[node_idx] = no_part;
                 continue;
             }
             if (node.to_buildplate || parts.empty()) //It's outside, so make it go towards the build plate.
             {
-                nodes_per_part[0][node.position] = p_node;
+                group_per_node[node_idx] = 0;
                 continue;
             }
             /* Find which part this node is located in and group the nodes in
@@ -289,30 +408,49 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                 }
             }
             //Put it in the best one.
-            nodes_per_part[closest_part + 1][node.position] = p_node; //Index + 1 because the 0th index is the outside part.
+            group_per_node[node_idx] = closest_part + 1; //Index + 1 because the 0th index is the outside part.
         }
-        //Create a MST for every part.
-        std::vector<MinimumSpanningTree> spanning_trees;
-        for (std::unordered_map<Point, Node*>& group : nodes_per_part)
+        std::vector<std::unordered_map<Point, size_t>> nodes_per_part(parts.size() + 1); //For each part the index of the node at each position. All nodes that aren't inside a part get grouped together in the 0th part.
+        for (size_t node_idx = 0; node_idx < layer_contact_nodes.size(); node_idx++)
         {
-            std::unordered_set<Point> points_to_buildplate;
-            for (const std::pair<Point, Node*>& entry : group)
+            if (group_per_node[node_idx] == no_part)
             {
-                points_to_buildplate.insert(entry.first); //Just the position of the node.
+                unsupported_branch_leaves.push_front({ layer_nr, node_idx });
+            }
+            else
+            {
+                nodes_per_part[group_per_node[node_idx]][layer_contact_nodes[node_idx].position] = node_idx;
             }
-            spanning_trees.emplace_back(points_to_buildplate);
         }
 
-        for (size_t group_index = 0; group_index < nodes_per_part.size(); group_index++)
+        /* The parts don't share any nodes, so each part is dropped down on its
+         * own thread. The new nodes and the unsupported leaves are collected
+         * per part and added in the order of the parts afterwards, so that
+         * the result doesn't depend on the scheduling of the threads.
+         */
+        std::vector<std::vector<Node>> dropped_nodes_per_part(nodes_per_part.size());
+        std::vector<std::vector<size_t>> unsupported_leaves_per_part(nodes_per_part.size());
+#pragma omp parallel for shared(layer_contact_nodes, nodes_per_part, dropped_nodes_per_part, unsupported_leaves_per_part) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int group_index = 0; group_index < static_cast<int>(nodes_per_part.size()); group_index++)
         {
-            const MinimumSpanningTree& mst = spanning_trees[group_index];
+            std::vector<Node>& dropped_nodes = dropped_nodes_per_part[group_index];
+            std::vector<size_t>& unsupported_leaves = unsupported_leaves_per_part[group_index];
+
+            //Create a MST for the part.
+            std::unordered_set<Point> points_to_buildplate;
+            for (const std::pair<const Point, size_t>& entry : nodes_per_part[group_index])
+            {
+                points_to_buildplate.insert(entry.first); //Just the position of the node.
+            }
+            const MinimumSpanningTree mst(points_to_buildplate);
             //In the first pass, merge all nodes that are close together.
-            std::unordered_set<Node*> to_delete;
-            for (const std::pair<Point, Node*>& entry : nodes_per_part[group_index])
+            std::unordered_set<size_t> to_delete;
+            for (const std::pair<const Point, size_t>& entry : nodes_per_part[group_index])
             {
-                Node* p_node = entry.second;
-                const Node& node = *p_node;
-                if (to_delete.find(p_node) != to_delete.end())
+                const size_t node_idx = entry.second;
+                Node& node = layer_contact_nodes[node_idx];
+                if (to_delete.find(node_idx) != to_delete.end())
                 {
                     continue; //Delete this node (don't create a new node for it on the next layer).
                 }
@@ -327,16 +465,17 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                     {
                         //Avoid collisions.
                         const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + 100; //100 micron extra for rounding errors.
-                        PolygonUtils::moveOutside(volumes_.getAvoidance(branch_radius_node, layer_nr - 1), next_position, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
+                        PolygonUtils::moveOutside(*volumes_.getAvoidance(branch_radius_node, layer_nr - 1), next_position, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
                     }
                     else
                     {
                         //Move towards centre of polygon.
-                        const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(node.position, volumes_.getInternalModel(branch_radius_node, layer_nr - 1));
+                        const std::shared_ptr<const Polygons> internal_model = volumes_.getInternalModel(branch_radius_node, layer_nr - 1); //Hold on to it, since closest_point_on_border refers to it.
+                        const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(node.position, *internal_model);
                         const coord_t distance = vSize(node.position - closest_point_on_border.location);
                         //Try moving a bit further inside: Current distance + 1 step.
                         Point moved_inside = next_position;
-                        PolygonUtils::ensureInsideOrOutside(volumes_.getInternalModel(branch_radius_node, layer_nr - 1), moved_inside, closest_point_on_border, distance + maximum_move_distance);
+                        PolygonUtils::ensureInsideOrOutside(*internal_model, moved_inside, closest_point_on_border, distance + maximum_move_distance);
                         Point difference = moved_inside - node.position;
                         if(vSize2(difference) > maximum_move_distance * maximum_move_distance)
                         {
@@ -345,15 +484,14 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                         next_position = node.position + difference;
                     }
 
-                    const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1).inside(next_position);
-                    Node* next_node = new Node(next_position, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
-                    insertDroppedNode(contact_nodes[layer_nr - 1], next_node); //Insert the node, resolving conflicts of the two colliding nodes.
+                    const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1)->inside(next_position);
+                    dropped_nodes.emplace_back(next_position, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, node_idx);
 
                     // Make sure the next pass doens't drop down either of these (since that already happened).
-                    Node *const neighbour = nodes_per_part[group_index][neighbours[0]];
-                    node.merged_neighbours.push_front(neighbour);
-                    to_delete.insert(neighbour);
-                    to_delete.insert(p_node);
+                    const size_t neighbour_idx = nodes_per_part[group_index][neighbours[0]];
+                    node.merged_neighbours.push_back(neighbour_idx);
+                    to_delete.insert(neighbour_idx);
+                    to_delete.insert(node_idx);
                 }
                 else if (neighbours.size() > 1) //Don't merge leaf nodes because we would then incur movement greater than the maximum move distance.
                 {
@@ -362,35 +500,36 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                     {
                         if (vSize2(neighbour - node.position) < maximum_move_distance * maximum_move_distance)
                         {
-                            Node* neighbour_node = nodes_per_part[group_index][neighbour];
-                            node.distance_to_top = std::max(node.distance_to_top, neighbour_node->distance_to_top);
-                            node.support_roof_layers_below = std::max(node.support_roof_layers_below, neighbour_node->support_roof_layers_below);
-                            node.merged_neighbours.push_front(neighbour_node);
-                            node.merged_neighbours.insert_after(node.merged_neighbours.end(), neighbour_node->merged_neighbours.begin(), neighbour_node->merged_neighbours.end());
-                            to_delete.insert(neighbour_node);
+                            const size_t neighbour_idx = nodes_per_part[group_index][neighbour];
+                            const Node& neighbour_node = layer_contact_nodes[neighbour_idx];
+                            node.distance_to_top = std::max(node.distance_to_top, neighbour_node.distance_to_top);
+                            node.support_roof_layers_below = std::max(node.support_roof_layers_below, neighbour_node.support_roof_layers_below);
+                            node.merged_neighbours.push_back(neighbour_idx);
+                            node.merged_neighbours.insert(node.merged_neighbours.end(), neighbour_node.merged_neighbours.begin(), neighbour_node.merged_neighbours.end());
+                            to_delete.insert(neighbour_idx);
                         }
                     }
                 }
             }
             //In the second pass, move all middle nodes.
-            for (std::pair<Point, Node*> entry : nodes_per_part[group_index])
+            for (const std::pair<const Point, size_t>& entry : nodes_per_part[group_index])
             {
-                Node* p_node = entry.second;
-                const Node& node = *p_node;
-                if (to_delete.find(p_node) != to_delete.end())
+                const size_t node_idx = entry.second;
+                const Node& node = layer_contact_nodes[node_idx];
+                if (to_delete.find(node_idx) != to_delete.end())
                 {
                     continue;
                 }
                 //If the branch falls completely inside a collision area (the entire branch would be removed by the X/Y offset), delete it.
-                if (group_index > 0 && volumes_.getCollision(0, layer_nr).inside(node.position))
+                if (group_index > 0 && volumes_.getCollision(0, layer_nr)->inside(node.position))
                 {
                     const coord_t branch_radius_node = (node.distance_to_top > tip_layers) ? (branch_radius + branch_radius * node.distance_to_top * diameter_angle_scale_factor) : (branch_radius * node.distance_to_top / tip_layers);
-                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, volumes_.getCollision(0, layer_nr));
+                    const ClosestPolygonPoint to_outside = PolygonUtils::findClosest(node.position, *volumes_.getCollision(0, layer_nr));
                     if (vSize2(node.position - to_outside.location) >= branch_radius_node * branch_radius_node) //Too far inside.
                     {
                         if (! support_rests_on_model)
                         {
-                            unsupported_branch_leaves.push_front({ layer_nr, p_node });
+                            unsupported_leaves.push_back(node_idx);
                         }
                         continue;
                     }
@@ -420,16 +559,17 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                 {
                     //Avoid collisions.
                     const coord_t maximum_move_between_samples = maximum_move_distance + radius_sample_resolution + 100; //100 micron extra for rounding errors.
-                    PolygonUtils::moveOutside(volumes_.getAvoidance(branch_radius_node, layer_nr - 1), next_layer_vertex, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
+                    PolygonUtils::moveOutside(*volumes_.getAvoidance(branch_radius_node, layer_nr - 1), next_layer_vertex, radius_sample_resolution + 100, maximum_move_between_samples * maximum_move_between_samples); //Some extra offset to prevent rounding errors with the sample resolution.
                 }
                 else
                 {
                     //Move towards centre of polygon.
-                    const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(next_layer_vertex, volumes_.getInternalModel(branch_radius_node, layer_nr - 1));
+                    const std::shared_ptr<const Polygons> internal_model = volumes_.getInternalModel(branch_radius_node, layer_nr - 1); //Hold on to it, since closest_point_on_border refers to it.
+                    const ClosestPolygonPoint closest_point_on_border = PolygonUtils::findClosest(next_layer_vertex, *internal_model);
                     const coord_t distance = vSize(node.position - closest_point_on_border.location);
                     //Try moving a bit further inside: Current distance + 1 step.
                     Point moved_inside = next_layer_vertex;
-                    PolygonUtils::ensureInsideOrOutside(volumes_.getInternalModel(branch_radius_node, layer_nr - 1), moved_inside, closest_point_on_border, distance + maximum_move_distance);
+                    PolygonUtils::ensureInsideOrOutside(*internal_model, moved_inside, closest_point_on_border, distance + maximum_move_distance);
                     Point difference = moved_inside - node.position;
                     if(vSize2(difference) > maximum_move_distance * maximum_move_distance)
                     {
@@ -438,9 +578,16 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
                     next_layer_vertex = node.position + difference;
                 }
 
-                const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1).inside(next_layer_vertex);
-                Node* next_node = new Node(next_layer_vertex, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, p_node);
-                insertDroppedNode(contact_nodes[layer_nr - 1], next_node);
+                const bool to_buildplate = !volumes_.getAvoidance(branch_radius_node, layer_nr - 1)->inside(next_layer_vertex);
+                dropped_nodes.emplace_back(next_layer_vertex, node.distance_to_top + 1, node.skin_direction, node.support_roof_layers_below - 1, to_buildplate, node_idx);
+            }
+        }
+        for (size_t group_index = 0; group_index < nodes_per_part.size(); group_index++)
+        {
+            contact_nodes[layer_nr - 1].insert(contact_nodes[layer_nr - 1].end(), dropped_nodes_per_part[group_index].begin(), dropped_nodes_per_part[group_index].end());
+            for (const size_t unsupported_leaf : unsupported_leaves_per_part[group_index])
+            {
+                unsupported_branch_leaves.push_front({ layer_nr, unsupported_leaf });
             }
         }
 
@@ -448,31 +595,27 @@ void TreeSupport::dropNodes(std::vector<std::unordered_set<Node*>>& contact_node
         for (;! unsupported_branch_leaves.empty(); unsupported_branch_leaves.pop_back())
         {
             const auto& entry = unsupported_branch_leaves.back();
-            Node* i_node = entry.second;
-            for (size_t i_layer = entry.first; i_node != nullptr; ++i_layer, i_node = i_node->parent)
+            size_t i_node = entry.second;
+            for (size_t i_layer = entry.first; i_node != Node::NO_PARENT; ++i_layer)
             {
-                contact_nodes[i_layer].erase(i_node);
-                to_free_node_set.insert(i_node);
-                for (Node* neighbour : i_node->merged_neighbours)
+                Node& node = contact_nodes[i_layer][i_node];
+                node.pruned = true;
+                for (const size_t neighbour : node.merged_neighbours)
                 {
                     unsupported_branch_leaves.push_front({i_layer, neighbour});
                 }
+                i_node = node.parent;
             }
         }
 
         Progress::messageProgress(
-            Progress::Stage::SUPPORT, (contact_nodes.size() - layer_nr) * PROGRESS_WEIGHT_DROPDOWN,
-            contact_nodes.size() * PROGRESS_WEIGHT_DROPDOWN + contact_nodes.size() * PROGRESS_WEIGHT_AREAS);
+            Progress::Stage::SUPPORT, contact_nodes.size() * PROGRESS_WEIGHT_AVOIDANCE + (contact_nodes.size() - layer_nr) * PROGRESS_WEIGHT_DROPDOWN,
+            contact_nodes.size() * PROGRESS_WEIGHT_TOTAL);
     }
 
-    for (Node *node : to_free_node_set)
-    {
-        delete node;
-    }
-    to_free_node_set.clear();
 }
 
-void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<TreeSupport::Node*>>& contact_nodes)
+void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::vector<TreeSupport::Node>>& contact_nodes)
 {
     const coord_t point_spread = mesh.settings.get<coord_t>("support_tree_branch_distance");
 
@@ -520,13 +663,20 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
     const size_t z_distance_top_layers = round_up_divide(z_distance_top, layer_height) + 1; //Support must always be 1 layer below overhang.
     const size_t support_roof_layers = mesh.settings.get<bool>("support_roof_enable") ? round_divide(mesh.settings.get<coord_t>("support_roof_height"), mesh.settings.get<coord_t>("layer_height")) : 0; //How many roof layers, if roof is enabled.
     const coord_t half_overhang_distance = tan(mesh.settings.get<AngleRadians>("support_angle")) * layer_height / 2;
-    for (size_t layer_nr = 1; (int)layer_nr < (int)mesh.overhang_areas.size() - (int)z_distance_top_layers; layer_nr++)
+    //Each layer only adds nodes to its own list, in the order of the overhang parts and grid points, so the layers are processed in parallel.
+#pragma omp parallel for shared(mesh, contact_nodes, grid_points, bounding_box) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 1; layer_nr < static_cast<int>(mesh.overhang_areas.size()) - static_cast<int>(z_distance_top_layers); layer_nr++)
     {
         const Polygons& overhang = mesh.overhang_areas[layer_nr + z_distance_top_layers];
         if (overhang.empty())
         {
             continue;
         }
+        //Most grid points are far from the border of the collision area, so rasterise it at the grid spacing where the grid points are tested, and only test the points near its border exactly.
+        AABB overhang_region(overhang);
+        overhang_region.expand(half_overhang_distance);
+        const PolygonsOccupancyGrid collision(*volumes_.getCollision(0, layer_nr), point_spread, overhang_region);
 
         for (const ConstPolygonRef overhang_part : overhang)
         {
@@ -540,12 +690,11 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
                     constexpr coord_t distance_inside = 0; //Move point towards the border of the polygon if it is closer than half the overhang distance: Catch points that fall between overhang areas on constant surfaces.
                     PolygonUtils::moveInside(overhang_part, candidate, distance_inside, half_overhang_distance * half_overhang_distance);
                     constexpr bool border_is_inside = true;
-                    if (overhang_part.inside(candidate, border_is_inside) && !volumes_.getCollision(0, layer_nr).inside(candidate, border_is_inside))
+                    if (overhang_part.inside(candidate, border_is_inside) && !collision.inside(candidate, border_is_inside))
                     {
                         constexpr size_t distance_to_top = 0;
                         constexpr bool to_buildplate = true;
-                        Node* contact_node = new Node(candidate, distance_to_top, (layer_nr + z_distance_top_layers) % 2, support_roof_layers, to_buildplate, Node::NO_PARENT);
-                        contact_nodes[layer_nr].insert(contact_node);
+                        contact_nodes[layer_nr].push_back(Node(candidate, distance_to_top, (layer_nr + z_distance_top_layers) % 2, support_roof_layers, to_buildplate, Node::NO_PARENT));
                         added = true;
                     }
                 }
@@ -556,34 +705,25 @@ void TreeSupport::generateContactPoints(const SliceMeshStorage& mesh, std::vecto
                 PolygonUtils::moveInside(overhang_part, candidate);
                 constexpr size_t distance_to_top = 0;
                 constexpr bool to_buildplate = true;
-                Node* contact_node = new Node(candidate, distance_to_top, layer_nr % 2, support_roof_layers, to_buildplate, Node::NO_PARENT);
-                contact_nodes[layer_nr].insert(contact_node);
+                contact_nodes[layer_nr].push_back(Node(candidate, distance_to_top, layer_nr % 2, support_roof_layers, to_buildplate, Node::NO_PARENT));
             }
         }
     }
 }
 
-void TreeSupport::insertDroppedNode(std::unordered_set<Node*>& nodes_layer, Node* p_node)
-{
-    std::unordered_set<Node*>::iterator conflicting_node_it = nodes_layer.find(p_node);
-    if (conflicting_node_it == nodes_layer.end()) //No conflict.
-    {
-        nodes_layer.insert(p_node);
-        return;
-    }
-
-    Node* conflicting_node = *conflicting_node_it;
-    conflicting_node->distance_to_top = std::max(conflicting_node->distance_to_top, p_node->distance_to_top);
-    conflicting_node->support_roof_layers_below = std::max(conflicting_node->support_roof_layers_below, p_node->support_roof_layers_below);
-}
-
 ModelVolumes::ModelVolumes(const SliceDataStorage& storage, coord_t xy_distance, coord_t max_move,
-                           coord_t radius_sample_resolution) :
+                           coord_t radius_sample_resolution, size_t cache_size) :
     machine_border_{calculateMachineBorderCollision(storage.getMachineBorder())},
     xy_distance_{xy_distance},
     max_move_{max_move},
-    radius_sample_resolution_{radius_sample_resolution}
+    radius_sample_resolution_{radius_sample_resolution},
+    collision_cache_{new VolumeCache(cache_size / 3, getMemorySize)},
+    avoidance_cache_{new VolumeCache(cache_size / 3, getMemorySize)},
+    internal_model_cache_{new VolumeCache(cache_size / 3, getMemorySize)}
 {
+    collision_cache_->trackMemory(MemoryAccount::MODEL_VOLUMES);
+    avoidance_cache_->trackMemory(MemoryAccount::MODEL_VOLUMES);
+    internal_model_cache_->trackMemory(MemoryAccount::MODEL_VOLUMES);
     for (std::size_t layer_idx  = 0; layer_idx < storage.support.supportLayers.size(); ++layer_idx)
     {
         constexpr bool include_support = false;
@@ -592,49 +732,25 @@ ModelVolumes::ModelVolumes(const SliceDataStorage& storage, coord_t xy_distance,
     }
 }
 
-const Polygons& ModelVolumes::getCollision(coord_t radius, LayerIndex layer_idx) const
+std::shared_ptr<const Polygons> ModelVolumes::getCollision(coord_t radius, LayerIndex layer_idx) const
 {
     radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = collision_cache_.find(key);
-    if (it != collision_cache_.end())
-    {
-        return it->second;
-    }
-    else
-    {
-        return calculateCollision(key);
-    }
+    const RadiusLayerPair key{radius, layer_idx};
+    return collision_cache_->get(key, [this, &key]() { return calculateCollision(key); });
 }
 
-const Polygons& ModelVolumes::getAvoidance(coord_t radius, LayerIndex layer_idx) const
+std::shared_ptr<const Polygons> ModelVolumes::getAvoidance(coord_t radius, LayerIndex layer_idx) const
 {
     radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = avoidance_cache_.find(key);
-    if (it != avoidance_cache_.end())
-    {
-        return it->second;
-    }
-    else
-    {
-        return calculateAvoidance(key);
-    }
+    const RadiusLayerPair key{radius, layer_idx};
+    return avoidance_cache_->get(key, [this, &key]() { return calculateAvoidance(key); });
 }
 
-const Polygons& ModelVolumes::getInternalModel(coord_t radius, LayerIndex layer_idx) const
+std::shared_ptr<const Polygons> ModelVolumes::getInternalModel(coord_t radius, LayerIndex layer_idx) const
 {
     radius = ceilRadius(radius);
-    RadiusLayerPair key{radius, layer_idx};
-    const auto it = internal_model_cache_.find(key);
-    if (it != internal_model_cache_.end())
-    {
-        return it->second;
-    }
-    else
-    {
-        return calculateInternalModel(key);
-    }
+    const RadiusLayerPair key{radius, layer_idx};
+    return internal_model_cache_->get(key, [this, &key]() { return calculateInternalModel(key); });
 }
 
 coord_t ModelVolumes::ceilRadius(coord_t radius) const
@@ -644,7 +760,7 @@ coord_t ModelVolumes::ceilRadius(coord_t radius) const
     return radius + delta;
 }
 
-const Polygons& ModelVolumes::calculateCollision(const RadiusLayerPair& key) const
+Polygons ModelVolumes::calculateCollision(const RadiusLayerPair& key) const
 {
     const auto& radius = key.first;
     const auto& layer_idx = key.second;
@@ -652,23 +768,19 @@ const Polygons& ModelVolumes::calculateCollision(const RadiusLayerPair& key) con
     auto collision_areas = machine_border_;
     if (layer_idx < static_cast<int>(layer_outlines_.size()))
     {
-        collision_areas = collision_areas.unionPolygons(layer_outlines_[layer_idx]);
+        collision_areas.unionInPlace(layer_outlines_[layer_idx]);
     }
-    collision_areas = collision_areas.offset(xy_distance_ + radius, ClipperLib::JoinType::jtRound);
-    const auto ret = collision_cache_.insert({key, std::move(collision_areas)});
-    assert(ret.second);
-    return ret.first->second;
+    return collision_areas.offset(xy_distance_ + radius, ClipperLib::JoinType::jtRound);
 }
 
-const Polygons& ModelVolumes::calculateAvoidance(const RadiusLayerPair& key) const
+Polygons ModelVolumes::calculateAvoidance(const RadiusLayerPair& key) const
 {
     const auto& radius = key.first;
     const auto& layer_idx = key.second;
 
     if (layer_idx == 0)
     {
-        avoidance_cache_[key] = getCollision(radius, 0);
-        return avoidance_cache_[key];
+        return *getCollision(radius, 0);
     }
 
     // Avoidance for a given layer depends on all layers beneath it so could have very deep recursion depths if
@@ -679,27 +791,21 @@ const Polygons& ModelVolumes::calculateAvoidance(const RadiusLayerPair& key) con
     constexpr auto max_recursion_depth = 100;
     // Check if we would exceed the recursion limit by trying to process this layer
     if (layer_idx >= max_recursion_depth
-        && avoidance_cache_.find({radius, layer_idx - max_recursion_depth}) == avoidance_cache_.end())
+        && !avoidance_cache_->contains({radius, layer_idx - max_recursion_depth}))
     {
         // Force the calculation of the layer `max_recursion_depth` below our current one, ignoring the result.
         getAvoidance(radius, layer_idx - max_recursion_depth);
     }
-    auto avoidance_areas = getAvoidance(radius, layer_idx - 1).offset(-max_move_).smooth(5);
-    avoidance_areas = avoidance_areas.unionPolygons(getCollision(radius, layer_idx));
-    const auto ret = avoidance_cache_.insert({key, std::move(avoidance_areas)});
-    assert(ret.second);
-    return ret.first->second;
+    auto avoidance_areas = getAvoidance(radius, layer_idx - 1)->offset(-max_move_).smooth(5);
+    return avoidance_areas.unionPolygons(*getCollision(radius, layer_idx));
 }
 
-const Polygons& ModelVolumes::calculateInternalModel(const RadiusLayerPair& key) const
+Polygons ModelVolumes::calculateInternalModel(const RadiusLayerPair& key) const
 {
     const auto& radius = key.first;
     const auto& layer_idx = key.second;
 
-    const auto& internal_areas = getAvoidance(radius, layer_idx).difference(getCollision(radius, layer_idx));
-    const auto ret = internal_model_cache_.insert({key, internal_areas});
-    assert(ret.second);
-    return ret.first->second;
+    return getAvoidance(radius, layer_idx)->difference(*getCollision(radius, layer_idx));
 }
 
 Polygons ModelVolumes::calculateMachineBorderCollision(Polygon machine_border)
@@ -710,4 +816,9 @@ Polygons ModelVolumes::calculateMachineBorderCollision(Polygon machine_border)
     machine_volume_border.add(machine_border);
     return machine_volume_border;
 }
+
+size_t ModelVolumes::getMemorySize(const Polygons& polygons)
+{
+    return polygons.getMemorySize();
+}
 }
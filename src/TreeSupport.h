@@ -4,8 +4,11 @@
 #ifndef TREESUPPORT_H
 #define TREESUPPORT_H
 
-#include <forward_list>
-#include <unordered_set>
+#include <limits> //For the index of no parent.
+#include <memory> //For shared_ptr and unique_ptr.
+#include <vector>
+
+#include "utils/ConcurrentLRUCache.h"
 
 
 namespace cura
@@ -13,7 +16,10 @@ namespace cura
 /*!
  * \brief Lazily generates tree guidance volumes.
  *
- * \warning This class is not currently thread-safe and should not be accessed in OpenMP blocks
+ * The volumes may be requested from multiple threads at the same time. Each
+ * volume is generated only once while it's in the cache, but the caches hold a
+ * limited amount of memory, so volumes that weren't used for a while may have
+ * to be generated again.
  */
 class ModelVolumes
 {
@@ -29,9 +35,11 @@ public:
      * \param max_move The maximum allowable movement between nodes on
      * adjacent layers
      * \param radius_sample_resolution Sample size used to round requested node radii.
+     * \param cache_size The maximum number of bytes that the cached collision,
+     * avoidance and internal model volumes may take up together.
      */
     ModelVolumes(const SliceDataStorage& storage, coord_t xy_distance, coord_t max_move,
-                 coord_t radius_sample_resolution);
+                 coord_t radius_sample_resolution, size_t cache_size);
 
     ModelVolumes(ModelVolumes&&) = default;
     ModelVolumes& operator=(ModelVolumes&&) = default;
@@ -47,9 +55,9 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object, which stays valid as long as it's held on to
      */
-    const Polygons& getCollision(coord_t radius, LayerIndex layer_idx) const;
+    std::shared_ptr<const Polygons> getCollision(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Creates the areas that have to be avoided by the tree's branches
@@ -63,9 +71,9 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object, which stays valid as long as it's held on to
      */
-    const Polygons& getAvoidance(coord_t radius, LayerIndex layer_idx) const;
+    std::shared_ptr<const Polygons> getAvoidance(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Generates the area of a given layer that must be avoided if the
@@ -76,30 +84,32 @@ public:
      *
      * \param radius The radius of the node of interest
      * \param layer The layer of interest
-     * \return Polygons object
+     * \return Polygons object, which stays valid as long as it's held on to
      */
-    const Polygons& getInternalModel(coord_t radius, LayerIndex layer_idx) const;
-
-private:
-    /*!
-     * \brief Convenience typedef for the keys to the caches
-     */
-    using RadiusLayerPair = std::pair<coord_t, LayerIndex>;
+    std::shared_ptr<const Polygons> getInternalModel(coord_t radius, LayerIndex layer_idx) const;
 
     /*!
      * \brief Round \p radius upwards to a multiple of radius_sample_resolution_
      *
+     * All radii within the same multiple share the same volumes.
+     *
      * \param radius The radius of the node of interest
      */
     coord_t ceilRadius(coord_t radius) const;
 
+private:
+    /*!
+     * \brief Convenience typedef for the keys to the caches
+     */
+    using RadiusLayerPair = std::pair<coord_t, LayerIndex>;
+
     /*!
      * \brief Calculate the collision areas at the radius and layer indicated
      * by \p key.
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateCollision(const RadiusLayerPair& key) const;
+    Polygons calculateCollision(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the avoidance areas at the radius and layer indicated
@@ -107,7 +117,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateAvoidance(const RadiusLayerPair& key) const;
+    Polygons calculateAvoidance(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the internal model areas at the radius and layer
@@ -115,7 +125,7 @@ private:
      *
      * \param key The radius and layer of the node of interest
      */
-    const Polygons& calculateInternalModel(const RadiusLayerPair& key) const;
+    Polygons calculateInternalModel(const RadiusLayerPair& key) const;
 
     /*!
      * \brief Calculate the collision area around the printable area of the machine.
@@ -124,6 +134,14 @@ private:
      */
     static Polygons calculateMachineBorderCollision(Polygon machine_border);
 
+    /*!
+     * \brief Estimate how much memory some cached polygons take up.
+     *
+     * \param polygons The polygons to estimate the memory size of
+     * \return The approximate size in bytes
+     */
+    static size_t getMemorySize(const Polygons& polygons);
+
     /*!
      * \brief Polygons representing the limits of the printable area of the
      * machine
@@ -159,14 +177,14 @@ private:
      * \brief Caches for the collision, avoidance and internal model polygons
      * at given radius and layer indices.
      *
-     * These are mutable to allow modification from const function. This is
-     * generally considered OK as the functions are still logically const
-     * (ie there is no difference in behaviour for the user betweeen
-     * calculating the values each time vs caching the results).
+     * The caches take care of their own locking, so that the volumes can be
+     * requested from multiple threads. They are held by pointer since they
+     * can't be moved.
      */
-    mutable std::unordered_map<RadiusLayerPair, Polygons> collision_cache_;
-    mutable std::unordered_map<RadiusLayerPair, Polygons> avoidance_cache_;
-    mutable std::unordered_map<RadiusLayerPair, Polygons> internal_model_cache_;
+    using VolumeCache = ConcurrentLRUCache<RadiusLayerPair, Polygons>;
+    std::unique_ptr<VolumeCache> collision_cache_;
+    std::unique_ptr<VolumeCache> avoidance_cache_;
+    std::unique_ptr<VolumeCache> internal_model_cache_;
 };
 
 class SliceDataStorage;
@@ -196,10 +214,13 @@ public:
 
     /*!
      * \brief Represents the metadata of a node in the tree.
+     *
+     * The nodes of each layer are stored contiguously, and nodes refer to
+     * other nodes by their index in the layer.
      */
     struct Node
     {
-        static constexpr Node* NO_PARENT = nullptr;
+        static constexpr size_t NO_PARENT = std::numeric_limits<size_t>::max();
 
         Node()
          : distance_to_top(0)
@@ -207,26 +228,20 @@ public:
          , skin_direction(false)
          , support_roof_layers_below(0)
          , to_buildplate(true)
-         , parent(nullptr)
+         , parent(NO_PARENT)
+         , pruned(false)
         {}
 
-        Node(const Point position, const size_t distance_to_top, const bool skin_direction, const int support_roof_layers_below, const bool to_buildplate, Node* const parent)
+        Node(const Point position, const size_t distance_to_top, const bool skin_direction, const int support_roof_layers_below, const bool to_buildplate, const size_t parent)
          : distance_to_top(distance_to_top)
          , position(position)
          , skin_direction(skin_direction)
          , support_roof_layers_below(support_roof_layers_below)
          , to_buildplate(to_buildplate)
          , parent(parent)
+         , pruned(false)
         {}
 
-#ifdef DEBUG // Clear the delete node's data so if there's invalid access after, we may get a clue by inspecting that node.
-        ~Node()
-        {
-            parent = nullptr;
-            merged_neighbours.clear();
-        }
-#endif // DEBUG
-
         /*!
          * \brief The number of layers to go to the top of this branch.
          */
@@ -265,22 +280,32 @@ public:
         mutable bool to_buildplate;
 
         /*!
-         * \brief The originating node for this one, one layer higher.
+         * \brief The index of the originating node for this one, in the layer
+         * one higher, or NO_PARENT if this is a contact node.
          *
          * In order to prune branches that can't have any support (because they
          * can't be on the model and the path to the buildplate isn't clear),
          * the entire branch needs to be known.
          */
-        Node *parent;
+        size_t parent;
 
         /*!
-        * \brief All neighbours (on the same layer) that where merged into this node.
+        * \brief The indices of all neighbours (on the same layer) that where merged into this node.
         *
         * In order to prune branches that can't have any support (because they
         * can't be on the model and the path to the buildplate isn't clear),
         * the entire branch needs to be known.
         */
-        mutable std::forward_list<Node*> merged_neighbours;
+        std::vector<size_t> merged_neighbours;
+
+        /*!
+         * \brief Whether this node was removed because its branch can't be
+         * supported.
+         *
+         * Nodes stay in their layer when pruned, so that the indices of the
+         * other nodes remain valid.
+         */
+        bool pruned;
 
         bool operator==(const Node& other) const
         {
@@ -292,11 +317,11 @@ private:
     /*!
      * \brief Generator for model collision, avoidance and internal guide volumes
      *
-     * Lazily computes volumes as needed.
-     *  \warning This class is NOT currently thread-safe and should not be accessed in OpenMP blocks
+     * Lazily computes volumes as needed. It may be used from multiple threads.
      */
     ModelVolumes volumes_;
 
+
     /*!
      * \brief Draws circles around each node of the tree into the final support.
      *
@@ -305,9 +330,10 @@ private:
      *
      * \param storage[in, out] The settings storage to get settings from and to
      * save the resulting support polygons to.
-     * \param contact_nodes The nodes to draw as support.
+     * \param contact_nodes The nodes to draw as support. Pruned nodes are
+     * skipped.
      */
-    void drawCircles(SliceDataStorage& storage, const std::vector<std::unordered_set<Node*>>& contact_nodes);
+    void drawCircles(SliceDataStorage& storage, const std::vector<std::vector<Node>>& contact_nodes);
 
     /*!
      * \brief Drops down the nodes of the tree support towards the build plate.
@@ -319,9 +345,26 @@ private:
      *
      * \param contact_nodes[in, out] The nodes in the space that need to be
      * dropped down. The nodes are dropped to lower layers inside the same
-     * vector of layers.
+     * vector of layers. Nodes whose branch can't be supported are marked as
+     * pruned rather than removed, so that the indices of the nodes of each
+     * layer stay valid.
      */
-    void dropNodes(std::vector<std::unordered_set<Node*>>& contact_nodes);
+    void dropNodes(std::vector<std::vector<Node>>& contact_nodes);
+
+    /*!
+     * \brief Calculates the avoidance areas that dropping down the nodes will
+     * need, before the nodes are dropped.
+     *
+     * The avoidance of each layer is based on that of the layer below, so
+     * requesting it on demand from the top down recurses all the way down to
+     * the build plate on a single thread. Instead, the avoidance of each
+     * rounded radius is calculated from the bottom up, with the radii divided
+     * over the threads. Each radius is calculated only up to the highest layer
+     * where a node could have that radius.
+     *
+     * \param contact_nodes The nodes that are going to be dropped down.
+     */
+    void precalculateAvoidance(const std::vector<std::vector<Node>>& contact_nodes);
 
     /*!
      * \brief Creates points where support contacts the model.
@@ -336,14 +379,7 @@ private:
      * \return For each layer, a list of points where the tree should connect
      * with the model.
      */
-    void generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::unordered_set<Node*>>& contact_nodes);
-
-    /*!
-     * \brief Add a node to the next layer.
-     *
-     * If a node is already at that position in the layer, the nodes are merged.
-     */
-    void insertDroppedNode(std::unordered_set<Node*>& nodes_layer, Node* node);
+    void generateContactPoints(const SliceMeshStorage& mesh, std::vector<std::vector<Node>>& contact_nodes);
 };
 
 }
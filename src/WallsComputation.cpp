@@ -16,10 +16,10 @@ WallsComputation::WallsComputation(const Settings& settings, const LayerIndex la
 }
 
 /*
- * This function is executed in a parallel region based on layer_nr.
+ * This function is executed in a parallel region based on layer_nr and part.
  * When modifying make sure any changes does not introduce data races.
  *
- * generateInsets only reads and writes data for the current layer
+ * generateInsets only reads and writes data for the current part
  */
 void WallsComputation::generateInsets(SliceLayerPart* part)
 {
@@ -130,14 +130,20 @@ void WallsComputation::generateInsets(SliceLayer* layer)
     {
         generateInsets(&layer->parts[partNr]);
     }
+    removePartsWithoutInsets(layer);
+}
 
+void WallsComputation::removePartsWithoutInsets(SliceLayer* layer)
+{
     const bool remove_parts_with_no_insets = !settings.get<bool>("fill_outline_gaps");
     //Remove the parts which did not generate an inset. As these parts are too small to print,
     // and later code can now assume that there is always minimal 1 inset line.
+    bool removed_enclosing_part = false;
     for (unsigned int part_idx = 0; part_idx < layer->parts.size(); part_idx++)
     {
         if (layer->parts[part_idx].insets.size() == 0 && remove_parts_with_no_insets)
         {
+            removed_enclosing_part |= layer->parts[part_idx].outline.size() > 1; //Only parts with holes can enclose other parts.
             if (part_idx != layer->parts.size() - 1)
             { // move existing part into part to be deleted
                 layer->parts[part_idx] = std::move(layer->parts.back());
@@ -146,6 +152,13 @@ void WallsComputation::generateInsets(SliceLayer* layer)
             part_idx -= 1; // check the part we just moved here
         }
     }
+    if (removed_enclosing_part)
+    { // we don't know which parts were in its holes, and those are now on the outside
+        for (SliceLayerPart& part : layer->parts)
+        {
+            part.is_enclosed = false;
+        }
+    }
 }
 
 }//namespace cura
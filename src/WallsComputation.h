@@ -37,6 +37,25 @@ public:
      */ 
     void generateInsets(SliceLayer* layer);
 
+    /*!
+     * Generates the insets / perimeters for a single layer part.
+     *
+     * This only reads and writes the part itself, so the parts of a layer can
+     * be processed in parallel. Afterwards, the parts without insets should be
+     * removed with WallsComputation::removePartsWithoutInsets.
+     *
+     * \param part The part for which to generate the insets.
+     */
+    void generateInsets(SliceLayerPart* part);
+
+    /*!
+     * Removes the parts of a layer which did not get any insets, because they
+     * are too small to print, unless the outline gaps are filled.
+     *
+     * \param layer The layer of which the insets of all parts are generated.
+     */
+    void removePartsWithoutInsets(SliceLayer* layer);
+
 private:
     /*!
      * \brief Settings container to get my settings from.
@@ -50,13 +69,6 @@ private:
      */
     const LayerIndex layer_nr;
 
-    /*!
-     * Generates the insets / perimeters for a single layer part.
-     *
-     * \param part The part for which to generate the insets.
-     */
-    void generateInsets(SliceLayerPart* part);
-
 };
 }//namespace cura
 
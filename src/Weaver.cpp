@@ -120,16 +120,24 @@ void Weaver::weave(MeshGroup* meshgroup)
     log("Finding horizontal parts...\n");
     {
         Progress::messageProgressStage(Progress::Stage::SUPPORT, nullptr);
-        for (unsigned int layer_idx = 0; layer_idx < wireFrame.layers.size(); layer_idx++)
+        const int layer_count = wireFrame.layers.size();
+        int completed_layer_count = 0; //To track progress in a multi-threaded environment.
+        //Each layer only reads the supported polygons of the layer above, which aren't changed here, so the layers can be processed in parallel.
+#pragma omp parallel for shared(completed_layer_count) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < layer_count; layer_idx++)
         {
-            Progress::messageProgress(Progress::Stage::SUPPORT, layer_idx+1, wireFrame.layers.size()); // abuse the progress system of the normal mode of CuraEngine
-            
             WeaveLayer& layer = wireFrame.layers[layer_idx];
             
             Polygons empty;
-            Polygons& layer_above = (layer_idx+1 < wireFrame.layers.size())? wireFrame.layers[layer_idx+1].supported : empty;
+            Polygons& layer_above = (layer_idx + 1 < layer_count)? wireFrame.layers[layer_idx + 1].supported : empty;
             
             createHorizontalFill(layer, layer_above);
+#pragma omp critical (progress)
+            {
+                completed_layer_count++;
+                Progress::messageProgress(Progress::Stage::SUPPORT, completed_layer_count, layer_count); // abuse the progress system of the normal mode of CuraEngine
+            }
         }
     }
     // at this point layer.supported still only contains the polygons to be connected
@@ -137,17 +145,35 @@ void Weaver::weave(MeshGroup* meshgroup)
 
     log("Connecting layers...\n");
     {
-        Polygons* lower_top_parts = &wireFrame.bottom_outline;
-        int last_z = wireFrame.z_bottom;
-        for (unsigned int layer_idx = 0; layer_idx < wireFrame.layers.size(); layer_idx++) // use top of every layer but the last
+        //Every layer is connected to the top of the layer below, including its roofs, so compute those tops first.
+        //Then the connections of all layers are independent of each other.
+        const int layer_count = wireFrame.layers.size();
+        std::vector<Polygons> top_parts(layer_count);
+        std::vector<int> top_z(layer_count); //Copied, because connecting a layer writes its heights.
+#pragma omp parallel for shared(top_parts, top_z) schedule(static)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < layer_count; layer_idx++)
+        {
+            const WeaveLayer& layer = wireFrame.layers[layer_idx];
+            top_parts[layer_idx] = layer.supported;
+            top_parts[layer_idx].add(layer.roofs.roof_outlines);
+            top_z[layer_idx] = layer.z1;
+        }
+
+#pragma omp parallel for shared(top_parts, top_z) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < layer_count; layer_idx++)
         {
             WeaveLayer& layer = wireFrame.layers[layer_idx];
-            
-            connect_polygons(*lower_top_parts, last_z, layer.supported, layer.z1, layer);
-            layer.supported.add(layer.roofs.roof_outlines);
-            lower_top_parts = &layer.supported;
-            
-            last_z = layer.z1;
+            Polygons& lower_top_parts = (layer_idx == 0) ? wireFrame.bottom_outline : top_parts[layer_idx - 1];
+            const int last_z = (layer_idx == 0) ? wireFrame.z_bottom : top_z[layer_idx - 1];
+
+            connect_polygons(lower_top_parts, last_z, layer.supported, layer.z1, layer);
+        }
+
+        for (int layer_idx = 0; layer_idx < layer_count; layer_idx++)
+        {
+            wireFrame.layers[layer_idx].supported = std::move(top_parts[layer_idx]);
         }
     }
 
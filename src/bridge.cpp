@@ -1,6 +1,9 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <utility> //For pair.
+#include <vector>
+
 #include "bridge.h"
 #include "sliceDataStorage.h"
 #include "settings/types/Ratio.h"
@@ -18,7 +21,9 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
     // This gives us the islands that the layer rests on.
     Polygons islands;
 
-    Polygons prev_layer_outline; // we also want the complete outline of the previous layer
+    // we also want the complete outline of the previous layer, but only if the skin turns out to be a bridge, so only keep track
+    // of the polygons and their bounding boxes for now rather than copying the outlines of the whole layer for every skin part
+    std::vector<std::pair<const Polygons*, AABB>> prev_layer_outlines;
 
     // include parts from all meshes
     for (const SliceMeshStorage& mesh : storage.meshes)
@@ -27,7 +32,7 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
         {
             for (const SliceLayerPart& prev_layer_part : mesh.layers[layer_nr].parts)
             {
-                prev_layer_outline.add(prev_layer_part.outline); // not intersected with skin
+                prev_layer_outlines.emplace_back(&prev_layer_part.outline, prev_layer_part.boundaryBox); // not intersected with skin
 
                 if (!boundary_box.hit(prev_layer_part.boundaryBox))
                     continue;
@@ -51,7 +56,7 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
             AABB support_roof_bb(support_layer->support_roof);
             if (boundary_box.hit(support_roof_bb))
             {
-                prev_layer_outline.add(support_layer->support_roof); // not intersected with skin
+                prev_layer_outlines.emplace_back(&support_layer->support_roof, support_roof_bb); // not intersected with skin
 
                 Polygons supported_skin(skin_outline.intersection(support_layer->support_roof));
                 if (!supported_skin.empty())
@@ -67,7 +72,7 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
                 AABB support_part_bb(support_part.getInfillArea());
                 if (boundary_box.hit(support_part_bb))
                 {
-                    prev_layer_outline.add(support_part.getInfillArea()); // not intersected with skin
+                    prev_layer_outlines.emplace_back(&support_part.getInfillArea(), support_part_bb); // not intersected with skin
 
                     Polygons supported_skin(skin_outline.intersection(support_part.getInfillArea()));
                     if (!supported_skin.empty())
@@ -98,6 +103,18 @@ int bridgeAngle(const Settings& settings, const Polygons& skin_outline, const Sl
             // the air boundary do appear to be supported
 
             const int bb_max_dim = std::max(boundary_box.max.X - boundary_box.min.X, boundary_box.max.Y - boundary_box.min.Y);
+
+            // the outlines that don't touch the expanded bounding box can't make a difference to the air below
+            AABB air_boundary_box(boundary_box);
+            air_boundary_box.expand(bb_max_dim);
+            Polygons prev_layer_outline;
+            for (const std::pair<const Polygons*, AABB>& prev_layer_polygons : prev_layer_outlines)
+            {
+                if (air_boundary_box.hit(prev_layer_polygons.second))
+                {
+                    prev_layer_outline.add(*prev_layer_polygons.first);
+                }
+            }
             const Polygons air_below(bb_poly.offset(bb_max_dim).difference(prev_layer_outline).offset(-10));
 
             Polygons skin_perimeter_lines;
@@ -3,7 +3,10 @@
 
 #ifdef ARCUS
 
+#include <algorithm> //For std::max.
 #include <Arcus/Socket.h> //The socket to communicate to.
+#include <cmath> //For std::llround.
+#include <mutex> //To guard the layer view data, which is filled by several threads.
 #include <thread> //To sleep while waiting for the connection.
 #include <unordered_map> //To map settings to their extruder numbers for limit_to_extruder.
 
@@ -16,6 +19,7 @@
 #include "../FffProcessor.h" //To start a slice.
 #include "../PrintFeature.h"
 #include "../Slice.h" //To process slices.
+#include "../settings/SettingKey.h" //To register settings that are limited to an extruder.
 #include "../settings/types/LayerIndex.h" //To point to layers.
 #include "../settings/types/Velocity.h" //To send to layer view how fast stuff is printing.
 #include "../utils/logoutput.h"
@@ -49,6 +53,10 @@ class ArcusCommunication::PathCompiler
     std::vector<float> points; //!< The points used to define the line segments, the size of this vector is D*(N+1) as each line segment is defined from one point to the next. D is the dimensionality of the point.
 
     Point last_point;
+    Point second_last_point; //!< The start of the last line segment, if there is a line segment in the buffers.
+
+    coord_t simplify_tolerance; //!< How far the sent polygons may deviate from the printed ones, or 0 to send them exactly.
+    coord_t resolution; //!< Points, widths and thicknesses are rounded to multiples of this, or 0 to send them exactly.
 
     PathCompiler(const PathCompiler&) = delete;
     PathCompiler& operator=(const PathCompiler&) = delete;
@@ -66,7 +74,10 @@ public:
         line_thicknesses(),
         line_velocities(),
         points(),
-        last_point{0,0}
+        last_point{0,0},
+        second_last_point{0,0},
+        simplify_tolerance(0),
+        resolution(0)
     {}
 
     /*
@@ -115,6 +126,22 @@ public:
         }
     }
 
+    /*!
+     * \brief Set how much detail of the paths is sent to the front-end.
+     *
+     * Decimating the paths makes the layer view less accurate, but saves time
+     * and bandwidth on huge prints.
+     * \param new_simplify_tolerance How far polygons may deviate from the
+     * printed ones, or 0 to send them exactly.
+     * \param new_resolution To what multiple the coordinates, widths and
+     * thicknesses are rounded, or 0 to send them exactly.
+     */
+    void setDecimation(const coord_t new_simplify_tolerance, const coord_t new_resolution)
+    {
+        simplify_tolerance = std::max(coord_t(0), new_simplify_tolerance);
+        resolution = std::max(coord_t(0), new_resolution);
+    }
+
     /*!
      * \brief Special handling of the first point in an added line sequence.
      *
@@ -151,30 +178,17 @@ public:
         path_segment->set_extruder(extruder);
         path_segment->set_point_type(data_point_type);
 
-        std::string line_type_data;
-        line_type_data.append(reinterpret_cast<const char*>(line_types.data()), line_types.size() * sizeof(PrintFeatureType));
+        //Copy the buffers straight into the byte fields of the message. The buffers keep their capacity for the next path segment.
+        path_segment->mutable_line_type()->assign(reinterpret_cast<const char*>(line_types.data()), line_types.size() * sizeof(PrintFeatureType));
         line_types.clear();
-        path_segment->set_line_type(line_type_data);
-
-        std::string polygon_data;
-        polygon_data.append(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(float));
+        path_segment->mutable_points()->assign(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(float));
         points.clear();
-        path_segment->set_points(polygon_data);
-
-        std::string line_width_data;
-        line_width_data.append(reinterpret_cast<const char*>(line_widths.data()), line_widths.size() * sizeof(float));
+        path_segment->mutable_line_width()->assign(reinterpret_cast<const char*>(line_widths.data()), line_widths.size() * sizeof(float));
         line_widths.clear();
-        path_segment->set_line_width(line_width_data);
-
-        std::string line_thickness_data;
-        line_thickness_data.append(reinterpret_cast<const char*>(line_thicknesses.data()), line_thicknesses.size() * sizeof(float));
+        path_segment->mutable_line_thickness()->assign(reinterpret_cast<const char*>(line_thicknesses.data()), line_thicknesses.size() * sizeof(float));
         line_thicknesses.clear();
-        path_segment->set_line_thickness(line_thickness_data);
-
-        std::string line_velocity_data;
-        line_velocity_data.append(reinterpret_cast<const char*>(line_velocities.data()), line_velocities.size() * sizeof(float));
+        path_segment->mutable_line_feedrate()->assign(reinterpret_cast<const char*>(line_velocities.data()), line_velocities.size() * sizeof(float));
         line_velocities.clear();
-        path_segment->set_line_feedrate(line_velocity_data);
     }
 
     /*!
@@ -182,7 +196,7 @@ public:
      */
     void setCurrentPosition(const Point& position)
     {
-        handleInitialPoint(position);
+        handleInitialPoint(quantize(position));
     }
 
     /*!
@@ -200,9 +214,10 @@ public:
     {
         assert(!points.empty() && "A point must already be in the buffer for sendLineTo(.) to function properly.");
 
-        if (to != last_point)
+        const Point quantized_to = quantize(to);
+        if (quantized_to != last_point)
         {
-            addLineSegment(print_feature_type, to, width, thickness, feedrate);
+            addLineSegment(print_feature_type, quantized_to, quantize(width), quantize(thickness), feedrate);
         }
     }
 
@@ -222,23 +237,67 @@ public:
             return;
         }
 
+        if (simplify_tolerance > 0 && polygon.size() > 3)
+        {
+            Polygon simplified(polygon);
+            simplified.simplify(4 * simplify_tolerance * simplify_tolerance, simplify_tolerance * simplify_tolerance);
+            if (simplified.size() >= 3) //Simplifying may remove small polygons altogether, but they should still be visible.
+            {
+                addPolygon(print_feature_type, simplified, quantize(width), quantize(thickness), velocity);
+                return;
+            }
+        }
+        addPolygon(print_feature_type, polygon, quantize(width), quantize(thickness), velocity);
+    }
+
+private:
+    /*!
+     * \brief Round a coordinate or size to the resolution of the sent data.
+     */
+    coord_t quantize(const coord_t value) const
+    {
+        if (resolution <= 0)
+        {
+            return value;
+        }
+        return std::llround(static_cast<double>(value) / resolution) * resolution;
+    }
+
+    /*!
+     * \brief Round a point to the resolution of the sent data.
+     */
+    Point quantize(const Point& point) const
+    {
+        return Point(quantize(point.X), quantize(point.Y));
+    }
+
+    /*!
+     * \brief Adds the line segments of a closed polygon to the current path.
+     *
+     * The coordinates of the polygon are rounded to the resolution, but the
+     * width and thickness must already be rounded.
+     */
+    void addPolygon(const PrintFeatureType& print_feature_type, const ConstPolygonRef& polygon, const coord_t& width, const coord_t& thickness, const Velocity& velocity)
+    {
         ClipperLib::Path::const_iterator point = polygon.begin();
-        handleInitialPoint(*point);
+        const Point first_point = quantize(*point);
+        handleInitialPoint(first_point);
 
         //Send all coordinates one by one.
         while(++point != polygon.end())
         {
-            if (*point == last_point)
+            const Point quantized_point = quantize(*point);
+            if (quantized_point == last_point)
             {
                 continue; //Ignore zero-length segments.
             }
-            addLineSegment(print_feature_type, *point, width, thickness, velocity);
+            addLineSegment(print_feature_type, quantized_point, width, thickness, velocity);
         }
 
         //Make sure the polygon is closed.
-        if (*polygon.begin() != polygon.back())
+        if (first_point != last_point)
         {
-            addLineSegment(print_feature_type, *polygon.begin(), width, thickness, velocity);
+            addLineSegment(print_feature_type, first_point, width, thickness, velocity);
         }
     }
 
@@ -270,11 +329,51 @@ private:
      */
     void addLineSegment(const PrintFeatureType& print_feature_type, const Point& point, const coord_t& width, const coord_t& thickness, const Velocity& velocity)
     {
+        const float width_mm = INT2MM(width);
+        const float thickness_mm = INT2MM(thickness);
+        const float feedrate = velocity;
+        if (continuesLastLineSegment(print_feature_type, point, width_mm, thickness_mm, feedrate))
+        {
+            //Extend the last line segment instead of adding one that looks the same in the layer view.
+            points[points.size() - 2] = INT2MM(point.X);
+            points[points.size() - 1] = INT2MM(point.Y);
+            last_point = point;
+            return;
+        }
+        second_last_point = last_point;
         addPoint2D(point);
         line_types.push_back(print_feature_type);
-        line_widths.push_back(INT2MM(width));
-        line_thicknesses.push_back(INT2MM(thickness));
-        line_velocities.push_back(velocity);
+        line_widths.push_back(width_mm);
+        line_thicknesses.push_back(thickness_mm);
+        line_velocities.push_back(feedrate);
+    }
+
+    /*!
+     * \brief Whether a new line segment to \p point would continue the last
+     * line segment in a straight line with exactly the same properties.
+     *
+     * Such a line segment can be merged into the last one, which saves sending
+     * it to the front-end.
+     * \param print_feature_type The type of feature of the new line segment.
+     * \param point The destination point of the new line segment.
+     * \param width The width of the new line segment, in mm.
+     * \param thickness The thickness of the new line segment, in mm.
+     * \param feedrate The feedrate of the new line segment.
+     */
+    bool continuesLastLineSegment(const PrintFeatureType& print_feature_type, const Point& point, const float width, const float thickness, const float feedrate) const
+    {
+        if (line_types.empty()
+            || line_types.back() != print_feature_type
+            || line_widths.back() != width
+            || line_thicknesses.back() != thickness
+            || line_velocities.back() != feedrate)
+        {
+            return false;
+        }
+        const Point last_direction = last_point - second_last_point;
+        const Point new_direction = point - last_point;
+        return last_direction.X * new_direction.Y == last_direction.Y * new_direction.X //Parallel.
+            && last_direction.X * new_direction.X + last_direction.Y * new_direction.Y > 0; //Not reversing.
     }
 };
 
@@ -293,7 +392,7 @@ ArcusCommunication::~ArcusCommunication()
 void ArcusCommunication::connect(const std::string& ip, const uint16_t port)
 {
     private_data->socket = new Arcus::Socket;
-    private_data->socket->addListener(new Listener);
+    private_data->socket->addListener(new Listener(private_data->received_message_count));
 
     private_data->socket->registerMessageType(&cura::proto::Slice::default_instance());
     private_data->socket->registerMessageType(&cura::proto::Layer::default_instance());
@@ -347,11 +446,16 @@ bool ArcusCommunication::isSequential() const
     return false; //We don't necessarily need to send the start g-code before the rest. We can send it afterwards when we have more accurate print statistics.
 }
 
+bool ArcusCommunication::isSliceCancelled() const
+{
+    return private_data->received_message_count.load(std::memory_order_relaxed) > private_data->taken_message_count.load(std::memory_order_relaxed);
+}
+
 bool ArcusCommunication::hasSlice() const
 {
     return private_data->socket->getState() != Arcus::SocketState::Closed
         && private_data->socket->getState() != Arcus::SocketState::Error
-        && private_data->slice_count < 1; //Only slice once per run of CuraEngine. See documentation of slice_count.
+        && (private_data->slice_count < 1 || Application::getInstance().keep_warm_state); //Only slice once per run of CuraEngine, unless asked to keep running. See documentation of slice_count.
 }
 
 void ArcusCommunication::sendCurrentPosition(const Point& position)
@@ -389,6 +493,7 @@ void ArcusCommunication::sendOptimizedLayerData()
 {
     path_compiler->flushPathSegments(); //Make sure the last path segment has been flushed from the compiler.
 
+    std::lock_guard<std::mutex> lock(private_data->optimized_layers_mutex);
     SliceDataStruct<proto::LayerOptimized>& data = private_data->optimized_layers;
     data.sliced_objects++;
     data.current_layer_offset = data.current_layer_count;
@@ -396,9 +501,9 @@ void ArcusCommunication::sendOptimizedLayerData()
     {
         return;
     }
-    log("Sending %d layers.", data.current_layer_count);
+    log("Sending the last %d of %d layers.", data.slice_data.size(), data.current_layer_count); //The other layers were sent as soon as they were written.
 
-    for (std::pair<const int, std::shared_ptr<proto::LayerOptimized>> entry : data.slice_data) //Note: This is in no particular order!
+    for (const std::pair<const int, std::shared_ptr<proto::LayerOptimized>>& entry : data.slice_data) //Note: This is in no particular order!
     {
         logDebug("Sending layer data for layer %i of %i.\n", entry.first, data.slice_data.size());
         private_data->socket->sendMessage(entry.second); //Send the actual layers.
@@ -471,7 +576,13 @@ void ArcusCommunication::sendProgress(const float& progress) const
 
 void ArcusCommunication::setLayerForSend(const LayerIndex& layer_nr)
 {
+    const LayerIndex previous_layer_nr = path_compiler->getLayer();
     path_compiler->setLayer(layer_nr);
+    //Layers are written bottom to top, so once we go up the previous layer is complete. Send it right away so the layer view can fill up while the rest is being written.
+    if (layer_nr > previous_layer_nr && !isSliceCancelled())
+    {
+        private_data->sendOptimizedLayer(previous_layer_nr);
+    }
 }
 
 void ArcusCommunication::setExtruderForSend(const ExtruderTrain& extruder)
@@ -482,6 +593,10 @@ void ArcusCommunication::setExtruderForSend(const ExtruderTrain& extruder)
 void ArcusCommunication::sliceNext()
 {
     const Arcus::MessagePtr message = private_data->socket->takeNextMessage();
+    if (message)
+    {
+        private_data->taken_message_count++; //Messages that arrive after this one cancel the slice that it starts.
+    }
 
     //Handle the main Slice message.
     const cura::proto::Slice* slice_message = dynamic_cast<cura::proto::Slice*>(message.get()); //See if the message is of the message type Slice. Returns nullptr otherwise.
@@ -496,6 +611,10 @@ void ArcusCommunication::sliceNext()
 
     private_data->readGlobalSettingsMessage(slice_message->global_settings());
     private_data->readExtruderSettingsMessage(slice_message->extruders());
+    const Settings& global_settings = slice.scene.settings;
+    path_compiler->setDecimation(
+        global_settings.has("layer_view_simplify_tolerance") ? global_settings.get<coord_t>("layer_view_simplify_tolerance") : 0, //0 sends the paths exactly.
+        global_settings.has("layer_view_resolution") ? global_settings.get<coord_t>("layer_view_resolution") : 0);
     const size_t extruder_count = slice.scene.extruders.size();
 
     //For each setting, register what extruder it should be obtained from (if this is limited to an extruder).
@@ -508,7 +627,7 @@ void ArcusCommunication::sliceNext()
             continue;
         }
         ExtruderTrain& extruder = slice.scene.extruders[setting_extruder.extruder()];
-        slice.scene.limit_to_extruder.emplace(setting_extruder.name(), &extruder);
+        slice.scene.limit_to_extruder.emplace(SettingKey(setting_extruder.name()).getId(), &extruder);
     }
 
     //Load all mesh groups, meshes and their settings.
@@ -521,7 +640,22 @@ void ArcusCommunication::sliceNext()
 
     if (!slice.scene.mesh_groups.empty())
     {
+        if (private_data->slice_count > 0)
+        {
+            FffProcessor::getInstance()->reset(); //Don't continue from the g-code state of the previous slice.
+        }
         slice.compute();
+        if (isSliceCancelled())
+        {
+            //The front-end doesn't want the results anymore. Start the next slice with a new g-code writer, even if this was the first slice.
+            log("Slice was cancelled by a newer slice.\n");
+            private_data->gcode_output_stream.str("");
+            path_compiler->flushPathSegments();
+            private_data->clearOptimizedLayers(); //Don't send the remaining layers of this slice along with the next.
+            FffProcessor::getInstance()->reset();
+            slice.reset();
+            return; //Take the next message right away.
+        }
         FffProcessor::getInstance()->finalize();
         flushGCode();
         sendPrintTimeMaterialEstimates();
@@ -35,6 +35,9 @@ class ArcusCommunication : public Communication
     FRIEND_TEST(ArcusCommunicationTest, SendProgress);
     friend class ArcusCommunicationPrivateTest;
 #endif
+#ifdef BUILD_BENCHMARKS
+    friend class ArcusCommunicationBenchmark;
+#endif
 public:
     /*
      * \brief Construct a new communicator that listens to libArcus messages via
@@ -130,7 +133,9 @@ public:
      * \brief Send the sliced layer data to the front-end after the optimisation
      * is done and the actual order in which to print has been set.
      *
-     * This layer data will be shown in the layer view of the front end.
+     * This layer data will be shown in the layer view of the front end. Most
+     * layers have been sent already by \ref setLayerForSend as soon as they
+     * were written. This sends the rest.
      */
     void sendOptimizedLayerData() override;
 
@@ -185,6 +190,10 @@ public:
      * ``sendPolygon``, ``sendPolygons`` and ``sendLineTo``.
      * \param layer_nr The index of the layer to send data for. This is zero-
      * indexed but may be negative for raft layers.
+     *
+     * When going up to a next layer, the layer that was finished is sent to
+     * the front-end right away, so that the bottom layers can be shown while
+     * the rest is still being written.
      */
     void setLayerForSend(const LayerIndex& layer_nr) override;
 
@@ -193,6 +202,15 @@ public:
      */
     void sliceNext() override;
 
+    /*
+     * \brief Whether the front-end has sent another message since the slice
+     * that is being computed was taken.
+     *
+     * The front-end only sends slice messages, so any newer message replaces
+     * the current slice.
+     */
+    bool isSliceCancelled() const override;
+
 private:
     /*
      * \brief Put any mock-socket there to assist with Unit-Testing.
@@ -3,6 +3,11 @@
 
 #ifdef ARCUS
 
+#include <algorithm> //For min.
+#include <Arcus/Socket.h> //To send the layers.
+#include <cstring> //memcpy
+#include <memory> //For unique_ptr.
+
 #include "ArcusCommunicationPrivate.h"
 #include "../Application.h"
 #include "../ExtruderTrain.h"
@@ -10,6 +15,7 @@
 #include "../settings/types/LayerIndex.h"
 #include "../utils/floatpoint.h"
 #include "../utils/logoutput.h"
+#include "../utils/SharedMemoryView.h"
 
 namespace cura
 {
@@ -20,10 +26,13 @@ ArcusCommunication::Private::Private()
     , last_sent_progress(-1)
     , slice_count(0)
     , millisecUntilNextTry(100)
+    , received_message_count(0)
+    , taken_message_count(0)
 {}
 
 std::shared_ptr<proto::LayerOptimized> ArcusCommunication::Private::getOptimizedLayerById(LayerIndex layer_nr)
 {
+    std::lock_guard<std::mutex> lock(optimized_layers_mutex);
     layer_nr += optimized_layers.current_layer_offset;
     std::unordered_map<int, std::shared_ptr<proto::LayerOptimized>>::iterator find_result = optimized_layers.slice_data.find(layer_nr);
 
@@ -41,6 +50,33 @@ std::shared_ptr<proto::LayerOptimized> ArcusCommunication::Private::getOptimized
     }
 }
 
+void ArcusCommunication::Private::sendOptimizedLayer(LayerIndex layer_nr)
+{
+    std::shared_ptr<proto::LayerOptimized> layer;
+    {
+        std::lock_guard<std::mutex> lock(optimized_layers_mutex);
+        layer_nr += optimized_layers.current_layer_offset;
+        std::unordered_map<int, std::shared_ptr<proto::LayerOptimized>>::iterator find_result = optimized_layers.slice_data.find(layer_nr);
+        if (find_result == optimized_layers.slice_data.end())
+        {
+            return; //Nothing was drawn in this layer, or it was sent already.
+        }
+        layer = find_result->second;
+        optimized_layers.slice_data.erase(find_result);
+    }
+    logDebug("Sending layer data for layer %i.\n", static_cast<int>(layer_nr));
+    socket->sendMessage(layer);
+}
+
+void ArcusCommunication::Private::clearOptimizedLayers()
+{
+    std::lock_guard<std::mutex> lock(optimized_layers_mutex);
+    optimized_layers.sliced_objects = 0;
+    optimized_layers.current_layer_count = 0;
+    optimized_layers.current_layer_offset = 0;
+    optimized_layers.slice_data.clear();
+}
+
 void ArcusCommunication::Private::readGlobalSettingsMessage(const proto::SettingList& global_settings_message)
 {
     Slice* slice = Application::getInstance().current_slice;
@@ -96,8 +132,19 @@ void ArcusCommunication::Private::readMeshGroupMessage(const proto::ObjectList&
     FMatrix3x3 matrix;
     for (const cura::proto::Object& object : mesh_group_message.objects())
     {
+        //Local front-ends may put the vertices in shared memory, so that they don't need to be copied through the socket.
+        std::unique_ptr<SharedMemoryView> shared_vertices;
+        const char* vertex_data = object.vertices().data();
+        size_t vertex_data_size = object.vertices().size();
+        if (!object.vertices_shared_memory().empty())
+        {
+            shared_vertices.reset(new SharedMemoryView(object.vertices_shared_memory()));
+            vertex_data = shared_vertices->data();
+            vertex_data_size = std::min(static_cast<size_t>(object.vertices_shared_memory_size()), shared_vertices->size()); //An empty view has size 0.
+        }
+
         const size_t bytes_per_face = sizeof(FPoint3) * 3; //3 vectors per face.
-        const size_t face_count = object.vertices().size() / bytes_per_face;
+        const size_t face_count = vertex_data_size / bytes_per_face;
 
         if (face_count <= 0)
         {
@@ -116,17 +163,17 @@ void ArcusCommunication::Private::readMeshGroupMessage(const proto::ObjectList&
         ExtruderTrain& extruder = mesh.settings.get<ExtruderTrain&>("extruder_nr"); //Set the parent setting to the correct extruder.
         mesh.settings.setParent(&extruder.settings);
 
-        for (size_t face = 0; face < face_count; face++)
+        //Read the vertices straight from the message or the shared memory. Every corner is independent, so they can be transformed in parallel.
+        std::vector<Point3> corners(face_count * 3);
+        #pragma omp parallel for schedule(static)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (long long corner_idx = 0; corner_idx < static_cast<long long>(corners.size()); corner_idx++)
         {
-            const std::string data = object.vertices().substr(face * bytes_per_face, bytes_per_face);
-            const FPoint3* float_vertices = reinterpret_cast<const FPoint3*>(data.data());
-
-            Point3 verts[3];
-            verts[0] = matrix.apply(float_vertices[0]);
-            verts[1] = matrix.apply(float_vertices[1]);
-            verts[2] = matrix.apply(float_vertices[2]);
-            mesh.addFace(verts[0], verts[1], verts[2]);
+            FPoint3 float_vertex;
+            memcpy(&float_vertex, vertex_data + corner_idx * sizeof(FPoint3), sizeof(FPoint3)); //The message doesn't guarantee any alignment.
+            corners[corner_idx] = matrix.apply(float_vertex);
         }
+        mesh.addFaces(corners);
 
         mesh.mesh_name = object.name();
         mesh.finish();
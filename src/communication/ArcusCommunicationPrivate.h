@@ -5,6 +5,8 @@
 #define ARCUSCOMMUNICATIONPRIVATE_H
 #ifdef ARCUS
 
+#include <atomic> //For the message counts, which the listener updates from the thread of the socket.
+#include <mutex> //To guard the optimised layers.
 #include <sstream> //For ostringstream.
 
 #include "ArcusCommunication.h" //We're adding a subclass to this.
@@ -28,6 +30,21 @@ public:
      */
     std::shared_ptr<proto::LayerOptimized> getOptimizedLayerById(LayerIndex layer_nr);
 
+    /*
+     * \brief Send the optimised layer data of a layer that is complete, and
+     * forget it.
+     *
+     * If there is no data for the layer, nothing is sent.
+     * \param layer_nr The layer number to send, not counting the offset of
+     * earlier mesh groups.
+     */
+    void sendOptimizedLayer(LayerIndex layer_nr);
+
+    /*
+     * \brief Forget all optimised layer data that wasn't sent yet.
+     */
+    void clearOptimizedLayers();
+
     /*
      * Reads the global settings from a Protobuf message.
      *
@@ -52,6 +69,7 @@ public:
 
     SliceDataStruct<cura::proto::Layer> sliced_layers;
     SliceDataStruct<cura::proto::LayerOptimized> optimized_layers;
+    std::mutex optimized_layers_mutex; //!< Guards optimized_layers. Layers are created while planning them on several threads, and filled and sent while writing them.
 
     int last_sent_progress; //!< Last sent progress promille (1/1000th). Used to not send duplicate messages with the same promille.
 
@@ -67,10 +85,16 @@ public:
      * depend on the order of iteration in unordered_map or unordered_set,
      * because those data structures will give a different order if more memory
      * has already been reserved for them.
+     *
+     * With Application::keep_warm_state the engine keeps slicing anyway. It
+     * then starts each slice with a new g-code writer.
      */
     size_t slice_count; //!< How often we've sliced so far during this run of CuraEngine.
 
     const size_t millisecUntilNextTry; // How long we wait until we try to connect again.
+
+    std::atomic<size_t> received_message_count; //!< How many messages the socket has received so far, counted by the Listener.
+    std::atomic<size_t> taken_message_count; //!< How many messages were taken from the socket to be handled so far.
 };
 
 } //namespace cura
@@ -1,9 +1,11 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cctype> //For isspace.
 #include <cstring> //For strtok and strcopy.
 #include <fstream> //To check if files exist.
 #include <errno.h> // error number when trying to read file
+#include <iterator> //For istreambuf_iterator.
 #include <numeric> //For std::accumulate.
 #ifdef _OPENMP
     #include <omp.h> //To change the number of threads to slice with.
@@ -18,19 +20,81 @@
 #include "../ExtruderTrain.h"
 #include "../FffProcessor.h" //To start a slice and get time estimates.
 #include "../Slice.h"
+#include "../utils/BinaryBuffer.h" //To read and write snapshots of definitions.
 #include "../utils/getpath.h"
 #include "../utils/floatpoint.h"
 #include "../utils/logoutput.h"
+#include "../utils/ThreadAffinity.h" //To pin threads to processors.
 
 namespace cura
 {
 
+//Starts every snapshot of a definition, to recognise snapshots among JSON files and to reject snapshots of another format.
+static const std::string snapshot_magic("CuraEngine definition snapshot 1");
+
 CommandLine::CommandLine(const std::vector<std::string>& arguments)
-: arguments(arguments)
+: jobs(1, arguments)
+, sliced_job_count(0)
+, last_shown_progress(0)
+{
+}
+
+CommandLine::CommandLine(const std::vector<std::vector<std::string>>& jobs)
+: jobs(jobs.begin(), jobs.end())
+, sliced_job_count(0)
 , last_shown_progress(0)
 {
 }
 
+bool CommandLine::readManifest(const std::string& manifest_filename, const std::string& executable, std::vector<std::vector<std::string>>& jobs)
+{
+    std::ifstream manifest(manifest_filename);
+    if (!manifest)
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(manifest, line))
+    {
+        std::vector<std::string> job{executable, "slice"};
+        std::string argument;
+        bool in_argument = false;
+        bool in_quotes = false;
+        for (const char character : line)
+        {
+            if (character == '"')
+            {
+                in_quotes = !in_quotes;
+                in_argument = true;
+            }
+            else if (!in_quotes && std::isspace(static_cast<unsigned char>(character)))
+            {
+                if (in_argument)
+                {
+                    job.push_back(argument);
+                    argument.clear();
+                    in_argument = false;
+                }
+            }
+            else
+            {
+                argument.push_back(character);
+                in_argument = true;
+            }
+        }
+        if (in_argument)
+        {
+            job.push_back(argument);
+        }
+        if (job.size() == 2 || job[2][0] == '#') //Empty line or comment.
+        {
+            continue;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
 //These are not applicable to command line slicing.
 void CommandLine::beginGCode() { }
 void CommandLine::flushGCode() { }
@@ -46,7 +110,7 @@ void CommandLine::setLayerForSend(const LayerIndex&) { }
 
 bool CommandLine::hasSlice() const
 {
-    return !arguments.empty();
+    return !jobs.empty();
 }
 
 bool CommandLine::isSequential() const
@@ -84,6 +148,15 @@ void CommandLine::sendProgress(const float& progress) const
 
 void CommandLine::sliceNext()
 {
+    const std::vector<std::string> arguments = std::move(jobs.front());
+    jobs.pop_front();
+    if (sliced_job_count > 0)
+    {
+        log("Slicing the next job of the batch, %zu more to go.\n", jobs.size());
+        FffProcessor::getInstance()->reset(); //Don't continue from the g-code state of the previous job.
+    }
+    sliced_job_count++;
+
     FffProcessor::getInstance()->time_keeper.restart();
 
     //Count the number of mesh groups to slice for.
@@ -155,6 +228,14 @@ void CommandLine::sliceNext()
                         omp_set_num_threads(threads);
                         break;
                     }
+                    case 'a':
+                    {
+                        if (!ThreadAffinity::setPlacement(argument.substr(2)))
+                        {
+                            logError("Unknown thread placement: %s\n", argument.substr(2).c_str());
+                        }
+                        break;
+                    }
 #endif //_OPENMP
                     case 'p':
                     {
@@ -170,7 +251,8 @@ void CommandLine::sliceNext()
                             exit(1);
                         }
                         argument = arguments[argument_index];
-                        if (loadJSON(argument, *last_settings))
+                        const int snapshot_error = loadSnapshot(argument, *last_settings);
+                        if (snapshot_error == 2 || (snapshot_error == 1 && loadJSON(argument, *last_settings)))
                         {
                             logError("Failed to load JSON file: %s\n", argument.c_str());
                             exit(1);
@@ -283,8 +365,6 @@ void CommandLine::sliceNext()
         }
     }
 
-    arguments.clear(); //We've processed all arguments now.
-
 #ifndef DEBUG
     try
     {
@@ -312,29 +392,117 @@ void CommandLine::sliceNext()
 
 int CommandLine::loadJSON(const std::string& json_filename, Settings& settings)
 {
-    FILE* file = fopen(json_filename.c_str(), "rb");
-    if (!file)
+    std::unique_ptr<rapidjson::Document>& json_document = parsed_json_files[json_filename];
+    if (!json_document)
     {
-        logError("Couldn't open JSON file: %s\n", json_filename.c_str());
-        return 1;
-    }
+        FILE* file = fopen(json_filename.c_str(), "rb");
+        if (!file)
+        {
+            logError("Couldn't open JSON file: %s\n", json_filename.c_str());
+            parsed_json_files.erase(json_filename);
+            return 1;
+        }
 
-    rapidjson::Document json_document;
-    char read_buffer[4096];
-    rapidjson::FileReadStream reader_stream(file, read_buffer, sizeof(read_buffer));
-    json_document.ParseStream(reader_stream);
-    fclose(file);
-    if (json_document.HasParseError())
-    {
-        logError("Error parsing JSON (offset %u): %s\n", static_cast<unsigned int>(json_document.GetErrorOffset()), GetParseError_En(json_document.GetParseError()));
-        return 2;
+        std::unique_ptr<rapidjson::Document> parsed_document(new rapidjson::Document());
+        char read_buffer[4096];
+        rapidjson::FileReadStream reader_stream(file, read_buffer, sizeof(read_buffer));
+        parsed_document->ParseStream(reader_stream);
+        fclose(file);
+        if (parsed_document->HasParseError())
+        {
+            logError("Error parsing JSON (offset %u): %s\n", static_cast<unsigned int>(parsed_document->GetErrorOffset()), GetParseError_En(parsed_document->GetParseError()));
+            parsed_json_files.erase(json_filename);
+            return 2;
+        }
+        json_document = std::move(parsed_document);
     }
 
     std::unordered_set<std::string> search_directories = defaultSearchDirectories(); //For finding the inheriting JSON files.
     std::string directory = getPathName(json_filename);
     search_directories.emplace(directory);
 
-    return loadJSON(json_document, search_directories, settings);
+    return loadJSON(*json_document, search_directories, settings);
+}
+
+bool CommandLine::writeSnapshot(const std::string& definition_filename, const std::string& snapshot_filename)
+{
+    Scene& scene = Application::getInstance().current_slice->scene;
+    scene.extruders.reserve(MAX_EXTRUDERS); //Allocate enough memory to prevent moves.
+    if (loadJSON(definition_filename, scene.settings))
+    {
+        logError("Failed to load JSON file: %s\n", definition_filename.c_str());
+        return false;
+    }
+
+    BinaryWriter writer;
+    writer.writeString(snapshot_magic);
+    scene.settings.serialise(writer);
+    writer.writeUnsigned(scene.extruders.size());
+    for (const ExtruderTrain& extruder : scene.extruders)
+    {
+        extruder.settings.serialise(writer);
+    }
+
+    std::ofstream file(snapshot_filename, std::ios_base::binary);
+    file.write(writer.getData().data(), writer.getData().size());
+    file.close();
+    if (!file)
+    {
+        logError("Couldn't write snapshot file: %s\n", snapshot_filename.c_str());
+        return false;
+    }
+    log("Wrote a snapshot of %s with %zu extruder trains to %s.\n", definition_filename.c_str(), scene.extruders.size(), snapshot_filename.c_str());
+    return true;
+}
+
+int CommandLine::loadSnapshot(const std::string& filename, Settings& settings)
+{
+    std::ifstream file(filename, std::ios_base::binary);
+    if (!file)
+    {
+        return 1; //Let the JSON loader report that the file doesn't exist.
+    }
+    //Snapshots start with their magic, so that JSON files can be told apart by their first bytes without reading them entirely.
+    std::string data(snapshot_magic.size() + 1, '\0');
+    file.read(&data[0], data.size());
+    data.resize(file.gcount());
+    std::string magic;
+    {
+        BinaryReader header_reader(data);
+        if (!header_reader.readString(magic) || magic != snapshot_magic)
+        {
+            return 1;
+        }
+    }
+    data.append(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    BinaryReader reader(data);
+    reader.readString(magic);
+    Scene& scene = Application::getInstance().current_slice->scene;
+    uint64_t extruder_count;
+    if (!settings.deserialise(reader) || !reader.readUnsigned(extruder_count) || extruder_count > MAX_EXTRUDERS)
+    {
+        logError("Snapshot file is damaged: %s\n", filename.c_str());
+        return 2;
+    }
+    for (size_t extruder_nr = 0; extruder_nr < extruder_count; extruder_nr++)
+    {
+        while (scene.extruders.size() <= extruder_nr)
+        {
+            scene.extruders.emplace_back(scene.extruders.size(), &scene.settings);
+        }
+        if (!scene.extruders[extruder_nr].settings.deserialise(reader))
+        {
+            logError("Snapshot file is damaged: %s\n", filename.c_str());
+            return 2;
+        }
+    }
+    if (!reader.atEnd())
+    {
+        logError("Snapshot file is damaged: %s\n", filename.c_str());
+        return 2;
+    }
+    return 0;
 }
 
 std::unordered_set<std::string> CommandLine::defaultSearchDirectories()
@@ -4,8 +4,11 @@
 #ifndef COMMANDLINE_H
 #define COMMANDLINE_H
 
+#include <deque> //To queue the jobs of a batch.
+#include <memory> //For unique_ptr.
 #include <rapidjson/document.h> //Loading JSON documents to get settings from them.
 #include <string> //To store the command line arguments.
+#include <unordered_map> //To keep the parsed JSON files.
 #include <unordered_set>
 #include <vector> //To store the command line arguments.
 
@@ -29,6 +32,46 @@ public:
      */
     CommandLine(const std::vector<std::string>& arguments);
 
+    /*
+     * \brief Construct a new communicator that slices a batch of jobs one
+     * after the other, in the same process.
+     *
+     * The JSON files are only parsed once for all jobs.
+     * \param jobs The command line arguments of each job, as they would be
+     * passed to the application to slice the job on its own.
+     */
+    CommandLine(const std::vector<std::vector<std::string>>& jobs);
+
+    /*
+     * \brief Read the jobs of a batch from a manifest file.
+     *
+     * Each line of the manifest holds the arguments of one job, as they would
+     * follow ``CuraEngine slice`` on the command line. Arguments are separated
+     * by whitespace, and may be quoted with double quotes to contain
+     * whitespace. Empty lines and lines starting with ``#`` are skipped.
+     * \param manifest_filename The manifest file to read.
+     * \param executable The name of the executable, which comes before the
+     * arguments of each job.
+     * \param[out] jobs The command line arguments of each job.
+     * \return Whether the manifest could be read.
+     */
+    static bool readManifest(const std::string& manifest_filename, const std::string& executable, std::vector<std::vector<std::string>>& jobs);
+
+    /*
+     * \brief Resolve a definition file with everything it inherits from and
+     * write the resulting settings to a snapshot file.
+     *
+     * The snapshot holds the global settings and the settings of each extruder
+     * train that the definition lists, flattened so that the inheritance chain
+     * doesn't need to be parsed again. It can be passed to ``-j`` instead of
+     * the definition file. This needs a current slice to resolve the extruder
+     * trains in.
+     * \param definition_filename The definition file to resolve.
+     * \param snapshot_filename The file to write the snapshot to.
+     * \return Whether the snapshot could be written.
+     */
+    bool writeSnapshot(const std::string& definition_filename, const std::string& snapshot_filename);
+
     /*
      * \brief Indicate that we're beginning to send g-code.
      * This does nothing to the command line.
@@ -146,15 +189,31 @@ public:
 
 private:
     /*
-     * \brief The command line arguments that the application was called with.
+     * \brief The command line arguments of the jobs that remain to be sliced.
+     *
+     * When slicing a single job, these are the arguments that the application
+     * was called with.
+     */
+    std::deque<std::vector<std::string>> jobs;
+
+    /*
+     * \brief The number of jobs that were sliced so far.
      */
-    std::vector<std::string> arguments;
+    size_t sliced_job_count;
 
     /*
      * The last progress update that we output to stdcerr.
      */
     unsigned int last_shown_progress;
 
+    /*
+     * \brief The JSON files that were parsed so far, by their file name.
+     *
+     * The definition files that extruders inherit from are loaded once for
+     * every extruder, so they are only parsed the first time.
+     */
+    std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> parsed_json_files;
+
     /*
      * \brief Get the default search directories to search for definition files.
      * \return The default search directories to search for definition files.
@@ -171,6 +230,20 @@ private:
      */
     int loadJSON(const std::string& json_filename, Settings& settings);
 
+    /*
+     * \brief Load the settings from a snapshot file that was written by
+     * \ref writeSnapshot, if the file is a snapshot.
+     *
+     * The global settings of the snapshot are stored in the given settings,
+     * and the settings of the extruder trains in the extruders of the current
+     * scene, like they would be when loading the definition file itself.
+     * \param filename The file to load settings from.
+     * \param settings The settings storage to store the global settings in.
+     * \return Error code. If it's 0, the snapshot was successfully loaded. If
+     * it's 1, the file is not a snapshot. If it's 2, the snapshot is damaged.
+     */
+    int loadSnapshot(const std::string& filename, Settings& settings);
+
     /*
      * \brief Load a JSON document and store the settings inside it.
      * \param document The JSON document to load the settings from.
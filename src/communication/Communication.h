@@ -172,6 +172,19 @@ public:
      * slice.
      */
     virtual void sliceNext() = 0;
+
+    /*
+     * \brief Whether the slice that is being computed has been superseded by
+     * a newer slice command, so that it may stop early.
+     *
+     * This is checked between layers by several threads at once, so it must be
+     * cheap and thread-safe. Once it returns true, it keeps doing so until the
+     * next slice starts.
+     */
+    virtual bool isSliceCancelled() const
+    {
+        return false;
+    }
 };
 
 } //namespace cura
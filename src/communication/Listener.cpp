@@ -11,6 +11,11 @@
 namespace cura
 {
 
+Listener::Listener(std::atomic<size_t>& received_message_count)
+: received_message_count(received_message_count)
+{
+}
+
 void Listener::stateChanged(Arcus::SocketState::SocketState)
 {
     //Do nothing.
@@ -18,7 +23,7 @@ void Listener::stateChanged(Arcus::SocketState::SocketState)
 
 void Listener::messageReceived()
 {
-    //Do nothing.
+    received_message_count++;
 }
 
 void Listener::error(const Arcus::Error& error)
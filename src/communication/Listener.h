@@ -6,6 +6,7 @@
 #ifdef ARCUS //Extends from Arcus::SocketListener, so only compile if we're using libArcus.
 
 #include <Arcus/SocketListener.h> //The class we're extending from.
+#include <atomic>
 
 namespace cura
 {
@@ -17,13 +18,23 @@ namespace cura
 class Listener : public Arcus::SocketListener
 {
 public:
+    /*
+     * \param received_message_count Where to count the received messages, so
+     * that a slice can find out that it has been superseded.
+     */
+    Listener(std::atomic<size_t>& received_message_count);
+
     /*
      * Changes the ``stateChanged`` signal to do nothing.
      */
     void stateChanged(Arcus::SocketState::SocketState) override;
 
     /*
-     * Changes the ``messageReceived`` signal to do nothing.
+     * Counts the received message. It stays in the queue of the socket until
+     * it's taken by ``ArcusCommunication::sliceNext``.
+     *
+     * This is called from the thread of the socket, while a slice may be
+     * computed.
      */
     void messageReceived() override;
 
@@ -31,6 +42,9 @@ public:
      * Log an error when we get one from libArcus.
      */
     void error(const Arcus::Error& error) override;
+
+private:
+    std::atomic<size_t>& received_message_count; //!< How many messages were received so far.
 };
 
 } //namespace cura
@@ -1,8 +1,10 @@
 //Copyright (c) 2019 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For count and min.
 #include <assert.h>
 #include <cmath>
+#include <cstring> //For memcpy.
 #include <iomanip>
 #include <stdarg.h>
 
@@ -16,7 +18,8 @@
 #include "settings/types/LayerIndex.h"
 #include "utils/Date.h"
 #include "utils/logoutput.h"
-#include "utils/string.h" // MMtoStream, PrecisionedDouble
+#include "utils/string.h" // MMtoStream, PrecisionedDouble, writeInt2mm, writeDoubleToBuffer
+#include "utils/TaskScheduler.h"
 #include "WipeScriptConfig.h"
 
 namespace cura {
@@ -35,6 +38,20 @@ std::string transliterate(const std::string& text)
 
 GCodeExport::GCodeExport()
 : output_stream(&std::cout)
+, discarded_output(nullptr)
+, suspended_output_stream(nullptr)
+, file_header_position(-1)
+, file_header_size(0)
+, file_header_line_count(0)
+, has_layer_range(false)
+, layer_range_first(0)
+, layer_range_last(0)
+, chunk_start_time(0.0)
+, chunk_layer_count(0)
+, binary_reference(0, 0, 0)
+, binary_reference_e(0)
+, layer_output_stream(nullptr)
+, task_scheduler(nullptr)
 , currentPosition(0,0,MM2INT(20))
 , layer_nr(0)
 , relative_extrusion(false)
@@ -42,6 +59,7 @@ GCodeExport::GCodeExport()
     *output_stream << std::fixed;
 
     current_e_value = 0;
+    current_e_offset = 0;
     current_extruder = 0;
     current_fan_speed = -1;
 
@@ -166,6 +184,8 @@ const std::string GCodeExport::flavorToString(const EGCodeFlavor& flavor) const
             return "Repetier";
         case EGCodeFlavor::REPRAP:
             return "RepRap";
+        case EGCodeFlavor::BINARY:
+            return "Binary";
         case EGCodeFlavor::MARLIN:
         default:
             return "Marlin";
@@ -280,15 +300,285 @@ std::string GCodeExport::getFileHeader(const std::vector<bool>& extruder_is_used
     return prefix.str();
 }
 
+void GCodeExport::writeFileHeader(const std::string& header)
+{
+    file_header_position = (suspended_output_stream || layer_output_stream) ? std::streampos(-1) : output_stream->tellp();
+    if (file_header_position == std::streampos(-1)) //Can't go back to it, so don't reserve any room.
+    {
+        *output_stream << header << new_line;
+        return;
+    }
+    //The final header has the print time, and for each extruder the material usage and GUID. Their values are longer than the placeholders too.
+    const size_t extruder_count = Application::getInstance().current_slice->scene.extruders.size();
+    file_header_size = header.size() + 128 + 128 * extruder_count;
+    file_header_line_count = std::count(header.begin(), header.end(), '\n') + 2 + 2 * extruder_count;
+    *output_stream << padFileHeader(header, file_header_size, file_header_line_count);
+}
 
-void GCodeExport::setLayerNr(unsigned int layer_nr_) {
+bool GCodeExport::rewriteFileHeader(const std::string& header)
+{
+    if (file_header_position == std::streampos(-1) || layer_output_stream)
+    {
+        return false;
+    }
+    //The header was written before the output was suspended, e.g. after the last layer of a chunk of layers, so it's in the actual output stream.
+    std::ostream* stream = suspended_output_stream ? suspended_output_stream : output_stream;
+    const std::string padded_header = padFileHeader(header, file_header_size, file_header_line_count);
+    if (padded_header.empty())
+    {
+        logWarning("The final g-code header doesn't fit in the room reserved for it.\n");
+        return false;
+    }
+    const std::streampos end_position = stream->tellp();
+    if (end_position == std::streampos(-1) || !stream->seekp(file_header_position))
+    {
+        stream->clear();
+        return false;
+    }
+    *stream << padded_header;
+    stream->seekp(end_position);
+    return static_cast<bool>(*stream);
+}
+
+std::string GCodeExport::padFileHeader(const std::string& header, const size_t size, const size_t line_count) const
+{
+    const size_t header_line_count = std::count(header.begin(), header.end(), '\n');
+    if (header_line_count >= line_count)
+    {
+        return std::string();
+    }
+    const size_t padding_line_count = line_count - header_line_count;
+    //Each padding line is at least a semicolon and a new line. The remaining characters are spaces on the last line.
+    const size_t minimum_padding_size = padding_line_count * (1 + new_line.size());
+    if (header.size() + minimum_padding_size > size)
+    {
+        return std::string();
+    }
+    std::string padded_header = header;
+    padded_header.reserve(size);
+    for (size_t line_idx = 0; line_idx + 1 < padding_line_count; line_idx++)
+    {
+        padded_header += ";";
+        padded_header += new_line;
+    }
+    padded_header += ";";
+    padded_header.append(size - header.size() - minimum_padding_size, ' ');
+    padded_header += new_line;
+    return padded_header;
+}
+
+void GCodeExport::setLayerNr(const LayerIndex layer_nr_) {
     layer_nr = layer_nr_;
+    if (!has_layer_range)
+    {
+        return;
+    }
+    if (layer_nr_ == layer_range_first && suspended_output_stream)
+    {
+        setEstimatesOnly(false);
+        writeChunkStart();
+    }
+    else if (layer_nr_ == layer_range_last + 1 && !suspended_output_stream)
+    {
+        writeChunkEnd();
+        std::ostream* next_chunk_stream = next_chunk_output ? next_chunk_output(layer_nr_) : nullptr;
+        if (!next_chunk_stream)
+        {
+            setEstimatesOnly(true);
+            return;
+        }
+        //Continue with the next chunk, as if it were written by another process.
+        output_stream = next_chunk_stream;
+        *output_stream << std::fixed;
+        file_header_position = -1; //The header is in the stream of the first chunk.
+        layer_range_first = layer_nr_;
+        layer_range_last = layer_nr_ + chunk_layer_count - 1;
+        writeChunkStart();
+    }
+}
+
+void GCodeExport::setLayerRange(const LayerIndex first_layer_nr, const LayerIndex last_layer_nr)
+{
+    has_layer_range = true;
+    layer_range_first = first_layer_nr;
+    layer_range_last = last_layer_nr;
+    chunk_start_time = getSumTotalPrintTimes();
+    chunk_start_filament.clear();
+    for (size_t extruder_nr = 0; extruder_nr < Application::getInstance().current_slice->scene.extruders.size(); extruder_nr++)
+    {
+        chunk_start_filament.push_back(getTotalFilamentUsed(extruder_nr));
+    }
+    if (first_layer_nr > 0) //Not the first chunk, so the start code and the layers before the range are only planned.
+    {
+        setEstimatesOnly(true);
+    }
+}
+
+void GCodeExport::setChunkOutput(const LayerIndex layer_count, const std::function<std::ostream* (const LayerIndex first_layer_nr)>& next_chunk)
+{
+    chunk_layer_count = layer_count;
+    next_chunk_output = next_chunk;
+}
+
+void GCodeExport::writeChunkStart()
+{
+    *output_stream << ";CHUNK.START:" << layer_range_first << new_line;
+    *output_stream << ";CHUNK.EXTRUDER:" << current_extruder << new_line;
+    chunk_start_time = getSumTotalPrintTimes();
+    for (size_t extruder_nr = 0; extruder_nr < chunk_start_filament.size(); extruder_nr++)
+    {
+        chunk_start_filament[extruder_nr] = getTotalFilamentUsed(extruder_nr);
+    }
+
+    for (size_t extruder_nr = 0; extruder_nr < chunk_start_filament.size(); extruder_nr++)
+    {
+        ExtruderTrainAttributes& extruder = extruder_attr[extruder_nr];
+        const Temperature temperature = extruder.currentTemperature;
+        if (temperature != 0 && extruder.is_used)
+        {
+            const bool waited_for_temperature = extruder.waited_for_temperature;
+            extruder.currentTemperature = 0; //Forget the temperature to write it again.
+            constexpr bool wait = false;
+            writeTemperatureCommand(extruder_nr, temperature, wait);
+            extruder.currentTemperature = temperature;
+            extruder.waited_for_temperature = waited_for_temperature;
+        }
+    }
+    const double fan_speed = current_fan_speed;
+    current_fan_speed = -1;
+    if (fan_speed >= 0)
+    {
+        writeFanCommand(fan_speed);
+    }
+    if (!relative_extrusion)
+    { //Continue from the E value that the layers before the range would have ended with in this process.
+        *output_stream << "G92 " << extruder_attr[current_extruder].extruderCharacter << PrecisionedDouble{5, current_e_value + current_e_offset} << new_line;
+    }
+
+    //The layers before the range may have been written by another process, so write the speed and accelerations again when they are used.
+    currentSpeed = -1;
+    current_print_acceleration = -1;
+    current_travel_acceleration = -1;
+    current_jerk = -1;
+}
+
+void GCodeExport::writeChunkEnd()
+{
+    *output_stream << ";CHUNK.END:" << layer_range_last << new_line;
+    *output_stream << ";CHUNK.EXTRUDER:" << current_extruder << new_line;
+    *output_stream << ";CHUNK.TIME:" << (getSumTotalPrintTimes() - chunk_start_time) << new_line;
+    for (size_t extruder_nr = 0; extruder_nr < chunk_start_filament.size(); extruder_nr++)
+    {
+        const double volume = getTotalFilamentUsed(extruder_nr) - chunk_start_filament[extruder_nr];
+        *output_stream << ";CHUNK.VOLUME." << extruder_nr << ":" << volume << new_line;
+        const double filament_area = extruder_attr[extruder_nr].filament_area;
+        *output_stream << ";CHUNK.LENGTH." << extruder_nr << ":" << ((filament_area > 0) ? volume / (1000 * filament_area) : 0.0) << new_line;
+    }
+    //The bounding box includes the layers that were only planned, but those are part of the same print.
+    *output_stream << ";CHUNK.MIN:" << total_bounding_box.min.x << "," << total_bounding_box.min.y << "," << total_bounding_box.min.z << new_line;
+    *output_stream << ";CHUNK.MAX:" << total_bounding_box.max.x << "," << total_bounding_box.max.y << "," << total_bounding_box.max.z << new_line;
 }
 
 void GCodeExport::setOutputStream(std::ostream* stream)
 {
-    output_stream = stream;
-    *output_stream << std::fixed;
+    if (suspended_output_stream)
+    {
+        suspended_output_stream = stream;
+    }
+    else
+    {
+        output_stream = stream;
+    }
+    file_header_position = -1; //The header is in the previous stream.
+    *stream << std::fixed;
+}
+
+std::ostream* GCodeExport::getOutputStream() const
+{
+    return suspended_output_stream ? suspended_output_stream : output_stream;
+}
+
+void GCodeExport::setEstimatesOnly(const bool estimates_only)
+{
+    if (estimates_only == (suspended_output_stream != nullptr))
+    {
+        return;
+    }
+    if (estimates_only)
+    {
+        suspended_output_stream = output_stream;
+        output_stream = &discarded_output;
+    }
+    else
+    {
+        output_stream = suspended_output_stream;
+        suspended_output_stream = nullptr;
+    }
+}
+
+void GCodeExport::setTaskScheduler(TaskScheduler* scheduler)
+{
+    task_scheduler = scheduler;
+}
+
+TaskScheduler* GCodeExport::getTaskScheduler() const
+{
+    return task_scheduler;
+}
+
+void GCodeExport::beginLayerBuffer()
+{
+    if (layer_output_stream || suspended_output_stream)
+    {
+        return; // already buffering, or nothing to convert to text
+    }
+    layer_output_stream = output_stream;
+    layer_text.str("");
+    layer_text.copyfmt(*output_stream);
+    layer_lines.clear();
+    output_stream = &layer_text;
+}
+
+void GCodeExport::flushLayerBuffer()
+{
+    if (!layer_output_stream)
+    {
+        return;
+    }
+    output_stream = layer_output_stream;
+    layer_output_stream = nullptr;
+
+    const std::string text = layer_text.str();
+    constexpr size_t lines_per_chunk = 4096;
+    const size_t chunk_count = (layer_lines.size() + lines_per_chunk - 1) / lines_per_chunk;
+    std::vector<std::string> chunks(chunk_count);
+    const auto convert_chunk = [this, &text, &chunks](const size_t chunk_idx)
+    {
+        const size_t begin = chunk_idx * lines_per_chunk;
+        const size_t end = std::min(begin + lines_per_chunk, layer_lines.size());
+        std::string& chunk = chunks[chunk_idx];
+        char buffer[1024];
+        size_t text_pos = (begin == 0) ? 0 : layer_lines[begin - 1].text_pos; // the text before each line goes along with it
+        for (size_t line_idx = begin; line_idx < end; line_idx++)
+        {
+            const FXYZELine& line = layer_lines[line_idx];
+            chunk.append(text, text_pos, line.text_pos - text_pos);
+            chunk.append(buffer, writeFXYZELine(line, buffer));
+            text_pos = line.text_pos;
+        }
+    };
+    // Chunks are converted both by this thread and by the threads of the task scheduler that have nothing else to do.
+    TaskScheduler::processShared(task_scheduler, chunk_count, convert_chunk);
+
+    for (const std::string& chunk : chunks)
+    {
+        output_stream->write(chunk.data(), chunk.size());
+    }
+    const size_t rest_pos = layer_lines.empty() ? 0 : layer_lines.back().text_pos;
+    output_stream->write(text.data() + rest_pos, text.size() - rest_pos);
+
+    layer_text.str("");
+    layer_lines.clear();
 }
 
 bool GCodeExport::getExtruderIsUsed(const int extruder_nr) const
@@ -494,7 +784,7 @@ void GCodeExport::updateTotalPrintTime()
         total_print_times[i] += estimates[i];
     }
     estimateCalculator.reset();
-    writeTimeComment(getSumTotalPrintTimes());
+    writeTimeComment(getSumTotalPrintTimes() - chunk_start_time);
 }
 
 void GCodeExport::writeComment(const std::string& unsanitized_comment)
@@ -723,8 +1013,8 @@ void GCodeExport::writeTravel(const coord_t& x, const coord_t& y, const coord_t&
     const double layer_height = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<double>("layer_height");
     Application::getInstance().communication->sendLineTo(travel_move_type, Point(x, y), display_width, layer_height, speed);
 
-    *output_stream << "G0";
-    writeFXYZE(speed, x, y, z, current_e_value, travel_move_type);
+    constexpr bool is_travel = true;
+    writeFXYZE(is_travel, speed, x, y, z, current_e_value, travel_move_type);
 }
 
 void GCodeExport::writeExtrusion(const int x, const int y, const int z, const Velocity& speed, const double extrusion_mm3_per_mm, const PrintFeatureType& feature, const bool update_extrusion_offset)
@@ -792,38 +1082,129 @@ void GCodeExport::writeExtrusion(const int x, const int y, const int z, const Ve
     extruder_attr[current_extruder].last_e_value_after_wipe += extrusion_per_mm * diff.vSizeMM();
     double new_e_value = current_e_value + extrusion_per_mm * diff.vSizeMM();
 
-    *output_stream << "G1";
-    writeFXYZE(speed, x, y, z, new_e_value, feature);
+    constexpr bool is_travel = false;
+    writeFXYZE(is_travel, speed, x, y, z, new_e_value, feature);
 }
 
-void GCodeExport::writeFXYZE(const Velocity& speed, const int x, const int y, const int z, const double e, const PrintFeatureType& feature)
+void GCodeExport::writeFXYZE(const bool is_travel, const Velocity& speed, const int x, const int y, const int z, const double e, const PrintFeatureType& feature)
 {
-    if (currentSpeed != speed)
+    FXYZELine line;
+    line.is_travel = is_travel;
+    line.write_feedrate = currentSpeed != speed;
+    if (line.write_feedrate)
     {
-        *output_stream << " F" << PrecisionedDouble{1, speed * 60};
+        line.feedrate = speed * 60;
         currentSpeed = speed;
     }
 
-    Point gcode_pos = getGcodePos(x, y, current_extruder);
-    total_bounding_box.include(Point3(gcode_pos.X, gcode_pos.Y, z));
+    line.position = getGcodePos(x, y, current_extruder);
+    total_bounding_box.include(Point3(line.position.X, line.position.Y, z));
 
-    *output_stream << " X" << MMtoStream{gcode_pos.X} << " Y" << MMtoStream{gcode_pos.Y};
-    if (z != currentPosition.z)
+    line.write_z = z != currentPosition.z;
+    line.z = z;
+    line.extruder_character = 0;
+    if (e + current_e_offset != current_e_value)
     {
-        *output_stream << " Z" << MMtoStream{z};
+        line.extruder_character = extruder_attr[current_extruder].extruderCharacter;
+        line.e = (relative_extrusion)? e + current_e_offset - current_e_value : e + current_e_offset;
     }
-    if (e + current_e_offset != current_e_value)
+
+    if (flavor == EGCodeFlavor::BINARY)
+    { // the differences depend on the moves before, so they can't be computed when converting the lines in parallel
+        line.binary_delta = Point3(line.position.X, line.position.Y, line.write_z ? z : binary_reference.z) - binary_reference;
+        binary_reference = Point3(line.position.X, line.position.Y, line.write_z ? z : binary_reference.z);
+        if (line.extruder_character)
+        {
+            const int64_t e_units = std::llround(line.e * 100000.0);
+            line.binary_delta_e = e_units - binary_reference_e;
+            binary_reference_e = e_units;
+        }
+    }
+
+    if (layer_output_stream)
+    { // converted to text when the layer is flushed
+        line.text_pos = layer_text.tellp();
+        layer_lines.push_back(line);
+    }
+    else if (!suspended_output_stream)
     {
-        const double output_e = (relative_extrusion)? e + current_e_offset - current_e_value : e + current_e_offset;
-        *output_stream << " " << extruder_attr[current_extruder].extruderCharacter << PrecisionedDouble{5, output_e};
+        char buffer[1024];
+        output_stream->write(buffer, writeFXYZELine(line, buffer));
     }
-    *output_stream << new_line;
     
     currentPosition = Point3(x, y, z);
     current_e_value = e;
     estimateCalculator.plan(TimeEstimateCalculator::Position(INT2MM(x), INT2MM(y), INT2MM(z), eToMm(e)), speed, feature);
 }
 
+size_t GCodeExport::writeFXYZELine(const FXYZELine& line, char* buffer) const
+{
+    size_t length = 0;
+    if (flavor == EGCodeFlavor::BINARY)
+    {
+        const auto append_varint = [buffer, &length](uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer[length++] = static_cast<char>(0x80 | (value & 0x7F));
+                value >>= 7;
+            }
+            buffer[length++] = static_cast<char>(value);
+        };
+        const auto append_signed = [&append_varint](const int64_t value)
+        {
+            append_varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63)); // zigzag, so that small negative numbers stay small
+        };
+
+        buffer[length++] = static_cast<char>(0x80 | (line.is_travel ? 0 : 0x40) | (line.write_feedrate ? 0x01 : 0) | (line.write_z ? 0x02 : 0) | (line.extruder_character ? 0x04 : 0));
+        if (line.write_feedrate)
+        {
+            append_varint(std::llround(line.feedrate * 10.0));
+        }
+        append_signed(line.binary_delta.x);
+        append_signed(line.binary_delta.y);
+        if (line.write_z)
+        {
+            append_signed(line.binary_delta.z);
+        }
+        if (line.extruder_character)
+        {
+            append_signed(line.binary_delta_e);
+        }
+        return length;
+    }
+
+    const auto append = [buffer, &length](const char* text, const size_t text_length)
+    {
+        std::memcpy(buffer + length, text, text_length);
+        length += text_length;
+    };
+
+    append(line.is_travel ? "G0" : "G1", 2);
+    if (line.write_feedrate)
+    {
+        append(" F", 2);
+        length += writeDoubleToBuffer(1, line.feedrate, buffer + length);
+    }
+    append(" X", 2);
+    length += writeInt2mm(line.position.X, buffer + length);
+    append(" Y", 2);
+    length += writeInt2mm(line.position.Y, buffer + length);
+    if (line.write_z)
+    {
+        append(" Z", 2);
+        length += writeInt2mm(line.z, buffer + length);
+    }
+    if (line.extruder_character)
+    {
+        buffer[length++] = ' ';
+        buffer[length++] = line.extruder_character;
+        length += writeDoubleToBuffer(5, line.e, buffer + length);
+    }
+    append(new_line.data(), new_line.size());
+    return length;
+}
+
 void GCodeExport::writeUnretractionAndPrime()
 {
     const double prime_volume = extruder_attr[current_extruder].prime_volume;
@@ -1339,6 +1720,10 @@ void GCodeExport::finalize(const char* endCode)
 {
     writeFanCommand(0);
     writeCode(endCode);
+    if (has_layer_range)
+    {
+        writeChunkEnd(); //Discarded if the range ended before the last layer, since its summary was written there.
+    }
     int64_t print_time = getSumTotalPrintTimes();
     int mat_0 = getTotalFilamentUsed(0);
     log("Print time (s): %d\n", print_time);
@@ -5,6 +5,7 @@
 #define GCODEEXPORT_H
 
 #include <deque> // for extrusionAmountAtPreviousRetractions
+#include <functional> // for the output of the next chunk of layers
 #ifdef BUILD_TESTS
     #include <gtest/gtest_prod.h> //To allow tests to use protected members.
 #endif
@@ -15,6 +16,7 @@
 #include "timeEstimate.h"
 #include "settings/EnumSettings.h"
 #include "settings/Settings.h" //For MAX_EXTRUDERS.
+#include "settings/types/LayerIndex.h" //For the range of layers to write.
 #include "settings/types/Temperature.h" //Bed temperature.
 #include "settings/types/Velocity.h"
 #include "utils/IntPoint.h"
@@ -23,8 +25,8 @@
 namespace cura
 {
 
-struct LayerIndex;
 class RetractionConfig;
+class TaskScheduler;
 struct WipeScriptConfig;
 
 //The GCodeExport class writes the actual GCode. This is the only class that knows how GCode looks and feels.
@@ -62,6 +64,11 @@ class GCodeExport : public NoCopy
     FRIEND_TEST(GCodeExportTest, insertWipeScriptOptionalDelay);
     FRIEND_TEST(GCodeExportTest, insertWipeScriptRetractionEnable);
     FRIEND_TEST(GCodeExportTest, insertWipeScriptHopEnable);
+    FRIEND_TEST(GCodeExportTest, LayerBufferSameOutput);
+    FRIEND_TEST(GCodeExportTest, BinaryFlavorMoves);
+    FRIEND_TEST(GCodeExportTest, EstimatesOnly);
+    FRIEND_TEST(GCodeExportTest, LayerRange);
+    FRIEND_TEST(GCodeExportTest, ChunkOutput);
 #endif
 private:
     struct ExtruderTrainAttributes
@@ -112,8 +119,48 @@ private:
     std::string machine_buildplate_type;
 
     std::ostream* output_stream;
+    std::ostream discarded_output; //!< A stream without a buffer, which ignores everything written to it. See \ref GCodeExport::setEstimatesOnly
+    std::ostream* suspended_output_stream; //!< The actual output stream while only computing the estimates, or nullptr while writing g-code.
+    std::streampos file_header_position; //!< Where in the output stream the header was written by \ref GCodeExport::writeFileHeader, or -1 if it can't be replaced.
+    size_t file_header_size; //!< The number of characters reserved for the header, including the padding.
+    size_t file_header_line_count; //!< The number of lines reserved for the header, including the padding.
     std::string new_line;
 
+    bool has_layer_range; //!< Whether only a chunk of the layers is written, see \ref GCodeExport::setLayerRange
+    LayerIndex layer_range_first; //!< The first layer of the chunk that is written.
+    LayerIndex layer_range_last; //!< The last layer of the chunk that is written.
+    Duration chunk_start_time; //!< The estimated print time before the chunk, so that the time comments and the summary only count the chunk itself.
+    std::vector<double> chunk_start_filament; //!< For each extruder, the material used before the chunk (in mm^3).
+    LayerIndex chunk_layer_count; //!< The number of layers of each chunk after the first, if the layers after the range are written as more chunks. See \ref GCodeExport::setChunkOutput
+    std::function<std::ostream* (const LayerIndex)> next_chunk_output; //!< Gives the stream to write the next chunk to, or is empty if the layers after the range aren't written.
+
+    /*!
+     * The numbers of a G0 or G1 line as written by \ref GCodeExport::writeFXYZE,
+     * kept so that they can be converted to text later on.
+     */
+    struct FXYZELine
+    {
+        size_t text_pos; //!< Where in \ref GCodeExport::layer_text the line goes
+        bool is_travel; //!< Whether it is a G0 rather than a G1 line
+        bool write_feedrate; //!< Whether to write the F value
+        double feedrate; //!< The F value in mm/min
+        Point position; //!< The X and Y values in microns
+        bool write_z; //!< Whether to write the Z value
+        coord_t z; //!< The Z value in microns
+        char extruder_character; //!< The letter of the E value, or zero to not write the E value
+        double e; //!< The E value
+        Point3 binary_delta; //!< For the binary flavor: the X, Y and Z values minus those of the previous record which had them
+        int64_t binary_delta_e; //!< For the binary flavor: the E value in units of 10^-5 minus that of the previous record which had one
+    };
+
+    Point3 binary_reference; //!< The X, Y and Z values of the previous binary move records, see \ref EGCodeFlavor::BINARY
+    int64_t binary_reference_e; //!< The E value in units of 10^-5 of the previous binary move record which had one
+
+    std::ostream* layer_output_stream; //!< The stream to write the buffered layer to, or nullptr if no layer is being buffered. See \ref GCodeExport::beginLayerBuffer
+    std::ostringstream layer_text; //!< The g-code of the buffered layer, without the G0 and G1 lines
+    std::vector<FXYZELine> layer_lines; //!< The G0 and G1 lines of the buffered layer
+    TaskScheduler* task_scheduler; //!< The scheduler on whose idle threads buffered layers are converted to text, or nullptr to convert them on the calling thread only
+
     double current_e_value; //!< The last E value written to gcode (in mm or mm^3)
 
     // flow-rate compensation
@@ -224,10 +271,126 @@ public:
      */
     std::string getFileHeader(const std::vector<bool>& extruder_is_used, const Duration* print_time = nullptr, const std::vector<double>& filament_used = std::vector<double>(), const std::vector<std::string>& mat_ids = std::vector<std::string>());
 
-    void setLayerNr(unsigned int layer_nr);
+    /*!
+     * Write the file header at the start of sequential output, before the
+     * print time and material usage are known.
+     *
+     * If the output stream can go back to it, room is reserved after the
+     * header, so that \ref GCodeExport::rewriteFileHeader can replace it in
+     * place once the estimates are known, without a second pass over the
+     * file.
+     * \param header The header as given by \ref GCodeExport::getFileHeader
+     */
+    void writeFileHeader(const std::string& header);
+
+    /*!
+     * Replace the header written by \ref GCodeExport::writeFileHeader with the
+     * final one, and continue writing at the end of the output.
+     * \param header The final header as given by
+     * \ref GCodeExport::getFileHeader
+     * \return Whether the header could be replaced. If not, the output keeps
+     * the header that was written at the start.
+     */
+    bool rewriteFileHeader(const std::string& header);
+
+    /*!
+     * Set the layer that is written next.
+     *
+     * If only a range of layers is written, this starts and ends the output of
+     * that range, see \ref GCodeExport::setLayerRange.
+     * \param layer_nr The layer that is written next.
+     */
+    void setLayerNr(const LayerIndex layer_nr);
+
+    /*!
+     * Only write the g-code of a range of layers, so that a large print can be
+     * sliced by several processes which each write one chunk of its layers.
+     * The chunks are joined with \ref GCodeStitcher.
+     *
+     * All layers up to the range still have to be planned, or at least the
+     * last few of them, so that the state of the printer at the start of the
+     * range is known. They are only used for that state and not written. The
+     * start of the range restores the state that the layers before it leave
+     * the printer in: the E value, the temperatures and the fan speed. The end
+     * of the range is followed by a summary of the estimates of the chunk.
+     *
+     * This must be called after the estimates are reset at the start of the
+     * print.
+     * \param first_layer_nr The first layer to write. If it is the first layer
+     * of the print, the start code is written as well.
+     * \param last_layer_nr The last layer to write. If there is no layer after
+     * it, the end code is written as well.
+     */
+    void setLayerRange(const LayerIndex first_layer_nr, const LayerIndex last_layer_nr);
+
+    /*!
+     * Write the layers after the range of \ref GCodeExport::setLayerRange as
+     * more chunks, each to a stream of its own, instead of not writing them.
+     *
+     * Each chunk is written as if it were sliced by a process of its own, so
+     * the chunks can be joined with \ref GCodeStitcher.
+     * \param layer_count The number of layers of each chunk.
+     * \param next_chunk Called after the summary of a chunk is written, with
+     * the first layer of the next chunk. Gives the stream to write the next
+     * chunk to, or nullptr to stop writing.
+     */
+    void setChunkOutput(const LayerIndex layer_count, const std::function<std::ostream* (const LayerIndex first_layer_nr)>& next_chunk);
 
     void setOutputStream(std::ostream* stream);
 
+    /*!
+     * Get the stream that the g-code is written to, also while only the
+     * estimates are computed.
+     */
+    std::ostream* getOutputStream() const;
+
+    /*!
+     * Only keep track of the print time and material estimates, without
+     * writing any g-code.
+     *
+     * All moves are planned as usual, so the estimates are the same as when
+     * writing g-code, but nothing is converted to text.
+     * \param estimates_only Whether to skip writing g-code. When turned off
+     * again, the g-code is written to the output stream as before.
+     */
+    void setEstimatesOnly(const bool estimates_only);
+
+    /*!
+     * Set the scheduler on whose idle threads buffered layers are converted to
+     * text, see \ref GCodeExport::flushLayerBuffer.
+     *
+     * \param scheduler The scheduler, or nullptr to convert the layers on the
+     * calling thread only.
+     */
+    void setTaskScheduler(TaskScheduler* scheduler);
+
+    /*!
+     * Get the scheduler that was set with \ref GCodeExport::setTaskScheduler,
+     * so that the layers that are being produced on it can use its idle
+     * threads as well.
+     *
+     * \return The scheduler, or nullptr if none was set.
+     */
+    TaskScheduler* getTaskScheduler() const;
+
+    /*!
+     * Start collecting the g-code in a buffer rather than writing it to the
+     * output stream, until \ref GCodeExport::flushLayerBuffer is called.
+     *
+     * All state of the exporter is kept up to date as usual, but the G0 and G1
+     * lines are kept as numbers and only converted to text when flushing. That
+     * way the conversion of a whole layer can be divided over the threads of
+     * the task scheduler, if one is set.
+     */
+    void beginLayerBuffer();
+
+    /*!
+     * Convert the buffered g-code to text and write it to the output stream.
+     *
+     * Does nothing if no layer is being buffered.
+     */
+    void flushLayerBuffer();
+
     bool getExtruderIsUsed(const int extruder_nr) const; //!< return whether the extruder has been used throughout printing all meshgroup up till now
 
     Point getGcodePos(const coord_t x, const coord_t y, const int extruder_train) const;
@@ -395,8 +558,38 @@ private:
      * This function updates the \ref GCodeExport::total_bounding_box
      * It estimates the time in \ref GCodeExport::estimateCalculator for the correct feature
      * It updates \ref GCodeExport::currentPosition, \ref GCodeExport::current_e_value and \ref GCodeExport::currentSpeed
+     *
+     * \param is_travel Whether to write a G0 rather than a G1 move
+     */
+    void writeFXYZE(const bool is_travel, const Velocity& speed, const int x, const int y, const int z, const double e, const PrintFeatureType& feature);
+
+    /*!
+     * Write a G0 or G1 line, as text or as a binary record depending on the
+     * flavor.
+     *
+     * \param line The numbers to write.
+     * \param buffer The buffer to write the characters to. It needs room for
+     * at least 1024 characters.
+     * \return The number of characters written.
+     */
+    size_t writeFXYZELine(const FXYZELine& line, char* buffer) const;
+
+    /*!
+     * Start writing the range of layers of \ref GCodeExport::setLayerRange,
+     * after the layers before it were only planned.
+     *
+     * Writes the state of the printer that the layers before the range left it
+     * in, and forgets the state that isn't written here so that it's written
+     * again when it's needed.
+     */
+    void writeChunkStart();
+
+    /*!
+     * Write the summary of the estimates of the range of layers of
+     * \ref GCodeExport::setLayerRange, which \ref GCodeStitcher combines into
+     * the header of the whole print.
      */
-    void writeFXYZE(const Velocity& speed, const int x, const int y, const int z, const double e, const PrintFeatureType& feature);
+    void writeChunkEnd();
 
     /*!
      * The writeTravel and/or writeExtrusion when flavor == BFB
@@ -408,6 +601,19 @@ private:
      * \param feature print feature to track print time for
      */
     void writeMoveBFB(const int x, const int y, const int z, const Velocity& speed, double extrusion_mm3_per_mm, PrintFeatureType feature);
+
+    /*!
+     * Pad a file header with comment lines up to an exact number of characters
+     * and lines.
+     *
+     * Both are kept the same, so that the padded header takes exactly as many
+     * bytes in the file even if the line endings are converted when writing.
+     * \param header The header to pad, ending with a new line.
+     * \param size The number of characters of the padded header.
+     * \param line_count The number of lines of the padded header.
+     * \return The padded header, or an empty string if the header doesn't fit.
+     */
+    std::string padFileHeader(const std::string& header, const size_t size, const size_t line_count) const;
 public:
     /*!
      * Get ready for extrusion moves:
@@ -3,7 +3,7 @@
 
 #include <algorithm> //For std::sort.
 #include <functional>
-#include <unordered_set>
+#include <memory> //For unique_ptr.
 
 #include "infill.h"
 #include "sliceDataStorage.h"
@@ -15,6 +15,7 @@
 #include "infill/SubDivCube.h"
 #include "infill/UniformDensityProvider.h"
 #include "utils/logoutput.h"
+#include "utils/NoCopy.h"
 #include "utils/PolygonConnector.h"
 #include "utils/polygonUtils.h"
 #include "utils/UnionFind.h"
@@ -42,6 +43,173 @@ static inline int computeScanSegmentIdx(int x, int line_width)
 
 namespace cura {
 
+namespace
+{
+
+/*!
+ * \brief Where a scanline crosses the outline.
+ *
+ * When we find crossings, we keep track of which crossing belongs to which scanline and to which polygon line segment.
+ * Then we can later join two crossings together to form lines and still know what polygon line segments that infill line connected to.
+ */
+struct Crossing
+{
+    Crossing(Point coordinate, size_t polygon_index, size_t vertex_index): coordinate(coordinate), polygon_index(polygon_index), vertex_index(vertex_index) {};
+    Point coordinate;
+    size_t polygon_index;
+    size_t vertex_index;
+    bool operator <(const Crossing& other) const //Crossings will be ordered by their Y coordinate so that they get ordered along the scanline.
+    {
+        return coordinate.Y < other.coordinate.Y;
+    }
+};
+
+/*!
+ * \brief The lists of crossings per scanline of one thread.
+ *
+ * Every infill area of every layer fills these in again, so they are kept to save allocating them each time, like the Clipper
+ * engines in CachedClipper. They keep the capacity of the largest area the thread filled in until the thread ends.
+ */
+struct ScanlineBuffers
+{
+    std::vector<std::vector<coord_t>> cut_list; //!< For each scanline the Y coordinates of the crossings.
+    std::vector<std::vector<Crossing>> crossings_per_scanline; //!< For each scanline the crossings with the polygon line segment they're on.
+    bool in_use = false;
+};
+
+thread_local ScanlineBuffers thread_scanline_buffers;
+
+/*!
+ * \brief Access to the scanline buffers of the calling thread, emptied and
+ * sized for a number of scanlines.
+ *
+ * If the buffers of the thread are still being used, separate buffers are
+ * created instead.
+ */
+class CachedScanlineBuffers : NoCopy
+{
+public:
+    CachedScanlineBuffers(const size_t cut_list_size, const size_t crossings_per_scanline_size)
+    {
+        if (thread_scanline_buffers.in_use)
+        {
+            separate_buffers.reset(new ScanlineBuffers());
+            buffers = separate_buffers.get();
+        }
+        else
+        {
+            thread_scanline_buffers.in_use = true;
+            buffers = &thread_scanline_buffers;
+        }
+        reset(buffers->cut_list, cut_list_size);
+        reset(buffers->crossings_per_scanline, crossings_per_scanline_size);
+    }
+
+    ~CachedScanlineBuffers()
+    {
+        if (!separate_buffers)
+        {
+            thread_scanline_buffers.in_use = false;
+        }
+    }
+
+    ScanlineBuffers* operator->()
+    {
+        return buffers;
+    }
+
+private:
+    //Empties the lists that are used, keeping what they allocated.
+    template<typename T>
+    static void reset(std::vector<std::vector<T>>& lists, const size_t size)
+    {
+        lists.resize(size);
+        for (std::vector<T>& list : lists)
+        {
+            list.clear();
+        }
+    }
+
+    ScanlineBuffers* buffers; //!< The buffers to use.
+    std::unique_ptr<ScanlineBuffers> separate_buffers; //!< The buffers that were created if the ones of the thread were in use.
+};
+
+/*!
+ * \brief Walk along the outline and find where it crosses the scanlines.
+ *
+ * This is the inner loop of the linear infill, instantiated for each connector processor so that its calls inline, and once
+ * with and once without gathering the crossings per scanline, which only zig-zaggified infill needs.
+ * \tparam record_crossings Whether to fill in \p crossings_per_scanline.
+ * \param outline The rotated outline of the infill area.
+ * \param shift The offset of the scanlines.
+ * \param line_distance The distance between the scanlines.
+ * \param scanline_min_idx The scanline of the first entry in \p cut_list.
+ * \param min_scanline_index The scanline of the first entry in \p crossings_per_scanline.
+ * \param[out] cut_list For each scanline the Y coordinates of the crossings.
+ * \param[out] crossings_per_scanline For each scanline the crossings with the polygon line segment they're on.
+ * \param zigzag_connector_processor The processor to register the vertices and crossings with.
+ */
+template<bool record_crossings, typename ConnectorProcessor>
+void scanOutline(const Polygons& outline, const coord_t shift, const int line_distance, const int scanline_min_idx, const int min_scanline_index, std::vector<std::vector<coord_t>>& cut_list, std::vector<std::vector<Crossing>>& crossings_per_scanline, ConnectorProcessor& zigzag_connector_processor)
+{
+    for(size_t poly_idx = 0; poly_idx < outline.size(); poly_idx++)
+    {
+        ConstPolygonRef poly = outline[poly_idx];
+        Point p0 = poly.back();
+        zigzag_connector_processor.registerVertex(p0); // always adds the first point to ZigzagConnectorProcessorEndPieces::first_zigzag_connector when using a zigzag infill type
+
+        for(size_t point_idx = 0; point_idx < poly.size(); point_idx++)
+        {
+            Point p1 = poly[point_idx];
+            if (p1.X == p0.X)
+            {
+                zigzag_connector_processor.registerVertex(p1); 
+                // TODO: how to make sure it always adds the shortest line? (in order to prevent overlap with the zigzag connectors)
+                // note: this is already a problem for normal infill, but hasn't really bothered anyone so far.
+                p0 = p1;
+                continue; 
+            }
+
+            int scanline_idx0;
+            int scanline_idx1;
+            // this way of handling the indices takes care of the case where a boundary line segment ends exactly on a scanline:
+            // in case the next segment moves back from that scanline either 2 or 0 scanline-boundary intersections are created
+            // otherwise only 1 will be created, counting as an actual intersection
+            int direction = 1;
+            if (p0.X < p1.X) 
+            {
+                scanline_idx0 = computeScanSegmentIdx(p0.X - shift, line_distance) + 1; // + 1 cause we don't cross the scanline of the first scan segment
+                scanline_idx1 = computeScanSegmentIdx(p1.X - shift, line_distance); // -1 cause the vertex point is handled in the next segment (or not in the case which looks like >)
+            }
+            else
+            {
+                direction = -1;
+                scanline_idx0 = computeScanSegmentIdx(p0.X - shift, line_distance); // -1 cause the vertex point is handled in the previous segment (or not in the case which looks like >)
+                scanline_idx1 = computeScanSegmentIdx(p1.X - shift, line_distance) + 1; // + 1 cause we don't cross the scanline of the first scan segment
+            }
+
+            for(int scanline_idx = scanline_idx0; scanline_idx != scanline_idx1 + direction; scanline_idx += direction)
+            {
+                int x = scanline_idx * line_distance + shift;
+                int y = p1.Y + (p0.Y - p1.Y) * (x - p1.X) / (p0.X - p1.X);
+                assert(scanline_idx - scanline_min_idx >= 0 && scanline_idx - scanline_min_idx < int(cut_list.size()) && "reading infill cutlist index out of bounds!");
+                cut_list[scanline_idx - scanline_min_idx].push_back(y);
+                Point scanline_linesegment_intersection(x, y);
+                zigzag_connector_processor.registerScanlineSegmentIntersection(scanline_linesegment_intersection, scanline_idx);
+                if (record_crossings)
+                {
+                    crossings_per_scanline[scanline_idx - min_scanline_index].emplace_back(scanline_linesegment_intersection, poly_idx, point_idx);
+                }
+            }
+            zigzag_connector_processor.registerVertex(p1);
+            p0 = p1;
+        }
+        zigzag_connector_processor.registerPolyFinished();
+    }
+}
+
+} //Anonymous namespace.
+
 void Infill::generate(Polygons& result_polygons, Polygons& result_lines, const SierpinskiFillProvider* cross_fill_provider, const SliceMeshStorage* mesh)
 {
     coord_t outline_offset_raw = outline_offset;
@@ -168,6 +336,7 @@ void Infill::_generate(Polygons& result_polygons, Polygons& result_lines, const
         connectLines(result_lines);
     }
     crossings_on_line.clear();
+    line_segments.clear();
 }
 
 void Infill::multiplyInfill(Polygons& result_polygons, Polygons& result_lines)
@@ -201,17 +370,17 @@ void Infill::multiplyInfill(Polygons& result_polygons, Polygons& result_lines)
         }
     }
     result.add(first_offset);
-    Polygons reference_polygons = first_offset;
-    for (size_t infill_line = 1; infill_line < infill_multiplier / 2; infill_line++) // 2 because we are making lines on both sides at the same time
+    if (infill_multiplier / 2 > 1) // 2 because we are making lines on both sides at the same time
     {
-        Polygons extra_offset = reference_polygons.offset(-infill_line_width);
-        result.add(extra_offset);
-        reference_polygons = std::move(extra_offset);
+        for (const Polygons& extra_offset : first_offset.offsetLadder(-infill_line_width, -infill_line_width, infill_multiplier / 2 - 1))
+        {
+            result.add(extra_offset);
+        }
     }
 
     if (zig_zaggify)
     {
-        result = result.intersection(outline);
+        result.intersectionInPlace(outline);
     }
 
     if (!odd_multiplier)
@@ -271,23 +440,26 @@ void Infill::generateConcentricInfill(Polygons& result, int inset_value)
 void Infill::generateConcentricInfill(Polygons& first_concentric_wall, Polygons& result, int inset_value)
 {
     result.add(first_concentric_wall);
-    Polygons* prev_inset = &first_concentric_wall;
-    Polygons next_inset;
-    Polygons new_inset;  // This intermediate inset variable is needed because prev_inset is referencing
-    while (prev_inset->size() > 0)
-    {
-        new_inset = prev_inset->offset(-inset_value);
-        result.add(new_inset);
-        if (perimeter_gaps)
+    // Each inset is offset from the previous one, until the area is used up.
+    const std::vector<Polygons> insets = first_concentric_wall.offsetLadder(-inset_value, -inset_value);
+    for (const Polygons& inset : insets)
+    {
+        result.add(inset);
+    }
+    if (perimeter_gaps)
+    {
+        const Polygons* prev_inset = &first_concentric_wall;
+        for (size_t inset_idx = 0; inset_idx <= insets.size() && !prev_inset->empty(); inset_idx++)
         {
             const Polygons outer = prev_inset->offset(-infill_line_width / 2 - perimeter_gaps_extra_offset);
-            const Polygons inner = new_inset.offset(infill_line_width / 2);
+            const Polygons inner = (inset_idx < insets.size()) ? insets[inset_idx].offset(infill_line_width / 2) : Polygons(); // the innermost inset borders on nothing
             const Polygons gaps_here = outer.difference(inner);
             perimeter_gaps->add(gaps_here);
+            if (inset_idx < insets.size())
+            {
+                prev_inset = &insets[inset_idx];
+            }
         }
-        // This operation helps to prevent the variable "prev_inset" changes whenever next_inset changes
-        next_inset = new_inset;
-        prev_inset = &next_inset;
     }
     std::reverse(std::begin(result), std::end(result));
 }
@@ -443,6 +615,31 @@ void Infill::addLineInfill(Polygons& result, const PointMatrix& rotation_matrix,
     }
 }
 
+const Polygons& Infill::getOffsetOutline(const coord_t offset)
+{
+    std::map<coord_t, Polygons>::iterator cached = offset_outlines.find(offset);
+    if (cached == offset_outlines.end())
+    {
+        cached = offset_outlines.emplace(offset, in_outline.offset(offset)).first;
+    }
+    return cached->second;
+}
+
+const Polygons& Infill::getRotatedOutline(const coord_t offset, const PointMatrix& rotation_matrix)
+{
+    std::pair<coord_t, std::array<double, 4>> key;
+    key.first = offset;
+    std::copy(rotation_matrix.matrix, rotation_matrix.matrix + 4, key.second.begin());
+    std::map<std::pair<coord_t, std::array<double, 4>>, Polygons>::iterator cached = rotated_outlines.find(key);
+    if (cached == rotated_outlines.end())
+    {
+        Polygons rotated = getOffsetOutline(offset);
+        rotated.applyMatrix(rotation_matrix);
+        cached = rotated_outlines.emplace(key, std::move(rotated)).first;
+    }
+    return cached->second;
+}
+
 coord_t Infill::getShiftOffsetFromInfillOriginAndRotation(const double& infill_rotation)
 {
     if (infill_origin.X != 0 || infill_origin.Y != 0)
@@ -457,7 +654,7 @@ void Infill::generateLineInfill(Polygons& result, int line_distance, const doubl
 {
     shift += getShiftOffsetFromInfillOriginAndRotation(infill_rotation);
     PointMatrix rotation_matrix(infill_rotation);
-    NoZigZagConnectorProcessor lines_processor(rotation_matrix, result);
+    NoZigZagConnectorProcessor lines_processor;
     bool connected_zigzags = false;
     generateLinearBasedInfill(outline_offset, result, line_distance, rotation_matrix, lines_processor, connected_zigzags, shift);
 }
@@ -495,7 +692,8 @@ void Infill::generateZigZagInfill(Polygons& result, const coord_t line_distance,
  * Edit: the term scansegment is wrong, since I call a boundary segment leaving from an even scanline to the left as belonging to an even scansegment, 
  *  while I also call a boundary segment leaving from an even scanline toward the right as belonging to an even scansegment.
  */
-void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& result, const int line_distance, const PointMatrix& rotation_matrix, ZigzagConnectorProcessor& zigzag_connector_processor, const bool connected_zigzags, coord_t extra_shift)
+template<typename ConnectorProcessor>
+void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& result, const int line_distance, const PointMatrix& rotation_matrix, ConnectorProcessor& zigzag_connector_processor, const bool connected_zigzags, coord_t extra_shift)
 {
     if (line_distance == 0)
     {
@@ -510,24 +708,25 @@ void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& resul
 
     if (outline_offset != 0 && perimeter_gaps)
     {
-        const Polygons gaps_outline = in_outline.offset(outline_offset + infill_line_width / 2 + perimeter_gaps_extra_offset);
+        const Polygons& gaps_outline = getOffsetOutline(outline_offset + infill_line_width / 2 + perimeter_gaps_extra_offset);
         perimeter_gaps->add(in_outline.difference(gaps_outline));
     }
 
-    Polygons outline = in_outline.offset(outline_offset + infill_overlap);
+    //The outline is offset only once and rotated only once per direction, even if the pattern has several passes.
+    //So every pass has the same polygons, with the same vertices as the connectLines step.
+    const Polygons& outline = getRotatedOutline(outline_offset + infill_overlap, rotation_matrix);
 
     if (outline.size() == 0)
     {
         return;
     }
-    //TODO: Currently we find the outline every time for each rotation.
-    //We should compute it only once and rotate that accordingly.
-    //We'll also have the guarantee that they have the same size every time.
-    //Currently we assume that the above operations are all rotation-invariant,
-    //which they aren't if vertices fall on the same coordinate due to rounding.
     crossings_on_line.resize(outline.size()); //One for each polygon.
-
-    outline.applyMatrix(rotation_matrix);
+    size_t max_polygon_size = 0;
+    for (ConstPolygonRef poly : outline)
+    {
+        max_polygon_size = std::max(max_polygon_size, poly.size());
+    }
+    zigzag_connector_processor.reserve(max_polygon_size);
 
     if (shift < 0)
     {
@@ -543,86 +742,29 @@ void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& resul
     int scanline_min_idx = computeScanSegmentIdx(boundary.min.X - shift, line_distance);
     int line_count = computeScanSegmentIdx(boundary.max.X - shift, line_distance) + 1 - scanline_min_idx;
 
-    std::vector<std::vector<coord_t>> cut_list; // mapping from scanline to all intersections with polygon segments
-
-    for(int scanline_idx = 0; scanline_idx < line_count; scanline_idx++)
-    {
-        cut_list.push_back(std::vector<coord_t>());
-    }
-
-    //When we find crossings, keep track of which crossing belongs to which scanline and to which polygon line segment.
-    //Then we can later join two crossings together to form lines and still know what polygon line segments that infill line connected to.
-    struct Crossing
-    {
-        Crossing(Point coordinate, size_t polygon_index, size_t vertex_index): coordinate(coordinate), polygon_index(polygon_index), vertex_index(vertex_index) {};
-        Point coordinate;
-        size_t polygon_index;
-        size_t vertex_index;
-        bool operator <(const Crossing& other) const //Crossings will be ordered by their Y coordinate so that they get ordered along the scanline.
-        {
-            return coordinate.Y < other.coordinate.Y;
-        }
-    };
-    std::vector<std::vector<Crossing>> crossings_per_scanline; //For each scanline, a list of crossings.
     const int min_scanline_index = computeScanSegmentIdx(boundary.min.X - shift, line_distance) + 1;
     const int max_scanline_index = computeScanSegmentIdx(boundary.max.X - shift, line_distance) + 1;
-    crossings_per_scanline.resize(max_scanline_index - min_scanline_index);
+    CachedScanlineBuffers buffers(line_count, zig_zaggify ? max_scanline_index - min_scanline_index : 0);
+    std::vector<std::vector<coord_t>>& cut_list = buffers->cut_list; // mapping from scanline to all intersections with polygon segments
+    std::vector<std::vector<Crossing>>& crossings_per_scanline = buffers->crossings_per_scanline; //For each scanline, a list of crossings.
 
     for(size_t poly_idx = 0; poly_idx < outline.size(); poly_idx++)
     {
-        PolygonRef poly = outline[poly_idx];
-        crossings_on_line[poly_idx].resize(poly.size()); //One for each line in this polygon.
-        Point p0 = poly.back();
-        zigzag_connector_processor.registerVertex(p0); // always adds the first point to ZigzagConnectorProcessorEndPieces::first_zigzag_connector when using a zigzag infill type
-
-        for(size_t point_idx = 0; point_idx < poly.size(); point_idx++)
-        {
-            Point p1 = poly[point_idx];
-            if (p1.X == p0.X)
-            {
-                zigzag_connector_processor.registerVertex(p1); 
-                // TODO: how to make sure it always adds the shortest line? (in order to prevent overlap with the zigzag connectors)
-                // note: this is already a problem for normal infill, but hasn't really bothered anyone so far.
-                p0 = p1;
-                continue; 
-            }
-
-            int scanline_idx0;
-            int scanline_idx1;
-            // this way of handling the indices takes care of the case where a boundary line segment ends exactly on a scanline:
-            // in case the next segment moves back from that scanline either 2 or 0 scanline-boundary intersections are created
-            // otherwise only 1 will be created, counting as an actual intersection
-            int direction = 1;
-            if (p0.X < p1.X) 
-            {
-                scanline_idx0 = computeScanSegmentIdx(p0.X - shift, line_distance) + 1; // + 1 cause we don't cross the scanline of the first scan segment
-                scanline_idx1 = computeScanSegmentIdx(p1.X - shift, line_distance); // -1 cause the vertex point is handled in the next segment (or not in the case which looks like >)
-            }
-            else
-            {
-                direction = -1;
-                scanline_idx0 = computeScanSegmentIdx(p0.X - shift, line_distance); // -1 cause the vertex point is handled in the previous segment (or not in the case which looks like >)
-                scanline_idx1 = computeScanSegmentIdx(p1.X - shift, line_distance) + 1; // + 1 cause we don't cross the scanline of the first scan segment
-            }
-
-            for(int scanline_idx = scanline_idx0; scanline_idx != scanline_idx1 + direction; scanline_idx += direction)
-            {
-                int x = scanline_idx * line_distance + shift;
-                int y = p1.Y + (p0.Y - p1.Y) * (x - p1.X) / (p0.X - p1.X);
-                assert(scanline_idx - scanline_min_idx >= 0 && scanline_idx - scanline_min_idx < int(cut_list.size()) && "reading infill cutlist index out of bounds!");
-                cut_list[scanline_idx - scanline_min_idx].push_back(y);
-                Point scanline_linesegment_intersection(x, y);
-                zigzag_connector_processor.registerScanlineSegmentIntersection(scanline_linesegment_intersection, scanline_idx);
-                crossings_per_scanline[scanline_idx - min_scanline_index].emplace_back(scanline_linesegment_intersection, poly_idx, point_idx);
-            }
-            zigzag_connector_processor.registerVertex(p1);
-            p0 = p1;
-        }
-        zigzag_connector_processor.registerPolyFinished();
+        crossings_on_line[poly_idx].resize(outline[poly_idx].size()); //One for each line in this polygon.
+    }
+    //Only connectLines needs the crossings per scanline, so the kernel without them is a separate instantiation without the bookkeeping.
+    if (zig_zaggify)
+    {
+        scanOutline<true>(outline, shift, line_distance, scanline_min_idx, min_scanline_index, cut_list, crossings_per_scanline, zigzag_connector_processor);
+    }
+    else
+    {
+        scanOutline<false>(outline, shift, line_distance, scanline_min_idx, min_scanline_index, cut_list, crossings_per_scanline, zigzag_connector_processor);
     }
     
     //Gather all crossings per scanline and find out which crossings belong together, then store them in crossings_on_line.
-    for (int scanline_index = min_scanline_index; scanline_index < max_scanline_index; scanline_index++)
+    //Only connectLines uses them, which only happens when zig-zaggifying.
+    for (int scanline_index = min_scanline_index; zig_zaggify && scanline_index < max_scanline_index; scanline_index++)
     {
         std::sort(crossings_per_scanline[scanline_index - min_scanline_index].begin(), crossings_per_scanline[scanline_index - min_scanline_index].end()); //Sorts them by Y coordinate.
         for (long crossing_index = 0; crossing_index < static_cast<long>(crossings_per_scanline[scanline_index - min_scanline_index].size()) - 1; crossing_index += 2) //Combine each 2 subsequent crossings together.
@@ -636,7 +778,8 @@ void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& resul
             {
                 continue;
             }
-            InfillLineSegment* new_segment = new InfillLineSegment(unrotated_first, first.vertex_index, first.polygon_index, unrotated_second, second.vertex_index, second.polygon_index);
+            line_segments.emplace_back(unrotated_first, first.vertex_index, first.polygon_index, unrotated_second, second.vertex_index, second.polygon_index);
+            InfillLineSegment* new_segment = &line_segments.back();
             //Put the same line segment in the data structure twice: Once for each of the polygon line segment that it crosses.
             crossings_on_line[first.polygon_index][first.vertex_index].push_back(new_segment);
             crossings_on_line[second.polygon_index][second.vertex_index].push_back(new_segment);
@@ -657,8 +800,7 @@ void Infill::generateLinearBasedInfill(const int outline_offset, Polygons& resul
 
 void Infill::connectLines(Polygons& result_lines)
 {
-    //TODO: We're reconstructing the outline here. We should store it and compute it only once.
-    Polygons outline = in_outline.offset(outline_offset + infill_overlap);
+    const Polygons& outline = getOffsetOutline(outline_offset + infill_overlap);
 
     UnionFind<InfillLineSegment*> connected_lines; //Keeps track of which lines are connected to which.
     for (std::vector<std::vector<InfillLineSegment*>>& crossings_on_polygon : crossings_on_line)
@@ -667,14 +809,16 @@ void Infill::connectLines(Polygons& result_lines)
         {
             for (InfillLineSegment* infill_line : crossings_on_polygon_segment)
             {
-                if (connected_lines.find(infill_line) == (size_t)-1)
+                if (infill_line->handle == (size_t)-1) //Every line is on two polygon line segments, but must only be added once.
                 {
-                    connected_lines.add(infill_line); //Put every line in there as a separate set.
+                    infill_line->handle = connected_lines.add(infill_line); //Put every line in there as a separate set.
                 }
             }
         }
     }
 
+    std::vector<std::pair<coord_t, InfillLineSegment*>> crossings_by_distance; //Reused for sorting the crossings of each polygon line segment.
+
     for (size_t polygon_index = 0; polygon_index < outline.size(); polygon_index++)
     {
         if (outline[polygon_index].empty())
@@ -690,23 +834,27 @@ void Infill::connectLines(Polygons& result_lines)
             Point vertex_after = outline[polygon_index][vertex_index];
 
             //Sort crossings on every line by how far they are from their initial point.
-            struct CompareByDistance
+            //The distances are computed once beforehand rather than in every comparison. Only the distances are compared, so they sort the same way.
+            std::vector<InfillLineSegment*>& crossings = crossings_on_line[polygon_index][vertex_index];
+            if (crossings.size() > 1)
             {
-                CompareByDistance(Point to_point, size_t polygon_index, size_t vertex_index): to_point(to_point), polygon_index(polygon_index), vertex_index(vertex_index) {};
-                Point to_point; //The distance to this point is compared.
-                size_t polygon_index; //The polygon which the vertex_index belongs to.
-                size_t vertex_index; //The vertex indicating a line segment. This determines which endpoint of each line should be used.
-                inline bool operator ()(InfillLineSegment*& left_hand_side, InfillLineSegment*& right_hand_side) const
+                crossings_by_distance.clear();
+                for (InfillLineSegment* crossing : crossings)
                 {
-                    //Find the two endpoints that are relevant.
-                    const Point left_hand_point = (left_hand_side->start_segment == vertex_index && left_hand_side->start_polygon == polygon_index) ? left_hand_side->start : left_hand_side->end;
-                    const Point right_hand_point = (right_hand_side->start_segment == vertex_index && right_hand_side->start_polygon == polygon_index) ? right_hand_side->start : right_hand_side->end;
-                    return vSize(left_hand_point - to_point) < vSize(right_hand_point - to_point);
+                    const Point crossing_point = (crossing->start_segment == vertex_index && crossing->start_polygon == polygon_index) ? crossing->start : crossing->end;
+                    crossings_by_distance.emplace_back(vSize(crossing_point - vertex_before), crossing);
                 }
-            };
-            std::sort(crossings_on_line[polygon_index][vertex_index].begin(), crossings_on_line[polygon_index][vertex_index].end(), CompareByDistance(vertex_before, polygon_index, vertex_index));
+                std::sort(crossings_by_distance.begin(), crossings_by_distance.end(), [](const std::pair<coord_t, InfillLineSegment*>& left_hand_side, const std::pair<coord_t, InfillLineSegment*>& right_hand_side)
+                {
+                    return left_hand_side.first < right_hand_side.first;
+                });
+                for (size_t crossing_index = 0; crossing_index < crossings.size(); crossing_index++)
+                {
+                    crossings[crossing_index] = crossings_by_distance[crossing_index].second;
+                }
+            }
 
-            for (InfillLineSegment* crossing : crossings_on_line[polygon_index][vertex_index])
+            for (InfillLineSegment* crossing : crossings)
             {
                 if (!previous_crossing) //If we're not yet drawing, then we have been trying to find the next vertex. We found it! Let's start drawing.
                 {
@@ -715,9 +863,9 @@ void Infill::connectLines(Polygons& result_lines)
                 }
                 else
                 {
-                    const size_t crossing_handle = connected_lines.find(crossing);
+                    const size_t crossing_handle = connected_lines.findByHandle(crossing->handle);
                     assert (crossing_handle != (size_t)-1);
-                    const size_t previous_crossing_handle = connected_lines.find(previous_crossing);
+                    const size_t previous_crossing_handle = connected_lines.findByHandle(previous_crossing->handle);
                     assert (previous_crossing_handle != (size_t)-1);
                     if (crossing_handle == previous_crossing_handle) //These two infill lines are already connected. Don't create a loop now. Continue connecting with the next crossing.
                     {
@@ -744,7 +892,8 @@ void Infill::connectLines(Polygons& result_lines)
                     }
                     else
                     {
-                        new_segment = new InfillLineSegment(previous_point, vertex_index, polygon_index, next_point, vertex_index, polygon_index); //A connecting line between them.
+                        line_segments.emplace_back(previous_point, vertex_index, polygon_index, next_point, vertex_index, polygon_index); //A connecting line between them.
+                        new_segment = &line_segments.back();
                         new_segment->previous = previous_segment;
                         if (previous_segment->start_segment == vertex_index && previous_segment->start_polygon == polygon_index)
                         {
@@ -785,7 +934,8 @@ void Infill::connectLines(Polygons& result_lines)
                     }
                     else
                     {
-                        new_segment = new InfillLineSegment(previous_segment->start, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % outline[polygon_index].size(), polygon_index);
+                        line_segments.emplace_back(previous_segment->start, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % outline[polygon_index].size(), polygon_index);
+                        new_segment = &line_segments.back();
                         previous_segment->previous = new_segment;
                         new_segment->previous = previous_segment;
                         previous_segment = new_segment;
@@ -801,7 +951,8 @@ void Infill::connectLines(Polygons& result_lines)
                     }
                     else
                     {
-                        new_segment = new InfillLineSegment(previous_segment->end, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % outline[polygon_index].size(), polygon_index);
+                        line_segments.emplace_back(previous_segment->end, vertex_index, polygon_index, vertex_after, (vertex_index + 1) % outline[polygon_index].size(), polygon_index);
+                        new_segment = &line_segments.back();
                         previous_segment->next = new_segment;
                         new_segment->previous = previous_segment;
                         previous_segment = new_segment;
@@ -814,11 +965,11 @@ void Infill::connectLines(Polygons& result_lines)
     }
 
     //Save all lines, now connected, to the output.
-    std::unordered_set<size_t> completed_groups;
+    std::vector<bool> completed_groups(line_segments.size(), false); //Indexed by handle. No line segment has more than one handle.
     for (InfillLineSegment* infill_line : connected_lines)
     {
-        const size_t group = connected_lines.find(infill_line);
-        if (completed_groups.find(group) != completed_groups.end()) //We already completed this group.
+        const size_t group = connected_lines.findByHandle(infill_line->handle);
+        if (completed_groups[group]) //We already completed this group.
         {
             continue;
         }
@@ -835,23 +986,19 @@ void Infill::connectLines(Polygons& result_lines)
         }
 
         //Now go along the linked list of infill lines and output the infill lines to the actual result.
-        InfillLineSegment* old_line = current_infill_line;
         const Point first_vertex = (!current_infill_line->previous) ? current_infill_line->start : current_infill_line->end;
         previous_vertex =          (!current_infill_line->previous) ? current_infill_line->end : current_infill_line->start;
         current_infill_line = (first_vertex == current_infill_line->start) ? current_infill_line->next : current_infill_line->previous;
         result_lines.addLine(first_vertex, previous_vertex);
-        delete old_line;
         while (current_infill_line)
         {
-            old_line = current_infill_line; //We'll delete this after we've traversed to the next line.
             const Point next_vertex = (previous_vertex == current_infill_line->start) ? current_infill_line->end : current_infill_line->start; //Opposite side of the line.
             current_infill_line =     (previous_vertex == current_infill_line->start) ? current_infill_line->next : current_infill_line->previous;
             result_lines.addLine(previous_vertex, next_vertex);
             previous_vertex = next_vertex;
-            delete old_line;
         }
 
-        completed_groups.insert(group);
+        completed_groups[group] = true;
     }
 }
 
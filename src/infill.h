@@ -4,6 +4,10 @@
 #ifndef INFILL_H
 #define INFILL_H
 
+#include <array>
+#include <deque>
+#include <map>
+
 #include "infill/ZigzagConnectorProcessor.h" //For DEFAULT_MINIMUM_LINE_LENGTH_THRESHOLD.
 #include "settings/EnumSettings.h" //For infill types.
 #include "settings/types/AngleDegrees.h"
@@ -146,6 +150,7 @@ private:
             , end_polygon(end_polygon)
             , previous(nullptr)
             , next(nullptr)
+            , handle(-1)
         {
         };
 
@@ -204,6 +209,12 @@ private:
          */
         InfillLineSegment* next;
 
+        /*!
+         * The handle of this line segment in the union-find structure that
+         * tracks which lines are connected, or -1 if it's not in there (yet).
+         */
+        size_t handle;
+
         /*!
          * Compares two infill line segments for equality.
          *
@@ -220,6 +231,49 @@ private:
      */
     std::vector<std::vector<std::vector<InfillLineSegment*>>> crossings_on_line;
 
+    /*!
+     * Owns all line segments that \ref Infill::crossings_on_line and their
+     * connections point to.
+     *
+     * A deque never moves its elements when growing, so the pointers to them
+     * stay valid. They are all freed at once when the infill is generated.
+     */
+    std::deque<InfillLineSegment> line_segments;
+
+    /*!
+     * The areas within which to generate infill, for each offset from
+     * \ref Infill::in_outline that was needed.
+     *
+     * Patterns with lines in several directions generate them in separate
+     * passes, which all need the same area. Computing it only once also makes
+     * sure that all passes see the same polygons, which
+     * \ref Infill::crossings_on_line relies on.
+     */
+    std::map<coord_t, Polygons> offset_outlines;
+
+    /*!
+     * The areas within which to generate infill, rotated for each offset and
+     * rotation matrix that linear infill was generated with.
+     */
+    std::map<std::pair<coord_t, std::array<double, 4>>, Polygons> rotated_outlines;
+
+    /*!
+     * Get \ref Infill::in_outline offset by some distance, computing it only
+     * the first time that it's needed.
+     * \param offset The distance to offset the outline by.
+     * \return The offset outline.
+     */
+    const Polygons& getOffsetOutline(const coord_t offset);
+
+    /*!
+     * Get \ref Infill::in_outline offset by some distance and rotated,
+     * computing it only the first time that it's needed.
+     * \param offset The distance to offset the outline by.
+     * \param rotation_matrix The rotation to apply after offsetting.
+     * \return The offset and rotated outline.
+     */
+    const Polygons& getRotatedOutline(const coord_t offset, const PointMatrix& rotation_matrix);
+
     /*!
      * Generate gyroid infill
      * \param result (output) The resulting polygons
@@ -343,7 +397,8 @@ private:
      * This function implements the basic functionality of Infill::generateLineInfill (see doc of that function),
      * but makes calls to a ZigzagConnectorProcessor which handles what to do with each line segment - scanline intersection.
      * 
-     * It is called only from Infill::generateLineinfill and Infill::generateZigZagInfill.
+     * It is called only from Infill::generateLineinfill and Infill::generateZigZagInfill, with the type of processor as template
+     * argument so that the calls for each vertex and intersection are inlined.
      * 
      * \param outline_offset An offset from the reference polygon (Infill::in_outline) to get the actual outline within which to generate infill
      * \param[out] result (output) The resulting lines
@@ -353,7 +408,8 @@ private:
      * \param connected_zigzags Whether to connect the endpiece zigzag segments on both sides to the same infill line
      * \param extra_shift extra shift of the scanlines in the direction perpendicular to the fill_angle
      */
-    void generateLinearBasedInfill(const int outline_offset, Polygons& result, const int line_distance, const PointMatrix& rotation_matrix, ZigzagConnectorProcessor& zigzag_connector_processor, const bool connected_zigzags, coord_t extra_shift);
+    template<typename ConnectorProcessor>
+    void generateLinearBasedInfill(const int outline_offset, Polygons& result, const int line_distance, const PointMatrix& rotation_matrix, ConnectorProcessor& zigzag_connector_processor, const bool connected_zigzags, coord_t extra_shift);
 
     /*!
      * 
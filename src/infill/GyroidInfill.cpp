@@ -5,6 +5,7 @@
 #include "../utils/AABB.h"
 #include "../utils/linearAlg2D.h"
 #include "../utils/polygon.h"
+#include "../utils/PolygonsScanlines.h"
 
 namespace cura {
 
@@ -63,6 +64,8 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
             even_line_coords.push_back(even_x_rads / M_PI * pitch);
         }
         const unsigned num_coords = odd_line_coords.size();
+        // all points of the lines lie on horizontal scanlines, so the outline only needs to be tested and clipped between two of them at a time
+        const PolygonsScanlines scanlines(outline, 0, step);
         unsigned num_columns = 0;
         for (coord_t x = (std::floor(aabb.min.X / pitch) - 2.25) * pitch; x <= aabb.max.X + pitch/2; x += pitch/2)
         {
@@ -76,7 +79,7 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                 for (unsigned i = 0; i < num_coords; ++i)
                 {
                     Point current(x + ((num_columns & 1) ? odd_line_coords[i] : even_line_coords[i])/2 + pitch, y + (coord_t)(i * step));
-                    bool current_inside = outline.inside(current, true);
+                    bool current_inside = scanlines.inside(current, true);
                     if (!is_first_point)
                     {
                         if (last_inside && current_inside)
@@ -87,16 +90,15 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                         else if (last_inside != current_inside)
                         {
                             // line hits the boundary, add the part that's inside the boundary
-                            Polygons line;
-                            line.addLine(last, current);
-                            line = outline.intersectionPolyLines(line);
-                            if (line.size() > 0)
+                            const Point inside_end = (last_inside) ? last : current;
+                            Point boundary;
+                            if (scanlines.findFirstCrossing(inside_end, (last_inside) ? current : last, boundary) && boundary != inside_end)
                             {
                                 // some of the line is inside the boundary
-                                result.addLine(line[0][0], line[0][1]);
+                                result.addLine((last_inside) ? last : boundary, (last_inside) ? boundary : current);
                                 if (zig_zaggify)
                                 {
-                                    chain_end[chain_end_index] = line[0][(line[0][0] != last && line[0][0] != current) ? 0 : 1];
+                                    chain_end[chain_end_index] = boundary;
                                     if (++chain_end_index == 2)
                                     {
                                         chains[0].push_back(chain_end[0]);
@@ -154,6 +156,20 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
             even_line_coords.push_back(even_y_rads / M_PI * pitch);
         }
         const unsigned num_coords = odd_line_coords.size();
+        // all points of the lines lie on vertical scanlines, which are made horizontal by swapping X and Y
+        const auto transpose = [](const Point p)
+        {
+            return Point(p.Y, p.X);
+        };
+        Polygons transposed_outline = outline;
+        for (PolygonRef poly : transposed_outline)
+        {
+            for (Point& point : poly)
+            {
+                point = transpose(point);
+            }
+        }
+        const PolygonsScanlines scanlines(transposed_outline, 0, step);
         unsigned num_rows = 0;
         for (coord_t y = (std::floor(aabb.min.Y / pitch) - 1) * pitch; y <= aabb.max.Y + pitch/2; y += pitch/2)
         {
@@ -167,7 +183,7 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                 for (unsigned i = 0; i < num_coords; ++i)
                 {
                     Point current(x + (coord_t)(i * step), y + ((num_rows & 1) ? odd_line_coords[i] : even_line_coords[i])/2);
-                    bool current_inside = outline.inside(current, true);
+                    bool current_inside = scanlines.inside(transpose(current), true);
                     if (!is_first_point)
                     {
                         if (last_inside && current_inside)
@@ -178,16 +194,17 @@ void GyroidInfill::generateTotalGyroidInfill(Polygons& result_lines, bool zig_za
                         else if (last_inside != current_inside)
                         {
                             // line hits the boundary, add the part that's inside the boundary
-                            Polygons line;
-                            line.addLine(last, current);
-                            line = outline.intersectionPolyLines(line);
-                            if (line.size() > 0)
+                            const Point inside_end = (last_inside) ? last : current;
+                            Point boundary;
+                            const bool crosses = scanlines.findFirstCrossing(transpose(inside_end), transpose((last_inside) ? current : last), boundary);
+                            boundary = transpose(boundary);
+                            if (crosses && boundary != inside_end)
                             {
                                 // some of the line is inside the boundary
-                                result.addLine(line[0][0], line[0][1]);
+                                result.addLine((last_inside) ? last : boundary, (last_inside) ? boundary : current);
                                 if (zig_zaggify)
                                 {
-                                    chain_end[chain_end_index] = line[0][(line[0][0] != last && line[0][0] != current) ? 0 : 1];
+                                    chain_end[chain_end_index] = boundary;
                                     if (++chain_end_index == 2)
                                     {
                                         chains[0].push_back(chain_end[0]);
@@ -6,6 +6,11 @@
 #define STB_IMAGE_IMPLEMENTATION // needed in order to enable the implementation of libs/std_image.h
 #include <stb/stb_image.h>
 
+#include <fstream> //To check whether the image exists.
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
 #include "ImageBasedDensityProvider.h"
 #include "SierpinskiFill.h"
 #include "../utils/AABB3D.h"
@@ -16,22 +21,90 @@ namespace cura {
 static constexpr bool diagonal = true;
 static constexpr bool straight = false;
 
-ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename, const AABB model_aabb)
+namespace
+{
+
+std::mutex prefetch_mutex; //!< Protects the prefetched images.
+std::unordered_map<std::string, std::shared_future<std::shared_ptr<const ImageBasedDensityProvider::SummedImage>>> prefetched_images; //!< The images being loaded in the background, by file name.
+
+} //Anonymous namespace.
+
+void ImageBasedDensityProvider::prefetch(const std::string& filename)
 {
+    if (filename.empty() || !std::ifstream(filename.c_str()).good())
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    if (prefetched_images.find(filename) == prefetched_images.end())
+    {
+        prefetched_images.emplace(filename, std::async(std::launch::async, &ImageBasedDensityProvider::loadImage, filename).share());
+    }
+}
+
+void ImageBasedDensityProvider::dropPrefetched()
+{
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    prefetched_images.clear();
+}
+
+std::shared_ptr<const ImageBasedDensityProvider::SummedImage> ImageBasedDensityProvider::loadImage(const std::string& filename)
+{
+    std::shared_ptr<SummedImage> result = std::make_shared<SummedImage>();
     int desired_channel_count = 0; // keep original amount of channels
     int img_x, img_y, img_z; // stbi requires pointer to int rather than to coord_t
-    image = stbi_load(filename.c_str(), &img_x, &img_y, &img_z, desired_channel_count);
-    image_size = Point3(img_x, img_y, img_z);
+    unsigned char* image = stbi_load(filename.c_str(), &img_x, &img_y, &img_z, desired_channel_count);
     if (!image)
     {
-        const char* reason = "[unknown reason]";
+        result->failure_reason = "[unknown reason]";
         if (stbi_failure_reason())
         {
-            reason = stbi_failure_reason();
+            result->failure_reason = stbi_failure_reason();
+        }
+        return result;
+    }
+    const Point3 image_size(img_x, img_y, img_z);
+    result->size = image_size;
+    { // compute the summed-area table, so that the image itself is no longer needed
+        std::vector<uint64_t>& summed_lightness = result->summed_lightness;
+        const size_t row_size = image_size.x + 1;
+        summed_lightness.assign(row_size * (image_size.y + 1), 0);
+        for (coord_t y = 0; y < image_size.y; y++)
+        {
+            const unsigned char* image_row = image + (image_size.y - 1 - y) * image_size.x * image_size.z; // the rows of the image are stored from the top down
+            uint64_t row_lightness = 0;
+            for (coord_t x = 0; x < image_size.x; x++)
+            {
+                for (coord_t z = 0; z < image_size.z; z++)
+                {
+                    row_lightness += image_row[x * image_size.z + z];
+                }
+                summed_lightness[(y + 1) * row_size + x + 1] = summed_lightness[y * row_size + x + 1] + row_lightness;
+            }
+        }
+    }
+    stbi_image_free(image);
+    return result;
+}
+
+ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename, const AABB model_aabb)
+{
+    std::shared_future<std::shared_ptr<const SummedImage>> prefetched_image;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        const auto it = prefetched_images.find(filename);
+        if (it != prefetched_images.end())
+        {
+            prefetched_image = it->second;
         }
-        logError("Cannot load image %s: '%s'.\n", filename.c_str(), reason);
+    }
+    image = prefetched_image.valid() ? prefetched_image.get() : loadImage(filename);
+    if (!image->failure_reason.empty())
+    {
+        logError("Cannot load image %s: '%s'.\n", filename.c_str(), image->failure_reason.c_str());
         std::exit(-1);
     }
+    image_size = image->size;
     { // compute aabb
         Point middle = model_aabb.getMiddle();
         Point model_aabb_size = model_aabb.max - model_aabb.min;
@@ -55,10 +128,14 @@ ImageBasedDensityProvider::ImageBasedDensityProvider(const std::string filename,
 
 ImageBasedDensityProvider::~ImageBasedDensityProvider()
 {
-    if (image)
-    {
-        stbi_image_free(image);
-    }
+}
+
+uint64_t ImageBasedDensityProvider::getTotalLightness(const coord_t min_x, const coord_t min_y, const coord_t max_x, const coord_t max_y) const
+{
+    const size_t row_size = image_size.x + 1;
+    const std::vector<uint64_t>& summed_lightness = image->summed_lightness;
+    return summed_lightness[(max_y + 1) * row_size + max_x + 1] - summed_lightness[min_y * row_size + max_x + 1]
+        - summed_lightness[(max_y + 1) * row_size + min_x] + summed_lightness[min_y * row_size + min_x];
 }
 
 float ImageBasedDensityProvider::operator()(const AABB3D& query_cube) const
@@ -66,30 +143,24 @@ float ImageBasedDensityProvider::operator()(const AABB3D& query_cube) const
     AABB query_box(Point(query_cube.min.x, query_cube.min.y), Point(query_cube.max.x, query_cube.max.y));
     Point img_min = (query_box.min - print_aabb.min - Point(1,1)) * image_size.x / (print_aabb.max.X - print_aabb.min.X);
     Point img_max = (query_box.max - print_aabb.min + Point(1,1)) * image_size.y / (print_aabb.max.Y - print_aabb.min.Y);
-    long total_lightness = 0;
-    int value_count = 0;
-    for (int x = std::max((coord_t)0, img_min.X); x <= std::min((coord_t)image_size.x - 1, img_max.X); x++)
+    const coord_t min_x = std::max((coord_t)0, img_min.X);
+    const coord_t min_y = std::max((coord_t)0, img_min.Y);
+    const coord_t max_x = std::min((coord_t)image_size.x - 1, img_max.X);
+    const coord_t max_y = std::min((coord_t)image_size.y - 1, img_max.Y);
+    uint64_t total_lightness;
+    coord_t value_count;
+    if (min_x <= max_x && min_y <= max_y)
     {
-        for (int y = std::max((coord_t)0, img_min.Y); y <= std::min((coord_t)image_size.y - 1, img_max.Y); y++)
-        {
-            for (int z = 0; z < image_size.z; z++)
-            {
-                total_lightness += image[((image_size.y - 1 - y) * image_size.x + x) * image_size.z + z];
-                value_count++;
-            }
-        }
+        total_lightness = getTotalLightness(min_x, min_y, max_x, max_y);
+        value_count = (max_x - min_x + 1) * (max_y - min_y + 1) * image_size.z;
     }
-    if (value_count == 0)
+    else
     { // triangle falls outside of image or in between pixels, so we return the closest pixel
         Point closest_pixel = (img_min + img_max) / 2;
         closest_pixel.X = std::max((coord_t)0, std::min((coord_t)image_size.x - 1, (coord_t)closest_pixel.X));
         closest_pixel.Y = std::max((coord_t)0, std::min((coord_t)image_size.y - 1, (coord_t)closest_pixel.Y));
-        assert(total_lightness == 0);
-        for (int z = 0; z < image_size.z; z++)
-        {
-            total_lightness += image[((image_size.y - 1 - closest_pixel.Y) * image_size.x + closest_pixel.X) * image_size.z + z];
-            value_count++;
-        }
+        total_lightness = getTotalLightness(closest_pixel.X, closest_pixel.Y, closest_pixel.X, closest_pixel.Y);
+        value_count = image_size.z;
     }
     return 1.0f - ((float)total_lightness) / value_count / 255.0f;
 };
@@ -5,6 +5,11 @@
 #ifndef INFILL_IMAGE_BASED_DENSITY_PROVIDER_H
 #define INFILL_IMAGE_BASED_DENSITY_PROVIDER_H
 
+#include <cstdint>
+#include <memory> //For shared_ptr.
+#include <string>
+#include <vector>
+
 #include "../utils/AABB.h"
 
 #include "DensityProvider.h"
@@ -17,15 +22,87 @@ struct AABB3D;
 class ImageBasedDensityProvider : public DensityProvider
 {
 public:
+    /*!
+     * \brief Make a density provider from an image.
+     *
+     * If the image was prefetched, this waits for it to be loaded instead of
+     * loading it again.
+     * \param filename The file of the image.
+     * \param aabb The area of the print to stretch the image over.
+     */
     ImageBasedDensityProvider(const std::string filename, const AABB aabb);
 
     virtual ~ImageBasedDensityProvider();
 
+    /*!
+     * \brief Start loading an image in the background.
+     *
+     * Decoding an image and computing its summed-area table takes a while for
+     * big images, so this is started before slicing the meshes. The density
+     * providers that are made of the image afterwards wait for it to be
+     * loaded. Files that don't exist are skipped, so that the error is
+     * reported where the image is used.
+     * \param filename The file of the image.
+     */
+    static void prefetch(const std::string& filename);
+
+    /*!
+     * \brief Forget the images that were prefetched, once all density
+     * providers that need them are made.
+     *
+     * This waits for the images that are still being loaded.
+     */
+    static void dropPrefetched();
+
+    /*!
+     * \brief The density of the image in the area of a box, averaged over the
+     * pixels and channels in it.
+     *
+     * Each query takes constant time and only reads data that was computed
+     * when loading the image, so it may be called from multiple threads at
+     * the same time.
+     */
     virtual float operator()(const AABB3D& aabb) const;
 
+    /*!
+     * \brief The pixels of an image as far as the density provider needs them.
+     */
+    struct SummedImage
+    {
+        Point3 size; //!< dimensions of the image. Third dimension is the amount of channels.
+
+        /*!
+         * \brief Summed-area table of the image: for each X from 0 to the image
+         * width and each Y from 0 to the image height, the sum of all channels
+         * of the pixels with lower X and lower Y, in rows of increasing Y.
+         *
+         * Y is counted from the bottom of the image.
+         */
+        std::vector<uint64_t> summed_lightness;
+
+        std::string failure_reason; //!< Why the image couldn't be loaded, or empty if it was loaded.
+    };
+
 protected:
+    /*!
+     * \brief Decode an image and compute its summed-area table.
+     * \param filename The file of the image.
+     */
+    static std::shared_ptr<const SummedImage> loadImage(const std::string& filename);
+
+    /*!
+     * \brief The sum of all channels of the pixels in a rectangle of the image.
+     *
+     * \param min_x The lowest pixel column in the rectangle.
+     * \param min_y The lowest pixel row in the rectangle, counted from the
+     * bottom of the image.
+     * \param max_x The highest pixel column in the rectangle.
+     * \param max_y The highest pixel row in the rectangle.
+     */
+    uint64_t getTotalLightness(const coord_t min_x, const coord_t min_y, const coord_t max_x, const coord_t max_y) const;
+
+    std::shared_ptr<const SummedImage> image; //!< The image, which may be shared with other density providers.
     Point3 image_size; //!< dimensions of the image. Third dimension is the amount of channels.
-    unsigned char* image = nullptr; //!< image data: rows of channel data per pixel.
 
     AABB print_aabb; //!< bounding box of print coordinates in which to apply the image
 };
@@ -4,29 +4,40 @@
 #ifndef INFILL_NO_ZIGZAG_CONNECTOR_PROCESSOR_H
 #define INFILL_NO_ZIGZAG_CONNECTOR_PROCESSOR_H
 
-#include "ZigzagConnectorProcessor.h"
+#include "../utils/IntPoint.h"
 
 namespace cura
 {
 
-class Polygons;
-
 /*!
  * This processor adds no connection. This is for line infill pattern.
+ *
+ * It has the same functions as ZigzagConnectorProcessor, which
+ * Infill::generateLinearBasedInfill is templated on, so that these calls
+ * compile to nothing.
  */
-class NoZigZagConnectorProcessor : public ZigzagConnectorProcessor
+class NoZigZagConnectorProcessor
 {
 public:
-    NoZigZagConnectorProcessor(const PointMatrix& rotation_matrix, Polygons& result)
-    : ZigzagConnectorProcessor(rotation_matrix, result,
-        false, false, // settings for zig-zag end pieces, no use here
-        false, 0) // settings for skipping some zags, no use here
+    void reserve(const size_t)
     {
+        //No need to allocate anything.
     }
 
-    void registerVertex(const Point& vertex);
-    void registerScanlineSegmentIntersection(const Point& intersection, int scanline_index);
-    void registerPolyFinished();
+    void registerVertex(const Point&)
+    {
+        //No need to add anything.
+    }
+
+    void registerScanlineSegmentIntersection(const Point&, int)
+    {
+        //No need to add anything.
+    }
+
+    void registerPolyFinished()
+    {
+        //No need to add anything.
+    }
 };
 
 
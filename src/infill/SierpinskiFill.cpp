@@ -25,6 +25,8 @@ static constexpr float allowed_length_error = .01;
 
 static constexpr bool deep_debug_checking = false;
 
+static constexpr size_t parallel_subtree_count = 64; //!< The minimum number of subtrees to build in parallel, enough to balance them over the threads.
+
 SierpinskiFill::SierpinskiFill(const DensityProvider& density_provider, const AABB aabb, int max_depth, const coord_t line_width, bool dithering)
 : dithering(dithering)
 , constraint_error_diffusion(dithering)
@@ -66,52 +68,89 @@ void SierpinskiFill::createTree()
     int root_depth = 1;
     root.children.emplace_back(rb, aabb.min, aabb.max, SierpinskiTriangle::SierpinskiDirection::AC_TO_AB, root_straight_corner_is_left, root_depth);
     root.children.emplace_back(lt, aabb.max, aabb.min, SierpinskiTriangle::SierpinskiDirection::AC_TO_AB, root_straight_corner_is_left, root_depth);
+
+    // create the top levels of the tree first, so that the subtrees below them can be created in parallel
+    std::vector<SierpinskiTriangle*> subtree_roots;
     for (SierpinskiTriangle& triangle : root.children)
     {
-        createTree(triangle);
+        subtree_roots.push_back(&triangle);
     }
+    while (subtree_roots.size() < parallel_subtree_count && subtree_roots.front()->depth < max_depth)
+    {
+        std::vector<SierpinskiTriangle*> next_subtree_roots;
+        for (SierpinskiTriangle* sub_root : subtree_roots)
+        {
+            createChildren(*sub_root);
+            for (SierpinskiTriangle& child : sub_root->children)
+            {
+                next_subtree_roots.push_back(&child);
+            }
+        }
+        subtree_roots.swap(next_subtree_roots);
+    }
+    const int subtree_depth = subtree_roots.front()->depth;
 
-    // calculate node statistics
-    createTreeStatistics(root);
+    // each subtree only reads the density provider and writes its own nodes
+#pragma omp parallel for shared(subtree_roots) schedule(dynamic)
+    for (int subtree_idx = 0; subtree_idx < static_cast<int>(subtree_roots.size()); subtree_idx++)
+    {
+        SierpinskiTriangle& sub_root = *subtree_roots[subtree_idx];
+        createTree(sub_root);
+        createTreeStatistics(sub_root, 0); // only the root is at depth zero, so nothing is skipped
+        createTreeRequestedLengths(sub_root, 0);
+    }
+
+    // calculate node statistics of the top levels
+    createTreeStatistics(root, subtree_depth);
     
-    createTreeRequestedLengths(root);
+    createTreeRequestedLengths(root, subtree_depth);
 }
 
 void SierpinskiFill::createTree(SierpinskiTriangle& sub_root)
 {
     if (sub_root.depth < max_depth) //We need to subdivide.
     {
-        SierpinskiTriangle& t = sub_root;
-        Point middle = (t.a + t.b) / 2;
-        //At each subdivision we divide the triangle in two.
-        //Figure out which sort of triangle each child will be:
-        SierpinskiTriangle::SierpinskiDirection first_dir, second_dir;
-        switch(t.dir)
-        {
-            default:
-            case SierpinskiTriangle::SierpinskiDirection::AB_TO_BC:
-                first_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_BC;
-                second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_AB;
-                break;
-            case SierpinskiTriangle::SierpinskiDirection::AC_TO_AB:
-                first_dir = SierpinskiTriangle::SierpinskiDirection::AB_TO_BC;
-                second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_BC;
-                break;
-            case SierpinskiTriangle::SierpinskiDirection::AC_TO_BC:
-                first_dir = SierpinskiTriangle::SierpinskiDirection::AB_TO_BC;
-                second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_AB;
-                break;
-        }
-        sub_root.children.emplace_back(middle, t.a, t.straight_corner, first_dir, !t.straight_corner_is_left, t.depth + 1);
-        sub_root.children.emplace_back(middle, t.straight_corner, t.b, second_dir, !t.straight_corner_is_left, t.depth + 1);
-        for (SierpinskiTriangle& child : t.children)
+        createChildren(sub_root);
+        for (SierpinskiTriangle& child : sub_root.children)
         {
             createTree(child);
         }
     }
 }
-void SierpinskiFill::createTreeStatistics(SierpinskiTriangle& triangle)
+
+void SierpinskiFill::createChildren(SierpinskiTriangle& sub_root)
+{
+    SierpinskiTriangle& t = sub_root;
+    Point middle = (t.a + t.b) / 2;
+    //At each subdivision we divide the triangle in two.
+    //Figure out which sort of triangle each child will be:
+    SierpinskiTriangle::SierpinskiDirection first_dir, second_dir;
+    switch(t.dir)
+    {
+        default:
+        case SierpinskiTriangle::SierpinskiDirection::AB_TO_BC:
+            first_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_BC;
+            second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_AB;
+            break;
+        case SierpinskiTriangle::SierpinskiDirection::AC_TO_AB:
+            first_dir = SierpinskiTriangle::SierpinskiDirection::AB_TO_BC;
+            second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_BC;
+            break;
+        case SierpinskiTriangle::SierpinskiDirection::AC_TO_BC:
+            first_dir = SierpinskiTriangle::SierpinskiDirection::AB_TO_BC;
+            second_dir = SierpinskiTriangle::SierpinskiDirection::AC_TO_AB;
+            break;
+    }
+    sub_root.children.emplace_back(middle, t.a, t.straight_corner, first_dir, !t.straight_corner_is_left, t.depth + 1);
+    sub_root.children.emplace_back(middle, t.straight_corner, t.b, second_dir, !t.straight_corner_is_left, t.depth + 1);
+}
+
+void SierpinskiFill::createTreeStatistics(SierpinskiTriangle& triangle, const int done_depth)
 {
+    if (triangle.depth == done_depth)
+    {
+        return;
+    }
     Point ac = triangle.straight_corner - triangle.a;
     float area = 0.5 * INT2MM2(vSize2(ac));
     float short_length = .5 * vSizeMM(ac);
@@ -120,13 +159,17 @@ void SierpinskiFill::createTreeStatistics(SierpinskiTriangle& triangle)
     triangle.realized_length = (triangle.dir == SierpinskiTriangle::SierpinskiDirection::AC_TO_BC)? long_length : short_length;
     for (SierpinskiTriangle& child : triangle.children)
     {
-        createTreeStatistics(child);
+        createTreeStatistics(child, done_depth);
     }
 }
 
 
-void SierpinskiFill::createTreeRequestedLengths(SierpinskiTriangle& triangle)
+void SierpinskiFill::createTreeRequestedLengths(SierpinskiTriangle& triangle, const int done_depth)
 {
+    if (triangle.depth == done_depth)
+    {
+        return;
+    }
     if (triangle.children.empty())
     { // set requested_length of leaves
         AABB triangle_aabb;
@@ -141,7 +184,7 @@ void SierpinskiFill::createTreeRequestedLengths(SierpinskiTriangle& triangle)
     { // bubble total up requested_length and total_child_realized_length
         for (SierpinskiTriangle& child : triangle.children)
         {
-            createTreeRequestedLengths(child);
+            createTreeRequestedLengths(child, done_depth);
             
             triangle.requested_length += child.requested_length;
             triangle.total_child_realized_length += child.realized_length;
@@ -345,14 +345,21 @@ protected:
     //! Calculate the direction, orientation and vertices of all nodes in the subtree below this \p sub_root.
     void createTree(SierpinskiTriangle& sub_root);
 
-    //! Calculate the area and realized length of all nodes in the subtree below this \p sub_root.
-    void createTreeStatistics(SierpinskiTriangle& sub_root);
+    //! Create the two children of \p sub_root, without subdividing them further.
+    void createChildren(SierpinskiTriangle& sub_root);
+
+    /*!
+     * Calculate the area and realized length of all nodes in the subtree below this \p sub_root.
+     * \param done_depth Subtrees of which the root is at this depth have already been calculated and are skipped.
+     */
+    void createTreeStatistics(SierpinskiTriangle& sub_root, const int done_depth);
 
     /*!
      * Calculate the requested length of all nodes in the subtree below this \p sub_root from their children.
      * For root nodes, retrieve the requested length from the \ref density_provider.
+     * \param done_depth Subtrees of which the root is at this depth have already been calculated and are skipped.
      */
-    void createTreeRequestedLengths(SierpinskiTriangle& sub_root);
+    void createTreeRequestedLengths(SierpinskiTriangle& sub_root, const int done_depth);
 
 
     /*!
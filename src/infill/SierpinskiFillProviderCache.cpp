@@ -0,0 +1,114 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <fstream>
+#include <functional>
+
+#include "SierpinskiFillProvider.h"
+#include "SierpinskiFillProviderCache.h"
+#include "../Application.h" //To see whether the engine keeps warm state.
+#include "../utils/logoutput.h"
+#include "../utils/math.h" //For hash_combine.
+
+namespace cura
+{
+
+SierpinskiFillProviderCache& SierpinskiFillProviderCache::getInstance()
+{
+    static SierpinskiFillProviderCache instance;
+    return instance;
+}
+
+void SierpinskiFillProviderCache::beginSlice()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::unordered_multimap<uint64_t, Entry>::iterator entry = entries.begin(); entry != entries.end();)
+    {
+        if (entry->second.used)
+        {
+            entry->second.used = false;
+            entry++;
+        }
+        else
+        {
+            entry = entries.erase(entry);
+        }
+    }
+}
+
+std::shared_ptr<const SierpinskiFillProvider> SierpinskiFillProviderCache::get(const AABB3D& aabb_3d, const coord_t min_line_distance, const coord_t line_width, const std::string& density_image)
+{
+    const std::function<SierpinskiFillProvider* ()> build = [&]()
+    {
+        if (density_image.empty())
+        {
+            return new SierpinskiFillProvider(aabb_3d, min_line_distance, line_width);
+        }
+        return new SierpinskiFillProvider(aabb_3d, min_line_distance, line_width, density_image);
+    };
+    if (!Application::getInstance().keep_warm_state)
+    {
+        return std::shared_ptr<const SierpinskiFillProvider>(build());
+    }
+
+    const uint64_t density_image_hash = hashFile(density_image);
+    uint64_t key = min_line_distance;
+    hash_combine(key, line_width);
+    hash_combine(key, aabb_3d.min.x);
+    hash_combine(key, aabb_3d.min.y);
+    hash_combine(key, aabb_3d.max.x);
+    hash_combine(key, aabb_3d.max.y);
+    hash_combine(key, density_image_hash);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::pair<std::unordered_multimap<uint64_t, Entry>::iterator, std::unordered_multimap<uint64_t, Entry>::iterator> candidates = entries.equal_range(key);
+        for (std::unordered_multimap<uint64_t, Entry>::iterator cached = candidates.first; cached != candidates.second; cached++)
+        {
+            //The fractal is flat, so the height of the bounding box doesn't matter.
+            const Entry& entry = cached->second;
+            if (entry.min_line_distance == min_line_distance && entry.line_width == line_width
+                && entry.aabb_3d.min.x == aabb_3d.min.x && entry.aabb_3d.min.y == aabb_3d.min.y
+                && entry.aabb_3d.max.x == aabb_3d.max.x && entry.aabb_3d.max.y == aabb_3d.max.y
+                && entry.density_image == density_image && entry.density_image_hash == density_image_hash)
+            {
+                log("Reusing the cross fractal from a previous slice.\n");
+                cached->second.used = true;
+                return entry.provider;
+            }
+        }
+    }
+
+    //Build the fractal without holding the lock, since that takes a while.
+    std::shared_ptr<const SierpinskiFillProvider> provider(build());
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.emplace(key, Entry{aabb_3d, min_line_distance, line_width, density_image, density_image_hash, provider, true});
+    return provider;
+}
+
+size_t SierpinskiFillProviderCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+uint64_t SierpinskiFillProviderCache::hashFile(const std::string& file_name)
+{
+    if (file_name.empty())
+    {
+        return 0;
+    }
+    std::ifstream file(file_name.c_str(), std::ios::binary);
+    uint64_t result = 1;
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+    {
+        const std::streamsize read_count = file.gcount();
+        for (std::streamsize i = 0; i < read_count; i++)
+        {
+            hash_combine(result, static_cast<unsigned char>(buffer[i]));
+        }
+    }
+    return result;
+}
+
+} //namespace cura
@@ -0,0 +1,96 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
+#define INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
+
+#include <cstdint> //For uint64_t.
+#include <memory> //For shared_ptr.
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../utils/AABB3D.h"
+#include "../utils/NoCopy.h"
+
+namespace cura
+{
+
+class SierpinskiFillProvider;
+
+/*!
+ * \brief The fractals of the cross infill and cross support of previous
+ * slices.
+ *
+ * Building the fractal of a \ref SierpinskiFillProvider subdivides the whole
+ * bounding box down to the line distance, which takes a noticeable part of a
+ * slice with cross infill. The fractal only depends on the bounding box, the
+ * line distance, the line width and the density image, so a long-running
+ * engine that slices the same model again with other settings can reuse it.
+ *
+ * The fractals are only kept if the engine keeps warm state between slices.
+ * Like the \ref InsetSkinCache, the cache drops the fractals that weren't used
+ * in a slice at the start of the next slice.
+ */
+class SierpinskiFillProviderCache : NoCopy
+{
+public:
+    static SierpinskiFillProviderCache& getInstance();
+
+    /*!
+     * \brief Start a new slice.
+     *
+     * This drops the fractals that weren't used since the previous call.
+     */
+    void beginSlice();
+
+    /*!
+     * \brief Get the fractal for the given parameters, reusing the one of a
+     * previous slice if there is one.
+     *
+     * This may be called from any thread.
+     * \param aabb_3d The bounding box to fill.
+     * \param min_line_distance The line distance at the highest density.
+     * \param line_width The width of the lines.
+     * \param density_image The image that determines the density, or an empty
+     * string for a uniform density.
+     */
+    std::shared_ptr<const SierpinskiFillProvider> get(const AABB3D& aabb_3d, const coord_t min_line_distance, const coord_t line_width, const std::string& density_image);
+
+    /*!
+     * \brief The number of fractals in the cache.
+     */
+    size_t size() const;
+
+private:
+    /*!
+     * \brief A fractal from a previous slice, with the parameters it was built
+     * from.
+     */
+    struct Entry
+    {
+        AABB3D aabb_3d; //!< The bounding box that it fills.
+        coord_t min_line_distance; //!< The line distance at the highest density.
+        coord_t line_width; //!< The width of the lines.
+        std::string density_image; //!< The file name of the density image, if any.
+        uint64_t density_image_hash; //!< The hash of the contents of the density image, in case it was changed.
+        std::shared_ptr<const SierpinskiFillProvider> provider; //!< The fractal.
+        bool used; //!< Whether the fractal was used since the last \ref SierpinskiFillProviderCache::beginSlice.
+    };
+
+    SierpinskiFillProviderCache() = default;
+
+    /*!
+     * \brief Hash the contents of a file.
+     * \param file_name The file to read, or an empty string.
+     * \return The hash, which is 0 for an empty file name.
+     */
+    static uint64_t hashFile(const std::string& file_name);
+
+    mutable std::mutex mutex; //!< Protects the entries, since fractals may be requested from several threads.
+    std::unordered_multimap<uint64_t, Entry> entries; //!< The fractals by the hash of their parameters.
+};
+
+} //namespace cura
+
+#endif //INFILL_SIERPINSKI_FILL_PROVIDER_CACHE_H
@@ -157,12 +157,18 @@ Polygons SpaghettiInfill::getFillingArea(const PolygonsPart& infill_area, const
 
 SpaghettiInfill::InfillPillar::InfillPillar(const SliceMeshStorage& mesh, const PolygonsPart& _top_part, const coord_t layer_height, const coord_t bottom_z)
 : top_part(_top_part) // TODO: prevent copy construction! Is that possible?
+, top_part_aabb(top_part)
 , total_volume_mm3(INT2MM(INT2MM(top_part.area())) * INT2MM(layer_height))
-, connection_inset_dist(mesh.settings.get<AngleDegrees>("spaghetti_max_infill_angle") >= 90 ? MM2INT(500) : (tan(mesh.settings.get<AngleRadians>("spaghetti_max_infill_angle")) * mesh.settings.get<coord_t>("layer_height")))
+, connection_inset_dist(getConnectionInsetDist(mesh))
 , bottom_z(bottom_z)
 {
 }
 
+coord_t SpaghettiInfill::InfillPillar::getConnectionInsetDist(const SliceMeshStorage& mesh)
+{
+    return mesh.settings.get<AngleDegrees>("spaghetti_max_infill_angle") >= 90 ? MM2INT(500) : (tan(mesh.settings.get<AngleRadians>("spaghetti_max_infill_angle")) * mesh.settings.get<coord_t>("layer_height"));
+}
+
 void SpaghettiInfill::InfillPillar::addToTopSliceLayerPart(const coord_t filling_area_inset, const coord_t line_width)
 {
     SliceLayerPart& slice_layer_part = *top_slice_layer_part;
@@ -174,10 +180,13 @@ void SpaghettiInfill::InfillPillar::addToTopSliceLayerPart(const coord_t filling
     slice_layer_part.spaghetti_infill_volumes.emplace_back(filling_area, volume);
 }
 
-bool SpaghettiInfill::InfillPillar::isConnected(const PolygonsPart& infill_part) const
+bool SpaghettiInfill::InfillPillar::isConnected(const Polygons& insetted_infill_part, const AABB& insetted_aabb) const
 {
-    Polygons insetted = infill_part.offset(-connection_inset_dist);
-    if (insetted.intersection(top_part).size() > 0)
+    if (!insetted_aabb.hit(top_part_aabb))
+    { // the bounding boxes don't even overlap, so don't bother intersecting the polygons
+        return false;
+    }
+    if (insetted_infill_part.intersection(top_part).size() > 0)
     {
         return true;
     }
@@ -190,13 +199,18 @@ bool SpaghettiInfill::InfillPillar::isConnected(const PolygonsPart& infill_part)
 SpaghettiInfill::InfillPillar& SpaghettiInfill::addPartToPillarBase(const SliceMeshStorage& mesh, const PolygonsPart& infill_part, std::list<SpaghettiInfill::InfillPillar>& pillar_base, const coord_t layer_height, const coord_t bottom_z)
 {
     std::list<SpaghettiInfill::InfillPillar>::iterator ret = pillar_base.end();
+    //All pillars of a mesh use the same inset, so inset the part only once rather than for every pillar.
+    const Polygons insetted = infill_part.offset(-InfillPillar::getConnectionInsetDist(mesh));
+    const AABB insetted_aabb(insetted);
+    const AABB infill_part_aabb(infill_part);
     for (auto it = pillar_base.begin(); it != pillar_base.end(); ++it)
     {
         InfillPillar& pillar = *it;
-        if (pillar.isConnected(infill_part))
+        if (pillar.isConnected(insetted, insetted_aabb))
         {
             pillar.total_volume_mm3 += INT2MM(INT2MM(infill_part.area())) * INT2MM(layer_height);
             pillar.top_part = infill_part;
+            pillar.top_part_aabb = infill_part_aabb;
             if (ret != pillar_base.end())
             { // connecting two pillars of the layer below via one area on this layer
                 pillar.total_volume_mm3 += ret->total_volume_mm3;
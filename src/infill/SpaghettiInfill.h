@@ -6,6 +6,7 @@
 
 #include <list>
 #include "../settings/types/LayerIndex.h"
+#include "../utils/AABB.h"
 #include "../utils/polygon.h"
 
 namespace cura
@@ -49,6 +50,7 @@ protected:
     public:
         SliceLayerPart* top_slice_layer_part = nullptr; //!< A reference to the slice_layer_part from which the top part is generated
         PolygonsPart top_part; //!< The top area of this pillar
+        AABB top_part_aabb; //!< The bounding box of \ref top_part, to quickly skip areas which can't be connected
         double total_volume_mm3; //!< The total volume of the pillar
         const coord_t connection_inset_dist; //!< Horizontal component of the spaghetti_max_infill_angle: the distance insetted corresponding to the maximum angle which can be filled by spaghetti infill.
         const coord_t bottom_z; //!< The z coordinate of the bottom of the first layer this pillar is present in
@@ -68,10 +70,21 @@ protected:
          * Check whether the top of this pillar is connected (enough) to the given \p infill_part.
          * It is assumed the infill_part is on the layer directly above the top part of this pillar.
          * 
-         * \param infill_part The part to check for connectivity
+         * The infill part is given already insetted by the \ref connection_inset_dist, so that it
+         * needs to be insetted only once when it's checked against many pillars.
+         * 
+         * \param insetted_infill_part The part to check for connectivity, insetted by the \ref connection_inset_dist
+         * \param insetted_aabb The bounding box of \p insetted_infill_part
          * \return Whether the infill part can be incorporated in this pillar
          */
-        bool isConnected(const PolygonsPart& infill_part) const;
+        bool isConnected(const Polygons& insetted_infill_part, const AABB& insetted_aabb) const;
+
+        /*!
+         * Get the distance insetted corresponding to the maximum angle which can be filled by spaghetti infill.
+         * 
+         * \param mesh The mesh that the infill belongs to.
+         */
+        static coord_t getConnectionInsetDist(const SliceMeshStorage& mesh);
 
         /*!
          * Register the volume of this infill pillar in the sliceDataStorage.
@@ -23,17 +23,6 @@ coord_t SubDivCube::radius_addition = 0;
 Point3Matrix SubDivCube::rotation_matrix;
 PointMatrix SubDivCube::infill_rotation_matrix;
 
-SubDivCube::~SubDivCube()
-{
-    for (int child_idx = 0; child_idx < 8; child_idx++)
-    {
-        if (children[child_idx])
-        {
-            delete children[child_idx];
-        }
-    }
-}
-
 void SubDivCube::precomputeOctree(SliceMeshStorage& mesh)
 {
     radius_addition = mesh.settings.get<coord_t>("sub_div_rad_add");
@@ -84,7 +73,7 @@ void SubDivCube::precomputeOctree(SliceMeshStorage& mesh)
     mesh.base_subdiv_cube = new SubDivCube(mesh, center, curr_recursion_depth - 1);
 }
 
-void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result)
+void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result) const
 {
     if (cube_properties_per_recursion_step.empty()) //Infill is set to 0%.
     {
@@ -92,7 +81,18 @@ void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result)
     }
     Polygons directional_line_groups[3];
 
-    generateSubdivisionLines(z, result, directional_line_groups);
+    size_t cube_idx = 0;
+    while (cube_idx < cubes.size())
+    {
+        const Cube& cube = cubes[cube_idx];
+        if (z < cube.min_z || z > cube.max_z) //!< this cube does not touch the target layer, and neither do the cubes inside of it. Skip the whole subtree.
+        {
+            cube_idx = cube.subtree_end;
+            continue;
+        }
+        generateSubdivisionLines(cube, z, directional_line_groups);
+        cube_idx++;
+    }
 
     for (int dir_idx = 0; dir_idx < 3; dir_idx++)
     {
@@ -104,15 +104,12 @@ void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result)
     }
 }
 
-void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result, Polygons (&directional_line_groups)[3])
+void SubDivCube::generateSubdivisionLines(const Cube& cube, const coord_t z, Polygons (&directional_line_groups)[3])
 {
-    CubeProperties cube_properties = cube_properties_per_recursion_step[depth];
+    const CubeProperties& cube_properties = cube_properties_per_recursion_step[cube.depth];
+    const Point3& center = cube.center;
 
     const coord_t z_diff = std::abs(z - center.z); //!< the difference between the cube center and the target layer.
-    if (z_diff > cube_properties.height / 2) //!< this cube does not touch the target layer. Early exit.
-    {
-        return;
-    }
     if (z_diff < cube_properties.max_draw_z_diff) //!< this cube has lines that need to be drawn.
     {
         Point relative_a, relative_b; //!< relative coordinates of line endpoints around cube center
@@ -137,34 +134,41 @@ void SubDivCube::generateSubdivisionLines(const coord_t z, Polygons& result, Pol
             }
         }
     }
-    for (int idx = 0; idx < 8; idx++) //!< draws the eight children
-    {
-        if (children[idx] != nullptr)
-        {
-            children[idx]->generateSubdivisionLines(z, result, directional_line_groups);
-        }
-    }
 }
 
 SubDivCube::SubDivCube(SliceMeshStorage& mesh, Point3& center, size_t depth)
 {
-    this->depth = depth;
-    this->center = center;
+    addCube(mesh, center, depth);
+}
 
-    if (depth == 0) // lowest layer, no need for subdivision, exit.
+void SubDivCube::addCube(SliceMeshStorage& mesh, const Point3& center, const size_t depth)
+{
+    const size_t cube_idx = cubes.size();
+    cubes.emplace_back();
+    cubes[cube_idx].center = center;
+    cubes[cube_idx].depth = depth;
+    cubes[cube_idx].subtree_end = cube_idx + 1;
+
+    if (depth >= cube_properties_per_recursion_step.size()) //Depth is out of bounds of what we pre-computed.
     {
+        //Never drawn. Only happens when infill is set to 0%, in which case nothing is generated at all.
+        cubes[cube_idx].min_z = center.z;
+        cubes[cube_idx].max_z = center.z;
         return;
     }
-    if (depth >= cube_properties_per_recursion_step.size()) //Depth is out of bounds of what we pre-computed.
+
+    const CubeProperties& cube_properties = cube_properties_per_recursion_step[depth];
+    cubes[cube_idx].min_z = center.z - cube_properties.height / 2;
+    cubes[cube_idx].max_z = center.z + cube_properties.height / 2;
+
+    if (depth == 0) // lowest layer, no need for subdivision, exit.
     {
         return;
     }
 
-    CubeProperties cube_properties = cube_properties_per_recursion_step[depth];
     Point3 child_center;
     coord_t radius = double(cube_properties.height) / 4.0 + radius_addition;
 
-    int child_nr = 0;
     std::vector<Point3> rel_child_centers;
     rel_child_centers.emplace_back(1, 1, 1); // top
     rel_child_centers.emplace_back(-1, 1, 1); // top three
@@ -179,10 +183,10 @@ SubDivCube::SubDivCube(SliceMeshStorage& mesh, Point3& center, size_t depth)
         child_center = center + rotation_matrix.apply(rel_child_center * int32_t(cube_properties.side_length / 4));
         if (isValidSubdivision(mesh, child_center, radius))
         {
-            children[child_nr] = new SubDivCube(mesh, child_center, depth - 1);
-            child_nr++;
+            addCube(mesh, child_center, depth - 1);
         }
     }
+    cubes[cube_idx].subtree_end = cubes.size();
 }
 
 bool SubDivCube::isValidSubdivision(SliceMeshStorage& mesh, Point3& center, coord_t radius)
@@ -230,7 +234,7 @@ coord_t SubDivCube::distanceFromPointToMesh(SliceMeshStorage& mesh, const LayerI
         return 2;
         *distance2 = 0;
     }
-    Polygons& collide = mesh.layers[layer_nr].getInnermostWalls(2, mesh);
+    const Polygons& collide = mesh.layers[layer_nr].getInnermostWalls(2, mesh);
     Point centerpoint = location;
     bool inside = collide.inside(centerpoint);
     ClosestPolygonPoint border_point = PolygonUtils::moveInside2(collide, centerpoint);
@@ -4,6 +4,8 @@
 #ifndef INFILL_SUBDIVCUBE_H
 #define INFILL_SUBDIVCUBE_H
 
+#include <vector>
+
 #include "../settings/types/Ratio.h"
 #include "../utils/IntPoint.h"
 #include "../utils/Point3.h"
@@ -19,15 +21,13 @@ class SubDivCube
 {
 public:
     /*!
-     * Constructor for SubDivCube. Recursively calls itself eight times to flesh out the octree.
+     * Constructor for SubDivCube. Builds the whole octree below the cube, flattened into #cubes.
      * \param mesh contains infill layer data and settings
      * \param my_center the center of the cube
      * \param depth the recursion depth of the cube (0 is most recursed)
      */
     SubDivCube(SliceMeshStorage& mesh, Point3& center, size_t depth);
 
-    ~SubDivCube(); //!< destructor (also destroys children)
-
     /*!
      * Precompute the octree of subdivided cubes
      * \param mesh contains infill layer data and settings
@@ -35,19 +35,41 @@ public:
     static void precomputeOctree(SliceMeshStorage& mesh);
 
     /*!
-     * Generates the lines of subdivision of the specific cube at the specific layer. It recursively calls itself, so it ends up drawing all the subdivision lines of sub-cubes too.
+     * Generates the lines of subdivision of the octree at the specific layer. Only the subtrees of the cubes that touch the layer are visited.
+     * This doesn't change the octree, so it can be called for multiple layers at the same time.
      * \param z the specified layer height
      * \param result (output) The resulting lines
      */
-    void generateSubdivisionLines(const coord_t z, Polygons& result);
+    void generateSubdivisionLines(const coord_t z, Polygons& result) const;
+
 private:
     /*!
-     * Generates the lines of subdivision of the specific cube at the specific layer. It recursively calls itself, so it ends up drawing all the subdivision lines of sub-cubes too.
+     * One cube of the octree, in the flattened octree #cubes.
+     */
+    struct Cube
+    {
+        Point3 center; //!< center location of the cube in absolute coordinates
+        size_t depth; //!< the recursion depth of the cube (0 is most recursed)
+        coord_t min_z; //!< the lowest layer height that the cube touches
+        coord_t max_z; //!< the highest layer height that the cube touches
+        size_t subtree_end; //!< the index in #cubes right after the last cube of the subtree of this cube
+    };
+
+    /*!
+     * Adds a cube and its subtree to the flattened octree. Recursively calls itself for the eight potential children.
+     * \param mesh contains infill layer data and settings
+     * \param center the center of the cube
+     * \param depth the recursion depth of the cube (0 is most recursed)
+     */
+    void addCube(SliceMeshStorage& mesh, const Point3& center, const size_t depth);
+
+    /*!
+     * Generates the lines of subdivision of a cube at the specific layer, if it has any there.
+     * \param cube the cube to draw
      * \param z the specified layer height
-     * \param result (output) The resulting lines
      * \param directional_line_groups Array of 3 times a polylines. Used to keep track of line segments that are all pointing the same direction for line segment combining
      */
-    void generateSubdivisionLines(const coord_t z, Polygons& result, Polygons (&directional_line_groups)[3]);
+    static void generateSubdivisionLines(const Cube& cube, const coord_t z, Polygons (&directional_line_groups)[3]);
 
     struct CubeProperties
     {
@@ -95,11 +117,14 @@ private:
      * \param from the first endpoint of the line
      * \param to the second endpoint of the line
      */
-    void addLineAndCombine(Polygons& group, Point from, Point to);
+    static void addLineAndCombine(Polygons& group, Point from, Point to);
+
+    /*!
+     * The octree, flattened in depth-first order: each cube is followed by the cubes of its subtree.
+     * With the fixed order of the children this is the Morton order of the octree, so the cubes of a subtree are together in memory and a subtree that doesn't touch a layer is skipped at once.
+     */
+    std::vector<Cube> cubes;
 
-    size_t depth; //!< the recursion depth of the cube (0 is most recursed)
-    Point3 center; //!< center location of the cube in absolute coordinates
-    SubDivCube* children[8] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr}; //!< pointers to this cube's eight octree children
     static std::vector<CubeProperties> cube_properties_per_recursion_step; //!< precomputed array of basic properties of cubes based on recursion depth.
     static Ratio radius_multiplier; //!< multiplier for the bounding radius when determining if a cube should be subdivided
     static Point3Matrix rotation_matrix; //!< The rotation matrix to get from axis aligned cubes to cubes standing on a corner point aligned with the infill_angle
@@ -4,19 +4,6 @@
 using namespace cura;
 
 
-void ZigzagConnectorProcessor::registerVertex(const Point& vertex)
-{
-    if (is_first_connector)
-    {
-        first_connector.push_back(vertex);
-    }
-    else
-    { // it's yet unclear whether the polygon segment should be included, so we store it until we know
-        current_connector.push_back(vertex);
-    }
-}
-
-
 bool ZigzagConnectorProcessor::shouldAddCurrentConnector(int start_scanline_idx, int end_scanline_idx) const
 {
     int direction = end_scanline_idx - start_scanline_idx;
@@ -131,14 +131,18 @@ public:
     , minimum_zag_line_length(minimum_zag_line_length)
     {}
 
-    virtual ~ZigzagConnectorProcessor()
-    {}
+    /*!
+     * Allocate room for the connectors up front.
+     * \param max_polygon_size The number of vertices of the largest polygon
+     * that will be processed.
+     */
+    void reserve(const size_t max_polygon_size);
 
     /*!
      * Handle the next vertex on the outer boundary.
      * \param vertex The vertex
      */
-    virtual void registerVertex(const Point& vertex);
+    void registerVertex(const Point& vertex);
 
     /*!
      * Handle the next intersection between a scanline and the outer boundary.
@@ -146,13 +150,13 @@ public:
      * \param intersection The intersection
      * \param scanline_index Index of the current scanline
      */
-    virtual void registerScanlineSegmentIntersection(const Point& intersection, int scanline_index);
+    void registerScanlineSegmentIntersection(const Point& intersection, int scanline_index);
 
     /*!
      * Handle the end of a polygon and prepare for the next.
      * This function should reset all member variables.
      */
-    virtual void registerPolyFinished();
+    void registerPolyFinished();
 
 protected:
     /*!
@@ -228,6 +232,25 @@ protected:
 // Inline functions
 //
 
+inline void ZigzagConnectorProcessor::reserve(const size_t max_polygon_size)
+{
+    //A connector has at most all vertices of the polygon, the first one twice, and a scanline intersection at each end.
+    first_connector.reserve(max_polygon_size + 3);
+    current_connector.reserve(max_polygon_size + 3);
+}
+
+inline void ZigzagConnectorProcessor::registerVertex(const Point& vertex)
+{
+    if (is_first_connector)
+    {
+        first_connector.push_back(vertex);
+    }
+    else
+    { // it's yet unclear whether the polygon segment should be included, so we store it until we know
+        current_connector.push_back(vertex);
+    }
+}
+
 inline void ZigzagConnectorProcessor::reset()
 {
     is_first_connector = true;
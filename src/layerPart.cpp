@@ -39,20 +39,23 @@ void createLayerWithParts(const Settings& settings, SliceLayer& storageLayer, Sl
     }
 
     std::vector<PolygonsPart> result;
+    std::vector<unsigned int> enclosing_parts; //Keep the nesting that the union finds, so that it doesn't need to be found again later.
     const bool union_layers = settings.get<bool>("meshfix_union_all");
-    result = layer->polygons.splitIntoParts(union_layers || union_all_remove_holes);
+    result = layer->polygons.splitIntoParts(union_layers || union_all_remove_holes, enclosing_parts);
     for(unsigned int i=0; i<result.size(); i++)
     {
         storageLayer.parts.emplace_back();
         storageLayer.parts[i].outline = result[i];
         storageLayer.parts[i].boundaryBox.calculate(storageLayer.parts[i].outline);
+        storageLayer.parts[i].is_enclosed = enclosing_parts[i] != NO_INDEX;
     }
+    storageLayer.indexParts();
 }
 void createLayerParts(SliceMeshStorage& mesh, Slicer* slicer)
 {
     const auto total_layers = slicer->layers.size();
     assert(mesh.layers.size() == total_layers);
-#pragma omp parallel for default(none) shared(mesh, slicer) schedule(dynamic)
+#pragma omp parallel for shared(mesh, slicer) schedule(dynamic)
     // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
     for (int layer_nr = 0; layer_nr < static_cast<int>(total_layers); layer_nr++)
     {
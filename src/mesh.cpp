@@ -1,7 +1,12 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> // min, max
+#include <cstdlib> // abs
+#include <limits> // numeric_limits
+
 #include "mesh.h"
+#include "utils/algorithm.h" //parallelSort
 #include "utils/floatpoint.h"
 #include "utils/logoutput.h"
 
@@ -9,6 +14,7 @@ namespace cura
 {
 
 const int vertex_meld_distance = MM2INT(0.03);
+constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max(); //!< Marks the end of a hash bucket in Mesh::vertex_hash_next.
 /*!
  * returns a hash for the location, but first divides by the vertex_meld_distance,
  * so that any point within a box of vertex_meld_distance by vertex_meld_distance would get mapped to the same hash.
@@ -45,9 +51,72 @@ void Mesh::addFace(Point3& v0, Point3& v1, Point3& v2)
     face.vertex_index[0] = vi0;
     face.vertex_index[1] = vi1;
     face.vertex_index[2] = vi2;
-    vertices[face.vertex_index[0]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[1]].connected_faces.push_back(idx);
-    vertices[face.vertex_index[2]].connected_faces.push_back(idx);
+}
+
+void Mesh::addFaces(const std::vector<Point3>& corners)
+{
+    const size_t corner_count = corners.size() - corners.size() % 3;
+
+    // Sort the corners by position, so that corners at exactly the same position end up next to each other.
+    // Ties are broken by index, so the first corner in each group is the one that occurs first in the mesh.
+    std::vector<uint32_t> order(corner_count);
+    for (size_t corner_idx = 0; corner_idx < corner_count; corner_idx++)
+    {
+        order[corner_idx] = corner_idx;
+    }
+    const auto lessThan = [&corners](const uint32_t a, const uint32_t b)
+    {
+        const Point3& p = corners[a];
+        const Point3& q = corners[b];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        if (p.z != q.z) return p.z < q.z;
+        return a < b;
+    };
+    parallelSort(order, lessThan);
+
+    // For each corner, the first corner at exactly the same position.
+    std::vector<uint32_t> first_occurrence(corner_count);
+    for (size_t sorted_idx = 0; sorted_idx < corner_count; sorted_idx++)
+    {
+        const uint32_t corner_idx = order[sorted_idx];
+        if (sorted_idx > 0 && corners[order[sorted_idx - 1]] == corners[corner_idx])
+        {
+            first_occurrence[corner_idx] = first_occurrence[order[sorted_idx - 1]];
+        }
+        else
+        {
+            first_occurrence[corner_idx] = corner_idx;
+        }
+    }
+    std::vector<uint32_t>().swap(order);
+
+    // Only the first corner at each position needs to be looked up. Identical corners later on would find the same vertex anyway,
+    // since buckets are searched in insertion order and vertices are only appended.
+    std::vector<uint32_t>& vertex_of_corner = first_occurrence; // reuse the memory: first_occurrence[i] <= i, so it's read before it is overwritten
+    vertex_hash_map.reserve(vertex_hash_map.size() + corner_count / 6); // a closed mesh has about half as many vertices as faces
+    vertices.reserve(vertices.size() + corner_count / 6);
+    vertex_hash_next.reserve(vertices.capacity());
+    for (size_t corner_idx = 0; corner_idx < corner_count; corner_idx++)
+    {
+        const uint32_t first = first_occurrence[corner_idx];
+        vertex_of_corner[corner_idx] = (first == corner_idx) ? findIndexOfVertex(corners[corner_idx]) : vertex_of_corner[first];
+    }
+
+    faces.reserve(faces.size() + corner_count / 3);
+    for (size_t corner_idx = 0; corner_idx < corner_count; corner_idx += 3)
+    {
+        const int vi0 = vertex_of_corner[corner_idx];
+        const int vi1 = vertex_of_corner[corner_idx + 1];
+        const int vi2 = vertex_of_corner[corner_idx + 2];
+        if (vi0 == vi1 || vi1 == vi2 || vi0 == vi2) continue; // the face has two vertices which get assigned the same location. Don't add the face.
+
+        faces.emplace_back();
+        MeshFace& face = faces.back();
+        face.vertex_index[0] = vi0;
+        face.vertex_index[1] = vi1;
+        face.vertex_index[2] = vi2;
+    }
 }
 
 void Mesh::clear()
@@ -55,12 +124,40 @@ void Mesh::clear()
     faces.clear();
     vertices.clear();
     vertex_hash_map.clear();
+    vertex_hash_next.clear();
+    connected_faces_start.clear();
+    connected_faces.clear();
 }
 
 void Mesh::finish()
 {
     // Finish up the mesh, clear the vertex_hash_map, as it's no longer needed from this point on and uses quite a bit of memory.
-    vertex_hash_map.clear();
+    std::unordered_map<uint32_t, uint32_t>().swap(vertex_hash_map);
+    std::vector<uint32_t>().swap(vertex_hash_next);
+
+    // Store which faces are connected to each vertex, in two flat arrays rather than a list per vertex.
+    // First count the faces per vertex, then use the running total as the start of each vertex' range.
+    connected_faces_start.assign(vertices.size() + 1, 0);
+    for (const MeshFace& face : faces)
+    {
+        for (const int vertex_idx : face.vertex_index)
+        {
+            connected_faces_start[vertex_idx + 1]++;
+        }
+    }
+    for (size_t vertex_idx = 0; vertex_idx < vertices.size(); vertex_idx++)
+    {
+        connected_faces_start[vertex_idx + 1] += connected_faces_start[vertex_idx];
+    }
+    connected_faces.resize(connected_faces_start.back());
+    std::vector<uint32_t> fill_position(connected_faces_start.begin(), connected_faces_start.end() - 1);
+    for (size_t face_idx = 0; face_idx < faces.size(); face_idx++) // in order of the faces, so that each range is sorted by face index
+    {
+        for (const int vertex_idx : faces[face_idx].vertex_index)
+        {
+            connected_faces[fill_position[vertex_idx]++] = face_idx;
+        }
+    }
 
     // For each face, store which other face is connected with it.
     for(unsigned int i=0; i<faces.size(); i++)
@@ -85,6 +182,35 @@ AABB3D Mesh::getAABB() const
 {
     return aabb;
 }
+
+bool Mesh::isHorizontalCopyOf(const Mesh& other, const coord_t allowed_deviation) const
+{
+    Point3 offset = min() - other.min();
+    offset.z = 0; //Layers are sliced at the same heights, so only horizontal copies are sliced the same.
+    if (vertices.size() != other.vertices.size() || faces.size() != other.faces.size() || !settings.hasSameValues(other.settings))
+    {
+        return false;
+    }
+    for (size_t vertex_idx = 0; vertex_idx < vertices.size(); vertex_idx++)
+    {
+        const Point3 deviation = vertices[vertex_idx].p - (other.vertices[vertex_idx].p + offset);
+        if (std::abs(deviation.x) > allowed_deviation || std::abs(deviation.y) > allowed_deviation || std::abs(deviation.z) > allowed_deviation)
+        {
+            return false;
+        }
+    }
+    for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+    {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            if (faces[face_idx].vertex_index[corner] != other.faces[face_idx].vertex_index[corner])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 void Mesh::expandXY(int64_t offset)
 {
     if (offset)
@@ -93,24 +219,55 @@ void Mesh::expandXY(int64_t offset)
     }
 }
 
+ZIntervalIndex Mesh::getFaceZIndex() const
+{
+    ZIntervalIndex index;
+    index.reserve(faces.size());
+    for (size_t face_idx = 0; face_idx < faces.size(); face_idx++)
+    {
+        const MeshFace& face = faces[face_idx];
+        const coord_t z0 = vertices[face.vertex_index[0]].p.z;
+        const coord_t z1 = vertices[face.vertex_index[1]].p.z;
+        const coord_t z2 = vertices[face.vertex_index[2]].p.z;
+        index.insert(std::min(z0, std::min(z1, z2)), std::max(z0, std::max(z1, z2)), face_idx);
+    }
+    index.finalize();
+    return index;
+}
 
 int Mesh::findIndexOfVertex(const Point3& v)
 {
-    uint32_t hash = pointHash(v);
+    const uint32_t hash = pointHash(v);
 
-    for(unsigned int idx = 0; idx < vertex_hash_map[hash].size(); idx++)
+    uint32_t last_in_bucket = NO_VERTEX;
+    std::unordered_map<uint32_t, uint32_t>::const_iterator bucket = vertex_hash_map.find(hash);
+    if (bucket != vertex_hash_map.end())
     {
-        if ((vertices[vertex_hash_map[hash][idx]].p - v).testLength(vertex_meld_distance))
+        for (uint32_t idx = bucket->second; idx != NO_VERTEX; idx = vertex_hash_next[idx])
         {
-            return vertex_hash_map[hash][idx];
+            if ((vertices[idx].p - v).testLength(vertex_meld_distance))
+            {
+                return idx;
+            }
+            last_in_bucket = idx;
         }
     }
-    vertex_hash_map[hash].push_back(vertices.size());
+
+    const uint32_t new_idx = vertices.size();
+    if (last_in_bucket == NO_VERTEX)
+    {
+        vertex_hash_map.emplace(hash, new_idx);
+    }
+    else
+    {
+        vertex_hash_next[last_in_bucket] = new_idx; // append, so that the bucket is still searched in insertion order
+    }
+    vertex_hash_next.push_back(NO_VERTEX);
     vertices.emplace_back(v);
-    
+
     aabb.include(v);
-    
-    return vertices.size() - 1;
+
+    return new_idx;
 }
 
 /*!
@@ -139,18 +296,39 @@ See <a href="http://stackoverflow.com/questions/14066933/direct-way-of-computing
 */
 int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVertexIdx) const
 {
-    std::vector<int> candidateFaces; // in case more than two faces meet at an edge, multiple candidates are generated
-    for(int f : vertices[idx0].connected_faces) // search through all faces connected to the first vertex and find those that are also connected to the second
+    // search through all faces connected to the first vertex and find those that are also connected to the second
+    const auto isCandidate = [this, idx1, notFaceIdx](const int f)
     {
-        if (f == notFaceIdx)
+        return f != notFaceIdx
+            && (faces[f].vertex_index[0] == idx1 // && faces[f].vertex_index[1] == idx0 // next face should have the right direction!
+             || faces[f].vertex_index[1] == idx1 // && faces[f].vertex_index[2] == idx0
+             || faces[f].vertex_index[2] == idx1 // && faces[f].vertex_index[0] == idx0
+            );
+    };
+    const ConnectedFaces faces_at_idx0 = getConnectedFaces(idx0);
+    size_t candidate_count = 0;
+    int first_candidate = -1;
+    for (const int f : faces_at_idx0)
+    {
+        if (isCandidate(f))
         {
-            continue;
+            if (candidate_count == 0)
+            {
+                first_candidate = f;
+            }
+            candidate_count++;
         }
-        if ( faces[f].vertex_index[0] == idx1 // && faces[f].vertex_index[1] == idx0 // next face should have the right direction!
-          || faces[f].vertex_index[1] == idx1 // && faces[f].vertex_index[2] == idx0
-          || faces[f].vertex_index[2] == idx1 // && faces[f].vertex_index[0] == idx0
-            )  candidateFaces.push_back(f);
+    }
+    if (candidate_count == 1) { return first_candidate; } // the common case for manifold meshes: no need to store the candidates
 
+    std::vector<int> candidateFaces; // in case more than two faces meet at an edge, multiple candidates are generated
+    candidateFaces.reserve(candidate_count);
+    for (const int f : faces_at_idx0)
+    {
+        if (isCandidate(f))
+        {
+            candidateFaces.push_back(f);
+        }
     }
 
     if (candidateFaces.size() == 0)
@@ -163,7 +341,6 @@ int Mesh::getFaceIdxWithPoints(int idx0, int idx1, int notFaceIdx, int notFaceVe
         has_disconnected_faces = true;
         return -1;
     }
-    if (candidateFaces.size() == 1) { return candidateFaces[0]; }
 
 
     if (candidateFaces.size() % 2 == 0)
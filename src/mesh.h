@@ -6,21 +6,21 @@
 
 #include "settings/Settings.h"
 #include "utils/AABB3D.h"
+#include "utils/ZIntervalIndex.h"
 
 namespace cura
 {
 /*!
 Vertex type to be used in a Mesh.
 
-Keeps track of which faces connect to it.
+The faces connected to a vertex are stored by the Mesh, see Mesh::getConnectedFaces.
 */
 class MeshVertex
 {
 public:
     Point3 p; //!< location of the vertex
-    std::vector<uint32_t> connected_faces; //!< list of the indices of connected faces
 
-    MeshVertex(Point3 p) : p(p) {connected_faces.reserve(8);} //!< doesn't set connected_faces
+    MeshVertex(Point3 p) : p(p) {}
 };
 
 /*! A MeshFace is a 3 dimensional model triangle with 3 points. These points are already converted to integers
@@ -59,10 +59,31 @@ See MeshFace for the specifics of how/when faces are connected.
 */
 class Mesh
 {
-    //! The vertex_hash_map stores a index reference of each vertex for the hash of that location. Allows for quick retrieval of points with the same location.
-    std::unordered_map<uint32_t, std::vector<uint32_t> > vertex_hash_map;
+    //! The vertex_hash_map stores the index of the first vertex for the hash of that location. Allows for quick retrieval of points with the same location.
+    std::unordered_map<uint32_t, uint32_t> vertex_hash_map;
+    //! For each vertex, the index of the next vertex with the same location hash, or NO_VERTEX if it's the last one. Together with vertex_hash_map this forms the hash buckets without any per-bucket allocations.
+    std::vector<uint32_t> vertex_hash_next;
+    //! For each vertex, where its connected faces start in connected_faces. The faces of vertex i are in [connected_faces_start[i], connected_faces_start[i + 1]). Filled by finish().
+    std::vector<uint32_t> connected_faces_start;
+    //! The indices of the faces connected to each vertex, concatenated in the order of the vertices. Filled by finish().
+    std::vector<uint32_t> connected_faces;
     AABB3D aabb;
 public:
+    /*!
+     * \brief A range of face indices connected to a single vertex.
+     */
+    class ConnectedFaces
+    {
+    public:
+        ConnectedFaces(const uint32_t* begin, const uint32_t* end) : begin_(begin), end_(end) {}
+        const uint32_t* begin() const { return begin_; }
+        const uint32_t* end() const { return end_; }
+        size_t size() const { return end_ - begin_; }
+    private:
+        const uint32_t* begin_;
+        const uint32_t* end_;
+    };
+
     std::vector<MeshVertex> vertices;//!< list of all vertices in the mesh
     std::vector<MeshFace> faces; //!< list of all faces in the mesh
     Settings settings;
@@ -72,13 +93,66 @@ public:
     Mesh();
 
     void addFace(Point3& v0, Point3& v1, Point3& v2); //!< add a face to the mesh without settings it's connected_faces.
+
+    /*!
+     * \brief Add many faces to the mesh at once.
+     *
+     * This gives the same mesh as calling addFace for every face in order, but
+     * corners at exactly the same position are merged in bulk first (in
+     * parallel), so that only the distinct positions need to be looked up in
+     * the vertex hash map.
+     * \param corners The corners of the faces to add. Every three consecutive
+     * corners form one face.
+     */
+    void addFaces(const std::vector<Point3>& corners);
     void clear(); //!< clears all data
     void finish(); //!< complete the model : set the connected_face_index fields of the faces.
 
+    /*!
+     * \brief Get the indices of all faces that contain a vertex.
+     *
+     * Only available after finish() has been called.
+     * \param vertex_idx The index of the vertex.
+     * \return The indices of the faces connected to the vertex, in the order
+     * in which the faces were added.
+     */
+    ConnectedFaces getConnectedFaces(const size_t vertex_idx) const
+    {
+        return ConnectedFaces(connected_faces.data() + connected_faces_start[vertex_idx], connected_faces.data() + connected_faces_start[vertex_idx + 1]);
+    }
+
     Point3 min() const; //!< min (in x,y and z) vertex of the bounding box
     Point3 max() const; //!< max (in x,y and z) vertex of the bounding box
     AABB3D getAABB() const; //!< Get the axis aligned bounding box
     void expandXY(int64_t offset); //!< Register applied horizontal expansion in the AABB
+
+    /*!
+     * \brief Whether this mesh is a copy of another mesh that was only moved
+     * horizontally, with the same settings.
+     *
+     * The vertices and faces must be in the same order, as they are when a
+     * front-end sends the same model several times. Such a copy is sliced into
+     * the same layers as the other mesh, moved by the difference between
+     * \ref Mesh::min of both.
+     *
+     * Front-ends move copies in floating point, so their vertices may be
+     * rounded to different microns. A small deviation is therefore allowed.
+     * \param other The mesh to compare to.
+     * \param allowed_deviation How far each coordinate of a vertex may be from
+     * the moved vertex of \p other.
+     * \return Whether this mesh is a moved copy of \p other.
+     */
+    bool isHorizontalCopyOf(const Mesh& other, const coord_t allowed_deviation) const;
+
+    /*!
+     * \brief Create an index of the height ranges of all faces of this mesh.
+     *
+     * The identifiers in the index are face indices. The index is not kept up
+     * to date when the mesh changes, so it should be created after the mesh
+     * is in its final position.
+     * \return An index of the faces of this mesh along the Z axis.
+     */
+    ZIntervalIndex getFaceZIndex() const;
     
     /*!
      * Offset the whole mesh (all vertices and the bounding box).
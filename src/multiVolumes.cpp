@@ -1,11 +1,14 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For std::max.
+
 #include "Application.h"
 #include "multiVolumes.h"
 #include "Slice.h"
 #include "slicer.h"
 #include "settings/EnumSettings.h"
+#include "utils/AABB.h"
 
 namespace cura 
 {
@@ -14,45 +17,67 @@ void carveMultipleVolumes(std::vector<Slicer*> &volumes)
 {
     //Go trough all the volumes, and remove the previous volume outlines from our own outline, so we never have overlapped areas.
     const bool alternate_carve_order = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<bool>("alternate_carve_order");
-    for (unsigned int volume_1_idx = 1; volume_1_idx < volumes.size(); volume_1_idx++)
+    std::vector<Slicer*> carved_volumes; //The volumes that take part in the carving, in the order of their priority.
+    size_t layer_count = 0;
+    for (Slicer* volume : volumes)
     {
-        Slicer& volume_1 = *volumes[volume_1_idx];
-        if (volume_1.mesh->settings.get<bool>("infill_mesh") 
-            || volume_1.mesh->settings.get<bool>("anti_overhang_mesh")
-            || volume_1.mesh->settings.get<bool>("support_mesh")
-            || volume_1.mesh->settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
+        if (volume->mesh->settings.get<bool>("infill_mesh")
+            || volume->mesh->settings.get<bool>("anti_overhang_mesh")
+            || volume->mesh->settings.get<bool>("support_mesh")
+            || volume->mesh->settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
             )
         {
             continue;
         }
-        for (unsigned int volume_2_idx = 0; volume_2_idx < volume_1_idx; volume_2_idx++)
+        carved_volumes.push_back(volume);
+        layer_count = std::max(layer_count, volume->layers.size());
+    }
+    if (carved_volumes.size() < 2)
+    {
+        return;
+    }
+
+    //Each volume loses the areas of all volumes before it. Those have been carved already, so they don't overlap each other
+    //and they can be subtracted all at once instead of one after the other.
+    //Each layer is carved independently from the other layers.
+#pragma omp parallel for shared(carved_volumes) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        //With the alternate carve order, the later volumes win on every other layer.
+        const bool reverse_order = alternate_carve_order && layer_nr % 2 == 0;
+        std::vector<std::pair<Polygons*, AABB>> carved_layers; //The carved layers of the volumes before the current one, with their boundary boxes.
+        for (size_t order_idx = 0; order_idx < carved_volumes.size(); order_idx++)
         {
-            Slicer& volume_2 = *volumes[volume_2_idx];
-            if (volume_2.mesh->settings.get<bool>("infill_mesh")
-                || volume_2.mesh->settings.get<bool>("anti_overhang_mesh")
-                || volume_2.mesh->settings.get<bool>("support_mesh")
-                || volume_2.mesh->settings.get<ESurfaceMode>("magic_mesh_surface_mode") == ESurfaceMode::SURFACE
-                )
+            Slicer& volume = *carved_volumes[reverse_order ? carved_volumes.size() - 1 - order_idx : order_idx];
+            if (static_cast<size_t>(layer_nr) >= volume.layers.size())
             {
                 continue;
             }
-            if (!volume_1.mesh->getAABB().hit(volume_2.mesh->getAABB()))
+            Polygons& polygons = volume.layers[layer_nr].polygons;
+            if (polygons.empty())
             {
                 continue;
             }
-            for (unsigned int layerNr = 0; layerNr < volume_1.layers.size(); layerNr++)
+            AABB aabb(polygons);
+            Polygons cutters;
+            for (const std::pair<Polygons*, AABB>& carved_layer : carved_layers)
             {
-                SlicerLayer& layer1 = volume_1.layers[layerNr];
-                SlicerLayer& layer2 = volume_2.layers[layerNr];
-                if (alternate_carve_order && layerNr % 2 == 0)
+                if (carved_layer.second.hit(aabb))
                 {
-                    layer2.polygons = layer2.polygons.difference(layer1.polygons);
+                    cutters.add(*carved_layer.first);
                 }
-                else
+            }
+            if (!cutters.empty())
+            {
+                polygons.differenceInPlace(cutters);
+                if (polygons.empty())
                 {
-                    layer1.polygons = layer1.polygons.difference(layer2.polygons);
+                    continue;
                 }
+                aabb = AABB(polygons);
             }
+            carved_layers.emplace_back(&polygons, aabb);
         }
     }
 }
@@ -66,71 +91,115 @@ void generateMultipleVolumesOverlap(std::vector<Slicer*> &volumes)
         return;
     }
 
-    int offset_to_merge_other_merged_volumes = 20;
-    for (Slicer* volume : volumes)
+    const coord_t offset_to_merge_other_merged_volumes = 20;
+
+    //Resolve the settings of the volumes once, rather than for every layer.
+    std::vector<bool> takes_part(volumes.size()); //Whether each volume overlaps and gets overlapped.
+    std::vector<coord_t> overlaps(volumes.size(), 0);
+    std::vector<AABB3D> expanded_aabbs(volumes.size());
+    size_t layer_count = 0;
+    for (size_t volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
     {
-        coord_t overlap = volume->mesh->settings.get<coord_t>("multiple_mesh_overlap");
-        if (volume->mesh->settings.get<bool>("infill_mesh")
-            || volume->mesh->settings.get<bool>("anti_overhang_mesh")
-            || volume->mesh->settings.get<bool>("support_mesh")
-            || overlap == 0)
+        const Settings& settings = volumes[volume_idx]->mesh->settings;
+        takes_part[volume_idx] = !settings.get<bool>("infill_mesh") && !settings.get<bool>("anti_overhang_mesh") && !settings.get<bool>("support_mesh");
+        overlaps[volume_idx] = settings.get<coord_t>("multiple_mesh_overlap");
+        expanded_aabbs[volume_idx] = volumes[volume_idx]->mesh->getAABB();
+        expanded_aabbs[volume_idx].expandXY(overlaps[volume_idx]); // expand to account for the case where two models and their bounding boxes are adjacent along the X or Y-direction
+        if (takes_part[volume_idx] && overlaps[volume_idx] != 0)
         {
-            continue;
+            layer_count = std::max(layer_count, volumes[volume_idx]->layers.size());
         }
-        AABB3D aabb(volume->mesh->getAABB());
-        aabb.expandXY(overlap); // expand to account for the case where two models and their bounding boxes are adjacent along the X or Y-direction
-        for (unsigned int layer_nr = 0; layer_nr < volume->layers.size(); layer_nr++)
+    }
+
+    //The layers are independent, but within a layer each volume sees the overlap that the volumes before it have already gotten.
+#pragma omp parallel for shared(volumes, takes_part, overlaps, expanded_aabbs) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        for (size_t volume_idx = 0; volume_idx < volumes.size(); volume_idx++)
         {
+            Slicer* volume = volumes[volume_idx];
+            if (!takes_part[volume_idx] || overlaps[volume_idx] == 0 || static_cast<size_t>(layer_nr) >= volume->layers.size())
+            {
+                continue;
+            }
             Polygons all_other_volumes;
-            for (Slicer* other_volume : volumes)
+            for (size_t other_volume_idx = 0; other_volume_idx < volumes.size(); other_volume_idx++)
             {
-                if (other_volume->mesh->settings.get<bool>("infill_mesh")
-                    || other_volume->mesh->settings.get<bool>("anti_overhang_mesh")
-                    || other_volume->mesh->settings.get<bool>("support_mesh")
-                    || !other_volume->mesh->getAABB().hit(aabb)
+                Slicer* other_volume = volumes[other_volume_idx];
+                if (!takes_part[other_volume_idx]
+                    || !other_volume->mesh->getAABB().hit(expanded_aabbs[volume_idx])
                     || other_volume == volume
+                    || static_cast<size_t>(layer_nr) >= other_volume->layers.size()
                 )
                 {
                     continue;
                 }
                 SlicerLayer& other_volume_layer = other_volume->layers[layer_nr];
-                all_other_volumes = all_other_volumes.unionPolygons(other_volume_layer.polygons.offset(offset_to_merge_other_merged_volumes));
+                all_other_volumes.unionInPlace(other_volume_layer.polygons.offset(offset_to_merge_other_merged_volumes));
             }
 
             SlicerLayer& volume_layer = volume->layers[layer_nr];
-            volume_layer.polygons = volume_layer.polygons.unionPolygons(all_other_volumes.intersection(volume_layer.polygons.offset(overlap / 2)));
+            volume_layer.polygons.unionInPlace(all_other_volumes.intersection(volume_layer.polygons.offset(overlaps[volume_idx] / 2)));
         }
     }
 }
 
 void MultiVolumes::carveCuttingMeshes(std::vector<Slicer*>& volumes, const std::vector<Mesh>& meshes)
 {
-    for (unsigned int carving_mesh_idx = 0; carving_mesh_idx < volumes.size(); carving_mesh_idx++)
+    //Resolve the settings of the meshes once, rather than for every layer.
+    std::vector<size_t> cutting_mesh_indices;
+    std::vector<size_t> carved_mesh_indices;
+    size_t layer_count = 0;
+    for (size_t mesh_idx = 0; mesh_idx < volumes.size(); mesh_idx++)
     {
-        const Mesh& cutting_mesh = meshes[carving_mesh_idx];
-        if (!cutting_mesh.settings.get<bool>("cutting_mesh"))
+        const Settings& settings = meshes[mesh_idx].settings;
+        if (settings.get<bool>("cutting_mesh"))
         {
-            continue;
+            cutting_mesh_indices.push_back(mesh_idx);
+            layer_count = std::max(layer_count, volumes[mesh_idx]->layers.size());
+        }
+        //Do not apply cutting_mesh for meshes which have settings (cutting_mesh, anti_overhang_mesh, support_mesh).
+        else if (!settings.get<bool>("anti_overhang_mesh") && !settings.get<bool>("support_mesh"))
+        {
+            carved_mesh_indices.push_back(mesh_idx);
         }
-        Slicer& cutting_mesh_volume = *volumes[carving_mesh_idx];
-        for (unsigned int layer_nr = 0; layer_nr < cutting_mesh_volume.layers.size(); layer_nr++)
+    }
+    if (cutting_mesh_indices.empty())
+    {
+        return;
+    }
+
+    //The layers are independent, but within a layer the cutting meshes carve one after the other.
+#pragma omp parallel for shared(volumes, cutting_mesh_indices, carved_mesh_indices) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(layer_count); layer_nr++)
+    {
+        for (const size_t cutting_mesh_idx : cutting_mesh_indices)
         {
+            Slicer& cutting_mesh_volume = *volumes[cutting_mesh_idx];
+            if (static_cast<size_t>(layer_nr) >= cutting_mesh_volume.layers.size())
+            {
+                continue;
+            }
             Polygons& cutting_mesh_layer = cutting_mesh_volume.layers[layer_nr].polygons;
+            if (cutting_mesh_layer.empty())
+            {
+                continue;
+            }
+            const AABB cutting_aabb(cutting_mesh_layer);
             Polygons new_outlines;
-            for (unsigned int carved_mesh_idx = 0; carved_mesh_idx < volumes.size(); carved_mesh_idx++)
+            for (const size_t carved_mesh_idx : carved_mesh_indices)
             {
-                const Mesh& carved_mesh = meshes[carved_mesh_idx];
-                //Do not apply cutting_mesh for meshes which have settings (cutting_mesh, anti_overhang_mesh, support_mesh).
-                if (carved_mesh.settings.get<bool>("cutting_mesh") || carved_mesh.settings.get<bool>("anti_overhang_mesh")
-                    || carved_mesh.settings.get<bool>("support_mesh"))
-                {
-                    continue;
-                }
                 Slicer& carved_volume = *volumes[carved_mesh_idx];
                 Polygons& carved_mesh_layer = carved_volume.layers[layer_nr].polygons;
+                if (carved_mesh_layer.empty() || !AABB(carved_mesh_layer).hit(cutting_aabb))
+                { // nothing to cut out of this mesh, and nothing of it to keep in the cutting mesh
+                    continue;
+                }
                 Polygons intersection = cutting_mesh_layer.intersection(carved_mesh_layer);
                 new_outlines.add(intersection);
-                carved_mesh_layer = carved_mesh_layer.difference(cutting_mesh_layer);
+                carved_mesh_layer.differenceInPlace(cutting_mesh_layer);
             }
             cutting_mesh_layer = new_outlines.unionPolygons();
         }
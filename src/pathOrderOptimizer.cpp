@@ -1,9 +1,13 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <map>
 #include "pathOrderOptimizer.h"
 #include "utils/logoutput.h"
+#include "utils/PointKDTree.h"
 #include "utils/SparsePointGridInclusive.h"
 #include "utils/linearAlg2D.h"
 #include "pathPlanning/LinePolygonsCrossings.h"
@@ -13,16 +17,50 @@
 
 namespace cura {
 
+/*!
+ * Visit the candidates which might be the best next path from a location, in
+ * order of their index.
+ *
+ * The optimizers pick the candidate with the lowest score at every step, and a
+ * score is never lower than the squared distance to the candidate. Visiting
+ * only the candidates near \p from therefore gives the same outcome as visiting
+ * all of them, as long as every candidate within the square root of the best
+ * score is visited. The score of the nearest candidate bounds how far that is.
+ *
+ * \param candidates The locations of the candidates which may be picked.
+ * \param from The location from which the next path is to start.
+ * \param get_bound The best score there will be after visiting a candidate.
+ * \param visit Visit a candidate, updating the best one.
+ */
+static void visitNearbyCandidates(const PointKDTree& candidates, const Point from, const std::function<float (unsigned int)>& get_bound, const std::function<void (unsigned int)>& visit)
+{
+    unsigned int nearest;
+    if (!candidates.findNearest(from, nearest))
+    {
+        return;
+    }
+    const double max_radius = std::numeric_limits<int32_t>::max(); // farther than any build plate, while its square still fits in a coord_t
+    const double radius = std::min(max_radius, std::sqrt(static_cast<double>(get_bound(nearest))) * 1.001 + 100); // with a margin for rounding errors in the scores
+
+    std::vector<unsigned int> nearby;
+    candidates.findWithin(from, radius, nearby);
+    std::sort(nearby.begin(), nearby.end());
+    nearby.erase(std::unique(nearby.begin(), nearby.end()), nearby.end());
+    for (const unsigned int candidate_idx : nearby)
+    {
+        visit(candidate_idx);
+    }
+}
+
 /**
 *
 */
 void PathOrderOptimizer::optimize()
 {
-    // NOTE: Keep this vector fixed-size, it replaces an (non-standard, sized at runtime) array:
-    std::vector<bool> picked(polygons.size(), false);
+    std::vector<std::pair<Point, unsigned int>> start_points;
     loc_to_line = nullptr;
 
-    for (unsigned poly_idx = 0; poly_idx < polygons.size(); ++poly_idx) /// find closest point to initial starting point within each polygon +initialize picked
+    for (unsigned poly_idx = 0; poly_idx < polygons.size(); ++poly_idx) /// find closest point to initial starting point within each polygon
     {
         const ConstPolygonRef poly = *polygons[poly_idx];
         switch (config.type)
@@ -40,7 +78,12 @@ void PathOrderOptimizer::optimize()
                 break;
         }
         assert(poly.size() != 2);
+        if (poly.size() > 0)
+        {
+            start_points.emplace_back(poly[polyStart.back()], poly_idx);
+        }
     }
+    PointKDTree unpicked(start_points); // the start points of the polygons which weren't picked yet
 
 
     Point prev_point;
@@ -60,14 +103,13 @@ void PathOrderOptimizer::optimize()
         int best_poly_idx = -1;
         float bestDist2 = std::numeric_limits<float>::infinity();
 
-
-        for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+        const std::function<float (unsigned int)> get_bound = [this, &prev_point](const unsigned int poly_idx)
+        {
+            const Point& p = (*polygons[poly_idx])[polyStart[poly_idx]];
+            return combing_boundary ? combingDistance2(p, prev_point) : vSize2f(p - prev_point);
+        };
+        const std::function<void (unsigned int)> visit = [this, &prev_point, &best_poly_idx, &bestDist2](const unsigned int poly_idx)
         {
-            if (picked[poly_idx] || polygons[poly_idx]->size() < 1) /// skip single-point-polygons
-            {
-                continue;
-            }
-
             assert (polygons[poly_idx]->size() != 2);
 
             const Point& p = (*polygons[poly_idx])[polyStart[poly_idx]];
@@ -76,37 +118,15 @@ void PathOrderOptimizer::optimize()
             {
                 // using direct routing, this poly is the closest so far but as the combing boundary
                 // is available, get the combed distance and use that instead
-                if (PolygonUtils::polygonCollidesWithLineSegment(*combing_boundary, p, prev_point))
-                {
-                    if (!loc_to_line)
-                    {
-                        // the combing boundary has been provided so do the initialisation
-                        // required to be able to calculate realistic travel distances to the start of new paths
-                        const int travel_avoid_distance = 2000; // assume 2mm - not really critical for our purposes
-                        loc_to_line = PolygonUtils::createLocToLineGrid(*combing_boundary, travel_avoid_distance);
-                    }
-                    CombPath comb_path;
-                    if (LinePolygonsCrossings::comb(*combing_boundary, *loc_to_line, p, prev_point, comb_path, -40, 0, false))
-                    {
-                        float dist = 0;
-                        Point last_point = p;
-                        for (const Point& comb_point : comb_path)
-                        {
-                            dist += vSize(comb_point - last_point);
-                            last_point = comb_point;
-                        }
-                        dist2 = dist * dist;
-                    }
-                }
+                dist2 = combingDistance2(p, prev_point);
             }
             if (dist2 < bestDist2)
             {
                 best_poly_idx = poly_idx;
                 bestDist2 = dist2;
             }
-
-        }
-
+        };
+        visitNearbyCandidates(unpicked, prev_point, get_bound, visit); /// skips single-point-polygons, which have no start point
 
         if (best_poly_idx > -1) /// should always be true; we should have been able to identify the best next polygon
         {
@@ -114,7 +134,7 @@ void PathOrderOptimizer::optimize()
 
             prev_point = (*polygons[best_poly_idx])[polyStart[best_poly_idx]];
 
-            picked[best_poly_idx] = true;
+            unpicked.remove(best_poly_idx);
             polyOrder.push_back(best_poly_idx);
         }
         else
@@ -129,6 +149,34 @@ void PathOrderOptimizer::optimize()
     }
 }
 
+float PathOrderOptimizer::combingDistance2(const Point& p0, const Point& p1)
+{
+    if (!loc_to_line)
+    {
+        // the combing boundary has been provided so do the initialisation
+        // required to be able to calculate realistic travel distances to the start of new paths
+        const int travel_avoid_distance = 2000; // assume 2mm - not really critical for our purposes
+        loc_to_line = PolygonUtils::createLocToLineGrid(*combing_boundary, travel_avoid_distance);
+    }
+    if (!PolygonUtils::polygonCollidesWithLineSegment(p0, p1, *loc_to_line))
+    {
+        return vSize2f(p0 - p1);
+    }
+    CombPath comb_path;
+    if (LinePolygonsCrossings::comb(*combing_boundary, *loc_to_line, p0, p1, comb_path, -40, 0, false))
+    {
+        float dist = 0;
+        Point last_point = p0;
+        for (const Point& comb_point : comb_path)
+        {
+            dist += vSize(comb_point - last_point);
+            last_point = comb_point;
+        }
+        return dist * dist;
+    }
+    return vSize2f(p0 - p1);
+}
+
 int PathOrderOptimizer::getClosestPointInPolygon(Point prev_point, int poly_idx)
 {
     ConstPolygonRef poly = *polygons[poly_idx];
@@ -139,10 +187,8 @@ int PathOrderOptimizer::getClosestPointInPolygon(Point prev_point, int poly_idx)
     for (unsigned int point_idx = 0; point_idx < poly.size(); point_idx++)
     {
         const Point& p1 = poly[point_idx];
-        const Point& p2 = poly[(point_idx + 1) % poly.size()];
         // when type is SHARPEST_CORNER, actual distance is ignored, we use a fixed distance and decision is based on curvature only
         float dist_score = (config.type == EZSeamType::SHARPEST_CORNER && config.corner_pref != EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE)? 10000 : vSize2(p1 - prev_point);
-        const float corner_angle = LinearAlg2D::getAngleLeft(p0, p1, p2) / M_PI; // 0 -> 2
         float corner_shift;
         if (config.type == EZSeamType::SHORTEST)
         {
@@ -158,32 +204,39 @@ int PathOrderOptimizer::getClosestPointInPolygon(Point prev_point, int poly_idx)
             // the divisor here may need adjusting to obtain the best results (TBD)
             corner_shift = dist_score / 10;
         }
-        switch (config.corner_pref)
+        // a corner reduces the distance by at most corner_shift (plus rounding), so don't compute the angle of the corner
+        // if there is no corner preference or if the point is too far away to become the best one anyway
+        if (config.corner_pref != EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE && dist_score - 2 * corner_shift < best_point_score)
         {
-            case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_INNER:
-                if (corner_angle > 1)
-                {
-                    // p1 lies on a concave curve so reduce the distance to favour it
-                    // the more concave the curve, the more we reduce the distance
-                    dist_score -= (corner_angle - 1) * corner_shift;
-                }
-                break;
-            case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_OUTER:
-                if (corner_angle < 1)
-                {
-                    // p1 lies on a convex curve so reduce the distance to favour it
-                    // the more convex the curve, the more we reduce the distance
-                    dist_score -= (1 - corner_angle) * corner_shift;
-                }
-                break;
-            case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_ANY:
-                // the more curved the region, the more we reduce the distance
-                dist_score -= fabs(corner_angle - 1) * corner_shift;
-                break;
-            case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE:
-            default:
-                // do nothing
-                break;
+            const Point& p2 = poly[(point_idx + 1) % poly.size()];
+            const float corner_angle = LinearAlg2D::getAngleLeft(p0, p1, p2) / M_PI; // 0 -> 2
+            switch (config.corner_pref)
+            {
+                case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_INNER:
+                    if (corner_angle > 1)
+                    {
+                        // p1 lies on a concave curve so reduce the distance to favour it
+                        // the more concave the curve, the more we reduce the distance
+                        dist_score -= (corner_angle - 1) * corner_shift;
+                    }
+                    break;
+                case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_OUTER:
+                    if (corner_angle < 1)
+                    {
+                        // p1 lies on a convex curve so reduce the distance to favour it
+                        // the more convex the curve, the more we reduce the distance
+                        dist_score -= (1 - corner_angle) * corner_shift;
+                    }
+                    break;
+                case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_ANY:
+                    // the more curved the region, the more we reduce the distance
+                    dist_score -= fabs(corner_angle - 1) * corner_shift;
+                    break;
+                case EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE:
+                default:
+                    // do nothing
+                    break;
+            }
         }
         if (dist_score < best_point_score)
         {
@@ -211,17 +264,27 @@ static inline bool pointsAreCoincident(const Point& a, const Point& b)
 void LineOrderOptimizer::optimize(bool find_chains)
 {
     const int grid_size = 2000; // the size of the cells in the hash grid. TODO
-    SparsePointGridInclusive<unsigned int> line_bucket_grid(grid_size);
+    std::vector<std::pair<Point, unsigned int>> line_ends;
+    line_ends.reserve(polygons.size() * 2);
     // NOTE: Keep this vector fixed-size, it replaces an (non-standard, sized at runtime) array:
     std::vector<bool> picked(polygons.size(), false);
 
     loc_to_line = nullptr;
+    combing_distance_cache.clear();
+
+    //The ends of the lines are looked up many times below, so keep them together.
+    lines.clear();
+    lines.reserve(polygons.size(), polygons.size() * 2);
+    for (const ConstPolygonPointer& polygon : polygons)
+    {
+        lines.add(*polygon);
+    }
 
     for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++) /// find closest point to initial starting point within each polygon +initialize picked
     {
         int best_point_idx = -1;
         float best_point_dist = std::numeric_limits<float>::infinity();
-        ConstPolygonRef poly = *polygons[poly_idx];
+        const FlatPolygons::ConstFlatPolygonRef poly = lines[poly_idx];
         for (unsigned int point_idx = 0; point_idx < poly.size(); point_idx++) /// get closest point from polygon
         {
             float dist = vSize2f(poly[point_idx] - startPoint);
@@ -235,16 +298,18 @@ void LineOrderOptimizer::optimize(bool find_chains)
 
         assert(poly.size() == 2);
 
-        line_bucket_grid.insert(poly[0], poly_idx);
-        line_bucket_grid.insert(poly[1], poly_idx);
+        line_ends.emplace_back(poly[0], poly_idx);
+        line_ends.emplace_back(poly[1], poly_idx);
     }
+    const SparsePointGridInclusive<unsigned int> line_bucket_grid(grid_size, line_ends);
+    PointKDTree unpicked(line_ends); // the ends of the lines which weren't picked yet, to look for lines farther away
 
     // a map with an entry for each chain end discovered
     //   keys are the indices of the lines (polys) that start/end a chain of lines
     //   values indicate which of the line's points are at the end of the chain
     std::map<unsigned, unsigned> chain_ends;
 
-    std::vector<unsigned> singletons; // indices of the line segments that don't join any other
+    std::vector<std::pair<Point, unsigned int>> singleton_ends; // the ends of the line segments that don't join any other
 
     if (find_chains)
     {
@@ -261,11 +326,11 @@ void LineOrderOptimizer::optimize(bool find_chains)
             {
                 std::set<int> joined_lines; // use a set because getNearbyVals() appears to return duplicates (?)
                 num_joined_lines[point_idx] = 0;
-                const Point& p = (*polygons[poly_idx])[point_idx];
+                const Point& p = lines[poly_idx][point_idx];
                 // look at each of the lines that finish close to this line to see if either of its vertices are coincident this vertex
                 for (unsigned int close_line_idx : line_bucket_grid.getNearbyVals(p, 10))
                 {
-                    if (close_line_idx != poly_idx && (pointsAreCoincident(p, (*polygons[close_line_idx])[0]) || pointsAreCoincident(p, (*polygons[close_line_idx])[1])))
+                    if (close_line_idx != poly_idx && (pointsAreCoincident(p, lines[close_line_idx][0]) || pointsAreCoincident(p, lines[close_line_idx][1])))
                     {
                         joined_lines.insert(close_line_idx);
                     }
@@ -297,11 +362,14 @@ void LineOrderOptimizer::optimize(bool find_chains)
                 // line is not connected to anything but if there are chains we may want to print it
                 // before moving away to a different area so make it possible for it to be selected
                 // before all the chains have been printed
-                singletons.push_back(poly_idx);
+                singleton_ends.emplace_back(lines[poly_idx][0], poly_idx);
+                singleton_ends.emplace_back(lines[poly_idx][1], poly_idx);
             }
         }
     }
 
+    PointKDTree unpicked_singletons(singleton_ends);
+
     Point prev_point = startPoint;
 
     for (unsigned int order_idx = 0; order_idx < polygons.size(); order_idx++) /// actual path order optimizer
@@ -309,6 +377,18 @@ void LineOrderOptimizer::optimize(bool find_chains)
         int best_line_idx = -1;
         float best_score = std::numeric_limits<float>::infinity(); // distance score for the best next line
 
+        const std::function<float (unsigned int)> get_bound = [this, &prev_point, &best_line_idx, &best_score](const unsigned int poly_idx)
+        {
+            int bound_line_idx = best_line_idx;
+            float bound_score = best_score;
+            updateBestLine(poly_idx, bound_line_idx, bound_score, prev_point);
+            return bound_score;
+        };
+        const std::function<void (unsigned int)> visit = [this, &prev_point, &best_line_idx, &best_score](const unsigned int poly_idx)
+        {
+            updateBestLine(poly_idx, best_line_idx, best_score, prev_point);
+        };
+
         const int close_point_radius = 5000;
 
         // for the first line we would prefer a line that is at the end of a sequence of connected lines (think zigzag) and
@@ -320,7 +400,7 @@ void LineOrderOptimizer::optimize(bool find_chains)
             for(unsigned int close_line_idx : line_bucket_grid.getNearbyVals(prev_point, 10))
             {
                 if (picked[close_line_idx]
-                    || !(pointsAreCoincident(prev_point,(*polygons[close_line_idx])[0]) || pointsAreCoincident(prev_point, (*polygons[close_line_idx])[1])))
+                    || !(pointsAreCoincident(prev_point,lines[close_line_idx][0]) || pointsAreCoincident(prev_point, lines[close_line_idx][1])))
                 {
                     continue;
                 }
@@ -349,7 +429,7 @@ void LineOrderOptimizer::optimize(bool find_chains)
             best_score = std::numeric_limits<float>::infinity();
         }
 
-        if (best_line_idx != -1 && !pointsAreCoincident(prev_point, (*polygons[best_line_idx])[polyStart[best_line_idx]]))
+        if (best_line_idx != -1 && !pointsAreCoincident(prev_point, lines[best_line_idx][polyStart[best_line_idx]]))
         {
             // we found a point close to prev_point but it's not close enough for the points to be considered coincident so we would
             // probably be better off by ditching this point and finding an end of a chain instead (let's hope it's not too far away!)
@@ -388,33 +468,18 @@ void LineOrderOptimizer::optimize(bool find_chains)
             }
 
             // if any singletons are not yet printed, consider them as well
-            for (auto poly_idx : singletons)
-            {
-                if (!picked[poly_idx])
-                {
-                    updateBestLine(poly_idx, best_line_idx, best_score, prev_point);
-                }
-            }
+            visitNearbyCandidates(unpicked_singletons, prev_point, get_bound, visit);
         }
 
         // fallback to using the nearest unpicked line
         if (best_line_idx == -1) /// if single-line-polygon hasn't been found yet
         {
-            for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
-            {
-                if (picked[poly_idx])
-                {
-                    continue;
-                }
-
-                updateBestLine(poly_idx, best_line_idx, best_score, prev_point);
-
-            }
+            visitNearbyCandidates(unpicked, prev_point, get_bound, visit);
         }
 
         if (best_line_idx > -1) /// should always be true; we should have been able to identify the best next polygon
         {
-            ConstPolygonRef best_line = *polygons[best_line_idx];
+            const FlatPolygons::ConstFlatPolygonRef best_line = lines[best_line_idx];
 
             int line_start_point_idx = polyStart[best_line_idx];
             int line_end_point_idx = line_start_point_idx * -1 + 1; /// 1 -> 0 , 0 -> 1
@@ -422,6 +487,8 @@ void LineOrderOptimizer::optimize(bool find_chains)
             prev_point = line_end;
 
             picked[best_line_idx] = true;
+            unpicked.remove(best_line_idx);
+            unpicked_singletons.remove(best_line_idx);
             polyOrder.push_back(best_line_idx);
         }
         else
@@ -435,6 +502,138 @@ void LineOrderOptimizer::optimize(bool find_chains)
     }
 }
 
+void LineOrderOptimizer::optimizeParallel()
+{
+    //Only straight lines can be ordered along their scanlines, so anything else, like the polylines of zigzags, goes through the general optimizer.
+    if (std::any_of(polygons.begin(), polygons.end(), [](const ConstPolygonPointer& polygon) { return polygon->size() != 2; }))
+    {
+        optimize();
+        return;
+    }
+
+    polyStart.assign(polygons.size(), 0);
+    polyOrder.clear();
+    polyOrder.reserve(polygons.size());
+    if (polygons.empty())
+    {
+        return;
+    }
+
+    const Point line_direction = (*polygons[0])[1] - (*polygons[0])[0];
+    const Point scan_direction = turn90CCW(line_direction);
+    //Lines on the same scanline are at the same position in the scan direction, up to rounding.
+    const coord_t scanline_tolerance = 2 * 10 * vSize(scan_direction); //The positions below use the sum of the endpoints instead of the middle, so they're doubled.
+
+    //Sort the lines by their position in the scan direction and group them per scanline.
+    std::vector<std::pair<coord_t, unsigned int>> scan_positions; //The (scaled) position of each line in the scan direction, with its index.
+    scan_positions.reserve(polygons.size());
+    for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        scan_positions.emplace_back(dot((*polygons[poly_idx])[0] + (*polygons[poly_idx])[1], scan_direction), poly_idx);
+    }
+    std::sort(scan_positions.begin(), scan_positions.end());
+    std::vector<std::vector<unsigned int>> scanlines;
+    for (unsigned int sorted_idx = 0; sorted_idx < scan_positions.size(); sorted_idx++)
+    {
+        if (sorted_idx == 0 || scan_positions[sorted_idx].first - scan_positions[sorted_idx - 1].first > scanline_tolerance)
+        {
+            scanlines.emplace_back();
+        }
+        scanlines.back().push_back(scan_positions[sorted_idx].second);
+    }
+
+    const auto distance_to_line = [this](const unsigned int poly_idx, const Point& position)
+    {
+        return std::min(vSize2((*polygons[poly_idx])[0] - position), vSize2((*polygons[poly_idx])[1] - position));
+    };
+
+    //Go through the scanlines starting from the side that is closest.
+    Point position = startPoint;
+    const auto distance_to_scanline = [&distance_to_line, &position](const std::vector<unsigned int>& scanline)
+    {
+        coord_t closest = std::numeric_limits<coord_t>::max();
+        for (const unsigned int poly_idx : scanline)
+        {
+            closest = std::min(closest, distance_to_line(poly_idx, position));
+        }
+        return closest;
+    };
+    if (distance_to_scanline(scanlines.back()) < distance_to_scanline(scanlines.front()))
+    {
+        std::reverse(scanlines.begin(), scanlines.end());
+    }
+
+    //The range that each line covers along the line direction, to find the lines next to it on the next scanline.
+    std::vector<std::pair<coord_t, coord_t>> ranges;
+    ranges.reserve(polygons.size());
+    for (const ConstPolygonPointer& polygon : polygons)
+    {
+        const coord_t start = dot((*polygon)[0], line_direction);
+        const coord_t end = dot((*polygon)[1], line_direction);
+        ranges.emplace_back(std::min(start, end), std::max(start, end));
+    }
+
+    std::vector<bool> picked(polygons.size(), false);
+    unsigned int first_scanline = 0; //The first scanline that may still have lines that aren't picked.
+    while (true)
+    {
+        while (first_scanline < scanlines.size() && std::all_of(scanlines[first_scanline].begin(), scanlines[first_scanline].end(), [&picked](const unsigned int poly_idx) { return picked[poly_idx]; }))
+        {
+            first_scanline++;
+        }
+        if (first_scanline >= scanlines.size())
+        {
+            break;
+        }
+
+        //Start a new strip at the closest line that isn't picked yet.
+        unsigned int poly_idx = polygons.size();
+        unsigned int start_scanline = first_scanline;
+        for (unsigned int scanline_idx = first_scanline; scanline_idx < scanlines.size(); scanline_idx++)
+        {
+            for (const unsigned int candidate_idx : scanlines[scanline_idx])
+            {
+                if (!picked[candidate_idx] && (poly_idx == polygons.size() || distance_to_line(candidate_idx, position) < distance_to_line(poly_idx, position)))
+                {
+                    poly_idx = candidate_idx;
+                    start_scanline = scanline_idx;
+                }
+            }
+        }
+
+        //Follow the strip from scanline to scanline, as long as there is a line next to the previous one.
+        for (unsigned int scanline_idx = start_scanline; ; )
+        {
+            const ConstPolygonRef line = *polygons[poly_idx];
+            polyStart[poly_idx] = (vSize2(line[1] - position) < vSize2(line[0] - position)) ? 1 : 0;
+            polyOrder.push_back(poly_idx);
+            picked[poly_idx] = true;
+            position = line[1 - polyStart[poly_idx]];
+
+            scanline_idx++;
+            if (scanline_idx >= scanlines.size())
+            {
+                break;
+            }
+            const unsigned int previous_idx = poly_idx;
+            poly_idx = polygons.size();
+            for (const unsigned int candidate_idx : scanlines[scanline_idx])
+            {
+                if (!picked[candidate_idx]
+                    && ranges[candidate_idx].first <= ranges[previous_idx].second && ranges[candidate_idx].second >= ranges[previous_idx].first
+                    && (poly_idx == polygons.size() || distance_to_line(candidate_idx, position) < distance_to_line(poly_idx, position)))
+                {
+                    poly_idx = candidate_idx;
+                }
+            }
+            if (poly_idx == polygons.size())
+            {
+                break;
+            }
+        }
+    }
+}
+
 float LineOrderOptimizer::combingDistance2(const Point &p0, const Point &p1)
 {
     if (loc_to_line == nullptr)
@@ -443,6 +642,24 @@ float LineOrderOptimizer::combingDistance2(const Point &p0, const Point &p1)
         loc_to_line = PolygonUtils::createLocToLineGrid(*combing_boundary, 1000); // 1mm grid to reduce computation time
     }
 
+    if (combing_distance_cache.empty() || p1 != combing_distance_cache_to)
+    { // the distances in the cache are to another point
+        combing_distance_cache.clear();
+        combing_distance_cache_to = p1;
+    }
+    const std::unordered_map<Point, float>::const_iterator cached = combing_distance_cache.find(p0);
+    if (cached != combing_distance_cache.end())
+    {
+        return cached->second;
+    }
+    float& dist2 = combing_distance_cache[p0];
+
+    if (!PolygonUtils::polygonCollidesWithLineSegment(p0, p1, *loc_to_line))
+    {
+        dist2 = vSize2f(p0 - p1);
+        return dist2;
+    }
+
     CombPath comb_path;
     if (LinePolygonsCrossings::comb(*combing_boundary, *loc_to_line, p0, p1, comb_path, -40, 0, false))
     {
@@ -453,12 +670,14 @@ float LineOrderOptimizer::combingDistance2(const Point &p0, const Point &p1)
             dist += vSize(comb_point - last_point);
             last_point = comb_point;
         }
-        return dist * dist;
+        dist2 = dist * dist;
+        return dist2;
     }
 
     // couldn't comb, fall back to a large distance
 
-    return vSize2f(p1 - p0) * 10000;
+    dist2 = vSize2f(p1 - p0) * 10000;
+    return dist2;
 }
 
 /*
@@ -475,16 +694,15 @@ inline void LineOrderOptimizer::updateBestLine(unsigned int poly_idx, int& best,
     // when looking at a chain end, just_point will be either 0 or 1 depending on which vertex we are currently interested in testing
     // if just_point is -1, it means that we are not looking at a chain end and we will test both vertices to see if either is best
 
-    const Point& p0 = (*polygons[poly_idx])[0];
-    const Point& p1 = (*polygons[poly_idx])[1];
+    const Point& p0 = lines[poly_idx][0];
+    const Point& p1 = lines[poly_idx][1];
 
     if (just_point != 1)
     { /// check distance to first point on line (0)
         float score = vSize2f(p0 - prev_point);
         if (score < best_score
             && combing_boundary != nullptr
-            && !pointsAreCoincident(p0, prev_point)
-            && PolygonUtils::polygonCollidesWithLineSegment(*combing_boundary, p0, prev_point))
+            && !pointsAreCoincident(p0, prev_point))
         {
             score = combingDistance2(p0, prev_point);
         }
@@ -500,8 +718,7 @@ inline void LineOrderOptimizer::updateBestLine(unsigned int poly_idx, int& best,
         float score = vSize2f(p1 - prev_point);
         if (score < best_score
             && combing_boundary != nullptr
-            && !pointsAreCoincident(p1, prev_point)
-            && PolygonUtils::polygonCollidesWithLineSegment(*combing_boundary, p1, prev_point))
+            && !pointsAreCoincident(p1, prev_point))
         {
             score = combingDistance2(p1, prev_point);
         }
@@ -5,7 +5,9 @@
 #define PATHOPTIMIZER_H
 
 #include <stdint.h>
+#include <unordered_map>
 #include "settings/EnumSettings.h"
+#include "utils/FlatPolygons.h"
 #include "utils/polygon.h"
 #include "utils/polygonUtils.h"
 
@@ -72,6 +74,7 @@ public:
 
     void addPolygons(const Polygons& polygons)
     {
+        this->polygons.reserve(this->polygons.size() + polygons.size());
         for(unsigned int i = 0; i < polygons.size(); i++)
         {
             this->polygons.emplace_back(polygons[i]);
@@ -82,6 +85,17 @@ public:
 
 private:
     int getClosestPointInPolygon(Point prev, int i_polygon); //!< returns the index of the closest point
+
+    /*!
+     * Compute the squared distance from \p p0 to \p p1, combing when the
+     * straight line between them crosses the combing boundary.
+     *
+     * \param p0 A point
+     * \param p1 Another point
+     *
+     * \return The squared travel distance between the two points
+     */
+    float combingDistance2(const Point& p0, const Point& p1);
     int getRandomPointInPolygon(int poly_idx);
 };
 //! Line path order optimization class.
@@ -114,8 +128,9 @@ public:
         polygons.push_back(polygon);
     }
 
-    void addPolygons(Polygons& polygons)
+    void addPolygons(const Polygons& polygons)
     {
+        this->polygons.reserve(this->polygons.size() + polygons.size());
         for(unsigned int i=0;i<polygons.size(); i++)
         {
             this->polygons.push_back(polygons[i]);
@@ -131,6 +146,25 @@ public:
      */
     void optimize(bool find_chains = true); //!< sets #polyStart and #polyOrder
 
+    /*!
+     * \brief Order lines which are all straight and parallel, such as the
+     * lines of the lines pattern.
+     *
+     * The lines are grouped per scanline and then printed in strips. Each strip
+     * goes from a line to the closest line next to it on the next scanline, in
+     * alternating directions, until the next scanline has no line next to it.
+     * The next strip starts at the closest line that is left. Unlike
+     * \ref LineOrderOptimizer::optimize, this doesn't search for the nearest
+     * line after every line, but it also doesn't take the combing boundary into
+     * account.
+     *
+     * If any of the lines has more than two points, they are all ordered by
+     * \ref LineOrderOptimizer::optimize instead.
+     *
+     * Sets #polyStart and #polyOrder.
+     */
+    void optimizeParallel();
+
 private:
     /*!
      * Update LineOrderOptimizer::polyStart if the current line is better than the current best.
@@ -143,8 +177,16 @@ private:
      */
     void updateBestLine(unsigned int poly_idx, int& best, float& best_score, Point prev_point, int just_point = -1);
 
+    FlatPolygons lines; //!< A copy of #polygons made by \ref optimize, so that the ends of the lines are read from a single block of memory.
+
+    Point combing_distance_cache_to; //!< The point to which the distances in LineOrderOptimizer::combing_distance_cache are.
+    std::unordered_map<Point, float> combing_distance_cache; //!< The squared travel distances from the ends of lines to LineOrderOptimizer::combing_distance_cache_to. Lines are often considered more than once in a step.
+
     /*!
-     * Compute the squared distance from \p p0 to \p p1 using combing
+     * Compute the squared distance from \p p0 to \p p1 using combing when the
+     * straight line between them crosses the combing boundary.
+     *
+     * The distances to the last \p p1 are cached.
      *
      * \param p0 A point
      * \param p1 Another point
@@ -12,6 +12,7 @@
 #include "../Application.h"
 #include "../ExtruderTrain.h"
 #include "../Slice.h"
+#include "../utils/Instrumentation.h"
 #include "../utils/linearAlg2D.h"
 #include "../utils/PolygonsPointIndex.h"
 #include "../sliceDataStorage.h"
@@ -28,6 +29,22 @@ Polygons& Comb::getBoundaryOutside()
 {
     return *boundary_outside;
 }
+
+Comb::InsidePart::InsidePart(PolygonsPart&& polygons, const coord_t cell_size)
+: polygons(std::move(polygons))
+, loc_to_line(PolygonUtils::createLocToLineGrid(this->polygons, cell_size))
+{
+}
+
+const Comb::InsidePart& Comb::getPartInside(const PartsView& parts_view, std::vector<std::unique_ptr<InsidePart>>& assembled_parts, const unsigned int part_idx)
+{
+    std::unique_ptr<InsidePart>& part = assembled_parts[part_idx];
+    if (!part)
+    {
+        part.reset(new InsidePart(parts_view.assemblePart(part_idx), offset_from_outlines));
+    }
+    return *part;
+}
   
 Comb::Comb(const SliceDataStorage& storage, const LayerIndex layer_nr, const Polygons& comb_boundary_inside_minimum, const Polygons& comb_boundary_inside_optimal, coord_t comb_boundary_offset, coord_t travel_avoid_distance, coord_t move_inside_distance)
 : storage(storage)
@@ -42,6 +59,8 @@ Comb::Comb(const SliceDataStorage& storage, const LayerIndex layer_nr, const Pol
 , partsView_inside_optimal( boundary_inside_optimal.splitIntoPartsView() ) // WARNING !! changes the order of boundary_inside !!
 , inside_loc_to_line_minimum(PolygonUtils::createLocToLineGrid(boundary_inside_minimum, comb_boundary_offset))
 , inside_loc_to_line_optimal(PolygonUtils::createLocToLineGrid(boundary_inside_optimal, comb_boundary_offset))
+, parts_inside_minimum(partsView_inside_minimum.size())
+, parts_inside_optimal(partsView_inside_optimal.size())
 , boundary_outside(
         [&storage, layer_nr, travel_avoid_distance]()
         {
@@ -63,6 +82,28 @@ Comb::Comb(const SliceDataStorage& storage, const LayerIndex layer_nr, const Pol
         , offset_from_inside_to_outside
     )
 , move_inside_distance(move_inside_distance)
+, travel_avoid_other_parts(
+        [&storage, layer_nr]()
+        {
+            const std::vector<bool> extruder_is_used = storage.getExtrudersUsed(layer_nr);
+            bool travel_avoid_other_parts = false;
+            for (const ExtruderTrain& train : Application::getInstance().current_slice->scene.extruders)
+            {
+                travel_avoid_other_parts |= extruder_is_used[train.extruder_nr] && train.settings.get<bool>("travel_avoid_other_parts");
+            }
+            return travel_avoid_other_parts;
+        }
+    )
+, boundary_inside_optimal_tester(
+        [](Comb* comber)
+        {
+            return PolygonsInsideTester(comber->boundary_inside_optimal);
+        }
+        , this
+    )
+, direct_travel_max_distance(Application::getInstance().current_slice->scene.settings.has("retraction_combing_direct_max_distance") ? Application::getInstance().current_slice->scene.settings.get<coord_t>("retraction_combing_direct_max_distance") : 0)
+, max_travels_through_air(Application::getInstance().current_slice->scene.settings.has("retraction_combing_max_air_travels_per_layer") ? Application::getInstance().current_slice->scene.settings.get<size_t>("retraction_combing_max_air_travels_per_layer") : 0)
+, travels_through_air(0)
 {
 }
 
@@ -85,6 +126,17 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
         return true;
     }
 
+    // short travels within a part are most common, so first try going straight before moving the points inside and finding the parts
+    if (direct_travel_max_distance > 0 && _startInside && _endInside && startPoint != endPoint && vSize2(endPoint - startPoint) <= direct_travel_max_distance * direct_travel_max_distance
+        && !LinePolygonsCrossings::collidesWithBoundary(boundary_inside_optimal, *inside_loc_to_line_optimal, startPoint, endPoint)
+        && (*boundary_inside_optimal_tester).inside(startPoint)) // not crossing the boundary from inside means the end is inside as well
+    {
+        combPaths.emplace_back();
+        combPaths.back().push_back(startPoint);
+        combPaths.back().push_back(endPoint);
+        return true;
+    }
+
     //Move start and end point inside the optimal comb boundary
     unsigned int start_inside_poly = NO_INDEX;
     const bool startInside = moveInside(boundary_inside_optimal, _startInside, inside_loc_to_line_optimal, startPoint, start_inside_poly);
@@ -104,9 +156,9 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
     // normal combing within part using optimal comb boundary
     if (startInside && endInside && start_part_idx == end_part_idx)
     {
-        PolygonsPart part = partsView_inside_optimal.assemblePart(start_part_idx);
+        const InsidePart& part = getPartInside(partsView_inside_optimal, parts_inside_optimal, start_part_idx);
         combPaths.emplace_back();
-        return LinePolygonsCrossings::comb(part, *inside_loc_to_line_optimal, startPoint, endPoint, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        return LinePolygonsCrossings::comb(part.polygons, *part.loc_to_line, startPoint, endPoint, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
     }
 
     //Move start and end point inside the minimum comb boundary
@@ -127,10 +179,10 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
     // normal combing within part using minimum comb boundary
     if (startInsideMin && endInsideMin && start_part_idx_min == end_part_idx_min)
     {
-        PolygonsPart part = partsView_inside_minimum.assemblePart(start_part_idx_min);
+        const InsidePart& part = getPartInside(partsView_inside_minimum, parts_inside_minimum, start_part_idx_min);
         combPaths.emplace_back();
 
-        comb_result = LinePolygonsCrossings::comb(part, *inside_loc_to_line_minimum, startPoint, endPoint, result_path, -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        comb_result = LinePolygonsCrossings::comb(part.polygons, *part.loc_to_line, startPoint, endPoint, result_path, -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         Comb::moveCombPathInside(boundary_inside_minimum, boundary_inside_optimal, result_path, combPaths.back());  // add altered result_path to combPaths.back()
         return comb_result;
     }
@@ -147,12 +199,19 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
         return false;
     }
 
+    if (max_travels_through_air > 0 && travels_through_air >= max_travels_through_air) //Layers with very many parts would take too long to comb; retract and move straight instead.
+    {
+        ScopedTimer::count("comb_air_travels_over_budget");
+        return false;
+    }
+    travels_through_air++;
+
     Crossing start_crossing(startPoint, startInside, start_part_idx, start_part_boundary_poly_idx, boundary_inside_optimal, inside_loc_to_line_optimal);
     Crossing end_crossing(endPoint, endInside, end_part_idx, end_part_boundary_poly_idx, boundary_inside_optimal, inside_loc_to_line_optimal);
 
     { // find crossing over the in-between area between inside and outside
-        start_crossing.findCrossingInOrMid(partsView_inside_optimal, endPoint);
-        end_crossing.findCrossingInOrMid(partsView_inside_optimal, start_crossing.in_or_mid);
+        start_crossing.findCrossingInOrMid(*this, endPoint);
+        end_crossing.findCrossingInOrMid(*this, start_crossing.in_or_mid);
     }
 
     bool skip_avoid_other_parts_path = false;
@@ -161,14 +220,7 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
         skip_avoid_other_parts_path = true;
     }
 
-    const std::vector<bool> extruder_is_used = storage.getExtrudersUsed(layer_nr);
-    bool travel_avoid_other_parts = false;
-    for (const ExtruderTrain& train : Application::getInstance().current_slice->scene.extruders)
-    {
-        travel_avoid_other_parts |= extruder_is_used[train.extruder_nr] && train.settings.get<bool>("travel_avoid_other_parts");
-    }
-
-    if (travel_avoid_other_parts && !skip_avoid_other_parts_path)
+    if (*travel_avoid_other_parts && !skip_avoid_other_parts_path)
     { // compute the crossing points when moving through air
         // comb through all air, since generally the outside consists of a single part
 
@@ -189,9 +241,9 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
     if (startInside)
     {
         // start to boundary
-        assert(start_crossing.dest_part.size() > 0 && "The part we start inside when combing should have been computed already!");
+        assert(start_crossing.dest_part && start_crossing.dest_part->polygons.size() > 0 && "The part we start inside when combing should have been computed already!");
         combPaths.emplace_back();
-        bool combing_succeeded = LinePolygonsCrossings::comb(start_crossing.dest_part, *inside_loc_to_line_optimal, startPoint, start_crossing.in_or_mid, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        bool combing_succeeded = LinePolygonsCrossings::comb(start_crossing.dest_part->polygons, *start_crossing.dest_part->loc_to_line, startPoint, start_crossing.in_or_mid, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         if (!combing_succeeded)
         { // Couldn't comb between start point and computed crossing from the start part! Happens for very thin parts when the offset_to_get_off_boundary moves points to outside the polygon
             return false;
@@ -199,7 +251,7 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
     }
 
     // throught air from boundary to boundary
-    if (travel_avoid_other_parts && !skip_avoid_other_parts_path)
+    if (*travel_avoid_other_parts && !skip_avoid_other_parts_path)
     {
         combPaths.emplace_back();
         combPaths.throughAir = true;
@@ -247,10 +299,10 @@ bool Comb::calc(const ExtruderTrain& train, Point startPoint, Point endPoint, Co
     if (endInside)
     {
         // boundary to end
-        assert(end_crossing.dest_part.size() > 0 && "The part we end up inside when combing should have been computed already!");
+        assert(end_crossing.dest_part && end_crossing.dest_part->polygons.size() > 0 && "The part we end up inside when combing should have been computed already!");
         combPaths.emplace_back();
 
-        bool combing_succeeded = LinePolygonsCrossings::comb(end_crossing.dest_part, *inside_loc_to_line_optimal, end_crossing.in_or_mid, endPoint, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+        bool combing_succeeded = LinePolygonsCrossings::comb(end_crossing.dest_part->polygons, *end_crossing.dest_part->loc_to_line, end_crossing.in_or_mid, endPoint, combPaths.back(), -offset_dist_to_get_from_on_the_polygon_to_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
         if (!combing_succeeded)
         { // Couldn't comb between end point and computed crossing to the end part! Happens for very thin parts when the offset_to_get_off_boundary moves points to outside the polygon
             return false;
@@ -294,6 +346,7 @@ void Comb::moveCombPathInside(Polygons& boundary_inside, Polygons& boundary_insi
 
 Comb::Crossing::Crossing(const Point& dest_point, const bool dest_is_inside, const unsigned int dest_part_idx, const unsigned int dest_part_boundary_crossing_poly_idx, const Polygons& boundary_inside, const LocToLineGrid* inside_loc_to_line)
 : dest_is_inside(dest_is_inside)
+, dest_part(nullptr)
 , boundary_inside(boundary_inside)
 , inside_loc_to_line(inside_loc_to_line)
 , dest_point(dest_point)
@@ -323,14 +376,15 @@ bool Comb::moveInside(Polygons& boundary_inside, bool is_inside, LocToLineGrid*
     return false;
 }
 
-void Comb::Crossing::findCrossingInOrMid(const PartsView& partsView_inside, const Point close_to)
+void Comb::Crossing::findCrossingInOrMid(Comb& comber, const Point close_to)
 {
     if (dest_is_inside)
     { // in-case
         // find the point on the start inside-polygon closest to the endpoint, but also kind of close to the start point
         Point _dest_point(dest_point); // copy to local variable for lambda capture
         std::function<int(Point)> close_towards_start_penalty_function([_dest_point](Point candidate){ return vSize2((candidate - _dest_point) / 10); });
-        dest_part = partsView_inside.assemblePart(dest_part_idx);
+        const PartsView& partsView_inside = comber.partsView_inside_optimal;
+        dest_part = &comber.getPartInside(partsView_inside, comber.parts_inside_optimal, dest_part_idx);
 
         ClosestPolygonPoint boundary_crossing_point;
         { // set [result] to a point on the destination part closest to close_to (but also a bit close to _dest_point)
@@ -365,7 +419,7 @@ void Comb::Crossing::findCrossingInOrMid(const PartsView& partsView_inside, cons
             result = dest_point;
         }
 
-        ClosestPolygonPoint crossing_1_in_cp = PolygonUtils::ensureInsideOrOutside(dest_part, result, boundary_crossing_point, offset_dist_to_get_from_on_the_polygon_to_outside, &boundary_inside, inside_loc_to_line, close_towards_start_penalty_function);
+        ClosestPolygonPoint crossing_1_in_cp = PolygonUtils::ensureInsideOrOutside(dest_part->polygons, result, boundary_crossing_point, offset_dist_to_get_from_on_the_polygon_to_outside, &boundary_inside, inside_loc_to_line, close_towards_start_penalty_function);
         if (crossing_1_in_cp.isValid())
         {
             dest_crossing_poly = crossing_1_in_cp.poly;
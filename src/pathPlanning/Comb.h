@@ -4,7 +4,8 @@
 #ifndef PATH_PLANNING_COMB_H
 #define PATH_PLANNING_COMB_H
 
-#include <memory> // shared_ptr
+#include <memory> // shared_ptr, unique_ptr
+#include <vector>
 #include <limits> //To find the maximum for coord_t.
 
 #include "../settings/types/LayerIndex.h" //To store the layer on which we comb.
@@ -12,6 +13,7 @@
 #include "../utils/polygon.h"
 #include "../utils/polygonUtils.h"
 #include "../utils/LazyInitialization.h"
+#include "../utils/PolygonsInsideTester.h"
 
 namespace cura 
 {
@@ -46,6 +48,22 @@ class Comb
 {
     friend class LinePolygonsCrossings;
 private:
+    /*!
+     * A part of an inside boundary, assembled from its polygons.
+     */
+    struct InsidePart
+    {
+        PolygonsPart polygons; //!< The polygons of the part.
+        std::unique_ptr<LocToLineGrid> loc_to_line; //!< Mapping locations to line segments of \ref InsidePart::polygons, so that LinePolygonsCrossings only has to look at the segments along a travel move.
+
+        /*!
+         * Assemble a part and build its grid.
+         * \param polygons The polygons of the part.
+         * \param cell_size The cell size of the grid.
+         */
+        InsidePart(PolygonsPart&& polygons, const coord_t cell_size);
+    };
+
     /*!
      * A crossing from the inside boundary to the outside boundary.
      * 
@@ -57,7 +75,7 @@ private:
         bool dest_is_inside; //!< Whether the startPoint or endPoint is inside the inside boundary
         Point in_or_mid; //!< The point on the inside boundary, or in between the inside and outside boundary if the start/end point isn't inside the inside boudary
         Point out; //!< The point on the outside boundary
-        PolygonsPart dest_part; //!< The assembled inside-boundary PolygonsPart in which the dest_point lies. (will only be initialized when Crossing::dest_is_inside holds)
+        const InsidePart* dest_part; //!< The assembled inside-boundary part in which the dest_point lies. (will only be initialized when Crossing::dest_is_inside holds)
         std::optional<ConstPolygonPointer> dest_crossing_poly; //!< The polygon of the part in which dest_point lies, which will be crossed (often will be the outside polygon)
         const Polygons& boundary_inside; //!< The inside boundary as in \ref Comb::boundary_inside
         const LocToLineGrid* inside_loc_to_line; //!< The loc to line grid \ref Comb::inside_loc_to_line
@@ -76,10 +94,10 @@ private:
         /*!
          * Find the not-outside location (Combing::in_or_mid) of the crossing between to the outside boundary
          * 
-         * \param partsView_inside Structured indices onto Comb::boundary_inside which shows which polygons belong to which part. 
+         * \param comber[in] The combing calculator which has the optimal inside boundary split into parts.
          * \param close_to[in] Try to get a crossing close to this point
          */
-        void findCrossingInOrMid(const PartsView& partsView_inside, const Point close_to);
+        void findCrossingInOrMid(Comb& comber, const Point close_to);
 
         /*!
          * Find the outside location (Combing::out)
@@ -132,9 +150,26 @@ private:
     const PartsView partsView_inside_optimal; //!< Structured indices onto boundary_inside_optimal which shows which polygons belong to which part.
     LocToLineGrid* inside_loc_to_line_minimum; //!< The SparsePointGridInclusive mapping locations to line segments of the inner boundary.
     LocToLineGrid* inside_loc_to_line_optimal; //!< The SparsePointGridInclusive mapping locations to line segments of the inner boundary.
+    std::vector<std::unique_ptr<InsidePart>> parts_inside_minimum; //!< The parts of boundary_inside_minimum that were assembled so far. Many travels comb within the same part.
+    std::vector<std::unique_ptr<InsidePart>> parts_inside_optimal; //!< The parts of boundary_inside_optimal that were assembled so far. Many travels comb within the same part.
     LazyInitialization<Polygons> boundary_outside; //!< The boundary outside of which to stay to avoid collision with other layer parts. This is a pointer cause we only compute it when we move outside the boundary (so not when there is only a single part in the layer)
     LazyInitialization<LocToLineGrid, Comb*, const coord_t> outside_loc_to_line; //!< The SparsePointGridInclusive mapping locations to line segments of the outside boundary.
     coord_t move_inside_distance; //!< When using comb_boundary_inside_minimum for combing it tries to move points inside by this amount after calculating the path to move it from the border a bit.
+    LazyInitialization<bool> travel_avoid_other_parts; //!< Whether any extruder used on this layer avoids other parts when travelling through air. Computed only once per layer, since it takes many settings lookups.
+    LazyInitialization<PolygonsInsideTester, Comb*> boundary_inside_optimal_tester; //!< For testing whether the start of a travel is inside Comb::boundary_inside_optimal, to find travels which can go straight.
+
+    const coord_t direct_travel_max_distance; //!< Travels which should stay inside and are at most this long go straight if that doesn't cross the inside boundary, without combing. Zero to always comb.
+    const size_t max_travels_through_air; //!< How many travels between parts may be routed through air on this layer. Beyond that, they are left to a retraction and a straight move. Zero for no limit.
+    size_t travels_through_air; //!< How many travels between parts have been routed through air on this layer so far.
+
+    /*!
+     * Get a part of an inside boundary. Assemble it when it hasn't been assembled yet.
+     * \param parts_view The structured indices onto the inside boundary.
+     * \param assembled_parts The parts of the inside boundary that were assembled so far.
+     * \param part_idx The index of the part in \p parts_view.
+     * \return The part. It stays valid as long as this Comb exists.
+     */
+    const InsidePart& getPartInside(const PartsView& parts_view, std::vector<std::unique_ptr<InsidePart>>& assembled_parts, const unsigned int part_idx);
 
     /*!
      * Get the SparsePointGridInclusive mapping locations to line segments of the outside boundary. Calculate it when it hasn't been calculated yet.
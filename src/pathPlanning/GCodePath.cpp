@@ -6,19 +6,19 @@
 
 namespace cura
 {
-GCodePath::GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const bool spiralize, const Ratio speed_factor) :
+GCodePath::GCodePath(const GCodePathConfig& config, std::shared_ptr<const std::string> mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const bool spiralize, const Ratio speed_factor) :
 config(&config),
-mesh_id(mesh_id),
+mesh_id(std::move(mesh_id)),
 space_fill_type(space_fill_type),
-flow(flow),
-speed_factor(speed_factor),
 retract(false),
 perform_z_hop(false),
 perform_prime(false),
 skip_agressive_merge_hint(false),
-points(std::vector<Point>()),
 done(false),
 spiralize(spiralize),
+flow(flow),
+speed_factor(speed_factor),
+points(),
 fan_speed(GCodePathConfig::FAN_SPEED_DEFAULT),
 estimates(TimeMaterialEstimates())
 {
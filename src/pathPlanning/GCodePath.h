@@ -4,9 +4,12 @@
 #ifndef PATH_PLANNING_G_CODE_PATH_H
 #define PATH_PLANNING_G_CODE_PATH_H
 
+#include <memory> //For shared_ptr.
+
 #include "../SpaceFillType.h"
 #include "../settings/types/Ratio.h"
 #include "../utils/IntPoint.h"
+#include "../utils/SmallVector.h"
 
 #include "TimeMaterialEstimates.h"
 
@@ -24,23 +27,25 @@ class GCodePathConfig;
  * 
  * In the final representation (gcode) each line segment may have different properties, 
  * which are added when the generated GCodePaths are processed.
+ * 
+ * A layer plan holds many paths, most of which are only one or two points long, so they're kept compact:
+ * short paths keep their points inline, paths of the same mesh share its ID and the flags are packed together.
  */
 class GCodePath
 {
 public:
     const GCodePathConfig* config; //!< The configuration settings of the path.
-    std::string mesh_id; //!< Which mesh this path belongs to, if any. If it's not part of any mesh, the mesh ID should be 0.
+    std::shared_ptr<const std::string> mesh_id; //!< Which mesh this path belongs to, if any. If it's not part of any mesh, the mesh ID should be "NONMESH". Shared by all paths of the same mesh in a layer plan.
     SpaceFillType space_fill_type; //!< The type of space filling of which this path is a part
-    Ratio flow; //!< A type-independent flow configuration (used for wall overlap compensation)
-    Ratio speed_factor; //!< A speed factor that is multiplied with the travel speed. This factor can be used to change the travel speed.
     bool retract; //!< Whether the path is a move path preceded by a retraction move; whether the path is a retracted move path. 
     bool perform_z_hop; //!< Whether to perform a z_hop in this path, which is assumed to be a travel path.
     bool perform_prime; //!< Whether this path is preceded by a prime (blob)
     bool skip_agressive_merge_hint; //!< Wheter this path needs to skip merging if any travel paths are in between the extrusions.
-    std::vector<Point> points; //!< The points constituting this path.
     bool done; //!< Path is finished, no more moves should be added, and a new path should be started instead of any appending done to this one.
-
     bool spiralize; //!< Whether to gradually increment the z position during the printing of this path. A sequence of spiralized paths should start at the given layer height and end in one layer higher.
+    Ratio flow; //!< A type-independent flow configuration (used for wall overlap compensation)
+    Ratio speed_factor; //!< A speed factor that is multiplied with the travel speed. This factor can be used to change the travel speed.
+    SmallVector<Point, 2> points; //!< The points constituting this path. Travel moves and single extruded lines fit without allocating memory.
 
     double fan_speed; //!< fan speed override for this path, value should be within range 0-100 (inclusive) and ignored otherwise
 
@@ -58,7 +63,7 @@ public:
      * \param speed_factor The factor that the travel speed will be multiplied with
      * this path.
      */
-    GCodePath(const GCodePathConfig& config, std::string mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const bool spiralize, const Ratio speed_factor = 1.0);
+    GCodePath(const GCodePathConfig& config, std::shared_ptr<const std::string> mesh_id, const SpaceFillType space_fill_type, const Ratio flow, const bool spiralize, const Ratio speed_factor = 1.0);
 
     /*!
      * Whether this config is the config of a travel path.
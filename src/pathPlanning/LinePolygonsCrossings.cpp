@@ -28,19 +28,21 @@ bool LinePolygonsCrossings::calcScanlineCrossings(bool fail_on_unavoidable_obsta
     min_crossing_idx = NO_INDEX;
     max_crossing_idx = NO_INDEX;
 
-    for(unsigned int poly_idx = 0; poly_idx < boundary.size(); poly_idx++)
+    size_t segment_idx = 0;
+    while (segment_idx < scanline_segments.size())
     {
+        const size_t poly_idx = scanline_segments[segment_idx].first;
         PolyCrossings minMax(poly_idx); 
         ConstPolygonRef poly = boundary[poly_idx];
-        Point p0 = transformation_matrix.apply(poly[poly.size() - 1]);
-        for(unsigned int point_idx = 0; point_idx < poly.size(); point_idx++)
+        for (; segment_idx < scanline_segments.size() && scanline_segments[segment_idx].first == poly_idx; segment_idx++)
         {
-            Point p1 = transformation_matrix.apply(poly[point_idx]);
+            const size_t point_idx = scanline_segments[segment_idx].second;
+            const Point p0 = transformation_matrix.apply(poly[(point_idx + poly.size() - 1) % poly.size()]);
+            const Point p1 = transformation_matrix.apply(poly[point_idx]);
             if ((p0.Y >= transformed_startPoint.Y && p1.Y <= transformed_startPoint.Y) || (p1.Y >= transformed_startPoint.Y && p0.Y <= transformed_startPoint.Y))
             { // if line segment crosses the line through the transformed start and end point (aka scanline)
                 if (p1.Y == p0.Y) //Line segment is parallel with the scanline. That means that both endpoints lie on the scanline, so they will have intersected with the adjacent line.
                 {
-                    p0 = p1;
                     continue;
                 }
                 const coord_t x = p0.X + (p1.X - p0.X) * (transformed_startPoint.Y - p0.Y) / (p1.Y - p0.Y); // intersection point between line segment and the scanline
@@ -65,7 +67,6 @@ bool LinePolygonsCrossings::calcScanlineCrossings(bool fail_on_unavoidable_obsta
                     }
                 }
             }
-            p0 = p1;
         }
 
         if (fail_on_unavoidable_obstacles && minMax.n_crossings % 2 == 1)
@@ -91,33 +92,65 @@ bool LinePolygonsCrossings::lineSegmentCollidesWithBoundary()
     transformed_startPoint = transformation_matrix.apply(startPoint);
     transformed_endPoint = transformation_matrix.apply(endPoint);
 
-    for(ConstPolygonRef poly : boundary)
+    findScanlineSegments();
+    for (const std::pair<size_t, size_t>& segment : scanline_segments)
     {
-        Point p0 = transformation_matrix.apply(poly.back());
-        for(Point p1_ : poly)
+        ConstPolygonRef poly = boundary[segment.first];
+        const Point p0 = transformation_matrix.apply(poly[(segment.second + poly.size() - 1) % poly.size()]);
+        const Point p1 = transformation_matrix.apply(poly[segment.second]);
+        // when the boundary just touches the line don't disambiguate between the boundary moving on to actually cross the line
+        // and the boundary bouncing back, resulting in not a real collision - to keep the algorithm simple.
+        //
+        // disregard overlapping line segments; probably the next or previous line segment is not overlapping, but will give a collision
+        // when the boundary line segment fully overlaps with the line segment this edge case is not viewed as a collision
+        if (p1.Y != p0.Y && ((p0.Y >= transformed_startPoint.Y && p1.Y <= transformed_startPoint.Y) || (p1.Y >= transformed_startPoint.Y && p0.Y <= transformed_startPoint.Y)))
         {
-            Point p1 = transformation_matrix.apply(p1_);
-            // when the boundary just touches the line don't disambiguate between the boundary moving on to actually cross the line
-            // and the boundary bouncing back, resulting in not a real collision - to keep the algorithm simple.
-            //
-            // disregard overlapping line segments; probably the next or previous line segment is not overlapping, but will give a collision
-            // when the boundary line segment fully overlaps with the line segment this edge case is not viewed as a collision
-            if (p1.Y != p0.Y && ((p0.Y >= transformed_startPoint.Y && p1.Y <= transformed_startPoint.Y) || (p1.Y >= transformed_startPoint.Y && p0.Y <= transformed_startPoint.Y)))
-            {
-                int64_t x = p0.X + (p1.X - p0.X) * (transformed_startPoint.Y - p0.Y) / (p1.Y - p0.Y);
+            int64_t x = p0.X + (p1.X - p0.X) * (transformed_startPoint.Y - p0.Y) / (p1.Y - p0.Y);
 
-                if (x > transformed_startPoint.X && x < transformed_endPoint.X)
-                {
-                    return true;
-                }
+            if (x > transformed_startPoint.X && x < transformed_endPoint.X)
+            {
+                return true;
             }
-            p0 = p1;
         }
     }
     
     return false;
 }
 
+void LinePolygonsCrossings::findScanlineSegments()
+{
+    scanline_segments.clear();
+    bool grid_is_of_boundary = true;
+    loc_to_line_grid.processLine(std::make_pair(startPoint, endPoint),
+        [this, &grid_is_of_boundary](const PolygonsPointIndex& segment_start)
+        {
+            if (segment_start.polygons != &boundary)
+            { // the indices in the grid don't refer to the boundary
+                grid_is_of_boundary = false;
+                return false;
+            }
+            const size_t poly_size = boundary[segment_start.poly_idx].size();
+            scanline_segments.emplace_back(segment_start.poly_idx, (segment_start.point_idx + 1) % poly_size);
+            return true;
+        });
+
+    if (grid_is_of_boundary)
+    { // a segment is in the grid once for every cell it passes through
+        std::sort(scanline_segments.begin(), scanline_segments.end());
+        scanline_segments.erase(std::unique(scanline_segments.begin(), scanline_segments.end()), scanline_segments.end());
+        return;
+    }
+
+    scanline_segments.clear();
+    for (size_t poly_idx = 0; poly_idx < boundary.size(); poly_idx++)
+    {
+        for (size_t point_idx = 0; point_idx < boundary[poly_idx].size(); point_idx++)
+        {
+            scanline_segments.emplace_back(poly_idx, point_idx);
+        }
+    }
+}
+
 
 bool LinePolygonsCrossings::generateCombingPath(CombPath& combPath, int64_t max_comb_distance_ignored, bool fail_on_unavoidable_obstacles)
 {
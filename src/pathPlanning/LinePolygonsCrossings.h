@@ -75,7 +75,7 @@ private:
     unsigned int max_crossing_idx; //!< The index into LinePolygonsCrossings::crossings to the crossing with the maximal PolyCrossings::max crossing of all PolyCrossings's.
     
     const Polygons& boundary; //!< The boundary not to cross during combing.
-    LocToLineGrid& loc_to_line_grid; //!< Mapping from locations to line segments of \ref LinePolygonsCrossings::boundary
+    const LocToLineGrid& loc_to_line_grid; //!< Mapping from locations to line segments of (at least) \ref LinePolygonsCrossings::boundary
     Point startPoint; //!< The start point of the scanline.
     Point endPoint; //!< The end point of the scanline.
     
@@ -84,12 +84,23 @@ private:
     PointMatrix transformation_matrix; //!< The transformation which rotates everything such that the scanline is aligned with the x-axis.
     Point transformed_startPoint; //!< The LinePolygonsCrossings::startPoint as transformed by Comb::transformation_matrix such that it has (roughly) the same Y as transformed_endPoint
     Point transformed_endPoint; //!< The LinePolygonsCrossings::endPoint as transformed by Comb::transformation_matrix such that it has (roughly) the same Y as transformed_startPoint
+    std::vector<std::pair<size_t, size_t>> scanline_segments; //!< The line segments of the boundary which might cross the scanline, as the index of the polygon and the index of the end point of the segment. Ordered as they occur in the boundary.
+
+    /*!
+     * Find the line segments of the boundary which might cross the scanline and store them in \ref LinePolygonsCrossings::scanline_segments.
+     *
+     * Only the segments in the grid cells along the scanline are considered, so
+     * that a travel move doesn't need to look at every segment of a detailed
+     * boundary. If the grid also holds other polygons than the boundary, all
+     * segments of the boundary are considered.
+     */
+    void findScanlineSegments();
 
     
     /*!
      * Check if we are crossing the boundaries, and pre-calculate some values.
      * 
-     * Sets Comb::transformation_matrix, Comb::transformed_startPoint and Comb::transformed_endPoint
+     * Sets Comb::transformation_matrix, Comb::transformed_startPoint, Comb::transformed_endPoint and LinePolygonsCrossings::scanline_segments
      * \return Whether the line segment from LinePolygonsCrossings::startPoint to LinePolygonsCrossings::endPoint collides with the boundary
      */
     bool lineSegmentCollidesWithBoundary();
@@ -159,7 +170,7 @@ private:
      * \param end the end point
      * \param dist_to_move_boundary_point_outside Distance used to move a point from a boundary so that it doesn't intersect with it anymore. (Precision issue)
      */
-    LinePolygonsCrossings(const Polygons& boundary, LocToLineGrid& loc_to_line_grid, Point& start, Point& end, int64_t dist_to_move_boundary_point_outside)
+    LinePolygonsCrossings(const Polygons& boundary, const LocToLineGrid& loc_to_line_grid, Point& start, Point& end, int64_t dist_to_move_boundary_point_outside)
     : boundary(boundary)
     , loc_to_line_grid(loc_to_line_grid)
     , startPoint(start)
@@ -180,11 +191,26 @@ public:
      * \param fail_on_unavoidable_obstacles When moving over other parts is inavoidable, stop calculation early and return false.
      * \return Whether combing succeeded, i.e. we didn't cross any gaps/other parts
      */
-    static bool comb(const Polygons& boundary, LocToLineGrid& loc_to_line_grid, Point startPoint, Point endPoint, CombPath& combPath, int64_t dist_to_move_boundary_point_outside, int64_t max_comb_distance_ignored, bool fail_on_unavoidable_obstacles)
+    static bool comb(const Polygons& boundary, const LocToLineGrid& loc_to_line_grid, Point startPoint, Point endPoint, CombPath& combPath, int64_t dist_to_move_boundary_point_outside, int64_t max_comb_distance_ignored, bool fail_on_unavoidable_obstacles)
     {
         LinePolygonsCrossings linePolygonsCrossings(boundary, loc_to_line_grid, startPoint, endPoint, dist_to_move_boundary_point_outside);
         return linePolygonsCrossings.generateCombingPath(combPath, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
     };
+
+    /*!
+     * Check whether a straight move crosses the boundary, without computing a
+     * combing path around it.
+     * \param boundary The polygons not to cross.
+     * \param loc_to_line_grid A sparse grid mapping cells to all line segments of (at least) \p boundary in those cells
+     * \param startPoint From where the move starts. Must differ from \p endPoint.
+     * \param endPoint Where the move ends.
+     * \return Whether the move crosses the boundary.
+     */
+    static bool collidesWithBoundary(const Polygons& boundary, const LocToLineGrid& loc_to_line_grid, Point startPoint, Point endPoint)
+    {
+        LinePolygonsCrossings linePolygonsCrossings(boundary, loc_to_line_grid, startPoint, endPoint, 0);
+        return linePolygonsCrossings.lineSegmentCollidesWithBoundary();
+    }
 };
 
 }//namespace cura
@@ -16,7 +16,7 @@ class GCodeExport;
  */
 struct NozzleTempInsert
 {
-    const unsigned int path_idx; //!< The path before which to insert this command
+    unsigned int path_idx; //!< The path before which to insert this command
     double time_after_path_start; //!< The time after the start of the path, before which to insert the command // TODO: use this to insert command in between moves in a path!
     int extruder; //!< The extruder for which to set the temp
     double temperature; //!< The temperature of the temperature command to insert
@@ -2,6 +2,7 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <cassert>
+#include <cmath> //For abs.
 
 #include "Progress.h"
 #include "../Application.h" //To get the communication channel to send progress through.
@@ -34,6 +35,9 @@ std::string Progress::names [] =
 
 double Progress::accumulated_times [N_PROGRESS_STAGES] = {-1};
 double Progress::total_timing = -1;
+constexpr float Progress::min_reported_change;
+float Progress::last_reported_progress = -1;
+std::mutex Progress::report_mutex;
 
 float Progress::calcOverallProgress(Stage stage, float stage_progress)
 {
@@ -57,6 +61,18 @@ void Progress::init()
 void Progress::messageProgress(Progress::Stage stage, int progress_in_stage, int progress_in_stage_max)
 {
     float percentage = calcOverallProgress(stage, float(progress_in_stage) / float(progress_in_stage_max));
+
+    std::unique_lock<std::mutex> lock(report_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+    { // another thread is reporting progress right now, so this update would be outdated soon anyway
+        return;
+    }
+    const bool stage_finished = progress_in_stage >= progress_in_stage_max;
+    if (!stage_finished && std::abs(percentage - last_reported_progress) < min_reported_change)
+    {
+        return;
+    }
+    last_reported_progress = percentage;
     Application::getInstance().communication->sendProgress(percentage);
 
     logProgress(names[(int)stage].c_str(), progress_in_stage, progress_in_stage_max, percentage);
@@ -4,6 +4,7 @@
 #ifndef PROGRESS_H
 #define PROGRESS_H
 
+#include <mutex>
 #include <string>
 
 namespace cura
@@ -40,6 +41,9 @@ private:
     static std::string names[N_PROGRESS_STAGES]; //!< name of each stage
     static double accumulated_times [N_PROGRESS_STAGES]; //!< Time past before each stage
     static double total_timing; //!< An estimate of the total time
+    static constexpr float min_reported_change = 0.001; //!< The minimal change in overall progress before it is messaged again.
+    static float last_reported_progress; //!< The overall progress which was messaged last
+    static std::mutex report_mutex; //!< Held while messaging progress, so that only one thread messages at a time
     /*!
      * Give an estimate between 0 and 1 of how far the process is.
      * 
@@ -53,6 +57,12 @@ public:
     /*!
      * Message progress over the CommandSocket and to the terminal (if the command line arg '-p' is provided).
      * 
+     * This may be called from any thread and never waits for other threads.
+     * The progress is only messaged if it changed noticeably since the last
+     * message or if a stage is finished, so that it can be called for every
+     * layer without flooding the front-end. If another thread is messaging
+     * progress at the same time, this update is dropped.
+     * 
      * \param stage The current stage of processing
      * \param progress_in_stage Any number giving the progress within the stage
      * \param progress_in_stage_max The maximal value of \p progress_in_stage
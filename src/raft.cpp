@@ -22,20 +22,24 @@ void Raft::generate(SliceDataStorage& storage)
     const coord_t distance = settings.get<coord_t>("raft_margin");
     constexpr bool include_support = true;
     constexpr bool include_prime_tower = true;
+    // The first layer outlines come from the layer outline cache, which the skirt/brim also reads from.
     storage.raftOutline = storage.getLayerOutlines(0, include_support, include_prime_tower).offset(distance, ClipperLib::jtRound);
     const coord_t shield_line_width_layer0 = settings.get<coord_t>("skirt_brim_line_width");
+    Polygons shields_raft; //The raft under the shields, added to the raft outline in a single union.
     if (storage.draft_protection_shield.size() > 0)
     {
-        Polygons draft_shield_raft = storage.draft_protection_shield.offset(shield_line_width_layer0) // start half a line width outside shield
-                                        .difference(storage.draft_protection_shield.offset(-distance - shield_line_width_layer0 / 2, ClipperLib::jtRound)); // end distance inside shield
-        storage.raftOutline = storage.raftOutline.unionPolygons(draft_shield_raft);
+        shields_raft.add(storage.draft_protection_shield.offset(shield_line_width_layer0) // start half a line width outside shield
+                            .difference(storage.draft_protection_shield.offset(-distance - shield_line_width_layer0 / 2, ClipperLib::jtRound))); // end distance inside shield
     }
     if (storage.oozeShield.size() > 0 && storage.oozeShield[0].size() > 0)
     {
         const Polygons& ooze_shield = storage.oozeShield[0];
-        Polygons ooze_shield_raft = ooze_shield.offset(shield_line_width_layer0) // start half a line width outside shield
-                                        .difference(ooze_shield.offset(-distance - shield_line_width_layer0 / 2, ClipperLib::jtRound)); // end distance inside shield
-        storage.raftOutline = storage.raftOutline.unionPolygons(ooze_shield_raft);
+        shields_raft.add(ooze_shield.offset(shield_line_width_layer0) // start half a line width outside shield
+                            .difference(ooze_shield.offset(-distance - shield_line_width_layer0 / 2, ClipperLib::jtRound))); // end distance inside shield
+    }
+    if (!shields_raft.empty())
+    {
+        storage.raftOutline.unionInPlace(shields_raft);
     }
     const coord_t smoothing = settings.get<coord_t>("raft_smoothing");
     storage.raftOutline = storage.raftOutline.offset(smoothing, ClipperLib::jtRound).offset(-smoothing, ClipperLib::jtRound); // remove small holes and smooth inward corners
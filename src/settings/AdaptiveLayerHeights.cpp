@@ -62,7 +62,10 @@ void AdaptiveLayerHeights::calculateLayers()
     const coord_t minimum_layer_height = *std::min_element(allowed_layer_heights.begin(), allowed_layer_heights.end());
     Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     SlicingTolerance slicing_tolerance = mesh_group_settings.get<SlicingTolerance>("slicing_tolerance");
-    std::vector<size_t> triangles_of_interest;
+    std::vector<size_t> triangles_of_interest; // of the thickest potential layer, sorted by the bottom of the triangles
+    std::vector<int> prefix_min_z_values; // the bottom of each of the triangles of interest
+    std::vector<double> prefix_minimum_slopes; // the minimum slope of the triangles of interest up to each index
+    size_t triangle_of_interest_count = 0; // how many of the triangles of interest intersect the current potential layer
     coord_t z_level = 0;
     coord_t previous_layer_height = 0;
 
@@ -75,8 +78,10 @@ void AdaptiveLayerHeights::calculateLayers()
     previous_layer_height = adaptive_layer->layer_height;
     layers.push_back(*adaptive_layer);
 
+    ZIntervalIndex::Sweep face_sweep(face_z_index);
+
     // loop while triangles are found
-    while (!triangles_of_interest.empty() || layers.size() < 2)
+    while (triangle_of_interest_count > 0 || layers.size() < 2)
     {
         double global_min_slope = std::numeric_limits<double>::max();
         int layer_height_for_global_min_slope = 0;
@@ -92,50 +97,42 @@ void AdaptiveLayerHeights::calculateLayers()
             if (layer_height == allowed_layer_heights[0])
             {
                 // this is the max layer thickness, search through all of the triangles in the mesh to find those
-                // that intersect with a layer this thick
-                triangles_of_interest.clear();
+                // that intersect with a layer this thick. The bounds only go up, so we can sweep through the index
+                triangles_of_interest = face_sweep.advance(lower_bound, upper_bound);
 
-                for (size_t i = 0; i < face_min_z_values.size(); ++i)
+                // the thinner layers only keep the triangles that start below their upper bound, which is a prefix
+                // of the triangles sorted by their bottom. Keep the minimum slope of every prefix, so that the
+                // thinner layers can look up their minimum slope instead of filtering and scanning the triangles.
+                std::sort(triangles_of_interest.begin(), triangles_of_interest.end(), [this](const size_t a, const size_t b)
+                {
+                    return face_min_z_values[a] < face_min_z_values[b];
+                });
+                prefix_min_z_values.clear();
+                prefix_minimum_slopes.clear();
+                double minimum_slope = std::numeric_limits<double>::max();
+                for (const size_t triangle_index : triangles_of_interest)
                 {
-                    if (face_min_z_values[i] <= upper_bound && face_max_z_values[i] >= lower_bound)
-                    {
-                        triangles_of_interest.push_back(i);
-                    }
+                    minimum_slope = std::min(minimum_slope, face_slopes[triangle_index]);
+                    prefix_min_z_values.push_back(face_min_z_values[triangle_index]);
+                    prefix_minimum_slopes.push_back(minimum_slope);
                 }
+                triangle_of_interest_count = triangles_of_interest.size();
             }
             else
             {
-                // this is a reduced thickness layer, just search those triangles that intersected with the layer
-                // in the previous iteration
-                std::vector<size_t> last_triangles_of_interest = triangles_of_interest;
-
-                triangles_of_interest.clear();
-
-                for (size_t i : last_triangles_of_interest)
-                {
-                    if (face_min_z_values[i] <= upper_bound)
-                    {
-                        triangles_of_interest.push_back(i);
-                    }
-                }
+                // this is a reduced thickness layer, just count those triangles of the thickest layer that start
+                // below the upper bound of this one
+                triangle_of_interest_count = std::upper_bound(prefix_min_z_values.begin(), prefix_min_z_values.end(), upper_bound) - prefix_min_z_values.begin();
             }
 
             // when there not interesting triangles in this potential layer go to the next one
-            if (triangles_of_interest.empty())
+            if (triangle_of_interest_count == 0)
             {
                 break;
             }
 
             // find the minimum slope of all the interesting triangles
-            double minimum_slope = std::numeric_limits<double>::max();
-            for (const int& triangle_index : triangles_of_interest)
-            {
-                const double slope = face_slopes.at(triangle_index);
-                if (minimum_slope > slope)
-                {
-                    minimum_slope = slope;
-                }
-            }
+            const double minimum_slope = prefix_minimum_slopes[triangle_of_interest_count - 1];
             if (global_min_slope > minimum_slope)
             {
                 global_min_slope = minimum_slope;
@@ -174,7 +171,7 @@ void AdaptiveLayerHeights::calculateLayers()
         }
 
         // stop calculating when we're out of triangles (e.g. above the mesh)
-        if (triangles_of_interest.empty())
+        if (triangle_of_interest_count == 0)
         {
             break;
         }
@@ -193,7 +190,10 @@ void AdaptiveLayerHeights::calculateLayers()
 
 void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
 {
-    // loop over all mesh faces (triangles) and find their slopes
+    // find where the faces of each printable mesh start, so that all faces can be processed in parallel
+    std::vector<const Mesh*> printable_meshes;
+    std::vector<size_t> mesh_face_offsets;
+    size_t face_count = 0;
     for (const Mesh& mesh : Application::getInstance().current_slice->scene.current_mesh_group->meshes)
     {
         // Skip meshes that are not printable
@@ -201,9 +201,25 @@ void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
         {
             continue;
         }
+        printable_meshes.push_back(&mesh);
+        mesh_face_offsets.push_back(face_count);
+        face_count += mesh.faces.size();
+    }
+
+    face_min_z_values.resize(face_count);
+    face_max_z_values.resize(face_count);
+    face_slopes.resize(face_count);
 
-        for (const MeshFace& face : mesh.faces)
+    // loop over all mesh faces (triangles) and find their slopes
+    for (size_t mesh_idx = 0; mesh_idx < printable_meshes.size(); mesh_idx++)
+    {
+        const Mesh& mesh = *printable_meshes[mesh_idx];
+        const size_t face_offset = mesh_face_offsets[mesh_idx];
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+#pragma omp parallel for shared(mesh) schedule(static)
+        for (int face_idx = 0; face_idx < static_cast<int>(mesh.faces.size()); face_idx++)
         {
+            const MeshFace& face = mesh.faces[face_idx];
             const MeshVertex& v0 = mesh.vertices[face.vertex_index[0]];
             const MeshVertex& v1 = mesh.vertices[face.vertex_index[1]];
             const MeshVertex& v2 = mesh.vertices[face.vertex_index[2]];
@@ -230,11 +246,18 @@ void AdaptiveLayerHeights::calculateMeshTriangleSlopes()
                 z_angle = M_PI;
             }
 
-            face_min_z_values.push_back(min_z * 1000);
-            face_max_z_values.push_back(max_z * 1000);
-            face_slopes.push_back(z_angle);
+            face_min_z_values[face_offset + face_idx] = min_z * 1000;
+            face_max_z_values[face_offset + face_idx] = max_z * 1000;
+            face_slopes[face_offset + face_idx] = z_angle;
         }
     }
+
+    face_z_index.reserve(face_slopes.size());
+    for (size_t face_idx = 0; face_idx < face_slopes.size(); face_idx++)
+    {
+        face_z_index.insert(face_min_z_values[face_idx], face_max_z_values[face_idx], face_idx);
+    }
+    face_z_index.finalize();
 }
 
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@
 #define ADAPTIVELAYERHEIGHTS_H
 
 #include "../utils/Coord_t.h"
+#include "../utils/ZIntervalIndex.h"
 
 namespace cura {
 
@@ -102,6 +103,12 @@ private:
     std::vector<int> face_min_z_values;
     std::vector<int> face_max_z_values;
 
+    /*!
+     * Index of the height ranges of all faces, to quickly find the faces
+     * that intersect with a potential layer.
+     */
+    ZIntervalIndex face_z_index;
+
     /*!
      * Calculate the allowed layer heights depending on variation and step input
      */
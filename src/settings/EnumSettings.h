@@ -190,6 +190,17 @@ enum class EGCodeFlavor
  * Real RepRap GCode suitable for printers using RepRap firmware (e.g. Duet controllers)
  **/
     REPRAP = 8,
+
+/**
+ * Marlin based GCode where the moves are written in a compact binary form.
+ *  Everything but the G0 and G1 moves is written as text lines like the Marlin flavor.
+ *  Each move is a record which starts with a byte of 128 or more, so it can be told apart from a text line:
+ *   bit 6 is set for G1 and cleared for G0, bit 0 marks an F value, bit 1 a Z value and bit 2 an E value.
+ *  That byte is followed by the F value if present, the X and Y values, and the Z and E values if present.
+ *  F is in tenths of mm/min. X, Y and Z are in microns and E in 10^-5 mm, as the difference with the value in the previous record that had them.
+ *  All numbers are LEB128 varints, where X, Y, Z and E are zigzag encoded.
+ **/
+    BINARY = 9,
 };
 
 } //Cura namespace.
@@ -1,6 +1,8 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For lower_bound.
+
 #include "FlowTempGraph.h"
 #include "../utils/logoutput.h"
 
@@ -22,15 +24,12 @@ double FlowTempGraph::getTemp(const double flow, const Temperature material_prin
         logWarning("Warning! Flow too low!\n"); // TODO
         return data.front().temp;
     }
-    const Datum* last_datum = &data.front();
-    for (unsigned int datum_idx = 1; datum_idx < data.size(); datum_idx++)
+    //The data is ordered by flow, so find the first datum with at least the requested flow by bisection.
+    const std::vector<Datum>::const_iterator datum = std::lower_bound(data.begin() + 1, data.end(), flow, [](const Datum& candidate, const double target_flow) { return candidate.flow < target_flow; });
+    if (datum != data.end())
     {
-        const Datum& datum = data[datum_idx];
-        if (datum.flow >= flow)
-        {
-            return last_datum->temp + Temperature((datum.temp - last_datum->temp) * (flow - last_datum->flow) / (datum.flow - last_datum->flow));
-        }
-        last_datum = &datum;
+        const Datum& last_datum = *(datum - 1);
+        return last_datum.temp + Temperature((datum->temp - last_datum.temp) * (flow - last_datum.flow) / (datum->flow - last_datum.flow));
     }
 
     logWarning("Warning! Flow too high!\n"); // TODO
@@ -26,7 +26,7 @@ public:
         {}
     };
 
-    std::vector<Datum> data; //!< The points of the graph between which the graph is linearly interpolated
+    std::vector<Datum> data; //!< The points of the graph between which the graph is linearly interpolated, ordered by flow
 
     /*!
      * Get the temperature corresponding to a specific flow.
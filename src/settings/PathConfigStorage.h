@@ -32,8 +32,14 @@ private:
     const ExtruderTrain& support_bottom_train;
 
     const std::vector<Ratio> line_width_factor_per_extruder;
-    static std::vector<Ratio> getLineWidthFactorPerExtruder(const LayerIndex& layer_nr);
 public:
+    /*!
+     * Get the factor with which the line widths of each extruder are multiplied on a layer.
+     * \param layer_nr The layer to get the factors for.
+     * \return For each extruder, the line width factor.
+     */
+    static std::vector<Ratio> getLineWidthFactorPerExtruder(const LayerIndex& layer_nr);
+
     class MeshPathConfigs
     {
     public:
@@ -0,0 +1,130 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "SettingDependencies.h"
+#include "Settings.h"
+#include "SettingsRecorder.h"
+#include "../Application.h"
+#include "../ExtruderTrain.h"
+#include "../Slice.h"
+#include "../utils/BinaryBuffer.h"
+
+namespace cura
+{
+
+bool SettingDependencies::record(const SettingsRecorder& recorder, const Settings& mesh_settings)
+{
+    const Scene& scene = Application::getInstance().current_slice->scene;
+    dependencies.clear();
+    for (const std::pair<const Settings*, size_t>& read : recorder.getReads())
+    {
+        Dependency dependency;
+        dependency.extruder_nr = 0;
+        dependency.key_id = read.second;
+        if (read.first == &mesh_settings)
+        {
+            dependency.source = Source::MESH;
+        }
+        else if (read.first == &scene.current_mesh_group->settings)
+        {
+            dependency.source = Source::MESH_GROUP;
+        }
+        else if (read.first == &scene.settings)
+        {
+            dependency.source = Source::SCENE;
+        }
+        else
+        {
+            dependency.source = Source::EXTRUDER;
+            while (dependency.extruder_nr < scene.extruders.size() && read.first != &scene.extruders[dependency.extruder_nr].settings)
+            {
+                dependency.extruder_nr++;
+            }
+            if (dependency.extruder_nr == scene.extruders.size()) //Read from some other settings container, which a later slice can't be compared with.
+            {
+                dependencies.clear();
+                return false;
+            }
+        }
+        const std::string* value = read.first->getSerialised(read.second);
+        dependency.value = value ? *value : std::string();
+        dependencies.push_back(std::move(dependency));
+    }
+    return true;
+}
+
+bool SettingDependencies::match(const Settings& mesh_settings) const
+{
+    for (const Dependency& dependency : dependencies)
+    {
+        const Settings* settings = getSettings(dependency.source, dependency.extruder_nr, mesh_settings);
+        if (!settings)
+        {
+            return false;
+        }
+        const std::string* value = settings->getSerialised(dependency.key_id);
+        if ((value ? *value : std::string()) != dependency.value) //A setting without a value was recorded as empty.
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SettingDependencies::serialise(BinaryWriter& writer) const
+{
+    writer.writeUnsigned(dependencies.size());
+    for (const Dependency& dependency : dependencies)
+    {
+        writer.writeUnsigned(static_cast<uint64_t>(dependency.source));
+        writer.writeUnsigned(dependency.extruder_nr);
+        writer.writeString(SettingKey::getName(dependency.key_id));
+        writer.writeString(dependency.value);
+    }
+}
+
+bool SettingDependencies::deserialise(BinaryReader& reader)
+{
+    dependencies.clear();
+    uint64_t count;
+    if (!reader.readUnsigned(count))
+    {
+        return false;
+    }
+    for (uint64_t dependency_idx = 0; dependency_idx < count; dependency_idx++)
+    {
+        uint64_t source;
+        uint64_t extruder_nr;
+        std::string name;
+        Dependency dependency;
+        if (!reader.readUnsigned(source) || source > static_cast<uint64_t>(Source::EXTRUDER) || !reader.readUnsigned(extruder_nr) || !reader.readString(name) || !reader.readString(dependency.value))
+        {
+            dependencies.clear();
+            return false;
+        }
+        dependency.source = static_cast<Source>(source);
+        dependency.extruder_nr = extruder_nr;
+        dependency.key_id = SettingKey(name).getId();
+        dependencies.push_back(std::move(dependency));
+    }
+    return true;
+}
+
+const Settings* SettingDependencies::getSettings(const Source source, const size_t extruder_nr, const Settings& mesh_settings)
+{
+    const Scene& scene = Application::getInstance().current_slice->scene;
+    switch (source)
+    {
+        case Source::MESH:
+            return &mesh_settings;
+        case Source::MESH_GROUP:
+            return &scene.current_mesh_group->settings;
+        case Source::SCENE:
+            return &scene.settings;
+        case Source::EXTRUDER:
+        default:
+            return extruder_nr < scene.extruders.size() ? &scene.extruders[extruder_nr].settings : nullptr;
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,98 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SETTINGS_SETTING_DEPENDENCIES_H
+#define SETTINGS_SETTING_DEPENDENCIES_H
+
+#include <string>
+#include <vector>
+
+namespace cura
+{
+
+class BinaryReader;
+class BinaryWriter;
+class Settings;
+class SettingsRecorder;
+
+/*!
+ * \brief The settings that the result of a computation for a mesh depends on,
+ * with the values they had.
+ *
+ * The settings are kept by where they were read from: the mesh itself, its
+ * mesh group, the scene or one of the extruders. That way they can be compared
+ * with the settings of a later slice, which has new settings containers.
+ */
+class SettingDependencies
+{
+public:
+    /*!
+     * \brief Take the settings that a recorder recorded, with their current
+     * values.
+     * \param recorder The recorder that was active during the computation.
+     * \param mesh_settings The settings of the mesh that the computation was
+     * for.
+     * \return Whether all settings were read from the mesh, its mesh group, the
+     * scene or an extruder. If not, it can't be checked whether the result of
+     * the computation may be reused.
+     */
+    bool record(const SettingsRecorder& recorder, const Settings& mesh_settings);
+
+    /*!
+     * \brief Check whether all settings still have the same values in the
+     * current slice.
+     * \param mesh_settings The settings of the mesh in the current slice.
+     */
+    bool match(const Settings& mesh_settings) const;
+
+    /*!
+     * \brief Write the settings, so that they can be compared with the
+     * settings of another run of the engine.
+     *
+     * The settings are written by name, since the IDs of settings differ
+     * between runs.
+     */
+    void serialise(BinaryWriter& writer) const;
+
+    /*!
+     * \brief Read settings that were written with \ref serialise.
+     * \return Whether the settings could be read.
+     */
+    bool deserialise(BinaryReader& reader);
+
+private:
+    /*!
+     * \brief Where a setting was read from.
+     */
+    enum class Source
+    {
+        MESH,
+        MESH_GROUP,
+        SCENE,
+        EXTRUDER
+    };
+
+    /*!
+     * \brief A setting that was read, with its value.
+     */
+    struct Dependency
+    {
+        Source source; //!< Which settings container it was read from.
+        size_t extruder_nr; //!< If it was read from an extruder, which extruder.
+        size_t key_id; //!< The ID of the setting.
+        std::string value; //!< The serialised value that was read.
+    };
+
+    /*!
+     * \brief Get the settings container of a source in the current slice.
+     * \return The settings container, or nullptr if the current slice has no
+     * such extruder.
+     */
+    static const Settings* getSettings(const Source source, const size_t extruder_nr, const Settings& mesh_settings);
+
+    std::vector<Dependency> dependencies; //!< The settings that were read.
+};
+
+} //namespace cura
+
+#endif //SETTINGS_SETTING_DEPENDENCIES_H
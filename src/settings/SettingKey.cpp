@@ -0,0 +1,138 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <cstdlib> //For exit.
+#include <mutex>
+
+#include "SettingKey.h"
+#include "../utils/logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+/*!
+ * \brief An interned setting name.
+ */
+struct InternedName
+{
+    InternedName(const uint64_t hash, const char* name, const size_t length, const size_t id)
+    : hash(hash)
+    , name(name, length)
+    , id(id)
+    {
+    }
+
+    uint64_t hash; //!< The hash of the name.
+    std::string name; //!< The name itself.
+    size_t id; //!< The ID assigned to this name.
+};
+
+/*!
+ * \brief The table of all interned setting names.
+ *
+ * Names are never removed, so the table is an open-addressing hash table
+ * that can be read without locking. Only inserting takes a lock.
+ */
+struct NameTable
+{
+    static constexpr size_t capacity = MAX_SETTING_KEYS * 2; //Keep the load factor below 0.5 so that probe sequences stay short. Must be a power of two.
+
+    std::atomic<const InternedName*> slots[capacity]; //!< The hash table, storing the names by their hash.
+    std::atomic<const InternedName*> by_id[MAX_SETTING_KEYS]; //!< The same names, by their ID.
+    size_t count; //!< The number of interned names. Only accessed while holding the lock.
+    std::mutex insert_mutex; //!< Lock for inserting new names.
+
+    NameTable()
+    : count(0)
+    {
+        for (std::atomic<const InternedName*>& slot : slots)
+        {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+        for (std::atomic<const InternedName*>& slot : by_id)
+        {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+NameTable& getNameTable()
+{
+    static NameTable table; //Avoids depending on the initialisation order of static objects in different translation units.
+    return table;
+}
+
+/*!
+ * \brief Find the slot in the table where this name is or should be stored.
+ * \return The slot index, and the name that's in it (or nullptr if it's not
+ * interned yet).
+ */
+const InternedName* probe(const NameTable& table, const uint64_t hash, const char* name, const size_t length, size_t& slot_idx)
+{
+    slot_idx = hash & (NameTable::capacity - 1);
+    while (true)
+    {
+        const InternedName* entry = table.slots[slot_idx].load(std::memory_order_acquire);
+        if (!entry || (entry->hash == hash && entry->name.size() == length && entry->name.compare(0, length, name, length) == 0))
+        {
+            return entry;
+        }
+        slot_idx = (slot_idx + 1) & (NameTable::capacity - 1);
+    }
+}
+} //Anonymous namespace.
+
+SettingKey::SettingKey(const std::string& name)
+: name(name.c_str())
+, length(name.size())
+, hash(hashRuntime(name.c_str(), name.size()))
+{
+}
+
+uint64_t SettingKey::hashRuntime(const char* name, const size_t length)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(name[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t SettingKey::getId() const
+{
+    NameTable& table = getNameTable();
+    size_t slot_idx;
+    const InternedName* entry = probe(table, hash, name, length, slot_idx);
+    if (entry)
+    {
+        return entry->id;
+    }
+
+    std::lock_guard<std::mutex> lock(table.insert_mutex);
+    entry = probe(table, hash, name, length, slot_idx); //Another thread may have inserted it in the meanwhile.
+    if (entry)
+    {
+        return entry->id;
+    }
+    if (table.count >= MAX_SETTING_KEYS)
+    {
+        logError("Too many different settings. The maximum is %d.\n", MAX_SETTING_KEYS);
+        std::exit(1);
+    }
+    const InternedName* interned = new InternedName(hash, name, length, table.count); //Never deleted. The names are needed for the entire lifetime of the application.
+    table.by_id[table.count].store(interned, std::memory_order_release);
+    table.count++;
+    table.slots[slot_idx].store(interned, std::memory_order_release);
+    return interned->id;
+}
+
+const std::string& SettingKey::getName(const size_t id)
+{
+    return getNameTable().by_id[id].load(std::memory_order_acquire)->name;
+}
+
+} //namespace cura
@@ -0,0 +1,136 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SETTINGS_SETTING_KEY_H
+#define SETTINGS_SETTING_KEY_H
+
+#include <cstdint> //For uint64_t.
+#include <cstring> //For strlen.
+#include <string>
+#include <type_traits> //For enable_if.
+
+//Maximum number of distinct setting names that can be used during the lifetime of the application.
+#define MAX_SETTING_KEYS 8192
+
+namespace cura
+{
+
+namespace setting_key_detail
+{
+/*!
+ * \brief FNV-1a hash of a setting name, usable at compile time.
+ * \param name The remaining part of the name to hash.
+ * \param length The number of characters remaining in the name.
+ * \param hash The hash of the part of the name that was already processed.
+ */
+constexpr uint64_t hashName(const char* name, size_t length, uint64_t hash = 14695981039346656037ull)
+{
+    return (length == 0) ? hash : hashName(name + 1, length - 1, (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull);
+}
+} //namespace setting_key_detail
+
+/*!
+ * \brief The name of a setting, in a form that's cheap to look up.
+ *
+ * A key made from a string literal gets its length and hash computed at
+ * compile time. The first time a name is looked up it gets interned and is
+ * assigned a small ID. Settings containers then store the values in a dense
+ * array indexed by those IDs, so a lookup doesn't need to allocate a string
+ * nor hash it.
+ *
+ * Keys can also be made from names that are only known at runtime, such as
+ * the names received from the front-end or read from a JSON file. Those get
+ * hashed when the key is constructed.
+ *
+ * The key only refers to the name it was constructed with. It should not
+ * outlive that name, which is why keys are normally only created as
+ * temporaries for a call to \ref Settings.
+ */
+class SettingKey
+{
+public:
+    /*!
+     * \brief Represents a setting name that is known at compile time.
+     * \param name The name of the setting.
+     */
+    template<size_t N>
+    constexpr SettingKey(const char (&name)[N])
+    : name(name)
+    , length(N - 1)
+    , hash(setting_key_detail::hashName(name, N - 1))
+    {
+    }
+
+    /*!
+     * \brief Represents a setting name in a character buffer.
+     *
+     * The buffer may not be filled completely, so this is measured at runtime.
+     * \param name The name of the setting.
+     */
+    template<size_t N>
+    SettingKey(char (&name)[N])
+    : SettingKey(static_cast<const char*>(name))
+    {
+    }
+
+    /*!
+     * \brief Represents a setting name given as C string.
+     *
+     * This is a template only to make sure that string literals always choose
+     * the compile-time constructor instead.
+     * \param name The name of the setting.
+     */
+    template<typename CharPointer, typename = typename std::enable_if<std::is_same<CharPointer, const char*>::value || std::is_same<CharPointer, char*>::value>::type>
+    SettingKey(const CharPointer& name)
+    : name(name)
+    , length(strlen(name))
+    , hash(hashRuntime(name, length))
+    {
+    }
+
+    /*!
+     * \brief Represents a setting name that is only known at runtime.
+     * \param name The name of the setting.
+     */
+    SettingKey(const std::string& name);
+
+    /*!
+     * \brief Get the interned ID of this setting name.
+     *
+     * The IDs are assigned in the order in which names are first seen, so they
+     * can be used to index a dense array. The same name always gets the same
+     * ID. This is safe to call from multiple threads.
+     * \return The ID of this setting name.
+     */
+    size_t getId() const;
+
+    /*!
+     * \brief Get the name of the setting, as null-terminated C string.
+     */
+    const char* c_str() const
+    {
+        return name;
+    }
+
+    /*!
+     * \brief Get the name that belongs to an interned setting ID.
+     * \param id An ID previously returned by \ref getId.
+     * \return The name of the setting with that ID.
+     */
+    static const std::string& getName(const size_t id);
+
+private:
+    const char* name; //!< The name of the setting. Not owned by this key.
+    size_t length; //!< The number of characters in the name.
+    uint64_t hash; //!< The hash of the name.
+
+    /*!
+     * \brief Hash a name at runtime, giving the same result as the
+     * compile-time hash.
+     */
+    static uint64_t hashRuntime(const char* name, const size_t length);
+};
+
+} //namespace cura
+
+#endif //SETTINGS_SETTING_KEY_H
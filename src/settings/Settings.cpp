@@ -11,6 +11,7 @@
 #include "EnumSettings.h"
 #include "FlowTempGraph.h"
 #include "Settings.h"
+#include "SettingsRecorder.h" //To record which settings are read.
 #include "types/AngleDegrees.h" //For angle settings.
 #include "types/AngleRadians.h" //For angle settings.
 #include "types/Duration.h" //For duration and time settings.
@@ -21,6 +22,7 @@
 #include "../Application.h" //To get the extruders.
 #include "../ExtruderTrain.h"
 #include "../Slice.h"
+#include "../utils/BinaryBuffer.h" //For serialising the settings.
 #include "../utils/floatpoint.h" //For FMatrix3x3.
 #include "../utils/logoutput.h"
 #include "../utils/string.h" //For Escaped.
@@ -33,65 +35,109 @@ Settings::Settings()
     parent = nullptr; //Needs to be properly initialised because we check against this if the parent is not set.
 }
 
-void Settings::add(const std::string& key, const std::string value)
+Settings::SettingValue::SettingValue(const std::string& value)
+: value(value)
+, number(atof(value.c_str()))
+, integer(atoi(value.c_str()))
+, boolean(value == "on" || value == "yes" || value == "true" || value == "True" || integer != 0)
 {
-    if (settings.find(key) != settings.end()) //Already exists.
+}
+
+constexpr uint32_t Settings::NO_VALUE;
+
+void Settings::add(const SettingKey& key, const std::string value)
+{
+    const size_t key_id = key.getId();
+    if (key_id >= setting_index.size())
     {
-        settings[key] = value;
+        setting_index.resize(key_id + 1, NO_VALUE);
+    }
+    if (setting_index[key_id] != NO_VALUE) //Already exists.
+    {
+        settings[setting_index[key_id]].second = SettingValue(value);
     }
     else //New setting.
     {
-        settings.emplace(key, value);
+        setting_index[key_id] = settings.size();
+        settings.emplace_back(key_id, SettingValue(value));
+    }
+}
+
+const Settings::SettingValue* Settings::find(const size_t key_id) const
+{
+    if (key_id >= setting_index.size() || setting_index[key_id] == NO_VALUE)
+    {
+        return nullptr;
+    }
+    return &settings[setting_index[key_id]].second;
+}
+
+const Settings::SettingValue& Settings::getValue(const SettingKey& key) const
+{
+    const size_t key_id = key.getId();
+    SettingsRecorder::recordRead(this, key_id);
+
+    const SettingValue* value = resolve(key_id, true);
+    if (!value)
+    {
+        logError("Trying to retrieve setting with no value given: '%s'\n", key.c_str());
+        std::exit(2);
     }
+    return *value;
 }
 
-template<> std::string Settings::get<std::string>(const std::string& key) const
+const Settings::SettingValue* Settings::resolve(const size_t key_id, const bool limit_to_extruder) const
 {
     //If this settings base has a setting value for it, look that up.
-    if (settings.find(key) != settings.end())
+    const SettingValue* own_value = find(key_id);
+    if (own_value)
     {
-        return settings.at(key);
+        return own_value;
     }
 
-    const std::unordered_map<std::string, ExtruderTrain*>& limit_to_extruder = Application::getInstance().current_slice->scene.limit_to_extruder;
-    if (limit_to_extruder.find(key) != limit_to_extruder.end())
+    if (limit_to_extruder)
     {
-        return limit_to_extruder.at(key)->settings.getWithoutLimiting(key);
+        const std::unordered_map<size_t, ExtruderTrain*>& limits = Application::getInstance().current_slice->scene.limit_to_extruder;
+        if (!limits.empty())
+        {
+            std::unordered_map<size_t, ExtruderTrain*>::const_iterator limited_extruder = limits.find(key_id);
+            if (limited_extruder != limits.end())
+            {
+                return limited_extruder->second->settings.resolve(key_id, false);
+            }
+        }
     }
 
     if (parent)
     {
-        return parent->get<std::string>(key);
+        return parent->resolve(key_id, true);
     }
+    return nullptr;
+}
 
-    logError("Trying to retrieve setting with no value given: '%s'\n", key.c_str());
-    std::exit(2);
+template<> std::string Settings::get<std::string>(const SettingKey& key) const
+{
+    return getValue(key).value;
 }
 
-template<> double Settings::get<double>(const std::string& key) const
+template<> double Settings::get<double>(const SettingKey& key) const
 {
-    return atof(get<std::string>(key).c_str());
+    return getValue(key).number;
 }
 
-template<> size_t Settings::get<size_t>(const std::string& key) const
+template<> size_t Settings::get<size_t>(const SettingKey& key) const
 {
-    return std::stoul(get<std::string>(key).c_str());
+    return std::stoul(getValue(key).value.c_str());
 }
 
-template<> bool Settings::get<bool>(const std::string& key) const
+template<> bool Settings::get<bool>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
-    if (value == "on" || value == "yes" || value == "true" || value == "True")
-    {
-        return true;
-    }
-    const int num = atoi(value.c_str());
-    return num != 0;
+    return getValue(key).boolean;
 }
 
-template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const std::string& key) const
+template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const SettingKey& key) const
 {
-    int extruder_nr = std::atoi(get<std::string>(key).c_str());
+    int extruder_nr = getValue(key).integer;
     if (extruder_nr < 0)
     {
         extruder_nr = get<size_t>("extruder_nr");
@@ -99,49 +145,49 @@ template<> ExtruderTrain& Settings::get<ExtruderTrain&>(const std::string& key)
     return Application::getInstance().current_slice->scene.extruders[extruder_nr];
 }
 
-template<> LayerIndex Settings::get<LayerIndex>(const std::string& key) const
+template<> LayerIndex Settings::get<LayerIndex>(const SettingKey& key) const
 {
-    return std::atoi(get<std::string>(key).c_str()) - 1; //For the user we display layer numbers starting from 1, but we start counting from 0. Still it may be negative for Raft layers.
+    return getValue(key).integer - 1; //For the user we display layer numbers starting from 1, but we start counting from 0. Still it may be negative for Raft layers.
 }
 
-template<> coord_t Settings::get<coord_t>(const std::string& key) const
+template<> coord_t Settings::get<coord_t>(const SettingKey& key) const
 {
     return MM2INT(get<double>(key)); //The settings are all in millimetres, but we need to interpret them as microns.
 }
 
-template<> AngleRadians Settings::get<AngleRadians>(const std::string& key) const
+template<> AngleRadians Settings::get<AngleRadians>(const SettingKey& key) const
 {
     return get<double>(key) * M_PI / 180; //The settings are all in degrees, but we need to interpret them as radians.
 }
 
-template<> AngleDegrees Settings::get<AngleDegrees>(const std::string& key) const
+template<> AngleDegrees Settings::get<AngleDegrees>(const SettingKey& key) const
 {
     return get<double>(key);
 }
 
-template<> Temperature Settings::get<Temperature>(const std::string& key) const
+template<> Temperature Settings::get<Temperature>(const SettingKey& key) const
 {
     return get<double>(key);
 }
 
-template<> Velocity Settings::get<Velocity>(const std::string& key) const
+template<> Velocity Settings::get<Velocity>(const SettingKey& key) const
 {
     return get<double>(key);
 }
 
-template<> Ratio Settings::get<Ratio>(const std::string& key) const
+template<> Ratio Settings::get<Ratio>(const SettingKey& key) const
 {
     return get<double>(key) / 100.0; //The settings are all in percentages, but we need to interpret them as radians.
 }
 
-template<> Duration Settings::get<Duration>(const std::string& key) const
+template<> Duration Settings::get<Duration>(const SettingKey& key) const
 {
     return get<double>(key);
 }
 
-template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation>(const std::string& key) const
+template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "limited")
     {
         return DraftShieldHeightLimitation::LIMITED;
@@ -152,7 +198,7 @@ template<> DraftShieldHeightLimitation Settings::get<DraftShieldHeightLimitation
     }
 }
 
-template<> FlowTempGraph Settings::get<FlowTempGraph>(const std::string& key) const
+template<> FlowTempGraph Settings::get<FlowTempGraph>(const SettingKey& key) const
 {
     std::string value_string = get<std::string>(key);
 
@@ -199,7 +245,7 @@ template<> FlowTempGraph Settings::get<FlowTempGraph>(const std::string& key) co
     return result;
 }
 
-template<> FMatrix3x3 Settings::get<FMatrix3x3>(const std::string& key) const
+template<> FMatrix3x3 Settings::get<FMatrix3x3>(const SettingKey& key) const
 {
     const std::string value_string = get<std::string>(key);
 
@@ -238,9 +284,9 @@ template<> FMatrix3x3 Settings::get<FMatrix3x3>(const std::string& key) const
     return result;
 }
 
-template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const std::string& key) const
+template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     //I wish that switch statements worked for std::string...
     if (value == "Griffin")
     {
@@ -274,13 +320,17 @@ template<> EGCodeFlavor Settings::get<EGCodeFlavor>(const std::string& key) cons
     {
         return EGCodeFlavor::REPRAP;
     }
+    else if (value == "Binary")
+    {
+        return EGCodeFlavor::BINARY;
+    }
     //Default:
     return EGCodeFlavor::MARLIN;
 }
 
-template<> EFillMethod Settings::get<EFillMethod>(const std::string& key) const
+template<> EFillMethod Settings::get<EFillMethod>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "lines")
     {
         return EFillMethod::LINES;
@@ -339,9 +389,9 @@ template<> EFillMethod Settings::get<EFillMethod>(const std::string& key) const
     }
 }
 
-template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const std::string& key) const
+template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "brim")
     {
         return EPlatformAdhesion::BRIM;
@@ -360,9 +410,9 @@ template<> EPlatformAdhesion Settings::get<EPlatformAdhesion>(const std::string&
     }
 }
 
-template<> ESupportType Settings::get<ESupportType>(const std::string& key) const
+template<> ESupportType Settings::get<ESupportType>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "everywhere")
     {
         return ESupportType::EVERYWHERE;
@@ -377,9 +427,9 @@ template<> ESupportType Settings::get<ESupportType>(const std::string& key) cons
     }
 }
 
-template<> EZSeamType Settings::get<EZSeamType>(const std::string& key) const
+template<> EZSeamType Settings::get<EZSeamType>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "random")
     {
         return EZSeamType::RANDOM;
@@ -398,9 +448,9 @@ template<> EZSeamType Settings::get<EZSeamType>(const std::string& key) const
     }
 }
 
-template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const std::string& key) const
+template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "z_seam_corner_inner")
     {
         return EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_INNER;
@@ -419,9 +469,9 @@ template<> EZSeamCornerPrefType Settings::get<EZSeamCornerPrefType>(const std::s
     }
 }
 
-template<> ESurfaceMode Settings::get<ESurfaceMode>(const std::string& key) const
+template<> ESurfaceMode Settings::get<ESurfaceMode>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "surface")
     {
         return ESurfaceMode::SURFACE;
@@ -436,9 +486,9 @@ template<> ESurfaceMode Settings::get<ESurfaceMode>(const std::string& key) cons
     }
 }
 
-template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const std::string& key) const
+template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const SettingKey& key) const
 {
-    if (get<std::string>(key) == "everywhere")
+    if (getValue(key).value == "everywhere")
     {
         return FillPerimeterGapMode::EVERYWHERE;
     }
@@ -448,9 +498,9 @@ template<> FillPerimeterGapMode Settings::get<FillPerimeterGapMode>(const std::s
     }
 }
 
-template<> BuildPlateShape Settings::get<BuildPlateShape>(const std::string& key) const
+template<> BuildPlateShape Settings::get<BuildPlateShape>(const SettingKey& key) const
 {
-    if (get<std::string>(key) == "elliptic")
+    if (getValue(key).value == "elliptic")
     {
         return BuildPlateShape::ELLIPTIC;
     }
@@ -460,9 +510,9 @@ template<> BuildPlateShape Settings::get<BuildPlateShape>(const std::string& key
     }
 }
 
-template<> CombingMode Settings::get<CombingMode>(const std::string& key) const
+template<> CombingMode Settings::get<CombingMode>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "off")
     {
         return CombingMode::OFF;
@@ -481,9 +531,9 @@ template<> CombingMode Settings::get<CombingMode>(const std::string& key) const
     }
 }
 
-template<> SupportDistPriority Settings::get<SupportDistPriority>(const std::string& key) const
+template<> SupportDistPriority Settings::get<SupportDistPriority>(const SettingKey& key) const
 {
-    if (get<std::string>(key) == "z_overrides_xy")
+    if (getValue(key).value == "z_overrides_xy")
     {
         return SupportDistPriority::Z_OVERRIDES_XY;
     }
@@ -493,9 +543,9 @@ template<> SupportDistPriority Settings::get<SupportDistPriority>(const std::str
     }
 }
 
-template<> SlicingTolerance Settings::get<SlicingTolerance>(const std::string& key) const
+template<> SlicingTolerance Settings::get<SlicingTolerance>(const SettingKey& key) const
 {
-    const std::string& value = get<std::string>(key);
+    const std::string& value = getValue(key).value;
     if (value == "inclusive")
     {
         return SlicingTolerance::INCLUSIVE;
@@ -510,9 +560,9 @@ template<> SlicingTolerance Settings::get<SlicingTolerance>(const std::string& k
     }
 }
 
-template<> std::vector<double> Settings::get<std::vector<double>>(const std::string& key) const
+template<> std::vector<double> Settings::get<std::vector<double>>(const SettingKey& key) const
 {
-    const std::string& value_string = get<std::string>(key);
+    const std::string& value_string = getValue(key).value;
 
     std::vector<double> result;
     if (value_string.empty())
@@ -551,7 +601,7 @@ template<> std::vector<double> Settings::get<std::vector<double>>(const std::str
     return result;
 }
 
-template<> std::vector<int> Settings::get<std::vector<int>>(const std::string& key) const
+template<> std::vector<int> Settings::get<std::vector<int>>(const SettingKey& key) const
 {
     std::vector<double> values_doubles = get<std::vector<double>>(key);
     std::vector<int> values_ints;
@@ -563,7 +613,7 @@ template<> std::vector<int> Settings::get<std::vector<int>>(const std::string& k
     return values_ints;
 }
 
-template<> std::vector<AngleDegrees> Settings::get<std::vector<AngleDegrees>>(const std::string& key) const
+template<> std::vector<AngleDegrees> Settings::get<std::vector<AngleDegrees>>(const SettingKey& key) const
 {
     std::vector<double> values_doubles = get<std::vector<double>>(key);
     return std::vector<AngleDegrees>(values_doubles.begin(), values_doubles.end()); //Cast them to AngleDegrees.
@@ -572,40 +622,78 @@ template<> std::vector<AngleDegrees> Settings::get<std::vector<AngleDegrees>>(co
 const std::string Settings::getAllSettingsString() const
 {
     std::stringstream sstream;
-    for (const std::pair<std::string, std::string> pair : settings)
+    for (const std::pair<size_t, SettingValue>& pair : settings)
     {
         char buffer[4096];
-        snprintf(buffer, 4096, " -s %s=\"%s\"", pair.first.c_str(), Escaped{pair.second.c_str()}.str);
+        snprintf(buffer, 4096, " -s %s=\"%s\"", SettingKey::getName(pair.first).c_str(), Escaped{pair.second.value.c_str()}.str);
         sstream << buffer;
     }
     return sstream.str();
 }
 
-bool Settings::has(const std::string& key) const
+void Settings::serialise(BinaryWriter& writer) const
 {
-    return settings.find(key) != settings.end();
+    writer.writeUnsigned(settings.size());
+    for (const std::pair<size_t, SettingValue>& pair : settings)
+    {
+        writer.writeString(SettingKey::getName(pair.first));
+        writer.writeString(pair.second.value);
+    }
 }
 
-void Settings::setParent(Settings* new_parent)
+bool Settings::deserialise(BinaryReader& reader)
 {
-    parent = new_parent;
+    uint64_t count;
+    if (!reader.readUnsigned(count))
+    {
+        return false;
+    }
+    std::string name;
+    std::string value;
+    for (uint64_t setting_idx = 0; setting_idx < count; setting_idx++)
+    {
+        if (!reader.readString(name) || !reader.readString(value))
+        {
+            return false;
+        }
+        add(name, value);
+    }
+    return true;
 }
 
-std::string Settings::getWithoutLimiting(const std::string& key) const
+bool Settings::has(const SettingKey& key) const
 {
-    if (settings.find(key) != settings.end())
-    {
-        return settings.at(key);
-    }
-    else if (parent)
+    const size_t key_id = key.getId();
+    SettingsRecorder::recordRead(this, key_id); //Whether an optional setting is given changes the result just like its value does.
+    return find(key_id) != nullptr;
+}
+
+bool Settings::hasSameValues(const Settings& other) const
+{
+    if (parent != other.parent || settings.size() != other.settings.size())
     {
-        return parent->get<std::string>(key);
+        return false;
     }
-    else
+    for (const std::pair<size_t, SettingValue>& pair : settings)
     {
-        logError("Trying to retrieve setting with no value given: '%s'\n", key.c_str());
-        std::exit(2);
+        const SettingValue* other_value = other.find(pair.first);
+        if (!other_value || other_value->value != pair.second.value)
+        {
+            return false;
+        }
     }
+    return true;
+}
+
+const std::string* Settings::getSerialised(const size_t key_id) const
+{
+    const SettingValue* value = resolve(key_id, true);
+    return value ? &value->value : nullptr;
+}
+
+void Settings::setParent(Settings* new_parent)
+{
+    parent = new_parent;
 }
 
 }//namespace cura
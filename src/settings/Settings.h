@@ -13,14 +13,20 @@
 //Maximum number of infill layers that can be combined into a single infill extrusion area.
 #define MAX_INFILL_COMBINE 8
 
+#include <limits>
 #include <vector>
 #include <map>
 #include <unordered_map>
 #include <sstream>
 
+#include "SettingKey.h"
+
 namespace cura
 {
 
+class BinaryReader;
+class BinaryWriter;
+
 /*!
  * \brief Container for a set of settings.
  *
@@ -44,7 +50,7 @@ public:
      * \param value The value of the setting. The value is always added and
      * stored in serialised form as a string.
      */
-    void add(const std::string& key, const std::string value);
+    void add(const SettingKey& key, const std::string value);
 
     /*!
      * \brief Get the value of a setting.
@@ -64,7 +70,7 @@ public:
      * \param key The key of the setting to get.
      * \return The setting's value, cast to the desired type.
      */
-    template<typename A> A get(const std::string& key) const;
+    template<typename A> A get(const SettingKey& key) const;
 
     /*!
      * \brief Get a string containing all settings in this container.
@@ -76,6 +82,21 @@ public:
      */
     const std::string getAllSettingsString() const;
 
+    /*!
+     * \brief Write the settings of this container, without those of its
+     * parents, so that they can be added again with \ref deserialise.
+     *
+     * The settings are written by name, since the IDs of settings differ
+     * between runs.
+     */
+    void serialise(BinaryWriter& writer) const;
+
+    /*!
+     * \brief Add the settings that were written with \ref serialise.
+     * \return Whether the settings could be read.
+     */
+    bool deserialise(BinaryReader& reader);
+
     /*!
      * \brief Indicate whether this settings instance has an entry for the
      * specified setting.
@@ -86,7 +107,31 @@ public:
      * \return Whether that setting is contained in this particular Settings
      * instance (``true``) or would be obtained via inheritance (``false``).
      */
-    bool has(const std::string& key) const;
+    bool has(const SettingKey& key) const;
+
+    /*!
+     * \brief Whether this container has the same values as another, and the
+     * same parent.
+     *
+     * Then every setting resolves to the same value in both. The values are
+     * compared in their serialised form, regardless of the order in which
+     * they were added.
+     * \param other The settings to compare to.
+     * \return Whether the settings are the same.
+     */
+    bool hasSameValues(const Settings& other) const;
+
+    /*!
+     * \brief Get the serialised value of a setting, going through the same
+     * steps as ``get``, but without closing the application if the setting has
+     * no value at all.
+     *
+     * Reading a setting this way isn't recorded by a \ref SettingsRecorder.
+     * \param key_id The ID of the setting, see \ref SettingKey::getId.
+     * \return The serialised value, or nullptr if no container has a value for
+     * the setting.
+     */
+    const std::string* getSerialised(const size_t key_id) const;
 
     /*
      * Change the parent settings object.
@@ -103,20 +148,66 @@ private:
     Settings* parent;
 
     /*!
-     * \brief A dictionary to map the setting keys to the actual setting values.
+     * \brief The value of a single setting, in serialised form and pre-parsed
+     * into the basic types that most settings are read as.
+     *
+     * Settings are read far more often than they are added, so parsing them
+     * once when they are added saves parsing them on every ``get``.
      */
-    std::unordered_map<std::string, std::string> settings;
+    struct SettingValue
+    {
+        SettingValue(const std::string& value);
+
+        std::string value; //!< The serialised value, as it was added.
+        double number; //!< The value parsed as floating point number, or 0 if it's not a number.
+        int integer; //!< The value parsed as integer, or 0 if it's not a number.
+        bool boolean; //!< The value interpreted as a boolean.
+    };
+
+    //! Marks a setting ID for which this container has no value.
+    static constexpr uint32_t NO_VALUE = std::numeric_limits<uint32_t>::max();
 
     /*!
-     * \brief Get the value of a setting, but without looking at the limiting to
-     * extruder.
+     * \brief For each setting ID, the position of its value in
+     * \ref Settings::settings, or NO_VALUE if this container has no value for it.
      *
-     * This is the same as the normal ``get`` function, but skipping step 2 and
-     * only for strings.
+     * This is indexed by \ref SettingKey::getId, so it's only as long as the
+     * highest ID of any setting in this container.
+     */
+    std::vector<uint32_t> setting_index;
+
+    /*!
+     * \brief The setting values in this container, together with the ID of the
+     * setting they belong to, in the order in which they were added.
+     */
+    std::vector<std::pair<size_t, SettingValue>> settings;
+
+    /*!
+     * \brief Find the value that this container itself has for a setting.
+     * \param key_id The ID of the setting.
+     * \return The value, or nullptr if this container has no value for it.
+     */
+    const SettingValue* find(const size_t key_id) const;
+
+    /*!
+     * \brief Find the value of a setting, going through the same steps as
+     * ``get``.
      * \param key The key of the setting to get.
-     * \return The setting's value.
+     * \return The setting's value, owned by the settings container that has
+     * it.
+     */
+    const SettingValue& getValue(const SettingKey& key) const;
+
+    /*!
+     * \brief Find the value of a setting, going through the same steps as
+     * ``get``.
+     * \param key_id The ID of the setting.
+     * \param limit_to_extruder Whether to look at the limiting to extruder. The
+     * limiting is applied only once at most, so this is ``false`` when looking
+     * in the settings of the extruder that the setting is limited to.
+     * \return The value, or nullptr if no container has a value for it.
      */
-    std::string getWithoutLimiting(const std::string& key) const;
+    const SettingValue* resolve(const size_t key_id, const bool limit_to_extruder) const;
 };
 
 } //namespace cura
@@ -0,0 +1,38 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cassert>
+
+#include "SettingsRecorder.h"
+
+namespace cura
+{
+
+std::atomic<SettingsRecorder*> SettingsRecorder::active(nullptr);
+
+SettingsRecorder::SettingsRecorder()
+{
+    SettingsRecorder* previous = nullptr;
+    const bool started = active.compare_exchange_strong(previous, this);
+    assert(started && "Only one settings recorder can be active at a time.");
+    (void)started;
+}
+
+SettingsRecorder::~SettingsRecorder()
+{
+    SettingsRecorder* current = this;
+    active.compare_exchange_strong(current, nullptr);
+}
+
+const std::set<std::pair<const Settings*, size_t>>& SettingsRecorder::getReads() const
+{
+    return reads;
+}
+
+void SettingsRecorder::record(const Settings* settings, const size_t key_id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    reads.emplace(settings, key_id);
+}
+
+} //namespace cura
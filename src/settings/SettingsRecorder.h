@@ -0,0 +1,77 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SETTINGS_SETTINGS_RECORDER_H
+#define SETTINGS_SETTINGS_RECORDER_H
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <utility> //For pair.
+
+#include "../utils/NoCopy.h"
+
+namespace cura
+{
+
+class Settings;
+
+/*!
+ * \brief Records which settings are read while it exists.
+ *
+ * This tells which settings the result of a computation depends on, so that
+ * the result can be reused as long as those settings don't change. Only one
+ * recorder can be active at a time. It records the reads of all threads, so
+ * nothing else must read settings while it's active.
+ */
+class SettingsRecorder : NoCopy
+{
+public:
+    /*!
+     * \brief Start recording.
+     */
+    SettingsRecorder();
+
+    /*!
+     * \brief Stop recording.
+     */
+    ~SettingsRecorder();
+
+    /*!
+     * \brief Record that a setting was read, if a recorder is active.
+     *
+     * This is called for every setting that is read, so it only costs a load
+     * when nothing is being recorded.
+     * \param settings The settings container that the setting was read from.
+     * \param key_id The ID of the setting.
+     */
+    static void recordRead(const Settings* settings, const size_t key_id)
+    {
+        SettingsRecorder* recorder = active.load(std::memory_order_relaxed);
+        if (recorder)
+        {
+            recorder->record(settings, key_id);
+        }
+    }
+
+    /*!
+     * \brief The settings that were read, with the container they were read
+     * from.
+     */
+    const std::set<std::pair<const Settings*, size_t>>& getReads() const;
+
+private:
+    static std::atomic<SettingsRecorder*> active; //!< The recorder that currently records, if any.
+
+    /*!
+     * \brief Add a read setting to the recorded reads.
+     */
+    void record(const Settings* settings, const size_t key_id);
+
+    std::mutex mutex; //!< Guards the reads, which may be recorded from multiple threads.
+    std::set<std::pair<const Settings*, size_t>> reads; //!< The settings that were read.
+};
+
+} //namespace cura
+
+#endif //SETTINGS_SETTINGS_RECORDER_H
@@ -0,0 +1,147 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "Settings.h"
+#include "SettingsSnapshot.h"
+#include "../ExtruderTrain.h"
+
+namespace cura
+{
+
+MeshSettingsSnapshot::MeshSettingsSnapshot()
+: anti_overhang_mesh(false)
+, support_mesh(false)
+, infill_mesh(false)
+, magic_mesh_surface_mode(ESurfaceMode::NORMAL)
+, retraction_combing(CombingMode::OFF)
+, bottom_layers(0)
+, wall_0_extruder_nr(0)
+, wall_x_extruder_nr(0)
+, infill_extruder_nr(0)
+, top_bottom_extruder_nr(0)
+, roofing_extruder_nr(0)
+, z_seam_type(EZSeamType::SHORTEST)
+, z_seam_corner(EZSeamCornerPrefType::Z_SEAM_CORNER_PREF_NONE)
+, wall_line_count(0)
+, wall_line_width_0(0)
+, wall_line_width_x(0)
+, initial_layer_line_width_factor(1.0)
+, wall_0_wipe_dist(0)
+, outer_inset_first(false)
+, travel_compensate_overlapping_walls_0_enabled(false)
+, travel_compensate_overlapping_walls_x_enabled(false)
+, travel_retract_before_outer_wall(false)
+, wall_overhang_angle(90)
+, wall_overhang_speed_factor(1.0)
+, wall_min_flow(0.0)
+, wall_min_flow_retract(false)
+, bridge_settings_enabled(false)
+, bridge_wall_min_length(0)
+, bridge_wall_coast(1.0)
+, fill_outline_gaps(false)
+, fill_perimeter_gaps(FillPerimeterGapMode::NOWHERE)
+, meshfix_maximum_resolution(0)
+, infill_before_walls(false)
+, spaghetti_infill_enabled(false)
+, infill_line_distance(0)
+, infill_pattern(EFillMethod::NONE)
+, zig_zaggify_infill(false)
+, infill_enable_travel_optimization(false)
+, infill_wipe_dist(0)
+, roofing_layer_count(0)
+{
+}
+
+MeshSettingsSnapshot::MeshSettingsSnapshot(const Settings& settings)
+: anti_overhang_mesh(settings.get<bool>("anti_overhang_mesh"))
+, support_mesh(settings.get<bool>("support_mesh"))
+, infill_mesh(settings.get<bool>("infill_mesh"))
+, magic_mesh_surface_mode(settings.get<ESurfaceMode>("magic_mesh_surface_mode"))
+, retraction_combing(settings.get<CombingMode>("retraction_combing"))
+, bottom_layers(settings.get<size_t>("bottom_layers"))
+, wall_0_extruder_nr(settings.get<ExtruderTrain&>("wall_0_extruder_nr").extruder_nr)
+, wall_x_extruder_nr(settings.get<ExtruderTrain&>("wall_x_extruder_nr").extruder_nr)
+, infill_extruder_nr(settings.get<ExtruderTrain&>("infill_extruder_nr").extruder_nr)
+, top_bottom_extruder_nr(settings.get<ExtruderTrain&>("top_bottom_extruder_nr").extruder_nr)
+, roofing_extruder_nr(settings.get<ExtruderTrain&>("roofing_extruder_nr").extruder_nr)
+, z_seam_type(settings.get<EZSeamType>("z_seam_type"))
+, z_seam_corner(settings.get<EZSeamCornerPrefType>("z_seam_corner"))
+, wall_line_count(settings.get<size_t>("wall_line_count"))
+, wall_line_width_0(settings.get<coord_t>("wall_line_width_0"))
+, wall_line_width_x(settings.get<coord_t>("wall_line_width_x"))
+, initial_layer_line_width_factor(settings.get<Ratio>("initial_layer_line_width_factor"))
+, wall_0_wipe_dist(settings.get<coord_t>("wall_0_wipe_dist"))
+, outer_inset_first(settings.get<bool>("outer_inset_first"))
+, travel_compensate_overlapping_walls_0_enabled(settings.get<bool>("travel_compensate_overlapping_walls_0_enabled"))
+, travel_compensate_overlapping_walls_x_enabled(settings.get<bool>("travel_compensate_overlapping_walls_x_enabled"))
+, travel_retract_before_outer_wall(settings.get<bool>("travel_retract_before_outer_wall"))
+, wall_overhang_angle(settings.get<AngleDegrees>("wall_overhang_angle"))
+, wall_overhang_speed_factor(settings.get<Ratio>("wall_overhang_speed_factor"))
+, wall_min_flow(settings.get<Ratio>("wall_min_flow"))
+, wall_min_flow_retract(settings.get<bool>("wall_min_flow_retract"))
+, bridge_settings_enabled(settings.get<bool>("bridge_settings_enabled"))
+, bridge_wall_min_length(settings.get<coord_t>("bridge_wall_min_length"))
+, bridge_wall_coast(settings.get<Ratio>("bridge_wall_coast"))
+, fill_outline_gaps(settings.get<bool>("fill_outline_gaps"))
+, fill_perimeter_gaps(settings.get<FillPerimeterGapMode>("fill_perimeter_gaps"))
+, meshfix_maximum_resolution(settings.get<coord_t>("meshfix_maximum_resolution"))
+, infill_before_walls(settings.get<bool>("infill_before_walls"))
+, spaghetti_infill_enabled(settings.get<bool>("spaghetti_infill_enabled"))
+, infill_line_distance(settings.get<coord_t>("infill_line_distance"))
+, infill_pattern(settings.get<EFillMethod>("infill_pattern"))
+, zig_zaggify_infill(settings.get<bool>("zig_zaggify_infill"))
+, infill_enable_travel_optimization(settings.get<bool>("infill_enable_travel_optimization"))
+, infill_wipe_dist(settings.get<coord_t>("infill_wipe_dist"))
+, roofing_layer_count(settings.get<size_t>("roofing_layer_count"))
+{
+}
+
+coord_t MeshSettingsSnapshot::getInnermostWallLineWidth(const int layer_nr) const
+{
+    const coord_t line_width = (wall_line_count > 1) ? wall_line_width_x : wall_line_width_0;
+    return (layer_nr == 0) ? line_width * initial_layer_line_width_factor : line_width;
+}
+
+ExtruderSettingsSnapshot::ExtruderSettingsSnapshot()
+: layer_start_position(0, 0)
+, meshfix_maximum_travel_resolution(0)
+, machine_nozzle_tip_outer_diameter(0)
+, retraction_hop_enabled(false)
+, retraction_hop_after_extruder_switch(false)
+, limit_support_retractions(false)
+, retraction_combing_max_distance(0)
+, wall_line_count(0)
+, wall_line_width_0(0)
+, wall_line_width_x(0)
+, initial_layer_line_width_factor(1.0)
+, coasting_volume(0.0)
+, coasting_min_volume(0.0)
+, coasting_speed(1.0)
+{
+}
+
+ExtruderSettingsSnapshot::ExtruderSettingsSnapshot(const Settings& settings)
+: layer_start_position(settings.get<coord_t>("layer_start_x"), settings.get<coord_t>("layer_start_y"))
+, meshfix_maximum_travel_resolution(settings.get<coord_t>("meshfix_maximum_travel_resolution"))
+, machine_nozzle_tip_outer_diameter(settings.get<coord_t>("machine_nozzle_tip_outer_diameter"))
+, retraction_hop_enabled(settings.get<bool>("retraction_hop_enabled"))
+, retraction_hop_after_extruder_switch(settings.get<bool>("retraction_hop_after_extruder_switch"))
+, limit_support_retractions(settings.get<bool>("limit_support_retractions"))
+, retraction_combing_max_distance(settings.get<coord_t>("retraction_combing_max_distance"))
+, wall_line_count(settings.get<size_t>("wall_line_count"))
+, wall_line_width_0(settings.get<coord_t>("wall_line_width_0"))
+, wall_line_width_x(settings.get<coord_t>("wall_line_width_x"))
+, initial_layer_line_width_factor(settings.get<Ratio>("initial_layer_line_width_factor"))
+, coasting_volume(settings.get<double>("coasting_volume"))
+, coasting_min_volume(settings.get<double>("coasting_min_volume"))
+, coasting_speed(settings.get<Ratio>("coasting_speed"))
+{
+}
+
+coord_t ExtruderSettingsSnapshot::getInnermostWallLineWidth(const int layer_nr) const
+{
+    const coord_t line_width = (wall_line_count > 1) ? wall_line_width_x : wall_line_width_0;
+    return (layer_nr == 0) ? line_width * initial_layer_line_width_factor : line_width;
+}
+
+} //namespace cura
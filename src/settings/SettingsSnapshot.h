@@ -0,0 +1,144 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef SETTINGS_SETTINGS_SNAPSHOT_H
+#define SETTINGS_SETTINGS_SNAPSHOT_H
+
+#include <cstddef> //For size_t.
+
+#include "EnumSettings.h"
+#include "types/AngleDegrees.h"
+#include "types/Ratio.h"
+#include "../utils/IntPoint.h"
+
+namespace cura
+{
+
+class Settings;
+
+/*!
+ * \brief The values of the settings of a mesh that are read for every part,
+ * wall or travel move while writing the g-code.
+ *
+ * Getting a setting from \ref Settings looks through the containers of the
+ * mesh, its extruder, the mesh group and the scene, and resolves the extruder
+ * that the setting is limited to on the way. That adds up when it's done for
+ * every part of every layer. These values are resolved once, after all
+ * settings are loaded, so that the g-code writer can read them directly.
+ *
+ * The fields have the names of the settings they hold. The settings are read
+ * as the same types as elsewhere, with extruder settings as the index of the
+ * extruder. This is filled by \ref FffGcodeWriter and doesn't change while
+ * the g-code is written.
+ */
+struct MeshSettingsSnapshot
+{
+    MeshSettingsSnapshot();
+
+    /*!
+     * \brief Resolve the settings of a mesh.
+     * \param settings The settings of the mesh.
+     */
+    explicit MeshSettingsSnapshot(const Settings& settings);
+
+    bool anti_overhang_mesh;
+    bool support_mesh;
+    bool infill_mesh;
+    ESurfaceMode magic_mesh_surface_mode;
+    CombingMode retraction_combing;
+    size_t bottom_layers;
+
+    size_t wall_0_extruder_nr;
+    size_t wall_x_extruder_nr;
+    size_t infill_extruder_nr;
+    size_t top_bottom_extruder_nr;
+    size_t roofing_extruder_nr;
+
+    EZSeamType z_seam_type;
+    EZSeamCornerPrefType z_seam_corner;
+
+    size_t wall_line_count;
+    coord_t wall_line_width_0;
+    coord_t wall_line_width_x;
+    Ratio initial_layer_line_width_factor;
+    coord_t wall_0_wipe_dist;
+    bool outer_inset_first;
+    bool travel_compensate_overlapping_walls_0_enabled;
+    bool travel_compensate_overlapping_walls_x_enabled;
+    bool travel_retract_before_outer_wall;
+    AngleDegrees wall_overhang_angle;
+    Ratio wall_overhang_speed_factor;
+    Ratio wall_min_flow;
+    bool wall_min_flow_retract;
+    bool bridge_settings_enabled;
+    coord_t bridge_wall_min_length;
+    Ratio bridge_wall_coast;
+    bool fill_outline_gaps;
+    FillPerimeterGapMode fill_perimeter_gaps;
+    coord_t meshfix_maximum_resolution;
+
+    bool infill_before_walls;
+    bool spaghetti_infill_enabled;
+    coord_t infill_line_distance;
+    EFillMethod infill_pattern;
+    bool zig_zaggify_infill;
+    bool infill_enable_travel_optimization;
+    coord_t infill_wipe_dist;
+
+    size_t roofing_layer_count;
+
+    /*!
+     * \brief The width of the innermost wall, which is what the nozzle moves
+     * inside of after printing a part.
+     * \param layer_nr The layer of the part, since the first layer has wider
+     * lines.
+     */
+    coord_t getInnermostWallLineWidth(const int layer_nr) const;
+};
+
+/*!
+ * \brief The values of the settings of an extruder that are read for every
+ * travel move or path while writing the g-code.
+ *
+ * This is the counterpart of \ref MeshSettingsSnapshot for the settings that
+ * the layer plans read from the extruder train itself.
+ */
+struct ExtruderSettingsSnapshot
+{
+    ExtruderSettingsSnapshot();
+
+    /*!
+     * \brief Resolve the settings of an extruder.
+     * \param settings The settings of the extruder train.
+     */
+    explicit ExtruderSettingsSnapshot(const Settings& settings);
+
+    Point layer_start_position; //!< The settings layer_start_x and layer_start_y.
+    coord_t meshfix_maximum_travel_resolution;
+    coord_t machine_nozzle_tip_outer_diameter;
+    bool retraction_hop_enabled;
+    bool retraction_hop_after_extruder_switch;
+    bool limit_support_retractions;
+    coord_t retraction_combing_max_distance;
+
+    size_t wall_line_count;
+    coord_t wall_line_width_0;
+    coord_t wall_line_width_x;
+    Ratio initial_layer_line_width_factor;
+
+    double coasting_volume;
+    double coasting_min_volume;
+    Ratio coasting_speed;
+
+    /*!
+     * \brief The width of the innermost wall according to the extruder, which
+     * is what the nozzle moves inside of before retracting.
+     * \param layer_nr The layer of the travel move, since the first layer has
+     * wider lines.
+     */
+    coord_t getInnermostWallLineWidth(const int layer_nr) const;
+};
+
+} //namespace cura
+
+#endif //SETTINGS_SETTINGS_SNAPSHOT_H
@@ -6,12 +6,14 @@
 #include "Application.h" //To get settings.
 #include "ExtruderTrain.h"
 #include "skin.h"
+#include "SkinWallCache.h"
 #include "sliceDataStorage.h"
 #include "settings/EnumSettings.h" //For EFillMethod.
 #include "settings/types/AngleRadians.h" //For the infill support angle.
 #include "settings/types/Ratio.h"
 #include "utils/math.h"
 #include "utils/polygonUtils.h"
+#include "utils/TaskScheduler.h" //To process the layers in parallel.
 
 #define MIN_AREA_SIZE (0.4 * 0.4) 
 
@@ -101,23 +103,51 @@ Polygons SkinInfillAreaComputation::getWalls(const SliceLayerPart& part_here, in
         return result;
     }
     const SliceLayer& layer2 = mesh.layers[layer2_nr];
-    for (const SliceLayerPart& part2 : layer2.parts)
+    for (const size_t part2_idx : layer2.getPartsHitting(part_here.boundaryBox))
     {
-        if (part_here.boundaryBox.hit(part2.boundaryBox))
+        const SliceLayerPart& part2 = layer2.parts[part2_idx];
+        if (wall_idx <= 0)
         {
-            if (wall_idx <= 0)
-            {
-                result.add(part2.outline);
-            }
-            else if (wall_idx <= part2.insets.size())
-            {
-                result.add(part2.insets[wall_idx - 1]); // -1 because it's a 1-based index
-            }
+            result.add(part2.outline);
+        }
+        else if (wall_idx <= part2.insets.size())
+        {
+            result.add(part2.insets[wall_idx - 1]); // -1 because it's a 1-based index
         }
     }
     return result;
 };
 
+/*
+ * This function is executed in a parallel region based on layer_nr.
+ * When modifying make sure any changes does not introduce data races.
+ *
+ * this function may only read/write the skin and infill from the *current* layer.
+ */
+Polygons SkinInfillAreaComputation::getOffsetWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx, coord_t offset)
+{
+    if (!mesh.skin_wall_cache)
+    {
+        return getWalls(part_here, layer2_nr, wall_idx).offset(offset);
+    }
+    Polygons result;
+    if (layer2_nr >= static_cast<int>(mesh.layers.size()))
+    {
+        return result;
+    }
+    const SliceLayer& layer2 = mesh.layers[layer2_nr];
+    const std::vector<size_t> hit_parts = layer2.getPartsHitting(part_here.boundaryBox);
+    for (const size_t part2_idx : hit_parts)
+    {
+        result.add(mesh.skin_wall_cache->getOffsetWall(layer2, layer2_nr, part2_idx, wall_idx, offset));
+    }
+    if (offset > 0 && hit_parts.size() > 1)
+    { // the walls of different parts may overlap after expanding them
+        result.unionInPlace();
+    }
+    return result;
+}
+
 int SkinInfillAreaComputation::getReferenceWallIdx(coord_t& preshrink) const
 {
     for (int wall_idx = wall_line_count; wall_idx > 0; wall_idx--)
@@ -153,12 +183,10 @@ void SkinInfillAreaComputation::generateSkinsAndInfill()
 {
     generateSkinAndInfillAreas();
 
-    SliceLayer* layer = &mesh.layers[layer_nr];
-    for (unsigned int part_nr = 0; part_nr < layer->parts.size(); part_nr++)
+    SliceLayer& layer = mesh.layers[layer_nr];
+    generateSkinInsetsAndInnerSkinInfill(layer);
+    for (SliceLayerPart& part : layer.parts)
     {
-        SliceLayerPart& part = layer->parts[part_nr];
-        generateSkinInsetsAndInnerSkinInfill(&part);
-
         generateRoofing(part);
     }
 }
@@ -247,12 +275,12 @@ void SkinInfillAreaComputation::calculateBottomSkin(const SliceLayerPart& part,
 {
     if (static_cast<int>(layer_nr - bottom_layer_count) >= 0 && bottom_layer_count > 0)
     {
-        Polygons not_air = getWalls(part, layer_nr - bottom_layer_count, bottom_reference_wall_idx).offset(bottom_reference_wall_expansion);
+        Polygons not_air = getOffsetWalls(part, layer_nr - bottom_layer_count, bottom_reference_wall_idx, bottom_reference_wall_expansion);
         if (!no_small_gaps_heuristic)
         {
             for (int downskin_layer_nr = layer_nr - bottom_layer_count + 1; downskin_layer_nr < layer_nr; downskin_layer_nr++)
             {
-                not_air = not_air.intersection(getWalls(part, downskin_layer_nr, bottom_reference_wall_idx).offset(bottom_reference_wall_expansion));
+                not_air.intersectionInPlace(getOffsetWalls(part, downskin_layer_nr, bottom_reference_wall_idx, bottom_reference_wall_expansion));
             }
         }
         const double min_infill_area = mesh.settings.get<double>("min_infill_area");
@@ -260,7 +288,7 @@ void SkinInfillAreaComputation::calculateBottomSkin(const SliceLayerPart& part,
         {
             not_air.removeSmallAreas(min_infill_area);
         }
-        downskin = downskin.difference(not_air); // skin overlaps with the walls
+        downskin.differenceInPlace(not_air); // skin overlaps with the walls
     }
 }
 
@@ -268,12 +296,12 @@ void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, Pol
 {
     if (static_cast<int>(layer_nr + top_layer_count) < static_cast<int>(mesh.layers.size()) && top_layer_count > 0)
     {
-        Polygons not_air = getWalls(part, layer_nr + top_layer_count, top_reference_wall_idx).offset(top_reference_wall_expansion);
+        Polygons not_air = getOffsetWalls(part, layer_nr + top_layer_count, top_reference_wall_idx, top_reference_wall_expansion);
         if (!no_small_gaps_heuristic)
         {
             for (int upskin_layer_nr = layer_nr + 1; upskin_layer_nr < layer_nr + top_layer_count; upskin_layer_nr++)
             {
-                not_air = not_air.intersection(getWalls(part, upskin_layer_nr, top_reference_wall_idx).offset(top_reference_wall_expansion));
+                not_air.intersectionInPlace(getOffsetWalls(part, upskin_layer_nr, top_reference_wall_idx, top_reference_wall_expansion));
             }
         }
         // Prevent removing top skin layers
@@ -285,8 +313,8 @@ void SkinInfillAreaComputation::calculateTopSkin(const SliceLayerPart& part, Pol
             not_air.removeSmallAreas(min_infill_area);
         }
 
-        upskin = upskin.difference(not_air); // skin overlaps with the walls
-        upskin = upskin.unionPolygons(upskin_before); // in some cases the top skin layer might be removed. To prevent it add them back
+        upskin.differenceInPlace(not_air); // skin overlaps with the walls
+        upskin.unionInPlace(upskin_before); // in some cases the top skin layer might be removed. To prevent it add them back
     }
 }
 
@@ -343,13 +371,18 @@ void SkinInfillAreaComputation::applySkinExpansion(const Polygons& original_outl
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
-void SkinInfillAreaComputation::generateSkinInsetsAndInnerSkinInfill(SliceLayerPart* part)
+void SkinInfillAreaComputation::generateSkinInsetsAndInnerSkinInfill(SliceLayer& layer)
 {
-    for (SkinPart& skin_part : part->skin_parts)
+    std::vector<SkinPart*> skin_parts;
+    for (SliceLayerPart& part : layer.parts)
     {
-        generateSkinInsets(skin_part);
-        generateInnerSkinInfill(skin_part);
+        for (SkinPart& skin_part : part.skin_parts)
+        {
+            skin_parts.push_back(&skin_part);
+        }
     }
+    generateSkinInsets(skin_parts);
+    generateInnerSkinInfill(skin_parts);
 }
 
 /*
@@ -358,29 +391,19 @@ void SkinInfillAreaComputation::generateSkinInsetsAndInnerSkinInfill(SliceLayerP
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
-void SkinInfillAreaComputation::generateSkinInsets(SkinPart& skin_part)
+void SkinInfillAreaComputation::generateSkinInsets(const std::vector<SkinPart*>& skin_parts)
 {
-    for (size_t inset_idx = 0; inset_idx < skin_inset_count; inset_idx++)
+    std::vector<const Polygons*> outlines;
+    std::vector<std::vector<Polygons>*> insets;
+    outlines.reserve(skin_parts.size());
+    insets.reserve(skin_parts.size());
+    for (SkinPart* skin_part : skin_parts)
     {
-        skin_part.insets.push_back(Polygons());
-        if (inset_idx == 0)
-        {
-            //The 10 micron reduced inset is to prevent rounding errors from creating gaps that get filled by the fill small gaps routine.
-            skin_part.insets[0] = skin_part.outline.offset(-skin_line_width / 2 + 10);
-        }
-        else
-        {
-            skin_part.insets[inset_idx] = skin_part.insets[inset_idx - 1].offset(-skin_line_width);
-        }
-
-        // optimize polygons: remove unnecessary verts
-        skin_part.insets[inset_idx].simplify();
-        if (skin_part.insets[inset_idx].size() < 1)
-        {
-            skin_part.insets.pop_back();
-            return; // don't generate inner_infill areas if the innermost inset was too small
-        }
+        outlines.push_back(&skin_part->outline);
+        insets.push_back(&skin_part->insets);
     }
+    //The 10 micron reduced inset is to prevent rounding errors from creating gaps that get filled by the fill small gaps routine.
+    PolygonUtils::generateInsetsOfEach(outlines, -skin_line_width / 2 + 10, -skin_line_width, skin_inset_count, insets);
 }
 
 /*
@@ -389,15 +412,25 @@ void SkinInfillAreaComputation::generateSkinInsets(SkinPart& skin_part)
  *
  * this function may only read/write the skin and infill from the *current* layer.
  */
-void SkinInfillAreaComputation::generateInnerSkinInfill(SkinPart& skin_part)
+void SkinInfillAreaComputation::generateInnerSkinInfill(const std::vector<SkinPart*>& skin_parts)
 {
-    if (skin_part.insets.empty())
+    std::vector<SkinPart*> skin_parts_with_insets;
+    std::vector<const Polygons*> innermost_insets;
+    for (SkinPart* skin_part : skin_parts)
     {
-        skin_part.inner_infill = skin_part.outline;
-        return;
+        if (skin_part->insets.empty())
+        {
+            skin_part->inner_infill = skin_part->outline;
+            continue;
+        }
+        skin_parts_with_insets.push_back(skin_part);
+        innermost_insets.push_back(&skin_part->insets.back());
+    }
+    std::vector<Polygons> inner_infills = Polygons::offsetEach(innermost_insets, -skin_line_width / 2);
+    for (size_t skin_part_idx = 0; skin_part_idx < skin_parts_with_insets.size(); skin_part_idx++)
+    {
+        skin_parts_with_insets[skin_part_idx]->inner_infill = std::move(inner_infills[skin_part_idx]);
     }
-    const Polygons& innermost_inset = skin_part.insets.back();
-    skin_part.inner_infill = innermost_inset.offset(-skin_line_width / 2);
 }
 
 /*
@@ -445,7 +478,7 @@ void SkinInfillAreaComputation::generateInfill(SliceLayerPart& part, const Polyg
     }
     Polygons infill = part.insets.back().offset(offset_from_inner_wall);
 
-    infill = infill.difference(skin);
+    infill.differenceInPlace(skin);
     infill.removeSmallAreas(MIN_AREA_SIZE);
 
     part.infill_area = infill.offset(infill_skin_overlap);
@@ -473,7 +506,7 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
                 for (int layer_nr_above = layer_nr + 1; layer_nr_above < layer_nr + roofing_layer_count; layer_nr_above++)
                 {
                     Polygons outlines_above = getWalls(part, layer_nr_above, wall_idx);
-                    no_air_above = no_air_above.intersection(outlines_above);
+                    no_air_above.intersectionInPlace(outlines_above);
                 }
             }
             if (layer_nr > 0)
@@ -489,11 +522,11 @@ void SkinInfillAreaComputation::generateRoofing(SliceLayerPart& part)
                 if (!air_below.empty())
                 {
                     // add the polygons that have air below to the no air above polygons
-                    no_air_above = no_air_above.unionPolygons(air_below);
+                    no_air_above.unionInPlace(air_below);
                 }
             }
             skin_part.roofing_fill = skin_part.inner_infill.difference(no_air_above);
-            skin_part.inner_infill = skin_part.inner_infill.intersection(no_air_above);
+            skin_part.inner_infill.intersectionInPlace(no_air_above);
         }
     }
 }
@@ -556,10 +589,11 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
     const LayerIndex min_layer = mesh.settings.get<size_t>("bottom_layers");
     const LayerIndex max_layer = mesh.layers.size() - 1 - mesh.settings.get<size_t>("top_layers");
 
-    for (LayerIndex layer_idx = 0; layer_idx < static_cast<LayerIndex>(mesh.layers.size()); layer_idx++)
-    { // loop also over layers which don't contain infill cause of bottom_ and top_layer to initialize their infill_area_per_combine_per_density
+    // Each layer only changes its own parts, and reads the infill areas of the layers above, which stay the same until all layers are done.
+    // The layers can therefore be processed in parallel, with the same result as when processing them one after the other.
+    const auto process_layer = [&](const LayerIndex layer_idx)
+    {
         SliceLayer& layer = mesh.layers[layer_idx];
-
         for (SliceLayerPart& part : layer.parts)
         {
             assert(part.infill_area_per_combine_per_density.size() == 0 && "infill_area_per_combine_per_density is supposed to be uninitialized");
@@ -588,15 +622,11 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
                     }
                     const SliceLayer& upper_layer = mesh.layers[static_cast<size_t>(upper_layer_idx)];
                     Polygons relevent_upper_polygons;
-                    for (const SliceLayerPart& upper_layer_part : upper_layer.parts)
+                    for (const size_t upper_part_idx : upper_layer.getPartsHitting(part.boundaryBox))
                     {
-                        if (!upper_layer_part.boundaryBox.hit(part.boundaryBox))
-                        {
-                            continue;
-                        }
-                        relevent_upper_polygons.add(upper_layer_part.getOwnInfillArea());
+                        relevent_upper_polygons.add(upper_layer.parts[upper_part_idx].getOwnInfillArea());
                     }
-                    less_dense_infill = less_dense_infill.intersection(relevent_upper_polygons);
+                    less_dense_infill.intersectionInPlace(relevent_upper_polygons);
                 }
                 if (less_dense_infill.size() == 0)
                 {
@@ -611,9 +641,25 @@ void SkinInfillAreaComputation::generateGradualInfill(SliceMeshStorage& mesh)
             part.infill_area_per_combine_per_density.emplace_back();
             std::vector<Polygons>& infill_area_per_combine_current_density = part.infill_area_per_combine_per_density.back();
             infill_area_per_combine_current_density.push_back(infill_area);
-            part.infill_area_own = nullptr; // clear infill_area_own, it's not needed any more.
             assert(part.infill_area_per_combine_per_density.size() != 0 && "infill_area_per_combine_per_density is now initialized");
         }
+    };
+    TaskScheduler scheduler;
+    for (LayerIndex layer_idx = 0; layer_idx < static_cast<LayerIndex>(mesh.layers.size()); layer_idx++)
+    { // loop also over layers which don't contain infill cause of bottom_ and top_layer to initialize their infill_area_per_combine_per_density
+        scheduler.schedule([&process_layer, layer_idx]() { process_layer(layer_idx); });
+    }
+    scheduler.run();
+
+    for (LayerIndex layer_idx = std::max(min_layer, LayerIndex(0)); layer_idx <= max_layer; layer_idx++)
+    {
+        for (SliceLayerPart& part : mesh.layers[layer_idx].parts)
+        {
+            if (part.getOwnInfillArea().size() > 0)
+            {
+                part.infill_area_own = nullptr; // clear infill_area_own, it's not needed any more.
+            }
+        }
     }
 }
 
@@ -639,7 +685,9 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
     min_layer -= min_layer % amount; //Round upwards to the nearest layer divisible by infill_sparse_combine.
     LayerIndex max_layer = static_cast<LayerIndex>(mesh.layers.size()) - 1 - mesh.settings.get<size_t>("top_layers");
     max_layer -= max_layer % amount; //Round downwards to the nearest layer divisible by infill_sparse_combine.
-    for(LayerIndex layer_idx = min_layer; layer_idx <= max_layer; layer_idx += amount) //Skip every few layers, but extrude more.
+    // Every combined layer only changes itself and the layers below it that it combines, which no other combined layer touches.
+    // The combined layers can therefore be processed in parallel, with the same result as when processing them one after the other.
+    const auto combine_layer = [&](const LayerIndex layer_idx)
     {
         SliceLayer* layer = &mesh.layers[layer_idx];
         for(size_t combine_count_here = 1; combine_count_here < amount; combine_count_here++)
@@ -661,32 +709,29 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
                 { // go over each density of gradual infill (these density areas overlap!)
                     std::vector<Polygons>& infill_area_per_combine = part.infill_area_per_combine_per_density[density_idx];
                     Polygons result;
-                    for (SliceLayerPart& lower_layer_part : lower_layer->parts)
+                    for (const size_t lower_part_idx : lower_layer->getPartsHitting(part.boundaryBox))
                     {
-                        if (part.boundaryBox.hit(lower_layer_part.boundaryBox))
+                        SliceLayerPart& lower_layer_part = lower_layer->parts[lower_part_idx];
+                        Polygons intersection = infill_area_per_combine[combine_count_here - 1].intersection(lower_layer_part.infill_area).offset(-200).offset(200);
+                        result.add(intersection); // add area to be thickened
+                        infill_area_per_combine[combine_count_here - 1] = infill_area_per_combine[combine_count_here - 1].difference(intersection); // remove thickened area from less thick layer here
+                        unsigned int max_lower_density_idx = density_idx;
+                        // Generally: remove only from *same density* areas on layer below
+                        // If there are no same density areas, then it's ok to print them anyway
+                        // Don't remove other density areas
+                        if (density_idx == part.infill_area_per_combine_per_density.size() - 1)
                         {
-
-                            Polygons intersection = infill_area_per_combine[combine_count_here - 1].intersection(lower_layer_part.infill_area).offset(-200).offset(200);
-                            result.add(intersection); // add area to be thickened
-                            infill_area_per_combine[combine_count_here - 1] = infill_area_per_combine[combine_count_here - 1].difference(intersection); // remove thickened area from less thick layer here
-                            unsigned int max_lower_density_idx = density_idx;
-                            // Generally: remove only from *same density* areas on layer below
-                            // If there are no same density areas, then it's ok to print them anyway
-                            // Don't remove other density areas
-                            if (density_idx == part.infill_area_per_combine_per_density.size() - 1)
-                            {
-                                // For the most dense areas on a given layer the density of that area is doubled.
-                                // This means that - if the lower layer has more densities -
-                                // all those lower density lines are included in the most dense of this layer.
-                                // We therefore compare the most dense are on this layer with all densities
-                                // of the lower layer with the same or higher density index
-                                max_lower_density_idx = lower_layer_part.infill_area_per_combine_per_density.size() - 1;
-                            }
-                            for (size_t lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
-                            {
-                                std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
-                                lower_infill_area_per_combine[0] = lower_infill_area_per_combine[0].difference(intersection); // remove thickened area from lower (single thickness) layer
-                            }
+                            // For the most dense areas on a given layer the density of that area is doubled.
+                            // This means that - if the lower layer has more densities -
+                            // all those lower density lines are included in the most dense of this layer.
+                            // We therefore compare the most dense are on this layer with all densities
+                            // of the lower layer with the same or higher density index
+                            max_lower_density_idx = lower_layer_part.infill_area_per_combine_per_density.size() - 1;
+                        }
+                        for (size_t lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
+                        {
+                            std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
+                            lower_infill_area_per_combine[0].differenceInPlace(intersection); // remove thickened area from lower (single thickness) layer
                         }
                     }
 
@@ -694,7 +739,13 @@ void SkinInfillAreaComputation::combineInfillLayers(SliceMeshStorage& mesh)
                 }
             }
         }
+    };
+    TaskScheduler scheduler;
+    for(LayerIndex layer_idx = min_layer; layer_idx <= max_layer; layer_idx += amount) //Skip every few layers, but extrude more.
+    {
+        scheduler.schedule([&combine_layer, layer_idx]() { combine_layer(layer_idx); });
     }
+    scheduler.run();
 }
 
 
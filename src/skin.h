@@ -4,6 +4,8 @@
 #ifndef SKIN_H
 #define SKIN_H
 
+#include <vector>
+
 #include "settings/types/LayerIndex.h"
 #include "utils/Coord_t.h"
 
@@ -12,6 +14,7 @@ namespace cura
 
 class Polygons;
 class SkinPart;
+class SliceLayer;
 class SliceLayerPart;
 class SliceMeshStorage;
 
@@ -135,28 +138,33 @@ protected:
     void generateRoofing(SliceLayerPart& part);
 
     /*!
-     * Generate the skin insets and the inner infill area
+     * Generate the skin insets and the inner infill area of all skin parts of
+     * a layer
      * 
-     * \param part The part where the skin outline information (input) is stored and
+     * \param layer The layer with the parts where the skin outline information (input) is stored and
      * where the skin insets (output) are stored.
      */
-    void generateSkinInsetsAndInnerSkinInfill(SliceLayerPart* part);
+    void generateSkinInsetsAndInnerSkinInfill(SliceLayer& layer);
 
     /*!
-     * Generate the skin insets of a skin part
+     * Generate the skin insets of skin parts
+     * 
+     * The insets of all skin parts are generated together, which saves
+     * setting up the offsets for each of the many small skin parts a layer
+     * may have.
      * 
-     * \param skin_part The part where the skin outline information (input) is stored and
+     * \param skin_parts The parts where the skin outline information (input) is stored and
      * where the skin insets (output) are stored.
      */
-    void generateSkinInsets(SkinPart& skin_part);
+    void generateSkinInsets(const std::vector<SkinPart*>& skin_parts);
 
     /*!
-     * Generate the inner_infill_area of a skin part
+     * Generate the inner_infill_area of skin parts
      * 
-     * \param skin_part The part where the skin outline information (input) is stored and
+     * \param skin_parts The parts where the skin outline information (input) is stored and
      * where the inner infill area (output) is stored.
      */
-    void generateInnerSkinInfill(SkinPart& skin_part);
+    void generateInnerSkinInfill(const std::vector<SkinPart*>& skin_parts);
 
 protected:
     const LayerIndex layer_nr; //!< The index of the layer for which to generate the skins and infill.
@@ -194,6 +202,18 @@ private:
      */
     Polygons getWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx);
 
+    /*!
+     * Helper function to get the walls of each part which might intersect with \p part_here, offset by some distance.
+     * 
+     * The offset walls are taken from SliceMeshStorage::skin_wall_cache if the mesh has one, so that the skins of neighbouring layers don't offset the same walls over and over.
+     * 
+     * \param part_here The part for which to check
+     * \param layer2_nr The layer index from which to gather the outlines
+     * \param wall_idx The 1-based wall index for the walls to grab. e.g. the outermost walls or the second walls. Zero means the outline.
+     * \param offset The distance by which to offset the walls
+     */
+    Polygons getOffsetWalls(const SliceLayerPart& part_here, int layer2_nr, unsigned int wall_idx, coord_t offset);
+
     /*!
      * Get the wall index of the reference wall for either the top or bottom skin.
      * With larger user specified preshrink come lower reference wall indices.
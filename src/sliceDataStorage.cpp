@@ -1,10 +1,14 @@
 //Copyright (c) 2018 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <cassert>
+
 #include "Application.h" //To get settings.
 #include "ExtruderTrain.h"
 #include "FffProcessor.h" //To create a mesh group with if none is provided.
+#include "LayerSpill.h"
 #include "raft.h"
+#include "settings/PathConfigStorage.h"
 #include "Slice.h"
 #include "sliceDataStorage.h"
 #include "infill/SierpinskiFillProvider.h"
@@ -12,25 +16,102 @@
 #include "infill/DensityProvider.h" // for destructor
 #include "utils/math.h" //For PI.
 #include "utils/logoutput.h"
+#include "utils/MemoryBudget.h"
+#include "utils/TaskScheduler.h"
 
+#define LAYER_OUTLINES_CACHE_SIZE (256 * 1024 * 1024) //The maximum number of bytes of layer outlines to keep in memory.
+#define MIN_INDEXED_PARTS 8 //Layers with fewer parts than this are searched part by part, which is just as fast as looking them up.
+#define PATH_CONFIGS_CACHE_SIZE 256 //The maximum number of sets of line configs to keep in memory, for when every layer has a different thickness.
 
 namespace cura
 {
 
+namespace
+{
+
+/*
+ * The approximate number of bytes that polygons take up in memory outside of
+ * the object that contains them.
+ */
+size_t getContentsMemorySize(const Polygons& polygons)
+{
+    return polygons.getMemorySize() - sizeof(Polygons);
+}
+
+size_t getContentsMemorySize(const std::vector<Polygons>& polygons_list)
+{
+    size_t bytes = polygons_list.capacity() * sizeof(Polygons);
+    for (const Polygons& polygons : polygons_list)
+    {
+        bytes += getContentsMemorySize(polygons);
+    }
+    return bytes;
+}
+
+size_t getContentsMemorySize(const std::vector<std::vector<Polygons>>& polygons_lists)
+{
+    size_t bytes = polygons_lists.capacity() * sizeof(std::vector<Polygons>);
+    for (const std::vector<Polygons>& polygons_list : polygons_lists)
+    {
+        bytes += getContentsMemorySize(polygons_list);
+    }
+    return bytes;
+}
+
+size_t getContentsMemorySize(const SliceLayerPart& part)
+{
+    size_t bytes = getContentsMemorySize(part.outline) + getContentsMemorySize(part.print_outline) + getContentsMemorySize(part.insets)
+        + getContentsMemorySize(part.perimeter_gaps) + getContentsMemorySize(part.outline_gaps) + getContentsMemorySize(part.infill_area)
+        + getContentsMemorySize(part.infill_area_per_combine_per_density) + getContentsMemorySize(part.infill_polygons_per_combine) + getContentsMemorySize(part.infill_lines_per_combine);
+    if (part.infill_area_own)
+    {
+        bytes += getContentsMemorySize(*part.infill_area_own);
+    }
+    bytes += part.skin_parts.capacity() * sizeof(SkinPart);
+    for (const SkinPart& skin_part : part.skin_parts)
+    {
+        bytes += getContentsMemorySize(skin_part.outline) + getContentsMemorySize(skin_part.insets) + getContentsMemorySize(skin_part.perimeter_gaps)
+            + getContentsMemorySize(skin_part.inner_infill) + getContentsMemorySize(skin_part.roofing_fill);
+    }
+    return bytes;
+}
+
+size_t getContentsMemorySize(const SliceLayer& layer)
+{
+    size_t bytes = layer.parts.capacity() * sizeof(SliceLayerPart) + getContentsMemorySize(layer.openPolyLines);
+    for (const SliceLayerPart& part : layer.parts)
+    {
+        bytes += getContentsMemorySize(part);
+    }
+    return bytes;
+}
+
+size_t getContentsMemorySize(const SupportLayer& layer)
+{
+    size_t bytes = layer.support_infill_parts.capacity() * sizeof(SupportInfillPart);
+    for (const SupportInfillPart& part : layer.support_infill_parts)
+    {
+        bytes += getContentsMemorySize(part.outline) + getContentsMemorySize(part.insets) + getContentsMemorySize(part.infill_area_per_combine_per_density);
+        if (&part.getInfillArea() != &part.outline) //Without walls the outline is the infill area.
+        {
+            bytes += getContentsMemorySize(part.getInfillArea());
+        }
+    }
+    return bytes + getContentsMemorySize(layer.support_bottom) + getContentsMemorySize(layer.support_roof) + getContentsMemorySize(layer.support_mesh_drop_down)
+        + getContentsMemorySize(layer.support_mesh) + getContentsMemorySize(layer.anti_overhang);
+}
+
+} //Anonymous namespace.
+
 SupportStorage::SupportStorage()
 : generated(false)
 , layer_nr_max_filled_layer(-1)
-, cross_fill_provider(nullptr)
 {
 }
 
 SupportStorage::~SupportStorage()
 {
     supportLayers.clear(); 
-    if (cross_fill_provider)
-    {
-        delete cross_fill_provider;
-    }
 }
 
 Polygons& SliceLayerPart::getOwnInfillArea()
@@ -50,10 +131,93 @@ const Polygons& SliceLayerPart::getOwnInfillArea() const
     }
 }
 
+void SliceLayerPart::translate(const Point translation)
+{
+    assert(wall_overlap_linkers.empty() && "The wall overlaps refer to the walls where they were computed.");
+    outline.translate(translation);
+    boundaryBox.calculate(outline);
+    print_outline.translate(translation);
+    for (Polygons& inset : insets)
+    {
+        inset.translate(translation);
+    }
+    perimeter_gaps.translate(translation);
+    outline_gaps.translate(translation);
+    for (SkinPart& skin_part : skin_parts)
+    {
+        skin_part.outline.translate(translation);
+        for (Polygons& inset : skin_part.insets)
+        {
+            inset.translate(translation);
+        }
+        skin_part.perimeter_gaps.translate(translation);
+        skin_part.inner_infill.translate(translation);
+        skin_part.roofing_fill.translate(translation);
+    }
+    infill_area.translate(translation);
+    if (infill_area_own)
+    {
+        infill_area_own->translate(translation);
+    }
+    for (std::vector<Polygons>& infill_area_per_combine : infill_area_per_combine_per_density)
+    {
+        for (Polygons& infill_area_combined : infill_area_per_combine)
+        {
+            infill_area_combined.translate(translation);
+        }
+    }
+    for (Polygons& infill_polygons : infill_polygons_per_combine)
+    {
+        infill_polygons.translate(translation);
+    }
+    for (Polygons& infill_lines : infill_lines_per_combine)
+    {
+        infill_lines.translate(translation);
+    }
+    for (std::pair<Polygons, double>& volume : spaghetti_infill_volumes)
+    {
+        volume.first.translate(translation);
+    }
+}
+
 SliceLayer::~SliceLayer()
 {
 }
 
+void SliceLayer::indexParts()
+{
+    if (parts.size() < MIN_INDEXED_PARTS)
+    {
+        parts_index = AABBTree();
+        return;
+    }
+    std::vector<AABB> part_boxes;
+    part_boxes.reserve(parts.size());
+    for (const SliceLayerPart& part : parts)
+    {
+        part_boxes.push_back(part.boundaryBox);
+    }
+    parts_index = AABBTree(part_boxes);
+}
+
+std::vector<size_t> SliceLayer::getPartsHitting(const AABB& box) const
+{
+    std::vector<size_t> result;
+    if (parts_index.size() == parts.size() && !parts.empty())
+    {
+        parts_index.findOverlapping(box, result);
+        return result;
+    }
+    for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+    {
+        if (parts[part_idx].boundaryBox.hit(box))
+        {
+            result.push_back(part_idx);
+        }
+    }
+    return result;
+}
+
 Polygons SliceLayer::getOutlines(bool external_polys_only) const
 {
     Polygons ret;
@@ -67,7 +231,10 @@ void SliceLayer::getOutlines(Polygons& result, bool external_polys_only) const
     {
         if (external_polys_only)
         {
-            result.add(part.outline.outerPolygon());
+            if (!part.is_enclosed) //Parts in holes are inside the outer polygon of another part, so they aren't on the outside.
+            {
+                result.add(part.outline.outerPolygon());
+            }
         }
         else 
         {
@@ -76,13 +243,17 @@ void SliceLayer::getOutlines(Polygons& result, bool external_polys_only) const
     }
 }
 
-Polygons& SliceLayer::getInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const
+const Polygons& SliceLayer::getInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const
 {
-    if (innermost_walls_cache.count(max_inset) > 0)
+    return innermost_walls_cache.get(max_inset, [this, max_inset, &mesh]()
     {
-        return innermost_walls_cache[max_inset];
-    }
-    Polygons& result = innermost_walls_cache.emplace(std::make_pair(max_inset, Polygons())).first->second;
+        return computeInnermostWalls(max_inset, mesh);
+    });
+}
+
+Polygons SliceLayer::computeInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const
+{
+    Polygons result;
 
     const coord_t half_line_width_0 = mesh.settings.get<coord_t>("wall_line_width_0") / 2;
     const coord_t half_line_width_x = mesh.settings.get<coord_t>("wall_line_width_x") / 2;
@@ -157,13 +328,22 @@ Polygons& SliceLayer::getInnermostWalls(const size_t max_inset, const SliceMeshS
     return result;
 }
 
+size_t SupportStorage::getMemorySize() const
+{
+    size_t bytes = supportLayers.capacity() * sizeof(SupportLayer);
+    for (const SupportLayer& layer : supportLayers)
+    {
+        bytes += getContentsMemorySize(layer);
+    }
+    return bytes;
+}
+
 SliceMeshStorage::SliceMeshStorage(Mesh* mesh, const size_t slice_layer_count)
 : settings(mesh->settings)
 , mesh_name(mesh->mesh_name)
 , layer_nr_max_filled_layer(0)
 , bounding_box(mesh->getAABB())
 , base_subdiv_cube(nullptr)
-, cross_fill_provider(nullptr)
 {
     layers.resize(slice_layer_count);
 }
@@ -174,10 +354,16 @@ SliceMeshStorage::~SliceMeshStorage()
     {
         delete base_subdiv_cube;
     }
-    if (cross_fill_provider)
+}
+
+size_t SliceMeshStorage::getMemorySize() const
+{
+    size_t bytes = layers.capacity() * sizeof(SliceLayer);
+    for (const SliceLayer& layer : layers)
     {
-        delete cross_fill_provider;
+        bytes += getContentsMemorySize(layer);
     }
+    return bytes + getContentsMemorySize(overhang_areas) + getContentsMemorySize(full_overhang_areas);
 }
 
 bool SliceMeshStorage::getExtruderIsUsed(const size_t extruder_nr) const
@@ -368,6 +554,9 @@ SliceDataStorage::SliceDataStorage()
 , extruder_switch_retraction_config_per_extruder(initializeRetractionConfigs())
 , max_print_height_second_to_last_extruder(-1)
 {
+    invalidateLayerOutlines();
+    path_configs_cache.reset(new PathConfigsCache(PATH_CONFIGS_CACHE_SIZE, [](const PathConfigStorage&) { return 1; }));
+
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     Point3 machine_max(mesh_group_settings.get<coord_t>("machine_width"), mesh_group_settings.get<coord_t>("machine_depth"), mesh_group_settings.get<coord_t>("machine_height"));
     Point3 machine_min(0, 0, 0);
@@ -380,7 +569,210 @@ SliceDataStorage::SliceDataStorage()
     machine_size.include(machine_max);
 }
 
+SliceDataStorage::~SliceDataStorage()
+{
+}
+
 Polygons SliceDataStorage::getLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only) const
+{
+    const int64_t key = static_cast<int64_t>(layer_nr) * 8 + include_support * 4 + include_prime_tower * 2 + external_polys_only;
+    return *layer_outlines_cache->get(key, [&]()
+    {
+        return computeLayerOutlines(layer_nr, include_support, include_prime_tower, external_polys_only);
+    });
+}
+
+std::shared_ptr<const PathConfigStorage> SliceDataStorage::getPathConfigs(const LayerIndex layer_nr, const coord_t layer_thickness) const
+{
+    //The layers below the speed slowdown layers and the first layer differ from the layers above them, and the raft (filler) layers from the first layer.
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const LayerIndex first_normal_layer_nr = std::max(LayerIndex(1), LayerIndex(mesh_group_settings.get<size_t>("speed_slowdown_layers")));
+    const LayerIndex config_layer_nr = std::max(LayerIndex(-1), std::min(layer_nr, first_normal_layer_nr));
+    const int64_t key = static_cast<int64_t>(config_layer_nr + 1) << 32 | static_cast<int64_t>(layer_thickness);
+    return path_configs_cache->get(key, [&]()
+    {
+        return PathConfigStorage(*this, config_layer_nr, layer_thickness);
+    });
+}
+
+void SliceDataStorage::invalidateLayerOutlines()
+{
+    layer_outlines_cache.reset(new LayerOutlinesCache(LAYER_OUTLINES_CACHE_SIZE, [](const Polygons& outlines) { return outlines.getMemorySize(); }));
+    layer_outlines_cache->trackMemory(MemoryAccount::LAYER_OUTLINES);
+}
+
+void SliceDataStorage::measureMemory(const char* stage_name) const
+{
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    if (!budget.isTracking())
+    {
+        return;
+    }
+    size_t mesh_bytes = 0;
+    for (const SliceMeshStorage& mesh : meshes)
+    {
+        mesh_bytes += mesh.getMemorySize();
+    }
+    budget.set(MemoryAccount::MESH_LAYERS, mesh_bytes);
+    budget.set(MemoryAccount::SUPPORT_LAYERS, support.getMemorySize());
+    budget.record(stage_name);
+}
+
+void SliceDataStorage::releaseLayer(const LayerIndex layer_nr)
+{
+    size_t mesh_bytes = 0;
+    for (SliceMeshStorage& mesh : meshes)
+    {
+        if (layer_nr < static_cast<LayerIndex>(mesh.layers.size()))
+        {
+            SliceLayer& layer = mesh.layers[layer_nr];
+            mesh_bytes += getContentsMemorySize(layer);
+            SliceLayer released;
+            released.printZ = layer.printZ;
+            released.thickness = layer.thickness;
+            layer = std::move(released);
+        }
+        if (layer_nr < static_cast<LayerIndex>(mesh.overhang_areas.size()))
+        {
+            mesh_bytes += getContentsMemorySize(mesh.overhang_areas[layer_nr]);
+            mesh.overhang_areas[layer_nr] = Polygons();
+        }
+        if (layer_nr < static_cast<LayerIndex>(mesh.full_overhang_areas.size()))
+        {
+            mesh_bytes += getContentsMemorySize(mesh.full_overhang_areas[layer_nr]);
+            mesh.full_overhang_areas[layer_nr] = Polygons();
+        }
+    }
+    size_t support_bytes = 0;
+    if (layer_nr < static_cast<LayerIndex>(support.supportLayers.size()))
+    {
+        support_bytes = getContentsMemorySize(support.supportLayers[layer_nr]);
+        support.supportLayers[layer_nr] = SupportLayer();
+    }
+
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    if (budget.isTracking())
+    {
+        budget.subtract(MemoryAccount::MESH_LAYERS, std::min(mesh_bytes, budget.get(MemoryAccount::MESH_LAYERS)));
+        budget.subtract(MemoryAccount::SUPPORT_LAYERS, std::min(support_bytes, budget.get(MemoryAccount::SUPPORT_LAYERS)));
+    }
+}
+
+void SliceDataStorage::spillLayers(const std::string& directory)
+{
+    std::unique_ptr<LayerSpill> spill(new LayerSpill());
+    if (directory.empty())
+    {
+        spill->keepInMemory();
+    }
+    else if (!spill->open(directory))
+    {
+        return;
+    }
+    size_t layer_count = support.supportLayers.size();
+    for (const SliceMeshStorage& mesh : meshes)
+    {
+        layer_count = std::max(layer_count, mesh.layers.size());
+    }
+
+    size_t mesh_bytes = 0;
+    size_t support_bytes = 0;
+    size_t record_bytes = 0;
+    LayerIndex layer_nr = 0;
+    for (; layer_nr < static_cast<LayerIndex>(layer_count); layer_nr++)
+    {
+        BinaryWriter record;
+        for (const SliceMeshStorage& mesh : meshes)
+        {
+            if (layer_nr < static_cast<LayerIndex>(mesh.layers.size()))
+            {
+                LayerSpill::writeLayer(record, mesh.layers[layer_nr]);
+            }
+        }
+        if (layer_nr < static_cast<LayerIndex>(support.supportLayers.size()))
+        {
+            LayerSpill::writeLayer(record, support.supportLayers[layer_nr]);
+        }
+        if (!spill->write(layer_nr, record.getData()))
+        {
+            break; //Keep the rest in memory.
+        }
+        record_bytes += record.getData().size();
+
+        for (SliceMeshStorage& mesh : meshes)
+        {
+            if (layer_nr < static_cast<LayerIndex>(mesh.layers.size()))
+            {
+                SliceLayer& layer = mesh.layers[layer_nr];
+                mesh_bytes += getContentsMemorySize(layer);
+                SliceLayer spilled;
+                spilled.printZ = layer.printZ;
+                spilled.thickness = layer.thickness;
+                spilled.parts.resize(layer.parts.size());
+                for (size_t part_idx = 0; part_idx < layer.parts.size(); part_idx++)
+                {
+                    spilled.parts[part_idx].wall_overlap_linkers = std::move(layer.parts[part_idx].wall_overlap_linkers);
+                }
+                layer = std::move(spilled);
+            }
+        }
+        if (layer_nr < static_cast<LayerIndex>(support.supportLayers.size()))
+        {
+            support_bytes += getContentsMemorySize(support.supportLayers[layer_nr]);
+            support.supportLayers[layer_nr] = SupportLayer();
+        }
+    }
+    spill->map();
+    layer_spill = std::move(spill);
+    log("Stored %d layers %s: %zu bytes of geometry in %zu bytes.\n", static_cast<int>(layer_nr), directory.empty() ? "compressed in memory" : "on disk", mesh_bytes + support_bytes, record_bytes);
+
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    if (budget.isTracking())
+    {
+        budget.subtract(MemoryAccount::MESH_LAYERS, std::min(mesh_bytes, budget.get(MemoryAccount::MESH_LAYERS)));
+        budget.subtract(MemoryAccount::SUPPORT_LAYERS, std::min(support_bytes, budget.get(MemoryAccount::SUPPORT_LAYERS)));
+    }
+}
+
+void SliceDataStorage::pageInLayer(const LayerIndex layer_nr)
+{
+    if (!layer_spill)
+    {
+        return;
+    }
+    layer_spill->pageIn(layer_nr, [this, layer_nr](BinaryReader& record)
+    {
+        bool is_intact = true;
+        size_t mesh_bytes = 0;
+        for (SliceMeshStorage& mesh : meshes)
+        {
+            if (layer_nr < static_cast<LayerIndex>(mesh.layers.size()))
+            {
+                is_intact = is_intact && LayerSpill::readLayer(record, mesh.layers[layer_nr]);
+                mesh_bytes += getContentsMemorySize(mesh.layers[layer_nr]);
+            }
+        }
+        size_t support_bytes = 0;
+        if (layer_nr < static_cast<LayerIndex>(support.supportLayers.size()))
+        {
+            is_intact = is_intact && LayerSpill::readLayer(record, support.supportLayers[layer_nr]);
+            support_bytes = getContentsMemorySize(support.supportLayers[layer_nr]);
+        }
+        if (!is_intact || !record.atEnd())
+        {
+            logError("Layer %d couldn't be read back from disk completely.\n", static_cast<int>(layer_nr));
+        }
+
+        MemoryBudget& budget = MemoryBudget::getInstance();
+        if (budget.isTracking())
+        {
+            budget.add(MemoryAccount::MESH_LAYERS, mesh_bytes);
+            budget.add(MemoryAccount::SUPPORT_LAYERS, support_bytes);
+        }
+    });
+}
+
+Polygons SliceDataStorage::computeLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only) const
 {
     if (layer_nr < 0 && layer_nr < -static_cast<LayerIndex>(Raft::getFillerLayerCount()))
     { // when processing raft
@@ -423,7 +815,7 @@ Polygons SliceDataStorage::getLayerOutlines(const LayerIndex layer_nr, const boo
                 layer.getOutlines(total, external_polys_only);
                 if (mesh.settings.get<ESurfaceMode>("magic_mesh_surface_mode") != ESurfaceMode::NORMAL)
                 {
-                    total = total.unionPolygons(layer.openPolyLines.offsetPolyLine(100));
+                    total.unionInPlace(layer.openPolyLines.offsetPolyLine(100));
                 }
                 maximum_resolution = std::min(maximum_resolution, mesh.settings.get<coord_t>("meshfix_maximum_resolution"));
                 maximum_deviation = std::min(maximum_deviation, mesh.settings.get<coord_t>("meshfix_maximum_deviation"));
@@ -508,6 +900,45 @@ std::vector<bool> SliceDataStorage::getExtrudersUsed() const
 }
 
 std::vector<bool> SliceDataStorage::getExtrudersUsed(LayerIndex layer_nr) const
+{
+    if (layer_nr < 0 || layer_nr >= static_cast<LayerIndex>(extruders_used_per_layer.size()))
+    {
+        return computeExtrudersUsed(layer_nr);
+    }
+    const std::bitset<MAX_EXTRUDERS>& extruders_used = extruders_used_per_layer[layer_nr];
+    std::vector<bool> ret(Application::getInstance().current_slice->scene.extruders.size(), false);
+    for (size_t extruder_nr = 0; extruder_nr < ret.size(); extruder_nr++)
+    {
+        ret[extruder_nr] = extruders_used[extruder_nr];
+    }
+    return ret;
+}
+
+void SliceDataStorage::computeExtrudersUsedPerLayer()
+{
+    size_t layer_count = support.supportLayers.size();
+    for (const SliceMeshStorage& mesh : meshes)
+    {
+        layer_count = std::max(layer_count, mesh.layers.size());
+    }
+    std::vector<std::bitset<MAX_EXTRUDERS>> result(layer_count);
+    TaskScheduler scheduler;
+    for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(layer_count); layer_nr++)
+    {
+        scheduler.schedule([this, layer_nr, &result]()
+        {
+            const std::vector<bool> extruders_used = computeExtrudersUsed(layer_nr);
+            for (size_t extruder_nr = 0; extruder_nr < extruders_used.size(); extruder_nr++)
+            {
+                result[layer_nr][extruder_nr] = extruders_used[extruder_nr];
+            }
+        });
+    }
+    scheduler.run();
+    extruders_used_per_layer = std::move(result);
+}
+
+std::vector<bool> SliceDataStorage::computeExtrudersUsed(LayerIndex layer_nr) const
 {
     std::vector<bool> ret;
     ret.resize(Application::getInstance().current_slice->scene.extruders.size(), false);
@@ -4,17 +4,23 @@
 #ifndef SLICE_DATA_STORAGE_H
 #define SLICE_DATA_STORAGE_H
 
+#include <bitset>
 #include <map>
+#include <memory> //For shared_ptr.
 #include "PrimeTower.h"
 #include "RetractionConfig.h"
 #include "SupportInfillPart.h"
 #include "TopSurface.h"
 #include "settings/Settings.h" //For MAX_EXTRUDERS.
+#include "settings/SettingsSnapshot.h"
 #include "settings/types/AngleDegrees.h" //Infill angles.
 #include "settings/types/LayerIndex.h"
 #include "utils/AABB.h"
 #include "utils/AABB3D.h"
+#include "utils/AABBTree.h"
+#include "utils/ConcurrentLRUCache.h"
 #include "utils/IntPoint.h"
+#include "utils/LazyInitialization.h"
 #include "utils/NoCopy.h"
 #include "utils/optional.h"
 #include "utils/polygon.h"
@@ -23,8 +29,12 @@
 namespace cura 
 {
 
+class LayerSpill;
 class Mesh;
+class PathConfigStorage;
+class PolygonProximityLinker;
 class SierpinskiFillProvider;
+class SkinWallCache;
 
 /*!
  * A SkinPart is a connected area designated as top and/or bottom skin. 
@@ -57,6 +67,7 @@ public:
     Polygons perimeter_gaps; //!< The gaps between consecutive walls and between the inner wall and outer skin inset
     Polygons outline_gaps; //!< The gaps between the outline of the mesh and the first wall. a.k.a. thin walls.
     std::vector<SkinPart> skin_parts;     //!< The skin parts which are filled for 100% with lines and/or insets.
+    bool is_enclosed = false; //!< Whether this part lies in a hole of another part of the same layer, as found when splitting the layer into parts. Its outline is then not on the outside of the layer.
 
     /*!
      * The areas inside of the mesh.
@@ -123,6 +134,26 @@ public:
      */
     std::vector<std::vector<Polygons>> infill_area_per_combine_per_density;
 
+    /*!
+     * The sparse infill paths, generated from infill_area_per_combine_per_density before the g-code is written.
+     *
+     * infill_polygons_per_combine[n] and infill_lines_per_combine[n] fill the infill areas of (n+1) layers thick, of all densities together.
+     * These are empty if the mesh has no sparse infill, or spaghetti infill instead.
+     */
+    std::vector<Polygons> infill_polygons_per_combine;
+    std::vector<Polygons> infill_lines_per_combine; //!< \see SliceLayerPart::infill_polygons_per_combine
+
+    /*!
+     * The overlaps between the walls, computed before the g-code is written for
+     * the walls of which the overlap is compensated.
+     *
+     * If the order of the walls is optimized (see
+     * InsetOrderOptimizer::optimizingInsetsIsWorthwhile) the first is for the
+     * outer wall and the second for all inner walls together. Otherwise there is
+     * one for each inset. It is nullptr where the overlap isn't compensated.
+     */
+    std::vector<std::shared_ptr<const PolygonProximityLinker>> wall_overlap_linkers;
+
     /*!
      * Get the infill_area_own (or when it's not instantiated: the normal infill_area)
      * \see SliceLayerPart::infill_area_own
@@ -137,6 +168,15 @@ public:
      */
     const Polygons& getOwnInfillArea() const;
 
+    /*!
+     * Move the part with its walls, skin and infill areas, to give a copy of
+     * the part elsewhere on the build plate.
+     *
+     * The wall overlaps can't be moved, so they must not be computed yet.
+     * \param translation The direction in which to move the part.
+     */
+    void translate(const Point translation);
+
     std::vector<std::pair<Polygons, double>> spaghetti_infill_volumes; //!< For each filling volume on this layer, the area within which to fill and the total volume (in mm3) to fill over the area
 };
 
@@ -150,7 +190,7 @@ public:
     coord_t thickness;  //!< The thickness of this layer. Can be different when using variable layer heights.
     std::vector<SliceLayerPart> parts;  //!< An array of LayerParts which contain the actual data. The parts are printed one at a time to minimize travel outside of the 3D model.
     Polygons openPolyLines; //!< A list of lines which were never hooked up into a 2D polygon. (Currently unused in normal operation)
-    mutable std::map<size_t, Polygons> innermost_walls_cache; //!< Cache for the in some cases computationaly expensive calculations in 'getInnermostWalls'.
+    mutable LazyInitializationMap<size_t, Polygons> innermost_walls_cache; //!< Cache for the in some cases computationaly expensive calculations in 'getInnermostWalls'. Safe to use from multiple threads.
         // ^^^^ NOTE: Caching function-results like this, when they don't change but are expensive to calculate, is generally considered one of the few 'acceptable uses' of the 'mutable' keyword.
 
     /*!
@@ -161,10 +201,34 @@ public:
      */
     TopSurface top_surface;
 
+    /*!
+     * \brief The bounding boxes of the parts, to find the parts near a box
+     * without checking all of them.
+     *
+     * Layers with only a few parts aren't indexed. See \ref indexParts.
+     */
+    AABBTree parts_index;
+
+    /*!
+     * \brief Index the bounding boxes of the parts for \ref getPartsHitting.
+     *
+     * This must be called again whenever the parts are replaced. If it isn't,
+     * \ref getPartsHitting checks every part instead.
+     */
+    void indexParts();
+
+    /*!
+     * \brief Get the parts whose bounding box overlaps with a box.
+     * \param box The box to look for, e.g. the bounding box of a part of
+     * another layer.
+     * \return The indices of those parts, from low to high.
+     */
+    std::vector<size_t> getPartsHitting(const AABB& box) const;
+
     /*!
      * Get the all outlines of all layer parts in this layer.
      * 
-     * \param external_polys_only Whether to only include the outermost outline of each layer part
+     * \param external_polys_only Whether to only include the outermost outline of each layer part, leaving out parts that lie in a hole of another part
      * \return A collection of all the outline polygons
      */
     Polygons getOutlines(bool external_polys_only = false) const;
@@ -173,7 +237,7 @@ public:
      * Get the all outlines of all layer parts in this layer.
      * Add those polygons to @p result.
      * 
-     * \param external_polys_only Whether to only include the outermost outline of each layer part
+     * \param external_polys_only Whether to only include the outermost outline of each layer part, leaving out parts that lie in a hole of another part
      * \param result The result: a collection of all the outline polygons
      */
     void getOutlines(Polygons& result, bool external_polys_only = false) const;
@@ -184,9 +248,16 @@ public:
      * \param max_inset If <= 1, use (up to) the 1st inner wall, if >= 2, use the 2nd inner wall.
      * \param mesh Pass mesh to let the function have access to wall-line-width settings.
      */
-    Polygons& getInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const;
+    const Polygons& getInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const;
 
     ~SliceLayer();
+
+private:
+    /*!
+     * Computes the innermost walls without looking in the cache.
+     * See \ref SliceLayer::getInnermostWalls for the parameters.
+     */
+    Polygons computeInnermostWalls(const size_t max_inset, const SliceMeshStorage& mesh) const;
 };
 
 /******************/
@@ -221,10 +292,16 @@ public:
     int layer_nr_max_filled_layer; //!< the layer number of the uppermost layer with content
 
     std::vector<SupportLayer> supportLayers;
-    SierpinskiFillProvider* cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern
+    std::shared_ptr<const SierpinskiFillProvider> cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern, which may be shared with later slices
 
     SupportStorage();
     ~SupportStorage();
+
+    /*!
+     * \return The approximate number of bytes that the support layers take
+     * up in memory.
+     */
+    size_t getMemorySize() const;
 };
 /******************/
 
@@ -234,6 +311,7 @@ class SliceMeshStorage
 {
 public:
     Settings& settings;
+    MeshSettingsSnapshot settings_snapshot; //!< The resolved settings that the g-code writer reads for every part and wall. Filled by \ref FffGcodeWriter before writing the g-code.
     std::vector<SliceLayer> layers;
     std::string mesh_name;
 
@@ -248,7 +326,8 @@ public:
     AABB3D bounding_box; //!< the mesh's bounding box
 
     SubDivCube* base_subdiv_cube;
-    SierpinskiFillProvider* cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern
+    std::shared_ptr<const SierpinskiFillProvider> cross_fill_provider; //!< the fractal pattern for the cross (3d) filling pattern, which may be shared with later slices
+    std::shared_ptr<SkinWallCache> skin_wall_cache; //!< the offset walls that the skin computation of each layer looks at, only present while the skins are being computed
 
     /*!
      * \brief Creates a storage space for slice results of a mesh.
@@ -261,6 +340,12 @@ public:
 
     virtual ~SliceMeshStorage();
 
+    /*!
+     * \return The approximate number of bytes that the layers and overhang
+     * areas of the mesh take up in memory.
+     */
+    size_t getMemorySize() const;
+
     /*!
      * \param extruder_nr The extruder for which to check
      * \return whether a particular extruder is used by this mesh
@@ -301,6 +386,8 @@ public:
     std::vector<RetractionConfig> retraction_config_per_extruder; //!< Retraction config per extruder.
     std::vector<RetractionConfig> extruder_switch_retraction_config_per_extruder; //!< Retraction config per extruder for when performing an extruder switch
 
+    std::vector<ExtruderSettingsSnapshot> settings_snapshot_per_extruder; //!< The resolved settings that the layer plans read for every travel move, per extruder.
+
     SupportStorage support;
 
     Polygons skirt_brim[MAX_EXTRUDERS]; //!< Skirt and brim polygons per extruder, ordered from inner to outer polygons.
@@ -311,7 +398,7 @@ public:
     std::vector<size_t> max_print_height_order; //!< Ordered indices into max_print_height_per_extruder: back() will return the extruder number with the highest print height.
 
     std::vector<int> spiralize_seam_vertex_indices; //!< the index of the seam vertex for each layer
-    std::vector<Polygons* > spiralize_wall_outlines; //!< the wall outline polygons for each layer
+    std::vector<Polygons* > spiralize_wall_outlines; //!< the wall outline polygons for each layer, filled in while the g-code is generated
 
     PrimeTower primeTower;
 
@@ -324,9 +411,7 @@ public:
      */
     SliceDataStorage();
 
-    ~SliceDataStorage()
-    {
-    }
+    ~SliceDataStorage();
 
     /*!
      * Get all outlines within a given layer.
@@ -340,6 +425,79 @@ public:
      */
     Polygons getLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only = false) const;
 
+    /*!
+     * \brief Forget the layer outlines that were computed so far.
+     *
+     * The outlines returned by \ref SliceDataStorage::getLayerOutlines are
+     * cached. This must be called whenever something that they are made of
+     * changes: the layers of the meshes, the support, the prime tower or the
+     * raft. It may not be called while other threads get layer outlines.
+     */
+    void invalidateLayerOutlines();
+
+    /*!
+     * \brief Get the line configs of a layer for each feature type.
+     *
+     * Only the first layers have configs of their own, because of their line
+     * width factor, their flow and their slower speeds. All other layers with
+     * the same thickness share the same configs, so these are made once for
+     * each kind of layer and thickness and cached. Safe to use from multiple
+     * threads.
+     * \param layer_nr The layer to get the configs for (negative layer numbers
+     * indicate the raft).
+     * \param layer_thickness The thickness of the layer.
+     */
+    std::shared_ptr<const PathConfigStorage> getPathConfigs(const LayerIndex layer_nr, const coord_t layer_thickness) const;
+
+    /*!
+     * \brief Measure the memory use of the mesh layers and support layers for
+     * the memory budget, and record all memory use with the stage timings.
+     *
+     * This is done at the boundaries of the stages of a slice. It does nothing
+     * if memory use isn't being tracked.
+     * \param stage_name The name under which to record the memory use. See
+     * \ref Instrumentation::Event::name.
+     */
+    void measureMemory(const char* stage_name) const;
+
+    /*!
+     * \brief Free the geometry of a layer of all meshes and of the support,
+     * once no g-code that is still to be generated looks at it.
+     *
+     * Only the height and thickness of the layers are kept. The cached layer
+     * outlines are left alone, since they evict themselves. This may be
+     * called while other threads process other layers, as long as those don't
+     * look at this layer.
+     * \param layer_nr The layer to release.
+     */
+    void releaseLayer(const LayerIndex layer_nr);
+
+    /*!
+     * \brief Move the geometry of all layers of all meshes and of the support
+     * to a scratch file or compress it in memory, from where
+     * \ref SliceDataStorage::pageInLayer brings it back when it's needed.
+     *
+     * Like with \ref SliceDataStorage::releaseLayer, the height and thickness
+     * of the layers are kept, as well as the wall overlap linkers of the
+     * parts. The overhang areas are kept too. If a layer can't be written, it
+     * and the layers above it stay in memory. The cached layer outlines are left alone, so this may only be
+     * called once nothing that's computed from all layers changes anymore.
+     * \param directory The directory to make the scratch file in. If empty,
+     * the layers are kept compressed in memory instead.
+     */
+    void spillLayers(const std::string& directory);
+
+    /*!
+     * \brief Bring back the geometry of a layer that was spilled to disk or
+     * compressed.
+     *
+     * This does nothing if the layer wasn't spilled or was brought back
+     * already. It may be called while other threads process other layers or
+     * bring back the same layer.
+     * \param layer_nr The layer to bring back.
+     */
+    void pageInLayer(const LayerIndex layer_nr);
+
     /*!
      * Get the extruders used.
      * 
@@ -356,6 +514,16 @@ public:
      */
     std::vector<bool> getExtrudersUsed(LayerIndex layer_nr) const;
 
+    /*!
+     * \brief Record which extruders are used on each layer, so that
+     * \ref SliceDataStorage::getExtrudersUsed(LayerIndex) is a lookup
+     * rather than a search through the parts of all meshes.
+     *
+     * This is done in parallel for all layers, once the areas of the layers
+     * and of the support don't change anymore.
+     */
+    void computeExtrudersUsedPerLayer();
+
     /*!
      * Gets whether prime blob is enabled for the given extruder number.
      *
@@ -383,6 +551,29 @@ private:
      * Construct the wipe_config_per_extruder
      */
     std::vector<WipeScriptConfig> initializeWipeConfigs();
+
+private:
+    /*!
+     * \brief Compute the outlines of a layer, without looking in the cache.
+     *
+     * See \ref SliceDataStorage::getLayerOutlines for the parameters.
+     */
+    Polygons computeLayerOutlines(const LayerIndex layer_nr, const bool include_support, const bool include_prime_tower, const bool external_polys_only) const;
+
+    /*!
+     * \brief Find the extruders used on a layer, without looking at the
+     * extruders recorded per layer.
+     *
+     * See \ref SliceDataStorage::getExtrudersUsed(LayerIndex).
+     */
+    std::vector<bool> computeExtrudersUsed(LayerIndex layer_nr) const;
+
+    typedef ConcurrentLRUCache<int64_t, Polygons> LayerOutlinesCache; //!< Maps a layer number and combination of flags to the outlines of that layer.
+    std::unique_ptr<LayerOutlinesCache> layer_outlines_cache; //!< The outlines computed by getLayerOutlines so far.
+    typedef ConcurrentLRUCache<int64_t, PathConfigStorage> PathConfigsCache; //!< Maps a kind of layer and a layer thickness to the line configs of such layers.
+    std::unique_ptr<PathConfigsCache> path_configs_cache; //!< The line configs made by getPathConfigs so far.
+    std::vector<std::bitset<MAX_EXTRUDERS>> extruders_used_per_layer; //!< For each layer which extruders are used on it, once computed by computeExtrudersUsedPerLayer.
+    std::unique_ptr<LayerSpill> layer_spill; //!< Where the layers are kept after \ref SliceDataStorage::spillLayers, if anywhere.
 };
 
 }//namespace cura
@@ -2,16 +2,21 @@
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #include <stdio.h>
-#include <algorithm> // remove_if
+#include <algorithm> // find, lower_bound, remove_if, sort
+#include <cassert>
 
 #include "settings/AdaptiveLayerHeights.h"
 #include "Application.h"
+#include "OpenCLSlicer.h"
 #include "Slice.h"
 #include "slicer.h"
 #include "settings/EnumSettings.h"
 #include "settings/types/LayerIndex.h"
+#include "utils/AABB.h"
 #include "utils/gettime.h"
+#include "utils/Instrumentation.h"
 #include "utils/logoutput.h"
+#include "utils/SparseLineGrid.h"
 #include "utils/SparsePointGridInclusive.h"
 
 
@@ -20,21 +25,23 @@ namespace cura {
 int largest_neglected_gap_first_phase = MM2INT(0.01); //!< distance between two line segments regarded as connected
 int largest_neglected_gap_second_phase = MM2INT(0.02); //!< distance between two line segments regarded as connected
 int max_stitch1 = MM2INT(10.0); //!< maximal distance stitched between open polylines to form polygons
+int max_extensive_stitch_snap = 100; //!< maximal distance between the end of an open polyline and the polygon over which it is stitched in extensive stitching
+coord_t extensive_stitch_cell_size = MM2INT(1.0); //!< cell size of the grid used to find the polygons next to the ends of open polylines in extensive stitching
 
-void SlicerLayer::makeBasicPolygonLoops(Polygons& open_polylines)
+void SlicerLayer::makeBasicPolygonLoops(const Mesh* mesh, Polygons& open_polylines)
 {
     for(unsigned int start_segment_idx = 0; start_segment_idx < segments.size(); start_segment_idx++)
     {
         if (!segments[start_segment_idx].addedToPolygon)
         {
-            makeBasicPolygonLoop(open_polylines, start_segment_idx);
+            makeBasicPolygonLoop(mesh, open_polylines, start_segment_idx);
         }
     }
     //Clear the segmentList to save memory, it is no longer needed after this point.
     segments.clear();
 }
 
-void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int start_segment_idx)
+void SlicerLayer::makeBasicPolygonLoop(const Mesh* mesh, Polygons& open_polylines, unsigned int start_segment_idx)
 {
 
     Polygon poly;
@@ -45,7 +52,7 @@ void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int st
         SlicerSegment& segment = segments[segment_idx];
         poly.add(segment.end);
         segment.addedToPolygon = true;
-        segment_idx = getNextSegmentIdx(segment, start_segment_idx);
+        segment_idx = getNextSegmentIdx(mesh, segment, start_segment_idx);
         if (segment_idx == static_cast<int>(start_segment_idx))
         { // polyon is closed
             polygons.add(poly);
@@ -58,12 +65,10 @@ void SlicerLayer::makeBasicPolygonLoop(Polygons& open_polylines, unsigned int st
 
 int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, int face_idx, unsigned int start_segment_idx) const
 {
-    decltype(face_idx_to_segment_idx.begin()) it;
-    auto it_end = face_idx_to_segment_idx.end();
-    it = face_idx_to_segment_idx.find(face_idx);
-    if (it != it_end)
+    std::vector<int>::const_iterator it = std::lower_bound(segment_face_indices.begin(), segment_face_indices.end(), face_idx);
+    if (it != segment_face_indices.end() && *it == face_idx)
     {
-        int segment_idx = (*it).second;
+        int segment_idx = it - segment_face_indices.begin();
         Point p1 = segments[segment_idx].start;
         Point diff = segment.end - p1;
         if (shorterThen(diff, largest_neglected_gap_first_phase))
@@ -83,7 +88,7 @@ int SlicerLayer::tryFaceNextSegmentIdx(const SlicerSegment& segment, int face_id
     return -1;
 }
 
-int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, unsigned int start_segment_idx)
+int SlicerLayer::getNextSegmentIdx(const Mesh* mesh, const SlicerSegment& segment, unsigned int start_segment_idx)
 {
     int next_segment_idx = -1;
 
@@ -101,8 +106,7 @@ int SlicerLayer::getNextSegmentIdx(const SlicerSegment& segment, unsigned int st
     {
         // segment ended at vertex
 
-        const std::vector<uint32_t> &faces_to_try = segment.endVertex->connected_faces;
-        for (int face_to_try : faces_to_try)
+        for (const int face_to_try : mesh->getConnectedFaces(segment.endVertex - mesh->vertices.data()))
         {
             int result_segment_idx =
                 tryFaceNextSegmentIdx(segment, face_to_try, start_segment_idx);
@@ -540,126 +544,284 @@ void SlicerLayer::connectOpenPolylinesImpl(Polygons& open_polylines, coord_t max
     }
 }
 
-void SlicerLayer::stitch_extensive(Polygons& open_polylines)
+/*!
+ * Check whether \p input lies next to the line segment from \p p0 to \p p1,
+ * i.e. it projects onto the segment and is close to it.
+ */
+static bool isNextToSegment(const Point p0, const Point p1, const Point input)
 {
-    //For extensive stitching find 2 open polygons that are touching 2 closed polygons.
-    // Then find the shortest path over this polygon that can be used to connect the open polygons,
-    // And generate a path over this shortest bit to link up the 2 open polygons.
-    // (If these 2 open polygons are the same polygon, then the final result is a closed polyon)
+    //Q = A + Normal( B - A ) * ((( B - A ) dot ( P - A )) / VSize( A - B ));
+    const Point pDiff = p1 - p0;
+    const int64_t lineLength = vSize(pDiff);
+    if (lineLength <= 1)
+    {
+        return false;
+    }
+    const int64_t distOnLine = dot(pDiff, input - p0) / lineLength;
+    if (distOnLine < 0 || distOnLine > lineLength)
+    {
+        return false;
+    }
+    const Point q = p0 + pDiff * distOnLine / lineLength;
+    return shorterThen(q - input, max_extensive_stitch_snap);
+}
+
+/*!
+ * Find the first line segment of \p polygon which \p input lies next to.
+ * \return The index of the vertex at the end of that segment, or -1 if there is none.
+ */
+static size_t findPolygonSegmentNextTo(ConstPolygonRef polygon, const Point input)
+{
+    if (polygon.empty())
+    {
+        return -1;
+    }
+    Point p0 = polygon.back();
+    for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+    {
+        const Point p1 = polygon[point_idx];
+        if (isNextToSegment(p0, p1, input))
+        {
+            return point_idx;
+        }
+        p0 = p1;
+    }
+    return -1;
+}
+
+/*!
+ * Remove an element from an unordered list of polyline indices.
+ */
+static void removePolylineIdx(std::vector<size_t>& polyline_indices, const size_t polyline_idx)
+{
+    std::vector<size_t>::iterator it = std::find(polyline_indices.begin(), polyline_indices.end(), polyline_idx);
+    assert(it != polyline_indices.end());
+    *it = polyline_indices.back();
+    polyline_indices.pop_back();
+}
 
-    while(1)
+bool SlicerLayer::GapCloserQueue::Connection::operator<(const Connection& other) const
+{
+    // worse if longer
+    if (result.len != other.result.len)
+    {
+        return result.len > other.result.len;
+    }
+    // Otherwise the order in which they are searched decides: by start polyline, closing a polyline onto itself first, then by end polyline.
+    if (start_polyline_idx != other.start_polyline_idx)
     {
-        unsigned int best_polyline_1_idx = -1;
-        unsigned int best_polyline_2_idx = -1;
-        GapCloserResult best_result;
-        best_result.len = POINT_MAX;
-        best_result.polygonIdx = -1;
-        best_result.pointIdxA = -1;
-        best_result.pointIdxB = -1;
+        return start_polyline_idx > other.start_polyline_idx;
+    }
+    const bool closes_polyline = end_polyline_idx == start_polyline_idx;
+    const bool other_closes_polyline = other.end_polyline_idx == other.start_polyline_idx;
+    if (closes_polyline != other_closes_polyline)
+    {
+        return other_closes_polyline;
+    }
+    return end_polyline_idx > other.end_polyline_idx;
+}
 
-        for(unsigned int polyline_1_idx = 0; polyline_1_idx < open_polylines.size(); polyline_1_idx++)
+SlicerLayer::GapCloserQueue::GapCloserQueue(const Polygons& polygons, const Polygons& open_polylines)
+: polygons(polygons)
+, open_polylines(open_polylines)
+, start_closest(open_polylines.size())
+, end_closest(open_polylines.size())
+, end_versions(open_polylines.size(), 0)
+, removed(open_polylines.size(), false)
+, queued_best(open_polylines.size())
+, polygon_starts(polygons.size())
+, polygon_ends(polygons.size())
+, polygon_lengths(polygons.size())
+{
+    // A line segment of one of the polygons, ending in the vertex with point_idx.
+    struct PolygonSegment
+    {
+        Point start;
+        Point end;
+        size_t polygon_idx;
+        size_t point_idx;
+    };
+
+    struct PolygonSegmentLocator
+    {
+        std::pair<Point, Point> operator()(const PolygonSegment& segment) const
         {
-            PolygonRef polyline_1 = open_polylines[polyline_1_idx];
-            if (polyline_1.size() < 1) continue;
+            return std::make_pair(segment.start, segment.end);
+        }
+    };
 
-            {
-                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_1.back());
-                if (res.len > 0 && res.len < best_result.len)
-                {
-                    best_polyline_1_idx = polyline_1_idx;
-                    best_polyline_2_idx = polyline_1_idx;
-                    best_result = res;
-                }
-            }
+    SparseLineGrid<PolygonSegment, PolygonSegmentLocator> segment_grid(extensive_stitch_cell_size);
+    for (size_t polygon_idx = 0; polygon_idx < polygons.size(); polygon_idx++)
+    {
+        ConstPolygonRef polygon = polygons[polygon_idx];
+        if (polygon.empty())
+        {
+            continue;
+        }
+        Point p0 = polygon.back();
+        for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+        {
+            segment_grid.insert(PolygonSegment{p0, polygon[point_idx], polygon_idx, point_idx});
+            p0 = polygon[point_idx];
+        }
+    }
 
-            for(unsigned int polyline_2_idx = 0; polyline_2_idx < open_polylines.size(); polyline_2_idx++)
+    // Finds the first segment in the order of the polygons that the point lies next to.
+    const std::function<ClosePolygonResult (const Point)> find_closest = [&segment_grid](const Point input)
+    {
+        ClosePolygonResult closest;
+        segment_grid.processNearby(input, max_extensive_stitch_snap * 2, [&closest, input](const PolygonSegment& segment)
             {
-                PolygonRef polyline_2 = open_polylines[polyline_2_idx];
-                if (polyline_2.size() < 1 || polyline_1_idx == polyline_2_idx) continue;
-
-                GapCloserResult res = findPolygonGapCloser(polyline_1[0], polyline_2.back());
-                if (res.len > 0 && res.len < best_result.len)
+                const bool is_earlier = closest.polygonIdx < 0
+                    || segment.polygon_idx < static_cast<size_t>(closest.polygonIdx)
+                    || (segment.polygon_idx == static_cast<size_t>(closest.polygonIdx) && segment.point_idx < closest.pointIdx);
+                if (is_earlier && isNextToSegment(segment.start, segment.end, input))
                 {
-                    best_polyline_1_idx = polyline_1_idx;
-                    best_polyline_2_idx = polyline_2_idx;
-                    best_result = res;
+                    closest.polygonIdx = segment.polygon_idx;
+                    closest.pointIdx = segment.point_idx;
                 }
-            }
+                return true;
+            });
+        return closest;
+    };
+
+    for (size_t polyline_idx = 0; polyline_idx < open_polylines.size(); polyline_idx++)
+    {
+        ConstPolygonRef polyline = open_polylines[polyline_idx];
+        if (polyline.empty())
+        {
+            removed[polyline_idx] = true;
+            continue;
         }
+        start_closest[polyline_idx] = find_closest(polyline[0]);
+        end_closest[polyline_idx] = find_closest(polyline.back());
+        registerStart(polyline_idx);
+        registerEnd(polyline_idx);
+    }
+    for (size_t polyline_idx = 0; polyline_idx < open_polylines.size(); polyline_idx++)
+    {
+        if (!removed[polyline_idx])
+        {
+            queueBest(polyline_idx);
+        }
+    }
+}
 
-        if (best_result.len < POINT_MAX)
+bool SlicerLayer::GapCloserQueue::pop(size_t& start_polyline_idx, size_t& end_polyline_idx, GapCloserResult& result)
+{
+    while (!queue.empty())
+    {
+        const Connection connection = queue.top();
+        queue.pop();
+        if (removed[connection.start_polyline_idx])
+        {
+            continue; // This start is already connected.
+        }
+        if (!isCurrent(connection))
         {
-            if (best_polyline_1_idx == best_polyline_2_idx)
+            // The end moved, so this start may now be best connected elsewhere. Unless a better connection was already queued for it.
+            if (!isCurrent(queued_best[connection.start_polyline_idx]))
             {
-                if (best_result.pointIdxA == best_result.pointIdxB)
-                {
-                    polygons.add(open_polylines[best_polyline_1_idx]);
-                    open_polylines[best_polyline_1_idx].clear();
-                }
-                else if (best_result.AtoB)
-                {
-                    PolygonRef poly = polygons.newPoly();
-                    for(unsigned int j = best_result.pointIdxA; j != best_result.pointIdxB; j = (j + 1) % polygons[best_result.polygonIdx].size())
-                        poly.add(polygons[best_result.polygonIdx][j]);
-                    for(unsigned int j = open_polylines[best_polyline_1_idx].size() - 1; int(j) >= 0; j--)
-                        poly.add(open_polylines[best_polyline_1_idx][j]);
-                    open_polylines[best_polyline_1_idx].clear();
-                }
-                else
-                {
-                    unsigned int n = polygons.size();
-                    polygons.add(open_polylines[best_polyline_1_idx]);
-                    for(unsigned int j = best_result.pointIdxB; j != best_result.pointIdxA; j = (j + 1) % polygons[best_result.polygonIdx].size())
-                        polygons[n].add(polygons[best_result.polygonIdx][j]);
-                    open_polylines[best_polyline_1_idx].clear();
-                }
+                queueBest(connection.start_polyline_idx);
             }
-            else
+            continue;
+        }
+        start_polyline_idx = connection.start_polyline_idx;
+        end_polyline_idx = connection.end_polyline_idx;
+        result = connection.result;
+        return true;
+    }
+    return false;
+}
+
+void SlicerLayer::GapCloserQueue::removePolyline(const size_t polyline_idx)
+{
+    unregisterStart(polyline_idx);
+    unregisterEnd(polyline_idx);
+    removed[polyline_idx] = true;
+}
+
+void SlicerLayer::GapCloserQueue::moveEnd(const size_t polyline_idx, const size_t source_polyline_idx, const bool source_is_end)
+{
+    unregisterEnd(polyline_idx);
+    end_closest[polyline_idx] = source_is_end ? end_closest[source_polyline_idx] : start_closest[source_polyline_idx];
+    end_versions[polyline_idx]++;
+    registerEnd(polyline_idx);
+
+    const int polygon_idx = end_closest[polyline_idx].polygonIdx;
+    if (polygon_idx >= 0)
+    {
+        for (const size_t start_polyline_idx : polygon_starts[polygon_idx])
+        {
+            queueIfBetter(start_polyline_idx, polyline_idx);
+        }
+    }
+}
+
+void SlicerLayer::GapCloserQueue::addPolygon()
+{
+    const size_t polygon_idx = polygons.size() - 1;
+    polygon_starts.emplace_back();
+    polygon_ends.emplace_back();
+    polygon_lengths.emplace_back();
+
+    // Only the points that weren't next to any earlier polygon can be next to this one first.
+    ConstPolygonRef polygon = polygons[polygon_idx];
+    AABB polygon_aabb(polygon);
+    polygon_aabb.expand(max_extensive_stitch_snap * 2);
+    const std::function<void (std::vector<size_t>&, std::vector<ClosePolygonResult>&, std::vector<size_t>&, bool)> match =
+        [&](std::vector<size_t>& unmatched, std::vector<ClosePolygonResult>& closest, std::vector<size_t>& matched, bool is_end)
+        {
+            for (size_t unmatched_idx = 0; unmatched_idx < unmatched.size(); )
             {
-                if (best_result.pointIdxA == best_result.pointIdxB)
-                {
-                    for(unsigned int n=0; n<open_polylines[best_polyline_1_idx].size(); n++)
-                        open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
-                    open_polylines[best_polyline_1_idx].clear();
-                }
-                else if (best_result.AtoB)
-                {
-                    Polygon poly;
-                    for(unsigned int n = best_result.pointIdxA; n != best_result.pointIdxB; n = (n + 1) % polygons[best_result.polygonIdx].size())
-                        poly.add(polygons[best_result.polygonIdx][n]);
-                    for(unsigned int n=poly.size()-1;int(n) >= 0; n--)
-                        open_polylines[best_polyline_2_idx].add(poly[n]);
-                    for(unsigned int n=0; n<open_polylines[best_polyline_1_idx].size(); n++)
-                        open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
-                    open_polylines[best_polyline_1_idx].clear();
-                }
-                else
+                const size_t polyline_idx = unmatched[unmatched_idx];
+                const Point point = is_end ? open_polylines[polyline_idx].back() : open_polylines[polyline_idx][0];
+                const size_t point_idx = polygon_aabb.contains(point) ? findPolygonSegmentNextTo(polygon, point) : -1;
+                if (point_idx == static_cast<size_t>(-1))
                 {
-                    for(unsigned int n = best_result.pointIdxB; n != best_result.pointIdxA; n = (n + 1) % polygons[best_result.polygonIdx].size())
-                        open_polylines[best_polyline_2_idx].add(polygons[best_result.polygonIdx][n]);
-                    for(unsigned int n = open_polylines[best_polyline_1_idx].size() - 1; int(n) >= 0; n--)
-                        open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
-                    open_polylines[best_polyline_1_idx].clear();
+                    unmatched_idx++;
+                    continue;
                 }
+                closest[polyline_idx].polygonIdx = polygon_idx;
+                closest[polyline_idx].pointIdx = point_idx;
+                matched.push_back(polyline_idx);
+                unmatched[unmatched_idx] = unmatched.back();
+                unmatched.pop_back();
             }
-        }
-        else
-        {
-            break;
-        }
+        };
+    match(unmatched_starts, start_closest, polygon_starts[polygon_idx], false);
+    match(unmatched_ends, end_closest, polygon_ends[polygon_idx], true);
+
+    for (const size_t start_polyline_idx : polygon_starts[polygon_idx])
+    {
+        queueBest(start_polyline_idx);
     }
 }
 
-GapCloserResult SlicerLayer::findPolygonGapCloser(Point ip0, Point ip1)
+bool SlicerLayer::GapCloserQueue::isCurrent(const Connection& connection) const
 {
-    GapCloserResult ret;
-    ClosePolygonResult c1 = findPolygonPointClosestTo(ip0);
-    ClosePolygonResult c2 = findPolygonPointClosestTo(ip1);
+    return connection.result.len >= 0
+        && !removed[connection.end_polyline_idx]
+        && end_versions[connection.end_polyline_idx] == connection.end_version;
+}
+
+SlicerLayer::GapCloserQueue::Connection SlicerLayer::GapCloserQueue::makeConnection(const size_t start_polyline_idx, const size_t end_polyline_idx)
+{
+    Connection connection;
+    connection.start_polyline_idx = start_polyline_idx;
+    connection.end_polyline_idx = end_polyline_idx;
+    connection.end_version = end_versions[end_polyline_idx];
+
+    GapCloserResult& ret = connection.result;
+    const ClosePolygonResult& c1 = start_closest[start_polyline_idx];
+    const ClosePolygonResult& c2 = end_closest[end_polyline_idx];
     if (c1.polygonIdx < 0 || c1.polygonIdx != c2.polygonIdx)
     {
         ret.len = -1;
-        return ret;
+        return connection;
     }
+    const Point ip0 = open_polylines[start_polyline_idx][0];
+    const Point ip1 = open_polylines[end_polyline_idx].back();
     ret.polygonIdx = c1.polygonIdx;
     ret.pointIdxA = c1.pointIdx;
     ret.pointIdxB = c2.pointIdx;
@@ -669,79 +831,198 @@ GapCloserResult SlicerLayer::findPolygonGapCloser(Point ip0, Point ip1)
     {
         //Connection points are on the same line segment.
         ret.len = vSize(ip0 - ip1);
-    }else{
+    }
+    else
+    {
         //Find out if we have should go from A to B or the other way around.
-        Point p0 = polygons[ret.polygonIdx][ret.pointIdxA];
-        int64_t lenA = vSize(p0 - ip0);
-        for(unsigned int i = ret.pointIdxA; i != ret.pointIdxB; i = (i + 1) % polygons[ret.polygonIdx].size())
-        {
-            Point p1 = polygons[ret.polygonIdx][i];
-            lenA += vSize(p0 - p1);
-            p0 = p1;
-        }
-        lenA += vSize(p0 - ip1);
-
-        p0 = polygons[ret.polygonIdx][ret.pointIdxB];
-        int64_t lenB = vSize(p0 - ip1);
-        for(unsigned int i = ret.pointIdxB; i != ret.pointIdxA; i = (i + 1) % polygons[ret.polygonIdx].size())
-        {
-            Point p1 = polygons[ret.polygonIdx][i];
-            lenB += vSize(p0 - p1);
-            p0 = p1;
-        }
-        lenB += vSize(p0 - ip0);
+        ConstPolygonRef polygon = polygons[ret.polygonIdx];
+        const size_t before_A = (ret.pointIdxA + polygon.size() - 1) % polygon.size();
+        const size_t before_B = (ret.pointIdxB + polygon.size() - 1) % polygon.size();
+        const coord_t lenA = vSize(polygon[ret.pointIdxA] - ip0) + getWalkLength(ret.polygonIdx, ret.pointIdxA, before_B) + vSize(polygon[before_B] - ip1);
+        const coord_t lenB = vSize(polygon[ret.pointIdxB] - ip1) + getWalkLength(ret.polygonIdx, ret.pointIdxB, before_A) + vSize(polygon[before_A] - ip0);
 
         if (lenA < lenB)
         {
             ret.AtoB = true;
             ret.len = lenA;
-        }else{
+        }
+        else
+        {
             ret.AtoB = false;
             ret.len = lenB;
         }
     }
-    return ret;
+    return connection;
+}
+
+coord_t SlicerLayer::GapCloserQueue::getWalkLength(const size_t polygon_idx, const size_t from_point_idx, const size_t to_point_idx)
+{
+    ConstPolygonRef polygon = polygons[polygon_idx];
+    std::vector<coord_t>& lengths = polygon_lengths[polygon_idx];
+    if (lengths.empty())
+    {
+        lengths.reserve(polygon.size() + 1);
+        lengths.push_back(0);
+        for (size_t point_idx = 0; point_idx < polygon.size(); point_idx++)
+        {
+            lengths.push_back(lengths.back() + vSize(polygon[(point_idx + 1) % polygon.size()] - polygon[point_idx]));
+        }
+    }
+    if (from_point_idx <= to_point_idx)
+    {
+        return lengths[to_point_idx] - lengths[from_point_idx];
+    }
+    return lengths.back() - lengths[from_point_idx] + lengths[to_point_idx];
 }
 
-ClosePolygonResult SlicerLayer::findPolygonPointClosestTo(Point input)
+void SlicerLayer::GapCloserQueue::queueBest(const size_t start_polyline_idx)
 {
-    ClosePolygonResult ret;
-    for(unsigned int n=0; n<polygons.size(); n++)
+    Connection& best = queued_best[start_polyline_idx];
+    best.result.len = -1;
+    const int polygon_idx = start_closest[start_polyline_idx].polygonIdx;
+    if (polygon_idx < 0)
     {
-        Point p0 = polygons[n][polygons[n].size()-1];
-        for(unsigned int i=0; i<polygons[n].size(); i++)
+        return;
+    }
+    for (const size_t end_polyline_idx : polygon_ends[polygon_idx])
+    {
+        const Connection connection = makeConnection(start_polyline_idx, end_polyline_idx);
+        if (connection.result.len > 0 && connection.result.len < POINT_MAX && (best.result.len < 0 || best < connection))
         {
-            Point p1 = polygons[n][i];
+            best = connection;
+        }
+    }
+    if (best.result.len >= 0)
+    {
+        queue.push(best);
+    }
+}
+
+void SlicerLayer::GapCloserQueue::queueIfBetter(const size_t start_polyline_idx, const size_t end_polyline_idx)
+{
+    const Connection connection = makeConnection(start_polyline_idx, end_polyline_idx);
+    Connection& best = queued_best[start_polyline_idx];
+    if (connection.result.len > 0 && connection.result.len < POINT_MAX && (best.result.len < 0 || best < connection))
+    {
+        best = connection;
+        queue.push(connection);
+    }
+}
 
-            //Q = A + Normal( B - A ) * ((( B - A ) dot ( P - A )) / VSize( A - B ));
-            Point pDiff = p1 - p0;
-            int64_t lineLength = vSize(pDiff);
-            if (lineLength > 1)
+void SlicerLayer::GapCloserQueue::registerStart(const size_t polyline_idx)
+{
+    const int polygon_idx = start_closest[polyline_idx].polygonIdx;
+    (polygon_idx < 0 ? unmatched_starts : polygon_starts[polygon_idx]).push_back(polyline_idx);
+}
+
+void SlicerLayer::GapCloserQueue::registerEnd(const size_t polyline_idx)
+{
+    const int polygon_idx = end_closest[polyline_idx].polygonIdx;
+    (polygon_idx < 0 ? unmatched_ends : polygon_ends[polygon_idx]).push_back(polyline_idx);
+}
+
+void SlicerLayer::GapCloserQueue::unregisterStart(const size_t polyline_idx)
+{
+    const int polygon_idx = start_closest[polyline_idx].polygonIdx;
+    removePolylineIdx(polygon_idx < 0 ? unmatched_starts : polygon_starts[polygon_idx], polyline_idx);
+}
+
+void SlicerLayer::GapCloserQueue::unregisterEnd(const size_t polyline_idx)
+{
+    const int polygon_idx = end_closest[polyline_idx].polygonIdx;
+    removePolylineIdx(polygon_idx < 0 ? unmatched_ends : polygon_ends[polygon_idx], polyline_idx);
+}
+
+void SlicerLayer::stitch_extensive(Polygons& open_polylines)
+{
+    //For extensive stitching find 2 open polygons that are touching 2 closed polygons.
+    // Then find the shortest path over this polygon that can be used to connect the open polygons,
+    // And generate a path over this shortest bit to link up the 2 open polygons.
+    // (If these 2 open polygons are the same polygon, then the final result is a closed polyon)
+
+    bool has_open_polylines = false;
+    for (size_t polyline_idx = 0; polyline_idx < open_polylines.size(); polyline_idx++)
+    {
+        has_open_polylines |= !open_polylines[polyline_idx].empty();
+    }
+    if (!has_open_polylines)
+    {
+        return;
+    }
+
+    GapCloserQueue gap_closers(polygons, open_polylines);
+    size_t best_polyline_1_idx;
+    size_t best_polyline_2_idx;
+    GapCloserResult best_result;
+    while (gap_closers.pop(best_polyline_1_idx, best_polyline_2_idx, best_result))
+    {
+        if (best_polyline_1_idx == best_polyline_2_idx)
+        {
+            if (best_result.pointIdxA == best_result.pointIdxB)
             {
-                int64_t distOnLine = dot(pDiff, input - p0) / lineLength;
-                if (distOnLine >= 0 && distOnLine <= lineLength)
-                {
-                    Point q = p0 + pDiff * distOnLine / lineLength;
-                    if (shorterThen(q - input, 100))
-                    {
-                        ret.polygonIdx = n;
-                        ret.pointIdx = i;
-                        return ret;
-                    }
-                }
+                polygons.add(open_polylines[best_polyline_1_idx]);
+                open_polylines[best_polyline_1_idx].clear();
+            }
+            else if (best_result.AtoB)
+            {
+                PolygonRef poly = polygons.newPoly();
+                for(unsigned int j = best_result.pointIdxA; j != best_result.pointIdxB; j = (j + 1) % polygons[best_result.polygonIdx].size())
+                    poly.add(polygons[best_result.polygonIdx][j]);
+                for(unsigned int j = open_polylines[best_polyline_1_idx].size() - 1; int(j) >= 0; j--)
+                    poly.add(open_polylines[best_polyline_1_idx][j]);
+                open_polylines[best_polyline_1_idx].clear();
             }
-            p0 = p1;
+            else
+            {
+                unsigned int n = polygons.size();
+                polygons.add(open_polylines[best_polyline_1_idx]);
+                for(unsigned int j = best_result.pointIdxB; j != best_result.pointIdxA; j = (j + 1) % polygons[best_result.polygonIdx].size())
+                    polygons[n].add(polygons[best_result.polygonIdx][j]);
+                open_polylines[best_polyline_1_idx].clear();
+            }
+            gap_closers.removePolyline(best_polyline_1_idx);
+            gap_closers.addPolygon();
+        }
+        else
+        {
+            if (best_result.pointIdxA == best_result.pointIdxB)
+            {
+                for(unsigned int n=0; n<open_polylines[best_polyline_1_idx].size(); n++)
+                    open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
+                open_polylines[best_polyline_1_idx].clear();
+            }
+            else if (best_result.AtoB)
+            {
+                Polygon poly;
+                for(unsigned int n = best_result.pointIdxA; n != best_result.pointIdxB; n = (n + 1) % polygons[best_result.polygonIdx].size())
+                    poly.add(polygons[best_result.polygonIdx][n]);
+                for(unsigned int n=poly.size()-1;int(n) >= 0; n--)
+                    open_polylines[best_polyline_2_idx].add(poly[n]);
+                for(unsigned int n=0; n<open_polylines[best_polyline_1_idx].size(); n++)
+                    open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
+                open_polylines[best_polyline_1_idx].clear();
+            }
+            else
+            {
+                for(unsigned int n = best_result.pointIdxB; n != best_result.pointIdxA; n = (n + 1) % polygons[best_result.polygonIdx].size())
+                    open_polylines[best_polyline_2_idx].add(polygons[best_result.polygonIdx][n]);
+                for(unsigned int n = open_polylines[best_polyline_1_idx].size() - 1; int(n) >= 0; n--)
+                    open_polylines[best_polyline_2_idx].add(open_polylines[best_polyline_1_idx][n]);
+                open_polylines[best_polyline_1_idx].clear();
+            }
+            // polyline 1 was appended to polyline 2, which now ends where polyline 1 ended, or where it started if it was reversed
+            const bool reversed = best_result.pointIdxA != best_result.pointIdxB && !best_result.AtoB;
+            gap_closers.removePolyline(best_polyline_1_idx);
+            gap_closers.moveEnd(best_polyline_2_idx, best_polyline_1_idx, !reversed);
         }
     }
-    ret.polygonIdx = -1;
-    return ret;
 }
 
-void SlicerLayer::makePolygons(const Mesh* mesh)
+void SlicerLayer::makePolygons(const Mesh* mesh, const size_t vertex_budget)
 {
     Polygons open_polylines;
 
-    makeBasicPolygonLoops(open_polylines);
+    makeBasicPolygonLoops(mesh, open_polylines);
 
     connectOpenPolylines(open_polylines);
 
@@ -784,6 +1065,19 @@ void SlicerLayer::makePolygons(const Mesh* mesh)
     const coord_t line_segment_deviation = mesh->settings.get<coord_t>("meshfix_maximum_deviation");
     polygons.simplify(line_segment_resolution, line_segment_deviation);
 
+    //Layers with too many vertices slow down every later stage. Simplify them more coarsely until they fit the budget, within bounds.
+    if (vertex_budget > 0)
+    {
+        constexpr coord_t max_tolerance_factor = 16; //Never deviate more than this many times the configured resolution and deviation.
+        size_t vertex_count = polygons.pointCount();
+        for (coord_t factor = 2; factor <= max_tolerance_factor && vertex_count > vertex_budget; factor *= 2)
+        {
+            polygons.simplify(line_segment_resolution * factor, line_segment_deviation * factor);
+            vertex_count = polygons.pointCount();
+            ScopedTimer::count("vertex_budget_simplifications");
+        }
+    }
+
     polygons.removeDegenerateVerts(); // remove verts connected to overlapping line segments
 }
 
@@ -825,106 +1119,66 @@ Slicer::Slicer(Mesh* mesh, const coord_t thickness, const size_t slice_layer_cou
         }
     }
 
-    // loop over all mesh faces
-    for (unsigned int mesh_idx = 0; mesh_idx < mesh->faces.size(); mesh_idx++)
-    {
-        // get all vertices per face
-        const MeshFace& face = mesh->faces[mesh_idx];
-        const MeshVertex& v0 = mesh->vertices[face.vertex_index[0]];
-        const MeshVertex& v1 = mesh->vertices[face.vertex_index[1]];
-        const MeshVertex& v2 = mesh->vertices[face.vertex_index[2]];
-
-        // get all vertices represented as 3D point
-        Point3 p0 = v0.p;
-        Point3 p1 = v1.p;
-        Point3 p2 = v2.p;
+    const Settings& scene_settings = Application::getInstance().current_slice->scene.settings;
+    std::vector<SlicerLayer>& layers_ref = layers; // force layers not to be copied into the threads
 
-        // find the minimum and maximum z point
-        int32_t minZ = p0.z;
-        int32_t maxZ = p0.z;
-        if (p1.z < minZ) minZ = p1.z;
-        if (p2.z < minZ) minZ = p2.z;
-        if (p1.z > maxZ) maxZ = p1.z;
-        if (p2.z > maxZ) maxZ = p2.z;
+    // Huge meshes are cut on the GPU if there is one. This gives the same segments, so it only changes how long it takes.
+    const size_t gpu_minimum_faces = scene_settings.has("slicing_gpu_minimum_faces") ? scene_settings.get<size_t>("slicing_gpu_minimum_faces") : 1000000;
+    if (mesh->faces.size() < gpu_minimum_faces || !OpenCLSlicer::slice(*mesh, layers))
+    {
+        // Slice the layers in parallel. Each thread gets a contiguous range of layers and sweeps upward through the index of face heights,
+        // so that it only visits the faces which actually cross each layer.
+        const ZIntervalIndex face_z_index = mesh->getFaceZIndex();
+        const ZIntervalIndex* face_z_index_ptr = &face_z_index; // force the index not to be copied into the threads
 
-        // calculate all intersections between a layer plane and a triangle
-        for (unsigned int layer_nr = 0; layer_nr < layers.size(); layer_nr++)
+#pragma omp parallel default(none) shared(mesh, layers_ref, face_z_index_ptr)
         {
-            int32_t z = layers.at(layer_nr).z;
-
-            if (z < minZ) continue;
+            ZIntervalIndex::Sweep sweep(*face_z_index_ptr);
+            std::vector<size_t> layer_faces;
 
-            SlicerSegment s;
-            s.endVertex = nullptr;
-            int end_edge_idx = -1;
-
-            if (p0.z < z && p1.z >= z && p2.z >= z)
-            {
-                s = project2D(p0, p2, p1, z);
-                end_edge_idx = 0;
-                if (p1.z == z)
-                {
-                    s.endVertex = &v1;
-                }
-            }
-            else if (p0.z > z && p1.z < z && p2.z < z)
-            {
-                s = project2D(p0, p1, p2, z);
-                end_edge_idx = 2;
-            }
-            else if (p1.z < z && p0.z >= z && p2.z >= z)
+            // Static scheduling hands out contiguous ranges of layers, which each thread processes bottom to top, as the sweep requires.
+#pragma omp for schedule(static)
+            // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+            for (int layer_nr = 0; layer_nr < static_cast<int>(layers_ref.size()); layer_nr++)
             {
-                s = project2D(p1, p0, p2, z);
-                end_edge_idx = 1;
-                if (p2.z == z)
+                const ScopedTimer timer("slice_layer", layer_nr);
+                SlicerLayer& layer = layers_ref[layer_nr];
+                layer_faces = sweep.advance(layer.z, layer.z);
+                std::sort(layer_faces.begin(), layer_faces.end()); // slice in face order, so the segments are in the same order as when slicing face by face
+
+                layer.segments.reserve(layer_faces.size());
+                layer.segment_face_indices.reserve(layer_faces.size());
+                for (const size_t face_idx : layer_faces)
                 {
-                    s.endVertex = &v2;
-                }
-            }
-            else if (p1.z > z && p0.z < z && p2.z < z)
-            {
-                s = project2D(p1, p2, p0, z);
-                end_edge_idx = 0;
-            }
-            else if (p2.z < z && p1.z >= z && p0.z >= z)
-            {
-                s = project2D(p2, p1, p0, z);
-                end_edge_idx = 2;
-                if (p0.z == z)
-                {
-                    s.endVertex = &v0;
+                    SlicerSegment s;
+                    if (!sliceFace(*mesh, face_idx, layer.z, s))
+                    {
+                        continue;
+                    }
+                    // store the segments per layer
+                    layer.segment_face_indices.push_back(face_idx);
+                    layer.segments.push_back(s);
                 }
+                ScopedTimer::count("segments", layer.segments.size());
             }
-            else if (p2.z > z && p1.z < z && p0.z < z)
-            {
-                s = project2D(p2, p0, p1, z);
-                end_edge_idx = 1;
-            }
-            else
-            {
-                //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
-                //  on the slice would create two segments
-                continue;
-            }
-
-            // store the segments per layer
-            layers[layer_nr].face_idx_to_segment_idx.insert(std::make_pair(mesh_idx, layers[layer_nr].segments.size()));
-            s.faceIndex = mesh_idx;
-            s.endOtherFaceIdx = face.connected_face_index[end_edge_idx];
-            s.addedToPolygon = false;
-            layers[layer_nr].segments.push_back(s);
         }
     }
 
     log("slice of mesh took %.3f seconds\n",slice_timer.restart());
 
-    std::vector<SlicerLayer>& layers_ref = layers; // force layers not to be copied into the threads
+    const size_t vertex_budget = scene_settings.has("meshfix_maximum_layer_vertices") ? scene_settings.get<size_t>("meshfix_maximum_layer_vertices") : 0; //0 means no budget.
 
-#pragma omp parallel for default(none) shared(mesh, layers_ref)
+    // Layers can take very different amounts of time to stitch (broken meshes mainly need stitching in a few layers), so balance them dynamically.
+#pragma omp parallel for default(none) shared(mesh, layers_ref, vertex_budget) schedule(dynamic)
     // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
     for (int layer_nr = 0; layer_nr < static_cast<int>(layers_ref.size()); layer_nr++)
     {
-        layers_ref[layer_nr].makePolygons(mesh);
+        if (Application::getInstance().isSliceCancelled())
+        {
+            continue;
+        }
+        const ScopedTimer timer("stitch_layer", layer_nr);
+        layers_ref[layer_nr].makePolygons(mesh, vertex_budget);
     }
 
     switch(slicing_tolerance)
@@ -974,6 +1228,87 @@ Slicer::Slicer(Mesh* mesh, const coord_t thickness, const size_t slice_layer_cou
     log("slice make polygons took %.3f seconds\n", slice_timer.restart());
 }
 
+Slicer::Slicer(Mesh* mesh, const std::vector<SlicerLayer>& sliced_layers)
+: layers(sliced_layers)
+, mesh(mesh)
+{
+    mesh->expandXY(mesh->settings.get<coord_t>("xy_offset")); //Like slicing does.
+}
+
+bool Slicer::sliceFace(const Mesh& mesh, const size_t face_idx, const coord_t z, SlicerSegment& segment) const
+{
+    // get all vertices per face
+    const MeshFace& face = mesh.faces[face_idx];
+    const MeshVertex& v0 = mesh.vertices[face.vertex_index[0]];
+    const MeshVertex& v1 = mesh.vertices[face.vertex_index[1]];
+    const MeshVertex& v2 = mesh.vertices[face.vertex_index[2]];
+
+    // get all vertices represented as 3D point
+    Point3 p0 = v0.p;
+    Point3 p1 = v1.p;
+    Point3 p2 = v2.p;
+
+    SlicerSegment s;
+    s.endVertex = nullptr;
+    int end_edge_idx = -1;
+
+    // calculate the intersection between the layer plane and the triangle
+    if (p0.z < z && p1.z >= z && p2.z >= z)
+    {
+        s = project2D(p0, p2, p1, z);
+        end_edge_idx = 0;
+        if (p1.z == z)
+        {
+            s.endVertex = &v1;
+        }
+    }
+    else if (p0.z > z && p1.z < z && p2.z < z)
+    {
+        s = project2D(p0, p1, p2, z);
+        end_edge_idx = 2;
+    }
+    else if (p1.z < z && p0.z >= z && p2.z >= z)
+    {
+        s = project2D(p1, p0, p2, z);
+        end_edge_idx = 1;
+        if (p2.z == z)
+        {
+            s.endVertex = &v2;
+        }
+    }
+    else if (p1.z > z && p0.z < z && p2.z < z)
+    {
+        s = project2D(p1, p2, p0, z);
+        end_edge_idx = 0;
+    }
+    else if (p2.z < z && p1.z >= z && p0.z >= z)
+    {
+        s = project2D(p2, p1, p0, z);
+        end_edge_idx = 2;
+        if (p0.z == z)
+        {
+            s.endVertex = &v0;
+        }
+    }
+    else if (p2.z > z && p1.z < z && p0.z < z)
+    {
+        s = project2D(p2, p0, p1, z);
+        end_edge_idx = 1;
+    }
+    else
+    {
+        //Not all cases create a segment, because a point of a face could create just a dot, and two touching faces
+        //  on the slice would create two segments
+        return false;
+    }
+
+    s.faceIndex = face_idx;
+    s.endOtherFaceIdx = face.connected_face_index[end_edge_idx];
+    s.addedToPolygon = false;
+    segment = s;
+    return true;
+}
+
 coord_t Slicer::interpolate(const coord_t x, const coord_t x0, const coord_t x1, const coord_t y0, const coord_t y1) const
 {
     const coord_t dx_01 = x1 - x0;
@@ -5,7 +5,6 @@
 #define SLICER_H
 
 #include <queue>
-#include <unordered_map>
 #include "utils/polygon.h"
 
 /*
@@ -53,7 +52,7 @@ class SlicerLayer
 {
 public:
     std::vector<SlicerSegment> segments;
-    std::unordered_map<int, int> face_idx_to_segment_idx; // topology
+    std::vector<int> segment_face_indices; //!< For each segment, the index of the face it was sliced from. The segments are sliced in face order, so this is sorted and the segment of a face can be found with a binary search (topology).
 
     int z = -1;
     Polygons polygons;
@@ -63,34 +62,40 @@ public:
      * \brief Connect the segments into polygons for this layer of this \p mesh.
      * \param[in] mesh The mesh data for which we are connecting sliced
      * segments. The face data is used.
+     * \param vertex_budget The number of vertices that this layer should have
+     * at most. If it has more, it is simplified more coarsely, up to a bound.
+     * 0 means that there is no budget.
      */
-    void makePolygons(const Mesh* mesh);
+    void makePolygons(const Mesh* mesh, const size_t vertex_budget = 0);
 
 protected:
     /*!
      * Connect the segments into loops which correctly form polygons (don't perform stitching here)
      *
+     * \param[in] mesh The mesh that was sliced, to find the faces connected at vertices.
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      */
-    void makeBasicPolygonLoops(Polygons& open_polylines);
+    void makeBasicPolygonLoops(const Mesh* mesh, Polygons& open_polylines);
 
     /*!
      * Connect the segments into a loop, starting from the segment with index \p start_segment_idx
      *
+     * \param[in] mesh The mesh that was sliced, to find the faces connected at vertices.
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop
      * \param[in] start_segment_idx The index into SlicerLayer::segments for the first segment from which to start the polygon loop
      */
-    void makeBasicPolygonLoop(Polygons& open_polylines, unsigned int start_segment_idx);
+    void makeBasicPolygonLoop(const Mesh* mesh, Polygons& open_polylines, unsigned int start_segment_idx);
 
     /*!
      * Get the next segment connected to the end of \p segment.
      * Used to make closed polygon loops.
      * Return ASAP if segment is (also) connected to SlicerLayer::segments[\p start_segment_idx]
      *
+     * \param[in] mesh The mesh that was sliced, to find the faces connected at vertices.
      * \param[in] segment The segment from which to start looking for the next
      * \param[in] start_segment_idx The index to the segment which when conected to \p segment will immediately stop looking for further candidates.
      */
-    int getNextSegmentIdx(const SlicerSegment& segment, unsigned int start_segment_idx);
+    int getNextSegmentIdx(const Mesh* mesh, const SlicerSegment& segment, unsigned int start_segment_idx);
 
     /*!
      * Connecting polygons that are not closed yet, as models are not always perfect manifold we need to join some stuff up to get proper polygons.
@@ -111,13 +116,13 @@ protected:
      */
     void stitch(Polygons& open_polylines);
 
-    GapCloserResult findPolygonGapCloser(Point ip0, Point ip1);
-
-    ClosePolygonResult findPolygonPointClosestTo(Point input);
-
     /*!
      * Try to close up polylines into polygons while they have large gaps in them.
      *
+     * The start of a polyline and the end of a polyline which both lie next
+     * to the same closed polygon are connected along that polygon, shortest
+     * connection first. See \ref GapCloserQueue.
+     *
      * Clears all open polylines which are used up in the process
      *
      * \param[in,out] open_polylines The polylines which are stiched, but couldn't be closed into a loop yet
@@ -288,6 +293,131 @@ private:
         bool operator<(const PossibleStitch &other) const;
     };
 
+    /*!
+     * \brief The possible connections between open polylines along the
+     * closed polygons for \ref stitch_extensive, best first.
+     *
+     * Only the start of a polyline and the end of a polyline (possibly the
+     * same one) which lie next to the same polygon can be connected by
+     * \ref stitch_extensive. The segments next to which they lie are found
+     * once with a grid, after which the starts and ends are kept per
+     * polygon. For every start only its best connection is queued.
+     *
+     * Each connection moves the end of only one polyline, so only the starts
+     * next to the same polygon need to be compared to its new end. Queued
+     * connections to ends that moved are recognised when they come up and
+     * replaced by the next best connection for their start.
+     */
+    class GapCloserQueue
+    {
+    public:
+        /*!
+         * \param polygons The closed polygons along which to connect.
+         * \param open_polylines The polylines to connect.
+         */
+        GapCloserQueue(const Polygons& polygons, const Polygons& open_polylines);
+
+        /*!
+         * Get the shortest connection from the start of a polyline to the end
+         * of a polyline.
+         *
+         * \param[out] start_polyline_idx The polyline of which the start is connected.
+         * \param[out] end_polyline_idx The polyline of which the end is connected.
+         * \param[out] result How to connect them along the polygon.
+         * \return Whether there was any connection left.
+         */
+        bool pop(size_t& start_polyline_idx, size_t& end_polyline_idx, GapCloserResult& result);
+
+        /*!
+         * Register that a polyline was cleared, so it can't be connected any more.
+         * \param polyline_idx The index of the polyline.
+         */
+        void removePolyline(const size_t polyline_idx);
+
+        /*!
+         * Register that a polyline now ends at the start or the end of another
+         * polyline, because that one was appended to it.
+         *
+         * \param polyline_idx The polyline of which the end moved.
+         * \param source_polyline_idx The polyline of which the start or end it
+         * now ends at.
+         * \param source_is_end Whether it now ends at the end of the source
+         * polyline, rather than at its start.
+         */
+        void moveEnd(const size_t polyline_idx, const size_t source_polyline_idx, const bool source_is_end);
+
+        /*!
+         * Register that a polygon was added at the end of the polygons.
+         */
+        void addPolygon();
+
+    private:
+        /*!
+         * A connection from the start of a polyline to the end of a polyline.
+         */
+        struct Connection
+        {
+            GapCloserResult result; //!< How to connect along the polygon, or a negative length if the connection is invalid.
+            size_t start_polyline_idx; //!< The polyline of which the start is connected.
+            size_t end_polyline_idx; //!< The polyline of which the end is connected.
+            size_t end_version; //!< The number of times the end of that polyline had moved when this was computed.
+
+            /*!
+             * Orders connections by goodness, so that the priority queue
+             * gives the shortest first.
+             */
+            bool operator<(const Connection& other) const;
+        };
+
+        /*!
+         * Whether a connection is valid and still connects to the current end
+         * of its end polyline.
+         */
+        bool isCurrent(const Connection& connection) const;
+
+        /*!
+         * Compute how to connect the start of a polyline to the end of a polyline.
+         */
+        Connection makeConnection(const size_t start_polyline_idx, const size_t end_polyline_idx);
+
+        /*!
+         * Get the length along a polygon from one vertex forward to another.
+         */
+        coord_t getWalkLength(const size_t polygon_idx, const size_t from_point_idx, const size_t to_point_idx);
+
+        /*!
+         * Queue the best connection from the start of a polyline to any of the
+         * ends next to the same polygon.
+         */
+        void queueBest(const size_t start_polyline_idx);
+
+        /*!
+         * Queue the connection from the start of a polyline to the end of a
+         * polyline if it's better than the last connection queued for that
+         * start.
+         */
+        void queueIfBetter(const size_t start_polyline_idx, const size_t end_polyline_idx);
+
+        void registerStart(const size_t polyline_idx); //!< Add the start of a polyline to the starts next to its polygon.
+        void registerEnd(const size_t polyline_idx); //!< Add the end of a polyline to the ends next to its polygon.
+        void unregisterStart(const size_t polyline_idx); //!< Remove the start of a polyline from the starts next to its polygon.
+        void unregisterEnd(const size_t polyline_idx); //!< Remove the end of a polyline from the ends next to its polygon.
+
+        const Polygons& polygons; //!< The closed polygons along which to connect.
+        const Polygons& open_polylines; //!< The polylines to connect.
+        std::vector<ClosePolygonResult> start_closest; //!< For each polyline, the polygon segment next to its start.
+        std::vector<ClosePolygonResult> end_closest; //!< For each polyline, the polygon segment next to its end.
+        std::vector<size_t> end_versions; //!< For each polyline, the number of times its end moved.
+        std::vector<bool> removed; //!< For each polyline, whether it was cleared.
+        std::vector<Connection> queued_best; //!< For each polyline, the last connection that was queued from its start.
+        std::vector<std::vector<size_t>> polygon_starts; //!< For each polygon, the polylines of which the start lies next to it.
+        std::vector<std::vector<size_t>> polygon_ends; //!< For each polygon, the polylines of which the end lies next to it.
+        std::vector<size_t> unmatched_starts; //!< The polylines of which the start doesn't lie next to any polygon.
+        std::vector<size_t> unmatched_ends; //!< The polylines of which the end doesn't lie next to any polygon.
+        std::vector<std::vector<coord_t>> polygon_lengths; //!< For each polygon, the length from its first vertex to each vertex, computed when first needed.
+        std::priority_queue<Connection> queue; //!< The queued connections, best first.
+    };
+
     /*!
      * \brief Tracks movements of polyline end point locations (Terminus).
      *
@@ -492,6 +622,15 @@ public:
 
     Slicer(Mesh* mesh, const coord_t thickness, const size_t slice_layer_count, bool use_variable_layer_heights, std::vector<AdaptiveLayer> *adaptive_layers);
 
+    /*!
+     * \brief Create a slicer with layers that the same mesh was sliced into
+     * before, as kept by the \ref SlicerCache.
+     * \param mesh The mesh that was sliced.
+     * \param sliced_layers The layers of the mesh, as the other constructor
+     * makes them.
+     */
+    Slicer(Mesh* mesh, const std::vector<SlicerLayer>& sliced_layers);
+
     /*!
      * \brief Linear interpolation between coordinates of a line.
      *
@@ -520,6 +659,19 @@ public:
      */
     SlicerSegment project2D(const Point3& p0, const Point3& p1, const Point3& p2, const coord_t z) const;
 
+    /*!
+     * \brief Intersect a single face of a mesh with a layer.
+     *
+     * This doesn't modify the slicer, so multiple threads may slice faces at
+     * the same time.
+     * \param mesh The mesh that the face belongs to.
+     * \param face_idx The index of the face in the mesh to slice.
+     * \param z The Z coordinate of the layer to intersect with.
+     * \param[out] segment The resulting segment, if any.
+     * \return Whether the face produced a segment in this layer.
+     */
+    bool sliceFace(const Mesh& mesh, const size_t face_idx, const coord_t z, SlicerSegment& segment) const;
+
     void dumpSegmentsToHTML(const char* filename);
 };
 
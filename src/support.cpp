@@ -18,13 +18,16 @@
 #include "support.h"
 #include "infill/ImageBasedDensityProvider.h"
 #include "infill/SierpinskiFillProvider.h"
+#include "infill/SierpinskiFillProviderCache.h"
 #include "infill/UniformDensityProvider.h"
 #include "progress/Progress.h"
 #include "settings/EnumSettings.h" //For EFillMethod.
 #include "settings/types/AngleRadians.h" //To compute overhang distance from the angle.
 #include "settings/types/Ratio.h"
+#include "utils/Instrumentation.h"
 #include "utils/logoutput.h"
 #include "utils/math.h"
+#include "utils/polygonUtils.h" //To generate the insets of the parts of a layer together.
 
 namespace cura
 {
@@ -75,9 +78,15 @@ void AreaSupport::splitGlobalSupportAreasIntoSupportInfillParts(SliceDataStorage
 
     // the wall line count is used for calculating insets, and we generate support infill patterns within the insets
     const size_t wall_line_count = infill_extruder.settings.get<size_t>("support_wall_count");
+    const coord_t support_line_width_layer_0 = (mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") != EPlatformAdhesion::RAFT)
+        ? support_line_width * infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor")
+        : support_line_width;
 
     // generate separate support islands
-    for (unsigned int layer_nr = 0; layer_nr < total_layer_count - 1; ++layer_nr)
+    // Each layer only fills in its own parts, so the layers are processed in parallel.
+    #pragma omp parallel for shared(storage, global_support_areas_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(total_layer_count) - 1; ++layer_nr)
     {
         unsigned int wall_line_count_this_layer = wall_line_count;
         if (layer_nr == 0 && (support_pattern == EFillMethod::LINES || support_pattern == EFillMethod::ZIG_ZAG))
@@ -87,26 +96,22 @@ void AreaSupport::splitGlobalSupportAreasIntoSupportInfillParts(SliceDataStorage
         assert(storage.support.supportLayers[layer_nr].support_infill_parts.empty() && "support infill part list is supposed to be uninitialized");
 
         const Polygons& global_support_areas = global_support_areas_per_layer[layer_nr];
-        if (global_support_areas.size() == 0 || layer_nr < min_layer || layer_nr > max_layer)
+        std::vector<SupportInfillPart>& support_infill_parts = storage.support.supportLayers[layer_nr].support_infill_parts;
+        if (global_support_areas.size() == 0 || static_cast<size_t>(layer_nr) < min_layer || static_cast<size_t>(layer_nr) > max_layer)
         {
             // initialize support_infill_parts empty
-            storage.support.supportLayers[layer_nr].support_infill_parts.clear();
+            support_infill_parts.clear();
             continue;
         }
 
         std::vector<PolygonsPart> support_islands = global_support_areas.splitIntoParts();
+        const coord_t support_line_width_here = (layer_nr == 0) ? support_line_width_layer_0 : support_line_width;
+        support_infill_parts.reserve(support_islands.size());
         for (const PolygonsPart& island_outline : support_islands)
         {
-            coord_t support_line_width_here = support_line_width;
-            if (layer_nr == 0 && mesh_group_settings.get<EPlatformAdhesion>("adhesion_type") != EPlatformAdhesion::RAFT)
-            {
-                support_line_width_here *= infill_extruder.settings.get<Ratio>("initial_layer_line_width_factor");
-            }
             // we don't generate insets and infill area for the parts yet because later the skid/brim and prime
             // tower will remove themselves from the support, so the outlines of the parts can be changed.
-            SupportInfillPart support_infill_part(island_outline, support_line_width_here, wall_line_count_this_layer);
-
-            storage.support.supportLayers[layer_nr].support_infill_parts.push_back(support_infill_part);
+            support_infill_parts.emplace_back(island_outline, support_line_width_here, wall_line_count_this_layer);
         }
     }
 }
@@ -127,18 +132,28 @@ void AreaSupport::generateSupportInfillFeatures(SliceDataStorage& storage)
 void AreaSupport::prepareInsetsAndInfillAreasForForSupportInfillParts(SliceDataStorage& storage)
 {
     // at this stage, the outlines are final, and we can generate insets and infill area
-    for (SupportLayer& support_layer : storage.support.supportLayers)
+    // Each layer only changes its own parts, so the layers are processed in parallel.
+    #pragma omp parallel for shared(storage) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(storage.support.supportLayers.size()); layer_nr++)
     {
-        for (std::vector<SupportInfillPart>::iterator part_itr = support_layer.support_infill_parts.begin(); part_itr != support_layer.support_infill_parts.end(); ++part_itr)
+        std::vector<SupportInfillPart>& support_infill_parts = storage.support.supportLayers[layer_nr].support_infill_parts;
+        generateOutlineInsets(support_infill_parts);
+        // keep the parts that aren't empty, in their order
+        size_t kept_part_count = 0;
+        for (size_t part_idx = 0; part_idx < support_infill_parts.size(); part_idx++)
         {
-            SupportInfillPart& part = *part_itr;
-            const bool is_not_empty_part = part.generateInsetsAndInfillAreas();
-            if (!is_not_empty_part)
+            const bool is_not_empty_part = support_infill_parts[part_idx].generateInfillArea();
+            if (is_not_empty_part)
             {
-                support_layer.support_infill_parts.erase(part_itr);
-                --part_itr;
+                if (kept_part_count != part_idx)
+                {
+                    support_infill_parts[kept_part_count] = std::move(support_infill_parts[part_idx]);
+                }
+                kept_part_count++;
             }
         }
+        support_infill_parts.erase(support_infill_parts.begin() + kept_part_count, support_infill_parts.end());
     }
 }
 
@@ -204,7 +219,10 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
     LayerIndex max_layer = total_layer_count - 1;
 
     // compute different density areas for each support island
-    for (LayerIndex layer_nr = 0; layer_nr < static_cast<LayerIndex>(total_layer_count) - 1; layer_nr++)
+    // Each layer only changes its own parts and reads the outlines of the layers above, which don't change, so the layers are processed in parallel.
+    #pragma omp parallel for shared(storage) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(total_layer_count) - 1; layer_nr++)
     {
         if (layer_nr < min_layer || layer_nr > max_layer)
         {
@@ -238,7 +256,7 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
                     }
 
                     // compute intersections with relevent upper parts
-                    const std::vector<SupportInfillPart> upper_infill_parts = storage.support.supportLayers[upper_layer_idx].support_infill_parts;
+                    const std::vector<SupportInfillPart>& upper_infill_parts = storage.support.supportLayers[upper_layer_idx].support_infill_parts;
                     Polygons relevant_upper_polygons;
                     for (unsigned int upper_part_idx = 0; upper_part_idx < upper_infill_parts.size(); ++upper_part_idx)
                     {
@@ -271,7 +289,7 @@ void AreaSupport::generateGradualSupport(SliceDataStorage& storage)
                         }
                     }
 
-                    less_dense_support = less_dense_support.intersection(relevant_upper_polygons);
+                    less_dense_support.intersectionInPlace(relevant_upper_polygons);
                 }
                 if (less_dense_support.size() == 0)
                 {
@@ -324,13 +342,18 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
     max_layer = max_layer - 1;
     max_layer -= max_layer % combine_layers_amount;  // Round downwards to the nearest layer divisible by infill_sparse_combine.
 
-    for (size_t layer_idx = min_layer; layer_idx <= max_layer; layer_idx += combine_layers_amount) //Skip every few layers, but extrude more.
+    std::vector<size_t> combined_layers; // the layers that combine the infill of the layers below them
+    for (size_t layer_idx = min_layer; layer_idx <= max_layer && layer_idx < storage.support.supportLayers.size(); layer_idx += combine_layers_amount) //Skip every few layers, but extrude more.
     {
-        if (layer_idx >= storage.support.supportLayers.size())
-        {
-            break;
-        }
+        combined_layers.push_back(layer_idx);
+    }
 
+    // Every combined layer only changes itself and the layers below it that it combines, which no other combined layer touches.
+    #pragma omp parallel for shared(storage, combined_layers) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int combined_layer_idx = 0; combined_layer_idx < static_cast<int>(combined_layers.size()); combined_layer_idx++)
+    {
+        const size_t layer_idx = combined_layers[combined_layer_idx];
         SupportLayer& layer = storage.support.supportLayers[layer_idx];
         for (unsigned int combine_count_here = 1; combine_count_here < combine_layers_amount; ++combine_count_here)
         {
@@ -392,7 +415,7 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
                         for (unsigned int lower_density_idx = density_idx; lower_density_idx <= max_lower_density_idx && lower_density_idx < lower_layer_part.infill_area_per_combine_per_density.size(); lower_density_idx++)
                         {
                             std::vector<Polygons>& lower_infill_area_per_combine = lower_layer_part.infill_area_per_combine_per_density[lower_density_idx];
-                            lower_infill_area_per_combine[0] = lower_infill_area_per_combine[0].difference(intersection); // remove thickened area from lower (single thickness) layer
+                            lower_infill_area_per_combine[0].differenceInPlace(intersection); // remove thickened area from lower (single thickness) layer
                         }
                     }
 
@@ -404,26 +427,35 @@ void AreaSupport::combineSupportInfillLayers(SliceDataStorage& storage)
 }
 
 
-void AreaSupport::generateOutlineInsets(std::vector<Polygons>& insets, Polygons& outline, const unsigned int inset_count, const coord_t wall_line_width_x)
+void AreaSupport::generateOutlineInsets(std::vector<SupportInfillPart>& parts)
 {
-    for (unsigned int inset_idx = 0; inset_idx < inset_count; inset_idx++)
+    std::vector<bool> is_generated(parts.size(), false);
+    std::vector<const Polygons*> outlines;
+    std::vector<std::vector<Polygons>*> insets;
+    for (size_t first_part_idx = 0; first_part_idx < parts.size(); first_part_idx++)
     {
-        insets.push_back(Polygons());
-        if (inset_idx == 0)
+        if (is_generated[first_part_idx])
         {
-            insets[0] = outline.offset(-wall_line_width_x / 2);
+            continue;
         }
-        else
+        //Generate the insets of this part together with those of all later parts with the same walls.
+        const coord_t wall_line_width_x = parts[first_part_idx].support_line_width;
+        const int inset_count = parts[first_part_idx].inset_count_to_generate;
+        outlines.clear();
+        insets.clear();
+        for (size_t part_idx = first_part_idx; part_idx < parts.size(); part_idx++)
         {
-            insets[inset_idx] = insets[inset_idx - 1].offset(-wall_line_width_x);
+            SupportInfillPart& part = parts[part_idx];
+            if (!is_generated[part_idx] && part.support_line_width == wall_line_width_x && part.inset_count_to_generate == inset_count)
+            {
+                is_generated[part_idx] = true;
+                outlines.push_back(&part.outline);
+                insets.push_back(&part.insets);
+            }
         }
-
-        // optimize polygons: remove unnecessary verts
-        insets[inset_idx].simplify();
-        if (insets[inset_idx].size() < 1)
+        if (inset_count > 0)
         {
-            insets.pop_back();
-            break;
+            PolygonUtils::generateInsetsOfEach(outlines, -wall_line_width_x / 2, -wall_line_width_x, inset_count, insets);
         }
     }
 }
@@ -431,7 +463,10 @@ void AreaSupport::generateOutlineInsets(std::vector<Polygons>& insets, Polygons&
 void AreaSupport::cleanup(SliceDataStorage& storage)
 {
     const coord_t support_line_width = Application::getInstance().current_slice->scene.current_mesh_group->settings.get<coord_t>("support_line_width");
-    for (unsigned int layer_nr = 0; layer_nr < storage.support.supportLayers.size(); layer_nr++)
+    // Each layer only removes its own parts, so the layers are processed in parallel.
+    #pragma omp parallel for shared(storage) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_nr = 0; layer_nr < static_cast<int>(storage.support.supportLayers.size()); layer_nr++)
     {
         SupportLayer& layer = storage.support.supportLayers[layer_nr];
         for (unsigned int part_idx = 0; part_idx < layer.support_infill_parts.size(); part_idx++)
@@ -549,7 +584,7 @@ Polygons AreaSupport::join(const SliceDataStorage& storage, const Polygons& supp
                 log("Unknown platform adhesion type! Please implement the width of the platform adhesion here.");
                 break;
         }
-        machine_volume_border = machine_volume_border.offset(-adhesion_size);
+        machine_volume_border.offsetInPlace(-adhesion_size);
 
         const coord_t conical_smallest_breadth = infill_settings.get<coord_t>("support_conical_min_width");
         Polygons insetted = supportLayer_up.offset(-conical_smallest_breadth / 2);
@@ -631,9 +666,9 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
     for (int layer_nr = 0; layer_nr < max_layer_nr_support_mesh_filled; layer_nr++)
     {
         SupportLayer& support_layer = storage.support.supportLayers[layer_nr];
-        support_layer.anti_overhang = support_layer.anti_overhang.unionPolygons();
-        support_layer.support_mesh_drop_down = support_layer.support_mesh_drop_down.unionPolygons();
-        support_layer.support_mesh = support_layer.support_mesh.unionPolygons();
+        support_layer.anti_overhang.unionInPlace();
+        support_layer.support_mesh_drop_down.unionInPlace();
+        support_layer.support_mesh.unionInPlace();
     }
 
     // initialization of supportAreasPerLayer
@@ -642,10 +677,12 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
         storage.support.supportLayers.resize(storage.print_layer_count);
     }
 
-    // generate support areas
+    // decide which meshes to generate support areas for
+    std::vector<SupportAreasJob> jobs;
     bool support_meshes_drop_down_handled = false;
     bool support_meshes_handled = false;
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const coord_t layer_thickness = mesh_group_settings.get<coord_t>("layer_height");
     for (unsigned int mesh_idx = 0; mesh_idx < storage.meshes.size(); mesh_idx++)
     {
         SliceMeshStorage& mesh = storage.meshes[mesh_idx];
@@ -656,7 +693,8 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
         Settings* infill_settings = &storage.meshes[mesh_idx].settings;
         Settings* roof_settings = &storage.meshes[mesh_idx].settings;
         Settings* bottom_settings = &storage.meshes[mesh_idx].settings;
-        if (mesh.settings.get<bool>("support_mesh"))
+        const bool is_support_mesh_place_holder = mesh.settings.get<bool>("support_mesh"); // whether this mesh has empty SliceMeshStorage and is now used to generate support for all support meshes
+        if (is_support_mesh_place_holder)
         {
             if ((mesh.settings.get<bool>("support_mesh_drop_down") && support_meshes_drop_down_handled) ||
                 (!mesh.settings.get<bool>("support_mesh_drop_down") && support_meshes_handled) )
@@ -678,25 +716,101 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
                 support_meshes_handled = true;
             }
         }
-        std::vector<Polygons> mesh_support_areas_per_layer;
-        mesh_support_areas_per_layer.resize(storage.print_layer_count, Polygons());
+        else if (!mesh.settings.get<bool>("support_enable") || mesh_group_settings.get<ESupportType>("support_type") == ESupportType::NONE)
+        {
+            continue;
+        }
+
+        // early out
+        const coord_t z_distance_top = ((mesh.settings.get<bool>("support_roof_enable")) ? *roof_settings : *infill_settings).get<coord_t>("support_top_distance");
+        const size_t layer_z_distance_top = round_up_divide(z_distance_top, layer_thickness) + 1; // support must always be 1 layer below overhang
+        if (layer_z_distance_top + 1 > storage.print_layer_count)
+        {
+            continue;
+        }
+
+        jobs.emplace_back();
+        SupportAreasJob& job = jobs.back();
+        job.mesh_idx = mesh_idx;
+        job.infill_settings = infill_settings;
+        job.roof_settings = roof_settings;
+        job.bottom_settings = bottom_settings;
+        job.layer_z_distance_top = layer_z_distance_top;
+        job.xy_disallowed_per_layer.resize(storage.print_layer_count);
+        job.overhang_per_layer.resize(storage.print_layer_count);
+        job.support_areas.resize(storage.print_layer_count);
+    }
+
+    if (jobs.empty())
+    { // without support areas there is no interface to generate and nothing to split into parts
+        precomputeCrossInfillTree(storage);
+        return;
+    }
+
+    // Everything that only depends on the model is computed for all layers of all meshes up front, so that it's not in the way of the layer-by-layer generation below.
+    std::vector<Polygons> model_outlines;
+    model_outlines.resize(storage.print_layer_count);
+    #pragma omp parallel for shared(storage, model_outlines) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
+    {
+        constexpr bool no_support = false;
+        constexpr bool no_prime_tower = false;
+        model_outlines[layer_idx] = storage.getLayerOutlines(layer_idx, no_support, no_prime_tower);
+    }
+    #pragma omp parallel for shared(storage, model_outlines, jobs) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int job_layer_idx = 0; job_layer_idx < static_cast<int>(jobs.size() * storage.print_layer_count); job_layer_idx++)
+    {
+        precomputeSupportLayer(storage, model_outlines, jobs[job_layer_idx / storage.print_layer_count], job_layer_idx % storage.print_layer_count);
+    }
+
+    // The support of each layer rests on the support of the layer above it, so each mesh is generated layer by layer, but the meshes are independent of each other.
+    size_t total_layer_count = 0;
+    for (const SupportAreasJob& job : jobs)
+    {
+        total_layer_count += storage.print_layer_count - job.layer_z_distance_top;
+    }
+    size_t completed_layer_count = 0; //To track progress in a multi-threaded environment.
+    #pragma omp parallel for if (jobs.size() > 1) shared(storage, model_outlines, jobs, completed_layer_count, total_layer_count) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int job_idx = 0; job_idx < static_cast<int>(jobs.size()); job_idx++)
+    {
+        generateSupportAreasForMesh(storage, model_outlines, jobs[job_idx], completed_layer_count, total_layer_count);
+    }
+
+    for (const SupportAreasJob& job : jobs)
+    {
+        for (size_t layer_idx = job.support_areas.size() - 1; layer_idx != static_cast<size_t>(std::max(-1, storage.support.layer_nr_max_filled_layer)); layer_idx--)
+        {
+            if (job.support_areas[layer_idx].size() > 0)
+            {
+                storage.support.layer_nr_max_filled_layer = layer_idx;
+                break;
+            }
+        }
+        storage.support.generated = true;
+    }
 
-        generateSupportAreasForMesh(storage, *infill_settings, *roof_settings, *bottom_settings, mesh_idx, storage.print_layer_count, mesh_support_areas_per_layer);
-        const double minimum_support_area = mesh.settings.get<double>("minimum_support_area");
-        for (size_t layer_idx = 0; layer_idx < storage.print_layer_count; layer_idx++)
+    #pragma omp parallel for shared(storage, jobs, global_support_areas_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
+    {
+        for (SupportAreasJob& job : jobs)
         {
+            const double minimum_support_area = storage.meshes[job.mesh_idx].settings.get<double>("minimum_support_area");
             if (minimum_support_area > 0.0)
             {
-                mesh_support_areas_per_layer[layer_idx].removeSmallAreas(minimum_support_area);
+                job.support_areas[layer_idx].removeSmallAreas(minimum_support_area);
             }
-            global_support_areas_per_layer[layer_idx].add(mesh_support_areas_per_layer[layer_idx]);
+            global_support_areas_per_layer[layer_idx].add(job.support_areas[layer_idx]);
         }
     }
 
     for (unsigned int layer_idx = 0; layer_idx < storage.print_layer_count ; layer_idx++)
     {
         Polygons& support_areas = global_support_areas_per_layer[layer_idx];
-        support_areas = support_areas.unionPolygons();
+        support_areas.unionInPlace();
     }
 
     // handle support interface
@@ -708,13 +822,28 @@ void AreaSupport::generateSupportAreas(SliceDataStorage& storage)
             continue;
         }
 
+        if (!mesh.settings.get<bool>("support_roof_enable") && !mesh.settings.get<bool>("support_bottom_enable"))
+        {
+            continue;
+        }
+
+        // The interface of every layer looks at the outlines of a range of layers, so get the outlines of each layer only once.
+        std::vector<Polygons> mesh_outlines;
+        mesh_outlines.resize(mesh.layers.size());
+        #pragma omp parallel for shared(mesh, mesh_outlines) schedule(dynamic)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int layer_idx = 0; layer_idx < static_cast<int>(mesh.layers.size()); layer_idx++)
+        {
+            mesh_outlines[layer_idx] = mesh.layers[layer_idx].getOutlines();
+        }
+
         if (mesh.settings.get<bool>("support_roof_enable"))
         {
-            generateSupportRoof(storage, mesh, global_support_areas_per_layer);
+            generateSupportRoof(storage, mesh, mesh_outlines, global_support_areas_per_layer);
         }
         if (mesh.settings.get<bool>("support_bottom_enable"))
         {
-            generateSupportBottom(storage, mesh, global_support_areas_per_layer);
+            generateSupportBottom(storage, mesh, mesh_outlines, global_support_areas_per_layer);
         }
     }
 
@@ -755,18 +884,12 @@ void AreaSupport::precomputeCrossInfillTree(SliceDataStorage& storage)
 
         std::string cross_subdisivion_spec_image_file = infill_extruder.settings.get<std::string>("cross_support_density_image");
         std::ifstream cross_fs(cross_subdisivion_spec_image_file.c_str());
-        if (cross_subdisivion_spec_image_file != "" && cross_fs.good())
+        if (cross_subdisivion_spec_image_file != "" && !cross_fs.good())
         {
-            storage.support.cross_fill_provider = new SierpinskiFillProvider(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"), cross_subdisivion_spec_image_file);
-        }
-        else
-        {
-            if(cross_subdisivion_spec_image_file != "")
-            {
-                logError("Cannot find density image \'%s\'.", cross_subdisivion_spec_image_file.c_str());
-            }
-            storage.support.cross_fill_provider = new SierpinskiFillProvider(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"));
+            logError("Cannot find density image \'%s\'.", cross_subdisivion_spec_image_file.c_str());
+            cross_subdisivion_spec_image_file = "";
         }
+        storage.support.cross_fill_provider = SierpinskiFillProviderCache::getInstance().get(aabb, infill_extruder.settings.get<coord_t>("support_line_distance"), infill_extruder.settings.get<coord_t>("support_line_width"), cross_subdisivion_spec_image_file);
     }
 }
 
@@ -813,6 +936,7 @@ void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceM
     // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
     for (int layer_idx = 1; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
     {
+        const ScopedTimer timer("overhang", layer_idx);
         std::pair<Polygons, Polygons> basic_and_full_overhang = computeBasicAndFullOverhang(storage, mesh, layer_idx);
         mesh.overhang_areas[layer_idx] = basic_and_full_overhang.first; //Store the results.
         mesh.full_overhang_areas[layer_idx] = basic_and_full_overhang.second;
@@ -830,64 +954,69 @@ void AreaSupport::generateOverhangAreasForMesh(SliceDataStorage& storage, SliceM
  *
  * for support buildplate only: purge all support not connected to build plate
  */
-void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const Settings& infill_settings, const Settings& roof_settings, const Settings& bottom_settings, const size_t mesh_idx, const size_t layer_count, std::vector<Polygons>& support_areas)
+void AreaSupport::precomputeSupportLayer(const SliceDataStorage& storage, const std::vector<Polygons>& model_outlines, SupportAreasJob& job, const size_t layer_idx)
 {
-    SliceMeshStorage& mesh = storage.meshes[mesh_idx];
+    const SliceMeshStorage& mesh = storage.meshes[job.mesh_idx];
+    const Settings& infill_settings = *job.infill_settings;
+    const Settings& roof_settings = *job.roof_settings;
+    const bool is_support_mesh_place_holder = mesh.settings.get<bool>("support_mesh");
 
-    const bool is_support_mesh_place_holder = mesh.settings.get<bool>("support_mesh"); // whether this mesh has empty SliceMeshStorage and this function is now called to only generate support for all support meshes
-    if (!mesh.settings.get<bool>("support_enable") && !is_support_mesh_place_holder)
-    {
-        return;
+    //Compute the areas that are disallowed by the X/Y distance.
+    const Polygons& outlines = model_outlines[layer_idx];
+    const coord_t xy_distance = infill_settings.get<coord_t>("support_xy_distance");
+    const bool use_xy_distance_overhang = infill_settings.get<SupportDistPriority>("support_xy_overrides_z") == SupportDistPriority::Z_OVERRIDES_XY; // whether to use a different xy distance at overhangs
+    if (layer_idx > 0 && !is_support_mesh_place_holder && use_xy_distance_overhang) // don't compute overhang for the bottom layer and for support meshes
+    { //Z overrides XY distance.
+        const coord_t xy_distance_overhang = infill_settings.get<coord_t>("support_xy_distance_overhang");
+        const coord_t z_distance_top = ((mesh.settings.get<bool>("support_roof_enable")) ? roof_settings : infill_settings).get<coord_t>("support_top_distance");
+        const AngleRadians angle = ((mesh.settings.get<bool>("support_roof_enable")) ? roof_settings : infill_settings).get<AngleRadians>("support_angle");
+        const double tan_angle = tan(angle) - 0.01;  // the XY-component of the supportAngle
+
+        //Compute the areas that are too close to the model.
+        Polygons xy_overhang_disallowed = mesh.overhang_areas[layer_idx].offset(z_distance_top * tan_angle);
+        Polygons xy_non_overhang_disallowed = outlines.difference(mesh.overhang_areas[layer_idx].offset(xy_distance)).offset(xy_distance);
+        job.xy_disallowed_per_layer[layer_idx] = xy_overhang_disallowed.unionPolygons(xy_non_overhang_disallowed.unionPolygons(outlines.offset(xy_distance_overhang)));
     }
-    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
-    const ESupportType support_type = mesh_group_settings.get<ESupportType>("support_type");
-    if (support_type == ESupportType::NONE && !is_support_mesh_place_holder)
-    {
-        return;
+    else
+    { // simplified processing - just ensure support clears part by XY distance
+        job.xy_disallowed_per_layer[layer_idx] = outlines.offset(xy_distance);
     }
 
-    // early out
-    const coord_t layer_thickness = mesh_group_settings.get<coord_t>("layer_height");
-    const coord_t z_distance_top = ((mesh.settings.get<bool>("support_roof_enable")) ? roof_settings : infill_settings).get<coord_t>("support_top_distance");
-    const size_t layer_z_distance_top = round_up_divide(z_distance_top, layer_thickness) + 1; // support must always be 1 layer below overhang
-    if (layer_z_distance_top + 1 > layer_count)
+    //The overhang that the support of this layer has to hold up.
+    if (layer_idx + job.layer_z_distance_top < storage.print_layer_count)
     {
-        return;
-    }
+        Polygons& overhang = job.overhang_per_layer[layer_idx];
+        overhang = mesh.full_overhang_areas[layer_idx + job.layer_z_distance_top];
 
-    //Compute the areas that are disallowed by the X/Y distance.
-    std::vector<Polygons> xy_disallowed_per_layer;
-    xy_disallowed_per_layer.resize(layer_count);
-    // simplified processing for bottom layer - just ensure support clears part by XY distance
-    const coord_t xy_distance = infill_settings.get<coord_t>("support_xy_distance");
-    const coord_t xy_distance_overhang = infill_settings.get<coord_t>("support_xy_distance_overhang");
-    const bool use_xy_distance_overhang = infill_settings.get<SupportDistPriority>("support_xy_overrides_z") == SupportDistPriority::Z_OVERRIDES_XY; // whether to use a different xy distance at overhangs
-    const AngleRadians angle = ((mesh.settings.get<bool>("support_roof_enable")) ? roof_settings : infill_settings).get<AngleRadians>("support_angle");
-    const double tan_angle = tan(angle) - 0.01;  // the XY-component of the supportAngle
-    constexpr bool no_support = false;
-    constexpr bool no_prime_tower = false;
-    xy_disallowed_per_layer[0] = storage.getLayerOutlines(0, no_support, no_prime_tower).offset(xy_distance);
-    // for all other layers (of non support meshes) compute the overhang area and possibly use that when calculating the support disallowed area
-    #pragma omp parallel for default(none) shared(xy_disallowed_per_layer, storage, mesh) schedule(dynamic)
-    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
-    for (int layer_idx = 1; layer_idx < static_cast<int>(layer_count); layer_idx++)
-    {
-        Polygons outlines = storage.getLayerOutlines(layer_idx, no_support, no_prime_tower);
-        if (!is_support_mesh_place_holder)
-        { // don't compute overhang for support meshes
-            if (use_xy_distance_overhang) //Z overrides XY distance.
-            {
-                //Compute the areas that are too close to the model.
-                Polygons xy_overhang_disallowed = mesh.overhang_areas[layer_idx].offset(z_distance_top * tan_angle);
-                Polygons xy_non_overhang_disallowed = outlines.difference(mesh.overhang_areas[layer_idx].offset(xy_distance)).offset(xy_distance);
-                xy_disallowed_per_layer[layer_idx] = xy_overhang_disallowed.unionPolygons(xy_non_overhang_disallowed.unionPolygons(outlines.offset(xy_distance_overhang)));
-            }
+        const coord_t extension_offset = infill_settings.get<coord_t>("support_offset");
+        if (extension_offset && !is_support_mesh_place_holder)
+        {
+            overhang.offsetInPlace(extension_offset);
         }
-        if (is_support_mesh_place_holder || !use_xy_distance_overhang)
+
+        const bool use_towers = infill_settings.get<bool>("support_use_towers") && infill_settings.get<coord_t>("support_minimal_diameter") > 0;
+        if (use_towers && !is_support_mesh_place_holder)
         {
-            xy_disallowed_per_layer[layer_idx] = outlines.offset(xy_distance);
+            // handle straight walls
+            AreaSupport::handleWallStruts(infill_settings, overhang);
         }
     }
+}
+
+void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const std::vector<Polygons>& model_outlines, SupportAreasJob& job, size_t& completed_layer_count, const size_t total_layer_count)
+{
+    SliceMeshStorage& mesh = storage.meshes[job.mesh_idx];
+    const Settings& infill_settings = *job.infill_settings;
+    const Settings& bottom_settings = *job.bottom_settings;
+    const size_t layer_count = storage.print_layer_count;
+    const size_t layer_z_distance_top = job.layer_z_distance_top;
+    const std::vector<Polygons>& xy_disallowed_per_layer = job.xy_disallowed_per_layer;
+    std::vector<Polygons>& support_areas = job.support_areas;
+
+    const bool is_support_mesh_place_holder = mesh.settings.get<bool>("support_mesh"); // whether this mesh has empty SliceMeshStorage and this function is now called to only generate support for all support meshes
+    const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
+    const ESupportType support_type = mesh_group_settings.get<ESupportType>("support_type");
+    const coord_t layer_thickness = mesh_group_settings.get<coord_t>("layer_height");
 
     std::vector<Polygons> tower_roofs;
     Polygons stair_removal; // polygons to subtract from support because of stair-stepping
@@ -896,7 +1025,6 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
     const bool is_support_mesh_drop_down_place_holder = is_support_mesh_place_holder && mesh.settings.get<bool>("support_mesh_drop_down");
 
     const coord_t bottom_stair_step_width = std::max(static_cast<coord_t>(0), mesh.settings.get<coord_t>("support_bottom_stair_step_width"));
-    const coord_t extension_offset = infill_settings.get<coord_t>("support_offset");
 
     const coord_t minimum_diameter = infill_settings.get<coord_t>("support_minimal_diameter");
     const bool use_towers = infill_settings.get<bool>("support_use_towers") && minimum_diameter > 0;
@@ -930,17 +1058,10 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
     for (size_t layer_idx = layer_count - 1 - layer_z_distance_top; layer_idx != static_cast<size_t>(-1); layer_idx--)
     {
-        Polygons layer_this = mesh.full_overhang_areas[layer_idx + layer_z_distance_top];
-
-        if (extension_offset && !is_support_mesh_place_holder)
-        {
-            layer_this = layer_this.offset(extension_offset);
-        }
+        Polygons layer_this = std::move(job.overhang_per_layer[layer_idx]); // already extended and with wall struts
 
         if (use_towers && !is_support_mesh_place_holder)
         {
-            // handle straight walls
-            AreaSupport::handleWallStruts(infill_settings, layer_this);
             // handle towers
             AreaSupport::handleTowers(infill_settings, layer_this, tower_roofs, mesh.overhang_points, layer_idx, layer_count);
         }
@@ -952,7 +1073,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
             if (is_support_mesh_nondrop_place_holder)
             {
                 layer_above = &empty;
-                layer_this = layer_this.unionPolygons(storage.support.supportLayers[layer_idx].support_mesh);
+                layer_this.unionInPlace(storage.support.supportLayers[layer_idx].support_mesh);
             }
             layer_this = AreaSupport::join(storage, *layer_above, layer_this, smoothing_distance);
         }
@@ -971,9 +1092,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
                         const Polygons& layer_above = support_areas[layer_idx + tower_top_layer_count];
                         const Point middle = AABB(poly).getMiddle();
                         const bool has_support_above = layer_above.inside(middle);
-                        constexpr bool no_support = false;
-                        constexpr bool no_prime_tower = false;
-                        const bool has_model_below = storage.getLayerOutlines(layer_idx - tower_top_layer_count - bottom_empty_layer_count, no_support, no_prime_tower).inside(middle);
+                        const bool has_model_below = model_outlines[layer_idx - tower_top_layer_count - bottom_empty_layer_count].inside(middle);
                         if (has_support_above && !has_model_below)
                         {
                             Polygons tiny_tower_here;
@@ -987,30 +1106,35 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
         if (is_support_mesh_drop_down_place_holder && storage.support.supportLayers[layer_idx].support_mesh_drop_down.size() > 0)
         { // handle support mesh which should be supported by more support
-            layer_this = layer_this.unionPolygons(storage.support.supportLayers[layer_idx].support_mesh_drop_down);
+            layer_this.unionInPlace(storage.support.supportLayers[layer_idx].support_mesh_drop_down);
         }
 
         // Move up from model, while taking the (post-processed) x/y-disallowed area into account.
-        moveUpFromModel(storage, xy_disallowed_per_layer[layer_idx], stair_removal, layer_this, layer_idx, bottom_empty_layer_count, bottom_stair_step_layer_count, bottom_stair_step_width);
+        moveUpFromModel(model_outlines, xy_disallowed_per_layer[layer_idx], stair_removal, layer_this, layer_idx, bottom_empty_layer_count, bottom_stair_step_layer_count, bottom_stair_step_width);
 
         support_areas[layer_idx] = layer_this;
-        Progress::messageProgress(Progress::Stage::SUPPORT, layer_count * (mesh_idx + 1) - layer_idx, layer_count * storage.meshes.size());
+#pragma omp critical (progress)
+        {
+            completed_layer_count++;
+            Progress::messageProgress(Progress::Stage::SUPPORT, completed_layer_count, total_layer_count);
+        }
     }
 
     // Substract x/y-disallowed area from the support.
     // This is done after the main loop, because at least one of the calculations there rely on other layers _without_ the x/y-disallowed area.
-    for (size_t layer_idx = layer_count - 1 - layer_z_distance_top; layer_idx != static_cast<size_t>(-1); layer_idx--)
+#pragma omp parallel for shared(support_areas, xy_disallowed_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(layer_count - layer_z_distance_top); layer_idx++)
     {
         Polygons& layer_this = support_areas[layer_idx];
 
         // inset using X/Y distance
         if (layer_this.size() > 0)
         {
-            layer_this = layer_this.difference(xy_disallowed_per_layer[layer_idx]);
+            layer_this.differenceInPlace(xy_disallowed_per_layer[layer_idx]);
         }
     }
 
-
     // do stuff for when support on buildplate only
     if (support_type == ESupportType::PLATFORM_ONLY)
     {
@@ -1032,7 +1156,7 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
 
             if (conical_support)
             { // with conical support the next layer is allowed to be larger than the previous
-                touching_buildplate = touching_buildplate.offset(std::abs(conical_support_offset) + 10, ClipperLib::jtMiter, 10);
+                touching_buildplate.offsetInPlace(std::abs(conical_support_offset) + 10, ClipperLib::jtMiter, 10);
                 // + 10 and larger miter limit cause performing an outward offset after an inward offset can disregard sharp corners
                 //
                 // conical support can make
@@ -1065,29 +1189,16 @@ void AreaSupport::generateSupportAreasForMesh(SliceDataStorage& storage, const S
         const int max_checking_layer_idx = std::max(0,
                                                     std::min(static_cast<int>(storage.support.supportLayers.size()),
                                                              static_cast<int>(layer_count - (layer_z_distance_top - 1))));
-#pragma omp parallel for default(none) shared(support_areas, storage) schedule(dynamic)
+#pragma omp parallel for shared(support_areas, model_outlines) schedule(dynamic)
         // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
         for (int layer_idx = 0; layer_idx < max_checking_layer_idx; layer_idx++)
         {
-            constexpr bool no_support = false;
-            constexpr bool no_prime_tower = false;
-            support_areas[layer_idx] = support_areas[layer_idx].difference(storage.getLayerOutlines(layer_idx + layer_z_distance_top - 1, no_support, no_prime_tower));
-        }
-    }
-
-    for (size_t layer_idx = support_areas.size() - 1; layer_idx != static_cast<size_t>(std::max(-1, storage.support.layer_nr_max_filled_layer)); layer_idx--)
-    {
-        if (support_areas[layer_idx].size() > 0)
-        {
-            storage.support.layer_nr_max_filled_layer = layer_idx;
-            break;
+            support_areas[layer_idx].differenceInPlace(model_outlines[layer_idx + layer_z_distance_top - 1]);
         }
     }
-
-    storage.support.generated = true;
 }
 
-void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, const Polygons& xy_disallowed, Polygons& stair_removal, Polygons& support_areas, const size_t layer_idx, const size_t bottom_empty_layer_count, const size_t bottom_stair_step_layer_count, const coord_t support_bottom_stair_step_width)
+void AreaSupport::moveUpFromModel(const std::vector<Polygons>& model_outlines, const Polygons& xy_disallowed, Polygons& stair_removal, Polygons& support_areas, const size_t layer_idx, const size_t bottom_empty_layer_count, const size_t bottom_stair_step_layer_count, const coord_t support_bottom_stair_step_width)
 {
 // The idea behind support bottom stairs:
 //
@@ -1143,9 +1254,7 @@ void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, const Polygon
     }
 
     const size_t bottom_layer_nr = layer_idx - bottom_empty_layer_count;
-    constexpr bool no_support = false;
-    constexpr bool no_prime_tower = false;
-    const Polygons bottom_outline = storage.getLayerOutlines(bottom_layer_nr, no_support, no_prime_tower);
+    const Polygons& bottom_outline = model_outlines[bottom_layer_nr];
 
     Polygons to_be_removed;
     if (bottom_stair_step_layer_count <= 1)
@@ -1157,13 +1266,14 @@ void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, const Polygon
         to_be_removed = stair_removal.unionPolygons(bottom_outline);
         if (layer_idx % bottom_stair_step_layer_count == 0)
         { // update stairs for next step
-            const Polygons supporting_bottom = storage.getLayerOutlines(bottom_layer_nr - 1, no_support, no_prime_tower);
+            const Polygons empty;
+            const Polygons& supporting_bottom = (bottom_layer_nr > 0) ? model_outlines[bottom_layer_nr - 1] : empty;
             const Polygons allowed_step_width = support_areas.difference(xy_disallowed).intersection(supporting_bottom).offset(support_bottom_stair_step_width);
 
             const int64_t step_bottom_layer_nr = bottom_layer_nr - bottom_stair_step_layer_count + 1;
             if (step_bottom_layer_nr >= 0)
             {
-                const Polygons step_bottom_outline = storage.getLayerOutlines(step_bottom_layer_nr, no_support, no_prime_tower);
+                const Polygons& step_bottom_outline = model_outlines[step_bottom_layer_nr];
                 stair_removal = step_bottom_outline.intersection(allowed_step_width);
             }
             else
@@ -1172,7 +1282,7 @@ void AreaSupport::moveUpFromModel(const SliceDataStorage& storage, const Polygon
             }
         }
     }
-    support_areas = support_areas.difference(to_be_removed);
+    support_areas.differenceInPlace(to_be_removed);
 }
 
 
@@ -1208,7 +1318,7 @@ std::pair<Polygons, Polygons> AreaSupport::computeBasicAndFullOverhang(const Sli
         // will create opposite effect.
         Polygons merged_polygons = support_layer.anti_overhang.unionPolygons();
 
-        basic_overhang = basic_overhang.difference(merged_polygons);
+        basic_overhang.differenceInPlace(merged_polygons);
     }
 
 //     Polygons support_extension = basic_overhang.offset(max_dist_from_lower_layer);
@@ -1232,8 +1342,13 @@ void AreaSupport::detectOverhangPoints(const SliceDataStorage& storage, SliceMes
 
     mesh.overhang_points.resize(storage.print_layer_count);
 
-    for (size_t layer_idx = 1; layer_idx < storage.print_layer_count; layer_idx++)
+    //Each layer only writes its own overhang points, in the order of its parts, so the layers can be done in parallel.
+    //Only propagating the towers down through the layers is serial, in handleTowers.
+    #pragma omp parallel for shared(storage, mesh) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 1; layer_idx < static_cast<int>(storage.print_layer_count); layer_idx++)
     {
+        const ScopedTimer timer("overhang_points", layer_idx);
         const SliceLayer& layer = mesh.layers[layer_idx];
         for (const SliceLayerPart& part : layer.parts)
         {
@@ -1295,7 +1410,7 @@ void AreaSupport::handleTowers(
                 {
                     for (const Polygons& poly_below : overhang_points_below)
                     {
-                        poly_here = poly_here.difference(poly_below.offset(minimum_diameter * 2));
+                        poly_here.differenceInPlace(poly_below.offset(minimum_diameter * 2));
                     }
                 }
             }
@@ -1320,11 +1435,11 @@ void AreaSupport::handleTowers(
         Polygons& tower_roof = towerRoofs[roof_idx];
         if (tower_roof.size() > 0)
         {
-            supportLayer_this = supportLayer_this.unionPolygons(tower_roof);
+            supportLayer_this.unionInPlace(tower_roof);
 
             if (tower_roof[0].area() < tower_diameter * tower_diameter)
             {
-                tower_roof = tower_roof.offset(tower_roof_expansion_distance);
+                tower_roof.offsetInPlace(tower_roof_expansion_distance);
             }
             else
             {
@@ -1374,13 +1489,13 @@ void AreaSupport::handleWallStruts(const Settings& settings, Polygons& supportLa
                 strut.add(mid + Point(-tower_diameter / 2,  tower_diameter / 2));
                 strut.add(mid + Point(-tower_diameter / 2, -tower_diameter / 2));
                 strut.add(mid + Point( tower_diameter / 2, -tower_diameter / 2));
-                supportLayer_this = supportLayer_this.unionPolygons(struts);
+                supportLayer_this.unionInPlace(struts);
             }
         }
     }
 }
 
-void AreaSupport::generateSupportBottom(SliceDataStorage& storage, const SliceMeshStorage& mesh, std::vector<Polygons>& global_support_areas_per_layer)
+void AreaSupport::generateSupportBottom(SliceDataStorage& storage, const SliceMeshStorage& mesh, const std::vector<Polygons>& mesh_outlines, std::vector<Polygons>& global_support_areas_per_layer)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     const coord_t layer_height = mesh_group_settings.get<coord_t>("layer_height");
@@ -1399,21 +1514,23 @@ void AreaSupport::generateSupportBottom(SliceDataStorage& storage, const SliceMe
     const double minimum_bottom_area = mesh.settings.get<double>("minimum_bottom_area");
 
     std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
-    for (unsigned int layer_idx = z_distance_bottom; layer_idx < support_layers.size(); layer_idx++)
+    #pragma omp parallel for shared(support_layers, mesh_outlines, global_support_areas_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = z_distance_bottom; layer_idx < static_cast<int>(support_layers.size()); layer_idx++)
     {
         const unsigned int bottom_layer_idx_below = std::max(0, int(layer_idx) - int(bottom_layer_count) - int(z_distance_bottom));
-        Polygons mesh_outlines;
+        Polygons colliding_outlines;
         for (float layer_idx_below = bottom_layer_idx_below; std::round(layer_idx_below) < (int)(layer_idx - z_distance_bottom); layer_idx_below += z_skip)
         {
-            mesh_outlines.add(mesh.layers[std::round(layer_idx_below)].getOutlines());
+            colliding_outlines.add(mesh_outlines[std::round(layer_idx_below)]);
         }
         Polygons bottoms;
-        generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], mesh_outlines, bottom_line_width, bottom_outline_offset, minimum_bottom_area, bottoms);
+        generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], colliding_outlines, bottom_line_width, bottom_outline_offset, minimum_bottom_area, bottoms);
         support_layers[layer_idx].support_bottom.add(bottoms);
     }
 }
 
-void AreaSupport::generateSupportRoof(SliceDataStorage& storage, const SliceMeshStorage& mesh, std::vector<Polygons>& global_support_areas_per_layer)
+void AreaSupport::generateSupportRoof(SliceDataStorage& storage, const SliceMeshStorage& mesh, const std::vector<Polygons>& mesh_outlines, std::vector<Polygons>& global_support_areas_per_layer)
 {
     const Settings& mesh_group_settings = Application::getInstance().current_slice->scene.current_mesh_group->settings;
     const coord_t layer_height = mesh_group_settings.get<coord_t>("layer_height");
@@ -1432,16 +1549,18 @@ void AreaSupport::generateSupportRoof(SliceDataStorage& storage, const SliceMesh
     const double minimum_roof_area = mesh.settings.get<double>("minimum_roof_area");
 
     std::vector<SupportLayer>& support_layers = storage.support.supportLayers;
-    for (LayerIndex layer_idx = 0; layer_idx < static_cast<int>(support_layers.size() - z_distance_top); layer_idx++)
+    #pragma omp parallel for shared(support_layers, mesh_outlines, global_support_areas_per_layer) schedule(dynamic)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int layer_idx = 0; layer_idx < static_cast<int>(support_layers.size() - z_distance_top); layer_idx++)
     {
-        const LayerIndex top_layer_idx_above = std::min(static_cast<LayerIndex>(support_layers.size() - 1), layer_idx + roof_layer_count + z_distance_top); //Maximum layer of the model that generates support roof.
-        Polygons mesh_outlines;
+        const LayerIndex top_layer_idx_above = std::min(static_cast<LayerIndex>(support_layers.size() - 1), static_cast<LayerIndex>(layer_idx + roof_layer_count + z_distance_top)); //Maximum layer of the model that generates support roof.
+        Polygons colliding_outlines;
         for (float layer_idx_above = top_layer_idx_above; layer_idx_above > layer_idx + z_distance_top; layer_idx_above -= z_skip)
         {
-            mesh_outlines.add(mesh.layers[std::round(layer_idx_above)].getOutlines());
+            colliding_outlines.add(mesh_outlines[std::round(layer_idx_above)]);
         }
         Polygons roofs;
-        generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], mesh_outlines, roof_line_width, roof_outline_offset, minimum_roof_area, roofs);
+        generateSupportInterfaceLayer(global_support_areas_per_layer[layer_idx], colliding_outlines, roof_line_width, roof_outline_offset, minimum_roof_area, roofs);
         support_layers[layer_idx].support_roof.add(roofs);
     }
 }
@@ -1453,17 +1572,17 @@ void AreaSupport::generateSupportInterfaceLayer(Polygons& support_areas, const P
     interface_polygons = interface_polygons.offset(safety_offset).intersection(support_areas); //Make sure we don't generate any models that are not printable.
     if (outline_offset != 0)
     {
-        interface_polygons = interface_polygons.offset(outline_offset);
+        interface_polygons.offsetInPlace(outline_offset);
         if (outline_offset > 0) //The interface might exceed the area of the normal support.
         {
-            interface_polygons = interface_polygons.intersection(support_areas);
+            interface_polygons.intersectionInPlace(support_areas);
         }
     }
     if (minimum_interface_area > 0.0)
     {
         interface_polygons.removeSmallAreas(minimum_interface_area);
     }
-    support_areas = support_areas.difference(interface_polygons);
+    support_areas.differenceInPlace(interface_polygons);
 }
 
 }//namespace cura
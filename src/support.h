@@ -12,6 +12,7 @@ class Settings;
 class SliceDataStorage;
 class SliceMeshStorage;
 class Slicer;
+class SupportInfillPart;
 
 class AreaSupport
 {
@@ -62,14 +63,16 @@ public:
     static void generateSupportInfillFeatures(SliceDataStorage& storage);
 
     /*!
-     * Generate the insets of the given support infill outline.
+     * Generate the insets of the outlines of support infill parts.
      *
-     * \param[out] insets The insets result to output.
-     * \param outline The given support infill outline.
-     * \param inset_count The number of perimeters to surround the support infill outline.
-     * \param wall_line_width_x The wall line width in microns on the X axis.
+     * The insets of the parts with the same line width and number of walls
+     * are generated together, which saves setting up the offsets for each of
+     * the many small parts a layer of support may have.
+     *
+     * \param[in,out] parts The parts to generate the insets of, in
+     * \ref SupportInfillPart::insets.
      */
-    static void generateOutlineInsets(std::vector<Polygons>& insets, Polygons& outline, const unsigned int inset_count, const coord_t wall_line_width_x);
+    static void generateOutlineInsets(std::vector<SupportInfillPart>& parts);
 
 private:
     /*!
@@ -136,6 +139,36 @@ private:
      */
     static void generateOverhangAreasForMesh(SliceDataStorage& storage, SliceMeshStorage& mesh);
 
+    /*!
+     * \brief The support areas to generate for one object, or for all support
+     * meshes together, with the data of each layer that doesn't depend on the
+     * support of the other layers.
+     */
+    struct SupportAreasJob
+    {
+        size_t mesh_idx; //!< The index of the object for which to generate support areas.
+        const Settings* infill_settings; //!< The settings which are based on the infill of the support.
+        const Settings* roof_settings; //!< The settings which are based on the top interface of the support.
+        const Settings* bottom_settings; //!< The settings base to get the bottom interface of the support.
+        size_t layer_z_distance_top; //!< The number of layers between an overhang and the top of the support below it.
+        std::vector<Polygons> xy_disallowed_per_layer; //!< The areas that are too close to the model in the X/Y direction, per layer.
+        std::vector<Polygons> overhang_per_layer; //!< The overhang that the support of each layer has to hold up by itself, per layer.
+        std::vector<Polygons> support_areas; //!< The generated support areas, per layer.
+    };
+
+    /*!
+     * \brief Compute the data of one layer of a support job that doesn't
+     * depend on the support of the other layers.
+     *
+     * This is done for all layers before the support is generated layer by
+     * layer, so that it can be done in parallel.
+     * \param storage Data storage containing the input layer outline data.
+     * \param model_outlines The outlines of the model on each layer.
+     * \param job The job to fill in the X/Y disallowed areas and overhang of.
+     * \param layer_idx The layer to compute.
+     */
+    static void precomputeSupportLayer(const SliceDataStorage& storage, const std::vector<Polygons>& model_outlines, SupportAreasJob& job, const size_t layer_idx);
+
     /*!
      * \brief Generate support polygons over all layers for one object.
      *
@@ -147,21 +180,22 @@ private:
      *
      * \warning This function should be called only once for handling support
      * meshes with drop down and once for all support meshes without drop down.
-     * The \p mesh_idx should then correspond to an empty \ref SliceMeshStorage
-     * of one support mesh with the given value of support_mesh_drop_down.
+     * The mesh of the job should then correspond to an empty
+     * \ref SliceMeshStorage of one support mesh with the given value of
+     * support_mesh_drop_down.
+     *
+     * Different jobs may be generated at the same time.
      * 
      * \param storage Data storage containing the input layer outline data.
-     * \param infill_settings The settings which are based on the infill of the
-     * support.
-     * \param roof_settings The settings which are based on the top interface of
-     * the support.
-     * \param bottom_settings The settings base to get the bottom interface of
-     * the support.
-     * \param mesh_idx The index of the object for which to generate support
-     * areas.
-     * \param layer_count Total number of layers.
+     * \param model_outlines The outlines of the model on each layer.
+     * \param job The object to generate support for, with every layer
+     * precomputed by \ref AreaSupport::precomputeSupportLayer. The support
+     * areas are stored in the job.
+     * \param[in,out] completed_layer_count The number of layers of all jobs
+     * that are finished, to report progress.
+     * \param total_layer_count The number of layers of all jobs together.
      */
-    static void generateSupportAreasForMesh(SliceDataStorage& storage, const Settings& infill_settings, const Settings& roof_settings, const Settings& bottom_settings, const size_t mesh_idx, const size_t layer_count, std::vector<Polygons>& support_areas);
+    static void generateSupportAreasForMesh(SliceDataStorage& storage, const std::vector<Polygons>& model_outlines, SupportAreasJob& job, size_t& completed_layer_count, const size_t total_layer_count);
 
     /*!
      * Generate support bottom areas for a given mesh.
@@ -173,9 +207,10 @@ private:
      * \param storage Where to find the previously generated support areas and
      * where to output the new support bottom areas.
      * \param mesh The mesh to generate support for.
+     * \param mesh_outlines The outlines of the mesh on each layer.
      * \param global_support_areas_per_layer the global support areas on each layer.
      */
-    static void generateSupportBottom(SliceDataStorage& storage, const SliceMeshStorage& mesh, std::vector<Polygons>& global_support_areas_per_layer);
+    static void generateSupportBottom(SliceDataStorage& storage, const SliceMeshStorage& mesh, const std::vector<Polygons>& mesh_outlines, std::vector<Polygons>& global_support_areas_per_layer);
 
     /*!
      * Generate support roof areas for a given mesh.
@@ -187,9 +222,10 @@ private:
      * \param storage Where to find the previously generated support areas and
      * where to output the new support roof areas.
      * \param mesh The mesh to generate support roof for.
+     * \param mesh_outlines The outlines of the mesh on each layer.
      * \param global_support_areas_per_layer the global support areas on each layer.
      */
-    static void generateSupportRoof(SliceDataStorage& storage, const SliceMeshStorage& mesh, std::vector<Polygons>& global_support_areas_per_layer);
+    static void generateSupportRoof(SliceDataStorage& storage, const SliceMeshStorage& mesh, const std::vector<Polygons>& mesh_outlines, std::vector<Polygons>& global_support_areas_per_layer);
 
     /*!
      * \brief Generate a single layer of support interface.
@@ -230,7 +266,7 @@ private:
      * the top half of the step will be as wide as the stair step width
      * and the bottom half will follow the model.
      * 
-     * \param storage Where to get model outlines from
+     * \param model_outlines The outlines of the model on each layer.
      * \param xy_disallowed Will be removed from support after all layers have processed, this unfortunately can't be done before this method is called.
      * \param[in,out] stair_removal The polygons to be removed for stair stepping on the current layer (input) and for the next layer (output). Only changed every [step_height] layers.
      * \param[in,out] support_areas The support areas before and after this function
@@ -239,7 +275,7 @@ private:
      * \param bottom_stair_step_layer_count The max height (in nr of layers) of the support bottom stairs
      * \param support_bottom_stair_step_width The max width of the support bottom stairs
      */
-    static void moveUpFromModel(const SliceDataStorage& storage, const Polygons& xy_disallowed, Polygons& stair_removal, Polygons& support_areas, const size_t layer_idx, const size_t bottom_empty_layer_count, const size_t bottom_stair_step_layer_count, const coord_t support_bottom_stair_step_width);
+    static void moveUpFromModel(const std::vector<Polygons>& model_outlines, const Polygons& xy_disallowed, Polygons& stair_removal, Polygons& support_areas, const size_t layer_idx, const size_t bottom_empty_layer_count, const size_t bottom_stair_step_layer_count, const coord_t support_bottom_stair_step_width);
 
     /*!
      * Joins the layer part outlines of all meshes and collects the overhang
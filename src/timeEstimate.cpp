@@ -3,7 +3,6 @@
 
 #include <math.h>
 #include <stdio.h>
-#include <string.h>
 #include <algorithm>
 
 #include "timeEstimate.h"
@@ -62,7 +61,13 @@ void TimeEstimateCalculator::setMaxZFeedrate(const Velocity& max_z_feedrate)
 void TimeEstimateCalculator::reset()
 {
     extra_time = 0.0;
-    blocks.clear();
+    block_nominal_feedrate.clear();
+    block_distance.clear();
+    block_acceleration.clear();
+    block_entry_speed.clear();
+    block_max_entry_speed.clear();
+    block_nominal_length.clear();
+    block_feature.clear();
 }
 
 // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the 
@@ -134,50 +139,55 @@ static inline double acceleration_time_from_distance(const Velocity& initial_fee
     return (-initial_feedrate + sqrt(discriminant)) / acceleration;
 }
 
-// Calculates trapezoid parameters so that the entry- and exit-speed is compensated by the provided factors.
-void TimeEstimateCalculator::calculate_trapezoid_for_block(Block *block, const Ratio entry_factor, const Ratio exit_factor)
+// Calculates the trapezoid so that the entry- and exit-speed is compensated by the factors that follow from the given speeds.
+void TimeEstimateCalculator::add_trapezoid_time(const size_t block, const Velocity exit_speed, std::vector<Duration>& totals) const
 {
-    const Velocity initial_feedrate = block->nominal_feedrate * entry_factor;
-    const Velocity final_feedrate = block->nominal_feedrate * exit_factor;
+    const Velocity nominal_feedrate = block_nominal_feedrate[block];
+    const double distance = block_distance[block];
+    // NOTE: Entry and exit factors always > 0 by all previous logic operations.
+    const Ratio entry_factor = Ratio(block_entry_speed[block] / nominal_feedrate);
+    const Ratio exit_factor = Ratio(exit_speed / nominal_feedrate);
+    const Velocity initial_feedrate = nominal_feedrate * entry_factor;
+    const Velocity final_feedrate = nominal_feedrate * exit_factor;
 
-    double accelerate_distance = estimate_acceleration_distance(initial_feedrate, block->nominal_feedrate, block->acceleration);
-    const double decelerate_distance = estimate_acceleration_distance(block->nominal_feedrate, final_feedrate, -block->acceleration);
+    double accelerate_distance = estimate_acceleration_distance(initial_feedrate, nominal_feedrate, block_acceleration[block]);
+    const double decelerate_distance = estimate_acceleration_distance(nominal_feedrate, final_feedrate, -block_acceleration[block]);
 
     // Calculate the size of Plateau of Nominal Rate.
-    double plateau_distance = block->distance-accelerate_distance - decelerate_distance;
+    double plateau_distance = distance-accelerate_distance - decelerate_distance;
 
     // Is the Plateau of Nominal Rate smaller than nothing? That means no cruising, and we will
     // have to use intersection_distance() to calculate when to abort acceleration and start braking
     // in order to reach the final_rate exactly at the end of this block.
     if (plateau_distance < 0)
     {
-        accelerate_distance = intersection_distance(initial_feedrate, final_feedrate, block->acceleration, block->distance);
+        accelerate_distance = intersection_distance(initial_feedrate, final_feedrate, block_acceleration[block], distance);
         accelerate_distance = std::max(accelerate_distance, 0.0); // Check limits due to numerical round-off
-        accelerate_distance = std::min(accelerate_distance, block->distance);//(We can cast here to unsigned, because the above line ensures that we are above zero)
+        accelerate_distance = std::min(accelerate_distance, distance);
         plateau_distance = 0;
     }
 
-    block->accelerate_until = accelerate_distance;
-    block->decelerate_after = accelerate_distance + plateau_distance;
-    block->initial_feedrate = initial_feedrate;
-    block->final_feedrate = final_feedrate;
+    const double accelerate_until = accelerate_distance;
+    const double decelerate_after = accelerate_distance + plateau_distance;
+
+    Duration& total = totals[static_cast<unsigned char>(block_feature[block])];
+    total += acceleration_time_from_distance(initial_feedrate, accelerate_until, block_acceleration[block]);
+    total += (decelerate_after - accelerate_until) / nominal_feedrate;
+    total += acceleration_time_from_distance(final_feedrate, (distance - decelerate_after), block_acceleration[block]);
 }
 
 void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatureType feature)
 {
-    Block block;
-    memset(&block, 0, sizeof(block));
-
-    block.feature = feature;
-
-    //block.maxTravel = 0; //Done by memset.
+    Position delta;
+    Position absDelta;
+    double maxTravel = 0;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        block.delta[n] = newPos[n] - currentPosition[n];
-        block.absDelta[n] = fabs(block.delta[n]);
-        block.maxTravel = std::max(block.maxTravel, block.absDelta[n]);
+        delta[n] = newPos[n] - currentPosition[n];
+        absDelta[n] = fabs(delta[n]);
+        maxTravel = std::max(maxTravel, absDelta[n]);
     }
-    if (block.maxTravel <= 0)
+    if (maxTravel <= 0)
     {
         return;
     }
@@ -185,19 +195,19 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
     {
         feedrate = minimumfeedrate;
     }
-    block.distance = sqrtf(square(block.absDelta[0]) + square(block.absDelta[1]) + square(block.absDelta[2]));
-    if (block.distance == 0.0)
+    double distance = sqrtf(square(absDelta[0]) + square(absDelta[1]) + square(absDelta[2]));
+    if (distance == 0.0)
     {
-        block.distance = block.absDelta[3];
+        distance = absDelta[3];
     }
-    block.nominal_feedrate = feedrate;
+    Velocity nominal_feedrate = feedrate;
     
     Position current_feedrate;
     Position current_abs_feedrate;
     Ratio feedrate_factor = 1.0;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        current_feedrate[n] = (block.delta[n] * feedrate) / block.distance;
+        current_feedrate[n] = (delta[n] * feedrate) / distance;
         current_abs_feedrate[n] = fabs(current_feedrate[n]);
         if (current_abs_feedrate[n] > max_feedrate[n])
         {
@@ -213,15 +223,15 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
             current_feedrate[n] *= feedrate_factor;
             current_abs_feedrate[n] *= feedrate_factor;
         }
-        block.nominal_feedrate *= feedrate_factor;
+        nominal_feedrate *= feedrate_factor;
     }
     
-    block.acceleration = acceleration;
+    Acceleration limited_acceleration = acceleration;
     for(size_t n = 0; n < NUM_AXIS; n++)
     {
-        if (block.acceleration * (block.absDelta[n] / block.distance) > max_acceleration[n])
+        if (limited_acceleration * (absDelta[n] / distance) > max_acceleration[n])
         {
-            block.acceleration = max_acceleration[n];
+            limited_acceleration = max_acceleration[n];
         }
     }
     
@@ -235,13 +245,12 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
     {
         vmax_junction = std::min(vmax_junction, max_e_jerk / 2);
     }
-    vmax_junction = std::min(vmax_junction, block.nominal_feedrate);
-    const Velocity safe_speed = vmax_junction;
+    vmax_junction = std::min(vmax_junction, nominal_feedrate);
     
-    if ((blocks.size() > 0) && (previous_nominal_feedrate > 0.0001))
+    if ((block_distance.size() > 0) && (previous_nominal_feedrate > 0.0001))
     {
         const Velocity xy_jerk = sqrt(square(current_feedrate[X_AXIS] - previous_feedrate[X_AXIS]) + square(current_feedrate[Y_AXIS] - previous_feedrate[Y_AXIS]));
-        vmax_junction = block.nominal_feedrate;
+        vmax_junction = nominal_feedrate;
         if (xy_jerk > max_xy_jerk)
         {
             vmax_junction_factor = Ratio(max_xy_jerk / xy_jerk);
@@ -257,154 +266,80 @@ void TimeEstimateCalculator::plan(Position newPos, Velocity feedrate, PrintFeatu
         vmax_junction = std::min(previous_nominal_feedrate, vmax_junction * vmax_junction_factor); // Limit speed to max previous speed
     }
 
-    block.max_entry_speed = vmax_junction;
+    const Velocity v_allowable = max_allowable_speed(-limited_acceleration, MINIMUM_PLANNER_SPEED, distance);
 
-    const Velocity v_allowable = max_allowable_speed(-block.acceleration, MINIMUM_PLANNER_SPEED, block.distance);
-    block.entry_speed = std::min(vmax_junction, v_allowable);
-    block.nominal_length_flag = block.nominal_feedrate <= v_allowable;
-    block.recalculate_flag = true; // Always calculate trapezoid for new block
+    block_nominal_feedrate.push_back(nominal_feedrate);
+    block_distance.push_back(distance);
+    block_acceleration.push_back(limited_acceleration);
+    block_entry_speed.push_back(std::min(vmax_junction, v_allowable));
+    block_max_entry_speed.push_back(vmax_junction);
+    block_nominal_length.push_back(nominal_feedrate <= v_allowable);
+    block_feature.push_back(feature);
 
     previous_feedrate = current_feedrate;
-    previous_nominal_feedrate = block.nominal_feedrate;
+    previous_nominal_feedrate = nominal_feedrate;
 
     currentPosition = newPos;
-
-    calculate_trapezoid_for_block(&block, Ratio(block.entry_speed / block.nominal_feedrate), Ratio(safe_speed / block.nominal_feedrate));
-
-    blocks.push_back(block);
 }
 
 std::vector<Duration> TimeEstimateCalculator::calculate()
 {
     reverse_pass();
     forward_pass();
-    recalculate_trapezoids();
     
     std::vector<Duration> totals(static_cast<unsigned char>(PrintFeatureType::NumPrintFeatureTypes), 0.0);
     totals[static_cast<unsigned char>(PrintFeatureType::NoneType)] = extra_time; // Extra time (pause for minimum layer time, etc) is marked as NoneType
-    for(unsigned int n = 0; n < blocks.size(); n++)
+    const size_t block_count = block_distance.size();
+    for(size_t n = 0; n < block_count; n++)
     {
-        const Block& block = blocks[n];
-        const double plateau_distance = block.decelerate_after - block.accelerate_until;
-
-        totals[static_cast<unsigned char>(block.feature)] += acceleration_time_from_distance(block.initial_feedrate, block.accelerate_until, block.acceleration);
-        totals[static_cast<unsigned char>(block.feature)] += plateau_distance / block.nominal_feedrate;
-        totals[static_cast<unsigned char>(block.feature)] += acceleration_time_from_distance(block.final_feedrate, (block.distance - block.decelerate_after), block.acceleration);
+        // The exit speed of each block is the entry speed of the next. The last/newest block exits with MINIMUM_PLANNER_SPEED.
+        const Velocity exit_speed = (n + 1 < block_count) ? block_entry_speed[n + 1] : Velocity(MINIMUM_PLANNER_SPEED);
+        add_trapezoid_time(n, exit_speed, totals);
     }
     return totals;
 }
 
-// The kernel called by accelerationPlanner::calculate() when scanning the plan from last to first entry.
-void TimeEstimateCalculator::planner_reverse_pass_kernel(Block *previous, Block *current, Block *next)
-{
-    (void)previous;
-    if (!current || !next)
-    {
-        return;
-    }
-
-    // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
-    // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
-    // check for maximum allowable speed reductions to ensure maximum possible planned speed.
-    if (current->entry_speed != current->max_entry_speed)
-    {
-        // If nominal length true, max junction speed is guaranteed to be reached. Only compute
-        // for max allowable speed if block is decelerating and nominal length is false.
-        if ((!current->nominal_length_flag) && (current->max_entry_speed > next->entry_speed))
-        {
-            current->entry_speed = std::min(current->max_entry_speed, max_allowable_speed(-current->acceleration, next->entry_speed, current->distance));
-        }
-        else
-        {
-            current->entry_speed = current->max_entry_speed;
-        }
-        current->recalculate_flag = true;
-    }
-}
-
+// Scans the plan from last to first entry, lowering the entry speed of each block to what it can decelerate from.
 void TimeEstimateCalculator::reverse_pass()
 {
-    Block* block[3] = {nullptr, nullptr, nullptr};
-    for(size_t n = blocks.size() - 1; int(n) >= 0; n--)
+    // The first block and the last block are skipped, like the firmware does.
+    for(size_t next = block_distance.size(); next-- > 2; )
     {
-        block[2]= block[1];
-        block[1]= block[0];
-        block[0] = &blocks[n];
-        planner_reverse_pass_kernel(block[0], block[1], block[2]);
-    }
-}
-
-// The kernel called by accelerationPlanner::calculate() when scanning the plan from first to last entry.
-void TimeEstimateCalculator::planner_forward_pass_kernel(Block *previous, Block *current, Block *next)
-{
-    (void)next;
-    if (!previous)
-    {
-        return;
-    }
-
-    // If the previous block is an acceleration block, but it is not long enough to complete the
-    // full speed change within the block, we need to adjust the entry speed accordingly. Entry
-    // speeds have already been reset, maximized, and reverse planned by reverse planner.
-    // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
-    if (!previous->nominal_length_flag)
-    {
-        if (previous->entry_speed < current->entry_speed)
+        const size_t current = next - 1;
+        // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
+        // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
+        // check for maximum allowable speed reductions to ensure maximum possible planned speed.
+        if (block_entry_speed[current] != block_max_entry_speed[current])
         {
-            const Velocity entry_speed = std::min(current->entry_speed, max_allowable_speed(-previous->acceleration, previous->entry_speed, previous->distance));
-
-            // Check for junction speed change
-            if (current->entry_speed != entry_speed)
+            // If nominal length true, max junction speed is guaranteed to be reached. Only compute
+            // for max allowable speed if block is decelerating and nominal length is false.
+            if ((!block_nominal_length[current]) && (block_max_entry_speed[current] > block_entry_speed[next]))
+            {
+                block_entry_speed[current] = std::min(block_max_entry_speed[current], max_allowable_speed(-block_acceleration[current], block_entry_speed[next], block_distance[current]));
+            }
+            else
             {
-                current->entry_speed = entry_speed;
-                current->recalculate_flag = true;
+                block_entry_speed[current] = block_max_entry_speed[current];
             }
         }
     }
 }
 
+// Scans the plan from first to last entry, lowering the entry speed of each block to what the previous block can accelerate to.
 void TimeEstimateCalculator::forward_pass()
 {
-    Block* block[3] = {nullptr, nullptr, nullptr};
-    for(size_t n = 0; n < blocks.size(); n++)
+    for(size_t current = 1; current < block_distance.size(); current++)
     {
-        block[0]= block[1];
-        block[1]= block[2];
-        block[2] = &blocks[n];
-        planner_forward_pass_kernel(block[0], block[1], block[2]);
-    }
-    planner_forward_pass_kernel(block[1], block[2], nullptr);
-}
-
-// Recalculates the trapezoid speed profiles for all blocks in the plan according to the 
-// entry_factor for each junction. Must be called by planner_recalculate() after 
-// updating the blocks.
-void TimeEstimateCalculator::recalculate_trapezoids()
-{
-    Block *current;
-    Block *next = nullptr;
-
-    for(unsigned int n=0; n<blocks.size(); n++)
-    {
-        current = next;
-        next = &blocks[n];
-        if (current)
+        const size_t previous = current - 1;
+        // If the previous block is an acceleration block, but it is not long enough to complete the
+        // full speed change within the block, we need to adjust the entry speed accordingly. Entry
+        // speeds have already been reset, maximized, and reverse planned by reverse planner.
+        // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
+        if (!block_nominal_length[previous] && block_entry_speed[previous] < block_entry_speed[current])
         {
-            // Recalculate if current block entry or exit junction speed has changed.
-            if (current->recalculate_flag || next->recalculate_flag)
-            {
-                // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                calculate_trapezoid_for_block(current, Ratio(current->entry_speed / current->nominal_feedrate), Ratio(next->entry_speed / current->nominal_feedrate));
-                current->recalculate_flag = false; // Reset current only to ensure next trapezoid is computed
-            }
+            block_entry_speed[current] = std::min(block_entry_speed[current], max_allowable_speed(-block_acceleration[previous], block_entry_speed[previous], block_distance[previous]));
         }
     }
-    // Last/newest block in buffer. Exit speed is set with MINIMUM_PLANNER_SPEED. Always recalculated.
-    if (next != nullptr)
-    {
-        calculate_trapezoid_for_block(next, Ratio(next->entry_speed / next->nominal_feedrate), Ratio(MINIMUM_PLANNER_SPEED / next->nominal_feedrate));
-        next->recalculate_flag = false;
-    }
 }
 
 }//namespace cura
\ No newline at end of file
@@ -15,7 +15,6 @@
 namespace cura
 {
 
-class Ratio;
 class Settings;
 
 /*!
@@ -43,30 +42,6 @@ public:
         double& operator[](const int n) { return axis[n]; }
     };
 
-    class Block
-    {
-    public:
-        bool recalculate_flag;
-        
-        double accelerate_until;
-        double decelerate_after;
-        Velocity initial_feedrate;
-        Velocity final_feedrate;
-
-        Velocity entry_speed;
-        Velocity max_entry_speed;
-        bool nominal_length_flag;
-        
-        Velocity nominal_feedrate;
-        double maxTravel;
-        double distance;
-        Acceleration acceleration;
-        Position delta;
-        Position absDelta;
-
-        PrintFeatureType feature;
-    };
-
 private:
     Velocity max_feedrate[NUM_AXIS] = {600, 600, 40, 25}; // mm/s
     Velocity minimumfeedrate = 0.01;
@@ -82,7 +57,20 @@ private:
 
     Position currentPosition;
 
-    std::vector<Block> blocks;
+    /*
+     * The planned blocks, stored as a structure of arrays indexed by block
+     * number. The passes over the blocks only look at a few of these at a time.
+     *
+     * The trapezoid of each block is only computed in \ref calculate, once
+     * the entry speeds of all blocks are known.
+     */
+    std::vector<Velocity> block_nominal_feedrate; //!< The speed at which each block is cruising.
+    std::vector<double> block_distance; //!< The length of each block.
+    std::vector<Acceleration> block_acceleration; //!< The acceleration with which each block changes speed.
+    std::vector<Velocity> block_entry_speed; //!< The speed with which each block starts.
+    std::vector<Velocity> block_max_entry_speed; //!< The highest allowed speed at the junction to each block.
+    std::vector<bool> block_nominal_length; //!< Whether each block is long enough to accelerate or decelerate to the nominal speed from any entry speed.
+    std::vector<PrintFeatureType> block_feature; //!< The print feature that each block's time is accounted to.
 public:
     /*!
      * \brief Set the movement configuration of the firmware.
@@ -102,11 +90,15 @@ public:
 private:
     void reverse_pass();
     void forward_pass();
-    void recalculate_trapezoids();
 
-    void calculate_trapezoid_for_block(Block *block, const Ratio entry_factor, const Ratio exit_factor);
-    void planner_reverse_pass_kernel(Block *previous, Block *current, Block *next);
-    void planner_forward_pass_kernel(Block *previous, Block *current, Block *next);
+    /*!
+     * Compute the speed profile of a block from the speeds at which it starts
+     * and ends, and add the time it takes to the total of its feature.
+     * \param block The number of the block.
+     * \param exit_speed The speed at the end of the block.
+     * \param[in,out] totals The time spent on each feature so far.
+     */
+    void add_trapezoid_time(const size_t block, const Velocity exit_speed, std::vector<Duration>& totals) const;
 };
 
 }//namespace cura
@@ -0,0 +1,116 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For nth_element and sort.
+
+#include "AABBTree.h"
+
+namespace cura
+{
+
+namespace
+{
+
+constexpr size_t leaf_size = 4; //Below this, checking the boxes one by one is faster than descending further.
+
+} //Anonymous namespace.
+
+AABBTree::AABBTree()
+{
+}
+
+AABBTree::AABBTree(const std::vector<AABB>& input_boxes)
+: box_indices(input_boxes.size())
+{
+    for (size_t box_idx = 0; box_idx < input_boxes.size(); box_idx++)
+    {
+        box_indices[box_idx] = box_idx;
+    }
+    if (!input_boxes.empty())
+    {
+        build(input_boxes, 0, input_boxes.size());
+    }
+    boxes.reserve(input_boxes.size());
+    for (const size_t box_idx : box_indices)
+    {
+        boxes.push_back(input_boxes[box_idx]);
+    }
+}
+
+size_t AABBTree::size() const
+{
+    return boxes.size();
+}
+
+void AABBTree::findOverlapping(const AABB& query, std::vector<size_t>& result) const
+{
+    result.clear();
+    if (nodes.empty())
+    {
+        return;
+    }
+    std::vector<size_t> to_visit(1, 0);
+    while (!to_visit.empty())
+    {
+        const Node& node = nodes[to_visit.back()];
+        const size_t node_idx = to_visit.back();
+        to_visit.pop_back();
+        if (!node.box.hit(query))
+        {
+            continue;
+        }
+        if (node.second_child == 0)
+        {
+            for (size_t box_idx = node.start; box_idx < node.end; box_idx++)
+            {
+                if (boxes[box_idx].hit(query))
+                {
+                    result.push_back(box_indices[box_idx]);
+                }
+            }
+        }
+        else
+        {
+            to_visit.push_back(node.second_child);
+            to_visit.push_back(node_idx + 1);
+        }
+    }
+    std::sort(result.begin(), result.end());
+}
+
+void AABBTree::build(const std::vector<AABB>& input_boxes, const size_t start, const size_t end)
+{
+    const size_t node_idx = nodes.size();
+    nodes.emplace_back();
+    AABB node_box;
+    AABB centres; //The centres are doubled, to stay in integers.
+    for (size_t box_idx = start; box_idx < end; box_idx++)
+    {
+        const AABB& box = input_boxes[box_indices[box_idx]];
+        node_box.include(box);
+        centres.include(box.min + box.max);
+    }
+    nodes[node_idx].box = node_box;
+    nodes[node_idx].start = start;
+    nodes[node_idx].end = end;
+    nodes[node_idx].second_child = 0;
+    if (end - start <= leaf_size)
+    {
+        return;
+    }
+
+    const bool split_x = centres.max.X - centres.min.X >= centres.max.Y - centres.min.Y;
+    const size_t middle = (start + end) / 2;
+    std::nth_element(box_indices.begin() + start, box_indices.begin() + middle, box_indices.begin() + end, [&input_boxes, split_x](const size_t a, const size_t b)
+        {
+            const AABB& box_a = input_boxes[a];
+            const AABB& box_b = input_boxes[b];
+            return split_x ? (box_a.min.X + box_a.max.X < box_b.min.X + box_b.max.X) : (box_a.min.Y + box_a.max.Y < box_b.min.Y + box_b.max.Y);
+        });
+    build(input_boxes, start, middle);
+    const size_t second_child = nodes.size();
+    build(input_boxes, middle, end);
+    nodes[node_idx].second_child = second_child;
+}
+
+} //namespace cura
@@ -0,0 +1,78 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_AABB_TREE_H
+#define UTILS_AABB_TREE_H
+
+#include <vector>
+
+#include "AABB.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A bounding volume hierarchy over a set of bounding boxes, to find
+ * the boxes that overlap with a query box without checking all of them.
+ *
+ * The tree is built top-down, splitting the boxes at the median of their
+ * centres along the longest side of the box around those centres. The tree
+ * doesn't change after it's built, so multiple threads may query it at the
+ * same time.
+ */
+class AABBTree
+{
+public:
+    /*!
+     * \brief Create an empty tree.
+     */
+    AABBTree();
+
+    /*!
+     * \brief Build a tree over some boxes.
+     * \param input_boxes The boxes, which are identified by their index.
+     */
+    AABBTree(const std::vector<AABB>& input_boxes);
+
+    /*!
+     * \brief The number of boxes in the tree.
+     */
+    size_t size() const;
+
+    /*!
+     * \brief Find the boxes that overlap with a query box, by the same
+     * definition as \ref AABB::hit.
+     * \param query The box to look for.
+     * \param[out] result The indices of the boxes that overlap with \p query,
+     * from low to high. Anything that was in it is removed.
+     */
+    void findOverlapping(const AABB& query, std::vector<size_t>& result) const;
+
+private:
+    /*!
+     * \brief A node of the tree, covering a range of \ref AABBTree::boxes.
+     */
+    struct Node
+    {
+        AABB box; //!< The box around all boxes in the range.
+        size_t start; //!< The first box in the range.
+        size_t end; //!< The box after the last one in the range.
+        size_t second_child; //!< The index of the second child node, or 0 if this is a leaf. The first child directly follows the node.
+    };
+
+    /*!
+     * \brief Add the node for a range of boxes and its children.
+     * \param input_boxes The boxes that the tree is built with.
+     * \param start The first box in the range.
+     * \param end The box after the last one in the range.
+     */
+    void build(const std::vector<AABB>& input_boxes, const size_t start, const size_t end);
+
+    std::vector<AABB> boxes; //!< The boxes, in the order of the leaves of the tree.
+    std::vector<size_t> box_indices; //!< For each box in \ref AABBTree::boxes, its index in the boxes that the tree was built with.
+    std::vector<Node> nodes; //!< The nodes of the tree, with the root first and every node before its children.
+};
+
+} //namespace cura
+
+#endif //UTILS_AABB_TREE_H
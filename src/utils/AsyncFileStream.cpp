@@ -0,0 +1,233 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "AsyncFileStream.h"
+
+namespace cura
+{
+
+constexpr size_t AsyncFileBuffer::block_size;
+constexpr size_t AsyncFileBuffer::max_block_count;
+
+AsyncFileBuffer::AsyncFileBuffer(const bool binary)
+: file(nullptr)
+, binary(binary)
+, block_count(0)
+, writing(false)
+, stop(false)
+, failed(false)
+{
+}
+
+AsyncFileBuffer::~AsyncFileBuffer()
+{
+    close();
+}
+
+bool AsyncFileBuffer::open(const char* filename)
+{
+    close();
+    file = fopen(filename, binary ? "wb" : "w");
+    if (!file)
+    {
+        return false;
+    }
+    if (!begin())
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    filling.resize(block_size);
+    block_count = 1;
+    setp(filling.data(), filling.data() + filling.size());
+    writing = false;
+    stop = false;
+    failed = false;
+    writer = std::thread(&AsyncFileBuffer::write, this);
+    return true;
+}
+
+bool AsyncFileBuffer::close()
+{
+    if (!file)
+    {
+        return false;
+    }
+    queue(BlockEnd::CLOSE);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    writer.join();
+
+    end();
+    const bool closed = fclose(file) == 0;
+    file = nullptr;
+    setp(nullptr, nullptr);
+    filling.clear();
+    unused_blocks.clear();
+    return closed && !failed;
+}
+
+bool AsyncFileBuffer::isOpen() const
+{
+    return file != nullptr;
+}
+
+AsyncFileBuffer::int_type AsyncFileBuffer::overflow(int_type character)
+{
+    if (!file)
+    {
+        return traits_type::eof();
+    }
+    queue(BlockEnd::NONE);
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+    return traits_type::not_eof(character);
+}
+
+int AsyncFileBuffer::sync()
+{
+    if (!file)
+    {
+        return -1;
+    }
+    queue(BlockEnd::FLUSH);
+    waitUntilWritten();
+    fflush(file);
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed ? -1 : 0;
+}
+
+AsyncFileBuffer::pos_type AsyncFileBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+    if (!file || !(which & std::ios_base::out) || sync() != 0)
+    {
+        return pos_type(off_type(-1));
+    }
+    if (offset != 0 || direction != std::ios_base::cur)
+    {
+        const int origin = (direction == std::ios_base::beg) ? SEEK_SET : ((direction == std::ios_base::cur) ? SEEK_CUR : SEEK_END);
+        if (fseek(file, offset, origin) != 0)
+        {
+            return pos_type(off_type(-1));
+        }
+    }
+    return pos_type(off_type(ftell(file))); //In text mode this needn't be a number of bytes, but fseek accepts it.
+}
+
+AsyncFileBuffer::pos_type AsyncFileBuffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+bool AsyncFileBuffer::begin()
+{
+    return true;
+}
+
+bool AsyncFileBuffer::writeBlock(const char* data, const size_t size, const BlockEnd)
+{
+    return fwrite(data, 1, size, file) == size;
+}
+
+void AsyncFileBuffer::end()
+{
+}
+
+void AsyncFileBuffer::queue(const BlockEnd block_end)
+{
+    const size_t size = pptr() - pbase();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        queued.push_back({std::move(filling), size, block_end});
+        condition.notify_all();
+        condition.wait(lock, [this]() { return !unused_blocks.empty() || block_count < max_block_count; });
+        if (!unused_blocks.empty())
+        {
+            filling = std::move(unused_blocks.back());
+            unused_blocks.pop_back();
+        }
+        else
+        {
+            filling = std::vector<char>();
+            block_count++;
+        }
+    }
+    filling.resize(block_size);
+    setp(filling.data(), filling.data() + filling.size());
+}
+
+void AsyncFileBuffer::waitUntilWritten()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return queued.empty() && !writing; });
+}
+
+void AsyncFileBuffer::write()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        condition.wait(lock, [this]() { return !queued.empty() || stop; });
+        if (queued.empty())
+        {
+            return;
+        }
+        Block block = std::move(queued.front());
+        queued.pop_front();
+        writing = true;
+        lock.unlock();
+
+        const bool success = writeBlock(block.data.data(), block.size, block.end);
+
+        lock.lock();
+        failed |= !success;
+        unused_blocks.push_back(std::move(block.data));
+        writing = false;
+        condition.notify_all();
+    }
+}
+
+AsyncFileStream::AsyncFileStream()
+: std::ostream(nullptr)
+{
+    rdbuf(&buffer);
+}
+
+bool AsyncFileStream::open(const char* filename)
+{
+    const bool opened = buffer.open(filename);
+    if (opened)
+    {
+        clear();
+    }
+    else
+    {
+        setstate(std::ios_base::failbit);
+    }
+    return opened;
+}
+
+bool AsyncFileStream::close()
+{
+    const bool closed = buffer.close();
+    if (!closed)
+    {
+        setstate(std::ios_base::failbit);
+    }
+    return closed;
+}
+
+bool AsyncFileStream::isOpen() const
+{
+    return buffer.isOpen();
+}
+
+} //namespace cura
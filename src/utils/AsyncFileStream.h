@@ -0,0 +1,212 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_ASYNC_FILE_STREAM_H
+#define UTILS_ASYNC_FILE_STREAM_H
+
+#include <condition_variable>
+#include <cstdio> //For FILE.
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Stream buffer that writes a file on a background thread.
+ *
+ * The data is collected in large blocks. Full blocks are queued and written to
+ * the file by a dedicated thread, while the next block is being filled. Writing
+ * to the stream therefore only waits for the file if several blocks are queued
+ * already, so a slow disk doesn't hold up the thread that produces the data.
+ *
+ * Subclasses can transform the blocks before they are written, such as
+ * \ref GzipFileBuffer. Because the blocks are written by a virtual function,
+ * subclasses must call \ref AsyncFileBuffer::close in their destructor.
+ */
+class AsyncFileBuffer : public std::streambuf, NoCopy
+{
+public:
+    /*!
+     * \param binary Whether to open files in binary mode rather than text
+     * mode.
+     */
+    AsyncFileBuffer(const bool binary = false);
+
+    /*!
+     * \brief Writes the remaining data and closes the file, if it is still
+     * open.
+     */
+    virtual ~AsyncFileBuffer();
+
+    /*!
+     * \brief Open a file to write to.
+     *
+     * If another file was open, that one is closed first.
+     * \param filename The file to write to.
+     * \return Whether the file could be opened.
+     */
+    bool open(const char* filename);
+
+    /*!
+     * \brief Write the remaining data and close the file.
+     * \return Whether all data could be written.
+     */
+    bool close();
+
+    /*!
+     * \brief Whether a file is open.
+     */
+    bool isOpen() const;
+
+protected:
+    /*!
+     * \brief How a block ends the data written so far.
+     */
+    enum class BlockEnd
+    {
+        NONE, //!< More data follows.
+        FLUSH, //!< The stream was flushed, so everything so far must end up in the file.
+        CLOSE //!< The file is about to be closed.
+    };
+
+    /*!
+     * \brief Queue the full block to be written and continue in a new block.
+     */
+    int_type overflow(int_type character) override;
+
+    /*!
+     * \brief Write all data that was written to the stream so far to the file.
+     */
+    int sync() override;
+
+    /*!
+     * \brief Get or change the position in the file at which the stream
+     * continues writing.
+     *
+     * Everything that was written to the stream so far is written to the file
+     * first, so this waits for the writing thread. It's meant for going back
+     * to overwrite some data once in a while, such as a header.
+     */
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which = std::ios_base::out) override;
+
+    /*!
+     * \brief Change the position in the file at which the stream continues
+     * writing.
+     *
+     * See \ref AsyncFileBuffer::seekoff.
+     */
+    pos_type seekpos(pos_type position, std::ios_base::openmode which = std::ios_base::out) override;
+
+    /*!
+     * \brief Prepare for writing a newly opened file.
+     * \return Whether that succeeded.
+     */
+    virtual bool begin();
+
+    /*!
+     * \brief Write a block to the file.
+     *
+     * Called on the writing thread, in the order in which the data was
+     * written to the stream.
+     * \param data The data of the block.
+     * \param size The number of bytes in the block.
+     * \param block_end What follows after this block.
+     * \return Whether the block could be written.
+     */
+    virtual bool writeBlock(const char* data, const size_t size, const BlockEnd block_end);
+
+    /*!
+     * \brief Clean up after the last block of a file was written.
+     */
+    virtual void end();
+
+    FILE* file; //!< The file to write to, or nullptr if no file is open.
+
+private:
+    static constexpr size_t block_size = 1 << 20; //!< The number of bytes to collect before queueing them.
+    static constexpr size_t max_block_count = 4; //!< The maximum number of blocks that are queued or being filled.
+
+    /*!
+     * \brief A block of data to be written.
+     */
+    struct Block
+    {
+        std::vector<char> data; //!< The memory of the block, of which the first \ref Block::size bytes are filled.
+        size_t size; //!< How many bytes of the block are filled.
+        BlockEnd end; //!< What follows after this block.
+    };
+
+    /*!
+     * \brief Queue the data collected so far to be written and get a new block
+     * to fill.
+     *
+     * Waits if the maximum number of blocks are in use.
+     * \param block_end What follows after this block.
+     */
+    void queue(const BlockEnd block_end);
+
+    /*!
+     * \brief Wait until the writing thread has written all queued blocks.
+     */
+    void waitUntilWritten();
+
+    /*!
+     * \brief Main loop of the writing thread.
+     */
+    void write();
+
+    const bool binary; //!< Whether to open files in binary mode.
+    std::vector<char> filling; //!< The block in which the data is collected.
+
+    std::thread writer; //!< The thread that writes the blocks to the file.
+    std::mutex mutex; //!< Protects the variables below.
+    std::condition_variable condition; //!< Notified when a block is queued and when one is written.
+    std::deque<Block> queued; //!< The blocks that are waiting to be written.
+    std::vector<std::vector<char>> unused_blocks; //!< Memory of blocks that were written, to be reused.
+    size_t block_count; //!< How many blocks are allocated.
+    bool writing; //!< Whether the writing thread is writing a block.
+    bool stop; //!< Whether the writing thread should stop.
+    bool failed; //!< Whether writing has failed.
+};
+
+/*!
+ * \brief Output stream that writes a file on a background thread.
+ *
+ * See \ref AsyncFileBuffer.
+ */
+class AsyncFileStream : public std::ostream
+{
+public:
+    AsyncFileStream();
+
+    /*!
+     * \brief Open a file to write to.
+     * \param filename The file to write to.
+     * \return Whether the file could be opened.
+     */
+    bool open(const char* filename);
+
+    /*!
+     * \brief Write the remaining data and close the file.
+     * \return Whether all data could be written.
+     */
+    bool close();
+
+    /*!
+     * \brief Whether a file is open.
+     */
+    bool isOpen() const;
+
+private:
+    AsyncFileBuffer buffer; //!< Collects and writes the data.
+};
+
+} //namespace cura
+
+#endif //UTILS_ASYNC_FILE_STREAM_H
@@ -0,0 +1,148 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_BINARY_BUFFER_H
+#define UTILS_BINARY_BUFFER_H
+
+#include <cstddef> //For size_t.
+#include <cstdint>
+#include <string>
+
+namespace cura
+{
+
+/*!
+ * \brief Writes numbers and strings into a compact binary form.
+ *
+ * Numbers are written as variable-length integers, seven bits per byte, so
+ * that small numbers take only a single byte. Signed numbers are zigzag
+ * encoded first, so that small negative numbers are short as well.
+ */
+class BinaryWriter
+{
+public:
+    void writeUnsigned(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        data.push_back(static_cast<char>(value));
+    }
+
+    void writeSigned(const int64_t value)
+    {
+        writeUnsigned((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writeString(const std::string& value)
+    {
+        writeUnsigned(value.size());
+        data.append(value);
+    }
+
+    /*!
+     * \brief The bytes that were written.
+     */
+    const std::string& getData() const
+    {
+        return data;
+    }
+
+private:
+    std::string data; //!< The bytes that were written.
+};
+
+/*!
+ * \brief Reads the numbers and strings that a \ref BinaryWriter wrote.
+ *
+ * All reading functions return false if the data ends or is malformed, which
+ * happens if the data is truncated or wasn't written by a \ref BinaryWriter.
+ */
+class BinaryReader
+{
+public:
+    /*!
+     * \brief Start reading at the start of some data.
+     * \param data The data to read. It must outlive the reader.
+     */
+    BinaryReader(const std::string& data)
+    : data(data.data())
+    , size(data.size())
+    , position(0)
+    {
+    }
+
+    /*!
+     * \brief Start reading at the start of a range of memory, such as a
+     * memory-mapped file.
+     * \param data The start of the memory. It must outlive the reader.
+     * \param size The number of bytes to read.
+     */
+    BinaryReader(const char* data, const size_t size)
+    : data(data)
+    , size(size)
+    , position(0)
+    {
+    }
+
+    bool readUnsigned(uint64_t& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (position >= size)
+            {
+                return false;
+            }
+            const uint8_t byte = static_cast<uint8_t>(data[position++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readSigned(int64_t& value)
+    {
+        uint64_t zigzag;
+        if (!readUnsigned(zigzag))
+        {
+            return false;
+        }
+        value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        return true;
+    }
+
+    bool readString(std::string& value)
+    {
+        uint64_t string_size;
+        if (!readUnsigned(string_size) || string_size > size - position)
+        {
+            return false;
+        }
+        value.assign(data + position, string_size);
+        position += string_size;
+        return true;
+    }
+
+    /*!
+     * \brief Whether all data was read.
+     */
+    bool atEnd() const
+    {
+        return position == size;
+    }
+
+private:
+    const char* data; //!< The data being read.
+    size_t size; //!< The number of bytes of data.
+    size_t position; //!< The position of the next byte to read.
+};
+
+} //namespace cura
+
+#endif //UTILS_BINARY_BUFFER_H
@@ -0,0 +1,80 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "ClipperEngineCache.h"
+#include "Instrumentation.h"
+
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * \brief The engines that belong to one thread.
+ */
+struct ThreadEngines
+{
+    ClipperLib::Clipper clipper;
+    bool clipper_in_use = false;
+    ClipperLib::ClipperOffset clipper_offset;
+    bool clipper_offset_in_use = false;
+};
+
+thread_local ThreadEngines thread_engines;
+
+} //Anonymous namespace.
+
+CachedClipper::CachedClipper()
+{
+    ScopedTimer::count("clipper_operations");
+    if (thread_engines.clipper_in_use)
+    {
+        separate_clipper.reset(new ClipperLib::Clipper());
+        clipper = separate_clipper.get();
+        return;
+    }
+    thread_engines.clipper_in_use = true;
+    clipper = &thread_engines.clipper;
+    //Undo any options that the previous user set.
+    clipper->ReverseSolution(false);
+    clipper->StrictlySimple(false);
+    clipper->PreserveCollinear(false);
+}
+
+CachedClipper::~CachedClipper()
+{
+    if (separate_clipper)
+    {
+        return;
+    }
+    clipper->Clear();
+    thread_engines.clipper_in_use = false;
+}
+
+CachedClipperOffset::CachedClipperOffset(const double miter_limit, const double arc_tolerance)
+{
+    ScopedTimer::count("clipper_offsets");
+    if (thread_engines.clipper_offset_in_use)
+    {
+        separate_clipper.reset(new ClipperLib::ClipperOffset(miter_limit, arc_tolerance));
+        clipper = separate_clipper.get();
+        return;
+    }
+    thread_engines.clipper_offset_in_use = true;
+    clipper = &thread_engines.clipper_offset;
+    clipper->MiterLimit = miter_limit;
+    clipper->ArcTolerance = arc_tolerance;
+}
+
+CachedClipperOffset::~CachedClipperOffset()
+{
+    if (separate_clipper)
+    {
+        return;
+    }
+    clipper->Clear();
+    thread_engines.clipper_offset_in_use = false;
+}
+
+} //namespace cura
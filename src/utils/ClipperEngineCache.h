@@ -0,0 +1,95 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_CLIPPER_ENGINE_CACHE_H
+#define UTILS_CLIPPER_ENGINE_CACHE_H
+
+#include <memory> //For unique_ptr.
+#include <clipper.hpp>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Access to a ClipperLib::Clipper that is reused by all operations on
+ * the same thread.
+ *
+ * Clipper keeps its local minima, edges and output records in containers which
+ * stay allocated between operations, so reusing the engine saves allocating
+ * them again for every operation. The engine is cleared when this goes out of
+ * scope.
+ *
+ * If the engine of the calling thread is still being used by an enclosing
+ * operation, a separate engine is created instead.
+ */
+class CachedClipper : NoCopy
+{
+public:
+    /*!
+     * \brief Take the engine of the calling thread, with the default options.
+     */
+    CachedClipper();
+
+    /*!
+     * \brief Clear the engine and give it back to the thread.
+     */
+    ~CachedClipper();
+
+    ClipperLib::Clipper& operator*()
+    {
+        return *clipper;
+    }
+
+    ClipperLib::Clipper* operator->()
+    {
+        return clipper;
+    }
+
+private:
+    ClipperLib::Clipper* clipper; //!< The engine to use.
+    std::unique_ptr<ClipperLib::Clipper> separate_clipper; //!< The engine that was created if the one of the thread was in use.
+};
+
+/*!
+ * \brief Access to a ClipperLib::ClipperOffset that is reused by all
+ * operations on the same thread.
+ *
+ * See \ref CachedClipper.
+ */
+class CachedClipperOffset : NoCopy
+{
+public:
+    /*!
+     * \brief Take the offset engine of the calling thread.
+     * \param miter_limit The maximum distance of a mitered corner, as a
+     * multiple of the offset distance.
+     * \param arc_tolerance The maximum deviation of a rounded corner from a
+     * true arc.
+     */
+    CachedClipperOffset(const double miter_limit, const double arc_tolerance);
+
+    /*!
+     * \brief Clear the engine and give it back to the thread.
+     */
+    ~CachedClipperOffset();
+
+    ClipperLib::ClipperOffset& operator*()
+    {
+        return *clipper;
+    }
+
+    ClipperLib::ClipperOffset* operator->()
+    {
+        return clipper;
+    }
+
+private:
+    ClipperLib::ClipperOffset* clipper; //!< The engine to use.
+    std::unique_ptr<ClipperLib::ClipperOffset> separate_clipper; //!< The engine that was created if the one of the thread was in use.
+};
+
+} //namespace cura
+
+#endif //UTILS_CLIPPER_ENGINE_CACHE_H
@@ -0,0 +1,236 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_CONCURRENT_LRU_CACHE_H
+#define UTILS_CONCURRENT_LRU_CACHE_H
+
+#include <functional>
+#include <list>
+#include <memory> //For shared_ptr.
+#include <mutex>
+#include <unordered_map>
+#include <utility> //For pair.
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A cache of lazily computed values which may be used from multiple
+ * threads at the same time and which holds on to a limited amount of data.
+ *
+ * The keys are spread over a number of shards, each with its own lock, so
+ * that threads looking up different keys hardly ever wait for each other. The
+ * value of a key is computed only once, even if multiple threads ask for it at
+ * the same time: the other threads wait for the first one to finish. The lock
+ * of the shard is not held while computing, so computing a value may look up
+ * other keys of the same cache, as long as no key (indirectly) depends on
+ * itself.
+ *
+ * Every value has a cost, e.g. its memory size. When the total cost of the
+ * values in a shard exceeds its share of the capacity, the least recently used
+ * values are dropped from the cache. Values are handed out as shared pointers,
+ * so a value that is dropped stays alive as long as someone is using it.
+ *
+ * The cost of the values may be counted as memory use of an account of the
+ * \ref MemoryBudget, see \ref trackMemory. While the budget is exceeded, the
+ * least recently used values are dropped even if the cache is within its
+ * capacity.
+ *
+ * \tparam K The type of the keys.
+ * \tparam V The type of the values.
+ * \tparam Hash The hash function of the keys.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class ConcurrentLRUCache : NoCopy
+{
+public:
+    typedef std::function<V ()> Computation; //!< Computes the value of a key that is not in the cache.
+    typedef std::function<size_t (const V&)> CostFunction; //!< Computes how much of the capacity a value takes up.
+
+    /*!
+     * \brief Creates an empty cache.
+     * \param capacity The maximum total cost of the values in the cache.
+     * \param cost_function Computes the cost of each value.
+     * \param shard_count The number of independently locked parts to divide
+     * the keys over.
+     */
+    ConcurrentLRUCache(const size_t capacity, const CostFunction& cost_function, const size_t shard_count = 16)
+    : cost_function(cost_function)
+    , shard_capacity(capacity / shard_count)
+    , shards(shard_count)
+    {
+    }
+
+    ~ConcurrentLRUCache()
+    {
+        if (tracked)
+        {
+            for (const Shard& shard : shards)
+            {
+                MemoryBudget::getInstance().subtract(account, shard.cost);
+            }
+        }
+    }
+
+    /*!
+     * \brief Count the cost of the values as memory use of an account of the
+     * \ref MemoryBudget, if it's tracking memory use. The cost must then be
+     * the memory size of the values, in bytes.
+     *
+     * This must be called before the cache is used.
+     * \param account The account to count the memory use in.
+     */
+    void trackMemory(const MemoryAccount account)
+    {
+        tracked = MemoryBudget::getInstance().isTracking();
+        this->account = account;
+    }
+
+    /*!
+     * \brief Get the value of a key, computing it if it's not in the cache.
+     * \param key The key to look up.
+     * \param compute Computes the value if it's not in the cache.
+     * \return The value of the key.
+     */
+    std::shared_ptr<const V> get(const K& key, const Computation& compute)
+    {
+        Shard& shard = getShard(key);
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const auto it = shard.entries.find(key);
+            if (it != shard.entries.end())
+            {
+                shard.recency.splice(shard.recency.begin(), shard.recency, it->second.second); // mark as most recently used
+                entry = it->second.first;
+            }
+            else
+            {
+                entry = std::make_shared<Entry>();
+                shard.recency.push_front(key);
+                shard.entries.emplace(key, std::make_pair(entry, shard.recency.begin()));
+            }
+        }
+
+        bool computed = false;
+        std::call_once(entry->once, [&]()
+        {
+            entry->value = std::make_shared<const V>(compute());
+            computed = true;
+        });
+        if (computed)
+        {
+            const size_t cost = cost_function(*entry->value);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            entry->cost = cost;
+            entry->computed = true;
+            if (isCached(shard, key, entry))
+            {
+                shard.cost += cost;
+                if (tracked)
+                {
+                    MemoryBudget::getInstance().add(account, cost);
+                }
+                evict(shard, key);
+            }
+        }
+        return entry->value;
+    }
+
+    /*!
+     * \brief Whether the value of a key is in the cache.
+     *
+     * This doesn't count as using the value.
+     * \param key The key to look up.
+     * \return Whether the value is in the cache, or being computed.
+     */
+    bool contains(const K& key)
+    {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.entries.find(key) != shard.entries.end();
+    }
+
+private:
+    /*!
+     * \brief A value in the cache.
+     */
+    struct Entry
+    {
+        std::once_flag once; //!< Makes sure the value is computed only once.
+        std::shared_ptr<const V> value; //!< The value, once it's computed.
+        bool computed = false; //!< Whether the value is computed and counted in the cost of the shard. Protected by the lock of the shard.
+        size_t cost = 0; //!< The cost of the value, once it's computed. Protected by the lock of the shard.
+    };
+
+    /*!
+     * \brief The part of the cache that holds the keys with a particular hash.
+     */
+    struct Shard
+    {
+        std::mutex mutex; //!< Protects everything in the shard.
+        std::list<K> recency; //!< The keys in the shard, from most to least recently used.
+        std::unordered_map<K, std::pair<std::shared_ptr<Entry>, typename std::list<K>::iterator>, Hash> entries; //!< The entry of each key, and its place in the recency list.
+        size_t cost = 0; //!< The total cost of the computed values in the shard.
+    };
+
+    Shard& getShard(const K& key)
+    {
+        return shards[Hash()(key) % shards.size()];
+    }
+
+    /*!
+     * \brief Whether a particular entry is (still) the cached entry of its
+     * key.
+     */
+    static bool isCached(Shard& shard, const K& key, const std::shared_ptr<Entry>& entry)
+    {
+        const auto it = shard.entries.find(key);
+        return it != shard.entries.end() && it->second.first == entry;
+    }
+
+    /*!
+     * \brief Drop the least recently used values until the shard is within
+     * its capacity, and the memory budget isn't exceeded if tracked.
+     *
+     * The shard must be locked.
+     * \param shard The shard to drop values from.
+     * \param keep A key that must stay in the cache, because its value was
+     * just computed.
+     */
+    void evict(Shard& shard, const K& keep)
+    {
+        auto it = shard.recency.end();
+        while ((shard.cost > shard_capacity || (tracked && MemoryBudget::getInstance().isExceeded())) && it != shard.recency.begin())
+        {
+            --it;
+            const auto entry_it = shard.entries.find(*it);
+            const Entry& entry = *entry_it->second.first;
+            if (*it == keep || !entry.computed)
+            {
+                continue; // values that are still being computed don't take up any capacity yet
+            }
+            shard.cost -= entry.cost;
+            if (tracked)
+            {
+                MemoryBudget::getInstance().subtract(account, entry.cost);
+            }
+            shard.entries.erase(entry_it);
+            it = shard.recency.erase(it);
+        }
+    }
+
+    const CostFunction cost_function; //!< Computes the cost of each value.
+    const size_t shard_capacity; //!< The maximum total cost of the values in each shard.
+    std::vector<Shard> shards; //!< The independently locked parts of the cache.
+    bool tracked = false; //!< Whether the cost of the values is counted in the memory budget.
+    MemoryAccount account = MemoryAccount::COUNT; //!< The account of the memory budget that the cost is counted in, if tracked.
+};
+
+} //namespace cura
+
+#endif //UTILS_CONCURRENT_LRU_CACHE_H
@@ -0,0 +1,64 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_DETERMINISTIC_RANDOM_H
+#define UTILS_DETERMINISTIC_RANDOM_H
+
+#include <cstdint> //For uint64_t.
+
+namespace cura
+{
+
+/*!
+ * \brief A small random number generator that gives the same numbers for the
+ * same seed, on every platform and in every thread.
+ *
+ * Unlike ``rand()``, it has no shared state, so tasks that run in parallel can
+ * each have their own generator, seeded with what they work on (e.g. the layer
+ * and the part). The output then doesn't depend on the number of threads or on
+ * the order in which the tasks run.
+ *
+ * The numbers are the SplitMix64 hash of a counter, which is statistically
+ * good enough for geometric noise but not for anything cryptographic.
+ */
+class DeterministicRandom
+{
+public:
+    /*!
+     * \brief Start a sequence of random numbers.
+     * \param seed Which sequence to generate.
+     */
+    DeterministicRandom(const uint64_t seed)
+    : counter(seed)
+    {
+    }
+
+    /*!
+     * \brief Get the next random number of the sequence.
+     */
+    uint64_t next()
+    {
+        counter += 0x9e3779b97f4a7c15ULL;
+        uint64_t result = counter;
+        result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        result = (result ^ (result >> 27)) * 0x94d049bb133111ebULL;
+        return result ^ (result >> 31);
+    }
+
+    /*!
+     * \brief Get the next random number of the sequence, in the range from 0
+     * up to but not including \p bound.
+     * \param bound The upper bound of the range. Must be positive.
+     */
+    int64_t below(const int64_t bound)
+    {
+        return static_cast<int64_t>(next() % static_cast<uint64_t>(bound));
+    }
+
+private:
+    uint64_t counter; //!< The position in the sequence.
+};
+
+} //namespace cura
+
+#endif //UTILS_DETERMINISTIC_RANDOM_H
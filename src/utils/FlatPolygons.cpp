@@ -0,0 +1,53 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "FlatPolygons.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+FlatPolygons::FlatPolygons()
+: offsets(1, 0)
+{
+}
+
+FlatPolygons::FlatPolygons(const Polygons& polygons)
+: offsets(1, 0)
+{
+    reserve(polygons.size(), polygons.pointCount());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        add(polygon);
+    }
+}
+
+void FlatPolygons::reserve(const size_t polygon_count, const size_t point_count)
+{
+    offsets.reserve(polygon_count + 1);
+    points.reserve(point_count);
+}
+
+void FlatPolygons::add(const ConstPolygonRef& polygon)
+{
+    points.insert(points.end(), polygon.begin(), polygon.end());
+    offsets.push_back(points.size());
+}
+
+void FlatPolygons::clear()
+{
+    points.clear();
+    offsets.resize(1);
+}
+
+Polygons FlatPolygons::toPolygons() const
+{
+    Polygons result;
+    for (size_t poly_idx = 0; poly_idx < size(); poly_idx++)
+    {
+        result.emplace_back(points.begin() + offsets[poly_idx], points.begin() + offsets[poly_idx + 1]);
+    }
+    return result;
+}
+
+} //namespace cura
@@ -0,0 +1,132 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_FLAT_POLYGONS_H
+#define UTILS_FLAT_POLYGONS_H
+
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+class ConstPolygonRef;
+class Polygons;
+
+/*!
+ * \brief A read-only copy of polygons, with all points in a single array.
+ *
+ * \ref Polygons keeps every polygon in a separate allocation, which is what
+ * Clipper needs, but which scatters the points over memory. Code that reads
+ * the same points many times, such as path ordering, can copy them into this
+ * once so that those reads stay in a contiguous block.
+ */
+class FlatPolygons
+{
+public:
+    /*!
+     * \brief A view on the points of one of the polygons.
+     *
+     * It is invalidated when polygons are added to the \ref FlatPolygons it
+     * came from.
+     */
+    class ConstFlatPolygonRef
+    {
+    public:
+        ConstFlatPolygonRef(const Point* begin, const Point* end)
+        : begin_point(begin)
+        , end_point(end)
+        {
+        }
+
+        size_t size() const
+        {
+            return end_point - begin_point;
+        }
+
+        bool empty() const
+        {
+            return begin_point == end_point;
+        }
+
+        const Point& operator[](const size_t index) const
+        {
+            return begin_point[index];
+        }
+
+        const Point* begin() const
+        {
+            return begin_point;
+        }
+
+        const Point* end() const
+        {
+            return end_point;
+        }
+
+    private:
+        const Point* begin_point; //!< The first point of the polygon.
+        const Point* end_point; //!< Just past the last point of the polygon.
+    };
+
+    /*!
+     * \brief Create an empty collection of polygons.
+     */
+    FlatPolygons();
+
+    /*!
+     * \brief Copy polygons.
+     */
+    FlatPolygons(const Polygons& polygons);
+
+    /*!
+     * \brief Reserve memory for a number of polygons and points.
+     */
+    void reserve(const size_t polygon_count, const size_t point_count);
+
+    /*!
+     * \brief Add a copy of a polygon after the polygons already in here.
+     */
+    void add(const ConstPolygonRef& polygon);
+
+    /*!
+     * \brief Remove all polygons.
+     */
+    void clear();
+
+    /*!
+     * \brief The number of polygons.
+     */
+    size_t size() const
+    {
+        return offsets.size() - 1;
+    }
+
+    /*!
+     * \brief The number of points in all polygons together.
+     */
+    size_t pointCount() const
+    {
+        return points.size();
+    }
+
+    ConstFlatPolygonRef operator[](const size_t poly_idx) const
+    {
+        const Point* data = points.data();
+        return ConstFlatPolygonRef(data + offsets[poly_idx], data + offsets[poly_idx + 1]);
+    }
+
+    /*!
+     * \brief Copy the polygons back into the form that Clipper uses.
+     */
+    Polygons toPolygons() const;
+
+private:
+    std::vector<Point> points; //!< The points of all polygons, one polygon after the other.
+    std::vector<size_t> offsets; //!< Where each polygon starts in #points, followed by the total number of points.
+};
+
+} //namespace cura
+
+#endif //UTILS_FLAT_POLYGONS_H
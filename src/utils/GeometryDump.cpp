@@ -0,0 +1,272 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For find.
+#include <fstream>
+#include <iterator> //For istreambuf_iterator.
+#include <map>
+#include <sstream>
+
+#include "BinaryBuffer.h"
+#include "GeometryDump.h"
+#include "logoutput.h"
+#include "SVG.h"
+
+namespace cura
+{
+
+namespace
+{
+
+const std::string dump_magic = "CuraEngineGeometryDump"; //!< The start of every dump, to recognise it.
+constexpr uint64_t dump_version = 1; //!< The version of the format, after the magic.
+
+/*!
+ * \brief Split a comma-separated list, leaving out empty items.
+ */
+std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> result;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty())
+        {
+            result.push_back(item);
+        }
+    }
+    return result;
+}
+
+} //Anonymous namespace.
+
+GeometryDump& GeometryDump::getInstance()
+{
+    static GeometryDump instance;
+    return instance;
+}
+
+GeometryDump::GeometryDump()
+: enabled(false)
+{
+}
+
+bool GeometryDump::start(const std::string& file_name, const std::string& layers, const std::string& stages)
+{
+    finish();
+    if (!parseLayers(layers, layer_ranges))
+    {
+        logError("Couldn't parse the layers to dump: %s\n", layers.c_str());
+        return false;
+    }
+    this->stages = splitList(stages);
+    if (!file.open(file_name.c_str()))
+    {
+        logError("Couldn't open the geometry dump file: %s\n", file_name.c_str());
+        return false;
+    }
+    BinaryWriter header;
+    header.writeString(dump_magic);
+    header.writeUnsigned(dump_version);
+    file.write(header.getData().data(), header.getData().size());
+    log("Dumping geometry to %s.\n", file_name.c_str());
+    enabled = true;
+    return true;
+}
+
+bool GeometryDump::isSelected(const std::string& stage, const LayerIndex layer_nr) const
+{
+    if (!stages.empty() && std::find(stages.begin(), stages.end(), stage) == stages.end())
+    {
+        return false;
+    }
+    if (layer_ranges.empty())
+    {
+        return true;
+    }
+    for (const std::pair<LayerIndex, LayerIndex>& range : layer_ranges)
+    {
+        if (layer_nr >= range.first && layer_nr <= range.second)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GeometryDump::dump(const std::string& stage, const LayerIndex layer_nr, const std::string& name, const Polygons& polygons)
+{
+    if (!isDumping(stage, layer_nr))
+    {
+        return;
+    }
+    //Encode the record before taking the lock, so that threads only wait for each other to queue the bytes.
+    BinaryWriter record;
+    record.writeString(stage);
+    record.writeSigned(layer_nr);
+    record.writeString(name);
+    record.writeUnsigned(polygons.size());
+    for (ConstPolygonRef polygon : polygons)
+    {
+        record.writeUnsigned(polygon.size());
+        Point previous(0, 0);
+        for (const Point& point : polygon)
+        {
+            record.writeSigned(point.X - previous.X);
+            record.writeSigned(point.Y - previous.Y);
+            previous = point;
+        }
+    }
+    BinaryWriter block;
+    block.writeString(record.getData());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file.write(block.getData().data(), block.getData().size());
+}
+
+bool GeometryDump::finish()
+{
+    if (!enabled)
+    {
+        return true;
+    }
+    enabled = false;
+    std::lock_guard<std::mutex> lock(mutex);
+    const bool success = file.close();
+    if (!success)
+    {
+        logError("Couldn't write the whole geometry dump.\n");
+    }
+    return success;
+}
+
+bool GeometryDump::read(const std::string& file_name, std::vector<Record>& records)
+{
+    std::ifstream file(file_name.c_str(), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    BinaryReader reader(data);
+    std::string magic;
+    uint64_t version;
+    if (!reader.readString(magic) || magic != dump_magic || !reader.readUnsigned(version) || version != dump_version)
+    {
+        return false;
+    }
+    while (!reader.atEnd())
+    {
+        std::string block;
+        if (!reader.readString(block))
+        {
+            return false;
+        }
+        BinaryReader record_reader(block);
+        Record record;
+        int64_t layer_nr;
+        uint64_t polygon_count;
+        if (!record_reader.readString(record.stage) || !record_reader.readSigned(layer_nr) || !record_reader.readString(record.name) || !record_reader.readUnsigned(polygon_count))
+        {
+            return false;
+        }
+        record.layer_nr = layer_nr;
+        for (uint64_t polygon_idx = 0; polygon_idx < polygon_count; polygon_idx++)
+        {
+            uint64_t point_count;
+            if (!record_reader.readUnsigned(point_count) || point_count > block.size())
+            {
+                return false;
+            }
+            PolygonRef polygon = record.polygons.newPoly();
+            Point point(0, 0);
+            for (uint64_t point_idx = 0; point_idx < point_count; point_idx++)
+            {
+                int64_t dx;
+                int64_t dy;
+                if (!record_reader.readSigned(dx) || !record_reader.readSigned(dy))
+                {
+                    return false;
+                }
+                point += Point(dx, dy);
+                polygon.add(point);
+            }
+        }
+        records.push_back(std::move(record));
+    }
+    return true;
+}
+
+size_t GeometryDump::writeSVGs(const std::vector<Record>& records, const std::string& prefix)
+{
+    std::map<std::pair<std::string, LayerIndex>, std::vector<const Record*>> records_per_file;
+    for (const Record& record : records)
+    {
+        records_per_file[std::make_pair(record.stage, record.layer_nr)].push_back(&record);
+    }
+
+    constexpr SVG::Color colors[] = {SVG::Color::BLACK, SVG::Color::RED, SVG::Color::BLUE, SVG::Color::GREEN, SVG::Color::YELLOW, SVG::Color::GRAY};
+    size_t file_count = 0;
+    for (const std::pair<const std::pair<std::string, LayerIndex>, std::vector<const Record*>>& file_records : records_per_file)
+    {
+        AABB aabb;
+        for (const Record* record : file_records.second)
+        {
+            aabb.include(AABB(record->polygons));
+        }
+        if (aabb.min.X > aabb.max.X) //Nothing to draw.
+        {
+            continue;
+        }
+        const std::string file_name = prefix + file_records.first.first + "_" + std::to_string(static_cast<int>(file_records.first.second)) + ".svg";
+        SVG svg(file_name.c_str(), aabb);
+        size_t color_idx = 0;
+        for (const Record* record : file_records.second)
+        {
+            svg.writeComment(record->name);
+            svg.writePolygons(record->polygons, colors[color_idx++ % (sizeof(colors) / sizeof(colors[0]))]);
+        }
+        file_count++;
+    }
+    return file_count;
+}
+
+bool GeometryDump::parseLayers(const std::string& layers, std::vector<std::pair<LayerIndex, LayerIndex>>& ranges)
+{
+    ranges.clear();
+    for (const std::string& item : splitList(layers))
+    {
+        const size_t dash = item.find('-', 1); //A dash at the start is the sign of a negative layer, like a raft layer.
+        try
+        {
+            size_t parsed;
+            const int first = std::stoi(item, &parsed);
+            if (dash == std::string::npos)
+            {
+                if (parsed != item.size())
+                {
+                    return false;
+                }
+                ranges.emplace_back(first, first);
+                continue;
+            }
+            const std::string last_string = item.substr(dash + 1);
+            const int last = std::stoi(last_string, &parsed);
+            if (parsed != last_string.size() || last < first)
+            {
+                return false;
+            }
+            ranges.emplace_back(first, last);
+        }
+        catch (const std::logic_error&) //Not a number, or out of range.
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace cura
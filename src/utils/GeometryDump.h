@@ -0,0 +1,137 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_GEOMETRY_DUMP_H
+#define UTILS_GEOMETRY_DUMP_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility> //For pair.
+#include <vector>
+
+#include "AsyncFileStream.h"
+#include "NoCopy.h"
+#include "polygon.h"
+#include "../settings/types/LayerIndex.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Writes the geometry of selected layers and stages to a compact binary
+ * file, to diagnose slow or wrong layers of a slice without rebuilding the
+ * engine.
+ *
+ * The dump is started with the geometry_dump_file setting, optionally limited
+ * to the layers in geometry_dump_layers (such as "0,10-12") and the stages in
+ * geometry_dump_stages (such as "walls,skin"). The records are written on a
+ * background thread, so dumping only costs the encoding. While no dump is
+ * started, \ref isDumping is a single atomic load. The file is written anew
+ * for every mesh group.
+ *
+ * Every record is a length-prefixed block of a \ref BinaryWriter with the
+ * stage, the layer number, the name of the geometry and its polygons, with the
+ * coordinates delta-encoded. The command "CuraEngine dumpsvg" converts a dump
+ * to SVG files, one per stage and layer.
+ */
+class GeometryDump : NoCopy
+{
+public:
+    /*!
+     * \brief A piece of geometry as it was dumped.
+     */
+    struct Record
+    {
+        std::string stage; //!< The stage of the slice that the geometry was dumped in.
+        LayerIndex layer_nr; //!< The layer that the geometry is in.
+        std::string name; //!< What the geometry is, such as "wall_0".
+        Polygons polygons; //!< The geometry itself.
+    };
+
+    static GeometryDump& getInstance();
+
+    /*!
+     * \brief Start dumping to a file.
+     * \param file_name The file to write to.
+     * \param layers The layers to dump, as a comma-separated list of layer
+     * numbers and ranges like "10-12", or an empty string for all layers.
+     * \param stages The stages to dump, as a comma-separated list, or an empty
+     * string for all stages.
+     * \return Whether the file could be opened and the layers were valid.
+     */
+    bool start(const std::string& file_name, const std::string& layers, const std::string& stages);
+
+    /*!
+     * \brief Whether the geometry of a stage in a layer is being dumped.
+     *
+     * Check this before collecting the geometry to dump. This may be called
+     * from any thread.
+     */
+    bool isDumping(const std::string& stage, const LayerIndex layer_nr) const
+    {
+        return enabled.load(std::memory_order_relaxed) && isSelected(stage, layer_nr);
+    }
+
+    /*!
+     * \brief Dump some geometry, if its stage and layer are selected.
+     *
+     * This may be called from any thread.
+     * \param stage The stage of the slice, such as "walls".
+     * \param layer_nr The layer that the geometry is in.
+     * \param name What the geometry is, such as "wall_0".
+     * \param polygons The geometry to dump.
+     */
+    void dump(const std::string& stage, const LayerIndex layer_nr, const std::string& name, const Polygons& polygons);
+
+    /*!
+     * \brief Write the remaining records and close the file, if a dump was
+     * started.
+     * \return Whether all records could be written.
+     */
+    bool finish();
+
+    /*!
+     * \brief Read all records of a dump.
+     * \param file_name The dump to read.
+     * \param[out] records The records in the dump.
+     * \return Whether the file could be read and is a complete dump.
+     */
+    static bool read(const std::string& file_name, std::vector<Record>& records);
+
+    /*!
+     * \brief Draw records in SVG files, one for every stage and layer.
+     * \param records The records to draw.
+     * \param prefix The start of the file names. The stage, the layer number
+     * and ".svg" are added to it.
+     * \return The number of SVG files that were written.
+     */
+    static size_t writeSVGs(const std::vector<Record>& records, const std::string& prefix);
+
+    /*!
+     * \brief Parse a selection of layers.
+     * \param layers A comma-separated list of layer numbers and ranges like
+     * "10-12".
+     * \param[out] ranges The first and last layer of every range.
+     * \return Whether the selection could be parsed.
+     */
+    static bool parseLayers(const std::string& layers, std::vector<std::pair<LayerIndex, LayerIndex>>& ranges);
+
+private:
+    GeometryDump();
+
+    /*!
+     * \brief Whether a stage and layer were selected when the dump started.
+     */
+    bool isSelected(const std::string& stage, const LayerIndex layer_nr) const;
+
+    std::atomic<bool> enabled; //!< Whether a dump was started. The selection doesn't change while this is true.
+    std::vector<std::pair<LayerIndex, LayerIndex>> layer_ranges; //!< The selected layers, or empty for all layers.
+    std::vector<std::string> stages; //!< The selected stages, or empty for all stages.
+    std::mutex mutex; //!< Held while a record is written to the file.
+    AsyncFileStream file; //!< The file being written.
+};
+
+} //namespace cura
+
+#endif //UTILS_GEOMETRY_DUMP_H
@@ -0,0 +1,110 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef GZIP
+
+#include "GzipFileStream.h"
+
+namespace cura
+{
+
+GzipFileBuffer::GzipFileBuffer()
+: AsyncFileBuffer(true)
+, stream()
+{
+}
+
+GzipFileBuffer::~GzipFileBuffer()
+{
+    close(); // while this is still a GzipFileBuffer, so that the last block gets compressed
+}
+
+bool GzipFileBuffer::begin()
+{
+    stream = z_stream();
+    constexpr int window_bits = 15 + 16; // the largest window, with a gzip header and trailer
+    constexpr int memory_level = 8; // the default
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, memory_level, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+    compressed.resize(1 << 20);
+    return true;
+}
+
+bool GzipFileBuffer::writeBlock(const char* data, const size_t size, const BlockEnd block_end)
+{
+    const int flush = (block_end == BlockEnd::CLOSE) ? Z_FINISH : ((block_end == BlockEnd::FLUSH) ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+    stream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(data));
+    stream.avail_in = size;
+    do
+    {
+        stream.next_out = compressed.data();
+        stream.avail_out = compressed.size();
+        if (deflate(&stream, flush) == Z_STREAM_ERROR)
+        {
+            return false;
+        }
+        const size_t compressed_size = compressed.size() - stream.avail_out;
+        if (fwrite(compressed.data(), 1, compressed_size, file) != compressed_size)
+        {
+            return false;
+        }
+    }
+    while (stream.avail_out == 0); // the output buffer was too small to hold everything
+    return true;
+}
+
+void GzipFileBuffer::end()
+{
+    deflateEnd(&stream);
+}
+
+GzipFileBuffer::pos_type GzipFileBuffer::seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode)
+{
+    return pos_type(off_type(-1));
+}
+
+GzipFileBuffer::pos_type GzipFileBuffer::seekpos(pos_type, std::ios_base::openmode)
+{
+    return pos_type(off_type(-1));
+}
+
+GzipFileStream::GzipFileStream()
+: std::ostream(nullptr)
+{
+    rdbuf(&buffer);
+}
+
+bool GzipFileStream::open(const char* filename)
+{
+    const bool opened = buffer.open(filename);
+    if (opened)
+    {
+        clear();
+    }
+    else
+    {
+        setstate(std::ios_base::failbit);
+    }
+    return opened;
+}
+
+bool GzipFileStream::close()
+{
+    const bool closed = buffer.close();
+    if (!closed)
+    {
+        setstate(std::ios_base::failbit);
+    }
+    return closed;
+}
+
+bool GzipFileStream::isOpen() const
+{
+    return buffer.isOpen();
+}
+
+} //namespace cura
+
+#endif //GZIP
@@ -0,0 +1,106 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_GZIP_FILE_STREAM_H
+#define UTILS_GZIP_FILE_STREAM_H
+
+#ifdef GZIP
+
+#include <ostream>
+#include <vector>
+#include <zlib.h>
+
+#include "AsyncFileStream.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Stream buffer that writes a gzip compressed file.
+ *
+ * The blocks of data are compressed on the background thread of the
+ * \ref AsyncFileBuffer, so writing to the stream only waits for the
+ * compression if that falls behind.
+ */
+class GzipFileBuffer : public AsyncFileBuffer
+{
+public:
+    GzipFileBuffer();
+
+    /*!
+     * \brief Finishes and closes the file, if it is still open.
+     */
+    ~GzipFileBuffer();
+
+protected:
+    /*!
+     * \brief Start a new gzip stream.
+     */
+    bool begin() override;
+
+    /*!
+     * \brief Compress a block and write the result to the file.
+     *
+     * When the stream is flushed, everything so far is compressed such that it
+     * can be decompressed up to that point. When the file is closed, the gzip
+     * stream is finished.
+     */
+    bool writeBlock(const char* data, const size_t size, const BlockEnd block_end) override;
+
+    /*!
+     * \brief Free the state of the compression.
+     */
+    void end() override;
+
+    /*!
+     * \brief Compressed data can't be overwritten, so this always fails.
+     */
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which = std::ios_base::out) override;
+
+    /*!
+     * \brief Compressed data can't be overwritten, so this always fails.
+     */
+    pos_type seekpos(pos_type position, std::ios_base::openmode which = std::ios_base::out) override;
+
+private:
+    z_stream stream; //!< The state of the compression.
+    std::vector<unsigned char> compressed; //!< Output of the compression, before it's written to the file.
+};
+
+/*!
+ * \brief Output stream that writes a gzip compressed file.
+ *
+ * See \ref GzipFileBuffer.
+ */
+class GzipFileStream : public std::ostream
+{
+public:
+    GzipFileStream();
+
+    /*!
+     * \brief Open a file to write the compressed data to.
+     * \param filename The file to write to.
+     * \return Whether the file could be opened.
+     */
+    bool open(const char* filename);
+
+    /*!
+     * \brief Finish the gzip stream and close the file.
+     * \return Whether all data could be written.
+     */
+    bool close();
+
+    /*!
+     * \brief Whether a file is open.
+     */
+    bool isOpen() const;
+
+private:
+    GzipFileBuffer buffer; //!< Collects and compresses the data.
+};
+
+} //namespace cura
+
+#endif //GZIP
+
+#endif //UTILS_GZIP_FILE_STREAM_H
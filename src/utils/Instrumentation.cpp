@@ -0,0 +1,367 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For stable_sort and partial_sort.
+#include <fstream>
+#include <iterator> //For back_inserter.
+#include <map>
+#include <stdio.h> //For snprintf.
+#include <time.h> //For the CPU time of the thread.
+
+#include "Instrumentation.h"
+#include "gettime.h"
+#include "logoutput.h"
+
+namespace cura
+{
+
+namespace
+{
+
+thread_local std::vector<Instrumentation::Event>* own_events = nullptr; //!< The buffer of each thread that has recorded anything.
+thread_local size_t own_thread_nr = 0; //!< The number of each thread that has recorded anything, see \ref Instrumentation::Event::thread_nr.
+
+#ifdef INSTRUMENTATION
+thread_local ScopedTimer* innermost_timer = nullptr; //!< The innermost timer of each thread that is recording.
+
+/*!
+ * \brief The CPU time that the calling thread has used, in seconds, or zero
+ * if the platform doesn't keep track of it per thread.
+ */
+double getThreadCpuTime()
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return double(time.tv_sec) + double(time.tv_nsec) / 1000000000.0;
+#else
+    return 0.0;
+#endif
+}
+#endif //INSTRUMENTATION
+
+} //Anonymous namespace.
+
+Instrumentation& Instrumentation::getInstance()
+{
+    static Instrumentation instance;
+    return instance;
+}
+
+Instrumentation::Instrumentation()
+: enabled(false)
+, start_time(0)
+{
+}
+
+void Instrumentation::addSink(std::unique_ptr<InstrumentationSink> sink)
+{
+#ifndef INSTRUMENTATION
+    logWarning("Instrumentation is not available in this build.\n");
+    return;
+#endif //INSTRUMENTATION
+    std::lock_guard<std::mutex> lock(mutex);
+    sinks.push_back(std::move(sink));
+    if (!enabled)
+    {
+        start_time = cura::getTime();
+        enabled = true;
+    }
+}
+
+double Instrumentation::getTime() const
+{
+    return cura::getTime() - start_time;
+}
+
+void Instrumentation::record(Event&& event)
+{
+    if (!own_events) //The first event of this thread.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        own_thread_nr = thread_events.size();
+        thread_events.emplace_back(new std::vector<Event>());
+        own_events = thread_events.back().get();
+    }
+    event.thread_nr = own_thread_nr;
+    own_events->push_back(std::move(event));
+}
+
+void Instrumentation::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled)
+    {
+        return;
+    }
+    enabled = false;
+    std::vector<Event> events;
+    for (const std::unique_ptr<std::vector<Event>>& buffer : thread_events)
+    {
+        std::move(buffer->begin(), buffer->end(), std::back_inserter(events));
+        buffer->clear();
+    }
+    std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+    {
+        return a.start + a.wall_time < b.start + b.wall_time;
+    });
+    for (const std::unique_ptr<InstrumentationSink>& sink : sinks)
+    {
+        sink->write(events);
+    }
+    sinks.clear();
+}
+
+#ifdef INSTRUMENTATION
+
+ScopedTimer::ScopedTimer(const char* name, const int layer_nr)
+: outer_timer(nullptr)
+, start_cpu_time(0)
+{
+    Instrumentation& instrumentation = Instrumentation::getInstance();
+    if (!instrumentation.isEnabled())
+    {
+        return;
+    }
+    event.reset(new Instrumentation::Event());
+    event->name = name;
+    event->layer_nr = layer_nr;
+    event->start = instrumentation.getTime();
+    start_cpu_time = getThreadCpuTime();
+    outer_timer = innermost_timer;
+    innermost_timer = this;
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (!event)
+    {
+        return;
+    }
+    innermost_timer = outer_timer;
+    Instrumentation& instrumentation = Instrumentation::getInstance();
+    if (!instrumentation.isEnabled()) //Finished while this stage was running.
+    {
+        return;
+    }
+    event->wall_time = instrumentation.getTime() - event->start;
+    event->cpu_time = getThreadCpuTime() - start_cpu_time;
+    instrumentation.record(std::move(*event));
+}
+
+void ScopedTimer::count(const char* counter, const int64_t amount)
+{
+    if (!innermost_timer)
+    {
+        return;
+    }
+    std::vector<std::pair<const char*, int64_t>>& counters = innermost_timer->event->counters;
+    for (std::pair<const char*, int64_t>& name_and_total : counters)
+    {
+        if (name_and_total.first == counter)
+        {
+            name_and_total.second += amount;
+            return;
+        }
+    }
+    counters.emplace_back(counter, amount);
+}
+#endif //INSTRUMENTATION
+
+ChromeTraceSink::ChromeTraceSink(const std::string& filename)
+: filename(filename)
+{
+}
+
+void ChromeTraceSink::write(const std::vector<Instrumentation::Event>& events)
+{
+    std::ofstream file(filename);
+    if (!file)
+    {
+        logError("Failed to open %s to write the trace to.\n", filename.c_str());
+        return;
+    }
+    file << std::fixed;
+    file.precision(3);
+    file << "{\"traceEvents\":[";
+    for (size_t event_idx = 0; event_idx < events.size(); event_idx++)
+    {
+        const Instrumentation::Event& event = events[event_idx];
+        file << (event_idx == 0 ? "\n" : ",\n");
+        //Complete events, with the times in microseconds.
+        file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread_nr;
+        file << ",\"ts\":" << event.start * 1000000.0 << ",\"dur\":" << event.wall_time * 1000000.0;
+        file << ",\"args\":{\"cpu_time\":" << event.cpu_time * 1000000.0;
+        if (event.layer_nr >= 0)
+        {
+            file << ",\"layer_nr\":" << event.layer_nr;
+        }
+        for (const std::pair<const char*, int64_t>& counter : event.counters)
+        {
+            file << ",\"" << counter.first << "\":" << counter.second;
+        }
+        file << "}}";
+    }
+    file << "\n]}\n";
+}
+
+InstrumentationSummarySink::InstrumentationSummarySink(const std::string& filename)
+: filename(filename)
+{
+}
+
+void InstrumentationSummarySink::write(const std::vector<Instrumentation::Event>& events)
+{
+    struct Stage
+    {
+        std::string name;
+        size_t runs = 0;
+        double wall_time = 0;
+        double cpu_time = 0;
+        std::vector<std::pair<std::string, int64_t>> counters; //In the order in which they were first counted.
+    };
+    std::vector<Stage> stages; //In the order in which they first ended.
+    std::map<std::string, size_t> stage_indices;
+    for (const Instrumentation::Event& event : events)
+    {
+        const std::map<std::string, size_t>::const_iterator found = stage_indices.find(event.name);
+        if (found == stage_indices.end())
+        {
+            stage_indices.emplace(event.name, stages.size());
+            stages.emplace_back();
+            stages.back().name = event.name;
+        }
+        Stage& stage = (found == stage_indices.end()) ? stages.back() : stages[found->second];
+        stage.runs++;
+        stage.wall_time += event.wall_time;
+        stage.cpu_time += event.cpu_time;
+        for (const std::pair<const char*, int64_t>& counter : event.counters)
+        {
+            std::vector<std::pair<std::string, int64_t>>::iterator total = stage.counters.begin();
+            while (total != stage.counters.end() && total->first != counter.first)
+            {
+                total++;
+            }
+            if (total == stage.counters.end())
+            {
+                stage.counters.emplace_back(counter.first, 0);
+                total = stage.counters.end() - 1;
+            }
+            total->second += counter.second;
+        }
+    }
+
+    std::ofstream file(filename);
+    if (!file)
+    {
+        logError("Failed to open %s to write the instrumentation summary to.\n", filename.c_str());
+        return;
+    }
+    file << std::fixed;
+    file.precision(6);
+    file << "{\"stages\":[";
+    for (size_t stage_idx = 0; stage_idx < stages.size(); stage_idx++)
+    {
+        const Stage& stage = stages[stage_idx];
+        file << (stage_idx == 0 ? "\n" : ",\n");
+        file << "{\"name\":\"" << stage.name << "\",\"runs\":" << stage.runs << ",\"wall_time\":" << stage.wall_time << ",\"cpu_time\":" << stage.cpu_time << ",\"counters\":{";
+        for (size_t counter_idx = 0; counter_idx < stage.counters.size(); counter_idx++)
+        {
+            file << (counter_idx == 0 ? "" : ",") << "\"" << stage.counters[counter_idx].first << "\":" << stage.counters[counter_idx].second;
+        }
+        file << "}}";
+    }
+    file << "\n]}\n";
+}
+
+SlowestLayersSink::SlowestLayersSink(const size_t layer_count)
+: layer_count(layer_count)
+{
+}
+
+std::vector<SlowestLayersSink::LayerCost> SlowestLayersSink::getSlowestLayers(const std::vector<Instrumentation::Event>& events, const size_t layer_count)
+{
+    std::vector<LayerCost> layers;
+    std::map<int, size_t> layer_indices;
+    for (const Instrumentation::Event& event : events)
+    {
+        if (event.layer_nr < 0)
+        {
+            continue;
+        }
+        const std::map<int, size_t>::const_iterator found = layer_indices.find(event.layer_nr);
+        if (found == layer_indices.end())
+        {
+            layer_indices.emplace(event.layer_nr, layers.size());
+            layers.emplace_back();
+            layers.back().layer_nr = event.layer_nr;
+        }
+        LayerCost& layer = (found == layer_indices.end()) ? layers.back() : layers[found->second];
+        const double time = (event.cpu_time > 0) ? event.cpu_time : event.wall_time;
+        layer.time += time;
+
+        std::vector<std::pair<std::string, double>>::iterator stage = layer.stage_times.begin();
+        while (stage != layer.stage_times.end() && stage->first != event.name)
+        {
+            stage++;
+        }
+        if (stage == layer.stage_times.end())
+        {
+            layer.stage_times.emplace_back(event.name, 0);
+            stage = layer.stage_times.end() - 1;
+        }
+        stage->second += time;
+
+        for (const std::pair<const char*, int64_t>& counter : event.counters)
+        {
+            std::vector<std::pair<std::string, int64_t>>::iterator total = layer.counters.begin();
+            while (total != layer.counters.end() && total->first != counter.first)
+            {
+                total++;
+            }
+            if (total == layer.counters.end())
+            {
+                layer.counters.emplace_back(counter.first, 0);
+                total = layer.counters.end() - 1;
+            }
+            total->second += counter.second;
+        }
+    }
+
+    //Ties go to the lowest layer, so that the report doesn't depend on the order of the events.
+    const size_t kept_count = std::min(layer_count, layers.size());
+    std::partial_sort(layers.begin(), layers.begin() + kept_count, layers.end(), [](const LayerCost& a, const LayerCost& b)
+    {
+        return a.time > b.time || (a.time == b.time && a.layer_nr < b.layer_nr);
+    });
+    layers.resize(kept_count);
+    return layers;
+}
+
+void SlowestLayersSink::write(const std::vector<Instrumentation::Event>& events)
+{
+    const std::vector<LayerCost> layers = getSlowestLayers(events, layer_count);
+    if (layers.empty())
+    {
+        return;
+    }
+    log("The %zu slowest layers:\n", layers.size());
+    for (const LayerCost& layer : layers)
+    {
+        std::string stages;
+        for (const std::pair<std::string, double>& stage : layer.stage_times)
+        {
+            char stage_time[64];
+            snprintf(stage_time, sizeof(stage_time), " %.2fms", stage.second * 1000.0);
+            stages += " " + stage.first + stage_time;
+        }
+        std::string counters;
+        for (const std::pair<std::string, int64_t>& counter : layer.counters)
+        {
+            counters += " " + counter.first + " " + std::to_string(counter.second);
+        }
+        log("  Layer %i took %.2fms:%s;%s\n", layer.layer_nr, layer.time * 1000.0, stages.c_str(), counters.c_str());
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,248 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_INSTRUMENTATION_H
+#define UTILS_INSTRUMENTATION_H
+
+#include <atomic>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <utility> //For pair.
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+class InstrumentationSink;
+
+/*!
+ * \brief Collects the wall-clock and CPU time of the stages of a slice and
+ * counters of the work done in them, so that performance regressions can be
+ * found in production without attaching a profiler.
+ *
+ * Stages are timed with \ref ScopedTimer. Nothing is recorded while no sinks
+ * are attached, so the timers cost next to nothing in normal slices. The
+ * recorded events are handed to the sinks by \ref Instrumentation::finish.
+ *
+ * Every thread records its events in a buffer of its own, so that threads
+ * don't wait for each other when many small tasks are timed. Only the first
+ * event of a thread takes a lock, to register the buffer.
+ *
+ * Without the CMake option ENABLE_INSTRUMENTATION the timers are compiled
+ * out and sinks are ignored.
+ */
+class Instrumentation : NoCopy
+{
+public:
+    /*!
+     * \brief One run of a stage on one thread.
+     */
+    struct Event
+    {
+        const char* name; //!< The name of the stage. Only letters, digits and underscores, so that the sinks don't need to escape it.
+        int layer_nr; //!< The layer that the stage processed, or -1 if it isn't about a single layer.
+        size_t thread_nr; //!< The thread that ran the stage, numbered in the order in which the threads first recorded a stage.
+        double start; //!< When the stage started, in seconds since recording started.
+        double wall_time; //!< How long the stage took, in seconds.
+        double cpu_time; //!< How much CPU time the thread used in the stage, in seconds. Zero where this isn't available.
+        std::vector<std::pair<const char*, int64_t>> counters; //!< The work counted in the stage, excluding that of the stages timed within it.
+    };
+
+    static Instrumentation& getInstance();
+
+    /*!
+     * \brief Attach a sink and start recording, if not recording yet.
+     * \param sink The sink to hand the events to when finishing.
+     */
+    void addSink(std::unique_ptr<InstrumentationSink> sink);
+
+    /*!
+     * \brief Whether events are being recorded.
+     */
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief The time since recording started, in seconds.
+     */
+    double getTime() const;
+
+    /*!
+     * \brief Store an event in the buffer of the calling thread. This may be
+     * called from any thread.
+     */
+    void record(Event&& event);
+
+    /*!
+     * \brief Hand all recorded events to the sinks, then detach the sinks and
+     * stop recording.
+     *
+     * This must only be called while no other thread is recording. Does
+     * nothing if nothing is being recorded.
+     */
+    void finish();
+
+private:
+    Instrumentation();
+
+    std::atomic<bool> enabled; //!< Whether any sinks are attached.
+    double start_time; //!< When recording started, as given by \ref getTime in gettime.h.
+    std::mutex mutex; //!< Protects the list of buffers and the sinks.
+    std::vector<std::unique_ptr<std::vector<Event>>> thread_events; //!< For each thread that recorded anything, by thread number, the events it recorded since the last finish.
+    std::vector<std::unique_ptr<InstrumentationSink>> sinks; //!< Where the events go when finishing.
+};
+
+/*!
+ * \brief Times a stage from its construction until it goes out of scope.
+ *
+ * Work counted with \ref ScopedTimer::count is attributed to the innermost
+ * timer of the calling thread. Tasks that run on other threads are only
+ * accounted for if they time themselves.
+ */
+class ScopedTimer : NoCopy
+{
+public:
+#ifdef INSTRUMENTATION
+    /*!
+     * \brief Start timing a stage, if instrumentation is enabled.
+     * \param name The name of the stage. See \ref Instrumentation::Event::name.
+     * \param layer_nr The layer that the stage processes, if any.
+     */
+    ScopedTimer(const char* name, const int layer_nr = -1);
+
+    /*!
+     * \brief Stop timing and record the stage.
+     */
+    ~ScopedTimer();
+
+    /*!
+     * \brief Add to a counter of the innermost stage that is being timed on
+     * the calling thread, if any.
+     * \param counter The name of the counter, which must be a string literal
+     * since counters are told apart by their address.
+     * \param amount How much to add.
+     */
+    static void count(const char* counter, const int64_t amount = 1);
+
+private:
+    std::unique_ptr<Instrumentation::Event> event; //!< The event being timed, or nullptr if instrumentation was disabled.
+    ScopedTimer* outer_timer; //!< The timer that was the innermost one of this thread before this one.
+    double start_cpu_time; //!< The CPU time of the thread when the stage started.
+#else //INSTRUMENTATION
+    ScopedTimer(const char*, const int = -1)
+    {
+    }
+
+    static void count(const char*, const int64_t = 1)
+    {
+    }
+#endif //INSTRUMENTATION
+};
+
+/*!
+ * \brief Time the rest of the enclosing function as a stage named after the
+ * function.
+ *
+ * The work counted within it, like the operations of Clipper, is then told
+ * apart from that of the stage around it. The stage isn't about a single
+ * layer. Don't use it in lambdas, which are all named "operator()".
+ */
+#define TIME_FUNCTION() const ScopedTimer function_timer(__func__)
+
+/*!
+ * \brief Somewhere that the recorded events go at the end of a slice.
+ */
+class InstrumentationSink
+{
+public:
+    virtual ~InstrumentationSink()
+    {
+    }
+
+    /*!
+     * \brief Process the events of a slice.
+     * \param events The events, in the order in which the stages ended.
+     */
+    virtual void write(const std::vector<Instrumentation::Event>& events) = 0;
+};
+
+/*!
+ * \brief Writes the events to a file in the trace event format of Chrome,
+ * which chrome://tracing and Perfetto can show as a timeline per thread.
+ */
+class ChromeTraceSink : public InstrumentationSink
+{
+public:
+    ChromeTraceSink(const std::string& filename);
+
+    void write(const std::vector<Instrumentation::Event>& events) override;
+
+private:
+    std::string filename; //!< The file to write to.
+};
+
+/*!
+ * \brief Writes a JSON summary to a file, with the number of runs, the total
+ * wall-clock and CPU time and the total of each counter of every stage.
+ */
+class InstrumentationSummarySink : public InstrumentationSink
+{
+public:
+    InstrumentationSummarySink(const std::string& filename);
+
+    void write(const std::vector<Instrumentation::Event>& events) override;
+
+private:
+    std::string filename; //!< The file to write to.
+};
+
+/*!
+ * \brief Logs the layers that took the longest, with the time of every stage
+ * in them and the total of each counter, to find pathological layers.
+ *
+ * Only the stages that process a single layer are taken into account. Their
+ * time is their CPU time where available, since the wall-clock time of a stage
+ * also includes the time that its thread was waiting for a core.
+ */
+class SlowestLayersSink : public InstrumentationSink
+{
+public:
+    /*!
+     * \param layer_count How many layers to log.
+     */
+    SlowestLayersSink(const size_t layer_count);
+
+    void write(const std::vector<Instrumentation::Event>& events) override;
+
+    /*!
+     * \brief The cost of one layer, summed over the runs of its stages.
+     */
+    struct LayerCost
+    {
+        int layer_nr;
+        double time = 0; //!< The total time of the stages, in seconds.
+        std::vector<std::pair<std::string, double>> stage_times; //!< The time of each stage, in the order in which they first ended.
+        std::vector<std::pair<std::string, int64_t>> counters; //!< The total of each counter, in the order in which they were first counted.
+    };
+
+    /*!
+     * \brief Sum the costs of the stages per layer.
+     * \param events The events of a slice.
+     * \param layer_count How many layers to return.
+     * \return The layers that took the longest, the slowest first.
+     */
+    static std::vector<LayerCost> getSlowestLayers(const std::vector<Instrumentation::Event>& events, const size_t layer_count);
+
+private:
+    size_t layer_count; //!< How many layers to log.
+};
+
+} //namespace cura
+
+#endif //UTILS_INSTRUMENTATION_H
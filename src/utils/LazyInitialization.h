@@ -3,6 +3,9 @@
 #define UTILS_LAZY_INITIALIZATION_H
 
 #include <functional> // bind, function
+#include <map>
+#include <memory> // unique_ptr
+#include <mutex> // call_once, mutex
 
 #include "optional.h"
 
@@ -125,5 +128,78 @@ private:
     std::function<T* ()> constructor;
 };
 
+/*!
+ * A map of lazily initialized values, which may be used from multiple threads
+ * at the same time.
+ *
+ * The value of each key is initialized only once, even if multiple threads ask
+ * for it at the same time: the other threads wait for the first one to finish.
+ * The map is only locked to look up the key, not while initializing, so
+ * threads that ask for different keys don't wait for each other. References
+ * to the values stay valid as long as the map exists.
+ *
+ * Copying the map doesn't copy the values, since they can be initialized again
+ * when they are needed.
+ *
+ * \tparam K The type of the keys.
+ * \tparam V The type of the values to initialize lazily.
+ */
+template <typename K, typename V>
+class LazyInitializationMap
+{
+public:
+    LazyInitializationMap()
+    { }
+
+    LazyInitializationMap(const LazyInitializationMap<K, V>&) //!< copy constructor
+    { }
+
+    LazyInitializationMap<K, V>& operator=(const LazyInitializationMap<K, V>&)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.clear();
+        return *this;
+    }
+
+    /*!
+     * Get the value of a key, initializing it if this is the first time it's
+     * requested.
+     *
+     * \param key The key to get the value of.
+     * \param initialize Computes the value of the key. Only called if the value
+     * isn't initialized yet.
+     * \return The value of the key.
+     */
+    const V& get(const K& key, const std::function<V ()>& initialize)
+    {
+        LazyValue* lazy_value;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::unique_ptr<LazyValue>& slot = values[key];
+            if (!slot)
+            {
+                slot.reset(new LazyValue());
+            }
+            lazy_value = slot.get();
+        }
+        std::call_once(lazy_value->once, [lazy_value, &initialize]()
+            {
+                lazy_value->value = initialize();
+            }
+        );
+        return lazy_value->value;
+    }
+
+private:
+    struct LazyValue
+    {
+        std::once_flag once; //!< Makes sure that the value is initialized only once.
+        V value; //!< The value, once it's initialized.
+    };
+
+    std::mutex mutex; //!< Protects the map while keys are looked up or added.
+    std::map<K, std::unique_ptr<LazyValue>> values; //!< The value of each key that was requested so far.
+};
+
 }//namespace cura
 #endif // UTILS_LAZY_INITIALIZATION_H
@@ -185,15 +185,12 @@ coord_t LinearAlg2D::getDist2FromLine(const Point& p, const Point& a, const Poin
     const Point vab = b - a;
     const Point vap = p - a;
     const coord_t ab_size2 = vSize2(vab);
-    const coord_t ap_size2 = vSize2(vap);
     if(ab_size2 == 0) //Line of 0 length. Assume it's a line perpendicular to the direction to p.
     {
-        return ap_size2;
+        return vSize2(vap);
     }
-    const coord_t dott = dot(vab, vap);
-    const coord_t ax_size2 = dott * dott / vSize2(vab);
-    const coord_t px_size2 = std::max(coord_t(0), ap_size2 - ax_size2);
-    return px_size2;
+    const coord_t cross = vab.X * vap.Y - vab.Y * vap.X; //The length of px, times the length of ab.
+    return mulDiv(cross, cross, ab_size2);
 }
 
 } // namespace cura
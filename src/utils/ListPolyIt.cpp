@@ -24,6 +24,7 @@ void ListPolyIt::convertPolygonToList(ConstPolygonRef poly, ListPolygon& result)
 #ifdef DEBUG
     Point last = poly.back();
 #endif // DEBUG
+    result.reserve(result.size() + poly.size());
     for (const Point& p : poly)
     {
         result.push_back(p);
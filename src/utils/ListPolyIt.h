@@ -5,10 +5,9 @@
 #define UTILS_LIST_POLY_IT_H
 
 #include <vector>
-#include <list>
-
 
 #include "IntPoint.h"
+#include "ListPolygon.h"
 #include "polygon.h"
 
 
@@ -0,0 +1,253 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_LIST_POLYGON_H
+#define UTILS_LIST_POLYGON_H
+
+#include <cassert>
+#include <cstddef> //For size_t and ptrdiff_t.
+#include <iterator> //For bidirectional_iterator_tag.
+#include <type_traits> //For conditional.
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A polygon represented by a doubly linked list, so that points can be
+ * inserted and removed without moving the other points.
+ *
+ * It behaves like an ``std::list<Point>``: iterators stay valid when other
+ * points are inserted or removed. The nodes of the list are kept in a single
+ * vector and link to each other by their index, rather than each being
+ * allocated separately. The nodes of removed points are reused for the points
+ * inserted after them, so that the vector only grows to the largest number of
+ * points the polygon had.
+ *
+ * References to the points are invalidated when a point is inserted, like in
+ * a vector. Iterators are not.
+ */
+class ListPolygon
+{
+    /*!
+     * \brief A point and the indices of the nodes before and after it.
+     */
+    struct Node
+    {
+        Point point;
+        size_t prev;
+        size_t next;
+    };
+
+    /*!
+     * \brief An iterator over the points, which keeps the index of its node
+     * rather than a pointer to it.
+     * \tparam is_const Whether the points can't be changed through it.
+     */
+    template<bool is_const>
+    class Iterator
+    {
+        friend class ListPolygon;
+        typedef typename std::conditional<is_const, const ListPolygon, ListPolygon>::type Container;
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Point value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<is_const, const Point*, Point*>::type pointer;
+        typedef typename std::conditional<is_const, const Point&, Point&>::type reference;
+
+        Iterator()
+        : polygon(nullptr)
+        , node_idx(0)
+        {
+        }
+
+        //! A mutable iterator can be turned into a const one.
+        Iterator(const Iterator<false>& other)
+        : polygon(other.polygon)
+        , node_idx(other.node_idx)
+        {
+        }
+
+        reference operator*() const
+        {
+            return polygon->nodes[node_idx].point;
+        }
+
+        pointer operator->() const
+        {
+            return &polygon->nodes[node_idx].point;
+        }
+
+        Iterator& operator++()
+        {
+            node_idx = polygon->nodes[node_idx].next;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator result(*this);
+            ++*this;
+            return result;
+        }
+
+        Iterator& operator--()
+        {
+            node_idx = polygon->nodes[node_idx].prev;
+            return *this;
+        }
+
+        Iterator operator--(int)
+        {
+            Iterator result(*this);
+            --*this;
+            return result;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return node_idx == other.node_idx && polygon == other.polygon;
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator(Container* polygon, const size_t node_idx)
+        : polygon(polygon)
+        , node_idx(node_idx)
+        {
+        }
+
+        Container* polygon; //!< The polygon that the node is in.
+        size_t node_idx; //!< The index of the node in \ref ListPolygon::nodes.
+
+        friend class Iterator<!is_const>;
+    };
+
+public:
+    typedef Point value_type;
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    ListPolygon()
+    : nodes(1, Node{Point(0, 0), END, END})
+    , first_free(END)
+    , point_count(0)
+    {
+    }
+
+    iterator begin()
+    {
+        return iterator(this, nodes[END].next);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, nodes[END].next);
+    }
+
+    iterator end()
+    {
+        return iterator(this, END);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, END);
+    }
+
+    size_t size() const
+    {
+        return point_count;
+    }
+
+    bool empty() const
+    {
+        return point_count == 0;
+    }
+
+    /*!
+     * \brief Make room for a number of points, so that adding them doesn't
+     * need to allocate memory.
+     */
+    void reserve(const size_t size)
+    {
+        nodes.reserve(size + 1);
+    }
+
+    void push_back(const Point& point)
+    {
+        insert(end(), point);
+    }
+
+    /*!
+     * \brief Insert a point before the point of an iterator.
+     * \return An iterator to the inserted point.
+     */
+    iterator insert(const const_iterator before, const Point& point)
+    {
+        assert(before.polygon == this);
+        size_t node_idx = first_free;
+        if (node_idx == END)
+        {
+            node_idx = nodes.size();
+            nodes.emplace_back();
+        }
+        else
+        {
+            first_free = nodes[node_idx].next;
+        }
+        Node& node = nodes[node_idx];
+        node.point = point;
+        node.next = before.node_idx;
+        node.prev = nodes[before.node_idx].prev;
+        nodes[node.prev].next = node_idx;
+        nodes[node.next].prev = node_idx;
+        point_count++;
+        return iterator(this, node_idx);
+    }
+
+    /*!
+     * \brief Remove the point of an iterator.
+     * \return An iterator to the point after it.
+     */
+    iterator erase(const const_iterator position)
+    {
+        assert(position.polygon == this && position.node_idx != END);
+        Node& node = nodes[position.node_idx];
+        const size_t next = node.next;
+        nodes[node.prev].next = next;
+        nodes[next].prev = node.prev;
+        node.next = first_free; //The node of a removed point is the first to be reused.
+        first_free = position.node_idx;
+        point_count--;
+        return iterator(this, next);
+    }
+
+    void clear()
+    {
+        nodes.resize(1);
+        nodes[END].prev = END;
+        nodes[END].next = END;
+        first_free = END;
+        point_count = 0;
+    }
+
+private:
+    //! The node that comes after the last point and before the first point, which the end iterator refers to.
+    static constexpr size_t END = 0;
+
+    std::vector<Node> nodes; //!< The nodes of the points, and of the removed points, after the node of \ref ListPolygon::END.
+    size_t first_free; //!< The first node of a removed point, which links to the next one, or \ref ListPolygon::END if there is none.
+    size_t point_count; //!< The number of points in the polygon.
+};
+
+} //namespace cura
+
+#endif //UTILS_LIST_POLYGON_H
@@ -0,0 +1,107 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <fstream>
+#ifdef __linux__
+#include <unistd.h> //For sysconf.
+#endif
+
+#include "Instrumentation.h"
+#include "MemoryBudget.h"
+
+namespace cura
+{
+
+namespace
+{
+
+//The names of the counters of the accounts when recording them, in the order of MemoryAccount.
+const char* const account_names[] = {"mesh_layers_bytes", "support_layers_bytes", "layer_outlines_bytes", "model_volumes_bytes", "layer_plans_bytes", "compressed_layers_bytes"};
+static_assert(sizeof(account_names) / sizeof(account_names[0]) == static_cast<size_t>(MemoryAccount::COUNT), "Every account needs a name.");
+
+} //Anonymous namespace.
+
+MemoryBudget& MemoryBudget::getInstance()
+{
+    static MemoryBudget instance;
+    return instance;
+}
+
+MemoryBudget::MemoryBudget()
+: limit(0)
+, peak(0)
+{
+    for (std::atomic<size_t>& account_usage : usage)
+    {
+        account_usage = 0;
+    }
+}
+
+void MemoryBudget::setLimit(const size_t limit)
+{
+    this->limit = limit;
+}
+
+bool MemoryBudget::isTracking() const
+{
+    return limit.load(std::memory_order_relaxed) > 0 || Instrumentation::getInstance().isEnabled();
+}
+
+size_t MemoryBudget::getTotal() const
+{
+    size_t total = 0;
+    for (const std::atomic<size_t>& account_usage : usage)
+    {
+        total += account_usage.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MemoryBudget::reset()
+{
+    limit = 0;
+    set(MemoryAccount::MESH_LAYERS, 0);
+    set(MemoryAccount::SUPPORT_LAYERS, 0);
+    peak = getTotal();
+}
+
+void MemoryBudget::updatePeak()
+{
+    const size_t total = getTotal();
+    size_t previous_peak = peak.load(std::memory_order_relaxed);
+    while (total > previous_peak && !peak.compare_exchange_weak(previous_peak, total, std::memory_order_relaxed))
+    {
+    }
+}
+
+void MemoryBudget::record(const char* stage_name) const
+{
+    if (!Instrumentation::getInstance().isEnabled())
+    {
+        return;
+    }
+    const ScopedTimer timer(stage_name);
+    for (size_t account = 0; account < usage.size(); account++)
+    {
+        ScopedTimer::count(account_names[account], usage[account].load(std::memory_order_relaxed));
+    }
+    ScopedTimer::count("peak_tracked_bytes", getPeakTotal());
+    ScopedTimer::count("resident_bytes", getResidentMemory());
+}
+
+size_t MemoryBudget::getResidentMemory()
+{
+#ifdef __linux__
+    //The second number is the number of pages in RAM.
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (statm >> total_pages >> resident_pages)
+    {
+        return resident_pages * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
+
+} //namespace cura
@@ -0,0 +1,156 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_MEMORY_BUDGET_H
+#define UTILS_MEMORY_BUDGET_H
+
+#include <array>
+#include <atomic>
+#include <stddef.h> //For size_t.
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief The parts of the slice data that memory use is attributed to.
+ */
+enum class MemoryAccount
+{
+    MESH_LAYERS, //!< The layers of all meshes in the slice data storage.
+    SUPPORT_LAYERS, //!< The support layers in the slice data storage.
+    LAYER_OUTLINES, //!< The cached layer outlines, which combing looks at.
+    MODEL_VOLUMES, //!< The cached volumes that tree support avoids.
+    LAYER_PLANS, //!< The layer plans that are being planned or waiting to be written.
+    COMPRESSED_LAYERS, //!< The layers that are kept compressed in memory until their g-code is generated, see LayerSpill.
+    COUNT //!< The number of accounts.
+};
+
+/*!
+ * \brief Keeps track of how much memory the large parts of the slice data use,
+ * with an optional soft limit on their total.
+ *
+ * The accounts of data that can be recomputed, like caches, are kept up to
+ * date when their data changes. The accounts of the slice data storage are
+ * measured at the boundaries of the stages of a slice, see \ref measure. When
+ * the total exceeds the limit, the caches evict more than their own capacity
+ * requires, to stay within the limit if possible. Data that can't be evicted
+ * is never dropped, so the limit is soft.
+ *
+ * Memory is only tracked while there is a limit or while instrumentation is
+ * enabled, so that measuring costs nothing in normal slices.
+ */
+class MemoryBudget : NoCopy
+{
+public:
+    static MemoryBudget& getInstance();
+
+    /*!
+     * \brief Set the soft limit on the total of all accounts.
+     * \param limit The limit in bytes, or 0 for no limit.
+     */
+    void setLimit(const size_t limit);
+
+    /*!
+     * \brief Whether memory use is being tracked.
+     */
+    bool isTracking() const;
+
+    /*!
+     * \brief Whether the total of all accounts exceeds the limit, if any.
+     */
+    bool isExceeded() const
+    {
+        const size_t current_limit = limit.load(std::memory_order_relaxed);
+        return current_limit > 0 && getTotal() > current_limit;
+    }
+
+    /*!
+     * \brief Add memory to an account. This may be called from any thread.
+     */
+    void add(const MemoryAccount account, const size_t bytes)
+    {
+        usage[static_cast<size_t>(account)].fetch_add(bytes, std::memory_order_relaxed);
+        updatePeak();
+    }
+
+    /*!
+     * \brief Remove memory from an account that was added to it before. This
+     * may be called from any thread.
+     */
+    void subtract(const MemoryAccount account, const size_t bytes)
+    {
+        usage[static_cast<size_t>(account)].fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Replace the memory of an account by a new measurement.
+     */
+    void set(const MemoryAccount account, const size_t bytes)
+    {
+        usage[static_cast<size_t>(account)].store(bytes, std::memory_order_relaxed);
+        updatePeak();
+    }
+
+    /*!
+     * \brief The memory of an account, in bytes.
+     */
+    size_t get(const MemoryAccount account) const
+    {
+        return usage[static_cast<size_t>(account)].load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief The total memory of all accounts, in bytes.
+     */
+    size_t getTotal() const;
+
+    /*!
+     * \brief The highest total of all accounts since the last reset, in bytes.
+     */
+    size_t getPeakTotal() const
+    {
+        return peak.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Remove the limit and forget the measured accounts and the peak,
+     * at the end of a mesh group.
+     *
+     * The accounts that are kept up to date by the data itself are left
+     * alone, since that data may outlive the mesh group.
+     */
+    void reset();
+
+    /*!
+     * \brief Record the memory of all accounts and of the whole process as a
+     * stage of the instrumentation, so that it's reported with the stage
+     * timings.
+     * \param stage_name The name of the stage. See
+     * \ref Instrumentation::Event::name.
+     */
+    void record(const char* stage_name) const;
+
+    /*!
+     * \brief The memory that the process currently occupies in RAM, in bytes,
+     * or 0 if the platform doesn't tell.
+     */
+    static size_t getResidentMemory();
+
+private:
+    MemoryBudget();
+
+    /*!
+     * \brief Raise the peak to the current total if that is higher.
+     */
+    void updatePeak();
+
+    std::atomic<size_t> limit; //!< The soft limit on the total of the accounts, or 0 if there is no limit.
+    std::array<std::atomic<size_t>, static_cast<size_t>(MemoryAccount::COUNT)> usage; //!< The memory of each account, in bytes.
+    std::atomic<size_t> peak; //!< The highest total of the accounts since the last reset.
+};
+
+} //namespace cura
+
+#endif //UTILS_MEMORY_BUDGET_H
@@ -1,7 +1,11 @@
 //Copyright (c) 2017 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <functional>
+#include <queue> //For priority_queue.
+
 #include "MinimumSpanningTree.h"
+#include "PointKDTree.h"
 
 namespace cura
 {
@@ -43,63 +47,55 @@ const std::unordered_map<Point, std::vector<MinimumSpanningTree::Edge>> MinimumS
         return result; //If there's only one vertex, we can't go creating any edges.
     }
 
-    std::unordered_map<Point*, coord_t> smallest_distance; //The shortest distance to the current tree.
-    smallest_distance.reserve(vertices_list.size());
-    std::unordered_map<Point*, Point*> smallest_distance_to; //Which point the shortest distance goes towards.
-    smallest_distance_to.reserve(vertices_list.size());
+    //Instead of updating the distance of every vertex outside of the tree to the tree whenever a vertex is added, which is O(V*V),
+    //each vertex in the tree remembers the vertex outside of the tree nearest to it, found with a k-d tree of the vertices outside of the tree.
+    //The shortest of those connections is the next edge of the tree. If its other end was added to the tree in the meantime, the nearest
+    //vertex is looked up again. Only a few vertices can have the same nearest vertex, so this takes O(V*log(V)) on average.
+    std::vector<std::pair<Point, unsigned int>> kd_tree_points;
+    kd_tree_points.reserve(vertices_list.size());
     for (size_t vertex_index = 0; vertex_index < vertices_list.size(); vertex_index++)
     {
-        if (vertices_list[vertex_index] == first_point)
-        {
-            continue;
-        }
-        smallest_distance[&vertices_list[vertex_index]] = vSize2(vertices_list[vertex_index] - first_point);
-        smallest_distance_to[&vertices_list[vertex_index]] = &vertices_list[0];
+        kd_tree_points.emplace_back(vertices_list[vertex_index], vertex_index);
     }
+    PointKDTree outside_tree(kd_tree_points);
+    std::vector<bool> is_in_tree(vertices_list.size(), false);
 
-    while(result.size() < vertices_list.size()) //All of the vertices need to be in the tree at the end.
+    typedef std::pair<coord_t, std::pair<size_t, unsigned int>> Candidate; //Squared length, vertex in the tree and the vertex outside of the tree nearest to it.
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates; //Shortest first.
+    const std::function<void (const size_t)> find_nearest_outside = [&](const size_t vertex_index)
     {
-        //Choose the closest vertex to connect to that is not yet in the tree.
-        //This search is O(V) right now, which can be made down to O(log(V)). This reduces the overall time complexity from O(V*V) to O(V*log(E)).
-        //However that requires an implementation of a heap that supports the decreaseKey operation, which is not in the std library.
-        //TODO: Implement this?
-        Point* closest_point = nullptr;
-        coord_t closest_distance = std::numeric_limits<coord_t>::max();
-        for(std::pair<Point*, coord_t> point_and_distance : smallest_distance)
+        unsigned int nearest_index;
+        if (outside_tree.findNearest(vertices_list[vertex_index], nearest_index))
         {
-            if (point_and_distance.second < closest_distance) //This one's closer!
-            {
-                closest_point = point_and_distance.first;
-                closest_distance = point_and_distance.second;
-            }
+            candidates.emplace(vSize2(vertices_list[nearest_index] - vertices_list[vertex_index]), std::make_pair(vertex_index, nearest_index));
         }
+    };
+    const std::function<void (const size_t)> add_to_tree = [&](const size_t vertex_index)
+    {
+        is_in_tree[vertex_index] = true;
+        outside_tree.remove(vertex_index);
+        find_nearest_outside(vertex_index);
+    };
+    add_to_tree(0);
 
-        //Add this point to the graph and remove it from the candidates.
-        Point closest_point_local = *closest_point;
-        Point other_end = *smallest_distance_to[closest_point];
-        if (result.find(closest_point_local) == result.end())
-        {
-            result[closest_point_local] = std::vector<Edge>();
-        }
-        result[closest_point_local].emplace_back(closest_point_local, other_end);
-        if (result.find(other_end) == result.end())
+    while (!candidates.empty()) //All of the vertices need to be in the tree at the end.
+    {
+        const size_t tree_index = candidates.top().second.first;
+        const unsigned int closest_index = candidates.top().second.second;
+        candidates.pop();
+        if (is_in_tree[closest_index]) //Was added by another edge already, so look for the next nearest one.
         {
-            result[other_end] = std::vector<Edge>();
+            find_nearest_outside(tree_index);
+            continue;
         }
-        result[other_end].emplace_back(other_end, closest_point_local);
-        smallest_distance.erase(closest_point); //Remove it so we don't check for these points again.
-        smallest_distance_to.erase(closest_point);
 
-        //Update the distances of all points that are not in the graph.
-        for (std::pair<Point*, coord_t> point_and_distance : smallest_distance)
-        {
-            coord_t new_distance = vSize2(*closest_point - *point_and_distance.first);
-            if (new_distance < point_and_distance.second) //New point is closer.
-            {
-                smallest_distance[point_and_distance.first] = new_distance;
-                smallest_distance_to[point_and_distance.first] = closest_point;
-            }
-        }
+        //Add this point to the graph.
+        const Point closest_point = vertices_list[closest_index];
+        const Point other_end = vertices_list[tree_index];
+        result[closest_point].emplace_back(closest_point, other_end);
+        result[other_end].emplace_back(other_end, closest_point);
+        add_to_tree(closest_index);
+        find_nearest_outside(tree_index); //Its nearest vertex is in the tree now.
     }
 
     return result;
@@ -17,6 +17,8 @@ namespace cura
  * \brief Implements Prim's algorithm to compute Minimum Spanning Trees (MST).
  *
  * The minimum spanning tree is always computed from a clique of vertices.
+ * The vertex nearest to the tree is found with a k-d tree, so that the tree is
+ * built in O(V*log(V)) on average rather than O(V*V).
  */
 class MinimumSpanningTree
 {
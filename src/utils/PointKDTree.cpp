@@ -0,0 +1,174 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For nth_element.
+#include <limits>
+
+#include "PointKDTree.h"
+
+namespace cura
+{
+
+PointKDTree::PointKDTree(const std::vector<std::pair<Point, unsigned int>>& points)
+{
+    nodes.reserve(points.size());
+    unsigned int item_count = 0;
+    for (const std::pair<Point, unsigned int>& point : points)
+    {
+        nodes.push_back({point.first, point.second, false, 0});
+        item_count = std::max(item_count, point.second + 1);
+    }
+    build(0, nodes.size(), 0);
+
+    nodes_of_item.resize(item_count);
+    for (size_t node_idx = 0; node_idx < nodes.size(); node_idx++)
+    {
+        nodes_of_item[nodes[node_idx].item_idx].push_back(node_idx);
+    }
+}
+
+void PointKDTree::build(const size_t begin, const size_t end, const size_t depth)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    const size_t middle = (begin + end) / 2;
+    if (depth % 2 == 0)
+    {
+        std::nth_element(nodes.begin() + begin, nodes.begin() + middle, nodes.begin() + end, [](const Node& a, const Node& b) { return a.location.X < b.location.X; });
+    }
+    else
+    {
+        std::nth_element(nodes.begin() + begin, nodes.begin() + middle, nodes.begin() + end, [](const Node& a, const Node& b) { return a.location.Y < b.location.Y; });
+    }
+    nodes[middle].remaining = end - begin;
+    build(begin, middle, depth + 1);
+    build(middle + 1, end, depth + 1);
+}
+
+void PointKDTree::remove(const unsigned int item_idx)
+{
+    if (item_idx >= nodes_of_item.size())
+    {
+        return;
+    }
+    for (const size_t node_idx : nodes_of_item[item_idx])
+    {
+        if (nodes[node_idx].removed)
+        {
+            continue;
+        }
+        nodes[node_idx].removed = true;
+
+        // update the counts of the subtrees the node is in, from the root down to the node itself
+        size_t begin = 0;
+        size_t end = nodes.size();
+        while (true)
+        {
+            const size_t middle = (begin + end) / 2;
+            nodes[middle].remaining--;
+            if (node_idx == middle)
+            {
+                break;
+            }
+            if (node_idx < middle)
+            {
+                end = middle;
+            }
+            else
+            {
+                begin = middle + 1;
+            }
+        }
+    }
+}
+
+bool PointKDTree::findNearest(const Point from, unsigned int& item_idx) const
+{
+    size_t best_node = nodes.size();
+    coord_t best_dist2 = std::numeric_limits<coord_t>::max();
+    findNearest(0, nodes.size(), 0, from, best_node, best_dist2);
+    if (best_node == nodes.size())
+    {
+        return false;
+    }
+    item_idx = nodes[best_node].item_idx;
+    return true;
+}
+
+void PointKDTree::findNearest(const size_t begin, const size_t end, const size_t depth, const Point from, size_t& best_node, coord_t& best_dist2) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    const size_t middle = (begin + end) / 2;
+    const Node& node = nodes[middle];
+    if (node.remaining == 0)
+    {
+        return;
+    }
+    if (!node.removed)
+    {
+        const coord_t dist2 = vSize2(node.location - from);
+        if (dist2 < best_dist2)
+        {
+            best_node = middle;
+            best_dist2 = dist2;
+        }
+    }
+
+    const coord_t split_dist = (depth % 2 == 0) ? from.X - node.location.X : from.Y - node.location.Y;
+    if (split_dist < 0)
+    { // first look on the side of the split where the location is
+        findNearest(begin, middle, depth + 1, from, best_node, best_dist2);
+        if (split_dist * split_dist < best_dist2)
+        {
+            findNearest(middle + 1, end, depth + 1, from, best_node, best_dist2);
+        }
+    }
+    else
+    {
+        findNearest(middle + 1, end, depth + 1, from, best_node, best_dist2);
+        if (split_dist * split_dist < best_dist2)
+        {
+            findNearest(begin, middle, depth + 1, from, best_node, best_dist2);
+        }
+    }
+}
+
+void PointKDTree::findWithin(const Point from, const coord_t radius, std::vector<unsigned int>& item_indices) const
+{
+    findWithin(0, nodes.size(), 0, from, radius, item_indices);
+}
+
+void PointKDTree::findWithin(const size_t begin, const size_t end, const size_t depth, const Point from, const coord_t radius, std::vector<unsigned int>& item_indices) const
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    const size_t middle = (begin + end) / 2;
+    const Node& node = nodes[middle];
+    if (node.remaining == 0)
+    {
+        return;
+    }
+    if (!node.removed && vSize2(node.location - from) <= radius * radius)
+    {
+        item_indices.push_back(node.item_idx);
+    }
+
+    const coord_t split_dist = (depth % 2 == 0) ? from.X - node.location.X : from.Y - node.location.Y;
+    if (split_dist <= radius)
+    {
+        findWithin(begin, middle, depth + 1, from, radius, item_indices);
+    }
+    if (split_dist >= -radius)
+    {
+        findWithin(middle + 1, end, depth + 1, from, radius, item_indices);
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,118 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_POINT_KD_TREE_H
+#define UTILS_POINT_KD_TREE_H
+
+#include <utility> //For pair.
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * \brief A k-d tree of points which finds the points nearest to a location,
+ * while points are being removed from it.
+ *
+ * Meant for greedy orderings, which repeatedly look for the nearest item that
+ * wasn't picked yet. Every point belongs to an item, and an item may have
+ * multiple points, such as the two ends of a line. Removing an item removes
+ * all of its points. Each node keeps track of how many points are left in its
+ * subtree, so that searches skip the parts of the tree that were emptied.
+ */
+class PointKDTree
+{
+public:
+    /*!
+     * \brief Build a tree of points.
+     * \param points The points, each with the index of the item it belongs
+     * to.
+     */
+    PointKDTree(const std::vector<std::pair<Point, unsigned int>>& points);
+
+    /*!
+     * \brief Remove all points of an item.
+     *
+     * Removing an item that has no points left in the tree does nothing.
+     * \param item_idx The index of the item.
+     */
+    void remove(const unsigned int item_idx);
+
+    /*!
+     * \brief Find the item with the point nearest to a location.
+     * \param from The location to search around.
+     * \param[out] item_idx The index of the item with the nearest point.
+     * \return Whether there are any points left in the tree.
+     */
+    bool findNearest(const Point from, unsigned int& item_idx) const;
+
+    /*!
+     * \brief Find the items with points within some distance of a location.
+     *
+     * An item is reported once for each of its points within the distance,
+     * in no particular order.
+     * \param from The location to search around.
+     * \param radius The distance from \p from within which to search.
+     * \param[out] item_indices The indices of the items found are appended to
+     * this.
+     */
+    void findWithin(const Point from, const coord_t radius, std::vector<unsigned int>& item_indices) const;
+
+private:
+    /*!
+     * \brief A point of an item in the tree.
+     */
+    struct Node
+    {
+        Point location; //!< Where the point is.
+        unsigned int item_idx; //!< The item the point belongs to.
+        bool removed; //!< Whether the item was removed from the tree.
+        size_t remaining; //!< How many points in the subtree of this node are not removed.
+    };
+
+    /*!
+     * The nodes of the tree. The subtree of a range of nodes has the middle
+     * node as its root, which splits the nodes before and after it along X at
+     * even depths and along Y at odd depths.
+     */
+    std::vector<Node> nodes;
+
+    std::vector<std::vector<size_t>> nodes_of_item; //!< For each item the indices of the nodes of its points.
+
+    /*!
+     * \brief Sort a range of nodes into a subtree.
+     * \param begin The first node of the range.
+     * \param end The node after the last node of the range.
+     * \param depth The depth of the root of the subtree.
+     */
+    void build(const size_t begin, const size_t end, const size_t depth);
+
+    /*!
+     * \brief Look for the nearest point in a subtree.
+     * \param begin The first node of the subtree.
+     * \param end The node after the last node of the subtree.
+     * \param depth The depth of the root of the subtree.
+     * \param from The location to search around.
+     * \param[in,out] best_node The nearest node found so far.
+     * \param[in,out] best_dist2 The squared distance to \p best_node.
+     */
+    void findNearest(const size_t begin, const size_t end, const size_t depth, const Point from, size_t& best_node, coord_t& best_dist2) const;
+
+    /*!
+     * \brief Look for the points within some distance in a subtree.
+     * \param begin The first node of the subtree.
+     * \param end The node after the last node of the subtree.
+     * \param depth The depth of the root of the subtree.
+     * \param from The location to search around.
+     * \param radius The distance from \p from within which to search.
+     * \param[out] item_indices The indices of the items found are appended to
+     * this.
+     */
+    void findWithin(const size_t begin, const size_t end, const size_t depth, const Point from, const coord_t radius, std::vector<unsigned int>& item_indices) const;
+};
+
+} //namespace cura
+
+#endif //UTILS_POINT_KD_TREE_H
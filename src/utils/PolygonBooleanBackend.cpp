@@ -0,0 +1,314 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "AABB.h"
+#include "ClipperEngineCache.h"
+#include "Instrumentation.h"
+#include "NoCopy.h"
+#include "PolygonBooleanBackend.h"
+#include "polygon.h" //To get the bounding box of a path.
+
+namespace cura
+{
+
+namespace
+{
+
+ClipperBooleanBackend clipper_backend; //!< The default backend.
+PolygonBooleanBackend* current_backend = &clipper_backend; //!< The backend in use.
+
+/*!
+ * The bounding box of all points of \p paths.
+ */
+AABB boundingBox(const ClipperLib::Paths& paths)
+{
+    AABB aabb;
+    for (const ClipperLib::Path& path : paths)
+    {
+        for (const Point& point : path)
+        {
+            aabb.include(point);
+        }
+    }
+    return aabb;
+}
+
+/*!
+ * Whether the bounding box of \p path overlaps with \p aabb.
+ *
+ * Boxes that only touch count as overlapping, so this never rejects a path
+ * that shares a border with the box.
+ */
+bool overlaps(const AABB& aabb, const ClipperLib::Path& path)
+{
+    const AABB path_aabb(path);
+    return path_aabb.min.X <= aabb.max.X && path_aabb.max.X >= aabb.min.X
+        && path_aabb.min.Y <= aabb.max.Y && path_aabb.max.Y >= aabb.min.Y;
+}
+
+/*!
+ * \brief Counts an operation of Clipper in the innermost stage that is being
+ * timed on the calling thread, with the number of points that go in and come
+ * out and the time it takes.
+ *
+ * The operation is counted as one call of the counter it is constructed with.
+ * The points and the time are counted as clipper_points_in,
+ * clipper_points_out and clipper_microseconds, summed over all operations.
+ * Nothing is counted while instrumentation is disabled, so that the points
+ * aren't counted for nothing.
+ */
+class CountedOperation : NoCopy
+{
+public:
+    /*!
+     * \brief Count the call and start timing the operation.
+     * \param calls_counter The name of the counter of the operation, which
+     * must be a string literal. See \ref ScopedTimer::count.
+     * \param calls How many operations the call consists of.
+     */
+    CountedOperation(const char* calls_counter, const size_t calls = 1)
+    : start_time(-1)
+    {
+#ifdef INSTRUMENTATION
+        Instrumentation& instrumentation = Instrumentation::getInstance();
+        if (instrumentation.isEnabled())
+        {
+            ScopedTimer::count(calls_counter, calls);
+            start_time = instrumentation.getTime();
+        }
+#endif //INSTRUMENTATION
+    }
+
+    /*!
+     * \brief Count the time of the operation.
+     */
+    ~CountedOperation()
+    {
+        if (start_time >= 0)
+        {
+            ScopedTimer::count("clipper_microseconds", static_cast<int64_t>((Instrumentation::getInstance().getTime() - start_time) * 1000000.0));
+        }
+    }
+
+    /*!
+     * \brief Count the points of polygons that go into the operation. Call
+     * this before the operation, since the result may replace the input.
+     */
+    void countInput(const ClipperLib::Paths& paths)
+    {
+        if (start_time >= 0)
+        {
+            ScopedTimer::count("clipper_points_in", pointCount(paths));
+        }
+    }
+
+    /*!
+     * \brief Count the points of the polygons that came out of the operation.
+     */
+    void countOutput(const ClipperLib::Paths& paths)
+    {
+        if (start_time >= 0)
+        {
+            ScopedTimer::count("clipper_points_out", pointCount(paths));
+        }
+    }
+
+    /*!
+     * \brief Count the points of the polygons and polylines that came out of
+     * the operation.
+     */
+    void countOutput(const ClipperLib::PolyTree& tree)
+    {
+        if (start_time >= 0)
+        {
+            int64_t point_count = 0;
+            for (const ClipperLib::PolyNode* node = tree.GetFirst(); node != nullptr; node = node->GetNext())
+            {
+                point_count += node->Contour.size();
+            }
+            ScopedTimer::count("clipper_points_out", point_count);
+        }
+    }
+
+private:
+    /*!
+     * The number of points of all of \p paths.
+     */
+    static int64_t pointCount(const ClipperLib::Paths& paths)
+    {
+        int64_t point_count = 0;
+        for (const ClipperLib::Path& path : paths)
+        {
+            point_count += path.size();
+        }
+        return point_count;
+    }
+
+    double start_time; //!< When the operation started, or a negative number if it isn't counted.
+};
+
+} //Anonymous namespace.
+
+PolygonBooleanBackend::~PolygonBooleanBackend()
+{
+}
+
+PolygonBooleanBackend& PolygonBooleanBackend::getInstance()
+{
+    return *current_backend;
+}
+
+void PolygonBooleanBackend::setInstance(PolygonBooleanBackend* backend)
+{
+    current_backend = backend ? backend : &clipper_backend;
+}
+
+void PolygonBooleanBackend::offsetEach(const std::vector<const ClipperLib::Paths*>& inputs, const coord_t distance, const ClipperLib::JoinType join_type, const double miter_limit, std::vector<ClipperLib::Paths>& results)
+{
+    results.resize(inputs.size());
+    ClipperLib::Paths unioned;
+    for (size_t input_idx = 0; input_idx < inputs.size(); input_idx++)
+    {
+        unionPolygons(*inputs[input_idx], ClipperLib::Paths(), ClipperLib::pftNonZero, unioned);
+        offset(unioned, distance, join_type, ClipperLib::etClosedPolygon, miter_limit, results[input_idx]);
+    }
+}
+
+void ClipperBooleanBackend::offset(const ClipperLib::Paths& paths, const coord_t distance, const ClipperLib::JoinType join_type, const ClipperLib::EndType end_type, const double miter_limit, ClipperLib::Paths& result)
+{
+    CountedOperation counted("clipper_offset");
+    counted.countInput(paths);
+    CachedClipperOffset clipper(miter_limit, 10.0);
+    clipper->AddPaths(paths, join_type, end_type);
+    clipper->Execute(result, distance);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::offsetEach(const std::vector<const ClipperLib::Paths*>& inputs, const coord_t distance, const ClipperLib::JoinType join_type, const double miter_limit, std::vector<ClipperLib::Paths>& results)
+{
+    results.resize(inputs.size());
+    CountedOperation counted("clipper_offset", inputs.size());
+    CachedClipper clipper;
+    CachedClipperOffset clipper_offset(miter_limit, 10.0);
+    ClipperLib::Paths unioned;
+    for (size_t input_idx = 0; input_idx < inputs.size(); input_idx++)
+    {
+        counted.countInput(*inputs[input_idx]);
+        clipper->AddPaths(*inputs[input_idx], ClipperLib::ptSubject, true);
+        clipper->Execute(ClipperLib::ctUnion, unioned, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        clipper->Clear();
+        clipper_offset->AddPaths(unioned, join_type, ClipperLib::etClosedPolygon);
+        clipper_offset->Execute(results[input_idx], distance);
+        clipper_offset->Clear();
+        counted.countOutput(results[input_idx]);
+    }
+}
+
+void ClipperBooleanBackend::unionPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type, ClipperLib::Paths& result)
+{
+    CountedOperation counted("clipper_union");
+    counted.countInput(subject);
+    counted.countInput(other);
+    CachedClipper clipper;
+    clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+    clipper->AddPaths(other, ClipperLib::ptSubject, true);
+    clipper->Execute(ClipperLib::ctUnion, result, fill_type, fill_type);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result)
+{
+    CountedOperation counted("clipper_difference");
+    counted.countInput(subject);
+    counted.countInput(clip);
+    if (subject.empty())
+    {
+        result.clear();
+        return;
+    }
+    const AABB aabb = boundingBox(subject);
+    CachedClipper clipper;
+    clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+    for (const ClipperLib::Path& path : clip)
+    {
+        //A polygon only changes the filled area within its own bounding box, so one that is far away can't cut anything off.
+        if (overlaps(aabb, path))
+        {
+            clipper->AddPath(path, ClipperLib::ptClip, true);
+        }
+    }
+    clipper->Execute(ClipperLib::ctDifference, result);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::intersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result)
+{
+    CountedOperation counted("clipper_intersection");
+    counted.countInput(subject);
+    counted.countInput(clip);
+    if (subject.empty() || clip.empty())
+    {
+        result.clear();
+        return;
+    }
+    const AABB aabb = boundingBox(subject);
+    const AABB clip_aabb = boundingBox(clip);
+    if (aabb.min.X > clip_aabb.max.X || aabb.max.X < clip_aabb.min.X || aabb.min.Y > clip_aabb.max.Y || aabb.max.Y < clip_aabb.min.Y)
+    {
+        result.clear(); //Far apart, so nothing in common.
+        return;
+    }
+    CachedClipper clipper;
+    for (const ClipperLib::Path& path : subject)
+    {
+        if (overlaps(clip_aabb, path))
+        {
+            clipper->AddPath(path, ClipperLib::ptSubject, true);
+        }
+    }
+    for (const ClipperLib::Path& path : clip)
+    {
+        if (overlaps(aabb, path))
+        {
+            clipper->AddPath(path, ClipperLib::ptClip, true);
+        }
+    }
+    clipper->Execute(ClipperLib::ctIntersection, result);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::xorPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result)
+{
+    CountedOperation counted("clipper_xor");
+    counted.countInput(subject);
+    counted.countInput(clip);
+    CachedClipper clipper;
+    clipper->AddPaths(subject, ClipperLib::ptSubject, true);
+    clipper->AddPaths(clip, ClipperLib::ptClip, true);
+    clipper->Execute(ClipperLib::ctXor, result);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::unionTree(const ClipperLib::Paths& paths, const ClipperLib::PolyFillType fill_type, ClipperLib::PolyTree& result)
+{
+    CountedOperation counted("clipper_union_tree");
+    counted.countInput(paths);
+    CachedClipper clipper;
+    clipper->AddPaths(paths, ClipperLib::ptSubject, true);
+    clipper->Execute(ClipperLib::ctUnion, result, fill_type, fill_type);
+    counted.countOutput(result);
+}
+
+void ClipperBooleanBackend::intersectionPolyLines(const ClipperLib::Paths& polylines, const ClipperLib::Paths& area, ClipperLib::PolyTree& result)
+{
+    CountedOperation counted("clipper_intersection_polylines");
+    counted.countInput(polylines);
+    counted.countInput(area);
+    CachedClipper clipper;
+    clipper->AddPaths(polylines, ClipperLib::ptSubject, false);
+    clipper->AddPaths(area, ClipperLib::ptClip, true);
+    clipper->Execute(ClipperLib::ctIntersection, result);
+    counted.countOutput(result);
+}
+
+} //namespace cura
@@ -0,0 +1,155 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_POLYGON_BOOLEAN_BACKEND_H
+#define UTILS_POLYGON_BOOLEAN_BACKEND_H
+
+#include <clipper.hpp>
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+/*!
+ * \brief The engine that computes the boolean operations and offsets of
+ * polygons.
+ *
+ * The operations of \ref Polygons go through the backend that is in use, so
+ * that a different engine can be benchmarked or selected at runtime without
+ * changing where the operations are called. By default this is the bundled
+ * Clipper, see \ref ClipperBooleanBackend.
+ *
+ * The polygons are given and returned as ``ClipperLib::Paths``, which is what
+ * \ref Polygons keeps them in. Closed polygons are filled according to the
+ * even-odd rule unless a fill type is given. The result may be the same
+ * object as one of the inputs. The operations are called from many threads at
+ * once, so a backend must allow that.
+ */
+class PolygonBooleanBackend
+{
+public:
+    virtual ~PolygonBooleanBackend();
+
+    /*!
+     * \brief Get the backend that is in use.
+     */
+    static PolygonBooleanBackend& getInstance();
+
+    /*!
+     * \brief Use a different backend from now on.
+     *
+     * This must not be called while any polygons are being processed. The
+     * caller keeps ownership of the backend, and must keep it alive until
+     * another one is set.
+     * \param backend The backend to use, or ``nullptr`` to go back to the
+     * bundled Clipper.
+     */
+    static void setInstance(PolygonBooleanBackend* backend);
+
+    /*!
+     * \brief Offset closed polygons or polylines.
+     * \param paths The polygons or polylines to offset. Closed polygons are
+     * filled according to the even-odd rule.
+     * \param distance How far to offset. Negative to offset inwards.
+     * \param join_type How to join the offset lines at the corners.
+     * \param end_type Whether the paths are closed, and if not how to end
+     * them.
+     * \param miter_limit The maximum distance of a mitered corner, as a
+     * multiple of the offset distance.
+     * \param[out] result The offset polygons.
+     */
+    virtual void offset(const ClipperLib::Paths& paths, const coord_t distance, const ClipperLib::JoinType join_type, const ClipperLib::EndType end_type, const double miter_limit, ClipperLib::Paths& result) = 0;
+
+    /*!
+     * \brief Offset each of many sets of closed polygons by the same distance,
+     * such as the parts of a layer.
+     *
+     * Like \ref Polygons::offset, each set is first unioned, with the areas
+     * filled according to the non-zero rule. By default this does the union
+     * and offset of each set in turn, but a backend can share the work of
+     * setting up between them, or do them at the same time.
+     * \param inputs The sets of polygons to offset.
+     * \param distance How far to offset. Negative to offset inwards.
+     * \param join_type How to join the offset lines at the corners.
+     * \param miter_limit The maximum distance of a mitered corner, as a
+     * multiple of the offset distance.
+     * \param[out] results The offset polygons of each set, in the same order.
+     */
+    virtual void offsetEach(const std::vector<const ClipperLib::Paths*>& inputs, const coord_t distance, const ClipperLib::JoinType join_type, const double miter_limit, std::vector<ClipperLib::Paths>& results);
+
+    /*!
+     * \brief Get the area covered by either of two sets of polygons.
+     * \param fill_type Which areas of each set are filled.
+     * \param[out] result The outlines of the union.
+     */
+    virtual void unionPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type, ClipperLib::Paths& result) = 0;
+
+    /*!
+     * \brief Get the area of the subject that is not covered by the clip.
+     * \param[out] result The outlines of the difference.
+     */
+    virtual void difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) = 0;
+
+    /*!
+     * \brief Get the area covered by both the subject and the clip.
+     * \param[out] result The outlines of the intersection.
+     */
+    virtual void intersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) = 0;
+
+    /*!
+     * \brief Get the area covered by exactly one of the subject and the clip.
+     * \param[out] result The outlines of the exclusive or.
+     */
+    virtual void xorPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) = 0;
+
+    /*!
+     * \brief Get the area covered by some polygons as a tree of outlines,
+     * where the holes of each outline are its children and the parts inside
+     * the holes are theirs.
+     * \param fill_type Which areas of the polygons are filled.
+     * \param[out] result The tree of outlines of the union.
+     */
+    virtual void unionTree(const ClipperLib::Paths& paths, const ClipperLib::PolyFillType fill_type, ClipperLib::PolyTree& result) = 0;
+
+    /*!
+     * \brief Cut polylines to the parts that are inside of an area.
+     * \param polylines The open paths to cut.
+     * \param area The closed polygons to keep the parts within.
+     * \param[out] result The parts of the polylines, as the open paths in the
+     * tree.
+     */
+    virtual void intersectionPolyLines(const ClipperLib::Paths& polylines, const ClipperLib::Paths& area, ClipperLib::PolyTree& result) = 0;
+};
+
+/*!
+ * \brief The bundled Clipper library as backend.
+ *
+ * The engines are reused by all operations on the same thread, see
+ * \ref CachedClipper. A batch of offsets takes them once for all of its sets
+ * of polygons. The difference and intersection leave out the
+ * polygons of which the bounding box doesn't overlap the other operand, since
+ * they can't change the result.
+ *
+ * Every operation is counted in the innermost stage that is being timed, see
+ * \ref ScopedTimer, with the points that go in and come out and its time. The
+ * instrumentation sinks then show which stages and layers spend the most in
+ * Clipper, which a sampling profiler attributes to Clipper as a whole.
+ */
+class ClipperBooleanBackend : public PolygonBooleanBackend
+{
+public:
+    void offset(const ClipperLib::Paths& paths, const coord_t distance, const ClipperLib::JoinType join_type, const ClipperLib::EndType end_type, const double miter_limit, ClipperLib::Paths& result) override;
+    void offsetEach(const std::vector<const ClipperLib::Paths*>& inputs, const coord_t distance, const ClipperLib::JoinType join_type, const double miter_limit, std::vector<ClipperLib::Paths>& results) override;
+    void unionPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type, ClipperLib::Paths& result) override;
+    void difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) override;
+    void intersection(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) override;
+    void xorPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) override;
+    void unionTree(const ClipperLib::Paths& paths, const ClipperLib::PolyFillType fill_type, ClipperLib::PolyTree& result) override;
+    void intersectionPolyLines(const ClipperLib::Paths& polylines, const ClipperLib::Paths& area, ClipperLib::PolyTree& result) override;
+};
+
+} //namespace cura
+
+#endif //UTILS_POLYGON_BOOLEAN_BACKEND_H
@@ -18,10 +18,13 @@ Polygons PolygonConnector::connect()
     }
 
     std::vector<Polygon> to_connect;
+    std::vector<AABB> to_connect_aabbs; // the bounding box of each polygon in to_connect, to quickly skip polygons which are far away
     to_connect.reserve(input_polygons.size());
+    to_connect_aabbs.reserve(input_polygons.size());
     for (ConstPolygonPointer poly : input_polygons)
     {
         to_connect.emplace_back(*poly); // copy into list
+        to_connect_aabbs.emplace_back(*poly);
     }
 
     while (!to_connect.empty())
@@ -33,8 +36,10 @@ Polygons PolygonConnector::connect()
         }
         Polygon current = std::move(to_connect.back());
         to_connect.pop_back();
+        const AABB current_aabb = to_connect_aabbs.back();
+        to_connect_aabbs.pop_back();
 
-        std::optional<PolygonBridge> bridge = getBridge(current, to_connect);
+        std::optional<PolygonBridge> bridge = getBridge(current, current_aabb, to_connect, to_connect_aabbs);
         if (bridge)
         {
             all_bridges.push_back(*bridge); // just for keeping scores
@@ -42,6 +47,7 @@ Polygons PolygonConnector::connect()
             // i.e. replace the old other poly by the new one
             PolygonRef other_poly(*const_cast<ClipperLib::Path*>(bridge->a.to.poly.operator->())); // const casting a ConstPolygonPointer is difficult!
             other_poly = std::move(connectPolygonsAlongBridge(*bridge)); // connect the bridged parts and overwrite the other polygon with it.
+            to_connect_aabbs[bridge->a.to.poly_idx] = AABB(other_poly);
 
             // don't store the current poly, it has just been connected and stored
         }
@@ -127,6 +133,17 @@ char PolygonConnector::getPolygonDirection(const ClosestPolygonPoint& from, cons
 }
 
 std::optional<PolygonConnector::PolygonBridge> PolygonConnector::getBridge(ConstPolygonRef from_poly, std::vector<Polygon>& to_polygons)
+{
+    std::vector<AABB> to_polygon_aabbs;
+    to_polygon_aabbs.reserve(to_polygons.size());
+    for (const Polygon& poly : to_polygons)
+    {
+        to_polygon_aabbs.emplace_back(poly);
+    }
+    return getBridge(from_poly, AABB(from_poly), to_polygons, to_polygon_aabbs);
+}
+
+std::optional<PolygonConnector::PolygonBridge> PolygonConnector::getBridge(ConstPolygonRef from_poly, const AABB& from_aabb, std::vector<Polygon>& to_polygons, const std::vector<AABB>& to_polygon_aabbs)
 {
     // line distance between consecutive polygons should be at least the line_width
     const coord_t min_connection_length = line_width - 10;
@@ -138,16 +155,26 @@ std::optional<PolygonConnector::PolygonBridge> PolygonConnector::getBridge(Const
     std::optional<PolygonConnector::PolygonConnection> first_connection;
     std::optional<PolygonConnector::PolygonConnection> second_connection;
 
+    // Only polygons within the maximum connection length can be connected to,
+    // so leave out the others rather than copying them and searching through them.
+    AABB search_aabb = from_aabb;
+    search_aabb.expand(max_connection_length);
     Polygons to_polys;
-    for (const Polygon& poly : to_polygons)
+    std::vector<size_t> to_poly_indices; // for each polygon in to_polys, its index in to_polygons
+    for (size_t poly_idx = 0; poly_idx < to_polygons.size(); poly_idx++)
     {
-        to_polys.add(poly);
+        if (search_aabb.hit(to_polygon_aabbs[poly_idx]))
+        {
+            to_polys.add(to_polygons[poly_idx]);
+            to_poly_indices.push_back(poly_idx);
+        }
     }
 
     std::function<bool (std::pair<ClosestPolygonPoint, ClosestPolygonPoint>)> can_make_bridge =
         [&, this](std::pair<ClosestPolygonPoint, ClosestPolygonPoint> candidate)
         {
             first_connection.emplace(candidate.first, candidate.second);
+            first_connection->to.poly_idx = to_poly_indices[first_connection->to.poly_idx];
             first_connection->to.poly = &to_polygons[first_connection->to.poly_idx]; // because it still refered to the local variable [to_polys]
             if (first_connection->getDistance2() > max_dist * max_dist)
             {
@@ -173,6 +200,7 @@ std::optional<PolygonConnector::PolygonBridge> PolygonConnector::getBridge(Const
     if (first_connection && second_connection)
     {
         PolygonBridge result(*first_connection, *second_connection);
+        result.b.to.poly_idx = result.a.to.poly_idx; // both connections go to the same polygon
         // ensure that b is always the right connection and a the left
         Point a_vec = result.a.to.p() - result.a.from.p();
         Point shift = turn90CCW(a_vec);
@@ -9,6 +9,7 @@
 #endif
 #include <vector>
 
+#include "AABB.h"
 #include "IntPoint.h"
 #include "polygon.h"
 #include "polygonUtils.h"
@@ -168,6 +169,18 @@ protected:
      */
     std::optional<PolygonBridge> getBridge(ConstPolygonRef poly, std::vector<Polygon>& polygons);
 
+    /*!
+     * Get the bridge to cross between two polygons, when the bounding boxes of
+     * the polygons are known.
+     * 
+     * Only the \p polygons whose bounding box is within the maximum connection
+     * length of the bounding box of \p poly are searched.
+     * 
+     * \param poly_aabb The bounding box of \p poly.
+     * \param polygon_aabbs The bounding box of each of the \p polygons.
+     */
+    std::optional<PolygonBridge> getBridge(ConstPolygonRef poly, const AABB& poly_aabb, std::vector<Polygon>& polygons, const std::vector<AABB>& polygon_aabbs);
+
     /*!
      * Get a connection parallel to a given \p first connection at an orthogonal distance line_width from the \p first connection.
      * 
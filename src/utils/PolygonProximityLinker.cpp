@@ -1,27 +1,75 @@
-/** Copyright (C) 2016 Ultimaker - Released under terms of the AGPLv3 License */
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> // rotate, sort, unique
 #include <cmath> // isfinite
-#include <sstream> // ostream
+#include <numeric> // iota
+#include <tuple>
 
 #include "PolygonProximityLinker.h"
 #include "linearAlg2D.h"
+#include "StaticLineGrid.h"
 
 #include "AABB.h" // for debug output svg html
 #include "SVG.h"
 
-namespace cura 
+namespace cura
+{
+
+namespace
+{
+
+/*!
+ * A line segment of the polygons, from a vertex to the next, to put in a grid.
+ */
+struct LineSegment
+{
+    Point from; //!< The location of the vertex at the start.
+    Point to; //!< The location of the next vertex.
+    size_t vertex; //!< The vertex at the start.
+};
+
+struct LineSegmentLocator
 {
+    std::pair<Point, Point> operator()(const LineSegment& segment) const
+    {
+        return std::make_pair(segment.from, segment.to);
+    }
+};
 
-PolygonProximityLinker::PolygonProximityLinker(Polygons& polygons, int proximity_distance)
- : polygons(polygons)
- , proximity_distance(proximity_distance)
- , proximity_distance_2(proximity_distance * proximity_distance)
- , line_grid(proximity_distance, polygons.pointCount(), 3.0f)
+/*!
+ * Get the numbers of the vertices at the start of the line segments near a
+ * point, without duplicates.
+ */
+void getNearbySegments(const StaticLineGrid<LineSegment, LineSegmentLocator>& line_grid, const Point point, const coord_t radius, std::vector<size_t>& result)
 {
-    // heuristic reserve a good amount of elements
-    proximity_point_links.reserve(polygons.pointCount()); // When the whole model consists of thin walls, there will generally be a link for every point, plus some endings minus some points which map to eachother
+    result.clear();
+    line_grid.processNearby(point, radius, [&result](const LineSegment& segment)
+        {
+            result.push_back(segment.vertex);
+            return true;
+        });
+    // a line segment is in every cell that it crosses
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
 
-    // convert to list polygons for insertion of points
-    ListPolyIt::convertPolygonsToLists(polygons, list_polygons); 
+/*!
+ * Compare points by X and then by Y.
+ */
+bool pointIsLess(const Point& a, const Point& b)
+{
+    return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+}
+
+}
+
+PolygonProximityLinker::PolygonProximityLinker(const Polygons& polygons, const coord_t proximity_distance)
+: proximity_distance(proximity_distance)
+, proximity_distance_2(proximity_distance * proximity_distance)
+, polygons(polygons)
+{
+    indexVertices();
 
     // link each corner to itself
     addSharpCorners();
@@ -31,274 +79,484 @@ PolygonProximityLinker::PolygonProximityLinker(Polygons& polygons, int proximity
 
     // add links where line segments diverge from below the proximity distance to over the proximity distance
     addProximityEndings();
-
-    // convert list polygons back
-    ListPolyIt::convertListPolygonsToPolygons(list_polygons, polygons);
 //     proximity2HTML("linker.html");
 }
 
-bool PolygonProximityLinker::isLinked(Point from)
+const Polygons& PolygonProximityLinker::getPolygons() const
 {
-    return point_to_link.find(from) != point_to_link.end();
+    return polygons;
 }
 
+coord_t PolygonProximityLinker::getProximityDistance() const
+{
+    return proximity_distance;
+}
+
+bool PolygonProximityLinker::isLinked(const Point from) const
+{
+    const LinkRange links = getLinks(from);
+    return links.first != links.second;
+}
+
+bool PolygonProximityLinker::vertexIsLinked(const size_t vertex) const
+{
+    // another vertex at the same location may have the links, but usually it's the vertex itself
+    return vertex_link_starts[vertex] != vertex_link_starts[vertex + 1] || isLinked(getPoint(vertex));
+}
 
-std::pair<PolygonProximityLinker::Point2Link::iterator, PolygonProximityLinker::Point2Link::iterator> PolygonProximityLinker::getLinks(Point from)
+PolygonProximityLinker::LinkRange PolygonProximityLinker::getLinks(const Point from) const
 {
-    std::pair<Point2Link::iterator, Point2Link::iterator> from_link_pair = point_to_link.equal_range(from);
-#ifdef DEBUG
-    for (Point2Link::iterator it = from_link_pair.first; it != from_link_pair.second; ++it)
+    const std::vector<Point>::const_iterator found = std::lower_bound(linked_points.begin(), linked_points.end(), from, pointIsLess);
+    if (found == linked_points.end() || *found != from)
     {
-        if (!(it->second.a.p() == from || it->second.b.p() == from))
+        return LinkRange(point_links.end(), point_links.end());
+    }
+    const size_t point_idx = found - linked_points.begin();
+    return LinkRange(point_links.begin() + point_link_starts[point_idx], point_links.begin() + point_link_starts[point_idx + 1]);
+}
+
+size_t PolygonProximityLinker::getLink(const size_t a, const size_t b) const
+{
+    for (size_t link_idx = vertex_link_starts[a]; link_idx < vertex_link_starts[a + 1]; link_idx++)
+    {
+        const size_t link = vertex_links[link_idx];
+        if ((link_a[link] == a && link_b[link] == b) || (link_a[link] == b && link_b[link] == a))
         {
-            std::cerr << " ERROR!\n" << it->first << " == " << from << "\n";
-            std::cerr << "should be either " << it->second.a.p() << " or " << it->second.b.p() << "\n";
-            std::cerr << (from_link_pair.first == from_link_pair.second) << " ; " << (from_link_pair.first == point_to_link.end()) << " ; " << (from_link_pair.second == point_to_link.end()) << "\n";
-            std::cerr << std::hash<Point>()(from) << " hashes " << std::hash<Point>()(it->second.a.p()) << " or " << std::hash<Point>()(it->second.b.p()) << "\n";
-//             std::cerr << "ERROR! some point got mapped to a link which doesn't have the point as one of the end points!\n";
-            
-            std::cerr << "\n all links:\n";
-            for (std::pair<const Point, const ProximityPointLink> pair : point_to_link)
-            {
-                std::cerr << pair.first << " : " << pair.second.a.p() << "-" <<pair.second.b.p() << "\n";
-            }
-            
-            std::cerr << "\n link set \n";
-            for (const ProximityPointLink link : proximity_point_links)
-            {
-                std::cerr << link.a.p() << "-" << link.b.p() << " hashes as " << std::hash<ProximityPointLink>()(link) << "\n";
-            }
-            assert(false && "some point got mapped to a link which doesn't have the point as one of the end points!");
+            return link;
         }
     }
-#endif
-    return from_link_pair;
+    return NO_LINK;
+}
+
+const Point& PolygonProximityLinker::getPoint(const size_t vertex) const
+{
+    const size_t poly_idx = vertex_polygon[vertex];
+    return polygons[poly_idx][vertex - polygon_starts[poly_idx]];
+}
+
+size_t PolygonProximityLinker::getNext(const size_t vertex) const
+{
+    const size_t poly_idx = vertex_polygon[vertex];
+    return (vertex + 1 == polygon_starts[poly_idx + 1]) ? polygon_starts[poly_idx] : vertex + 1;
+}
+
+size_t PolygonProximityLinker::getPrev(const size_t vertex) const
+{
+    const size_t poly_idx = vertex_polygon[vertex];
+    return (vertex == polygon_starts[poly_idx]) ? polygon_starts[poly_idx + 1] - 1 : vertex - 1;
+}
+
+size_t PolygonProximityLinker::getLinkA(const size_t link) const
+{
+    return link_a[link];
+}
+
+size_t PolygonProximityLinker::getLinkB(const size_t link) const
+{
+    return link_b[link];
+}
+
+coord_t PolygonProximityLinker::getLinkDist(const size_t link) const
+{
+    return link_dist[link];
+}
+
+ProximityPointLinkType PolygonProximityLinker::getLinkType(const size_t link) const
+{
+    return link_type[link];
+}
+
+void PolygonProximityLinker::indexVertices()
+{
+    polygon_starts.clear();
+    vertex_polygon.clear();
+    polygon_starts.push_back(0);
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        polygon_starts.push_back(polygon_starts.back() + polygons[poly_idx].size());
+        vertex_polygon.insert(vertex_polygon.end(), polygons[poly_idx].size(), poly_idx);
+    }
 }
 
-void PolygonProximityLinker::createLineGrid()
+void PolygonProximityLinker::removeDuplicateLinks()
 {
-    for (unsigned int poly_idx = 0; poly_idx < list_polygons.size(); poly_idx++)
+    // remove duplicate links, which are between the same two vertices in either order
+    // sorted on the vertices and then the link itself, so that the first of each is kept
+    std::vector<std::tuple<size_t, size_t, size_t>> links_by_vertices;
+    links_by_vertices.reserve(link_a.size());
+    for (size_t link = 0; link < link_a.size(); link++)
+    {
+        links_by_vertices.emplace_back(std::min(link_a[link], link_b[link]), std::max(link_a[link], link_b[link]), link);
+    }
+    std::sort(links_by_vertices.begin(), links_by_vertices.end());
+    std::vector<bool> is_duplicate(link_a.size(), false);
+    for (size_t order_idx = 1; order_idx < links_by_vertices.size(); order_idx++)
     {
-        ListPolygon& poly = list_polygons[poly_idx];
-        for (ListPolygon::iterator it = poly.begin(); it != poly.end(); ++it)
+        is_duplicate[std::get<2>(links_by_vertices[order_idx])] = std::get<0>(links_by_vertices[order_idx]) == std::get<0>(links_by_vertices[order_idx - 1])
+            && std::get<1>(links_by_vertices[order_idx]) == std::get<1>(links_by_vertices[order_idx - 1]);
+    }
+    size_t link_count = 0;
+    for (size_t link = 0; link < link_a.size(); link++)
+    {
+        if (!is_duplicate[link])
         {
-            ListPolyIt point_it(poly, it);
-            line_grid.insert(point_it);
+            link_a[link_count] = link_a[link];
+            link_b[link_count] = link_b[link];
+            link_dist[link_count] = link_dist[link];
+            link_type[link_count] = link_type[link];
+            link_count++;
         }
     }
+    link_a.resize(link_count);
+    link_b.resize(link_count);
+    link_dist.resize(link_count);
+    link_type.resize(link_count);
 }
 
-void PolygonProximityLinker::findProximatePoints()
+void PolygonProximityLinker::indexLinks(const size_t link_count)
 {
-    createLineGrid();
+    // the links of each vertex, counted first so that they can be put in place right away
+    vertex_link_starts.assign(polygon_starts.back() + 1, 0);
+    for (size_t link = 0; link < link_count; link++)
+    {
+        vertex_link_starts[link_a[link] + 1]++;
+        if (link_b[link] != link_a[link])
+        {
+            vertex_link_starts[link_b[link] + 1]++;
+        }
+    }
+    std::partial_sum(vertex_link_starts.begin(), vertex_link_starts.end(), vertex_link_starts.begin());
+    vertex_links.resize(vertex_link_starts.back());
+    std::vector<size_t> vertex_link_ends(vertex_link_starts.begin(), vertex_link_starts.end() - 1);
+    for (size_t link = 0; link < link_count; link++)
+    {
+        vertex_links[vertex_link_ends[link_a[link]]++] = link;
+        if (link_b[link] != link_a[link])
+        {
+            vertex_links[vertex_link_ends[link_b[link]]++] = link;
+        }
+    }
 
-    for (unsigned int poly_idx = 0; poly_idx < list_polygons.size(); poly_idx++)
+    // the links of each point, from the links of the vertices at that point
+    std::vector<std::pair<Point, size_t>> linked_vertices;
+    for (size_t vertex = 0; vertex < polygon_starts.back(); vertex++)
+    {
+        if (vertex_link_starts[vertex] != vertex_link_starts[vertex + 1])
+        {
+            linked_vertices.emplace_back(getPoint(vertex), vertex);
+        }
+    }
+    // merge sorted, since the vertices along the walls would often be a bad case for a quick sort
+    std::stable_sort(linked_vertices.begin(), linked_vertices.end(), [](const std::pair<Point, size_t>& lhs, const std::pair<Point, size_t>& rhs)
+        {
+            return pointIsLess(lhs.first, rhs.first);
+        });
+    linked_points.clear();
+    point_link_starts.clear();
+    point_links.clear();
+    for (const std::pair<Point, size_t>& linked_vertex : linked_vertices)
     {
-        ListPolygon& poly = list_polygons[poly_idx];
-        for (ListPolygon::iterator it = poly.begin(); it != poly.end(); ++it)
+        const size_t vertex = linked_vertex.second;
+        if (linked_points.empty() || linked_points.back() != linked_vertex.first)
         {
-            ListPolyIt point_it(poly, it);
-            if (new_points.find(point_it) == new_points.end())
+            linked_points.push_back(linked_vertex.first);
+            point_link_starts.push_back(point_links.size());
+        }
+        point_links.insert(point_links.end(), vertex_links.begin() + vertex_link_starts[vertex], vertex_links.begin() + vertex_link_starts[vertex + 1]);
+    }
+    point_link_starts.push_back(point_links.size());
+}
+
+std::vector<size_t> PolygonProximityLinker::insertPoints(const std::vector<Insertion>& insertions)
+{
+    const size_t vertex_count = polygon_starts.back();
+    std::vector<coord_t> dist2_along_segment;
+    dist2_along_segment.reserve(insertions.size());
+    for (const Insertion& insertion : insertions)
+    {
+        dist2_along_segment.push_back(vSize2(insertion.point - getPoint(insertion.segment)));
+    }
+    std::vector<size_t> order(insertions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&insertions, &dist2_along_segment](const size_t lhs, const size_t rhs)
+        {
+            if (insertions[lhs].segment != insertions[rhs].segment)
+            {
+                return insertions[lhs].segment < insertions[rhs].segment;
+            }
+            if (dist2_along_segment[lhs] != dist2_along_segment[rhs])
+            {
+                return dist2_along_segment[lhs] < dist2_along_segment[rhs];
+            }
+            if (insertions[lhs].point != insertions[rhs].point) // keep the same points together
+            {
+                return pointIsLess(insertions[lhs].point, insertions[rhs].point);
+            }
+            return lhs < rhs;
+        });
+
+    std::vector<size_t> renumber(vertex_count + insertions.size()); // the new number of each vertex and each inserted point
+    std::vector<size_t> at_next_vertex; // the inserted points that are at the end of their line segment, which may not be numbered yet
+    std::vector<size_t> inserted; // the new numbers of the inserted points
+    std::vector<size_t> rotated; // the final number of each new number, after the points on the closing line segments are moved to the start of their polygon
+    Polygons result;
+    size_t new_vertex_count = 0;
+    std::vector<size_t>::const_iterator insertion_it = order.begin();
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        PolygonRef result_poly = result.newPoly();
+        const size_t poly_start = new_vertex_count;
+        size_t closing_count = 0; // the number of points inserted on the line segment from the last vertex to the first
+        for (size_t vertex = polygon_starts[poly_idx]; vertex < polygon_starts[poly_idx + 1]; vertex++)
+        {
+            renumber[vertex] = new_vertex_count++;
+            result_poly.add(getPoint(vertex));
+            for (; insertion_it != order.end() && insertions[*insertion_it].segment == vertex; ++insertion_it)
             {
-                // handle new_points separately
-                // to prevent this:
-                //  1    3   5   7
-                //  o<-.
-                //  :   'o<-.
-                //  :   /:   o<.
-                //  :  / :  /:  'o<.
-                //  : /  : / : / :
-                //  :/   :/  :/  :   etc.
-                //  o--->o-->o-->o->
-                //  2    4   6   8
-                std::unordered_set<ListPolyIt> nearby_lines;
-                std::function<bool (const ListPolyIt&)> process_func = [&nearby_lines](const ListPolyIt& elem)
+                const Point point = insertions[*insertion_it].point;
+                if (point == result_poly.back()) // at the start of the line segment, or at the previous inserted point
                 {
-                    nearby_lines.emplace(elem);
-                    return true;
-                };
-                line_grid.processNearby(point_it.p(), proximity_distance, process_func);
-                for (const ListPolyIt& nearby_line : nearby_lines)
+                    renumber[vertex_count + *insertion_it] = new_vertex_count - 1;
+                }
+                else if (point == getPoint(getNext(vertex)))
                 {
-                    findProximatePoints(point_it, *nearby_line.poly, nearby_line, nearby_line.next());
+                    at_next_vertex.push_back(*insertion_it);
+                }
+                else
+                {
+                    renumber[vertex_count + *insertion_it] = new_vertex_count++;
+                    result_poly.add(point);
+                    inserted.push_back(new_vertex_count - 1);
+                    closing_count += (vertex + 1 == polygon_starts[poly_idx + 1]) ? 1 : 0;
                 }
             }
         }
+        // the points on the closing line segment go before the first vertex, so the polygon starts at the first of them
+        std::rotate(result_poly.begin(), result_poly.end() - closing_count, result_poly.end());
+        for (size_t new_vertex = poly_start; new_vertex < new_vertex_count; new_vertex++)
+        {
+            rotated.push_back(poly_start + (new_vertex - poly_start + closing_count) % result_poly.size());
+        }
+    }
+    for (const size_t insertion_idx : at_next_vertex)
+    {
+        renumber[vertex_count + insertion_idx] = renumber[getNext(insertions[insertion_idx].segment)];
+    }
+    for (size_t& new_vertex : renumber)
+    {
+        new_vertex = rotated[new_vertex];
+    }
+    for (size_t& new_vertex : inserted)
+    {
+        new_vertex = rotated[new_vertex];
+    }
+    std::sort(inserted.begin(), inserted.end());
+
+    polygons = std::move(result);
+    indexVertices();
+    for (size_t link = 0; link < link_a.size(); link++)
+    {
+        link_a[link] = renumber[link_a[link]];
+        link_b[link] = renumber[link_b[link]];
+    }
+    return inserted;
+}
+
+void PolygonProximityLinker::addLink(const size_t a, const size_t b, const coord_t dist, const ProximityPointLinkType type)
+{
+    link_a.push_back(a);
+    link_b.push_back(b);
+    link_dist.push_back(dist);
+    link_type.push_back(type);
+}
+
+void PolygonProximityLinker::addSharpCorners()
+{
+    for (size_t vertex = 0; vertex < polygon_starts.back(); vertex++)
+    {
+        if (LinearAlg2D::isAcuteCorner(getPoint(getPrev(vertex)), getPoint(vertex), getPoint(getNext(vertex))) > 0)
+        {
+            addLink(vertex, vertex, 0, ProximityPointLinkType::SHARP_CORNER);
+        }
+    }
+}
+
+void PolygonProximityLinker::findProximatePoints()
+{
+    const size_t vertex_count = polygon_starts.back();
+    std::vector<LineSegment> segments;
+    segments.reserve(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; vertex++)
+    {
+        segments.push_back(LineSegment{getPoint(vertex), getPoint(getNext(vertex)), vertex});
     }
 
-    for (const ListPolyIt& new_point_it : new_points)
-    {
-        // link with existing points, but don't introduce new points for line segments
-        // to prevent this:
-        //  1    3   5   7
-        //  o<-.
-        //  :   'o<-.
-        //  :   /:   o<.
-        //  :  / :  /:  'o<.
-        //  : /  : / : / :
-        //  :/   :/  :/  :   etc.
-        //  o--->o-->o-->o->
-        //  2    4   6   8
-        std::unordered_set<ListPolyIt> nearby_vert_its;
-        std::function<bool (const ListPolyIt&)> process_func = [&nearby_vert_its](const ListPolyIt& elem)
+    std::vector<Insertion> insertions;
+    std::vector<size_t> nearby_segments;
+    {
+        const StaticLineGrid<LineSegment, LineSegmentLocator> line_grid(proximity_distance, segments);
+        for (size_t vertex = 0; vertex < vertex_count; vertex++)
         {
-            nearby_vert_its.emplace(elem);
-            return true;
-        };
-        line_grid.processNearby(new_point_it.p(), proximity_distance, process_func);
-        // because we use the same line_grid as before the resulting nearby_points
-        // will also have points which are not nearby, (But when the line segment *is* nearby.)
-        // but at least we don't have to create a whole new SparsePointGrid
-        for (const ListPolyIt& nearby_vert_it : nearby_vert_its)
+            getNearbySegments(line_grid, getPoint(vertex), proximity_distance, nearby_segments);
+            for (const size_t b_from : nearby_segments)
+            {
+                findProximatePoints(vertex, b_from, insertions);
+            }
+        }
+    }
+    const std::vector<size_t> new_points = insertPoints(insertions);
+
+    // link the new points with existing points, but don't introduce new points for line segments
+    // to prevent this:
+    //  1    3   5   7
+    //  o<-.
+    //  :   'o<-.
+    //  :   /:   o<.
+    //  :  / :  /:  'o<.
+    //  : /  : / : / :
+    //  :/   :/  :/  :   etc.
+    //  o--->o-->o-->o->
+    //  2    4   6   8
+    segments.clear();
+    for (size_t vertex = 0; vertex < polygon_starts.back(); vertex++)
+    {
+        segments.push_back(LineSegment{getPoint(vertex), getPoint(getNext(vertex)), vertex});
+    }
+    const StaticLineGrid<LineSegment, LineSegmentLocator> line_grid(proximity_distance, segments);
+    for (const size_t new_point : new_points)
+    {
+        // every vertex is at the start of a line segment, so each vertex that is close enough is among these
+        getNearbySegments(line_grid, getPoint(new_point), proximity_distance, nearby_segments);
+        for (const size_t nearby_vertex : nearby_segments)
         {
-            Point new_point = new_point_it.p();
-            Point nearby_vert = nearby_vert_it.p();
-            int64_t dist2 = vSize2(new_point - nearby_vert);
+            const Point new_point_location = getPoint(new_point);
+            const Point nearby_vertex_location = getPoint(nearby_vertex);
+            const coord_t dist2 = vSize2(new_point_location - nearby_vertex_location);
             if (dist2 < proximity_distance_2
-                && new_point != nearby_vert // not the same point
+                && new_point_location != nearby_vertex_location // not the same point
             )
             {
-                addProximityLink(new_point_it, nearby_vert_it, sqrt(dist2), ProximityPointLinkType::NORMAL);
+                addLink(new_point, nearby_vertex, sqrt(dist2), ProximityPointLinkType::NORMAL);
             }
         }
     }
 }
 
-void PolygonProximityLinker::findProximatePoints(const ListPolyIt a_point_it, ListPolygon& to_list_poly, const ListPolyIt b_from_it, const ListPolyIt b_to_it)
+void PolygonProximityLinker::findProximatePoints(const size_t a_vertex, const size_t b_from, std::vector<Insertion>& insertions)
 {
-    const Point& a_point = a_point_it.p();
-
-    const Point& b_from = b_from_it.p();
-    const Point& b_to = b_to_it.p();
-
-    if (a_point_it == b_from_it || a_point_it == b_to_it) // we currently consider a linesegment directly connected to [from]
+    const size_t b_to = getNext(b_from);
+    if (a_vertex == b_from || a_vertex == b_to) // we currently consider a linesegment directly connected to [from]
     {
         return;
     }
 
-    Point closest = LinearAlg2D::getClosestOnLineSegment(a_point, b_from, b_to);
+    const Point a_point = getPoint(a_vertex);
+    const Point b_from_point = getPoint(b_from);
+    const Point b_to_point = getPoint(b_to);
+
+    const Point closest = LinearAlg2D::getClosestOnLineSegment(a_point, b_from_point, b_to_point);
 
-    int64_t dist2 = vSize2(closest - a_point);
+    const coord_t dist2 = vSize2(closest - a_point);
 
     if (dist2 > proximity_distance_2
-        || (a_point_it.poly == &to_list_poly
-            && dot(a_point_it.next().p() - a_point, b_to - b_from) > 0 
-            && dot(a_point - a_point_it.prev().p(), b_to - b_from) > 0  ) // line segments are likely connected, because the winding order is in the same general direction
+        || (vertex_polygon[a_vertex] == vertex_polygon[b_from]
+            && dot(getPoint(getNext(a_vertex)) - a_point, b_to_point - b_from_point) > 0
+            && dot(a_point - getPoint(getPrev(a_vertex)), b_to_point - b_from_point) > 0  ) // line segments are likely connected, because the winding order is in the same general direction
     )
     { // line segment too far away to be proximate
         return;
     }
 
-    int64_t dist = sqrt(dist2);
+    const coord_t dist = sqrt(dist2);
 
-    if (shorterThen(closest - b_from, 10))
+    if (shorterThen(closest - b_from_point, 10))
     {
-        addProximityLink(a_point_it, b_from_it, dist, ProximityPointLinkType::NORMAL);
+        addLink(a_vertex, b_from, dist, ProximityPointLinkType::NORMAL);
     }
-    else if (shorterThen(closest - b_to, 10))
+    else if (shorterThen(closest - b_to_point, 10))
     {
-        addProximityLink(a_point_it, b_to_it, dist, ProximityPointLinkType::NORMAL);
+        addLink(a_vertex, b_to, dist, ProximityPointLinkType::NORMAL);
     }
-    else 
+    else
     {
-        if (new_points.find(a_point_it) == new_points.end())
-        {
-            // don't introduce new points for newly introduced points
-            // to prevent this:
-            //  1    3   5   7
-            //  o<-.
-            //  :   'o<-.
-            //  :   /:   o<.
-            //  :  / :  /:  'o<.
-            //  : /  : / : / :
-            //  :/   :/  :/  :   etc.
-            //  o--->o-->o-->o->
-            //  2    4   6   8
-            ListPolyIt new_it = addNewPolyPoint(closest, b_from_it, b_to_it, b_to_it);
-            addProximityLink(a_point_it, new_it, dist, ProximityPointLinkType::NORMAL);
-        }
-    }
-}
-
-
-
-bool PolygonProximityLinker::addProximityLink(ListPolyIt from, ListPolyIt to, int64_t dist, const ProximityPointLinkType type)
-{
-    std::pair<ProximityPointLinks::iterator, bool> result =
-        proximity_point_links.emplace(from, to, dist, type);
-
-    if (!result.second)
-    { // links was already made!
-        return false;
+        addLink(a_vertex, polygon_starts.back() + insertions.size(), dist, ProximityPointLinkType::NORMAL);
+        insertions.push_back(Insertion{b_from, closest});
     }
-    ProximityPointLinks::iterator it = result.first;
-    assert(it->a == from);
-    assert(it->b == to);
-    assert(it->a.p() == from.p());
-    assert(it->b.p() == to.p());
-    addToPoint2LinkMap(from.p(), it);
-    addToPoint2LinkMap(to.p(), it);
-
-    return result.second;
-}
-
-bool PolygonProximityLinker::addCornerLink(ListPolyIt corner_point, const ProximityPointLinkType type)
-{
-    constexpr int dist = 0;
-    std::pair<ProximityPointLinks::iterator, bool> result =
-        proximity_point_links.emplace(corner_point, corner_point, dist, type);
-
-    if (!result.second)
-    { // links was already made!
-        return false;
-    }
-    ProximityPointLinks::iterator it = result.first;
-    assert(it->a == corner_point);
-    assert(it->b == corner_point);
-    addToPoint2LinkMap(corner_point.p(), it);
-
-    return result.second;
 }
 
 void PolygonProximityLinker::addProximityEndings()
 {
-    ProximityPointLinks new_links; // Where to store the new links temporarily (Don't add them to the map we are iterating over!)
-    for (const ProximityPointLink& link : proximity_point_links)
+    // the endings are found from the links so far, and only these are iterated over and looked up
+    removeDuplicateLinks();
+    const size_t link_count = link_a.size();
+    indexLinks(link_count);
+
+    std::vector<Insertion> insertions;
+    std::vector<std::pair<size_t, bool>> skipped; // the links and directions that weren't an ending because the next vertices on both sides are linked
+    for (size_t link = 0; link < link_count; link++)
     {
-        if (link.dist == proximity_distance)
+        if (link_dist[link] == proximity_distance)
         { // its ending itself
             continue;
         }
-        const ListPolyIt& a_1 = link.a;
-        const ListPolyIt& b_1 = link.b;
         // an overlap segment can be an ending in two directions
-        { 
-            ListPolyIt a_2 = a_1.next();
-            ListPolyIt b_2 = b_1.prev();
-            addProximityEnding(link, a_2, b_2, a_2, b_1, new_links);
-        }
-        { 
-            ListPolyIt a_2 = a_1.prev();
-            ListPolyIt b_2 = b_1.next();
-            addProximityEnding(link, a_2, b_2, a_1, b_2, new_links);
+        for (const bool forward : {true, false})
+        {
+            if (!addProximityEnding(link, forward, insertions))
+            {
+                skipped.emplace_back(link, forward);
+            }
         }
     }
-    for (const ProximityPointLink& link : new_links)
+    insertPoints(insertions);
+
+    if (!skipped.empty())
     {
-        addProximityLink(link.a, link.b, link.dist, link.type);
+        // the ending points of the neighbouring links may have been inserted in between, which aren't linked themselves
+        // e.g. at a sharp corner next to another one, the endings of both are added
+        indexLinks(link_count);
+        insertions.clear();
+        for (const std::pair<size_t, bool>& link_direction : skipped)
+        {
+            addProximityEnding(link_direction.first, link_direction.second, insertions);
+        }
+        insertPoints(insertions);
     }
+
+    removeDuplicateLinks();
+    indexLinks(link_a.size());
 }
 
-void PolygonProximityLinker::addProximityEnding(const ProximityPointLink& link, const ListPolyIt& a2_it, const ListPolyIt& b2_it, const ListPolyIt& a_after_middle, const ListPolyIt& b_after_middle, ProximityPointLinks& result)
+bool PolygonProximityLinker::addProximityEnding(const size_t link, const bool forward, std::vector<Insertion>& insertions)
 {
-    Point& a1 = link.a.p();
-    Point& a2 = a2_it.p();
-    Point& b1 = link.b.p();
-    Point& b2 = b2_it.p();
-    Point a = a2 - a1;
-    Point b = b2 - b1;
+    const size_t a_1 = link_a[link];
+    const size_t b_1 = link_b[link];
+    if (forward)
+    {
+        const size_t a_2 = getNext(a_1);
+        const size_t b_2 = getPrev(b_1);
+        return addProximityEnding(link, a_2, b_2, a_1, b_2, insertions);
+    }
+    else
+    {
+        const size_t a_2 = getPrev(a_1);
+        const size_t b_2 = getNext(b_1);
+        return addProximityEnding(link, a_2, b_2, a_2, b_1, insertions);
+    }
+}
 
-    if (isLinked(a2_it.p()) && isLinked(b2_it.p())) // overlap area stops at one side
+bool PolygonProximityLinker::addProximityEnding(const size_t link, const size_t a2_vertex, const size_t b2_vertex, const size_t a_segment, const size_t b_segment, std::vector<Insertion>& insertions)
+{
+    const size_t a1_vertex = link_a[link];
+    const size_t b1_vertex = link_b[link];
+    const Point a1 = getPoint(a1_vertex);
+    const Point a2 = getPoint(a2_vertex);
+    const Point b1 = getPoint(b1_vertex);
+    const Point b2 = getPoint(b2_vertex);
+    const Point a = a2 - a1;
+    const Point b = b2 - b1;
+
+    if (vertexIsLinked(a2_vertex) && vertexIsLinked(b2_vertex)) // overlap area stops at one side
     {
         // TODO: add proximity endings between point and line ?
         // would be good for:
@@ -307,9 +565,9 @@ void PolygonProximityLinker::addProximityEnding(const ProximityPointLink& link,
         //      +-----
         // would be bad for
         //  ----+-+-----
-        return;
+        return false;
     }
-    if (isLinked(a2_it, link.b) || isLinked(b2_it, link.a))
+    if (getLink(a2_vertex, b1_vertex) != NO_LINK || getLink(b2_vertex, a1_vertex) != NO_LINK)
     { // other side of ending continues to overlap with the same ending
         //     link considered
         //     *
@@ -319,21 +577,28 @@ void PolygonProximityLinker::addProximityEnding(const ProximityPointLink& link,
         //     |
         //     v
         //     0
-        return;
+        return true;
     }
-    if (a2_it == b2_it)
+    if (a2_vertex == b2_vertex)
     { // overlap ends in pointy end
         //  o-->o-->o
         //  :   :   : \,
         //  :   :   :  o  wasn't linked yet because it's connected to the upper and lower part
         //  :   :   :,/
         //  o<--o<--o
-        result.emplace(ProximityPointLink(a2_it, a2_it, 0, ProximityPointLinkType::ENDING_CORNER));
-        return;
+        addLink(a2_vertex, a2_vertex, 0, ProximityPointLinkType::ENDING_CORNER);
+        return true;
     }
 
-    int64_t dist = proximityEndingDistance(a1, a2, b1, b2, link.dist);
-    if (dist < 0) { return; }
+    // the new points are numbered after the existing vertices until they are inserted
+    const auto insert = [this, &insertions](const size_t segment, const Point point)
+    {
+        insertions.push_back(Insertion{segment, point});
+        return polygon_starts.back() + insertions.size() - 1;
+    };
+
+    int64_t dist = proximityEndingDistance(a1, a2, b1, b2, link_dist[link]);
+    if (dist < 0) { return true; }
     int64_t a_length2 = vSize2(a);
     int64_t b_length2 = vSize2(b);
     if (dist*dist > std::min(a_length2, b_length2) )
@@ -342,64 +607,42 @@ void PolygonProximityLinker::addProximityEnding(const ProximityPointLink& link,
         dist = std::sqrt(std::min(a_length2, b_length2));
         if (a_length2 < b_length2)
         {
-            Point b_p = b1 + normal(b, dist);
-            ListPolyIt new_b = addNewPolyPoint(b_p, link.b, b2_it, b_after_middle);
-            result.emplace(ProximityPointLink(a2_it, new_b, proximity_distance, ProximityPointLinkType::ENDING));
+            const size_t new_b = insert(b_segment, b1 + normal(b, dist));
+            addLink(a2_vertex, new_b, proximity_distance, ProximityPointLinkType::ENDING);
         }
         else if (b_length2 < a_length2)
         {
-            Point a_p = a1 + normal(a, dist);
-            ListPolyIt new_a = addNewPolyPoint(a_p, link.a, a2_it, a_after_middle);
-            result.emplace(ProximityPointLink(new_a, b2_it, proximity_distance, ProximityPointLinkType::ENDING));
+            const size_t new_a = insert(a_segment, a1 + normal(a, dist));
+            addLink(new_a, b2_vertex, proximity_distance, ProximityPointLinkType::ENDING);
         }
         else // equal
         {
-            result.emplace(ProximityPointLink(a2_it, b2_it, proximity_distance, ProximityPointLinkType::ENDING));
+            addLink(a2_vertex, b2_vertex, proximity_distance, ProximityPointLinkType::ENDING);
         }
     }
     else if (dist > 0)
     {
-        Point a_p = a1 + normal(a, dist);
-        ListPolyIt new_a = addNewPolyPoint(a_p, link.a, a2_it, a_after_middle);
-        Point b_p = b1 + normal(b, dist);
-        ListPolyIt new_b = addNewPolyPoint(b_p, link.b, b2_it, b_after_middle);
-        result.emplace(ProximityPointLink(new_a, new_b, proximity_distance, ProximityPointLinkType::ENDING));
+        const size_t new_a = insert(a_segment, a1 + normal(a, dist));
+        const size_t new_b = insert(b_segment, b1 + normal(b, dist));
+        addLink(new_a, new_b, proximity_distance, ProximityPointLinkType::ENDING);
     }
     else if (dist == 0)
     {
-//         addProximityLink(link.a, link.b, proximity_distance);
-        // won't be inserted any way, because there already is such a link!
-        link.setDist(proximity_distance);
-    }
-}
-
-ListPolyIt PolygonProximityLinker::addNewPolyPoint(const Point point, const ListPolyIt line_start, const ListPolyIt line_end, const ListPolyIt before_this)
-{
-    if (point == line_start.p())
-    {
-        return line_start;
-    }
-    if (point == line_end.p())
-    {
-        return line_end;
+        // no new link is needed, because there already is such a link!
+        link_dist[link] = proximity_distance;
     }
-    ListPolygon::iterator new_p = before_this.poly->insert(before_this.it, point);
-    ListPolyIt lpi(*before_this.poly, new_p);
-    line_grid.insert(lpi);
-    // TODO: remove new part of old segment from the line_grid (?)
-    new_points.emplace(lpi);
-    return lpi;
+    return true;
 }
 
-int64_t PolygonProximityLinker::proximityEndingDistance(Point& a1, Point& a2, Point& b1, Point& b2, int a1b1_dist)
+int64_t PolygonProximityLinker::proximityEndingDistance(const Point a1, const Point a2, const Point b1, const Point b2, const coord_t a1b1_dist) const
 {
     int overlap = proximity_distance - a1b1_dist;
     Point a = a2-a1;
     Point b = b2-b1;
     double cos_angle = INT2MM2(dot(a, b)) / vSizeMM(a) / vSizeMM(b);
-    // result == .5*overlap / tan(.5*angle) == .5*overlap / tan(.5*acos(cos_angle)) 
+    // result == .5*overlap / tan(.5*angle) == .5*overlap / tan(.5*acos(cos_angle))
     // [wolfram alpha] == 0.5*overlap * sqrt(cos_angle+1)/sqrt(1-cos_angle)
-    // [assuming positive x] == 0.5*overlap / sqrt( 2 / (cos_angle + 1) - 1 ) 
+    // [assuming positive x] == 0.5*overlap / sqrt( 2 / (cos_angle + 1) - 1 )
     if (cos_angle <= 0
         || ! std::isfinite(cos_angle) )
     {
@@ -416,52 +659,21 @@ int64_t PolygonProximityLinker::proximityEndingDistance(Point& a1, Point& a2, Po
     }
 }
 
-void PolygonProximityLinker::addSharpCorners()
-{
-    for (ListPolygon& poly : list_polygons)
-    {
-        ListPolyIt here(poly, --poly.end());
-        ListPolyIt prev = here.prev();
-        for (ListPolygon::iterator it = poly.begin(); it != poly.end(); ++it)
-        {
-            ListPolyIt next(poly, it);
-
-            if (LinearAlg2D::isAcuteCorner(prev.p(), here.p(), next.p()) > 0)
-            {
-                addCornerLink(here, ProximityPointLinkType::SHARP_CORNER);
-            }
-
-            prev = here;
-            here = next;
-        }
-    }
-}
-
-void PolygonProximityLinker::addToPoint2LinkMap(Point p, ProximityPointLinks::iterator it)
-{
-    const ProximityPointLink& link = *it;
-    point_to_link.emplace(p, link); // copy element from proximity_point_links set to Point2Link map
-    assert(p == link.a.p() || p == link.b.p());
-}
-
-
 void PolygonProximityLinker::proximity2HTML(const char* filename) const
 {
-    PolygonProximityLinker copy = *this; // copy, cause getFlow might change the state of the overlap computation!
-
-    AABB aabb(copy.polygons);
+    AABB aabb(polygons);
 
     aabb.expand(200);
 
     SVG svg(filename, aabb, Point(1024 * 2, 1024 * 2));
 
 
-    svg.writeAreas(copy.polygons);
+    svg.writeAreas(polygons);
 
     { // output points and coords
-        for (ListPolygon poly : copy.list_polygons)
+        for (ConstPolygonRef poly : polygons)
         {
-            for (Point& p : poly)
+            for (const Point& p : poly)
             {
                 svg.writePoint(p, true);
             }
@@ -470,33 +682,15 @@ void PolygonProximityLinker::proximity2HTML(const char* filename) const
 
     { // output links
         // output normal links
-        for (const ProximityPointLink& link : copy.proximity_point_links)
+        for (size_t link = 0; link < link_a.size(); link++)
         {
-            svg.writePoint(link.a.p(), false, 3, SVG::Color::GRAY);
-            svg.writePoint(link.b.p(), false, 3, SVG::Color::GRAY);
-            Point a = svg.transform(link.a.p());
-            Point b = svg.transform(link.b.p());
-            svg.printf("<line x1=\"%lli\" y1=\"%lli\" x2=\"%lli\" y2=\"%lli\" style=\"stroke:rgb(%d,%d,0);stroke-width:1\" />", a.X, a.Y, b.X, b.Y, link.dist == proximity_distance? 0 : 255, link.dist==proximity_distance? 255 : 0);
+            svg.writePoint(getPoint(link_a[link]), false, 3, SVG::Color::GRAY);
+            svg.writePoint(getPoint(link_b[link]), false, 3, SVG::Color::GRAY);
+            Point a = svg.transform(getPoint(link_a[link]));
+            Point b = svg.transform(getPoint(link_b[link]));
+            svg.printf("<line x1=\"%lli\" y1=\"%lli\" x2=\"%lli\" y2=\"%lli\" style=\"stroke:rgb(%d,%d,0);stroke-width:1\" />", a.X, a.Y, b.X, b.Y, link_dist[link] == proximity_distance? 0 : 255, link_dist[link] == proximity_distance? 255 : 0);
         }
     }
 }
 
-bool PolygonProximityLinker::isLinked(ListPolyIt a, ListPolyIt b)
-{
-    ProximityPointLink test_link(a, b, 0, ProximityPointLinkType::NORMAL);
-    return proximity_point_links.find(test_link) != proximity_point_links.end();
-}
-
-const ProximityPointLink* PolygonProximityLinker::getLink(ListPolyIt a, ListPolyIt b)
-{
-    ProximityPointLink test_link(a, b, 0, ProximityPointLinkType::NORMAL);
-    ProximityPointLinks::const_iterator found = proximity_point_links.find(test_link);
-
-    if (found != proximity_point_links.end())
-    {
-        return &*found;
-    }
-    return nullptr;
-}
-
-}//namespace cura 
+}//namespace cura
@@ -1,220 +1,246 @@
-//Copyright (c) 2018 Ultimaker B.V.
+//Copyright (c) 2019 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
 #ifndef UTILS_POLYGON_PROXIMITY_LINKER_H
 #define UTILS_POLYGON_PROXIMITY_LINKER_H
 
-#include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <list>
 #include <utility> // pair
-
-#include <functional> // hash function object
+#include <vector>
 
 #include "IntPoint.h"
 #include "polygon.h"
 
-#include "ListPolyIt.h"
-#include "ProximityPointLink.h"
-#include "SparseLineGrid.h"
+namespace cura
+{
 
-namespace cura 
+/*!
+ * Type of link signifying why/how it was created
+ */
+enum class ProximityPointLinkType
 {
+    NORMAL, // Point is close to line segment or to another point
+    ENDING, // link where two line segments diverge and have the maximum proximity, i.e. where the overlap will be zero
+    ENDING_CORNER, // when an overlap area ends in a point
+    SHARP_CORNER // The corner in the polygon is so sharp that it will overlap with itself
+};
 
 /*!
  * Class for computing which parts of polygons are close to which other parts of polygons
  * A link always occurs between a point already on a polygon and either another point of a polygon or a point on a line segment of a polygon.
- * 
+ *
  * In the latter case we insert the point into the polygon so that we can later look up by how much to reduce the extrusion at the corresponding line segment.
- * This is the reason that the polygons are converted to (linked) lists before the proximity linking computation takes place, after which they are converted back.
- * 
+ *
  * At the end of a sequence of proximity links the polygon segments diverge away from each other.
  * Therefore points are introduced on the line segments involved and a link is created with a link distance of exactly the PolygonProximityLinker::proximity_distance.
- * 
- * We end up with links which include a boolean field to represent whether the link is already processed from outside.
- * This is used by functions which use the PolygonProximityLinker class when there is being looped over points in a polygon, which by definition loops over all links twice.
- * 
- * Each point on the polygons maps to a link, so that we can easily look up which links corresponds to the current line segment being handled when compensating for wall overlaps for example.
- * 
- * The main functionality of this class is performed by the constructor.
+ *
+ * Each point on the polygons maps to its links, so that we can easily look up which links corresponds to the current line segment being handled when compensating for wall overlaps for example.
+ *
+ * The main functionality of this class is performed by the constructor. After
+ * that it can't be changed, so it can be computed beforehand and be used by
+ * several threads at the same time.
+ *
+ * Everything is stored in flat arrays. The vertices of all polygons are
+ * numbered consecutively, and the links are stored as a structure of arrays,
+ * indexed by link number. The points that are inserted on line segments are
+ * gathered per step of the computation and put in place all at once, sorted
+ * along their line segment, so the result doesn't depend on the order in which
+ * they are found.
  */
 class PolygonProximityLinker
 {
 public:
-    typedef std::unordered_set<ProximityPointLink> ProximityPointLinks; //!< The type of PolygonProximityLinker::overlap_point_links
-    typedef std::unordered_multimap<Point, ProximityPointLink> Point2Link; //!< The type of PolygonProximityLinker::point_to_link
+    static constexpr size_t NO_LINK = static_cast<size_t>(-1); //!< Returned by getLink if two vertices aren't linked.
+
+    //! A range of link numbers, from the first (inclusive) to the last (exclusive).
+    using LinkRange = std::pair<std::vector<size_t>::const_iterator, std::vector<size_t>::const_iterator>;
 
-private:
-    /////////////////////////////////////////////////////////////////////////////////////////////
     /*!
-     * Locator to retrieve line segment data from a \ref ListPolyIt
+     * Computes the neccesary priliminaries in order to efficiently compute the flow when generatign gcode paths.
+     * \param polygons The wall polygons for which to compute the overlaps
+     * \param proximity_distance The distance below which parts of the polygons
+     * are linked to each other.
      */
-    struct ListPolyItSegmentLocator
-    {
-        std::pair<Point, Point> operator()(const ListPolyIt& val) const
-        {
-            return std::pair<Point, Point>(val.p(), val.next().p());
-        }
-    };
-
-    Polygons& polygons; //!< The polygons for which to compensate overlapping walls for
-    ListPolygons list_polygons; //!< The PolygonProximityLinker::polygons converted
-
-    int proximity_distance; //!< The line width of the walls
-    int proximity_distance_2; //!< The squared line width of the walls
+    PolygonProximityLinker(const Polygons& polygons, const coord_t proximity_distance);
 
-    SparseLineGrid<ListPolyIt, ListPolyItSegmentLocator> line_grid; //!< Mapping from locations to lines
+    /*!
+     * The polygons, with points inserted wherever a link needed one.
+     *
+     * They are in the same order as the polygons given to the constructor.
+     */
+    const Polygons& getPolygons() const;
 
-    std::unordered_set<ListPolyIt> new_points; //!< The newly inserted points to create new links.
+    /*!
+     * The distance below which parts of the polygons are linked.
+     */
+    coord_t getProximityDistance() const;
 
-    ProximityPointLinks proximity_point_links; //!< mapping from each link to its attributes
+    /*!
+     * Check whether a point has any links
+     * \param from the point for which to check whether it has any links
+     * \return Whether a link has been created between the point and another point
+     */
+    bool isLinked(const Point from) const;
 
-    Point2Link point_to_link; //!< mapping from each point to the/a corresponding link (collisions are ignored as of yet)
+    /*!
+     * Get all links connected to a given point.
+     *
+     * \param from The point to get all connected links for
+     * \return The range of the numbers of the links, which is empty if the
+     * point has no links.
+     */
+    LinkRange getLinks(const Point from) const;
 
     /*!
-     * Create the initial \ref PolygonProximityLinker::line_grid
-     * 
-     * Map locations where line segments of the input polygons occur to iterators pointing to the start of those line segments.
-     * 
-     * Note that when points are introduced which split line segments in two,
-     * the line_grid maps locations to segments which are not close any more.
+     * Get the link between two vertices if they are linked.
+     * \param a The one vertex.
+     * \param b The other vertex.
+     * \return The number of the link between the two vertices, or NO_LINK.
      */
-    void createLineGrid();
+    size_t getLink(const size_t a, const size_t b) const;
+
+    const Point& getPoint(const size_t vertex) const; //!< The location of a vertex.
+    size_t getNext(const size_t vertex) const; //!< The vertex after a vertex in its polygon.
+    size_t getPrev(const size_t vertex) const; //!< The vertex before a vertex in its polygon.
 
-    void findProximatePoints(); //!< find the basic proximity links (for trapezoids) and record them into PolygonProximityLinker::overlap_point_links
+    size_t getLinkA(const size_t link) const; //!< The one vertex of a link.
+    size_t getLinkB(const size_t link) const; //!< The other vertex of a link.
+    coord_t getLinkDist(const size_t link) const; //!< The distance between the two vertices of a link.
+    ProximityPointLinkType getLinkType(const size_t link) const; //!< Why the link was created.
 
+    void proximity2HTML(const char* filename) const; //!< debug
+
+private:
     /*!
-     * Find the basic proximity link (for a trapezoid) between a given point and a line segment
-     * and record them into PolygonProximityLinker::overlap_point_links
-     * 
-     * \param a_point_it Iterator to the point from which to check for proximity
-     * \param to_list_poly The polygon in which the line segment occurs
-     * \param b_from_it iterator to the one end point of the line segment
-     * \param b_to_it iterator to the other end point of the line segment
+     * A point to insert on the line segment from a vertex to the next.
      */
-    void findProximatePoints(const ListPolyIt a_point_it, ListPolygon& to_list_poly, const ListPolyIt b_from_it, const ListPolyIt b_to_it);
+    struct Insertion
+    {
+        size_t segment; //!< The vertex at the start of the line segment.
+        Point point; //!< Where to insert the point.
+    };
+
+    coord_t proximity_distance; //!< The line width of the walls
+    coord_t proximity_distance_2; //!< The squared line width of the walls
+
+    Polygons polygons; //!< The polygons for which to compensate overlapping walls, with the inserted points.
+    std::vector<size_t> polygon_starts; //!< For each polygon the number of its first vertex, with the total number of vertices at the end.
+    std::vector<size_t> vertex_polygon; //!< For each vertex the polygon it belongs to.
+
+    std::vector<size_t> link_a; //!< For each link the one vertex. The order of the two vertices doesn't matter.
+    std::vector<size_t> link_b; //!< For each link the other vertex.
+    std::vector<coord_t> link_dist; //!< For each link the distance between the two points
+    std::vector<ProximityPointLinkType> link_type; //!< For each link why/how it was created
+
+    std::vector<size_t> vertex_link_starts; //!< For each vertex where its links start in #vertex_links, with the total at the end.
+    std::vector<size_t> vertex_links; //!< The links of all vertices, grouped per vertex.
+
+    std::vector<Point> linked_points; //!< The locations of all linked vertices, sorted and without duplicates.
+    std::vector<size_t> point_link_starts; //!< For each of the linked points where its links start in #point_links, with the total at the end.
+    std::vector<size_t> point_links; //!< The links of all linked points, grouped per point.
 
     /*!
-     * Add a new point to the polygon on a line segment between \p line_start and \p line_end
-     * 
-     * Don't add the point if it's already the same as either of the end points of the line segment.
-     * 
-     * \param point The point to insert
-     * \param line_start The start of the line segment on which to insert
-     * \param line_end The end of the line segment on which to insert
-     * \param before_this Either \p line_start or \p line_end such that inserting the new point before \p before_this results in the point being in between the two
-     * \return An iterator to the newly inserted point, or an existing point if \p coincided with either end point of the line
+     * Check whether a vertex or any other vertex at the same location has any
+     * links. This is the same as \ref isLinked for its location, but faster.
      */
-    ListPolyIt addNewPolyPoint(const Point point, const ListPolyIt line_start, const ListPolyIt line_end, const ListPolyIt before_this);
+    bool vertexIsLinked(const size_t vertex) const;
 
     /*!
-     * Add a link between \p from and \p to to PolygonProximityLinker::overlap_point_links and add the appropriate mappings to PolygonProximityLinker::point_to_link
-     * 
-     * \param from The one point of the link
-     * \param to The other point of the link
-     * \param dist The distance between the two points
-     * \param type The type of the link being introduced
-     * \return Whether the point has been added
+     * Number the vertices of #polygons, filling #polygon_starts and
+     * #vertex_polygon.
      */
-    bool addProximityLink(ListPolyIt from, ListPolyIt to, int64_t dist, const ProximityPointLinkType type);
-
+    void indexVertices();
 
     /*!
-     * Add a link for the corner at \p corner_point to PolygonProximityLinker::overlap_point_links and add the appropriate mappings to PolygonProximityLinker::point_to_link
-     * 
-     * This is done by adding a link between the point and itself.
-     * 
-     * \param corner_point The one point of the link
-     * \param type The type of the link being introduced
-     * \return Whether the point has been added
+     * Remove the links between the same two vertices as an earlier link.
      */
-    bool addCornerLink(ListPolyIt corner_point, const ProximityPointLinkType type);
+    void removeDuplicateLinks();
 
     /*!
-     * Add links for the ending points of proximity regions, supporting the residual triangles.
+     * Fill the lookup tables from vertices and points to links.
+     *
+     * \param link_count The number of links to look up, from the first one.
+     * The links after these are left out, as if they weren't made yet.
      */
-    void addProximityEndings();
+    void indexLinks(const size_t link_count);
 
     /*!
-     * Add a link for the ending point of a given proximity region, if it is an ending.
-     * 
-     * \param link_pair The link which might be an ending
-     * \param a_next The next point from ListPolyIt::a of \p link 
-     * \param b_next The next point from ListPolyIt::b of \p link (in the opposite direction of \p a_next)
-     * \param a_before_middle Where to insert a new point for a if this is indeed en ending
-     * \param b_before_middle Where to insert a new point for b if this is indeed en ending
-     * \param[out] result Where to store a link if a new one has been generated
+     * Insert points on the line segments of the polygons.
+     *
+     * Links may refer to the inserted points before they are inserted: the
+     * insertion at index \p i is referred to as vertex number
+     * <tt>vertex_count + i</tt>. All links are renumbered afterwards.
+     * \param insertions The points to insert, in any order. A point which is
+     * at an end point of its line segment or at the same location as another
+     * insertion on the same line segment becomes that vertex.
+     * \return The numbers of the vertices that were inserted, in increasing
+     * order.
      */
-    void addProximityEnding(const ProximityPointLink& link, const ListPolyIt& a_next, const ListPolyIt& b_next, const ListPolyIt& a_before_middle, const ListPolyIt& b_before_middle, ProximityPointLinks& result);
+    std::vector<size_t> insertPoints(const std::vector<Insertion>& insertions);
 
     /*!
-     * Compute the distance between the points of the last link and the points introduced to account for the proximity endings.
+     * Add a link, even if the two vertices are linked already.
      */
-    int64_t proximityEndingDistance(Point& a1, Point& a2, Point& b1, Point& b2, int a1b1_dist);
+    void addLink(const size_t a, const size_t b, const coord_t dist, const ProximityPointLinkType type);
 
     /*!
-     * Add proximity links for sharp corners, so that the proximity of two consecutive line segments is compensated for.
-     * 
-     * Currently UNIMPLEMENTED.
+     * Link each sharp corner to itself, so that the proximity of two
+     * consecutive line segments is compensated for.
      */
     void addSharpCorners();
 
     /*!
-     * Map a point to a link in PolygonProximityLinker::point_to_link
-     * 
-     * \param p The key
-     * \param it The value
+     * Find the basic proximity links (for trapezoids): between each vertex and
+     * the nearby line segments, and then between the inserted points and the
+     * nearby vertices.
      */
-    void addToPoint2LinkMap(Point p, ProximityPointLinks::iterator it);
-
-public:
-    void proximity2HTML(const char* filename) const; //!< debug
+    void findProximatePoints();
 
     /*!
-     * Computes the neccesary priliminaries in order to efficiently compute the flow when generatign gcode paths.
-     * \param polygons The wall polygons for which to compute the overlaps
+     * Find the basic proximity link (for a trapezoid) between a given vertex and a line segment
+     *
+     * \param a_vertex The vertex from which to check for proximity
+     * \param b_from The vertex at the start of the line segment
+     * \param[out] insertions Where to put the point that the link needs on the
+     * line segment, if any.
      */
-    PolygonProximityLinker(Polygons& polygons, int proximity_distance);
+    void findProximatePoints(const size_t a_vertex, const size_t b_from, std::vector<Insertion>& insertions);
 
     /*!
-     * Check whether a point has any links
-     * \param from the point for which to check whether it has any links
-     * \return Whether a link has been created between the point and another point
+     * Add links for the ending points of proximity regions, supporting the residual triangles.
      */
-    bool isLinked(Point from);
+    void addProximityEndings();
 
     /*!
-     * Get all links connected to a given point.
-     * 
-     * The returned pair is an iterator range;
-     * The first is the starting iterator (inclusive)
-     * and the second is the end iterator (exclusive).
-     * 
-     * Note that the returned iterators point to a pair,
-     * for which the second is the actual link.
-     * The first is \p from
-     * 
-     * \param from The point to get all connected links for
-     * \return a pair containing two iterators
+     * Add a link for the ending point of a given proximity region in one
+     * direction, if it is an ending.
+     *
+     * \param link The link which might be an ending
+     * \param forward Whether to look past the next vertex from the A vertex
+     * of \p link rather than the previous one.
+     * \param[out] insertions Where to put the points that the new link needs.
+     * \return Whether it was decided, i.e. false if the next vertices on both
+     * sides are linked.
      */
-    std::pair<PolygonProximityLinker::Point2Link::iterator, PolygonProximityLinker::Point2Link::iterator> getLinks(Point from);
+    bool addProximityEnding(const size_t link, const bool forward, std::vector<Insertion>& insertions);
 
     /*!
-     * Check whether two points are linked
-     * \param a an iterator to the first point (in \ref PolygonProximityLinker::list_polygons)
-     * \param b an iterator to the second point (in \ref PolygonProximityLinker::list_polygons)
-     * \return Whether a link has been created between the two points
+     * Add a link for the ending point of a given proximity region, if it is an ending.
+     *
+     * \param link The link which might be an ending
+     * \param a2 The next vertex from the A vertex of \p link
+     * \param b2 The next vertex from the B vertex of \p link (in the opposite direction of \p a2)
+     * \param a_segment The start of the line segment between the A vertex and \p a2
+     * \param b_segment The start of the line segment between the B vertex and \p b2
+     * \param[out] insertions Where to put the points that the new link needs.
+     * \return Whether it was decided, i.e. false if \p a2 and \p b2 are both
+     * linked.
      */
-    bool isLinked(ListPolyIt a, ListPolyIt b);
+    bool addProximityEnding(const size_t link, const size_t a2, const size_t b2, const size_t a_segment, const size_t b_segment, std::vector<Insertion>& insertions);
 
     /*!
-     * Get the link between two points if they are linked already
-     * \param a an iterator to the first point (in \ref PolygonProximityLinker::list_polygons)
-     * \param b an iterator to the second point (in \ref PolygonProximityLinker::list_polygons)
-     * \return The link between the two points, or nullptr
+     * Compute the distance between the points of the last link and the points introduced to account for the proximity endings.
      */
-    const ProximityPointLink* getLink(ListPolyIt a, ListPolyIt b);
+    int64_t proximityEndingDistance(const Point a1, const Point a2, const Point b1, const Point b2, const coord_t a1b1_dist) const;
 };
 
 
@@ -0,0 +1,78 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include "PolygonsInsideTester.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+PolygonsInsideTester::PolygonsInsideTester()
+{
+}
+
+PolygonsInsideTester::PolygonsInsideTester(const Polygons& polygons)
+{
+    const size_t point_count = polygons.pointCount() + polygons.size();
+    xs.reserve(point_count);
+    ys.reserve(point_count);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        if (polygon.size() < 3) //Clipper considers no point to be inside of these, not even on their border.
+        {
+            continue;
+        }
+        PolygonRange range;
+        range.aabb = AABB(polygon);
+        range.begin = xs.size();
+        for (const Point& point : polygon)
+        {
+            xs.push_back(point.X);
+            ys.push_back(point.Y);
+        }
+        range.end = xs.size();
+        xs.push_back(polygon[0].X);
+        ys.push_back(polygon[0].Y);
+        this->polygons.push_back(range);
+    }
+}
+
+bool PolygonsInsideTester::inside(const Point p, const bool border_result) const
+{
+    bool inside = false;
+    for (const PolygonRange& polygon : polygons)
+    {
+        //Outside of the bounding box, the point is not on the border and the edges cross the horizontal line through it an even number of times.
+        if (!polygon.aabb.contains(p))
+        {
+            continue;
+        }
+        //The same tests as ClipperLib::PointInPolygon, but combined with bitwise operators instead of branching on each of them.
+        const coord_t* x = xs.data();
+        const coord_t* y = ys.data();
+        unsigned int crossings = 0;
+        bool polygon_border = false;
+        for (size_t point_idx = polygon.begin; point_idx < polygon.end; point_idx++)
+        {
+            const coord_t ax = x[point_idx];
+            const coord_t ay = y[point_idx];
+            const coord_t bx = x[point_idx + 1];
+            const coord_t by = y[point_idx + 1];
+            const bool straddles = (ay < p.Y) != (by < p.Y);
+            const bool both_right = (ax >= p.X) & (bx > p.X);
+            const bool both_left = (ax < p.X) & (bx <= p.X);
+            const bool uncertain = straddles & !both_right & !both_left; //One end is to the left and one to the right, so it depends on where the edge crosses.
+            const double d = static_cast<double>(ax - p.X) * (by - p.Y) - static_cast<double>(bx - p.X) * (ay - p.Y);
+            crossings += (straddles & both_right) | (uncertain & ((d > 0) == (by > ay)));
+            polygon_border |= ((by == p.Y) & ((bx == p.X) | ((ay == p.Y) & ((bx > p.X) == (ax < p.X))))) | (uncertain & (d == 0));
+        }
+        if (polygon_border)
+        {
+            return border_result;
+        }
+        inside ^= crossings & 1;
+    }
+    return inside;
+}
+
+} //namespace cura
@@ -0,0 +1,80 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_POLYGONS_INSIDE_TESTER_H
+#define UTILS_POLYGONS_INSIDE_TESTER_H
+
+#include <vector>
+
+#include "AABB.h"
+#include "IntPoint.h"
+
+namespace cura
+{
+
+class Polygons;
+
+/*!
+ * \brief Tests whether points are inside some polygons, for when many points
+ * are tested against the same polygons.
+ *
+ * Gives the same results as \ref Polygons::inside, but prepares the polygons
+ * once: the bounding box of each polygon is computed so that polygons that
+ * are far from a point are skipped, and the coordinates are copied into
+ * separate arrays of X and Y coordinates. The crossings are counted without
+ * branching on each edge, so that the compiler may vectorise the loop.
+ */
+class PolygonsInsideTester
+{
+public:
+    /*!
+     * \brief Create a tester without any polygons, with which no point is
+     * inside.
+     */
+    PolygonsInsideTester();
+
+    /*!
+     * \brief Prepare polygons for testing.
+     *
+     * The tester keeps a copy, so \p polygons may change afterwards.
+     */
+    PolygonsInsideTester(const Polygons& polygons);
+
+    /*!
+     * \brief Check whether a point is inside the polygons.
+     *
+     * Like \ref Polygons::inside, a point is inside if it is inside an odd
+     * number of polygons.
+     * \param p The point to test.
+     * \param border_result What to return when the point is exactly on the
+     * border of one of the polygons.
+     */
+    bool inside(const Point p, const bool border_result = false) const;
+
+    /*!
+     * \brief Whether there are no polygons that a point could be inside of.
+     */
+    bool empty() const
+    {
+        return polygons.empty();
+    }
+
+private:
+    /*!
+     * \brief Where the coordinates of a polygon are, and its bounding box.
+     */
+    struct PolygonRange
+    {
+        AABB aabb; //!< The bounding box of the polygon.
+        size_t begin; //!< The index of the first point in #xs and #ys.
+        size_t end; //!< The index of the last point, which is a copy of the first point.
+    };
+
+    std::vector<PolygonRange> polygons; //!< The polygons with at least three points.
+    std::vector<coord_t> xs; //!< The X coordinates of the points of all polygons, with the first point of each polygon repeated after its last point.
+    std::vector<coord_t> ys; //!< The Y coordinates, in the same order as #xs.
+};
+
+} //namespace cura
+
+#endif //UTILS_POLYGONS_INSIDE_TESTER_H
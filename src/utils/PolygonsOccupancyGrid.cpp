@@ -0,0 +1,167 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For min, max and sort.
+#include <cassert>
+#include <cmath> //For floor and ceil.
+
+#include "AABB.h"
+#include "PolygonsOccupancyGrid.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+PolygonsOccupancyGrid::PolygonsOccupancyGrid(const Polygons& polygons, const coord_t cell_size)
+: PolygonsOccupancyGrid(polygons, cell_size, AABB(Point(POINT_MIN, POINT_MIN), Point(POINT_MAX, POINT_MAX)))
+{
+}
+
+PolygonsOccupancyGrid::PolygonsOccupancyGrid(const Polygons& polygons, const coord_t cell_size, const AABB& region)
+: cell_size(cell_size)
+, origin(0, 0)
+, column_count(0)
+, row_count(0)
+, exact_tester(polygons)
+{
+    assert(cell_size > 0);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        if (polygon.size() >= 3) //Like in Polygons::inside, no point is inside of the others.
+        {
+            bounding_box.include(AABB(polygon));
+        }
+    }
+    //Only make cells where the region and the polygons overlap.
+    const Point grid_min(std::max(bounding_box.min.X, region.min.X), std::max(bounding_box.min.Y, region.min.Y));
+    const Point grid_max(std::min(bounding_box.max.X, region.max.X), std::min(bounding_box.max.Y, region.max.Y));
+    if (grid_min.X > grid_max.X || grid_min.Y > grid_max.Y) //No polygons there, so nothing is known beyond the bounding box.
+    {
+        return;
+    }
+
+    //Leave a cell of margin on all sides, so that the polygons are never near the edge of the grid if it covers all of them.
+    origin = grid_min - Point(cell_size, cell_size);
+    column_count = (grid_max.X - origin.X) / cell_size + 2;
+    row_count = (grid_max.Y - origin.Y) / cell_size + 2;
+    cells.assign(column_count * row_count, Occupancy::OUTSIDE);
+
+    //Find where the edges cross the horizontal line through the middle of each row.
+    //An edge crosses it if the line is above the lowest end and at or below the highest end, like the crossings counted in Polygons::inside.
+    const coord_t half_cell = cell_size / 2;
+    std::vector<std::vector<double>> crossings_per_row(row_count);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        if (polygon.size() < 3)
+        {
+            continue;
+        }
+        Point a = polygon.back();
+        for (const Point& b : polygon)
+        {
+            const coord_t min_y = std::min(a.Y, b.Y);
+            const coord_t max_y = std::max(a.Y, b.Y);
+            //Rows below the grid have a negative index, so round that towards minus infinity.
+            const coord_t first_row = std::max(coord_t(0), floorDivide(min_y - origin.Y - half_cell, cell_size) + 1);
+            const coord_t last_row = std::min(row_count - 1, floorDivide(max_y - origin.Y - half_cell, cell_size));
+            for (coord_t row = first_row; row <= last_row; row++)
+            {
+                const coord_t y = origin.Y + row * cell_size + half_cell;
+                crossings_per_row[row].push_back(a.X + static_cast<double>(b.X - a.X) * (y - a.Y) / (b.Y - a.Y));
+            }
+            markEdge(a, b);
+            a = b;
+        }
+    }
+
+    //A cell that no edge passes through is completely inside or outside, like the middle of the cell.
+    for (coord_t row = 0; row < row_count; row++)
+    {
+        std::vector<double>& crossings = crossings_per_row[row];
+        std::sort(crossings.begin(), crossings.end());
+        size_t crossings_left = 0;
+        for (coord_t column = 0; column < column_count; column++)
+        {
+            const coord_t x = origin.X + column * cell_size + half_cell;
+            while (crossings_left < crossings.size() && crossings[crossings_left] < x)
+            {
+                crossings_left++;
+            }
+            Occupancy& cell = cells[row * column_count + column];
+            if (cell != Occupancy::NEAR_BORDER && crossings_left % 2 == 1)
+            {
+                cell = Occupancy::INSIDE;
+            }
+        }
+    }
+}
+
+void PolygonsOccupancyGrid::markEdge(const Point a, const Point b)
+{
+    const coord_t min_y = std::min(a.Y, b.Y);
+    const coord_t max_y = std::max(a.Y, b.Y);
+    //Include the rows within a unit of the edge, so that rounding never leaves out a cell that the edge touches.
+    const coord_t first_row = std::max(coord_t(0), floorDivide(min_y - 1 - origin.Y, cell_size));
+    const coord_t last_row = std::min(row_count - 1, floorDivide(max_y + 1 - origin.Y, cell_size));
+    for (coord_t row = first_row; row <= last_row; row++)
+    {
+        //The part of the edge within this row lies between the X coordinates of the edge at the bottom and top of the row.
+        const coord_t row_min_y = std::min(max_y, std::max(min_y, origin.Y + row * cell_size));
+        const coord_t row_max_y = std::min(max_y, std::max(min_y, origin.Y + (row + 1) * cell_size));
+        double min_x = std::min(a.X, b.X);
+        double max_x = std::max(a.X, b.X);
+        if (a.Y != b.Y)
+        {
+            const double x_at_min_y = a.X + static_cast<double>(b.X - a.X) * (row_min_y - a.Y) / (b.Y - a.Y);
+            const double x_at_max_y = a.X + static_cast<double>(b.X - a.X) * (row_max_y - a.Y) / (b.Y - a.Y);
+            min_x = std::min(x_at_min_y, x_at_max_y);
+            max_x = std::max(x_at_min_y, x_at_max_y);
+        }
+        const coord_t first_column = std::max(coord_t(0), floorDivide(static_cast<coord_t>(std::floor(min_x)) - 1 - origin.X, cell_size));
+        const coord_t last_column = std::min(column_count - 1, floorDivide(static_cast<coord_t>(std::ceil(max_x)) + 1 - origin.X, cell_size));
+        for (coord_t column = first_column; column <= last_column; column++)
+        {
+            cells[row * column_count + column] = Occupancy::NEAR_BORDER;
+        }
+    }
+}
+
+PolygonsOccupancyGrid::Occupancy PolygonsOccupancyGrid::getOccupancy(const Point p) const
+{
+    if (!bounding_box.contains(p))
+    {
+        return Occupancy::OUTSIDE;
+    }
+    if (p.X < origin.X || p.Y < origin.Y)
+    {
+        return Occupancy::NEAR_BORDER;
+    }
+    const coord_t column = (p.X - origin.X) / cell_size;
+    const coord_t row = (p.Y - origin.Y) / cell_size;
+    if (column >= column_count || row >= row_count)
+    {
+        return Occupancy::NEAR_BORDER;
+    }
+    return cells[row * column_count + column];
+}
+
+coord_t PolygonsOccupancyGrid::floorDivide(const coord_t dividend, const coord_t divisor)
+{
+    const coord_t quotient = dividend / divisor;
+    return (dividend % divisor < 0) ? quotient - 1 : quotient;
+}
+
+bool PolygonsOccupancyGrid::inside(const Point p, const bool border_result) const
+{
+    switch (getOccupancy(p))
+    {
+        case Occupancy::INSIDE:
+            return true;
+        case Occupancy::OUTSIDE:
+            return false;
+        default:
+            return exact_tester.inside(p, border_result);
+    }
+}
+
+} //namespace cura
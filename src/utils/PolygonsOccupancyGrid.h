@@ -0,0 +1,115 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_POLYGONS_OCCUPANCY_GRID_H
+#define UTILS_POLYGONS_OCCUPANCY_GRID_H
+
+#include <cstdint> //For uint8_t.
+#include <vector>
+
+#include "AABB.h"
+#include "IntPoint.h"
+#include "PolygonsInsideTester.h"
+
+namespace cura
+{
+
+class Polygons;
+
+/*!
+ * \brief A raster of square cells over some polygons, which tells for each
+ * cell whether it is completely inside, completely outside or near the border
+ * of the polygons.
+ *
+ * This is for when very many points are tested against the same polygons.
+ * Most points then only need a look-up of their cell. Only points in the cells
+ * that the border passes through are tested against the polygons themselves.
+ *
+ * The cells are filled in once, with a scanline through the middle of each row
+ * of cells. A cell is near the border if any edge passes through it or
+ * touches it. The memory it takes is a byte per cell, so the cell size should
+ * be chosen such that the bounding box of the polygons doesn't have a great
+ * many of them.
+ */
+class PolygonsOccupancyGrid
+{
+public:
+    /*!
+     * \brief What is known about the points in a cell.
+     */
+    enum class Occupancy : uint8_t
+    {
+        OUTSIDE, //!< All points in the cell are outside the polygons.
+        INSIDE, //!< All points in the cell are inside the polygons.
+        NEAR_BORDER //!< The border of the polygons passes through or touches the cell.
+    };
+
+    /*!
+     * \brief Rasterise polygons.
+     *
+     * The grid keeps a copy of the polygons for the points near the border, so
+     * \p polygons may change afterwards.
+     * \param polygons The polygons to rasterise. Like with
+     * \ref Polygons::inside, a point is inside if it is inside an odd number
+     * of them, and polygons with fewer than three points are skipped.
+     * \param cell_size The width and height of the cells.
+     */
+    PolygonsOccupancyGrid(const Polygons& polygons, const coord_t cell_size);
+
+    /*!
+     * \brief Rasterise the part of some polygons where points are going to be
+     * tested.
+     *
+     * Points beyond the region that may be inside the polygons are tested
+     * against the polygons themselves.
+     * \param polygons The polygons to rasterise.
+     * \param cell_size The width and height of the cells.
+     * \param region The area to make cells for.
+     */
+    PolygonsOccupancyGrid(const Polygons& polygons, const coord_t cell_size, const AABB& region);
+
+    /*!
+     * \brief Get what is known about a point without testing it against the
+     * polygons.
+     * \param p The point to look up.
+     * \return The occupancy of the cell that the point is in. Points beyond
+     * the grid are outside if they're beyond the polygons, or else near the
+     * border, since nothing is known about them.
+     */
+    Occupancy getOccupancy(const Point p) const;
+
+    /*!
+     * \brief Check whether a point is inside the polygons.
+     *
+     * Gives the same results as \ref Polygons::inside.
+     * \param p The point to test.
+     * \param border_result What to return when the point is exactly on the
+     * border of one of the polygons.
+     */
+    bool inside(const Point p, const bool border_result = false) const;
+
+private:
+    /*!
+     * \brief Mark the cells that an edge passes through or touches as near
+     * the border.
+     */
+    void markEdge(const Point a, const Point b);
+
+    /*!
+     * \brief Divide, rounding towards minus infinity, to get the cell of a
+     * coordinate that may be below the grid.
+     */
+    static coord_t floorDivide(const coord_t dividend, const coord_t divisor);
+
+    AABB bounding_box; //!< The bounding box of the polygons with at least three points.
+    coord_t cell_size; //!< The width and height of the cells.
+    Point origin; //!< The corner of the first cell, with the lowest coordinates.
+    coord_t column_count; //!< The number of cells in each row.
+    coord_t row_count; //!< The number of rows of cells.
+    std::vector<Occupancy> cells; //!< The occupancy of each cell, row after row.
+    PolygonsInsideTester exact_tester; //!< To test the points near the border with.
+};
+
+} //namespace cura
+
+#endif //UTILS_POLYGONS_OCCUPANCY_GRID_H
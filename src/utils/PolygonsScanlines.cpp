@@ -0,0 +1,161 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For min and max.
+#include <cassert>
+#include <cmath> //For llround.
+#include <functional>
+
+#include "PolygonsScanlines.h"
+#include "polygon.h"
+
+namespace cura
+{
+
+PolygonsScanlines::PolygonsScanlines(const Polygons& polygons, const coord_t first_y, const coord_t spacing)
+: first_y(first_y)
+, spacing(spacing)
+, min_band(0)
+{
+    assert(spacing > 0);
+    //Calls the function with each edge of the polygons that have at least three points, and the first and last band it is in.
+    const auto for_each_edge = [&polygons, this](const std::function<void (const Point, const Point, const coord_t, const coord_t)>& edge_func)
+    {
+        for (ConstPolygonRef polygon : polygons)
+        {
+            if (polygon.size() < 3) //Like in Polygons::inside, no point is inside of these.
+            {
+                continue;
+            }
+            Point a = polygon.back();
+            for (const Point& b : polygon)
+            {
+                edge_func(a, b, getBand(std::min(a.Y, b.Y)), getBand(std::max(a.Y, b.Y)));
+                a = b;
+            }
+        }
+    };
+
+    bool has_edges = false;
+    coord_t max_band = 0;
+    for_each_edge([&has_edges, &max_band, this](const Point, const Point, const coord_t first_band, const coord_t last_band)
+    {
+        min_band = has_edges ? std::min(min_band, first_band) : first_band;
+        max_band = has_edges ? std::max(max_band, last_band) : last_band;
+        has_edges = true;
+    });
+    if (!has_edges)
+    {
+        band_starts.push_back(0);
+        return;
+    }
+
+    //Count the edges of each band first, so that they can be put in place right away.
+    band_starts.assign(max_band - min_band + 2, 0);
+    for_each_edge([this](const Point, const Point, const coord_t first_band, const coord_t last_band)
+    {
+        for (coord_t band = first_band; band <= last_band; band++)
+        {
+            band_starts[band - min_band + 1]++;
+        }
+    });
+    for (size_t band_idx = 1; band_idx < band_starts.size(); band_idx++)
+    {
+        band_starts[band_idx] += band_starts[band_idx - 1];
+    }
+    edges.resize(band_starts.back());
+    std::vector<size_t> band_ends(band_starts.begin(), band_starts.end() - 1); //Where the next edge of each band goes.
+    for_each_edge([&band_ends, this](const Point a, const Point b, const coord_t first_band, const coord_t last_band)
+    {
+        for (coord_t band = first_band; band <= last_band; band++)
+        {
+            edges[band_ends[band - min_band]++] = Edge{a, b};
+        }
+    });
+}
+
+bool PolygonsScanlines::inside(const Point p, const bool border_result) const
+{
+    const coord_t band_idx = getBand(p.Y) - min_band;
+    if (band_idx < 0 || band_idx + 1 >= static_cast<coord_t>(band_starts.size()))
+    {
+        return false;
+    }
+    //Each edge that the horizontal line through the point crosses is in its band, and so is each edge that the point could be on.
+    //The same tests as ClipperLib::PointInPolygon, but for the edges of all polygons together, since a point is inside if it is inside an odd number of polygons.
+    unsigned int crossings = 0;
+    bool border = false;
+    for (size_t edge_idx = band_starts[band_idx]; edge_idx < band_starts[band_idx + 1]; edge_idx++)
+    {
+        const Point& a = edges[edge_idx].a;
+        const Point& b = edges[edge_idx].b;
+        const bool straddles = (a.Y < p.Y) != (b.Y < p.Y);
+        const bool both_right = (a.X >= p.X) & (b.X > p.X);
+        const bool both_left = (a.X < p.X) & (b.X <= p.X);
+        const bool uncertain = straddles & !both_right & !both_left; //One end is to the left and one to the right, so it depends on where the edge crosses.
+        const double d = static_cast<double>(a.X - p.X) * (b.Y - p.Y) - static_cast<double>(b.X - p.X) * (a.Y - p.Y);
+        crossings += (straddles & both_right) | (uncertain & ((d > 0) == (b.Y > a.Y)));
+        border |= ((b.Y == p.Y) & ((b.X == p.X) | ((a.Y == p.Y) & ((b.X > p.X) == (a.X < p.X))))) | (uncertain & (d == 0));
+    }
+    if (border)
+    {
+        return border_result;
+    }
+    return crossings & 1;
+}
+
+bool PolygonsScanlines::findFirstCrossing(const Point from, const Point to, Point& crossing) const
+{
+    const coord_t band_count = band_starts.size() - 1;
+    const coord_t first_band_idx = std::max(getBand(std::min(from.Y, to.Y)) - min_band, coord_t(0));
+    const coord_t last_band_idx = std::min(getBand(std::max(from.Y, to.Y)) - min_band, band_count - 1);
+    const Point direction = to - from;
+    bool found = false;
+    double closest_t = 0; //How far along the segment the closest crossing is, from 0 at from to 1 at to.
+    for (coord_t band_idx = first_band_idx; band_idx <= last_band_idx; band_idx++)
+    {
+        for (size_t edge_idx = band_starts[band_idx]; edge_idx < band_starts[band_idx + 1]; edge_idx++)
+        {
+            const Edge& edge = edges[edge_idx];
+            const Point edge_direction = edge.b - edge.a;
+            const Point to_edge = edge.a - from;
+            //The crossing is at from + direction * t_numerator / denominator and at edge.a + edge_direction * u_numerator / denominator.
+            coord_t denominator = direction.X * edge_direction.Y - direction.Y * edge_direction.X;
+            coord_t t_numerator = to_edge.X * edge_direction.Y - to_edge.Y * edge_direction.X;
+            coord_t u_numerator = to_edge.X * direction.Y - to_edge.Y * direction.X;
+            if (denominator == 0) //Parallel, so any overlap is not a crossing.
+            {
+                continue;
+            }
+            if (denominator < 0)
+            {
+                denominator = -denominator;
+                t_numerator = -t_numerator;
+                u_numerator = -u_numerator;
+            }
+            if (t_numerator <= 0 || t_numerator > denominator || u_numerator < 0 || u_numerator > denominator)
+            {
+                continue;
+            }
+            const double t = static_cast<double>(t_numerator) / denominator;
+            if (!found || t < closest_t)
+            {
+                closest_t = t;
+                found = true;
+            }
+        }
+    }
+    if (found)
+    {
+        crossing = from + Point(std::llround(direction.X * closest_t), std::llround(direction.Y * closest_t));
+    }
+    return found;
+}
+
+coord_t PolygonsScanlines::getBand(const coord_t y) const
+{
+    const coord_t from_first = y - first_y;
+    return (from_first >= 0) ? from_first / spacing : -((spacing - 1 - from_first) / spacing);
+}
+
+} //namespace cura
@@ -0,0 +1,97 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_POLYGONS_SCANLINES_H
+#define UTILS_POLYGONS_SCANLINES_H
+
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+class Polygons;
+
+/*!
+ * \brief The edges of some polygons, sorted into the bands between evenly
+ * spaced horizontal scanlines.
+ *
+ * This is for generating infill lines of which the points lie on the
+ * scanlines. A point is tested for being inside the polygons with only the
+ * edges of its band, and a line segment between two consecutive scanlines is
+ * clipped with only the edges of the band it lies in.
+ *
+ * The edges are stored in compressed sparse row form: all in one array,
+ * grouped per band. An edge is in every band that it overlaps, including the
+ * bands of which it only touches the bounding scanline.
+ */
+class PolygonsScanlines
+{
+public:
+    /*!
+     * \brief Sort the edges of polygons into bands.
+     *
+     * The scanlines are at Y coordinates \p first_y plus any multiple of
+     * \p spacing, including negative multiples.
+     * \param polygons The polygons to sort the edges of. Polygons with fewer
+     * than three points are skipped.
+     * \param first_y The Y coordinate of any of the scanlines.
+     * \param spacing The distance between consecutive scanlines.
+     */
+    PolygonsScanlines(const Polygons& polygons, const coord_t first_y, const coord_t spacing);
+
+    /*!
+     * \brief Check whether a point is inside the polygons.
+     *
+     * Gives the same results as \ref Polygons::inside, for any point, but
+     * only looks at the edges of the band that the point lies in.
+     * \param p The point to test.
+     * \param border_result What to return when the point is exactly on the
+     * border of one of the polygons.
+     */
+    bool inside(const Point p, const bool border_result = false) const;
+
+    /*!
+     * \brief Find where a line segment first crosses the border of the
+     * polygons.
+     *
+     * Crossings at \p from itself are ignored, so if \p from is on the border
+     * this finds where the segment crosses the border again.
+     * \param from The start of the line segment.
+     * \param to The end of the line segment.
+     * \param[out] crossing The crossing that is closest to \p from, rounded to
+     * the nearest point.
+     * \return Whether the line segment crosses the border anywhere after
+     * \p from.
+     */
+    bool findFirstCrossing(const Point from, const Point to, Point& crossing) const;
+
+private:
+    /*!
+     * \brief An edge of one of the polygons, in the direction of the polygon.
+     */
+    struct Edge
+    {
+        Point a; //!< The start of the edge.
+        Point b; //!< The end of the edge.
+    };
+
+    /*!
+     * \brief The band that a Y coordinate lies in, where band zero lies
+     * between #first_y and the next scanline.
+     *
+     * A coordinate on a scanline is in the band above it.
+     */
+    coord_t getBand(const coord_t y) const;
+
+    coord_t first_y; //!< The Y coordinate of one of the scanlines.
+    coord_t spacing; //!< The distance between consecutive scanlines.
+    coord_t min_band; //!< The lowest band that contains any edges.
+    std::vector<size_t> band_starts; //!< For each band from #min_band, the index of its first edge in #edges, with the total number of edges at the end.
+    std::vector<Edge> edges; //!< The edges of all bands, grouped per band.
+};
+
+} //namespace cura
+
+#endif //UTILS_POLYGONS_SCANLINES_H
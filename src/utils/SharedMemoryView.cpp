@@ -0,0 +1,100 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef _WIN32
+#include <windows.h> //OpenFileMappingA, MapViewOfFile.
+#else
+#include <fcntl.h> //For O_RDONLY.
+#include <sys/mman.h> //shm_open, mmap.
+#include <sys/stat.h> //fstat, for the size of the segment.
+#include <unistd.h> //close.
+#endif
+
+#include "logoutput.h"
+#include "SharedMemoryView.h"
+
+namespace cura
+{
+
+SharedMemoryView::SharedMemoryView(const std::string& name)
+: mapped_data(nullptr)
+, mapped_size(0)
+#ifdef _WIN32
+, mapping_handle(nullptr)
+#endif
+{
+#ifdef _WIN32
+    mapping_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!mapping_handle)
+    {
+        logError("Couldn't open shared memory %s.\n", name.c_str());
+        return;
+    }
+    void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        logError("Couldn't map shared memory %s.\n", name.c_str());
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+        return;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(view, &info, sizeof(info)); //Windows doesn't tell the size of a mapping, only of the pages it occupies.
+    mapped_data = static_cast<const char*>(view);
+    mapped_size = info.RegionSize;
+#else
+    const int file_descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+    if (file_descriptor < 0)
+    {
+        logError("Couldn't open shared memory %s.\n", name.c_str());
+        return;
+    }
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size <= 0)
+    {
+        logError("Shared memory %s is empty.\n", name.c_str());
+        close(file_descriptor);
+        return;
+    }
+    void* view = mmap(nullptr, file_status.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    close(file_descriptor); //The mapping stays valid without the descriptor.
+    if (view == MAP_FAILED)
+    {
+        logError("Couldn't map shared memory %s.\n", name.c_str());
+        return;
+    }
+    mapped_data = static_cast<const char*>(view);
+    mapped_size = file_status.st_size;
+#endif
+}
+
+SharedMemoryView::~SharedMemoryView()
+{
+    if (!mapped_data)
+    {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mapped_data);
+    CloseHandle(mapping_handle);
+#else
+    munmap(const_cast<char*>(mapped_data), mapped_size);
+#endif
+}
+
+bool SharedMemoryView::isValid() const
+{
+    return mapped_data != nullptr;
+}
+
+const char* SharedMemoryView::data() const
+{
+    return mapped_data;
+}
+
+size_t SharedMemoryView::size() const
+{
+    return mapped_size;
+}
+
+} //namespace cura
@@ -0,0 +1,72 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SHARED_MEMORY_VIEW_H
+#define UTILS_SHARED_MEMORY_VIEW_H
+
+#include <string>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Read-only mapping of a named shared memory segment.
+ *
+ * A front-end on the same machine can put large data, such as the vertices of
+ * a mesh, in a shared memory segment and only send the name of the segment.
+ * The engine then reads the data where it is, without serialising it through
+ * the socket and copying it out of a message.
+ *
+ * The segment is mapped as long as the view exists. The engine never writes to
+ * it and never removes it, since it's owned by the process that created it.
+ */
+class SharedMemoryView : NoCopy
+{
+public:
+    /*!
+     * \brief Map a shared memory segment.
+     *
+     * If the segment can't be opened or mapped, the view is empty. Check with
+     * \ref SharedMemoryView::isValid.
+     * \param name The name of the segment. On POSIX systems this is the name
+     * given to shm_open, starting with a slash. On Windows it's the name of a
+     * file mapping object.
+     */
+    SharedMemoryView(const std::string& name);
+
+    /*!
+     * \brief Unmaps the segment.
+     */
+    ~SharedMemoryView();
+
+    /*!
+     * \brief Whether the segment could be mapped.
+     */
+    bool isValid() const;
+
+    /*!
+     * \brief The start of the mapped segment, or nullptr if it isn't mapped.
+     *
+     * There is no guarantee on the alignment of the data in the segment beyond
+     * that of the page.
+     */
+    const char* data() const;
+
+    /*!
+     * \brief The size of the mapped segment in bytes.
+     */
+    size_t size() const;
+
+private:
+    const char* mapped_data; //!< Where the segment is mapped in our address space.
+    size_t mapped_size; //!< The size of the mapping.
+#ifdef _WIN32
+    void* mapping_handle; //!< The handle to the file mapping object.
+#endif
+};
+
+} //namespace cura
+
+#endif //UTILS_SHARED_MEMORY_VIEW_H
@@ -0,0 +1,281 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SMALL_VECTOR_H
+#define UTILS_SMALL_VECTOR_H
+
+#include <algorithm> //For max.
+#include <cassert>
+#include <cstdint> //For uint32_t.
+#include <cstring> //For memcpy and memmove.
+#include <iterator> //For distance.
+#include <new> //For placement new.
+#include <type_traits>
+#include <utility> //For forward.
+
+namespace cura
+{
+
+/*!
+ * \brief A sequence of elements like an ``std::vector``, which keeps its first
+ * few elements inside the object itself.
+ *
+ * As long as it has at most \p N elements, it doesn't allocate any memory.
+ * This is meant for the many short sequences that are kept alive in bulk,
+ * such as the points of the paths of a layer plan, most of which are only one
+ * or two points long. Beyond \p N elements, it grows like a vector.
+ *
+ * Only types that can be copied byte by byte are supported, so that elements
+ * can be moved between the inline storage and the heap with ``memcpy``.
+ *
+ * \tparam T The type of the elements.
+ * \tparam N How many elements fit without allocating memory.
+ */
+template<typename T, size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value, "The elements of a SmallVector are copied byte by byte.");
+    static_assert(N > 0, "A SmallVector must have room for at least one element inline.");
+
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    SmallVector()
+    : count(0)
+    , allocated(N)
+    {
+    }
+
+    SmallVector(const SmallVector& other)
+    : SmallVector()
+    {
+        insert(end(), other.begin(), other.end());
+    }
+
+    SmallVector(SmallVector&& other)
+    : count(other.count)
+    , allocated(other.allocated)
+    {
+        std::memcpy(&storage, &other.storage, sizeof(storage)); //Either the elements or the pointer to them.
+        other.count = 0;
+        other.allocated = N;
+    }
+
+    ~SmallVector()
+    {
+        if (!isInline())
+        {
+            ::operator delete(storage.heap);
+        }
+    }
+
+    SmallVector& operator=(const SmallVector& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            insert(end(), other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other)
+    {
+        if (this != &other)
+        {
+            this->~SmallVector();
+            new (this) SmallVector(std::move(other));
+        }
+        return *this;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    /*!
+     * \brief How many elements fit before memory needs to be allocated.
+     */
+    size_t capacity() const
+    {
+        return allocated;
+    }
+
+    /*!
+     * \brief Whether the elements are kept inside this object, without any
+     * memory allocated for them.
+     */
+    bool isInline() const
+    {
+        return allocated == N;
+    }
+
+    T* data()
+    {
+        return isInline() ? reinterpret_cast<T*>(&storage.inline_data) : storage.heap;
+    }
+
+    const T* data() const
+    {
+        return isInline() ? reinterpret_cast<const T*>(&storage.inline_data) : storage.heap;
+    }
+
+    iterator begin()
+    {
+        return data();
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    iterator end()
+    {
+        return data() + count;
+    }
+
+    const_iterator end() const
+    {
+        return data() + count;
+    }
+
+    T& operator[](const size_t index)
+    {
+        assert(index < count);
+        return data()[index];
+    }
+
+    const T& operator[](const size_t index) const
+    {
+        assert(index < count);
+        return data()[index];
+    }
+
+    T& front()
+    {
+        return (*this)[0];
+    }
+
+    const T& front() const
+    {
+        return (*this)[0];
+    }
+
+    T& back()
+    {
+        return (*this)[count - 1];
+    }
+
+    const T& back() const
+    {
+        return (*this)[count - 1];
+    }
+
+    void push_back(const T& element)
+    {
+        emplace_back(element);
+    }
+
+    template<typename... Args>
+    void emplace_back(Args&&... args)
+    {
+        if (count == allocated)
+        {
+            reallocate(allocated * 2);
+        }
+        new (data() + count) T(std::forward<Args>(args)...);
+        count++;
+    }
+
+    void pop_back()
+    {
+        assert(count > 0);
+        count--;
+    }
+
+    /*!
+     * \brief Remove all elements, but keep the memory that was allocated.
+     */
+    void clear()
+    {
+        count = 0;
+    }
+
+    /*!
+     * \brief Make sure that a number of elements fits without allocating
+     * again.
+     */
+    void reserve(const size_t minimum_capacity)
+    {
+        if (minimum_capacity > allocated)
+        {
+            reallocate(minimum_capacity);
+        }
+    }
+
+    /*!
+     * \brief Insert a range of elements before \p position.
+     * \return The position of the first inserted element.
+     */
+    template<typename InputIterator>
+    iterator insert(const_iterator position, InputIterator first, InputIterator last)
+    {
+        const size_t index = position - begin();
+        const size_t insert_count = std::distance(first, last);
+        if (count + insert_count > allocated)
+        {
+            reallocate(std::max(count + insert_count, static_cast<size_t>(allocated) * 2));
+        }
+        T* insert_start = data() + index;
+        std::memmove(insert_start + insert_count, insert_start, (count - index) * sizeof(T));
+        for (T* destination = insert_start; first != last; ++first, ++destination)
+        {
+            new (destination) T(*first);
+        }
+        count += insert_count;
+        return insert_start;
+    }
+
+private:
+    /*!
+     * \brief Move the elements to memory on the heap with room for more
+     * elements.
+     */
+    void reallocate(const size_t new_capacity)
+    {
+        assert(new_capacity > allocated);
+        T* new_data = static_cast<T*>(::operator new(new_capacity * sizeof(T)));
+        std::memcpy(new_data, data(), count * sizeof(T));
+        if (!isInline())
+        {
+            ::operator delete(storage.heap);
+        }
+        storage.heap = new_data;
+        allocated = new_capacity;
+    }
+
+    /*!
+     * \brief The elements themselves while they fit inline, or else a pointer
+     * to them.
+     */
+    union Storage
+    {
+        T* heap;
+        typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type inline_data;
+    } storage;
+    uint32_t count; //!< The number of elements.
+    uint32_t allocated; //!< The number of elements that fit, which is N while they are inline.
+};
+
+} //namespace cura
+
+#endif //UTILS_SMALL_VECTOR_H
@@ -0,0 +1,276 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_SPARSE_CELL_MAP_H
+#define UTILS_SPARSE_CELL_MAP_H
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "IntPoint.h"
+
+namespace cura
+{
+
+namespace SparseCellMapImpl
+{
+
+/*!
+ * \brief Hash the grid coordinates of a cell for the open addressing tables of
+ * the cell maps.
+ */
+inline uint64_t hashCell(const Point& cell)
+{
+    uint64_t hash = static_cast<uint64_t>(cell.X) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(cell.Y) * 0xC2B2AE3D27D4EB4Full;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} //namespace SparseCellMapImpl
+
+/*!
+ * \brief A map from grid cells to any number of elements each, for
+ * \ref SparseGrid.
+ *
+ * Unlike a std::unordered_multimap, this doesn't allocate a node for each
+ * element. The cells are kept in a single hash table with open addressing
+ * (linear probing) and the elements in a single array, in which the elements
+ * of each cell are linked to each other by their indices. Elements can only be
+ * added, not removed.
+ *
+ * The elements of a cell are visited from the last added to the first added,
+ * which is the same order as that of a std::unordered_multimap.
+ *
+ * \tparam ElemT The element type to store.
+ */
+template<class ElemT>
+class SparseCellMap
+{
+    /*!
+     * \brief The index of an element that doesn't exist, marking empty slots
+     * and the last element of each cell.
+     */
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    /*!
+     * \brief A slot in the hash table.
+     */
+    struct Slot
+    {
+        Point cell; //!< The grid coordinates of the cell.
+        uint32_t last_elem; //!< The index of the element that was added last to this cell, or NONE if the slot is empty.
+    };
+
+    /*!
+     * \brief An element with the index of the element that was added before it
+     * to the same cell.
+     */
+    struct Node
+    {
+        Node(const ElemT& elem, const uint32_t previous)
+        : elem(elem)
+        , previous(previous)
+        {
+        }
+
+        ElemT elem; //!< The element itself.
+        uint32_t previous; //!< The element that was added to the same cell before this one, or NONE if this was the first.
+    };
+
+public:
+    /*!
+     * \brief Goes over all elements, yielding each with the cell it is in.
+     */
+    class const_iterator : public std::iterator<std::forward_iterator_tag, std::pair<Point, ElemT>>
+    {
+    public:
+        const_iterator(const SparseCellMap* map, const size_t slot_idx)
+        : map(map)
+        , slot_idx(slot_idx)
+        , elem_idx(NONE)
+        {
+            skipEmptySlots();
+        }
+
+        std::pair<Point, ElemT> operator*() const
+        {
+            return std::make_pair(map->slots[slot_idx].cell, map->nodes[elem_idx].elem);
+        }
+
+        const_iterator& operator++()
+        {
+            elem_idx = map->nodes[elem_idx].previous;
+            if (elem_idx == NONE)
+            {
+                slot_idx++;
+                skipEmptySlots();
+            }
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return slot_idx == other.slot_idx && elem_idx == other.elem_idx;
+        }
+
+        bool operator!=(const const_iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        /*!
+         * \brief Move to the first element of the current slot, or of the
+         * first filled slot after it.
+         */
+        void skipEmptySlots()
+        {
+            while (slot_idx < map->slots.size() && map->slots[slot_idx].last_elem == NONE)
+            {
+                slot_idx++;
+            }
+            elem_idx = (slot_idx < map->slots.size()) ? map->slots[slot_idx].last_elem : NONE;
+        }
+
+        const SparseCellMap* map; //!< The map being iterated over.
+        size_t slot_idx; //!< The slot of the current cell.
+        uint32_t elem_idx; //!< The index of the current element.
+    };
+
+    SparseCellMap()
+    : cell_count(0)
+    {
+    }
+
+    /*!
+     * \brief Reserve memory for a number of elements, each assumed to be in
+     * a different cell.
+     */
+    void reserve(const size_t elem_count)
+    {
+        nodes.reserve(elem_count);
+        size_t capacity = slots.empty() ? 16 : slots.size();
+        while (elem_count * 2 > capacity)
+        {
+            capacity *= 2;
+        }
+        if (capacity > slots.size())
+        {
+            rehash(capacity);
+        }
+    }
+
+    /*!
+     * \brief Add an element to a cell.
+     * \param cell The grid coordinates of the cell.
+     * \param elem The element to add.
+     */
+    void emplace(const Point& cell, const ElemT& elem)
+    {
+        assert(nodes.size() < NONE && "The elements are indexed with 32 bits.");
+        if ((cell_count + 1) * 2 > slots.size())
+        {
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+        Slot& slot = slots[findSlot(cell)];
+        if (slot.last_elem == NONE)
+        {
+            slot.cell = cell;
+            cell_count++;
+        }
+        nodes.emplace_back(elem, slot.last_elem);
+        slot.last_elem = nodes.size() - 1;
+    }
+
+    /*!
+     * \brief Call a function on each element of a cell, until it returns
+     * false.
+     * \param cell The grid coordinates of the cell.
+     * \param process_func The function to call, taking the element.
+     * \return False if \p process_func returned false for any element.
+     */
+    template<class Function>
+    bool processCell(const Point& cell, const Function& process_func) const
+    {
+        if (slots.empty())
+        {
+            return true;
+        }
+        for (uint32_t elem_idx = slots[findSlot(cell)].last_elem; elem_idx != NONE; elem_idx = nodes[elem_idx].previous)
+        {
+            if (!process_func(nodes[elem_idx].elem))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*!
+     * \brief The number of elements in all cells together.
+     */
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, slots.size());
+    }
+
+private:
+    /*!
+     * \brief Find the slot of a cell, or the empty slot where it would be
+     * placed.
+     *
+     * There must be at least one slot.
+     */
+    size_t findSlot(const Point& cell) const
+    {
+        const size_t mask = slots.size() - 1;
+        size_t slot_idx = SparseCellMapImpl::hashCell(cell) & mask;
+        while (slots[slot_idx].last_elem != NONE && slots[slot_idx].cell != cell)
+        {
+            slot_idx = (slot_idx + 1) & mask;
+        }
+        return slot_idx;
+    }
+
+    /*!
+     * \brief Move the cells into a hash table with a different number of
+     * slots, which must be a power of two.
+     */
+    void rehash(const size_t capacity)
+    {
+        std::vector<Slot> old_slots(capacity, Slot{Point(), NONE});
+        old_slots.swap(slots);
+        for (const Slot& slot : old_slots)
+        {
+            if (slot.last_elem != NONE)
+            {
+                slots[findSlot(slot.cell)] = slot;
+            }
+        }
+    }
+
+    std::vector<Slot> slots; //!< The hash table of cells. Its size is zero or a power of two, and at most half of it is filled.
+    std::vector<Node> nodes; //!< All elements, in the order in which they were added.
+    size_t cell_count; //!< The number of filled slots.
+};
+
+template<class ElemT>
+constexpr uint32_t SparseCellMap<ElemT>::NONE;
+
+} //namespace cura
+
+#endif //UTILS_SPARSE_CELL_MAP_H
@@ -6,9 +6,9 @@
 #define UTILS_SPARSE_GRID_H
 
 #include "IntPoint.h"
+#include "SparseCellMap.h"
 
 #include <cassert>
-#include <unordered_map>
 #include <vector>
 #include <functional>
 
@@ -20,8 +20,10 @@ namespace cura {
  * \see SparsePointGrid
  *
  * \tparam ElemT The element type to store.
+ * \tparam CellMapT The map from cells to their elements, such as
+ *    \ref SparseCellMap or \ref StaticCellMap.
  */
-template<class ElemT>
+template<class ElemT, class CellMapT = SparseCellMap<ElemT>>
 class SparseGrid
 {
 public:
@@ -32,9 +34,8 @@ public:
      * \param[in] cell_size The size to use for a cell (square) in the grid.
      *    Typical values would be around 0.5-2x of expected query radius.
      * \param[in] elem_reserve Number of elements to research space for.
-     * \param[in] max_load_factor Maximum average load factor before rehashing.
      */
-    SparseGrid(coord_t cell_size, size_t elem_reserve=0U, float max_load_factor=1.0f);
+    SparseGrid(coord_t cell_size, size_t elem_reserve=0U);
 
     /*! \brief Returns all data within radius of query_pt.
      *
@@ -102,7 +103,7 @@ public:
 protected:
     using GridPoint = Point;
     using grid_coord_t = coord_t;
-    using GridMap = std::unordered_multimap<GridPoint, Elem>;
+    using GridMap = CellMapT;
 
     /*! \brief Process elements from the cell indicated by \p grid_pt.
      *
@@ -174,18 +175,16 @@ protected:
 
 
 
-#define SGI_TEMPLATE template<class ElemT>
-#define SGI_THIS SparseGrid<ElemT>
+#define SGI_TEMPLATE template<class ElemT, class CellMapT>
+#define SGI_THIS SparseGrid<ElemT, CellMapT>
 
 SGI_TEMPLATE
-SGI_THIS::SparseGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
+SGI_THIS::SparseGrid(coord_t cell_size, size_t elem_reserve)
 {
     assert(cell_size > 0U);
 
     m_cell_size = cell_size;
 
-    // Must be before the reserve call.
-    m_grid.max_load_factor(max_load_factor);
     if (elem_reserve != 0U) {
         m_grid.reserve(elem_reserve);
     }
@@ -232,15 +231,7 @@ bool SGI_THIS::processFromCell(
     const GridPoint &grid_pt,
     const std::function<bool (const Elem&)>& process_func) const
 {
-    auto grid_range = m_grid.equal_range(grid_pt);
-    for (auto iter = grid_range.first; iter != grid_range.second; ++iter)
-    {
-        if (!process_func(iter->second))
-        {
-            return false;
-        }
-    }
-    return true;
+    return m_grid.processCell(grid_pt, process_func);
 }
 
 SGI_TEMPLATE
@@ -34,9 +34,8 @@ public:
      * \param[in] cell_size The size to use for a cell (square) in the grid.
      *    Typical values would be around 0.5-2x of expected query radius.
      * \param[in] elem_reserve Number of elements to research space for.
-     * \param[in] max_load_factor Maximum average load factor before rehashing.
      */
-    SparseLineGrid(coord_t cell_size, size_t elem_reserve = 0U, float max_load_factor = 1.0f);
+    SparseLineGrid(coord_t cell_size, size_t elem_reserve = 0U);
 
     /*! \brief Inserts elem into the sparse grid.
      *
@@ -61,8 +60,8 @@ protected:
 #define SGI_THIS SparseLineGrid<ElemT, Locator>
 
 SGI_TEMPLATE
-SGI_THIS::SparseLineGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
- : SparseGrid<ElemT>(cell_size, elem_reserve, max_load_factor)
+SGI_THIS::SparseLineGrid(coord_t cell_size, size_t elem_reserve)
+ : SparseGrid<ElemT>(cell_size, elem_reserve)
 {
 }
 
@@ -70,7 +69,7 @@ SGI_TEMPLATE
 void SGI_THIS::insert(const Elem &elem)
 {
     const std::pair<Point, Point> line = m_locator(elem);
-    using GridMap = std::unordered_multimap<GridPoint, Elem>;
+    using GridMap = typename SparseGrid<ElemT>::GridMap;
     // below is a workaround for the fact that lambda functions cannot access private or protected members
     // first we define a lambda which works on any GridMap and then we bind it to the actual protected GridMap of the parent class
     std::function<bool (GridMap*, const GridPoint)> process_cell_func_ = [&elem, this](GridMap* m_grid, const GridPoint grid_loc)
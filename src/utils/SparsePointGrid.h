@@ -32,9 +32,8 @@ public:
      * \param[in] cell_size The size to use for a cell (square) in the grid.
      *    Typical values would be around 0.5-2x of expected query radius.
      * \param[in] elem_reserve Number of elements to research space for.
-     * \param[in] max_load_factor Maximum average load factor before rehashing.
      */
-    SparsePointGrid(coord_t cell_size, size_t elem_reserve=0U, float max_load_factor=1.0f);
+    SparsePointGrid(coord_t cell_size, size_t elem_reserve=0U);
 
     /*! \brief Inserts elem into the sparse grid.
      *
@@ -55,8 +54,8 @@ protected:
 #define SGI_THIS SparsePointGrid<ElemT, Locator>
 
 SGI_TEMPLATE
-SGI_THIS::SparsePointGrid(coord_t cell_size, size_t elem_reserve, float max_load_factor)
- : SparseGrid<ElemT>(cell_size, elem_reserve, max_load_factor)
+SGI_THIS::SparsePointGrid(coord_t cell_size, size_t elem_reserve)
+ : SparseGrid<ElemT>(cell_size, elem_reserve)
 {
 }
 
@@ -6,7 +6,7 @@
 #define UTILS_SPARSE_POINT_GRID_INCLUSIVE_H
 
 #include <cassert>
-#include <unordered_map>
+#include <utility> //For pair.
 #include <vector>
 
 #include "IntPoint.h"
@@ -62,9 +62,20 @@ public:
      * \param[in] cell_size The size to use for a cell (square) in the grid.
      *    Typical values would be around 0.5-2x of expected query radius.
      * \param[in] elem_reserve Number of elements to research space for.
-     * \param[in] max_load_factor Maximum average load factor before rehashing.
      */
-    SparsePointGridInclusive(coord_t cell_size, size_t elem_reserve=0U, float max_load_factor=1.0f);
+    SparsePointGridInclusive(coord_t cell_size, size_t elem_reserve=0U);
+
+    /*! \brief Constructs a sparse grid with the specified cell size, filled
+     * with values at their locations.
+     *
+     * Memory for all values is reserved at once, instead of growing the grid
+     * while they are inserted one by one.
+     *
+     * \param[in] cell_size The size to use for a cell (square) in the grid.
+     * \param[in] values The values with their locations, in the order in
+     *    which to insert them.
+     */
+    SparsePointGridInclusive(coord_t cell_size, const std::vector<std::pair<Point, Val>>& values);
 
     /*! \brief Inserts an element with specified point and value into the sparse grid.
      *
@@ -94,11 +105,21 @@ public:
 #define SG_THIS SparsePointGridInclusive<Val>
 
 SG_TEMPLATE
-SG_THIS::SparsePointGridInclusive(coord_t cell_size, size_t elem_reserve, float max_load_factor) :
-    Base(cell_size,elem_reserve,max_load_factor)
+SG_THIS::SparsePointGridInclusive(coord_t cell_size, size_t elem_reserve) :
+    Base(cell_size, elem_reserve)
 {
 }
 
+SG_TEMPLATE
+SG_THIS::SparsePointGridInclusive(coord_t cell_size, const std::vector<std::pair<Point, Val>>& values) :
+    Base(cell_size, values.size())
+{
+    for (const std::pair<Point, Val>& value : values)
+    {
+        insert(value.first, value.second);
+    }
+}
+
 SG_TEMPLATE
 void SG_THIS::insert(const Point &point, const Val &val)
 {
@@ -0,0 +1,200 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif // _OPENMP
+#include <algorithm> //For min.
+#include <cstdlib> //For strtoul.
+#include <fstream>
+#include <sstream>
+
+#include "gettime.h"
+#include "Instrumentation.h"
+#include "logoutput.h"
+#include "StageThreads.h"
+
+namespace cura
+{
+
+StageThreads& StageThreads::getInstance()
+{
+    static StageThreads instance;
+    return instance;
+}
+
+bool StageThreads::start(const std::string& limits, const std::string& tuning_file)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->limits.clear();
+    this->tuning_file = tuning_file;
+    times.clear();
+    new_times.clear();
+
+    if (!tuning_file.empty())
+    {
+        std::ifstream file(tuning_file.c_str());
+        std::string stage;
+        size_t thread_count;
+        double wall_time;
+        while (file >> stage >> thread_count >> wall_time)
+        {
+            std::map<size_t, double>& stage_times = times[stage];
+            const auto it = stage_times.find(thread_count);
+            stage_times[thread_count] = (it == stage_times.end()) ? wall_time : std::min(it->second, wall_time);
+        }
+    }
+
+    if (!parseLimits(limits, this->limits))
+    {
+        logError("Couldn't parse the thread counts of the stages: %s\n", limits.c_str());
+        this->limits.clear();
+        return false;
+    }
+    return true;
+}
+
+void StageThreads::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!tuning_file.empty() && !new_times.empty())
+    {
+        std::ofstream file(tuning_file.c_str(), std::ios_base::app);
+        for (const std::string& line : new_times)
+        {
+            file << line << "\n";
+        }
+        if (!file.good())
+        {
+            logError("Couldn't write the thread tuning file: %s\n", tuning_file.c_str());
+        }
+    }
+    limits.clear();
+    tuning_file.clear();
+    times.clear();
+    new_times.clear();
+}
+
+size_t StageThreads::getThreadCount(const std::string& stage, const size_t max_threads)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto limit = limits.find(stage);
+    if (limit != limits.end())
+    {
+        return std::min(limit->second, max_threads);
+    }
+    if (tuning_file.empty())
+    {
+        return max_threads;
+    }
+    bool is_tuned;
+    const size_t thread_count = chooseThreadCount(times[stage], max_threads, is_tuned);
+    if (!is_tuned)
+    {
+        log("Tuning the threads of stage %s: trying %u threads.\n", stage.c_str(), static_cast<unsigned int>(thread_count));
+    }
+    return thread_count;
+}
+
+void StageThreads::recordTime(const std::string& stage, const size_t thread_count, const double wall_time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tuning_file.empty() || limits.find(stage) != limits.end())
+    {
+        return;
+    }
+    std::map<size_t, double>& stage_times = times[stage];
+    const auto it = stage_times.find(thread_count);
+    stage_times[thread_count] = (it == stage_times.end()) ? wall_time : std::min(it->second, wall_time);
+    std::ostringstream line;
+    line << stage << " " << thread_count << " " << wall_time;
+    new_times.push_back(line.str());
+}
+
+bool StageThreads::parseLimits(const std::string& limits, std::map<std::string, size_t>& thread_counts)
+{
+    thread_counts.clear();
+    std::istringstream stream(limits);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (item.empty())
+        {
+            continue;
+        }
+        const size_t separator = item.find('=');
+        if (separator == 0 || separator == std::string::npos || separator + 1 == item.size())
+        {
+            return false;
+        }
+        const char* count_start = item.c_str() + separator + 1;
+        char* count_end;
+        const unsigned long thread_count = std::strtoul(count_start, &count_end, 10);
+        if (*count_end != '\0' || thread_count == 0)
+        {
+            return false;
+        }
+        thread_counts[item.substr(0, separator)] = thread_count;
+    }
+    return true;
+}
+
+size_t StageThreads::chooseThreadCount(const std::map<size_t, double>& times, const size_t max_threads, bool& is_tuned)
+{
+    size_t fastest_thread_count = 0;
+    double fastest_time = 0;
+    for (size_t thread_count = std::max(size_t(1), max_threads); ; thread_count /= 2)
+    {
+        const auto it = times.find(thread_count);
+        if (it == times.end())
+        {
+            is_tuned = false;
+            return thread_count;
+        }
+        if (fastest_thread_count > 0 && it->second > fastest_time)
+        {
+            break; //Fewer threads only get slower from here.
+        }
+        fastest_thread_count = thread_count;
+        fastest_time = it->second;
+        if (thread_count == 1)
+        {
+            break;
+        }
+    }
+    is_tuned = true;
+    return fastest_thread_count;
+}
+
+ScopedStageThreads::ScopedStageThreads(const char* stage)
+: stage(stage)
+, previous_thread_count(1)
+, thread_count(1)
+, start_time(-1)
+{
+#ifdef _OPENMP
+    previous_thread_count = omp_get_max_threads();
+    thread_count = StageThreads::getInstance().getThreadCount(stage, std::max(1, previous_thread_count));
+    omp_set_num_threads(thread_count);
+    if (omp_get_level() == 0) //Stages within a parallel loop share the cores with the other iterations, so their time says little about their scaling.
+    {
+        start_time = getTime();
+    }
+#endif // _OPENMP
+    ScopedTimer::count("threads", thread_count);
+}
+
+ScopedStageThreads::~ScopedStageThreads()
+{
+#ifdef _OPENMP
+    if (start_time >= 0)
+    {
+        StageThreads::getInstance().recordTime(stage, thread_count, getTime() - start_time);
+    }
+    omp_set_num_threads(previous_thread_count);
+#endif // _OPENMP
+}
+
+} //namespace cura
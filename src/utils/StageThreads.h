@@ -0,0 +1,143 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_STAGE_THREADS_H
+#define UTILS_STAGE_THREADS_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Limits the number of threads of the stages of a slice.
+ *
+ * The parallel loops of the engine use all threads by default (see the option
+ * -m). Some stages don't scale to many threads, since their threads mostly
+ * wait for the memory allocator and the memory of Clipper, so more threads
+ * only make them slower. The scene setting parallel_stage_threads limits the
+ * threads of such stages, like "support=4,walls_skin_infill=8". The stages
+ * have the names of their timers in \ref Instrumentation: slice,
+ * walls_skin_infill, support and gcode.
+ *
+ * With the scene setting parallel_stage_tuning_file, the thread counts of the
+ * stages without a limit are tuned for the host instead. Every slice runs
+ * these stages with the next thread count to try, halving the thread count
+ * each time until the stage gets slower, and stores the time of the stage in
+ * the file. Once a stage is tuned, it gets the thread count with which it was
+ * fastest. The slices that tune a stage should be alike, e.g. the same model
+ * sliced a few times, since the times of different slices are compared. The
+ * file has a line with the stage, the thread count and the time in seconds
+ * for every run.
+ *
+ * The thread count of every stage is counted as "threads" in the timer of the
+ * stage, so the scaling of the stages can be followed with the instrumentation
+ * sinks.
+ */
+class StageThreads : NoCopy
+{
+public:
+    static StageThreads& getInstance();
+
+    /*!
+     * \brief Start applying limits and tuning for a slice.
+     * \param limits The thread count of each stage, as a comma-separated list
+     * like "support=4,gcode=2", or an empty string for no limits.
+     * \param tuning_file The file with the times of the stages in earlier
+     * slices, or an empty string to not tune the stages.
+     * \return Whether the limits were valid. If not, no limits are applied.
+     */
+    bool start(const std::string& limits, const std::string& tuning_file);
+
+    /*!
+     * \brief Store the times of the stages of the slice in the tuning file, if
+     * any, and stop applying limits and tuning.
+     */
+    void finish();
+
+    /*!
+     * \brief Get the number of threads to run a stage with.
+     * \param stage The name of the stage.
+     * \param max_threads The number of threads that the stage would use
+     * without limits.
+     */
+    size_t getThreadCount(const std::string& stage, const size_t max_threads);
+
+    /*!
+     * \brief Record how long a stage took, for tuning.
+     * \param stage The name of the stage.
+     * \param thread_count The number of threads that it ran with.
+     * \param wall_time How long it took, in seconds.
+     */
+    void recordTime(const std::string& stage, const size_t thread_count, const double wall_time);
+
+    /*!
+     * \brief Parse the thread counts of the stages.
+     * \param limits A comma-separated list like "support=4,gcode=2".
+     * \param[out] thread_counts The thread count of each stage.
+     * \return Whether the list could be parsed. Thread counts must be at
+     * least 1.
+     */
+    static bool parseLimits(const std::string& limits, std::map<std::string, size_t>& thread_counts);
+
+    /*!
+     * \brief Choose the thread count of a stage that is being tuned.
+     *
+     * The thread counts to try are \p max_threads, halved until 1. They are
+     * tried in that order until one is slower than the fastest one before it.
+     * \param times For each thread count that the stage was timed with, the
+     * fastest time.
+     * \param max_threads The number of threads that the stage would use
+     * without limits.
+     * \param[out] is_tuned Whether all thread counts that matter were tried.
+     * \return The thread count to try next, or the fastest one if the stage is
+     * tuned.
+     */
+    static size_t chooseThreadCount(const std::map<size_t, double>& times, const size_t max_threads, bool& is_tuned);
+
+private:
+    StageThreads() = default;
+
+    std::mutex mutex; //!< Protects everything below, since stages may run on several threads at the same time.
+    std::map<std::string, size_t> limits; //!< The thread count of each stage that has a limit.
+    std::string tuning_file; //!< Where the times of the stages are stored, or empty if the stages aren't tuned.
+    std::map<std::string, std::map<size_t, double>> times; //!< For each stage and thread count, the fastest time in the tuning file and this slice.
+    std::vector<std::string> new_times; //!< The lines of the tuning file for the stages of this slice.
+};
+
+/*!
+ * \brief Runs the parallel loops of a stage with the number of threads that
+ * \ref StageThreads chooses for it, from its construction until it goes out
+ * of scope.
+ *
+ * This sets the number of threads of the parallel loops that the calling
+ * thread starts, including those of a \ref TaskScheduler. Construct it just
+ * after the timer of the stage, so that the thread count is counted in that
+ * timer. Only the stages that aren't nested in a parallel loop are timed for
+ * tuning.
+ */
+class ScopedStageThreads : NoCopy
+{
+public:
+    /*!
+     * \param stage The name of the stage.
+     */
+    ScopedStageThreads(const char* stage);
+
+    ~ScopedStageThreads();
+
+private:
+    const char* stage; //!< The name of the stage.
+    int previous_thread_count; //!< The number of threads before the stage started, to go back to afterwards.
+    size_t thread_count; //!< The number of threads of the stage.
+    double start_time; //!< When the stage started, or a negative number if it isn't timed.
+};
+
+} //namespace cura
+
+#endif //UTILS_STAGE_THREADS_H
@@ -0,0 +1,172 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_STATIC_CELL_MAP_H
+#define UTILS_STATIC_CELL_MAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "IntPoint.h"
+#include "SparseCellMap.h" //For the hash function.
+
+namespace cura
+{
+
+/*!
+ * \brief An immutable map from grid cells to any number of elements each, for
+ * a \ref SparseGrid that is filled all at once and only queried afterwards.
+ *
+ * The elements are stored in compressed sparse row form: all elements are in a
+ * single array, grouped per cell, and each cell in the hash table refers to the
+ * range of its elements. Compared to \ref SparseCellMap this saves the link to
+ * the next element of the same cell and the elements of a cell are next to
+ * each other in memory.
+ *
+ * The elements of a cell are visited in the same order as they would be in a
+ * \ref SparseCellMap that had them added in the same order, so that a grid
+ * using either map gives the same results.
+ *
+ * The map doesn't change when it's queried, so it can be read from multiple
+ * threads at the same time.
+ *
+ * \tparam ElemT The element type to store.
+ */
+template<class ElemT>
+class StaticCellMap
+{
+    /*!
+     * \brief A slot in the hash table.
+     *
+     * A slot is empty if its range of elements is empty, since a cell is only
+     * stored if it has elements.
+     */
+    struct Slot
+    {
+        Point cell; //!< The grid coordinates of the cell.
+        uint32_t begin; //!< The index of the first element of this cell.
+        uint32_t end; //!< The index after the last element of this cell.
+    };
+
+public:
+    StaticCellMap()
+    {
+    }
+
+    /*!
+     * \brief Reserve memory for a number of elements.
+     */
+    void reserve(const size_t elem_count)
+    {
+        elems.reserve(elem_count);
+    }
+
+    /*!
+     * \brief Replace the contents of the map.
+     * \param cell_elems Each element with the grid coordinates of a cell it
+     * is in, in the order in which they would be added to a
+     * \ref SparseCellMap.
+     */
+    void assign(std::vector<std::pair<Point, ElemT>> cell_elems)
+    {
+        assert(cell_elems.size() < std::numeric_limits<uint32_t>::max() && "The elements are indexed with 32 bits.");
+        //Group the elements per cell, with the last added element first.
+        std::reverse(cell_elems.begin(), cell_elems.end());
+        std::stable_sort(cell_elems.begin(), cell_elems.end(), [](const std::pair<Point, ElemT>& a, const std::pair<Point, ElemT>& b)
+        {
+            return a.first.X < b.first.X || (a.first.X == b.first.X && a.first.Y < b.first.Y);
+        });
+
+        size_t cell_count = 0;
+        for (size_t elem_idx = 0; elem_idx < cell_elems.size(); elem_idx++)
+        {
+            cell_count += elem_idx == 0 || cell_elems[elem_idx].first != cell_elems[elem_idx - 1].first;
+        }
+        size_t capacity = 16;
+        while (cell_count * 2 > capacity)
+        {
+            capacity *= 2;
+        }
+        slots.assign(capacity, Slot{Point(), 0, 0});
+
+        elems.clear();
+        elems.reserve(cell_elems.size());
+        for (const std::pair<Point, ElemT>& cell_elem : cell_elems)
+        {
+            elems.push_back(cell_elem.second);
+        }
+        for (size_t group_begin = 0; group_begin < cell_elems.size(); )
+        {
+            const Point& cell = cell_elems[group_begin].first;
+            size_t group_end = group_begin + 1;
+            while (group_end < cell_elems.size() && cell_elems[group_end].first == cell)
+            {
+                group_end++;
+            }
+            slots[findSlot(cell)] = Slot{cell, static_cast<uint32_t>(group_begin), static_cast<uint32_t>(group_end)};
+            group_begin = group_end;
+        }
+    }
+
+    /*!
+     * \brief Call a function on each element of a cell, until it returns
+     * false.
+     * \param cell The grid coordinates of the cell.
+     * \param process_func The function to call, taking the element.
+     * \return False if \p process_func returned false for any element.
+     */
+    template<class Function>
+    bool processCell(const Point& cell, const Function& process_func) const
+    {
+        if (slots.empty())
+        {
+            return true;
+        }
+        const Slot& slot = slots[findSlot(cell)];
+        for (uint32_t elem_idx = slot.begin; elem_idx < slot.end; elem_idx++)
+        {
+            if (!process_func(elems[elem_idx]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*!
+     * \brief The number of elements in all cells together.
+     */
+    size_t size() const
+    {
+        return elems.size();
+    }
+
+private:
+    /*!
+     * \brief Find the slot of a cell, or the empty slot where it would be
+     * placed.
+     *
+     * There must be at least one slot.
+     */
+    size_t findSlot(const Point& cell) const
+    {
+        const size_t mask = slots.size() - 1;
+        size_t slot_idx = SparseCellMapImpl::hashCell(cell) & mask;
+        while (slots[slot_idx].begin != slots[slot_idx].end && slots[slot_idx].cell != cell)
+        {
+            slot_idx = (slot_idx + 1) & mask;
+        }
+        return slot_idx;
+    }
+
+    std::vector<Slot> slots; //!< The hash table of cells. Its size is zero or a power of two, and at most half of it is filled.
+    std::vector<ElemT> elems; //!< All elements, grouped per cell.
+};
+
+} //namespace cura
+
+#endif //UTILS_STATIC_CELL_MAP_H
@@ -0,0 +1,74 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_STATIC_LINE_GRID_H
+#define UTILS_STATIC_LINE_GRID_H
+
+#include <utility>
+#include <vector>
+
+#include "IntPoint.h"
+#include "SparseGrid.h"
+#include "StaticCellMap.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Sparse grid of line segments which is built once from all of its
+ * elements and can't be changed afterwards.
+ *
+ * This gives the same results as a \ref SparseLineGrid with the same elements
+ * inserted in the same order, but stores them in a \ref StaticCellMap, which
+ * takes less memory and keeps the elements of a cell together. Since it can't
+ * be changed, it can be queried from multiple threads at the same time.
+ *
+ * \tparam ElemT The element type to store.
+ * \tparam Locator The functor to get the start and end locations from ElemT.
+ *    must have: std::pair<Point, Point> operator()(const ElemT &elem) const
+ *    which returns the location associated with val.
+ */
+template<class ElemT, class Locator>
+class StaticLineGrid : public SparseGrid<ElemT, StaticCellMap<ElemT>>
+{
+public:
+    using Elem = ElemT;
+
+    /*!
+     * \brief Constructs a grid with all of its elements.
+     *
+     * \param[in] cell_size The size to use for a cell (square) in the grid.
+     *    Typical values would be around 0.5-2x of expected query radius.
+     * \param[in] elems The elements to put in the grid.
+     */
+    StaticLineGrid(coord_t cell_size, const std::vector<Elem>& elems);
+
+protected:
+    using Base = SparseGrid<ElemT, StaticCellMap<ElemT>>;
+    using GridPoint = typename Base::GridPoint;
+
+    /*! \brief Accessor for getting locations from elements. */
+    Locator m_locator;
+};
+
+template<class ElemT, class Locator>
+StaticLineGrid<ElemT, Locator>::StaticLineGrid(coord_t cell_size, const std::vector<Elem>& elems)
+: Base(cell_size)
+{
+    std::vector<std::pair<GridPoint, Elem>> cell_elems;
+    cell_elems.reserve(elems.size() * 2); //Most line segments are shorter than a cell, but they often cross into the next one.
+    for (const Elem& elem : elems)
+    {
+        const std::pair<Point, Point> line = m_locator(elem);
+        Base::processLineCells(line, [&cell_elems, &elem](const GridPoint grid_loc)
+            {
+                cell_elems.emplace_back(grid_loc, elem);
+                return true;
+            });
+    }
+    Base::m_grid.assign(std::move(cell_elems));
+}
+
+} //namespace cura
+
+#endif //UTILS_STATIC_LINE_GRID_H
@@ -0,0 +1,190 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> //For max and min.
+#include <thread> //For yield.
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
+#include "TaskScheduler.h"
+#include "ThreadAffinity.h"
+
+namespace cura
+{
+
+TaskScheduler::TaskScheduler()
+: queued_count(0)
+, unfinished_count(0)
+{
+    size_t thread_count = 1;
+#ifdef _OPENMP
+    thread_count = std::max(1, omp_get_max_threads());
+#endif // _OPENMP
+    for (size_t worker_idx = 0; worker_idx < thread_count; worker_idx++)
+    {
+        queues.emplace_back(new WorkerQueue());
+    }
+    //Steal from the threads on the same NUMA node first, since the tasks of their queue tend to work on memory of that node.
+    steal_orders.resize(thread_count);
+    for (size_t worker_idx = 0; worker_idx < thread_count; worker_idx++)
+    {
+        const size_t node = ThreadAffinity::getNode(worker_idx);
+        for (size_t offset = 1; offset < thread_count; offset++)
+        {
+            const size_t victim_idx = (worker_idx + offset) % thread_count;
+            if (ThreadAffinity::getNode(victim_idx) == node)
+            {
+                steal_orders[worker_idx].push_back(victim_idx);
+            }
+        }
+        for (size_t offset = 1; offset < thread_count; offset++)
+        {
+            const size_t victim_idx = (worker_idx + offset) % thread_count;
+            if (ThreadAffinity::getNode(victim_idx) != node)
+            {
+                steal_orders[worker_idx].push_back(victim_idx);
+            }
+        }
+    }
+}
+
+void TaskScheduler::schedule(const Task& task)
+{
+    //Count the task before it's visible in a queue, so the counts never go below zero when another thread takes it right away.
+    unfinished_count++;
+    queued_count++;
+    {
+        WorkerQueue& queue = *queues[getWorkerIdx()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex); //Threads check the counts while holding this lock before sleeping, so holding it here makes sure that they don't miss the notification.
+    }
+    idle_condition.notify_one();
+}
+
+void TaskScheduler::run()
+{
+    if (queues.size() == 1)
+    {
+        work(0);
+        return;
+    }
+#pragma omp parallel num_threads(static_cast<int>(queues.size()))
+    {
+        size_t worker_idx = 0;
+#ifdef _OPENMP
+        worker_idx = omp_get_thread_num();
+#endif // _OPENMP
+        ThreadAffinity::pinThread(worker_idx);
+        work(worker_idx);
+    }
+}
+
+size_t TaskScheduler::getThreadCount() const
+{
+    return queues.size();
+}
+
+void TaskScheduler::work(const size_t worker_idx)
+{
+    while (true)
+    {
+        Task task;
+        if (take(worker_idx, task))
+        {
+            queued_count--;
+            task();
+            if (--unfinished_count == 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                }
+                idle_condition.notify_all(); //Wake up all threads so that they can stop.
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle_condition.wait(lock, [this]() { return queued_count > 0 || unfinished_count == 0; });
+        if (unfinished_count == 0)
+        {
+            return;
+        }
+    }
+}
+
+bool TaskScheduler::take(const size_t worker_idx, Task& task)
+{
+    if (takeOldest(*queues[worker_idx], task))
+    {
+        return true;
+    }
+    for (const size_t victim_idx : steal_orders[worker_idx])
+    {
+        if (takeOldest(*queues[victim_idx], task))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskScheduler::takeOldest(WorkerQueue& queue, Task& task)
+{
+    //Take the oldest task first. Tasks tend to be scheduled in the order in which their results are needed.
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+size_t TaskScheduler::getWorkerIdx() const
+{
+#ifdef _OPENMP
+    return omp_get_thread_num() % queues.size();
+#else
+    return 0;
+#endif // _OPENMP
+}
+
+void TaskScheduler::processShared(TaskScheduler* scheduler, const size_t item_count, const std::function<void (size_t)>& process)
+{
+    //The claiming state is shared with the helpers rather than living on this stack, since a helper may only start after this function returned.
+    struct Progress
+    {
+        std::atomic<size_t> next_item_idx { 0 };
+        std::atomic<size_t> processed_count { 0 };
+    };
+    const std::shared_ptr<Progress> progress = std::make_shared<Progress>();
+    const std::function<void ()> process_items = [progress, item_count, &process]()
+    {
+        for (size_t item_idx = progress->next_item_idx++; item_idx < item_count; item_idx = progress->next_item_idx++)
+        {
+            process(item_idx); //Only reached while the caller is still waiting, so process is still alive.
+            progress->processed_count++;
+        }
+    };
+    if (scheduler)
+    {
+        const size_t helper_count = std::min(item_count, scheduler->getThreadCount()) - ((item_count > 0) ? 1 : 0);
+        for (size_t helper_idx = 0; helper_idx < helper_count; helper_idx++)
+        {
+            scheduler->schedule(process_items);
+        }
+    }
+    process_items();
+    while (progress->processed_count < item_count)
+    { //Helpers are still processing their last items.
+        std::this_thread::yield();
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,134 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_TASK_SCHEDULER_H
+#define UTILS_TASK_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory> //For unique_ptr.
+#include <mutex>
+#include <vector>
+
+#include "NoCopy.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Runs a dynamic set of tasks on all threads of an OpenMP team.
+ *
+ * Every thread has its own queue of tasks. Tasks scheduled from within a task
+ * go to the queue of the thread that runs it. A thread that runs out of tasks
+ * steals from the queues of the other threads, and if there is nothing to
+ * steal it sleeps until a new task is scheduled. Threads therefore don't
+ * contend on a single lock, nor do they poll. If threads are pinned to NUMA
+ * nodes (see \ref ThreadAffinity), they steal from threads on their own node
+ * first.
+ *
+ * The threads are those of an OpenMP parallel region, so code running in the
+ * tasks can synchronise with OpenMP constructs like ``#pragma omp critical``
+ * in the same way as the rest of the engine. Without OpenMP, all tasks are
+ * executed by the calling thread.
+ */
+class TaskScheduler : NoCopy
+{
+public:
+    typedef std::function<void ()> Task;
+
+    /*!
+     * \brief Creates a scheduler with a queue for every thread that OpenMP
+     * would use for a parallel region.
+     */
+    TaskScheduler();
+
+    /*!
+     * \brief Add a task to be executed.
+     *
+     * This can be called before \ref TaskScheduler::run, or from within a task
+     * while the scheduler is running.
+     * \param task The task to execute.
+     */
+    void schedule(const Task& task);
+
+    /*!
+     * \brief Execute tasks on all threads until all scheduled tasks, including
+     * the tasks that those tasks schedule, are finished.
+     */
+    void run();
+
+    /*!
+     * \brief Get the number of threads that execute the tasks.
+     */
+    size_t getThreadCount() const;
+
+    /*!
+     * \brief Process a number of items on the calling thread, helped by the
+     * idle threads of a scheduler, and wait until all of them are processed.
+     *
+     * The items are claimed one by one, both by the calling thread and by
+     * helper tasks. This may be called from within a task of the same
+     * scheduler: the calling thread never waits for a helper to start, so the
+     * items are processed even if all other threads are busy. A helper that
+     * only starts once all items are claimed returns right away.
+     * \param scheduler The scheduler whose threads may help, or nullptr to
+     * process all items on the calling thread.
+     * \param item_count The number of items.
+     * \param process Processes the item with the given index. Different items
+     * may be processed at the same time.
+     */
+    static void processShared(TaskScheduler* scheduler, const size_t item_count, const std::function<void (size_t)>& process);
+
+private:
+    /*!
+     * \brief The tasks that belong to one thread.
+     */
+    struct WorkerQueue
+    {
+        std::mutex mutex; //!< Protects the tasks, since other threads may steal from them.
+        std::deque<Task> tasks; //!< The tasks that are waiting to be executed.
+    };
+
+    /*!
+     * \brief Main loop of each thread: execute tasks until all tasks are
+     * finished.
+     * \param worker_idx The index of the queue that belongs to this thread.
+     */
+    void work(const size_t worker_idx);
+
+    /*!
+     * \brief Take the next task, first from the thread's own queue and
+     * otherwise from the queues of the other threads.
+     * \param worker_idx The index of the queue that belongs to this thread.
+     * \param[out] task The task that was taken, if any.
+     * \return Whether a task was available.
+     */
+    bool take(const size_t worker_idx, Task& task);
+
+    /*!
+     * \brief Take the oldest task of a queue, if any.
+     * \param queue The queue to take from.
+     * \param[out] task The task that was taken, if any.
+     * \return Whether the queue had a task.
+     */
+    static bool takeOldest(WorkerQueue& queue, Task& task);
+
+    /*!
+     * \brief Get the index of the queue that belongs to the calling thread.
+     */
+    size_t getWorkerIdx() const;
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; //!< One queue of tasks for every thread.
+    std::vector<std::vector<size_t>> steal_orders; //!< For every thread, the queues of the other threads in the order to steal from them.
+    std::atomic<size_t> queued_count; //!< The number of tasks waiting in any of the queues.
+    std::atomic<size_t> unfinished_count; //!< The number of tasks that were scheduled but haven't finished yet.
+
+    std::mutex idle_mutex; //!< Mutex for \ref TaskScheduler::idle_condition.
+    std::condition_variable idle_condition; //!< Notified when new tasks are scheduled or all tasks are finished.
+};
+
+} //namespace cura
+
+#endif //UTILS_TASK_SCHEDULER_H
@@ -0,0 +1,241 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <fstream> //To read the topology from /sys.
+#include <sstream>
+#include <stdexcept> //For logic_error.
+
+#ifdef __linux__
+#include <sched.h> //sched_getaffinity, sched_setaffinity.
+#endif
+
+#include "logoutput.h"
+#include "ThreadAffinity.h"
+
+namespace cura
+{
+
+namespace
+{
+
+std::atomic<ThreadAffinity::Placement> current_placement(ThreadAffinity::Placement::NONE); //!< How threads are placed.
+
+#ifdef __linux__
+/*!
+ * \brief Read a list of processors or nodes from a file in /sys.
+ */
+bool readList(const std::string& file_name, std::vector<int>& result)
+{
+    std::ifstream file(file_name);
+    std::string list;
+    return std::getline(file, list) && ThreadAffinity::parseProcessorList(list, result);
+}
+#endif
+
+} //Anonymous namespace.
+
+bool ThreadAffinity::setPlacement(const std::string& placement_name)
+{
+    Placement placement;
+    if (placement_name == "none")
+    {
+        placement = Placement::NONE;
+    }
+    else if (placement_name == "compact")
+    {
+        placement = Placement::COMPACT;
+    }
+    else if (placement_name == "spread")
+    {
+        placement = Placement::SPREAD;
+    }
+    else
+    {
+        return false;
+    }
+    current_placement = placement;
+    if (placement != Placement::NONE)
+    {
+        const std::vector<std::vector<int>>& node_processors = getNodeProcessors();
+        if (node_processors.empty())
+        {
+            logWarning("Threads can't be pinned to processors on this platform.\n");
+        }
+        else
+        {
+            log("Placing threads %s over %zu NUMA nodes.\n", placement_name.c_str(), node_processors.size());
+        }
+    }
+    return true;
+}
+
+ThreadAffinity::Placement ThreadAffinity::getPlacement()
+{
+    return current_placement;
+}
+
+void ThreadAffinity::pinThread(const size_t thread_idx)
+{
+    const Placement placement = current_placement;
+    if (placement == Placement::NONE)
+    {
+        return;
+    }
+    const std::vector<std::vector<int>>& node_processors = getNodeProcessors();
+    if (node_processors.empty())
+    {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t processor_set;
+    CPU_ZERO(&processor_set);
+    CPU_SET(place(node_processors, placement, thread_idx).first, &processor_set);
+    sched_setaffinity(0, sizeof(processor_set), &processor_set); //Pins the calling thread. If it fails, the thread just isn't pinned.
+#endif
+}
+
+size_t ThreadAffinity::getNode(const size_t thread_idx)
+{
+    const Placement placement = current_placement;
+    if (placement == Placement::NONE)
+    {
+        return 0;
+    }
+    const std::vector<std::vector<int>>& node_processors = getNodeProcessors();
+    if (node_processors.empty())
+    {
+        return 0;
+    }
+    return place(node_processors, placement, thread_idx).second;
+}
+
+std::pair<int, size_t> ThreadAffinity::place(const std::vector<std::vector<int>>& node_processors, const Placement placement, const size_t thread_idx)
+{
+    if (placement == Placement::SPREAD)
+    {
+        const size_t node_idx = thread_idx % node_processors.size();
+        const std::vector<int>& processors = node_processors[node_idx];
+        return std::make_pair(processors[(thread_idx / node_processors.size()) % processors.size()], node_idx);
+    }
+    size_t processor_count = 0;
+    for (const std::vector<int>& processors : node_processors)
+    {
+        processor_count += processors.size();
+    }
+    size_t processor_idx = thread_idx % processor_count; //With more threads than processors, start over at the first node.
+    size_t node_idx = 0;
+    while (processor_idx >= node_processors[node_idx].size())
+    {
+        processor_idx -= node_processors[node_idx].size();
+        node_idx++;
+    }
+    return std::make_pair(node_processors[node_idx][processor_idx], node_idx);
+}
+
+bool ThreadAffinity::parseProcessorList(const std::string& list, std::vector<int>& processors)
+{
+    processors.clear();
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        item.erase(0, item.find_first_not_of(" \t\n"));
+        item.erase(item.find_last_not_of(" \t\n") + 1);
+        if (item.empty())
+        {
+            continue;
+        }
+        try
+        {
+            size_t parsed;
+            const int first = std::stoi(item, &parsed);
+            int last = first;
+            if (parsed != item.size())
+            {
+                if (item[parsed] != '-')
+                {
+                    return false;
+                }
+                const std::string last_string = item.substr(parsed + 1);
+                last = std::stoi(last_string, &parsed);
+                if (parsed != last_string.size())
+                {
+                    return false;
+                }
+            }
+            if (first < 0 || last < first)
+            {
+                return false;
+            }
+            for (int processor = first; processor <= last; processor++)
+            {
+                processors.push_back(processor);
+            }
+        }
+        catch (const std::logic_error&) //Not a number, or out of range.
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<std::vector<int>>& ThreadAffinity::getNodeProcessors()
+{
+    static const std::vector<std::vector<int>> node_processors = []()
+    {
+        std::vector<std::vector<int>> result;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        {
+            return result;
+        }
+        std::vector<int> nodes;
+        if (readList("/sys/devices/system/node/online", nodes))
+        {
+            for (const int node : nodes)
+            {
+                std::vector<int> processors;
+                if (!readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", processors))
+                {
+                    continue;
+                }
+                std::vector<int> allowed_processors;
+                for (const int processor : processors)
+                {
+                    if (processor < CPU_SETSIZE && CPU_ISSET(processor, &allowed))
+                    {
+                        allowed_processors.push_back(processor);
+                    }
+                }
+                if (!allowed_processors.empty()) //Nodes with only memory, or with processors that the process may not use.
+                {
+                    result.push_back(allowed_processors);
+                }
+            }
+        }
+        if (result.empty()) //No NUMA information, so all processors are alike.
+        {
+            std::vector<int> allowed_processors;
+            for (int processor = 0; processor < CPU_SETSIZE; processor++)
+            {
+                if (CPU_ISSET(processor, &allowed))
+                {
+                    allowed_processors.push_back(processor);
+                }
+            }
+            if (!allowed_processors.empty())
+            {
+                result.push_back(allowed_processors);
+            }
+        }
+#endif
+        return result;
+    }();
+    return node_processors;
+}
+
+} //namespace cura
@@ -0,0 +1,104 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_THREAD_AFFINITY_H
+#define UTILS_THREAD_AFFINITY_H
+
+#include <string>
+#include <utility> //For pair.
+#include <vector>
+
+namespace cura
+{
+
+/*!
+ * \brief Pins the threads that process a slice to processors, grouped by the
+ * NUMA node that the processors belong to.
+ *
+ * Without pinning, the operating system moves threads between processors, so
+ * on a machine with several sockets a thread often works on memory that was
+ * allocated on another node. Since memory is placed on the node of the thread
+ * that first touches it, pinned threads keep the geometry they produce in the
+ * memory of their own node. \ref TaskScheduler lets idle threads steal from
+ * threads on the same node before the others, so that later stages mostly
+ * read local memory too.
+ *
+ * Threads are pinned when a \ref TaskScheduler runs. OpenMP reuses its
+ * threads, so the parallel loops elsewhere in the engine run on pinned threads
+ * as well. Pinning is only supported on Linux; elsewhere it does nothing.
+ */
+class ThreadAffinity
+{
+public:
+    /*!
+     * \brief How threads are distributed over the NUMA nodes.
+     */
+    enum class Placement
+    {
+        NONE, //!< Don't pin threads, leave it to the operating system.
+        COMPACT, //!< Fill the processors of one node before using the next, keeping neighbouring threads together.
+        SPREAD //!< Distribute threads over the nodes in turn, to use the memory bandwidth of all nodes.
+    };
+
+    /*!
+     * \brief Set how threads are placed from now on.
+     * \param placement_name "none", "compact" or "spread".
+     * \return Whether the placement was recognised. If not, the placement
+     * doesn't change.
+     */
+    static bool setPlacement(const std::string& placement_name);
+
+    /*!
+     * \brief Get how threads are placed.
+     */
+    static Placement getPlacement();
+
+    /*!
+     * \brief Pin the calling thread to the processor that belongs to the
+     * thread with the given index, if threads are placed.
+     * \param thread_idx The index of the thread within its team.
+     */
+    static void pinThread(const size_t thread_idx);
+
+    /*!
+     * \brief Get the NUMA node that the thread with the given index is pinned
+     * to, or 0 if threads aren't placed.
+     * \param thread_idx The index of the thread within its team.
+     */
+    static size_t getNode(const size_t thread_idx);
+
+    /*!
+     * \brief Choose the processor of a thread.
+     * \param node_processors For each NUMA node, the processors that belong to
+     * it. None of the nodes is empty.
+     * \param placement How threads are distributed over the nodes. Must not be
+     * NONE.
+     * \param thread_idx The index of the thread within its team.
+     * \return The processor and the index of its node in \p node_processors.
+     */
+    static std::pair<int, size_t> place(const std::vector<std::vector<int>>& node_processors, const Placement placement, const size_t thread_idx);
+
+    /*!
+     * \brief Parse a list of processors in the format of Linux, like
+     * "0-3,8,10-11".
+     * \param list The list to parse.
+     * \param[out] processors The processors in the list.
+     * \return Whether the list could be parsed.
+     */
+    static bool parseProcessorList(const std::string& list, std::vector<int>& processors);
+
+private:
+    /*!
+     * \brief For each NUMA node with processors that this process may use,
+     * those processors.
+     *
+     * The topology is read once. If it can't be read, all processors that the
+     * process may use form a single node, or there are no nodes at all if the
+     * platform isn't supported.
+     */
+    static const std::vector<std::vector<int>>& getNodeProcessors();
+};
+
+} //namespace cura
+
+#endif //UTILS_THREAD_AFFINITY_H
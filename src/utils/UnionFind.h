@@ -28,6 +28,7 @@ class UnionFind
 {
 public:
     UnionFind(const Hash& hash = Hash())
+    : mapped_items(0)
     {
         element_to_position = std::unordered_map<E, size_t, Hash>(10, hash);
     }
@@ -45,7 +46,6 @@ public:
     {
         items.push_back(item);
         size_t handle = parent_index.size(); //Guaranteed to be unique because there has never been any item with this index (can't remove from this data structure!)
-        element_to_position[item] = handle;
         parent_index.push_back(handle);
         rank.push_back(1);
         return handle;
@@ -60,6 +60,11 @@ public:
      */
     size_t find(const E& item)
     {
+        //Only now map the items that were added since the last search. Users that only work with handles never need the map.
+        for (; mapped_items < items.size(); mapped_items++)
+        {
+            element_to_position[items[mapped_items]] = mapped_items;
+        }
         const typename std::unordered_map<E, size_t, Hash>::const_iterator it = element_to_position.find(item);
         if (it == element_to_position.end())
         {
@@ -192,6 +197,11 @@ private:
      */
     std::unordered_map<E, size_t, Hash> element_to_position;
 
+    /*!
+     * How many of the first items are in \ref element_to_position already.
+     */
+    size_t mapped_items;
+
     /*!
      * For each item, the set handle of the parent item.
      *
@@ -0,0 +1,69 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm> // sort, remove_if
+#include <limits>
+
+#include "ZIntervalIndex.h"
+
+namespace cura
+{
+
+ZIntervalIndex::Sweep::Sweep(const ZIntervalIndex& index)
+: index(index)
+, next_interval_idx(0)
+, last_lower(std::numeric_limits<coord_t>::lowest())
+, last_upper(std::numeric_limits<coord_t>::lowest())
+{
+}
+
+const std::vector<size_t>& ZIntervalIndex::Sweep::advance(const coord_t lower, const coord_t upper)
+{
+    if (lower < last_lower || upper < last_upper)
+    { // Going down. Start over from the bottom.
+        next_interval_idx = 0;
+        active.clear();
+    }
+    last_lower = lower;
+    last_upper = upper;
+
+    // Activate all intervals that start below the top of the range.
+    while (next_interval_idx < index.intervals.size() && index.intervals[next_interval_idx].min_z <= upper)
+    {
+        active.push_back(index.intervals[next_interval_idx]);
+        next_interval_idx++;
+    }
+
+    // Drop all intervals that end below the bottom of the range. Since the range never goes down, they'll never become relevant again.
+    active.erase(std::remove_if(active.begin(), active.end(), [lower](const Interval& interval) { return interval.max_z < lower; }), active.end());
+
+    result.clear();
+    for (const Interval& interval : active)
+    {
+        result.push_back(interval.id);
+    }
+    return result;
+}
+
+void ZIntervalIndex::insert(const coord_t min_z, const coord_t max_z, const size_t id)
+{
+    intervals.push_back({min_z, max_z, id});
+}
+
+void ZIntervalIndex::finalize()
+{
+    // Stable, so that intervals starting at the same height keep their insertion order.
+    std::stable_sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) { return a.min_z < b.min_z; });
+}
+
+void ZIntervalIndex::reserve(const size_t count)
+{
+    intervals.reserve(count);
+}
+
+size_t ZIntervalIndex::size() const
+{
+    return intervals.size();
+}
+
+} // namespace cura
@@ -0,0 +1,112 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_Z_INTERVAL_INDEX_H
+#define UTILS_Z_INTERVAL_INDEX_H
+
+#include <vector>
+
+#include "Coord_t.h"
+
+namespace cura
+{
+
+/*!
+ * \brief An index over a set of intervals along the Z axis, such as the
+ * height ranges of the faces of a mesh.
+ *
+ * The intervals are sorted by their lower bound. Queries are done with a
+ * \ref ZIntervalIndex::Sweep, which moves upward through the index and keeps
+ * track of the intervals that are currently active. Going through all layers
+ * of a mesh this way only visits every interval a constant number of times,
+ * rather than once for every layer.
+ */
+class ZIntervalIndex
+{
+public:
+    /*!
+     * \brief A single interval in the index.
+     */
+    struct Interval
+    {
+        coord_t min_z; //!< The lowest Z coordinate covered by this interval.
+        coord_t max_z; //!< The highest Z coordinate covered by this interval.
+        size_t id; //!< The identifier of the object that this interval belongs to, e.g. a face index.
+    };
+
+    /*!
+     * \brief Walks upward through the index, reporting which intervals overlap
+     * with a Z range.
+     *
+     * Each sweep has its own state, so multiple threads can each sweep
+     * through the same index at the same time.
+     */
+    class Sweep
+    {
+    public:
+        /*!
+         * \brief Start a new sweep from the bottom of an index.
+         * \param index The index to sweep through. It must outlive the sweep.
+         */
+        Sweep(const ZIntervalIndex& index);
+
+        /*!
+         * \brief Get the identifiers of all intervals that overlap with the
+         * range from \p lower to \p upper, inclusive.
+         *
+         * The sweep is fastest if \p lower and \p upper never decrease between
+         * subsequent calls. If they do, the sweep starts over from the bottom
+         * of the index.
+         *
+         * The identifiers are returned in no particular order.
+         * \param lower The lower bound of the range to query.
+         * \param upper The upper bound of the range to query.
+         * \return The identifiers of the overlapping intervals. The reference
+         * is invalidated by the next call to this function.
+         */
+        const std::vector<size_t>& advance(const coord_t lower, const coord_t upper);
+
+    private:
+        const ZIntervalIndex& index; //!< The index to sweep through.
+        size_t next_interval_idx; //!< The first interval in the index that hasn't been activated yet.
+        coord_t last_lower; //!< The lower bound of the previous query.
+        coord_t last_upper; //!< The upper bound of the previous query.
+        std::vector<Interval> active; //!< The intervals that started below the previous upper bound and didn't end below the previous lower bound.
+        std::vector<size_t> result; //!< Storage for the result of the last query.
+    };
+
+    /*!
+     * \brief Add an interval to the index.
+     *
+     * After adding all intervals, call \ref finalize before sweeping through
+     * the index.
+     * \param min_z The lowest Z coordinate covered by the interval.
+     * \param max_z The highest Z coordinate covered by the interval.
+     * \param id An identifier to report back when the interval is found.
+     */
+    void insert(const coord_t min_z, const coord_t max_z, const size_t id);
+
+    /*!
+     * \brief Sort the intervals, so that the index can be queried.
+     */
+    void finalize();
+
+    /*!
+     * \brief Reserve room for a number of intervals.
+     * \param count The number of intervals that will be inserted.
+     */
+    void reserve(const size_t count);
+
+    /*!
+     * \brief Get the number of intervals in this index.
+     * \return The number of intervals.
+     */
+    size_t size() const;
+
+private:
+    std::vector<Interval> intervals; //!< All intervals, sorted by min_z after finalizing.
+};
+
+} // namespace cura
+
+#endif // UTILS_Z_INTERVAL_INDEX_H
@@ -7,6 +7,10 @@
 #include <functional>
 #include <numeric>
 
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+
 // extensions to algorithm.h from the standard library
 
 namespace cura
@@ -41,6 +45,61 @@ std::vector<size_t> order(const std::vector<T> &in)
     return order;
 }
 
+/*!
+ * Sort a vector using multiple threads, if OpenMP is available.
+ *
+ * The vector is split into one block per thread. The blocks are sorted in
+ * parallel, and then merged pairwise until one sorted block remains.
+ *
+ * Like std::sort, this is not stable. Use a comparison with a tie-breaker if
+ * the order of equal elements matters.
+ *
+ * \param[in,out] data The vector to sort.
+ * \param less The comparison function giving a strict weak ordering.
+ */
+template<typename T, typename Compare>
+void parallelSort(std::vector<T>& data, const Compare& less)
+{
+    size_t block_count = 1;
+#ifdef _OPENMP
+    block_count = std::max(1, omp_get_max_threads());
+#endif // _OPENMP
+    constexpr size_t minimum_block_size = 1 << 14; // below this, the overhead of threading is larger than what it gains
+    block_count = std::max(size_t(1), std::min(block_count, data.size() / minimum_block_size));
+    if (block_count == 1)
+    {
+        std::sort(data.begin(), data.end(), less);
+        return;
+    }
+
+    std::vector<size_t> block_start(block_count + 1);
+    for (size_t block_idx = 0; block_idx <= block_count; block_idx++)
+    {
+        block_start[block_idx] = data.size() * block_idx / block_count;
+    }
+
+    #pragma omp parallel for schedule(static)
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    for (int block_idx = 0; block_idx < static_cast<int>(block_count); block_idx++)
+    {
+        std::sort(data.begin() + block_start[block_idx], data.begin() + block_start[block_idx + 1], less);
+    }
+
+    for (size_t merge_width = 1; merge_width < block_count; merge_width *= 2)
+    {
+        #pragma omp parallel for schedule(static)
+        // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+        for (int block_idx = 0; block_idx < static_cast<int>(block_count); block_idx += 2 * merge_width)
+        {
+            if (block_idx + merge_width < block_count)
+            {
+                const size_t end_block_idx = std::min(block_idx + 2 * merge_width, block_count);
+                std::inplace_merge(data.begin() + block_start[block_idx], data.begin() + block_start[block_idx + merge_width], data.begin() + block_start[end_block_idx], less);
+            }
+        }
+    }
+}
+
 } // namespace cura
 
 #endif // UTILS_ALGORITHM_H
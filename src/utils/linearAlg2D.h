@@ -119,8 +119,7 @@ public:
         }
         else
         {
-            Point ret = p0 + projected_x / vSize(direction) * direction  / vSize(direction);
-            return ret;
+            return p0 + Point(mulDiv(direction.X, projected_x, x_p1), mulDiv(direction.Y, projected_x, x_p1));
         }
     }
 
@@ -160,15 +159,15 @@ public:
     *      'c
     * 
     * x = b projected on ac
-    * ax = ab dot ac / vSize(ac)
-    * xb = ab - ax
-    * error = vSize(xb)
+    * error = vSize(xb) = |ab x ac| / vSize(ac)
+    * 
+    * This is computed exactly in integers, without taking square roots.
     */
         const Point ac = c - a;
-        const coord_t ac_size = vSize(ac);
+        const coord_t ac_size2 = vSize2(ac);
 
         const Point ab = b - a;
-        if (ac_size == 0) 
+        if (ac_size2 == 0) 
         {
             const coord_t ab_dist2 = vSize2(ab); 
             if (ab_dist2 == 0 && b_is_beyond_ac)
@@ -178,10 +177,9 @@ public:
             // otherwise variable b_is_beyond_ac remains its value; it doesn't make sense to choose between -1 and 1
             return ab_dist2;
         }
-        const coord_t projected_x = dot(ab, ac);
-        const coord_t ax_size = projected_x / ac_size;
+        const coord_t projected_x = dot(ab, ac); // The length of ax, times the length of ac.
 
-        if (ax_size < 0) 
+        if (projected_x < 0) 
         {// b is 'before' segment ac 
             if (b_is_beyond_ac)
             {
@@ -189,7 +187,7 @@ public:
             }
             return vSize2(ab);
         }
-        if (ax_size > ac_size)
+        if (projected_x > ac_size2)
         {// b is 'after' segment ac
             if (b_is_beyond_ac)
             {
@@ -202,10 +200,8 @@ public:
         {
             *b_is_beyond_ac = 0;
         }
-        const Point ax = ac * ax_size / ac_size;
-        const Point bx = ab - ax;
-        return vSize2(bx);
-//         return vSize2(ab) - ax_size*ax_size; // less accurate
+        const coord_t cross = ab.X * ac.Y - ab.Y * ac.X; // The length of xb, times the length of ac.
+        return mulDiv(cross, cross, ac_size2);
     }
 
     /*!
@@ -341,6 +337,28 @@ public:
         return dot(ba, bc);
     }
 
+    /*!
+     * Compute \p value * \p numerator / \p denominator exactly, rounded
+     * towards zero, even if the product doesn't fit in a coord_t.
+     * 
+     * Products of squared lengths of micrometre coordinates easily overflow 64
+     * bits, so these are computed with 128 bits where the compiler supports
+     * that, and with a long double otherwise.
+     */
+    static inline coord_t mulDiv(const coord_t value, const coord_t numerator, const coord_t denominator)
+    {
+        constexpr coord_t max_factor = 3037000499; //Square root of the largest coord_t, so the product of two of these can't overflow.
+        if (value <= max_factor && value >= -max_factor && numerator <= max_factor && numerator >= -max_factor)
+        {
+            return value * numerator / denominator;
+        }
+#ifdef __SIZEOF_INT128__
+        return static_cast<coord_t>(static_cast<__int128>(value) * numerator / denominator);
+#else
+        return static_cast<coord_t>(static_cast<long double>(value) * numerator / denominator);
+#endif
+    }
+
     /*!
      * Get the rotation matrix for rotating around a specific point in place.
      */
@@ -1,107 +1,135 @@
-/** Copyright (C) 2013 Ultimaker - Released under terms of the AGPLv3 License */
-#include <stdio.h>
-#include <stdarg.h>
-
-#ifdef _OPENMP
-    #include <omp.h>
-#endif // _OPENMP
-#include "logoutput.h"
-
-namespace cura {
-
-static int verbose_level;
-static bool progressLogging;
-
-void increaseVerboseLevel()
-{
-    verbose_level++;
-}
-
-void enableProgressLogging()
-{
-    progressLogging = true;
-}
-
-void logError(const char* fmt, ...)
-{
-    #pragma omp critical
-    {
-        va_list args;
-        va_start(args, fmt);
-        fprintf(stderr, "[ERROR] ");
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-        fflush(stderr);
-    }
-}
-
-void logWarning(const char* fmt, ...)
-{
-    #pragma omp critical
-    {
-        va_list args;
-        va_start(args, fmt);
-        fprintf(stderr, "[WARNING] ");
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-        fflush(stderr);
-    }
-}
-
-void logAlways(const char* fmt, ...)
-{
-    #pragma omp critical
-    {
-        va_list args;
-        va_start(args, fmt);
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-        fflush(stderr);
-    }
-}
-
-void log(const char* fmt, ...)
-{
-    if (verbose_level < 1)
-        return;
-
-    #pragma omp critical
-    {
-        va_list args;
-        va_start(args, fmt);
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-        fflush(stderr);
-    }
-}
-
-void logDebug(const char* fmt, ...)
-{
-    if (verbose_level < 2)
-    {
-        return;
-    }
-    #pragma omp critical
-    {
-        va_list args;
-        va_start(args, fmt);
-        fprintf(stderr, "[DEBUG] ");
-        vfprintf(stderr, fmt, args);
-        va_end(args);
-        fflush(stderr);
-    }
-}
-
-void logProgress(const char* type, int value, int maxValue, float percent)
-{
-    if (!progressLogging)
-        return;
-
-    #pragma omp critical
-    {
-        fprintf(stderr, "Progress:%s:%i:%i \t%f%%\n", type, value, maxValue, percent);
-        fflush(stderr);
-    }
-}
-
-}//namespace cura
+/** Copyright (C) 2013 Ultimaker - Released under terms of the AGPLv3 License */
+#include <algorithm> //For std::min.
+#include <stdio.h>
+#include <stdarg.h>
+#include <vector>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif // _OPENMP
+#include "logoutput.h"
+
+namespace cura {
+
+static int verbose_level;
+static bool progressLogging;
+
+/*
+ * \brief Write a message to stderr in one go.
+ *
+ * The message is formatted before the lock is taken, so that threads which
+ * log at the same time only wait for each other while the finished line is
+ * written, not while it's being formatted. The lock is a named critical
+ * section of its own, so logging doesn't wait for unrelated critical
+ * sections either.
+ *
+ * \param prefix The text to put before the message, such as the level.
+ * \param fmt The printf-style format of the message.
+ * \param args The arguments of the format.
+ */
+static void logMessage(const char* prefix, const char* fmt, va_list args)
+{
+    char stack_buffer[1024];
+    std::vector<char> heap_buffer;
+    char* buffer = stack_buffer;
+    const int prefix_length = snprintf(stack_buffer, sizeof(stack_buffer), "%s", prefix);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    const int message_length = vsnprintf(stack_buffer + prefix_length, sizeof(stack_buffer) - prefix_length, fmt, args_copy);
+    va_end(args_copy);
+    if (message_length < 0)
+    {
+        return;
+    }
+    const size_t length = prefix_length + message_length;
+    if (length >= sizeof(stack_buffer)) //Didn't fit. Format it again in a buffer that's large enough.
+    {
+        heap_buffer.resize(length + 1);
+        buffer = heap_buffer.data();
+        snprintf(buffer, heap_buffer.size(), "%s", prefix);
+        vsnprintf(buffer + prefix_length, heap_buffer.size() - prefix_length, fmt, args);
+    }
+
+    #pragma omp critical (log)
+    {
+        fwrite(buffer, 1, length, stderr);
+        fflush(stderr);
+    }
+}
+
+void increaseVerboseLevel()
+{
+    verbose_level++;
+}
+
+void enableProgressLogging()
+{
+    progressLogging = true;
+}
+
+void logError(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    logMessage("[ERROR] ", fmt, args);
+    va_end(args);
+}
+
+void logWarning(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    logMessage("[WARNING] ", fmt, args);
+    va_end(args);
+}
+
+void logAlways(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    logMessage("", fmt, args);
+    va_end(args);
+}
+
+void log(const char* fmt, ...)
+{
+    if (verbose_level < 1)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    logMessage("", fmt, args);
+    va_end(args);
+}
+
+void logDebug(const char* fmt, ...)
+{
+    if (verbose_level < 2)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    logMessage("[DEBUG] ", fmt, args);
+    va_end(args);
+}
+
+void logProgress(const char* type, int value, int maxValue, float percent)
+{
+    if (!progressLogging)
+        return;
+
+    char buffer[256];
+    const int length = snprintf(buffer, sizeof(buffer), "Progress:%s:%i:%i \t%f%%\n", type, value, maxValue, percent);
+    if (length < 0)
+    {
+        return;
+    }
+    #pragma omp critical (log)
+    {
+        fwrite(buffer, 1, std::min(static_cast<size_t>(length), sizeof(buffer) - 1), stderr);
+        fflush(stderr);
+    }
+}
+
+}//namespace cura
@@ -3,6 +3,7 @@
 #define UTILS_MATH_H
 
 #include <cmath>
+#include <cstdint> //For uint64_t.
 
 
 //c++11 no longer defines M_PI, so add our own constant.
@@ -25,6 +26,10 @@ inline unsigned int round_up_divide(unsigned int dividend, unsigned int divisor)
 {
     return (dividend + divisor - 1) / divisor;
 }
+inline void hash_combine(uint64_t& hash, const uint64_t value) //!< Mix a value into a hash
+{
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+}
 
 }//namespace cura
 #endif // UTILS_MATH_H
@@ -3,9 +3,12 @@
 
 #include "polygon.h"
 
+#include "AABB.h"
+
 #include "linearAlg2D.h" // pointLiesOnTheRightOfLine
 
 #include "ListPolyIt.h"
+#include "PolygonBooleanBackend.h"
 
 namespace cura
 {
@@ -69,10 +72,7 @@ bool ConstPolygonRef::_inside(Point p, bool border_result) const
 Polygons ConstPolygonRef::intersection(const ConstPolygonRef& other) const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
-    clipper.AddPath(*path, ClipperLib::ptSubject, true);
-    clipper.AddPath(*other.path, ClipperLib::ptClip, true);
-    clipper.Execute(ClipperLib::ctIntersection, ret.paths);
+    PolygonBooleanBackend::getInstance().intersection(ClipperLib::Paths(1, *path), ClipperLib::Paths(1, *other.path), ret.paths);
     return ret;
 }
 
@@ -81,23 +81,84 @@ bool Polygons::empty() const
     return paths.empty();
 }
 
-Polygons Polygons::approxConvexHull(int extra_outset)
+void Polygons::difference(const Polygons& other, ClipperLib::Paths& result) const
 {
-    constexpr int overshoot = 100000; //10cm (hard-coded value).
+    PolygonBooleanBackend::getInstance().difference(paths, other.paths, result);
+}
+
+void Polygons::unionPolygons(const Polygons& other, ClipperLib::Paths& result) const
+{
+    PolygonBooleanBackend::getInstance().unionPolygons(paths, other.paths, ClipperLib::pftNonZero, result);
+}
+
+void Polygons::intersection(const Polygons& other, ClipperLib::Paths& result) const
+{
+    PolygonBooleanBackend::getInstance().intersection(paths, other.paths, result);
+}
+
+Polygon Polygons::convexHull() const
+{
+    std::vector<Point> points;
+    points.reserve(pointCount());
+    for (const ClipperLib::Path& path : paths)
+    {
+        points.insert(points.end(), path.begin(), path.end());
+    }
+    std::sort(points.begin(), points.end(), [](const Point& a, const Point& b)
+    {
+        return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+    });
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    //Whether the corner at b turns left, i.e. is a proper corner of a counter-clockwise hull.
+    const auto turns_left = [](const Point& a, const Point& b, const Point& c)
+    {
+        return (b.X - a.X) * (c.Y - a.Y) - (b.Y - a.Y) * (c.X - a.X) > 0;
+    };
+
+    Polygon hull;
+    if (points.size() < 3)
+    {
+        for (const Point& point : points)
+        {
+            hull.add(point);
+        }
+        return hull;
+    }
+    ClipperLib::Path& hull_path = *hull;
+    hull_path.reserve(points.size() + 1);
+    //Lower hull, from left to right.
+    for (const Point& point : points)
+    {
+        while (hull_path.size() >= 2 && !turns_left(hull_path[hull_path.size() - 2], hull_path.back(), point))
+        {
+            hull_path.pop_back();
+        }
+        hull_path.push_back(point);
+    }
+    //Upper hull, from right to left, ending at the leftmost point again.
+    const size_t lower_size = hull_path.size();
+    for (size_t point_idx = points.size() - 1; point_idx-- > 0;)
+    {
+        while (hull_path.size() > lower_size && !turns_left(hull_path[hull_path.size() - 2], hull_path.back(), points[point_idx]))
+        {
+            hull_path.pop_back();
+        }
+        hull_path.push_back(points[point_idx]);
+    }
+    hull_path.pop_back(); //The leftmost point was added twice.
+    return hull;
+}
 
+Polygons Polygons::approxConvexHull(int extra_outset)
+{
     Polygons convex_hull;
-    //Perform the offset for each polygon one at a time.
-    //This is necessary because the polygons may overlap, in which case the offset could end up in an infinite loop.
-    //See http://www.angusj.com/delphi/clipper/documentation/Docs/Units/ClipperLib/Classes/ClipperOffset/_Body.htm
-    for (const ClipperLib::Path path : paths)
+    Polygon hull = convexHull();
+    if (hull.size() >= 3)
     {
-        Polygons offset_result;
-        ClipperLib::ClipperOffset offsetter(1.2, 10.0);
-        offsetter.AddPath(path, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
-        offsetter.Execute(offset_result.paths, overshoot);
-        convex_hull.add(offset_result);
+        convex_hull.add(std::move(hull));
     }
-    return convex_hull.unionPolygons().offset(-overshoot + extra_outset, ClipperLib::jtRound);
+    return convex_hull.offset(extra_outset, ClipperLib::jtRound);
 }
 
 unsigned int Polygons::pointCount() const
@@ -110,6 +171,16 @@ unsigned int Polygons::pointCount() const
     return count;
 }
 
+size_t Polygons::getMemorySize() const
+{
+    size_t size = sizeof(Polygons);
+    for (const ClipperLib::Path& path : paths)
+    {
+        size += sizeof(ClipperLib::Path) + path.size() * sizeof(Point);
+    }
+    return size;
+}
+
 bool Polygons::inside(Point p, bool border_result) const
 {
     int poly_count_inside = 0;
@@ -240,10 +311,7 @@ unsigned int Polygons::findInside(Point p, bool border_result)
 Polygons Polygons::intersectionPolyLines(const Polygons& polylines) const
 {
     ClipperLib::PolyTree result;
-    ClipperLib::Clipper clipper(clipper_init);
-    clipper.AddPaths(polylines.paths, ClipperLib::ptSubject, false);
-    clipper.AddPaths(paths, ClipperLib::ptClip, true);
-    clipper.Execute(ClipperLib::ctIntersection, result);
+    PolygonBooleanBackend::getInstance().intersectionPolyLines(polylines.paths, paths, result);
     Polygons ret;
     ret.addPolyTreeNodeRecursive(result);
     return ret;
@@ -265,17 +333,65 @@ coord_t Polygons::polyLineLength() const
     return length;
 }
 
-Polygons Polygons::offset(int distance, ClipperLib::JoinType join_type, double miter_limit) const
+void Polygons::offset(int distance, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::Paths& result) const
+{
+    PolygonBooleanBackend::getInstance().offset(unionPolygons().paths, distance, join_type, ClipperLib::etClosedPolygon, miter_limit, result);
+}
+
+std::vector<Polygons> Polygons::offsetLadder(int first_distance, int spacing, size_t max_count, ClipperLib::JoinType join_type, double miter_limit) const
+{
+    assert((max_count > 0 || spacing < 0) && "An outward ladder needs a maximum number of offsets, since it never becomes empty.");
+    std::vector<Polygons> ret;
+    Polygons result = offset(first_distance, join_type, miter_limit);
+    if (max_count == 0 && spacing >= 0)
+    { // the results would never become empty, so only the first one is given
+        if (!result.empty())
+        {
+            ret.push_back(std::move(result));
+        }
+        return ret;
+    }
+    while (!result.empty())
+    {
+        ret.push_back(std::move(result));
+        if (ret.size() == max_count)
+        {
+            break;
+        }
+        if (spacing == 0)
+        {
+            result = ret.back();
+            continue;
+        }
+        // Clipper already unions the result of an offset, so unlike Polygons::offset this doesn't need to union its input again.
+        PolygonBooleanBackend::getInstance().offset(ret.back().paths, spacing, join_type, ClipperLib::etClosedPolygon, miter_limit, result.paths);
+    }
+    return ret;
+}
+
+std::vector<Polygons> Polygons::offsetEach(const std::vector<const Polygons*>& polygons, int distance, ClipperLib::JoinType join_type, double miter_limit)
 {
+    std::vector<Polygons> ret(polygons.size());
     if (distance == 0)
     {
-        return *this;
+        for (size_t polygons_idx = 0; polygons_idx < polygons.size(); polygons_idx++)
+        {
+            ret[polygons_idx] = *polygons[polygons_idx];
+        }
+        return ret;
+    }
+    std::vector<const ClipperLib::Paths*> inputs;
+    inputs.reserve(polygons.size());
+    for (const Polygons* input : polygons)
+    {
+        inputs.push_back(&input->paths);
+    }
+    std::vector<ClipperLib::Paths> results;
+    PolygonBooleanBackend::getInstance().offsetEach(inputs, distance, join_type, miter_limit, results);
+    for (size_t polygons_idx = 0; polygons_idx < polygons.size(); polygons_idx++)
+    {
+        ret[polygons_idx].paths = std::move(results[polygons_idx]);
     }
-    Polygons ret;
-    ClipperLib::ClipperOffset clipper(miter_limit, 10.0);
-    clipper.AddPaths(unionPolygons().paths, join_type, ClipperLib::etClosedPolygon);
-    clipper.MiterLimit = miter_limit;
-    clipper.Execute(ret.paths, distance);
     return ret;
 }
 
@@ -288,10 +404,7 @@ Polygons ConstPolygonRef::offset(int distance, ClipperLib::JoinType join_type, d
         return ret;
     }
     Polygons ret;
-    ClipperLib::ClipperOffset clipper(miter_limit, 10.0);
-    clipper.AddPath(*path, join_type, ClipperLib::etClosedPolygon);
-    clipper.MiterLimit = miter_limit;
-    clipper.Execute(ret.paths, distance);
+    PolygonBooleanBackend::getInstance().offset(ClipperLib::Paths(1, *path), distance, join_type, ClipperLib::etClosedPolygon, miter_limit, ret.paths);
     return ret;
 }
 
@@ -307,7 +420,11 @@ void PolygonRef::simplify(const coord_t smallest_line_segment_squared, const coo
         return;
     }
 
-    ClipperLib::Path new_path;
+    //Build the result in a buffer that is kept per thread, so that simplifying the many polygons of a slice doesn't allocate for every polygon.
+    //It's swapped with the original path at the end, so the buffer of the original is what gets reused for the next polygon.
+    static thread_local ClipperLib::Path new_path;
+    new_path.clear();
+    new_path.reserve(size());
     Point previous = path->at(0);
     Point current = path->at(1);
     /* When removing a vertex, we'll check if the delta area of the polygon
@@ -387,7 +504,7 @@ void PolygonRef::simplify(const coord_t smallest_line_segment_squared, const coo
         new_path.erase(new_path.begin());
     }
 
-    *path = new_path;
+    path->swap(new_path);
 }
 
 void PolygonRef::applyMatrix(const PointMatrix& matrix)
@@ -408,11 +525,8 @@ void PolygonRef::applyMatrix(const Point3Matrix& matrix)
 Polygons Polygons::getOutsidePolygons() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree poly_tree;
-    constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    PolygonBooleanBackend::getInstance().unionTree(paths, ClipperLib::pftEvenOdd, poly_tree);
 
     for (int outer_poly_idx = 0; outer_poly_idx < poly_tree.ChildCount(); outer_poly_idx++)
     {
@@ -425,11 +539,8 @@ Polygons Polygons::getOutsidePolygons() const
 Polygons Polygons::removeEmptyHoles() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree poly_tree;
-    constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    PolygonBooleanBackend::getInstance().unionTree(paths, ClipperLib::pftEvenOdd, poly_tree);
 
     bool remove_holes = true;
     removeEmptyHoles_processPolyTreeNode(poly_tree, remove_holes, ret);
@@ -439,11 +550,8 @@ Polygons Polygons::removeEmptyHoles() const
 Polygons Polygons::getEmptyHoles() const
 {
     Polygons ret;
-    ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree poly_tree;
-    constexpr bool paths_are_closed_polys = true;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, paths_are_closed_polys);
-    clipper.Execute(ClipperLib::ctUnion, poly_tree);
+    PolygonBooleanBackend::getInstance().unionTree(paths, ClipperLib::pftEvenOdd, poly_tree);
 
     bool remove_holes = false;
     removeEmptyHoles_processPolyTreeNode(poly_tree, remove_holes, ret);
@@ -866,9 +974,14 @@ void ConstPolygonRef::smooth_outward(const AngleDegrees min_angle, int shortcut_
 
         const Point v10 = p0 - p1;
         const Point v12 = p2 - p1;
-        float cos_angle = INT2MM(INT2MM(dot(v10, v12))) / vSizeMM(v10) / vSizeMM(v12);
         bool is_left_angle = LinearAlg2D::pointIsLeftOfLine(p1, p0, p2) > 0;
-        if (cos_angle > cos_min_angle && is_left_angle)
+        if (!is_left_angle)
+        { // only inner corners are smoothed, so don't bother computing the angle
+            ++p1_it;
+            continue;
+        }
+        float cos_angle = INT2MM(INT2MM(dot(v10, v12))) / vSizeMM(v10) / vSizeMM(v12);
+        if (cos_angle > cos_min_angle)
         {
             // angle is so sharp that it can be removed
             Point v02 = p2_it.p() - p0_it.p();
@@ -899,8 +1012,12 @@ void ConstPolygonRef::smooth_outward(const AngleDegrees min_angle, int shortcut_
 
 Polygons Polygons::smooth_outward(const AngleDegrees max_angle, int shortcut_length)
 {
-    Polygons ret;
-    for (unsigned int p = 0; p < size(); p++)
+    // the polygons are smoothed independently, each into its own slot so that they stay in order
+    Polygons smoothed;
+    smoothed.paths.resize(paths.size());
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    #pragma omp parallel for if (paths.size() > 1) shared(smoothed, shortcut_length) schedule(dynamic)
+    for (int p = 0; p < static_cast<int>(paths.size()); p++)
     {
         PolygonRef poly(paths[p]);
         if (poly.size() < 3)
@@ -909,13 +1026,18 @@ Polygons Polygons::smooth_outward(const AngleDegrees max_angle, int shortcut_len
         }
         if (poly.size() == 3)
         {
-            ret.add(poly);
+            smoothed.paths[p] = paths[p];
             continue;
         }
-        poly.smooth_outward(max_angle, shortcut_length, ret.newPoly());
-        if (ret.back().size() < 3)
+        poly.smooth_outward(max_angle, shortcut_length, smoothed[p]);
+    }
+
+    Polygons ret;
+    for (ClipperLib::Path& path : smoothed.paths)
+    {
+        if (path.size() >= 3)
         {
-            ret.paths.resize(ret.paths.size() - 1);
+            ret.paths.emplace_back(std::move(path));
         }
     }
     return ret;
@@ -943,8 +1065,10 @@ void ConstPolygonRef::smooth(int remove_length, PolygonRef result) const
     {
         poly->push_back(thiss[0]);
     }
-    auto is_zigzag = [remove_length](const int64_t v02_size, const int64_t v12_size, const int64_t v13_size, const int64_t dot1, const int64_t dot2)
+    // the lengths are only computed once the cheaper tests have passed, since most corners fail those
+    auto is_zigzag = [remove_length](const Point v02, const Point v12, const Point v13, const int64_t dot1, const int64_t dot2)
     {
+        const int64_t v12_size = vSize(v12);
         if (v12_size > remove_length)
         { // v12 or v13 is too long
             return false;
@@ -959,11 +1083,11 @@ void ConstPolygonRef::smooth(int remove_length, PolygonRef result) const
         { // l0123 doesn't constitute a zigzag ''|,,
             return false;
         }
-        if (-dot1 <= v02_size * v12_size / 2)
+        if (-dot1 <= vSize(v02) * v12_size / 2)
         { // angle at p1 isn't sharp enough
             return false;
         }
-        if (-dot2 <= v13_size * v12_size / 2)
+        if (-dot2 <= vSize(v13) * v12_size / 2)
         { // angle at p2 isn't sharp enough
             return false;
         }
@@ -971,7 +1095,6 @@ void ConstPolygonRef::smooth(int remove_length, PolygonRef result) const
     };
     Point v02 = thiss[2] - thiss[0];
     Point v02T = turn90CCW(v02);
-    int64_t v02_size = vSize(v02);
     bool force_push = false;
     for (unsigned int poly_idx = 1; poly_idx < size(); poly_idx++)
     {
@@ -979,17 +1102,14 @@ void ConstPolygonRef::smooth(int remove_length, PolygonRef result) const
         const Point& p2 = thiss[(poly_idx + 1) % size()];
         const Point& p3 = thiss[(poly_idx + 2) % size()];
         // v02 computed in last iteration
-        // v02_size as well
         const Point v12 = p2 - p1;
-        const int64_t v12_size = vSize(v12);
         const Point v13 = p3 - p1;
-        const int64_t v13_size = vSize(v13);
 
         // v02T computed in last iteration
         const int64_t dot1 = dot(v02T, v12);
         const Point v13T = turn90CCW(v13);
         const int64_t dot2 = dot(v13T, v12);
-        bool push_point = force_push || !is_zigzag(v02_size, v12_size, v13_size, dot1, dot2);
+        bool push_point = force_push || !is_zigzag(v02, v12, v13, dot1, dot2);
         force_push = false;
         if (push_point)
         {
@@ -1002,14 +1122,17 @@ void ConstPolygonRef::smooth(int remove_length, PolygonRef result) const
         }
         v02T = v13T;
         v02 = v13;
-        v02_size = v13_size;
     }
 }
 
 Polygons Polygons::smooth(int remove_length) const
 {
+    // the polygons are smoothed independently, each into its own slot so that they stay in order
     Polygons ret;
-    for (unsigned int p = 0; p < size(); p++)
+    ret.paths.resize(paths.size());
+    // Use a signed type for the loop counter so MSVC compiles (because it uses OpenMP 2.0, an old version).
+    #pragma omp parallel for if (paths.size() > 1) shared(ret, remove_length) schedule(dynamic)
+    for (int p = 0; p < static_cast<int>(paths.size()); p++)
     {
         ConstPolygonRef poly(paths[p]);
         if (poly.size() < 3)
@@ -1018,16 +1141,31 @@ Polygons Polygons::smooth(int remove_length) const
         }
         if (poly.size() == 3)
         {
-            ret.add(poly);
+            ret.paths[p] = paths[p];
             continue;
         }
-        poly.smooth(remove_length, ret.newPoly());
-        PolygonRef back = ret.back();
+        PolygonRef back = ret[p];
+        poly.smooth(remove_length, back);
         if (back.size() < 3)
         {
             back.path->resize(back.path->size() - 1);
         }
     }
+
+    // drop the slots of the polygons that were skipped
+    size_t kept_count = 0;
+    for (size_t p = 0; p < paths.size(); p++)
+    {
+        if (paths[p].size() >= 3)
+        {
+            if (kept_count != p)
+            {
+                ret.paths[kept_count] = std::move(ret.paths[p]);
+            }
+            kept_count++;
+        }
+    }
+    ret.paths.resize(kept_count);
     return ret;
 }
 
@@ -1100,29 +1238,49 @@ double Polygons::area() const
 std::vector<PolygonsPart> Polygons::splitIntoParts(bool unionAll) const
 {
     std::vector<PolygonsPart> ret;
-    ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree resultPolyTree;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-    if (unionAll)
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
-    else
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree);
+    PolygonBooleanBackend::getInstance().unionTree(paths, unionAll ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd, resultPolyTree);
+
+    splitIntoParts_processPolyTreeNode(&resultPolyTree, ret, nullptr);
+    return ret;
+}
 
-    splitIntoParts_processPolyTreeNode(&resultPolyTree, ret);
+std::vector<PolygonsPart> Polygons::splitIntoParts(bool unionAll, std::vector<unsigned int>& enclosing_parts) const
+{
+    std::vector<PolygonsPart> ret;
+    ClipperLib::PolyTree resultPolyTree;
+    PolygonBooleanBackend::getInstance().unionTree(paths, unionAll ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd, resultPolyTree);
+
+    enclosing_parts.clear();
+    splitIntoParts_processPolyTreeNode(&resultPolyTree, ret, &enclosing_parts);
     return ret;
 }
 
-void Polygons::splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, std::vector<PolygonsPart>& ret) const
+void Polygons::splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, std::vector<PolygonsPart>& ret, std::vector<unsigned int>* enclosing_parts) const
 {
     for(int n=0; n<node->ChildCount(); n++)
     {
         ClipperLib::PolyNode* child = node->Childs[n];
         PolygonsPart part;
         part.add(child->Contour);
+        const size_t first_nested_part = ret.size();
         for(int i=0; i<child->ChildCount(); i++)
         {
             part.add(child->Childs[i]->Contour);
-            splitIntoParts_processPolyTreeNode(child->Childs[i], ret);
+            splitIntoParts_processPolyTreeNode(child->Childs[i], ret, enclosing_parts);
+        }
+        if (enclosing_parts)
+        {
+            //The parts in the holes of this part come before it. Those nested even deeper already know their enclosing part.
+            const unsigned int part_idx = ret.size();
+            for (size_t nested_part_idx = first_nested_part; nested_part_idx < part_idx; nested_part_idx++)
+            {
+                if ((*enclosing_parts)[nested_part_idx] == NO_INDEX)
+                {
+                    (*enclosing_parts)[nested_part_idx] = part_idx;
+                }
+            }
+            enclosing_parts->push_back(NO_INDEX);
         }
         ret.push_back(part);
     }
@@ -1174,13 +1332,8 @@ PartsView Polygons::splitIntoPartsView(bool unionAll)
 {
     Polygons reordered;
     PartsView partsView(*this);
-    ClipperLib::Clipper clipper(clipper_init);
     ClipperLib::PolyTree resultPolyTree;
-    clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-    if (unionAll)
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
-    else
-        clipper.Execute(ClipperLib::ctUnion, resultPolyTree);
+    PolygonBooleanBackend::getInstance().unionTree(paths, unionAll ? ClipperLib::pftNonZero : ClipperLib::pftEvenOdd, resultPolyTree);
 
     splitIntoPartsView_processPolyTreeNode(partsView, reordered, &resultPolyTree);
 
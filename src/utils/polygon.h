@@ -17,6 +17,7 @@
 #include <initializer_list>
 
 #include "IntPoint.h"
+#include "PolygonBooleanBackend.h"
 #include "../settings/types/AngleDegrees.h" //For angles between vertices.
 
 #define CHECK_POLY_ACCESS
@@ -35,8 +36,7 @@ class Polygon;
 class PolygonRef;
 
 class ListPolyIt;
-
-typedef std::list<Point> ListPolygon; //!< A polygon represented by a linked list instead of a vector
+class ListPolygon; //!< A polygon represented by a linked list instead of a vector, see utils/ListPolygon.h
 typedef std::vector<ListPolygon> ListPolygons; //!< Polygons represented by a vector of linked lists instead of a vector of vectors
 
 const static int clipper_init = (0);
@@ -608,6 +608,8 @@ public:
 
     unsigned int pointCount() const; //!< Return the amount of points in all polygons
 
+    size_t getMemorySize() const; //!< Return the approximate number of bytes that the polygons take up in memory
+
     PolygonRef operator[] (unsigned int index)
     {
         POLY_ASSERT(index < size() && index <= std::numeric_limits<int>::max());
@@ -675,6 +677,21 @@ public:
     {
         std::copy(other.paths.begin(), other.paths.end(), std::back_inserter(paths));
     }
+    /*!
+     * Add polygons that are no longer needed elsewhere, such as the result of
+     * a Clipper operation, by moving their points instead of copying them.
+     */
+    void add(Polygons&& other)
+    {
+        if (paths.empty())
+        {
+            paths = std::move(other.paths);
+            return;
+        }
+        paths.reserve(paths.size() + other.paths.size());
+        std::move(other.paths.begin(), other.paths.end(), std::back_inserter(paths));
+        other.paths.clear();
+    }
     /*!
      * Add a 'polygon' consisting of two points
      */
@@ -706,7 +723,9 @@ public:
     Polygons() {}
 
     Polygons(const Polygons& other) { paths = other.paths; }
+    Polygons(Polygons&& other) noexcept : paths(std::move(other.paths)) {} //!< move constructor, so that intermediate results are handed over instead of copied
     Polygons& operator=(const Polygons& other) { paths = other.paths; return *this; }
+    Polygons& operator=(Polygons&& other) noexcept { paths = std::move(other.paths); return *this; } //!< move assignment
 
     bool operator==(const Polygons& other) const =delete;
 
@@ -716,24 +735,41 @@ public:
      */
     static Polygons toPolygons(ClipperLib::PolyTree& poly_tree);
 
+    /*!
+     * Subtract \p other from these polygons.
+     *
+     * Polygons of \p other whose bounding box doesn't overlap with the
+     * bounding box of these polygons can't affect the result, so they are not
+     * given to Clipper.
+     */
     Polygons difference(const Polygons& other) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctDifference, ret.paths);
+        difference(other, ret.paths);
         return ret;
     }
+    /*!
+     * Subtract \p other from these polygons, replacing these polygons with the
+     * result instead of making a new copy.
+     */
+    void differenceInPlace(const Polygons& other)
+    {
+        difference(other, paths);
+    }
     Polygons unionPolygons(const Polygons& other) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptSubject, true);
-        clipper.Execute(ClipperLib::ctUnion, ret.paths, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        unionPolygons(other, ret.paths);
         return ret;
     }
+    /*!
+     * Union these polygons with \p other, replacing these polygons with the
+     * result instead of making a new copy.
+     */
+    void unionInPlace(const Polygons& other)
+    {
+        unionPolygons(other, paths);
+    }
     /*!
      * Union all polygons with each other (When polygons.add(polygon) has been called for overlapping polygons)
      */
@@ -741,15 +777,35 @@ public:
     {
         return unionPolygons(Polygons());
     }
+    /*!
+     * Union all polygons with each other, replacing these polygons with the
+     * result instead of making a new copy.
+     */
+    void unionInPlace()
+    {
+        unionPolygons(Polygons(), paths);
+    }
+    /*!
+     * Intersect these polygons with \p other.
+     *
+     * If the bounding boxes of both don't overlap, the result is empty without
+     * calling Clipper. Otherwise only the polygons of each whose bounding box
+     * overlaps with the bounding box of the other are given to Clipper.
+     */
     Polygons intersection(const Polygons& other) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctIntersection, ret.paths);
+        intersection(other, ret.paths);
         return ret;
     }
+    /*!
+     * Intersect these polygons with \p other, replacing these polygons with
+     * the result instead of making a new copy.
+     */
+    void intersectionInPlace(const Polygons& other)
+    {
+        intersection(other, paths);
+    }
 
     /*!
      * Intersect polylines with this area Polygons object.
@@ -764,32 +820,82 @@ public:
     ClipperLib::PolyTree lineSegmentIntersection(const Polygons& other) const
     {
         ClipperLib::PolyTree ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptClip, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptSubject, false);
-        clipper.Execute(ClipperLib::ctIntersection, ret);
+        PolygonBooleanBackend::getInstance().intersectionPolyLines(other.paths, paths, ret);
         return ret;
     }
     Polygons xorPolygons(const Polygons& other) const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.AddPaths(other.paths, ClipperLib::ptClip, true);
-        clipper.Execute(ClipperLib::ctXor, ret.paths);
+        PolygonBooleanBackend::getInstance().xorPolygons(paths, other.paths, ret.paths);
         return ret;
     }
 
-    Polygons offset(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2) const;
+    Polygons offset(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2) const
+    {
+        if (distance == 0)
+        {
+            return *this;
+        }
+        Polygons ret;
+        offset(distance, joinType, miter_limit, ret.paths);
+        return ret;
+    }
+
+    /*!
+     * Offset these polygons, replacing them with the result instead of making
+     * a new copy.
+     */
+    void offsetInPlace(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miter_limit = 1.2)
+    {
+        if (distance != 0)
+        {
+            offset(distance, joinType, miter_limit, paths);
+        }
+    }
+
+    /*!
+     * Offset these polygons by a series of distances at a fixed spacing, such
+     * as for concentric insets.
+     *
+     * Like calling \ref Polygons::offset on each result again, each result is
+     * offset from the previous one. Only these polygons are unioned first,
+     * since the result of an offset is a union already. Producing the next
+     * result stops at the first empty one.
+     *
+     * \param first_distance The offset of the first result.
+     * \param spacing The difference between the offsets of consecutive results.
+     * \param max_count The maximum number of results, or 0 to stop only at the
+     * first empty result. Must not be 0 if \p spacing is an outward offset or
+     * zero; if it is, only the first result is given.
+     * \param join_type How to join the offset lines at the corners.
+     * \param miter_limit The maximum distance of a mitered corner, as a
+     * multiple of the offset distance.
+     * \return The results up to the first empty one, in order of distance.
+     */
+    std::vector<Polygons> offsetLadder(int first_distance, int spacing, size_t max_count = 0, ClipperLib::JoinType join_type = ClipperLib::jtMiter, double miter_limit = 1.2) const;
+
+    /*!
+     * Offset each of many polygons by the same distance, such as all parts of
+     * a layer.
+     *
+     * The results are the same as calling \ref Polygons::offset on each of
+     * them, but the polygon engine is set up once for all of them, which saves
+     * a lot of the time on layers with many small parts.
+     *
+     * \param polygons The polygons to offset.
+     * \param distance How far to offset. Negative to offset inwards.
+     * \param join_type How to join the offset lines at the corners.
+     * \param miter_limit The maximum distance of a mitered corner, as a
+     * multiple of the offset distance.
+     * \return The offset of each of the polygons, in the same order.
+     */
+    static std::vector<Polygons> offsetEach(const std::vector<const Polygons*>& polygons, int distance, ClipperLib::JoinType join_type = ClipperLib::jtMiter, double miter_limit = 1.2);
 
     Polygons offsetPolyLine(int distance, ClipperLib::JoinType joinType = ClipperLib::jtMiter) const
     {
         Polygons ret;
         double miterLimit = 1.2;
-        ClipperLib::ClipperOffset clipper(miterLimit, 10.0);
-        clipper.AddPaths(paths, joinType, ClipperLib::etOpenSquare);
-        clipper.MiterLimit = miterLimit;
-        clipper.Execute(ret.paths, distance);
+        PolygonBooleanBackend::getInstance().offset(paths, distance, joinType, ClipperLib::etOpenSquare, miterLimit, ret.paths);
         return ret;
     }
     
@@ -842,10 +948,22 @@ public:
      */
     unsigned int findInside(Point p, bool border_result = false);
     
+    /*!
+     * Compute the convex hull of all vertices of the polygons.
+     *
+     * This uses Andrew's monotone chain algorithm, which only sorts the
+     * vertices and doesn't need Clipper.
+     *
+     * \return The convex hull, counter-clockwise and without collinear
+     * vertices. It has fewer than 3 vertices if all vertices lie on one line.
+     */
+    Polygon convexHull() const;
+
     /*!
      * Approximates the convex hull of the polygons.
      * \p extra_outset Extra offset outward
-     * \return the convex hull (approximately)
+     * \return the convex hull, offset with round corners if \p extra_outset
+     * isn't 0
      * 
      */
     Polygons approxConvexHull(int extra_outset = 0);
@@ -927,7 +1045,33 @@ public:
      * Each PolygonsPart in the result has an outline as first polygon, whereas the rest are holes.
      */
     std::vector<PolygonsPart> splitIntoParts(bool unionAll = false) const;
+
+    /*!
+     * Split up the polygons into groups according to the even-odd rule, and
+     * keep how the groups are nested in each other.
+     *
+     * This gives the containment of the parts that the union computes anyway,
+     * so that it doesn't need to be computed again with another union.
+     * \param unionAll Whether to union all polygons with the non-zero rule
+     * instead of the even-odd rule.
+     * \param[out] enclosing_parts For each part in the result, the index of
+     * the part in whose hole it lies, or NO_INDEX if it doesn't lie in any
+     * hole.
+     */
+    std::vector<PolygonsPart> splitIntoParts(bool unionAll, std::vector<unsigned int>& enclosing_parts) const;
 private:
+    /*!
+     * The Clipper operations behind the functions of the same name, which
+     * write their result to \p result.
+     *
+     * \p result may be #paths itself, since Clipper copies all of its input
+     * before it writes the result.
+     */
+    void difference(const Polygons& other, ClipperLib::Paths& result) const;
+    void unionPolygons(const Polygons& other, ClipperLib::Paths& result) const;
+    void intersection(const Polygons& other, ClipperLib::Paths& result) const;
+    void offset(int distance, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::Paths& result) const;
+
     /*!
      * recursive part of \ref Polygons::removeEmptyHoles and \ref Polygons::getEmptyHoles
      * \param node The node of the polygons part to process
@@ -935,7 +1079,7 @@ private:
      * \param ret Where to store polygons which are not empty holes
      */
     void removeEmptyHoles_processPolyTreeNode(const ClipperLib::PolyNode& node, const bool remove_holes, Polygons& ret) const;
-    void splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, std::vector<PolygonsPart>& ret) const;
+    void splitIntoParts_processPolyTreeNode(ClipperLib::PolyNode* node, std::vector<PolygonsPart>& ret, std::vector<unsigned int>* enclosing_parts) const;
 
     /*!
      * Convert a node from a ClipperLib::PolyTree and add it to a Polygons object,
@@ -1080,9 +1224,7 @@ public:
     Polygons processEvenOdd() const
     {
         Polygons ret;
-        ClipperLib::Clipper clipper(clipper_init);
-        clipper.AddPaths(paths, ClipperLib::ptSubject, true);
-        clipper.Execute(ClipperLib::ctUnion, ret.paths);
+        PolygonBooleanBackend::getInstance().unionPolygons(paths, ClipperLib::Paths(), ClipperLib::pftEvenOdd, ret.paths);
         return ret;
     }
 
@@ -1142,6 +1284,22 @@ public:
             }
         }
     }
+
+    /*!
+     * Translate all polygons in some direction.
+     *
+     * \param translation The direction in which to move the polygons
+     */
+    void translate(const Point translation)
+    {
+        for (ClipperLib::Path& path : paths)
+        {
+            for (Point& point : path)
+            {
+                point += translation;
+            }
+        }
+    }
 };
 
 /*!
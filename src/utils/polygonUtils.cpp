@@ -5,13 +5,13 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "AABB.h"
 #include "linearAlg2D.h"
 #include "polygonUtils.h"
 #include "SparsePointGridInclusive.h"
 #include "../utils/logoutput.h"
 
 #ifdef DEBUG
-#include "AABB.h"
 #include "SVG.h"
 #endif
 
@@ -832,7 +832,35 @@ ClosestPolygonPoint PolygonUtils::findClosest(Point from, const Polygons& polygo
     ClosestPolygonPoint best((*any_polygon)[0], 0, *any_polygon, any_poly_idx);
 
     int64_t closestDist2_score = vSize2(from - best.location) + penalty_function(best.location);
-    
+
+    if (&penalty_function == &no_penalty_function)
+    {
+        for (unsigned int ply = 0; ply < polygons.size(); ply++)
+        {
+            ConstPolygonRef poly = polygons[ply];
+            if (poly.size() == 0)
+            {
+                continue;
+            }
+            //Like findClosest on each polygon, the first point of the polygon is the closest until a segment is closer.
+            Point closest_here = poly[0];
+            int64_t dist2_here = vSize2(from - closest_here);
+            unsigned int pos_here = 0;
+            const bool first_point_is_closer = dist2_here < closestDist2_score;
+            if (!first_point_is_closer)
+            {
+                dist2_here = closestDist2_score; //Only look for points that are closer than the best of the earlier polygons.
+            }
+            if (!findCloserOnSegments(from, poly, closest_here, dist2_here, pos_here) && !first_point_is_closer)
+            {
+                continue;
+            }
+            best = ClosestPolygonPoint(closest_here, pos_here, poly, ply);
+            closestDist2_score = dist2_here;
+        }
+        return best;
+    }
+
     for (unsigned int ply = 0; ply < polygons.size(); ply++)
     {
         ConstPolygonRef poly = polygons[ply];
@@ -863,6 +891,14 @@ ClosestPolygonPoint PolygonUtils::findClosest(Point from, ConstPolygonRef polygo
     Point aPoint = polygon[0];
     Point best = aPoint;
 
+    if (&penalty_function == &no_penalty_function)
+    {
+        int64_t best_dist2 = vSize2(from - best);
+        unsigned int best_pos = 0;
+        findCloserOnSegments(from, polygon, best, best_dist2, best_pos);
+        return ClosestPolygonPoint(best, best_pos, polygon);
+    }
+
     int64_t closestDist2_score = vSize2(from - best) + penalty_function(best);
     int bestPos = 0;
 
@@ -887,6 +923,33 @@ ClosestPolygonPoint PolygonUtils::findClosest(Point from, ConstPolygonRef polygo
     return ClosestPolygonPoint(best, bestPos, polygon);
 }
 
+bool PolygonUtils::findCloserOnSegments(const Point from, ConstPolygonRef polygon, Point& best, int64_t& best_dist2, unsigned int& best_pos)
+{
+    bool found = false;
+    for (unsigned int p = 0; p < polygon.size(); p++)
+    {
+        const Point& p1 = polygon[p];
+        const Point& p2 = polygon[(p + 1 < polygon.size()) ? p + 1 : 0];
+        //The squared distance to the bounding box of the segment is a lower bound for the squared distance to the segment.
+        const coord_t dx = std::max(std::max(std::min(p1.X, p2.X) - from.X, from.X - std::max(p1.X, p2.X)), coord_t(0));
+        const coord_t dy = std::max(std::max(std::min(p1.Y, p2.Y) - from.Y, from.Y - std::max(p1.Y, p2.Y)), coord_t(0));
+        if (dx * dx + dy * dy >= best_dist2)
+        {
+            continue;
+        }
+        const Point closest_here = LinearAlg2D::getClosestOnLineSegment(from, p1, p2);
+        const int64_t dist2 = vSize2(from - closest_here);
+        if (dist2 < best_dist2)
+        {
+            best = closest_here;
+            best_dist2 = dist2;
+            best_pos = p;
+            found = true;
+        }
+    }
+    return found;
+}
+
 PolygonsPointIndex PolygonUtils::findNearestVert(const Point from, const Polygons& polys)
 {
     int64_t best_dist2 = std::numeric_limits<int64_t>::max();
@@ -926,24 +989,17 @@ unsigned int PolygonUtils::findNearestVert(const Point from, ConstPolygonRef pol
 
 LocToLineGrid* PolygonUtils::createLocToLineGrid(const Polygons& polygons, int square_size)
 {
-    unsigned int n_points = 0;
-    for (const auto& poly : polygons)
-    {
-        n_points += poly.size();
-    }
-
-    LocToLineGrid* ret = new LocToLineGrid(square_size, n_points);
-
+    std::vector<PolygonsPointIndex> segments;
+    segments.reserve(polygons.pointCount());
     for (unsigned int poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
     {
         ConstPolygonRef poly = polygons[poly_idx];
         for (unsigned int point_idx = 0; point_idx < poly.size(); point_idx++)
         {
-            ret->insert(PolygonsPointIndex(&polygons, poly_idx, point_idx));
+            segments.emplace_back(&polygons, poly_idx, point_idx);
         }
-
     }
-    return ret;
+    return new LocToLineGrid(square_size, segments);
 }
 
 /*
@@ -1279,14 +1335,26 @@ bool PolygonUtils::polygonOutlinesAdjacent(const ConstPolygonRef inner_poly, con
     }
 
     //Heuristic says they are near. Now check for real.
+    //A point can only be near a line segment if it is inside the segment's AABB expanded by the gap, which rules out most pairs cheaply.
+    const AABB inner_aabb_exact(inner_poly);
     const coord_t max_gap2 = max_gap * max_gap;
     const unsigned outer_poly_size = outer_poly.size();
     for (unsigned line_index = 0; line_index < outer_poly_size; ++line_index)
     {
         const Point lp0 = outer_poly[line_index];
         const Point lp1 = outer_poly[(line_index + 1) % outer_poly_size];
+        const Point line_min(std::min(lp0.X, lp1.X) - max_gap, std::min(lp0.Y, lp1.Y) - max_gap);
+        const Point line_max(std::max(lp0.X, lp1.X) + max_gap, std::max(lp0.Y, lp1.Y) + max_gap);
+        if (line_max.X < inner_aabb_exact.min.X || line_min.X > inner_aabb_exact.max.X || line_max.Y < inner_aabb_exact.min.Y || line_min.Y > inner_aabb_exact.max.Y)
+        {
+            continue;
+        }
         for (Point inner_poly_point : inner_poly)
         {
+            if (inner_poly_point.X < line_min.X || inner_poly_point.X > line_max.X || inner_poly_point.Y < line_min.Y || inner_poly_point.Y > line_max.Y)
+            {
+                continue;
+            }
             if (LinearAlg2D::getDist2FromLineSegment(lp0, inner_poly_point, lp1) < max_gap2)
             {
                 return true;
@@ -1347,4 +1415,32 @@ double PolygonUtils::relativeHammingDistance(const Polygons& poly_a, const Polyg
     return hamming_distance / total_area;
 }
 
+void PolygonUtils::generateInsetsOfEach(const std::vector<const Polygons*>& areas, const coord_t first_distance, const coord_t spacing, const size_t inset_count, const std::vector<std::vector<Polygons>*>& insets)
+{
+    assert(areas.size() == insets.size());
+    std::vector<const Polygons*> offset_from = areas;
+    std::vector<std::vector<Polygons>*> unfinished_insets = insets; //The insets of the areas that may get another inset, in the same order as offset_from.
+    for (size_t inset_idx = 0; inset_idx < inset_count && !offset_from.empty(); inset_idx++)
+    {
+        std::vector<Polygons> new_insets = Polygons::offsetEach(offset_from, inset_idx == 0 ? first_distance : spacing);
+        size_t unfinished_count = 0;
+        for (size_t area_idx = 0; area_idx < new_insets.size(); area_idx++)
+        {
+            Polygons& inset = new_insets[area_idx];
+            inset.simplify();
+            if (inset.empty())
+            {
+                continue; //This area is finished.
+            }
+            std::vector<Polygons>& area_insets = *unfinished_insets[area_idx];
+            area_insets.push_back(std::move(inset));
+            offset_from[unfinished_count] = &area_insets.back();
+            unfinished_insets[unfinished_count] = &area_insets;
+            unfinished_count++;
+        }
+        offset_from.resize(unfinished_count);
+        unfinished_insets.resize(unfinished_count);
+    }
+}
+
 }//namespace cura
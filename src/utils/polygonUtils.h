@@ -9,7 +9,7 @@
 
 #include "polygon.h"
 #include "SparsePointGridInclusive.h"
-#include "SparseLineGrid.h"
+#include "StaticLineGrid.h"
 #include "optional.h"
 #include "PolygonsPointIndex.h"
 
@@ -100,7 +100,7 @@ struct PolygonsPointIndexSegmentLocator
     }
 };
 
-typedef SparseLineGrid<PolygonsPointIndex, PolygonsPointIndexSegmentLocator> LocToLineGrid;
+typedef StaticLineGrid<PolygonsPointIndex, PolygonsPointIndexSegmentLocator> LocToLineGrid;
 
 class PolygonUtils 
 {
@@ -615,6 +615,24 @@ public:
      */
     static double relativeHammingDistance(const Polygons& poly_a, const Polygons& poly_b);
 
+    /*!
+     * Generate the concentric insets of many areas, such as the walls of all
+     * skin parts of a layer.
+     *
+     * The first inset of each area is offset from the area, and every next
+     * inset from the previous one. Each inset is simplified before the next
+     * one is made from it. The insets of an area stop at the first one that is
+     * empty, which is left out. The offsets of all areas at the same depth are
+     * made together, see \ref Polygons::offsetEach.
+     * \param areas The areas to make insets of.
+     * \param first_distance The offset of the first inset from the area.
+     * \param spacing The offset of every next inset from the previous one.
+     * \param inset_count The maximum number of insets of each area.
+     * \param[out] insets Where to add the insets of each area, in the same
+     * order as the areas.
+     */
+    static void generateInsetsOfEach(const std::vector<const Polygons*>& areas, const coord_t first_distance, const coord_t spacing, const size_t inset_count, const std::vector<std::vector<Polygons>*>& insets);
+
 private:
     /*!
      * Helper function for PolygonUtils::moveInside2: moves a point \p from which was moved onto \p closest_polygon_point towards inside/outside when it's not already inside/outside by enough distance.
@@ -626,7 +644,24 @@ private:
      * \return The point on the polygon closest to \p from
      */
     static ClosestPolygonPoint _moveInside2(const ClosestPolygonPoint& closest_polygon_point, const int distance, Point& from, const int64_t max_dist2);
-    
+
+    /*!
+     * Helper function for PolygonUtils::findClosest without a penalty: find
+     * the point closest to \p from on the segments of \p polygon, if it is
+     * closer than \p best_dist2.
+     *
+     * Computing the closest point on a segment needs square roots, so this is
+     * skipped for segments whose bounding box is already too far away. The
+     * closest point on a segment always lies within its bounding box.
+     *
+     * \param from The point from which to get the smallest distance.
+     * \param polygon The polygon of which to check the segments.
+     * \param[in,out] best The closest point found so far.
+     * \param[in,out] best_dist2 The squared distance from \p from to \p best.
+     * \param[in,out] best_pos The index of the segment that \p best is on.
+     * \return Whether a closer point was found on \p polygon.
+     */
+    static bool findCloserOnSegments(const Point from, ConstPolygonRef polygon, Point& best, int64_t& best_dist2, unsigned int& best_pos);
 };
 
 
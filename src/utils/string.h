@@ -1,215 +1,290 @@
-//Copyright (c) 2017 Ultimaker B.V.
-//CuraEngine is released under the terms of the AGPLv3 or higher.
-
-#ifndef UTILS_STRING_H
-#define UTILS_STRING_H
-
-#include <ctype.h>
-#include <cstdio> // sprintf
-#include <sstream> // ostringstream
-
-#include "logoutput.h"
-
-namespace cura
-{
-    
-//c++11 no longer supplies a strcasecmp, so define our own version.
-static inline int stringcasecompare(const char* a, const char* b)
-{
-    while(*a && *b)
-    {
-        if (tolower(*a) != tolower(*b))
-            return tolower(*a) - tolower(*b);
-        a++;
-        b++;
-    }
-    return *a - *b;
-}
-
-/*!
- * Efficient conversion of micron integer type to millimeter string.
- * 
- * The integer type is half the size of the normal integer type because of implementation details.
- * However, half the integer type should suffice, because we made the basic coord_t twice as big as necessary
- * so as to support multiplication within the same integer type.
- * 
- * \param coord The micron unit to convert
- * \param ss The output stream to write the string to
- */
-static inline void writeInt2mm(const int32_t coord, std::ostream& ss)
-{
-    constexpr size_t buffer_size = 24;
-    char buffer[buffer_size];
-    int char_count = sprintf(buffer, "%d", coord); // we haven't found any way for the windows compiler to accept formatting of a coord_t, so it has to be int32_t instead
-#ifdef DEBUG
-    if (char_count + 1 >= int(buffer_size)) // + 1 for the null character
-    {
-        logError("Cannot write %ld to buffer of size %i", coord, buffer_size);
-    }
-    if (char_count < 0)
-    {
-        logError("Encoding error while writing %ld", coord);
-    }
-#endif // DEBUG
-    int end_pos = char_count; // the first character not to write any more
-    int trailing_zeros = 1;
-    while (trailing_zeros < 4 && buffer[char_count - trailing_zeros] == '0')
-    {
-        trailing_zeros++;
-    }
-    trailing_zeros--;
-    end_pos = char_count - trailing_zeros;
-    if (trailing_zeros == 3)
-    { // no need to write the decimal dot
-        buffer[char_count - trailing_zeros] = '\0';
-        ss << buffer;
-        return;
-    }
-    if (char_count <= 3)
-    {
-        int start = 0; // where to start writing from the buffer
-        if (coord < 0)
-        {
-            ss << '-';
-            start = 1;
-        }
-        ss << "0.";
-        for (int nulls = char_count - start; nulls < 3; nulls++)
-        { // fill up to 3 decimals with zeros
-            ss << '0';
-        }
-        buffer[char_count - trailing_zeros] = '\0';
-        ss << (static_cast<char*>(buffer) + start);
-    }
-    else
-    {
-        char prev = '.';
-        int pos;
-        for (pos = char_count - 3; pos <= end_pos; pos++)
-        { // shift all characters and insert the decimal dot
-            char next_prev = buffer[pos];
-            buffer[pos] = prev;
-            prev = next_prev;
-        }
-        buffer[pos] = '\0';
-        ss << buffer;
-    }
-}
-
-/*!
- * Struct to make it possible to inline calls to writeInt2mm with writing other stuff to the output stream
- */
-struct MMtoStream
-{
-    int64_t value; //!< The coord in micron
-
-    friend inline std::ostream& operator<< (std::ostream& out, const MMtoStream precision_and_input)
-    {
-        writeInt2mm(precision_and_input.value, out);
-        return out;
-    }
-};
-
-/*!
- * Efficient writing of a double to a stringstream
- * 
- * writes with \p precision digits after the decimal dot, but removes trailing zeros
- * 
- * \warning only works with precision up to 9 and input up to 10^14
- * 
- * \param precision The number of (non-zero) digits after the decimal dot
- * \param coord double to output
- * \param ss The output stream to write the string to
- */
-static inline void writeDoubleToStream(const unsigned int precision, const double coord, std::ostream& ss)
-{
-    char format[5] = "%.xF"; // write a float with [x] digits after the dot
-    format[2] = '0' + precision; // set [x]
-    constexpr size_t buffer_size = 400;
-    char buffer[buffer_size];
-    int char_count = sprintf(buffer, format, coord);
-#ifdef DEBUG
-    if (char_count + 1 >= int(buffer_size)) // + 1 for the null character
-    {
-        logError("Cannot write %f to buffer of size %i", coord, buffer_size);
-    }
-    if (char_count < 0)
-    {
-        logError("Encoding error while writing %f", coord);
-    }
-#endif // DEBUG
-    if (char_count <= 0)
-    {
-        return;
-    }
-    if (buffer[char_count - precision - 1] == '.')
-    {
-        int non_nul_pos = char_count - 1;
-        while (buffer[non_nul_pos] == '0')
-        {
-            non_nul_pos--;
-        }
-        if (buffer[non_nul_pos] == '.')
-        {
-            buffer[non_nul_pos] = '\0';
-        }
-        else
-        {
-            buffer[non_nul_pos + 1] = '\0';
-        }
-    }
-    ss << buffer;
-}
-
-/*!
- * Struct to make it possible to inline calls to writeDoubleToStream with writing other stuff to the output stream
- */
-struct PrecisionedDouble
-{
-    unsigned int precision; //!< Number of digits after the decimal mark with which to convert to string
-    double value; //!< The double value
-
-    friend inline std::ostream& operator<< (std::ostream& out, const PrecisionedDouble precision_and_input)
-    {
-        writeDoubleToStream(precision_and_input.precision, precision_and_input.value, out);
-        return out;
-    }
-};
-
-/*!
- * Struct for writing a string to a stream in an escaped form
- */
-struct Escaped
-{
-    const char* str;
-    
-    /*!
-     * Streaming function which replaces escape sequences with extra slashes
-     */
-    friend inline std::ostream& operator<<(std::ostream& os, const Escaped& e)
-    {
-        for (const char* char_p = e.str; *char_p != '\0'; char_p++)
-        {
-            switch (*char_p)
-            {
-                case '\a':  os << "\\a"; break;
-                case '\b':  os << "\\b"; break;
-                case '\f':  os << "\\f"; break;
-                case '\n':  os << "\\n"; break;
-                case '\r':  os << "\\r"; break;
-                case '\t':  os << "\\t"; break;
-                case '\v':  os << "\\v"; break;
-                case '\\':  os << "\\\\"; break;
-                case '\'':  os << "\\'"; break;
-                case '\"':  os << "\\\""; break;
-                case '\?':  os << "\\\?"; break;
-                default: os << *char_p;
-            }
-        }
-        return os;
-    }
-};
-
-}//namespace cura
-
-#endif//UTILS_STRING_H
+//Copyright (c) 2017 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifndef UTILS_STRING_H
+#define UTILS_STRING_H
+
+#include <ctype.h>
+#include <cmath> // floor, signbit
+#include <cstdio> // snprintf
+#include <cstring> // memcpy
+#include <sstream> // ostringstream
+
+#include "logoutput.h"
+
+namespace cura
+{
+    
+//c++11 no longer supplies a strcasecmp, so define our own version.
+static inline int stringcasecompare(const char* a, const char* b)
+{
+    while(*a && *b)
+    {
+        if (tolower(*a) != tolower(*b))
+            return tolower(*a) - tolower(*b);
+        a++;
+        b++;
+    }
+    return *a - *b;
+}
+
+/*!
+ * Efficient conversion of micron integer type to millimeter string.
+ * 
+ * The integer type is half the size of the normal integer type because of implementation details.
+ * However, half the integer type should suffice, because we made the basic coord_t twice as big as necessary
+ * so as to support multiplication within the same integer type.
+ * 
+ * The digits are computed directly from the integer, rather than printing the integer and moving the decimal dot into it afterwards,
+ * since this is done for every coordinate in the g-code.
+ * 
+ * \param coord The micron unit to convert
+ * \param buffer The buffer to write the characters to. It needs room for at least 24 characters. No terminating null character is written.
+ * \return The number of characters written
+ */
+static inline size_t writeInt2mm(const int32_t coord, char* buffer)
+{
+    if (coord == 0)
+    { // this is how zero has always been written, so keep it that way for the sake of comparing g-code
+        std::memcpy(buffer, "0.00", 4);
+        return 4;
+    }
+    const uint32_t magnitude = (coord < 0) ? 0u - static_cast<uint32_t>(coord) : static_cast<uint32_t>(coord);
+    uint32_t decimals = magnitude % 1000;
+    uint32_t integer_part = magnitude / 1000;
+
+    char reversed[24]; // the characters after the minus sign, from back to front
+    size_t reversed_count = 0;
+    if (decimals != 0)
+    {
+        int decimal_count = 3;
+        while (decimals % 10 == 0)
+        { // leave out the trailing zeros
+            decimals /= 10;
+            decimal_count--;
+        }
+        for (; decimal_count > 0; decimal_count--)
+        {
+            reversed[reversed_count++] = '0' + decimals % 10;
+            decimals /= 10;
+        }
+        reversed[reversed_count++] = '.';
+    }
+    if (integer_part != 0 || coord > -100) // values from -0.999 to -0.1 have always been written without the leading zero
+    {
+        do
+        {
+            reversed[reversed_count++] = '0' + integer_part % 10;
+            integer_part /= 10;
+        }
+        while (integer_part != 0);
+    }
+
+    size_t char_count = 0;
+    if (coord < 0)
+    {
+        buffer[char_count++] = '-';
+    }
+    while (reversed_count > 0)
+    {
+        buffer[char_count++] = reversed[--reversed_count];
+    }
+    return char_count;
+}
+
+/*!
+ * Efficient conversion of micron integer type to millimeter string.
+ * 
+ * \param coord The micron unit to convert
+ * \param ss The output stream to write the string to
+ */
+static inline void writeInt2mm(const int32_t coord, std::ostream& ss)
+{
+    char buffer[24];
+    ss.write(buffer, writeInt2mm(coord, buffer));
+}
+
+/*!
+ * Struct to make it possible to inline calls to writeInt2mm with writing other stuff to the output stream
+ */
+struct MMtoStream
+{
+    int64_t value; //!< The coord in micron
+
+    friend inline std::ostream& operator<< (std::ostream& out, const MMtoStream precision_and_input)
+    {
+        writeInt2mm(precision_and_input.value, out);
+        return out;
+    }
+};
+
+/*!
+ * Efficient writing of a double to a character buffer
+ * 
+ * writes with \p precision digits after the decimal dot, but removes trailing zeros
+ * 
+ * The value is rounded to an integer number of units of the last digit, which is then written digit by digit.
+ * Only when the value is too large for that, or when it lies so close to halfway between two roundings that the choice
+ * depends on the exact binary value, printf is used so that the outcome is the same as printf would give.
+ * 
+ * \warning only works with precision up to 9 and input up to 10^14
+ * 
+ * \param precision The number of (non-zero) digits after the decimal dot
+ * \param coord double to output
+ * \param buffer The buffer to write the characters to. It needs room for at least 400 characters. No terminating null character is written.
+ * \return The number of characters written
+ */
+static inline size_t writeDoubleToBuffer(const unsigned int precision, const double coord, char* buffer)
+{
+    constexpr double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    constexpr double max_scaled = 1099511627776.0; // 2^40, below which the scaled value is within 2^-13 of the exact product
+    if (precision < sizeof(powers_of_ten) / sizeof(powers_of_ten[0]))
+    {
+        const double scaled = std::abs(coord) * powers_of_ten[precision];
+        if (scaled < max_scaled) // also false for NaN
+        {
+            const double floored = std::floor(scaled);
+            const double fraction = scaled - floored;
+            if (std::abs(fraction - 0.5) > 0.001)
+            {
+                uint64_t units = static_cast<uint64_t>(floored) + ((fraction > 0.5) ? 1 : 0);
+
+                char reversed[24]; // the digits from back to front
+                size_t reversed_count = 0;
+                bool writing_decimals = false; // whether a non-zero decimal has been found, so that the rest of the decimals need to be written
+                for (unsigned int decimal_idx = 0; decimal_idx < precision; decimal_idx++)
+                {
+                    const char digit = '0' + units % 10;
+                    units /= 10;
+                    if (digit != '0' || writing_decimals)
+                    {
+                        reversed[reversed_count++] = digit;
+                        writing_decimals = true;
+                    }
+                }
+                if (writing_decimals)
+                {
+                    reversed[reversed_count++] = '.';
+                }
+                do
+                {
+                    reversed[reversed_count++] = '0' + units % 10;
+                    units /= 10;
+                }
+                while (units != 0);
+
+                size_t char_count = 0;
+                if (std::signbit(coord))
+                { // printf writes the sign even if the value rounds to zero
+                    buffer[char_count++] = '-';
+                }
+                while (reversed_count > 0)
+                {
+                    buffer[char_count++] = reversed[--reversed_count];
+                }
+                return char_count;
+            }
+        }
+    }
+
+    char format[5] = "%.xF"; // write a float with [x] digits after the dot
+    format[2] = '0' + precision; // set [x]
+    constexpr size_t buffer_size = 400;
+    int char_count = snprintf(buffer, buffer_size, format, coord);
+#ifdef DEBUG
+    if (char_count + 1 >= int(buffer_size)) // + 1 for the null character
+    {
+        logError("Cannot write %f to buffer of size %i", coord, buffer_size);
+    }
+    if (char_count < 0)
+    {
+        logError("Encoding error while writing %f", coord);
+    }
+#endif // DEBUG
+    if (char_count <= 0)
+    {
+        return 0;
+    }
+    if (static_cast<unsigned int>(char_count) > precision && buffer[char_count - precision - 1] == '.')
+    {
+        while (buffer[char_count - 1] == '0')
+        {
+            char_count--;
+        }
+        if (buffer[char_count - 1] == '.')
+        {
+            char_count--;
+        }
+    }
+    return char_count;
+}
+
+/*!
+ * Efficient writing of a double to a stringstream
+ * 
+ * writes with \p precision digits after the decimal dot, but removes trailing zeros
+ * 
+ * \warning only works with precision up to 9 and input up to 10^14
+ * 
+ * \param precision The number of (non-zero) digits after the decimal dot
+ * \param coord double to output
+ * \param ss The output stream to write the string to
+ */
+static inline void writeDoubleToStream(const unsigned int precision, const double coord, std::ostream& ss)
+{
+    char buffer[400];
+    ss.write(buffer, writeDoubleToBuffer(precision, coord, buffer));
+}
+
+/*!
+ * Struct to make it possible to inline calls to writeDoubleToStream with writing other stuff to the output stream
+ */
+struct PrecisionedDouble
+{
+    unsigned int precision; //!< Number of digits after the decimal mark with which to convert to string
+    double value; //!< The double value
+
+    friend inline std::ostream& operator<< (std::ostream& out, const PrecisionedDouble precision_and_input)
+    {
+        writeDoubleToStream(precision_and_input.precision, precision_and_input.value, out);
+        return out;
+    }
+};
+
+/*!
+ * Struct for writing a string to a stream in an escaped form
+ */
+struct Escaped
+{
+    const char* str;
+    
+    /*!
+     * Streaming function which replaces escape sequences with extra slashes
+     */
+    friend inline std::ostream& operator<<(std::ostream& os, const Escaped& e)
+    {
+        for (const char* char_p = e.str; *char_p != '\0'; char_p++)
+        {
+            switch (*char_p)
+            {
+                case '\a':  os << "\\a"; break;
+                case '\b':  os << "\\b"; break;
+                case '\f':  os << "\\f"; break;
+                case '\n':  os << "\\n"; break;
+                case '\r':  os << "\\r"; break;
+                case '\t':  os << "\\t"; break;
+                case '\v':  os << "\\v"; break;
+                case '\\':  os << "\\\\"; break;
+                case '\'':  os << "\\'"; break;
+                case '\"':  os << "\\\""; break;
+                case '\?':  os << "\\\?"; break;
+                default: os << *char_p;
+            }
+        }
+        return os;
+    }
+};
+
+}//namespace cura
+
+#endif//UTILS_STRING_H
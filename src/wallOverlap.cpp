@@ -5,14 +5,15 @@
 #include <sstream>
 
 #include "utils/AABB.h" // for debug output svg html
+#include "utils/linearAlg2D.h"
 #include "utils/SVG.h"
 
 namespace cura 
 {
 
-WallOverlapComputation::WallOverlapComputation(Polygons& polygons, const coord_t line_width)
-: overlap_linker(polygons, line_width)
-, line_width(line_width)
+WallOverlapComputation::WallOverlapComputation(const PolygonProximityLinker& overlap_linker)
+: overlap_linker(overlap_linker)
+, line_width(overlap_linker.getProximityDistance())
 { 
 
 }
@@ -20,13 +21,11 @@ WallOverlapComputation::WallOverlapComputation(Polygons& polygons, const coord_t
 
 Ratio WallOverlapComputation::getFlow(const Point& from, const Point& to)
 {
-    using Point2LinkIt = PolygonProximityLinker::Point2Link::iterator;
-
     if (!overlap_linker.isLinked(from))
     { // [from] is not linked
         return 1;
     }
-    const std::pair<Point2LinkIt, Point2LinkIt> to_links = overlap_linker.getLinks(to);
+    const PolygonProximityLinker::LinkRange to_links = overlap_linker.getLinks(to);
     if (to_links.first == to_links.second)
     { // [to] is not linked
         return 1;
@@ -34,19 +33,19 @@ Ratio WallOverlapComputation::getFlow(const Point& from, const Point& to)
 
     coord_t overlap_area = 0;
     // note that we don't need to loop over all from_links, because they are handled in the previous getFlow(.) call (or in the very last)
-    for (Point2LinkIt to_link_it = to_links.first; to_link_it != to_links.second; ++to_link_it)
+    for (std::vector<size_t>::const_iterator to_link_it = to_links.first; to_link_it != to_links.second; ++to_link_it)
     {
-        const ProximityPointLink& to_link = to_link_it->second;
-        ListPolyIt to_it = to_link.a;
-        ListPolyIt to_other_it = to_link.b;
-        if (to_link.a.p() != to)
+        const size_t to_link = *to_link_it;
+        size_t to_it = overlap_linker.getLinkA(to_link);
+        size_t to_other_it = overlap_linker.getLinkB(to_link);
+        if (overlap_linker.getPoint(to_it) != to)
         {
-            assert(to_link.b.p() == to && "Either part of the link should be the point in the link!");
+            assert(overlap_linker.getPoint(to_other_it) == to && "Either part of the link should be the point in the link!");
             std::swap(to_it, to_other_it);
         }
-        ListPolyIt from_it = to_it.prev();
+        const size_t from_it = overlap_linker.getPrev(to_it);
 
-        ListPolyIt to_other_next_it = to_other_it.next(); // move towards [from]; the lines on the other side move in the other direction
+        const size_t to_other_next_it = overlap_linker.getNext(to_other_it); // move towards [from]; the lines on the other side move in the other direction
         //           to  from
         //   o<--o<--T<--F
         //   |       :   :
@@ -56,7 +55,7 @@ Ratio WallOverlapComputation::getFlow(const Point& from, const Point& to)
         //           ;   to_other_next
         //           to other
 
-        bool are_in_same_general_direction = dot(from - to, to_other_it.p() - to_other_next_it.p()) > 0;
+        bool are_in_same_general_direction = dot(from - to, overlap_linker.getPoint(to_other_it) - overlap_linker.getPoint(to_other_next_it)) > 0;
         // handle multiple points  linked to [to]
         //   o<<<T<<<F
         //     / |
@@ -75,7 +74,7 @@ Ratio WallOverlapComputation::getFlow(const Point& from, const Point& to)
         //       |  /
         //       | /
         //   o>>>o>>>o
-        bool all_are_in_same_general_direction = are_in_same_general_direction && dot(from - to, to_other_it.prev().p() - to_other_it.p()) > 0;
+        bool all_are_in_same_general_direction = are_in_same_general_direction && dot(from - to, overlap_linker.getPoint(overlap_linker.getPrev(to_other_it)) - overlap_linker.getPoint(to_other_it)) > 0;
         if (!all_are_in_same_general_direction)
         {
             overlap_area = std::max(overlap_area, handlePotentialOverlap(from_it, to_it, to_link, to_other_it, to_other_it));
@@ -102,23 +101,23 @@ Ratio WallOverlapComputation::getFlow(const Point& from, const Point& to)
     return std::min(1.0_r, std::max(0.0_r, ratio));
 }
 
-coord_t WallOverlapComputation::handlePotentialOverlap(const ListPolyIt from_it, const ListPolyIt to_it, const ProximityPointLink& to_link, const ListPolyIt from_other_it, const ListPolyIt to_other_it)
+coord_t WallOverlapComputation::handlePotentialOverlap(const size_t from_it, const size_t to_it, const size_t to_link, const size_t from_other_it, const size_t to_other_it)
 {
     if (from_it == to_other_it && from_it == from_other_it)
     { // don't compute overlap with a line and itself
         return 0;
     }
-    const ProximityPointLink* from_link = overlap_linker.getLink(from_it, from_other_it);
-    if (!from_link)
+    const size_t from_link = overlap_linker.getLink(from_it, from_other_it);
+    if (from_link == PolygonProximityLinker::NO_LINK)
     {
         return 0;
     }
-    if (!getIsPassed(to_link, *from_link))
+    if (!getIsPassed(to_link, from_link))
     { // check whether the segment is already passed
-        setIsPassed(to_link, *from_link);
+        setIsPassed(to_link, from_link);
         return 0;
     }
-    return getApproxOverlapArea(from_it.p(), to_it.p(), to_link.dist, to_other_it.p(), from_other_it.p(), from_link->dist);
+    return getApproxOverlapArea(overlap_linker.getPoint(from_it), overlap_linker.getPoint(to_it), overlap_linker.getLinkDist(to_link), overlap_linker.getPoint(to_other_it), overlap_linker.getPoint(from_other_it), overlap_linker.getLinkDist(from_link));
 }
 
 coord_t WallOverlapComputation::getApproxOverlapArea(const Point from, const Point to, const coord_t to_dist, const Point other_from, const Point other_to, const coord_t from_dist)
@@ -208,12 +207,12 @@ coord_t WallOverlapComputation::getApproxOverlapArea(const Point from, const Poi
     return overlap_length_2 * overlap_width_2 / 4; //Area = width * height.
 }
 
-bool WallOverlapComputation::getIsPassed(const ProximityPointLink& link_a, const ProximityPointLink& link_b)
+bool WallOverlapComputation::getIsPassed(const size_t link_a, const size_t link_b)
 {
-    return passed_links.find(SymmetricPair<ProximityPointLink>(link_a, link_b)) != passed_links.end();
+    return passed_links.find(SymmetricPair<size_t>(link_a, link_b)) != passed_links.end();
 }
 
-void WallOverlapComputation::setIsPassed(const ProximityPointLink& link_a, const ProximityPointLink& link_b)
+void WallOverlapComputation::setIsPassed(const size_t link_a, const size_t link_b)
 {
     passed_links.emplace(link_a, link_b);
 }
@@ -4,18 +4,11 @@
 #ifndef WALL_OVERLAP_H
 #define WALL_OVERLAP_H
 
-#include <functional> // hash function object
-#include <list>
-#include <unordered_map>
 #include <unordered_set>
-#include <vector>
 
 #include "settings/types/Ratio.h" //For flow ratios.
-#include "utils/linearAlg2D.h"
 #include "utils/IntPoint.h"
-#include "utils/polygon.h"
 #include "utils/PolygonProximityLinker.h"
-#include "utils/ProximityPointLink.h"
 #include "utils/SymmetricPair.h"
 
 namespace cura 
@@ -40,17 +33,18 @@ namespace cura
  * to the current line segment being produced when producing gcode.
  * 
  * When producing gcode, the first line crossing the overlap area is laid down normally and the second line is reduced by the overlap amount.
- * For this reason the function WallOverlapComputation::getFlow changes the internal state of the PolygonProximityLinker.
+ * For this reason the function WallOverlapComputation::getFlow keeps track of which overlap areas have been passed.
  * 
- * The main functionality of this class is performed by the constructor, by calling the constructor of PolygonProximityLinker.
+ * The links are computed beforehand by a PolygonProximityLinker, which doesn't change anymore, so that it can be shared.
+ * This class only holds the state of printing the walls once, and should be constructed anew for each time the walls are printed.
  * The adjustment during gcode generation is made with the help of WallOverlapComputation::getFlow
  */
 class WallOverlapComputation
 {
-    PolygonProximityLinker overlap_linker;
+    const PolygonProximityLinker& overlap_linker;
     coord_t line_width;
 
-    std::unordered_set<SymmetricPair<ProximityPointLink>> passed_links;
+    std::unordered_set<SymmetricPair<size_t>> passed_links; //!< The pairs of consecutive links of which the overlap area has been passed once already.
 public:
     /*!
      * Compute the flow for a given line segment in the wall.
@@ -64,10 +58,14 @@ public:
     Ratio getFlow(const Point& from, const Point& to);
 
     /*!
-     * Computes the neccesary priliminaries in order to efficiently compute the flow when generatign gcode paths.
-     * \param polygons The wall polygons for which to compute the overlaps
+     * Start printing walls of which the overlaps have been computed.
+     *
+     * The walls must be printed along the polygons of \p overlap_linker, since
+     * those have the points where the overlaps start and end.
+     * \param overlap_linker The links between the overlapping parts of the
+     * walls. Its proximity distance is the line width of the walls.
      */
-    WallOverlapComputation(Polygons& polygons, const coord_t lineWidth);
+    WallOverlapComputation(const PolygonProximityLinker& overlap_linker);
 
 private:
     /*!
@@ -84,14 +82,14 @@ private:
      *          o-------->o
      *       from         to
      * 
-     * \param from_it The first point possibly invovled in the second link
-     * \param to_it The first point of \p to_link connected to \p from_it
+     * \param from_it The first vertex possibly invovled in the second link
+     * \param to_it The first vertex of \p to_link connected to \p from_it
      * \param to_link The first link involved in the overlap: from \p from_it to \p to_it
-     * \param from_other_it The second point possibly involved in the second link
-     * \param to_other_it The second point of \p to_link connected to \p from_other_it
+     * \param from_other_it The second vertex possibly involved in the second link
+     * \param to_other_it The second vertex of \p to_link connected to \p from_other_it
      * \return The overlap area between the two links, or zero if there was no such link
      */
-    coord_t handlePotentialOverlap(const ListPolyIt from_it, const ListPolyIt to_it, const ProximityPointLink& to_link, const ListPolyIt from_other_it, const ListPolyIt to_other_it);
+    coord_t handlePotentialOverlap(const size_t from_it, const size_t to_it, const size_t to_link, const size_t from_other_it, const size_t to_other_it);
 
     /*!
      * Compute the approximate overlap area between two line segments
@@ -127,7 +125,7 @@ private:
      * \param link_b the other link of the overlap area
      * \return whether the link has already been passed once
      */
-    bool getIsPassed(const ProximityPointLink& link_a, const ProximityPointLink& link_b);
+    bool getIsPassed(const size_t link_a, const size_t link_b);
 
     /*!
      * Mark an overlap area between two consecutive links as being passed once already.
@@ -137,7 +135,7 @@ private:
      * \param link_a the one link of the overlap area
      * \param link_b the other link of the overlap area
      */
-    void setIsPassed(const ProximityPointLink& link_a, const ProximityPointLink& link_b);
+    void setIsPassed(const size_t link_a, const size_t link_b);
 };
 
 
@@ -1,7 +1,9 @@
 //Copyright (c) 2019 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For count.
 #include <gtest/gtest.h>
+#include <memory> //For unique_ptr.
 
 #include "../src/settings/types/LayerIndex.h"
 #include "../src/utils/Date.h" //To check the Griffin header.
@@ -687,4 +689,172 @@ TEST_F(GCodeExportTest, insertWipeScriptHopEnable)
     EXPECT_EQ(std::string(";WIPE_SCRIPT_END"), token) << "Wipe script should always end with tag.";
 }
 
+TEST_F(GCodeExportTest, LayerBufferSameOutput)
+{
+    // Enough lines to be converted to text in multiple chunks.
+    const auto write_layer = [this]()
+    {
+        gcode.currentPosition = Point3(0, 0, MM2INT(20));
+        gcode.currentSpeed = 1;
+        gcode.current_e_value = 0;
+        for (int line_idx = 0; line_idx < 10000; line_idx++)
+        {
+            if (line_idx % 7 == 0)
+            {
+                gcode.writeComment("Some text between the moves");
+            }
+            const Velocity speed = 10 + line_idx % 3;
+            const double e = (line_idx % 5 == 0) ? gcode.current_e_value : line_idx * 0.01;
+            constexpr bool is_travel = false;
+            gcode.writeFXYZE(is_travel, speed, line_idx * 17 - 5000, -line_idx * 3, 200 + line_idx / 1000 * 200, e, PrintFeatureType::OuterWall);
+        }
+        gcode.writeComment("End of the layer");
+    };
+
+    write_layer();
+    const std::string unbuffered = output.str();
+    output.str("");
+
+    gcode.beginLayerBuffer();
+    write_layer();
+    EXPECT_EQ(std::string(""), output.str()) << "Nothing should be written before the layer is flushed.";
+    gcode.flushLayerBuffer();
+
+    EXPECT_EQ(unbuffered, output.str()) << "Buffering a layer should not change the g-code.";
+}
+
+TEST_F(GCodeExportTest, BinaryFlavorMoves)
+{
+    gcode.setFlavor(EGCodeFlavor::BINARY);
+    gcode.binary_reference = Point3(0, 0, 0);
+    gcode.binary_reference_e = 0;
+
+    gcode.writeFXYZE(true, 10, 1000, -2000, MM2INT(20), 0, PrintFeatureType::MoveCombing); // F600, Z and E unchanged
+    gcode.writeComment("text");
+    gcode.writeFXYZE(false, 10, 1000, -1000, 20200, 1.5, PrintFeatureType::OuterWall);
+
+    const std::vector<unsigned char> expected = {
+        0x81, 0xF0, 0x2E, 0xD0, 0x0F, 0x9F, 0x1F, // G0 with F 6000, X +1000 and Y -2000
+        ';', 't', 'e', 'x', 't', '\n',
+        0xC6, 0x00, 0xD0, 0x0F, 0xD0, 0xBB, 0x02, 0xE0, 0xA7, 0x12 // G1 with X +0, Y +1000, Z +20200 and E +150000
+    };
+    const std::string result = output.str();
+    EXPECT_EQ(std::string(expected.begin(), expected.end()), result) << "The moves should be written as binary records and the rest as text.";
+}
+
+TEST_F(GCodeExportTest, EstimatesOnly)
+{
+    const auto write_moves = [this]()
+    {
+        gcode.currentPosition = Point3(0, 0, MM2INT(20));
+        gcode.currentSpeed = 1;
+        gcode.current_e_value = 0;
+        gcode.estimateCalculator.reset();
+        gcode.estimateCalculator.setPosition(TimeEstimateCalculator::Position(0, 0, 20, 0));
+        for (int line_idx = 0; line_idx < 100; line_idx++)
+        {
+            gcode.writeComment("Some text between the moves");
+            const bool is_travel = line_idx % 2 == 0;
+            gcode.writeFXYZE(is_travel, 10 + line_idx % 3, line_idx * 170, (line_idx % 4) * 1000, MM2INT(20), line_idx * 0.01, PrintFeatureType::OuterWall);
+        }
+        return gcode.estimateCalculator.calculate();
+    };
+
+    const std::vector<Duration> written_estimates = write_moves();
+    output.str("");
+
+    gcode.setEstimatesOnly(true);
+    gcode.beginLayerBuffer();
+    const std::vector<Duration> estimates = write_moves();
+    gcode.flushLayerBuffer();
+
+    EXPECT_EQ(std::string(""), output.str()) << "No g-code should be written when only estimating.";
+    ASSERT_EQ(written_estimates.size(), estimates.size());
+    for (size_t feature_idx = 0; feature_idx < estimates.size(); feature_idx++)
+    {
+        EXPECT_EQ(double(written_estimates[feature_idx]), double(estimates[feature_idx])) << "The estimates should be the same as when writing g-code.";
+    }
+
+    gcode.setEstimatesOnly(false);
+    gcode.writeComment("Writing again");
+    EXPECT_EQ(std::string(";Writing again\n"), output.str()) << "The g-code should be written to the original stream again.";
+}
+
+TEST_F(GCodeExportTest, LayerRange)
+{
+    gcode.setLayerRange(2, 3);
+    gcode.writeComment("Start code");
+    for (int layer_nr = 0; layer_nr < 5; layer_nr++)
+    {
+        gcode.setLayerNr(layer_nr);
+        gcode.writeLayerComment(layer_nr);
+        gcode.writeFXYZE(false, 10, layer_nr * 1000, 0, MM2INT(20), layer_nr + 1.0, PrintFeatureType::OuterWall);
+        gcode.updateTotalPrintTime();
+    }
+
+    const std::string result = output.str();
+    EXPECT_EQ(std::string::npos, result.find("Start code")) << "The start code belongs to the first chunk.";
+    EXPECT_EQ(size_t(0), result.find(";CHUNK.START:2\n;CHUNK.EXTRUDER:0\nG92 E2\n;LAYER:2\nG1 F600 X2 Y0.00 E3\n")) << "The chunk should continue with the E value of the layers before it, and write the speed again.";
+    EXPECT_NE(std::string::npos, result.find(";LAYER:3\n")) << "The last layer of the range should be written.";
+    EXPECT_EQ(std::string::npos, result.find(";LAYER:4\n")) << "The layer after the range should not be written.";
+    EXPECT_NE(std::string::npos, result.find(";CHUNK.END:3\n;CHUNK.EXTRUDER:0\n;CHUNK.TIME:")) << "The range should end with its summary.";
+}
+
+TEST_F(GCodeExportTest, ChunkOutput)
+{
+    std::vector<std::unique_ptr<std::ostringstream>> chunks;
+    gcode.setLayerRange(0, 1);
+    gcode.setChunkOutput(2, [&chunks](const LayerIndex first_layer_nr)
+        {
+            chunks.emplace_back(new std::ostringstream());
+            *chunks.back() << ";Chunk of layer " << first_layer_nr << "\n";
+            return chunks.back().get();
+        });
+    for (int layer_nr = 0; layer_nr < 5; layer_nr++)
+    {
+        gcode.setLayerNr(layer_nr);
+        gcode.writeLayerComment(layer_nr);
+        gcode.writeFXYZE(false, 10, layer_nr * 1000, 0, MM2INT(20), layer_nr + 1.0, PrintFeatureType::OuterWall);
+        gcode.updateTotalPrintTime();
+    }
+
+    const std::string first = output.str();
+    EXPECT_NE(std::string::npos, first.find(";LAYER:1\n")) << "The first chunk should have the layers of the range.";
+    EXPECT_EQ(std::string::npos, first.find(";LAYER:2\n")) << "The layers after the range should go to the next chunks.";
+    EXPECT_NE(std::string::npos, first.find(";CHUNK.END:1\n")) << "The first chunk should end with its summary.";
+    ASSERT_EQ(size_t(2), chunks.size()) << "Layers 2-3 and 4 should each be a chunk of their own.";
+    const std::string second = chunks[0]->str();
+    EXPECT_EQ(size_t(0), second.find(";Chunk of layer 2\n;CHUNK.START:2\n;CHUNK.EXTRUDER:0\nG92 E2\n;LAYER:2\n")) << "Each chunk should restore the state of the printer, as if it were written by another process.";
+    EXPECT_NE(std::string::npos, second.find(";CHUNK.END:3\n"));
+    EXPECT_EQ(std::string::npos, second.find(";LAYER:4\n"));
+    EXPECT_EQ(size_t(0), chunks[1]->str().find(";Chunk of layer 4\n;CHUNK.START:4\n"));
+}
+
+TEST_F(GCodeExportTest, RewriteFileHeader)
+{
+    const std::string header = ";FLAVOR:Marlin\n;TIME:6666\n";
+    gcode.writeFileHeader(header);
+    const std::string reserved = output.str();
+    EXPECT_EQ(header, reserved.substr(0, header.size()));
+    gcode.writeComment("The rest of the g-code");
+
+    const std::string final_header = ";FLAVOR:Marlin\n;TIME:1337\n;Filament used: 0.02m\n";
+    ASSERT_TRUE(gcode.rewriteFileHeader(final_header));
+    gcode.writeComment("End of Gcode");
+
+    const std::string result = output.str();
+    ASSERT_EQ(reserved.size() + 38, result.size()) << "The header should be replaced in place.";
+    EXPECT_EQ(final_header, result.substr(0, final_header.size()));
+    EXPECT_EQ(std::count(reserved.begin(), reserved.end(), '\n'), std::count(result.begin(), result.begin() + reserved.size(), '\n')) << "The header should keep its number of lines.";
+    EXPECT_EQ(std::string(";The rest of the g-code\n;End of Gcode\n"), result.substr(reserved.size())) << "Writing should continue at the end.";
+}
+
+TEST_F(GCodeExportTest, RewriteFileHeaderTooLong)
+{
+    gcode.writeFileHeader(";FLAVOR:Marlin\n");
+    const std::string reserved = output.str();
+
+    EXPECT_FALSE(gcode.rewriteFileHeader(";FLAVOR:Marlin\n;" + std::string(1000, 'X') + "\n"));
+    EXPECT_EQ(reserved, output.str()) << "A header that doesn't fit shouldn't overwrite the g-code after it.";
+}
 } //namespace cura
@@ -0,0 +1,128 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "../src/GCodeStitcher.h" //The unit under test.
+
+namespace cura
+{
+
+TEST(GCodeStitcherTest, StitchChunks)
+{
+    std::stringstream first(
+        ";FLAVOR:Marlin\n"
+        ";TIME:6666\n"
+        ";Filament used: 0.5m\n"
+        ";MINX:0\n"
+        ";MAXX:10\n"
+        ";LAYER_COUNT:4\n"
+        ";LAYER:0\n"
+        "G1 X1 E1\n"
+        ";TIME_ELAPSED:10.000000\n"
+        ";LAYER:1\n"
+        "G1 X2 E2\n"
+        ";TIME_ELAPSED:20.000000\n"
+        ";CHUNK.END:1\n"
+        ";CHUNK.EXTRUDER:0\n"
+        ";CHUNK.TIME:20.000000\n"
+        ";CHUNK.VOLUME.0:100.000000\n"
+        ";CHUNK.LENGTH.0:0.040000\n"
+        ";CHUNK.MIN:1000,0,200\n"
+        ";CHUNK.MAX:2000,0,400\n");
+    std::stringstream second(
+        ";CHUNK.START:2\n"
+        ";CHUNK.EXTRUDER:0\n"
+        "G92 E2.00000\n"
+        ";LAYER:2\n"
+        "G1 X3 E3\n"
+        ";TIME_ELAPSED:15.000000\n"
+        ";LAYER:3\n"
+        "G1 X40 E4\n"
+        ";TIME_ELAPSED:30.500000\n"
+        ";End of Gcode\n"
+        ";CHUNK.END:3\n"
+        ";CHUNK.EXTRUDER:0\n"
+        ";CHUNK.TIME:30.500000\n"
+        ";CHUNK.VOLUME.0:150.000000\n"
+        ";CHUNK.LENGTH.0:0.060000\n"
+        ";CHUNK.MIN:0,0,200\n"
+        ";CHUNK.MAX:40000,0,800\n");
+    std::ostringstream output;
+
+    ASSERT_TRUE(GCodeStitcher::stitch({&first, &second}, output));
+
+    const std::string expected =
+        ";FLAVOR:Marlin\n"
+        ";TIME:50\n"
+        ";Filament used: 0.1m\n"
+        ";MINX:0\n"
+        ";MAXX:40\n"
+        ";LAYER_COUNT:4\n"
+        ";LAYER:0\n"
+        "G1 X1 E1\n"
+        ";TIME_ELAPSED:10.000000\n"
+        ";LAYER:1\n"
+        "G1 X2 E2\n"
+        ";TIME_ELAPSED:20.000000\n"
+        "G92 E2.00000\n"
+        ";LAYER:2\n"
+        "G1 X3 E3\n"
+        ";TIME_ELAPSED:35.000000\n"
+        ";LAYER:3\n"
+        "G1 X40 E4\n"
+        ";TIME_ELAPSED:50.500000\n"
+        ";End of Gcode\n";
+    EXPECT_EQ(expected, output.str()) << "The header should have the estimates of both chunks and the time should count on from the first chunk.";
+}
+
+TEST(GCodeStitcherTest, CompleteGriffinHeader)
+{
+    std::stringstream first(
+        ";START_OF_HEADER\n"
+        ";EXTRUDER_TRAIN.0.INITIAL_TEMPERATURE:200\n"
+        ";EXTRUDER_TRAIN.0.NOZZLE.DIAMETER:0.4\n"
+        ";PRINT.GROUPS:1\n"
+        ";END_OF_HEADER\n"
+        ";LAYER:0\n"
+        ";CHUNK.END:0\n"
+        ";CHUNK.EXTRUDER:0\n"
+        ";CHUNK.TIME:20.000000\n"
+        ";CHUNK.VOLUME.0:100.000000\n");
+    std::ostringstream output;
+
+    ASSERT_TRUE(GCodeStitcher::stitch({&first}, output));
+
+    const std::string expected =
+        ";START_OF_HEADER\n"
+        ";EXTRUDER_TRAIN.0.INITIAL_TEMPERATURE:200\n"
+        ";EXTRUDER_TRAIN.0.MATERIAL.VOLUME_USED:100\n"
+        ";EXTRUDER_TRAIN.0.NOZZLE.DIAMETER:0.4\n"
+        ";PRINT.TIME:20\n"
+        ";PRINT.GROUPS:1\n"
+        ";END_OF_HEADER\n"
+        ";LAYER:0\n";
+    EXPECT_EQ(expected, output.str()) << "A header without the estimates, from before they were known, should get them.";
+}
+
+TEST(GCodeStitcherTest, StitchChunksWithGap)
+{
+    std::stringstream first(";LAYER:0\n;CHUNK.END:0\n;CHUNK.EXTRUDER:0\n;CHUNK.TIME:1.0\n");
+    std::stringstream third(";CHUNK.START:2\n;CHUNK.EXTRUDER:0\n;LAYER:2\n;CHUNK.END:2\n;CHUNK.EXTRUDER:0\n;CHUNK.TIME:1.0\n");
+    std::ostringstream output;
+
+    EXPECT_FALSE(GCodeStitcher::stitch({&first, &third}, output)) << "Layer 1 is missing.";
+    EXPECT_EQ(std::string(""), output.str()) << "Nothing should be written if the chunks don't fit together.";
+}
+
+TEST(GCodeStitcherTest, StitchIncompleteChunk)
+{
+    std::stringstream first(";LAYER:0\n;CHUNK.END:0\n;CHUNK.EXTRUDER:0\n;CHUNK.TIME:1.0\n");
+    std::stringstream second(";CHUNK.START:1\n;CHUNK.EXTRUDER:0\n;LAYER:1\n");
+    std::ostringstream output;
+
+    EXPECT_FALSE(GCodeStitcher::stitch({&first, &second}, output)) << "The second chunk has no summary, so it may have been cut short.";
+}
+
+} //namespace cura
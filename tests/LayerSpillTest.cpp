@@ -0,0 +1,178 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/LayerSpill.h" //The unit under test.
+#include "../src/sliceDataStorage.h"
+#include "../src/support.h" //To generate the insets of support.
+#include "../src/utils/MemoryBudget.h"
+
+namespace cura
+{
+
+/*!
+ * \brief Check that two sets of polygons have the same points in the same
+ * order.
+ */
+static void expectSamePolygons(const Polygons& expected, const Polygons& actual)
+{
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t polygon_idx = 0; polygon_idx < expected.size(); polygon_idx++)
+    {
+        ASSERT_EQ(expected[polygon_idx].size(), actual[polygon_idx].size());
+        for (size_t point_idx = 0; point_idx < expected[polygon_idx].size(); point_idx++)
+        {
+            EXPECT_EQ(expected[polygon_idx][point_idx], actual[polygon_idx][point_idx]);
+        }
+    }
+}
+
+static Polygons square(const coord_t x, const coord_t y, const coord_t size)
+{
+    Polygons result;
+    PolygonRef polygon = result.newPoly();
+    polygon.emplace_back(x, y);
+    polygon.emplace_back(x + size, y);
+    polygon.emplace_back(x + size, y + size);
+    polygon.emplace_back(x, y + size);
+    return result;
+}
+
+TEST(LayerSpillTest, MeshLayerRoundTrip)
+{
+    SliceLayer layer;
+    layer.openPolyLines = square(-500, -500, 10);
+    layer.top_surface.areas = square(0, 0, 1000);
+    layer.parts.resize(2); //The second part stays empty.
+    SliceLayerPart& part = layer.parts[0];
+    part.outline.add(square(0, 0, 1000));
+    part.boundaryBox = AABB(part.outline);
+    part.insets = {square(100, 100, 800), square(200, 200, 600)};
+    part.is_enclosed = true;
+    part.infill_area = square(300, 300, 400);
+    part.infill_area_own = square(350, 350, 300);
+    part.infill_area_per_combine_per_density = {{square(300, 300, 400)}, {}};
+    part.skin_parts.emplace_back();
+    part.skin_parts.back().outline.add(square(400, 400, 50));
+    part.skin_parts.back().roofing_fill = square(410, 410, 30);
+    part.spaghetti_infill_volumes.emplace_back(square(300, 300, 10), 0.125);
+
+    BinaryWriter writer;
+    LayerSpill::writeLayer(writer, layer);
+
+    SliceLayer read_layer;
+    read_layer.parts.resize(2);
+    read_layer.parts[0].wall_overlap_linkers.resize(1); //Not in the record, so it must be kept.
+    BinaryReader reader(writer.getData());
+    ASSERT_TRUE(LayerSpill::readLayer(reader, read_layer));
+    EXPECT_TRUE(reader.atEnd());
+
+    expectSamePolygons(layer.openPolyLines, read_layer.openPolyLines);
+    expectSamePolygons(layer.top_surface.areas, read_layer.top_surface.areas);
+    ASSERT_EQ(size_t(2), read_layer.parts.size());
+    const SliceLayerPart& read_part = read_layer.parts[0];
+    EXPECT_EQ(part.boundaryBox.min, read_part.boundaryBox.min);
+    EXPECT_EQ(part.boundaryBox.max, read_part.boundaryBox.max);
+    expectSamePolygons(part.outline, read_part.outline);
+    ASSERT_EQ(part.insets.size(), read_part.insets.size());
+    expectSamePolygons(part.insets[1], read_part.insets[1]);
+    EXPECT_TRUE(read_part.is_enclosed);
+    expectSamePolygons(part.infill_area, read_part.infill_area);
+    ASSERT_TRUE(static_cast<bool>(read_part.infill_area_own));
+    expectSamePolygons(*part.infill_area_own, *read_part.infill_area_own);
+    ASSERT_EQ(size_t(2), read_part.infill_area_per_combine_per_density.size());
+    expectSamePolygons(part.infill_area_per_combine_per_density[0][0], read_part.infill_area_per_combine_per_density[0][0]);
+    EXPECT_TRUE(read_part.infill_area_per_combine_per_density[1].empty());
+    ASSERT_EQ(size_t(1), read_part.skin_parts.size());
+    expectSamePolygons(part.skin_parts[0].roofing_fill, read_part.skin_parts[0].roofing_fill);
+    ASSERT_EQ(size_t(1), read_part.spaghetti_infill_volumes.size());
+    EXPECT_EQ(0.125, read_part.spaghetti_infill_volumes[0].second);
+    EXPECT_EQ(size_t(1), read_part.wall_overlap_linkers.size()) << "The wall overlap linkers stay in memory.";
+    EXPECT_FALSE(static_cast<bool>(read_layer.parts[1].infill_area_own));
+}
+
+TEST(LayerSpillTest, SupportLayerRoundTrip)
+{
+    SupportLayer layer;
+    PolygonsPart outline;
+    outline.add(square(0, 0, 2000));
+    layer.support_infill_parts.emplace_back(outline, 400, 1);
+    AreaSupport::generateOutlineInsets(layer.support_infill_parts);
+    layer.support_infill_parts.back().generateInfillArea();
+    layer.support_roof = square(0, 0, 100);
+    layer.anti_overhang = square(5000, 5000, 100);
+
+    BinaryWriter writer;
+    LayerSpill::writeLayer(writer, layer);
+
+    SupportLayer read_layer;
+    BinaryReader reader(writer.getData());
+    ASSERT_TRUE(LayerSpill::readLayer(reader, read_layer));
+    EXPECT_TRUE(reader.atEnd());
+
+    ASSERT_EQ(size_t(1), read_layer.support_infill_parts.size());
+    const SupportInfillPart& part = layer.support_infill_parts[0];
+    const SupportInfillPart& read_part = read_layer.support_infill_parts[0];
+    expectSamePolygons(part.outline, read_part.outline);
+    EXPECT_EQ(part.support_line_width, read_part.support_line_width);
+    EXPECT_EQ(part.inset_count_to_generate, read_part.inset_count_to_generate);
+    ASSERT_EQ(part.insets.size(), read_part.insets.size());
+    expectSamePolygons(part.getInfillArea(), read_part.getInfillArea());
+    expectSamePolygons(layer.support_roof, read_layer.support_roof);
+    expectSamePolygons(layer.anti_overhang, read_layer.anti_overhang);
+}
+
+TEST(LayerSpillTest, PageInOnce)
+{
+    LayerSpill spill;
+    ASSERT_TRUE(spill.open("."));
+    BinaryWriter first;
+    first.writeString("layer 0");
+    BinaryWriter second;
+    second.writeString("layer 1");
+    ASSERT_TRUE(spill.write(0, first.getData()));
+    EXPECT_FALSE(spill.write(2, second.getData())) << "The layers must be written in order.";
+    ASSERT_TRUE(spill.write(1, second.getData()));
+    ASSERT_TRUE(spill.map());
+
+    std::string read;
+    size_t restore_count = 0;
+    const std::function<void (BinaryReader&)> restore = [&read, &restore_count](BinaryReader& reader)
+    {
+        EXPECT_TRUE(reader.readString(read));
+        EXPECT_TRUE(reader.atEnd());
+        restore_count++;
+    };
+    spill.pageIn(1, restore);
+    EXPECT_EQ(std::string("layer 1"), read);
+    spill.pageIn(1, restore);
+    EXPECT_EQ(size_t(1), restore_count) << "A layer is read back only once.";
+    spill.pageIn(0, restore);
+    EXPECT_EQ(std::string("layer 0"), read);
+    spill.pageIn(2, restore);
+    EXPECT_EQ(size_t(2), restore_count) << "Layer 2 wasn't spilled.";
+}
+
+TEST(LayerSpillTest, KeepInMemory)
+{
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    const size_t bytes_before = budget.get(MemoryAccount::COMPRESSED_LAYERS);
+    LayerSpill spill;
+    spill.keepInMemory();
+    BinaryWriter record;
+    record.writeString("layer 0");
+    ASSERT_TRUE(spill.write(0, record.getData()));
+    ASSERT_TRUE(spill.map());
+    EXPECT_EQ(bytes_before + record.getData().size(), budget.get(MemoryAccount::COMPRESSED_LAYERS)) << "The records in memory are counted.";
+
+    std::string read;
+    spill.pageIn(0, [&read](BinaryReader& reader)
+    {
+        EXPECT_TRUE(reader.readString(read));
+    });
+    EXPECT_EQ(std::string("layer 0"), read);
+    EXPECT_EQ(bytes_before, budget.get(MemoryAccount::COMPRESSED_LAYERS)) << "The record is dropped once it's read back.";
+}
+
+} //namespace cura
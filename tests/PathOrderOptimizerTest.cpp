@@ -0,0 +1,104 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/pathOrderOptimizer.h" //The unit under test.
+
+namespace cura
+{
+
+/*
+ * Parallel lines on consecutive scanlines should be printed in order, in
+ * alternating directions.
+ */
+TEST(LineOrderOptimizerTest, ParallelLinesZigZag)
+{
+    Polygons lines;
+    for (coord_t y = 0; y < 5000; y += 1000)
+    {
+        lines.addLine(Point(0, y), Point(10000, y));
+    }
+    LineOrderOptimizer optimizer(Point(-100, -100));
+    for (ConstPolygonRef line : lines)
+    {
+        optimizer.addPolygon(line);
+    }
+    optimizer.optimizeParallel();
+
+    ASSERT_EQ(optimizer.polyOrder.size(), lines.size());
+    for (size_t order_idx = 0; order_idx < optimizer.polyOrder.size(); order_idx++)
+    {
+        const int line_idx = optimizer.polyOrder[order_idx];
+        EXPECT_EQ(line_idx, static_cast<int>(order_idx)) << "The lines should be printed from the side closest to the start.";
+        EXPECT_EQ(optimizer.polyStart[line_idx], static_cast<int>(order_idx % 2)) << "Every next line should be printed in the other direction.";
+    }
+}
+
+/*
+ * When a scanline is interrupted by a hole, the lines on either side of the hole
+ * should be printed in separate strips, rather than crossing the hole on every
+ * scanline.
+ */
+TEST(LineOrderOptimizerTest, ParallelLinesAroundHole)
+{
+    Polygons lines;
+    for (coord_t y = 0; y < 10000; y += 1000)
+    {
+        lines.addLine(Point(0, y), Point(4000, y)); //Left of the hole.
+        lines.addLine(Point(6000, y), Point(10000, y)); //Right of the hole.
+    }
+    LineOrderOptimizer optimizer(Point(0, 0));
+    for (ConstPolygonRef line : lines)
+    {
+        optimizer.addPolygon(line);
+    }
+    optimizer.optimizeParallel();
+
+    ASSERT_EQ(optimizer.polyOrder.size(), lines.size());
+    std::vector<bool> seen(lines.size(), false);
+    size_t hole_crossings = 0;
+    for (size_t order_idx = 0; order_idx < optimizer.polyOrder.size(); order_idx++)
+    {
+        const int line_idx = optimizer.polyOrder[order_idx];
+        EXPECT_FALSE(seen[line_idx]) << "Every line should be printed once.";
+        seen[line_idx] = true;
+        if (order_idx > 0)
+        {
+            hole_crossings += (line_idx % 2) != (optimizer.polyOrder[order_idx - 1] % 2);
+        }
+    }
+    EXPECT_EQ(hole_crossings, 1) << "All lines on one side of the hole should be printed before going to the other side.";
+}
+
+/*
+ * Polylines, such as those of zigzags, can't be ordered along their scanlines,
+ * so they should be ordered like the general optimizer does instead.
+ */
+TEST(LineOrderOptimizerTest, ParallelPolylinesLikeGeneral)
+{
+    Polygons lines;
+    for (coord_t y = 0; y < 10000; y += 2000)
+    {
+        Polygon zigzag;
+        zigzag.add(Point(0, y));
+        zigzag.add(Point(10000, y));
+        zigzag.add(Point(10000, y + 1000));
+        zigzag.add(Point(0, y + 1000));
+        lines.add(zigzag);
+    }
+    LineOrderOptimizer parallel_optimizer(Point(0, 0));
+    LineOrderOptimizer general_optimizer(Point(0, 0));
+    for (ConstPolygonRef line : lines)
+    {
+        parallel_optimizer.addPolygon(line);
+        general_optimizer.addPolygon(line);
+    }
+    parallel_optimizer.optimizeParallel();
+    general_optimizer.optimize();
+
+    EXPECT_EQ(parallel_optimizer.polyOrder, general_optimizer.polyOrder);
+    EXPECT_EQ(parallel_optimizer.polyStart, general_optimizer.polyStart);
+}
+
+} //namespace cura
@@ -6,8 +6,10 @@
 
 #include "MockSocket.h" //To mock out the communication with the front-end.
 #include "../src/FffProcessor.h"
+#include "../src/PrintFeature.h"
 #include "../src/communication/ArcusCommunicationPrivate.h" //To access the private fields of this communication class.
 #include "../src/settings/types/LayerIndex.h"
+#include "../src/settings/types/Velocity.h"
 #include "../src/utils/polygon.h" //Create test shapes to send over the socket.
 
 namespace cura
@@ -153,6 +155,24 @@ TEST_F(ArcusCommunicationTest, SendLayerComplete)
     EXPECT_EQ(static_cast<float>(layer_thickness), message->thickness());
 }
 
+TEST_F(ArcusCommunicationTest, SendLayerWhenGoingUp)
+{
+    ac->setLayerForSend(0);
+    ac->sendCurrentPosition(Point(0, 0));
+    ac->sendLineTo(PrintFeatureType::OuterWall, Point(1000, 0), 400, 200, Velocity(30));
+    EXPECT_TRUE(socket->sent_messages.empty()) << "The layer may still get more lines.";
+
+    ac->setLayerForSend(1);
+    ASSERT_EQ(size_t(1), socket->sent_messages.size()) << "Going up completes the previous layer.";
+    const proto::LayerOptimized* message = dynamic_cast<proto::LayerOptimized*>(socket->sent_messages.back().get());
+    ASSERT_NE(nullptr, message);
+    EXPECT_EQ(0, message->id());
+    EXPECT_EQ(1, message->path_segment_size());
+
+    ac->sendOptimizedLayerData();
+    EXPECT_EQ(size_t(1), socket->sent_messages.size()) << "Layer 0 was sent already, and nothing was drawn in layer 1.";
+}
+
 TEST_F(ArcusCommunicationTest, SendProgress)
 {
     ac->private_data->object_count = 2; //If there are two objects, all progress should get halved.
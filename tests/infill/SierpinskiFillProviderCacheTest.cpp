@@ -0,0 +1,84 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To keep warm state.
+#include "../src/infill/SierpinskiFillProvider.h"
+#include "../src/infill/SierpinskiFillProviderCache.h" //The class under test.
+
+namespace cura
+{
+
+class SierpinskiFillProviderCacheTest : public testing::Test
+{
+public:
+    AABB3D aabb;
+    bool keep_warm_state;
+
+    void SetUp()
+    {
+        aabb = AABB3D(Point3(0, 0, 0), Point3(20000, 20000, 10000));
+        keep_warm_state = Application::getInstance().keep_warm_state;
+        Application::getInstance().keep_warm_state = true;
+    }
+
+    void TearDown()
+    {
+        SierpinskiFillProviderCache::getInstance().beginSlice(); //Clear the cache for other tests.
+        SierpinskiFillProviderCache::getInstance().beginSlice();
+        Application::getInstance().keep_warm_state = keep_warm_state;
+    }
+};
+
+TEST_F(SierpinskiFillProviderCacheTest, ReuseSameParameters)
+{
+    SierpinskiFillProviderCache& cache = SierpinskiFillProviderCache::getInstance();
+    cache.beginSlice();
+    const std::shared_ptr<const SierpinskiFillProvider> first = cache.get(aabb, 2000, 400, "");
+
+    cache.beginSlice();
+    AABB3D taller = aabb;
+    taller.max.z *= 2;
+    const std::shared_ptr<const SierpinskiFillProvider> second = cache.get(taller, 2000, 400, "");
+    EXPECT_EQ(first, second) << "The fractal is flat, so it must be reused for a bounding box of another height.";
+}
+
+TEST_F(SierpinskiFillProviderCacheTest, RebuildOtherParameters)
+{
+    SierpinskiFillProviderCache& cache = SierpinskiFillProviderCache::getInstance();
+    cache.beginSlice();
+    const std::shared_ptr<const SierpinskiFillProvider> first = cache.get(aabb, 2000, 400, "");
+    const std::shared_ptr<const SierpinskiFillProvider> other_distance = cache.get(aabb, 3000, 400, "");
+    EXPECT_NE(first, other_distance);
+    AABB3D wider = aabb;
+    wider.max.x *= 2;
+    const std::shared_ptr<const SierpinskiFillProvider> other_aabb = cache.get(wider, 2000, 400, "");
+    EXPECT_NE(first, other_aabb);
+    EXPECT_EQ(cache.size(), 3);
+}
+
+TEST_F(SierpinskiFillProviderCacheTest, DropUnused)
+{
+    SierpinskiFillProviderCache& cache = SierpinskiFillProviderCache::getInstance();
+    cache.beginSlice();
+    cache.get(aabb, 2000, 400, "");
+    cache.get(aabb, 3000, 400, "");
+
+    cache.beginSlice();
+    cache.get(aabb, 2000, 400, "");
+    cache.beginSlice();
+    EXPECT_EQ(cache.size(), 1) << "The fractal that wasn't used in the previous slice must be dropped.";
+}
+
+TEST_F(SierpinskiFillProviderCacheTest, NothingKeptWithoutWarmState)
+{
+    Application::getInstance().keep_warm_state = false;
+    SierpinskiFillProviderCache& cache = SierpinskiFillProviderCache::getInstance();
+    const std::shared_ptr<const SierpinskiFillProvider> first = cache.get(aabb, 2000, 400, "");
+    const std::shared_ptr<const SierpinskiFillProvider> second = cache.get(aabb, 2000, 400, "");
+    EXPECT_NE(first, second);
+    EXPECT_EQ(cache.size(), 0);
+}
+
+} //namespace cura
@@ -0,0 +1,223 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory> //For unique_ptr.
+
+#include "../src/Application.h" //To set up a slice with settings.
+#include "../src/Slice.h" //To set up a scene to slice.
+#include "../src/SlicerCache.h" //The class under test.
+#include "../src/utils/floatpoint.h" //For FMatrix3x3 to load STL files.
+
+namespace cura
+{
+
+class SlicerCacheTest : public testing::Test
+{
+public:
+    SlicerCache cache;
+    size_t num_layers;
+
+    void SetUp()
+    {
+        //Set up a scene so that we may request settings.
+        Application::getInstance().current_slice = new Slice(1);
+
+        Scene& scene = Application::getInstance().current_slice->scene;
+        scene.settings.add("slicing_tolerance", "middle");
+        scene.settings.add("layer_height_0", "0.2");
+        scene.settings.add("layer_height", "0.1");
+        scene.settings.add("magic_mesh_surface_mode", "normal");
+        scene.settings.add("meshfix_extensive_stitching", "false");
+        scene.settings.add("meshfix_keep_open_polygons", "false");
+        scene.settings.add("minimum_polygon_circumference", "1");
+        scene.settings.add("meshfix_maximum_resolution", "0.04");
+        scene.settings.add("meshfix_maximum_deviation", "0.02");
+        scene.settings.add("xy_offset", "0");
+        scene.settings.add("xy_offset_layer_0", "0");
+
+        MeshGroup& mesh_group = scene.mesh_groups.back();
+        const FMatrix3x3 transformation;
+        //Path to cube.stl is relative to CMAKE_CURRENT_SOURCE_DIR/tests.
+        ASSERT_TRUE(loadMeshIntoMeshGroup(&mesh_group, "integration/resources/cube.stl", transformation, scene.settings));
+        ASSERT_EQ(mesh_group.meshes.size(), 1);
+
+        num_layers = (mesh_group.meshes[0].getAABB().max.z - scene.settings.get<coord_t>("layer_height_0")) / scene.settings.get<coord_t>("layer_height") + 1;
+    }
+
+    void TearDown()
+    {
+        delete Application::getInstance().current_slice;
+        Application::getInstance().current_slice = nullptr;
+    }
+
+    /*!
+     * Slice a mesh with a cache, as the next slice.
+     */
+    std::unique_ptr<Slicer> slice(Mesh& mesh, SlicerCache& slicer_cache, const bool keep_in_memory = true, const std::string& directory = "")
+    {
+        const coord_t layer_thickness = Application::getInstance().current_slice->scene.settings.get<coord_t>("layer_height");
+        slicer_cache.beginSlice(keep_in_memory, directory);
+        slicer_cache.beginMeshGroup(layer_thickness, num_layers, nullptr);
+        return std::unique_ptr<Slicer>(slicer_cache.slice(mesh, layer_thickness, num_layers, false, nullptr));
+    }
+
+    std::unique_ptr<Slicer> slice(Mesh& mesh)
+    {
+        return slice(mesh, cache);
+    }
+
+    /*!
+     * Get the file that a cache on disk in the working directory keeps a mesh
+     * in.
+     */
+    std::string getFilename(const Mesh& mesh, const size_t variant)
+    {
+        SlicerCache disk_cache;
+        disk_cache.beginSlice(false, ".");
+        disk_cache.beginMeshGroup(Application::getInstance().current_slice->scene.settings.get<coord_t>("layer_height"), num_layers, nullptr);
+        return disk_cache.getFilename(disk_cache.hash(mesh), variant);
+    }
+
+    /*!
+     * Check that two slicers produced the same layers.
+     */
+    void expectSameLayers(const Slicer& expected, const Slicer& actual)
+    {
+        ASSERT_EQ(expected.layers.size(), actual.layers.size());
+        for (size_t layer_nr = 0; layer_nr < expected.layers.size(); layer_nr++)
+        {
+            EXPECT_EQ(expected.layers[layer_nr].z, actual.layers[layer_nr].z);
+            const Polygons& expected_polygons = expected.layers[layer_nr].polygons;
+            const Polygons& actual_polygons = actual.layers[layer_nr].polygons;
+            ASSERT_EQ(expected_polygons.size(), actual_polygons.size()) << "Layer " << layer_nr << " must have the same polygons.";
+            for (size_t polygon_idx = 0; polygon_idx < expected_polygons.size(); polygon_idx++)
+            {
+                ASSERT_EQ(expected_polygons[polygon_idx].size(), actual_polygons[polygon_idx].size());
+                for (size_t point_idx = 0; point_idx < expected_polygons[polygon_idx].size(); point_idx++)
+                {
+                    EXPECT_EQ(expected_polygons[polygon_idx][point_idx], actual_polygons[polygon_idx][point_idx]);
+                }
+            }
+        }
+    }
+};
+
+TEST_F(SlicerCacheTest, SameMeshGetsSameLayers)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh mesh_copy = mesh; //The next slice gets the same mesh again, in a new object.
+
+    const std::unique_ptr<Slicer> sliced = slice(mesh);
+    const std::unique_ptr<Slicer> cached = slice(mesh_copy);
+
+    expectSameLayers(*sliced, *cached);
+    ASSERT_FALSE(sliced->layers[1].segment_face_indices.empty());
+    EXPECT_TRUE(cached->layers[1].segment_face_indices.empty()) << "The second slice must come from the cache, which doesn't keep the segments.";
+}
+
+TEST_F(SlicerCacheTest, ChangedSettingSlicesAgain)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh offset_mesh = mesh;
+    offset_mesh.settings.add("xy_offset", "1");
+
+    const std::unique_ptr<Slicer> sliced = slice(mesh);
+    const std::unique_ptr<Slicer> offset = slice(offset_mesh);
+
+    ASSERT_EQ(sliced->layers.size(), offset->layers.size());
+    ASSERT_EQ(offset->layers[1].polygons.size(), 1);
+    EXPECT_GT(offset->layers[1].polygons.area(), sliced->layers[1].polygons.area()) << "With a different setting, the mesh must be sliced again rather than taken from the cache.";
+}
+
+TEST_F(SlicerCacheTest, UnusedSettingChangeGetsSameLayers)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh faster_mesh = mesh;
+    faster_mesh.settings.add("speed_print", "80"); //Isn't read while slicing.
+
+    const std::unique_ptr<Slicer> sliced = slice(mesh);
+    const std::unique_ptr<Slicer> cached = slice(faster_mesh);
+
+    expectSameLayers(*sliced, *cached);
+    EXPECT_TRUE(cached->layers[1].segment_face_indices.empty()) << "A setting that the slicer doesn't read mustn't cause the mesh to be sliced again.";
+}
+
+TEST_F(SlicerCacheTest, ChangedMeshSlicesAgain)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh moved_mesh = mesh;
+    for (MeshVertex& vertex : moved_mesh.vertices)
+    {
+        vertex.p.x += 1000;
+    }
+
+    const std::unique_ptr<Slicer> sliced = slice(mesh);
+    const std::unique_ptr<Slicer> moved = slice(moved_mesh);
+
+    ASSERT_EQ(moved->layers[1].polygons.size(), 1);
+    EXPECT_EQ(sliced->layers[1].polygons.min().X + 1000, moved->layers[1].polygons.min().X) << "A mesh with different vertices must be sliced again.";
+}
+
+TEST_F(SlicerCacheTest, DiskCacheGetsSameLayers)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh mesh_copy = mesh;
+    const std::string filename = getFilename(mesh, 0);
+
+    SlicerCache first_run;
+    const std::unique_ptr<Slicer> sliced = slice(mesh, first_run, false, ".");
+    SlicerCache second_run; //Another run of the engine, which has nothing in memory.
+    const std::unique_ptr<Slicer> cached = slice(mesh_copy, second_run, false, ".");
+    std::remove(filename.c_str());
+
+    expectSameLayers(*sliced, *cached);
+    EXPECT_TRUE(cached->layers[1].segment_face_indices.empty()) << "The second run must read the layers from disk.";
+}
+
+TEST_F(SlicerCacheTest, DiskCacheKeepsSettingsApart)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh offset_mesh = mesh;
+    offset_mesh.settings.add("xy_offset", "1");
+    Mesh offset_mesh_copy = offset_mesh;
+
+    SlicerCache first_run;
+    slice(mesh, first_run, false, ".");
+    SlicerCache second_run;
+    const std::unique_ptr<Slicer> offset = slice(offset_mesh, second_run, false, ".");
+    SlicerCache third_run;
+    const std::unique_ptr<Slicer> cached_offset = slice(offset_mesh_copy, third_run, false, ".");
+    std::remove(getFilename(mesh, 0).c_str());
+    std::remove(getFilename(mesh, 1).c_str());
+
+    EXPECT_FALSE(offset->layers[1].segment_face_indices.empty()) << "The file of the mesh with different settings mustn't be used.";
+    expectSameLayers(*offset, *cached_offset);
+    EXPECT_TRUE(cached_offset->layers[1].segment_face_indices.empty()) << "The mesh with different settings must have gotten its own file.";
+}
+
+TEST_F(SlicerCacheTest, DiskCacheIgnoresCorruptFile)
+{
+    Mesh& mesh = Application::getInstance().current_slice->scene.mesh_groups[0].meshes[0];
+    Mesh mesh_copy = mesh;
+    const std::string filename = getFilename(mesh, 0);
+
+    SlicerCache first_run;
+    const std::unique_ptr<Slicer> sliced = slice(mesh, first_run, false, ".");
+    {
+        std::fstream file(filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        file.seekp(40);
+        file.put('\x55');
+    }
+    SlicerCache second_run;
+    const std::unique_ptr<Slicer> resliced = slice(mesh_copy, second_run, false, ".");
+    std::remove(filename.c_str());
+    std::remove(getFilename(mesh, 1).c_str());
+
+    expectSameLayers(*sliced, *resliced);
+    EXPECT_FALSE(resliced->layers[1].segment_face_indices.empty()) << "A corrupt file must be ignored.";
+}
+
+} //namespace cura
@@ -0,0 +1,182 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <memory> //For unique_ptr.
+
+#include "../src/Application.h" //To set up a slice with settings.
+#include "../src/ExtruderTrain.h"
+#include "../src/Slice.h"
+#include "../src/sliceDataStorage.h"
+#include "../src/pathPlanning/Comb.h" //The class under test.
+#include "../src/pathPlanning/CombPaths.h"
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+/*
+ * Tests the shortcuts Comb takes before combing: going straight for short
+ * travels and not combing through air beyond a number of travels per layer.
+ */
+class CombTest : public testing::Test
+{
+public:
+    Polygons boundary; //!< Two parts of which the first has a hole.
+    SliceDataStorage* storage; //!< Only asked which extruders are used, since travels through air don't avoid other parts here.
+
+    void SetUp() override
+    {
+        Application::getInstance().current_slice = new Slice(1);
+        Scene& scene = Application::getInstance().current_slice->scene;
+        Settings& settings = scene.current_mesh_group->settings;
+        settings.add("machine_width", "200");
+        settings.add("machine_depth", "200");
+        settings.add("machine_height", "200");
+        settings.add("machine_center_is_zero", "false");
+        settings.add("adhesion_type", "none");
+        settings.add("prime_tower_enable", "false");
+        settings.add("retraction_hop_enabled", "false");
+        settings.add("retraction_hop_only_when_collides", "false");
+        settings.add("travel_avoid_other_parts", "false"); //Travels between parts go straight through air, which doesn't need the outlines of the layer.
+        scene.extruders.emplace_back(0, &settings);
+
+        storage = new SliceDataStorage();
+
+        boundary.clear();
+        PolygonRef first = boundary.newPoly();
+        first.emplace_back(0, 0);
+        first.emplace_back(20000, 0);
+        first.emplace_back(20000, 20000);
+        first.emplace_back(0, 20000);
+        PolygonRef hole = boundary.newPoly();
+        hole.emplace_back(8000, 8000);
+        hole.emplace_back(8000, 12000);
+        hole.emplace_back(12000, 12000);
+        hole.emplace_back(12000, 8000);
+        PolygonRef second = boundary.newPoly();
+        second.emplace_back(40000, 0);
+        second.emplace_back(60000, 0);
+        second.emplace_back(60000, 20000);
+        second.emplace_back(40000, 20000);
+    }
+
+    void TearDown() override
+    {
+        delete storage;
+        delete Application::getInstance().current_slice;
+    }
+
+    /*!
+     * Comb a travel between points which should both be inside.
+     */
+    bool calc(Comb& comb, const Point start, const Point end, CombPaths& comb_paths)
+    {
+        constexpr bool start_inside = true;
+        constexpr bool end_inside = true;
+        constexpr coord_t max_comb_distance_ignored = 0;
+        return comb.calc(Application::getInstance().current_slice->scene.extruders[0], start, end, comb_paths, start_inside, end_inside, max_comb_distance_ignored);
+    }
+
+    /*!
+     * Create the Comb of a layer, which reads the limits from the settings.
+     */
+    Comb* makeComb()
+    {
+        constexpr coord_t offset_from_outlines = 200;
+        constexpr coord_t travel_avoid_distance = 600;
+        constexpr coord_t move_inside_distance = 100;
+        return new Comb(*storage, LayerIndex(1), boundary, boundary, offset_from_outlines, travel_avoid_distance, move_inside_distance);
+    }
+};
+
+TEST_F(CombTest, DirectTravelGoesStraight)
+{
+    Application::getInstance().current_slice->scene.settings.add("retraction_combing_direct_max_distance", "5");
+    std::unique_ptr<Comb> comb(makeComb());
+
+    CombPaths comb_paths;
+    const Point start(16000, 3000);
+    const Point end(19960, 3000); //Close to the side of the part, which combing would move away from.
+    ASSERT_TRUE(calc(*comb, start, end, comb_paths));
+    ASSERT_EQ(comb_paths.size(), 1);
+    EXPECT_EQ(static_cast<const std::vector<Point>&>(comb_paths[0]), std::vector<Point>({start, end})) << "The travel isn't combed, so the end isn't moved inside.";
+    EXPECT_FALSE(comb_paths[0].cross_boundary);
+    EXPECT_FALSE(comb_paths.throughAir);
+}
+
+TEST_F(CombTest, WithoutDirectTravelCombs)
+{
+    std::unique_ptr<Comb> comb(makeComb());
+
+    CombPaths comb_paths;
+    const Point start(16000, 3000);
+    const Point end(19960, 3000);
+    ASSERT_TRUE(calc(*comb, start, end, comb_paths));
+    ASSERT_EQ(comb_paths.size(), 1);
+    EXPECT_EQ(comb_paths[0].back(), Point(19900, 3000)) << "Combing moves the end away from the side of the part.";
+}
+
+TEST_F(CombTest, LongTravelIsCombed)
+{
+    Application::getInstance().current_slice->scene.settings.add("retraction_combing_direct_max_distance", "5");
+    std::unique_ptr<Comb> comb(makeComb());
+
+    CombPaths comb_paths;
+    const Point start(1000, 3000);
+    const Point end(19960, 3000); //Straight within the part, but over the limit.
+    ASSERT_TRUE(calc(*comb, start, end, comb_paths));
+    ASSERT_EQ(comb_paths.size(), 1);
+    EXPECT_EQ(comb_paths[0].back(), Point(19900, 3000)) << "Combing moves the end away from the side of the part.";
+}
+
+TEST_F(CombTest, DirectTravelAroundHole)
+{
+    Application::getInstance().current_slice->scene.settings.add("retraction_combing_direct_max_distance", "5");
+    std::unique_ptr<Comb> comb(makeComb());
+
+    CombPaths comb_paths;
+    const Point start(7000, 10000);
+    const Point end(13000, 10000); //Under the limit, but the hole is in between.
+    ASSERT_TRUE(calc(*comb, start, end, comb_paths));
+    ASSERT_EQ(comb_paths.size(), 1);
+    EXPECT_GT(comb_paths[0].size(), 2) << "The travel must be combed around the hole.";
+    EXPECT_EQ(comb_paths[0].back(), end);
+}
+
+TEST_F(CombTest, AirTravelsLimitedPerLayer)
+{
+    Application::getInstance().current_slice->scene.settings.add("retraction_combing_max_air_travels_per_layer", "2");
+    std::unique_ptr<Comb> comb(makeComb());
+
+    const Point first_part(5000, 5000);
+    const Point second_part(50000, 10000);
+    for (size_t travel = 0; travel < 2; travel++)
+    {
+        CombPaths comb_paths;
+        EXPECT_TRUE(calc(*comb, first_part, second_part, comb_paths)) << "Travel " << travel << " is within the limit.";
+        EXPECT_TRUE(comb_paths.throughAir);
+    }
+    CombPaths over_limit;
+    EXPECT_FALSE(calc(*comb, second_part, first_part, over_limit)) << "The third travel through air is over the limit, so it needs a retraction.";
+
+    CombPaths within_part;
+    EXPECT_TRUE(calc(*comb, first_part, Point(15000, 5000), within_part)) << "Travels within a part don't count toward the limit.";
+
+    std::unique_ptr<Comb> next_layer(makeComb());
+    CombPaths next_layer_paths;
+    EXPECT_TRUE(calc(*next_layer, second_part, first_part, next_layer_paths)) << "Each layer has its own limit.";
+}
+
+TEST_F(CombTest, AirTravelsUnlimited)
+{
+    std::unique_ptr<Comb> comb(makeComb());
+
+    for (size_t travel = 0; travel < 10; travel++)
+    {
+        CombPaths comb_paths;
+        EXPECT_TRUE(calc(*comb, Point(5000, 5000), Point(50000, 10000), comb_paths)) << "Without a limit, travel " << travel << " is combed through air.";
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,160 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cmath> //For generating circles.
+#include <gtest/gtest.h>
+#include <memory> //For unique_ptr.
+
+#include "../src/pathPlanning/CombPath.h" //The output of combing.
+#include "../src/pathPlanning/LinePolygonsCrossings.h" //The class under test.
+#include "../src/utils/polygon.h"
+#include "../src/utils/polygonUtils.h" //To create the grids of line segments.
+
+namespace cura
+{
+
+/*
+ * LinePolygonsCrossings only looks at the line segments in the grid cells
+ * along a travel move, when the grid is made of the boundary it combs in. When
+ * the grid is made of other polygons it falls back to scanning all segments.
+ * Both must give the same result.
+ */
+class LinePolygonsCrossingsTest : public testing::Test
+{
+public:
+    Polygons boundary; //!< A part to comb in, made the way Comb assembles its inside parts.
+    Polygons boundary_copy; //!< The same polygons, but another object, so grids of it make LinePolygonsCrossings scan all segments.
+    Polygons other_parts; //!< The boundary and another part beside it, like the whole inside boundary of a layer.
+    std::vector<Point> points; //!< Points inside the boundary to travel between.
+
+    void SetUp() override
+    {
+        //A detailed circle with a round hole and a square hole.
+        Polygons shape;
+        PolygonRef circle = shape.newPoly();
+        for (size_t i = 0; i < 64; i++)
+        {
+            const double angle = 2 * M_PI * i / 64;
+            circle.emplace_back(10000 + std::llrint(10000 * std::cos(angle)), 10000 + std::llrint(10000 * std::sin(angle)));
+        }
+        PolygonRef round_hole = shape.newPoly();
+        for (size_t i = 0; i < 32; i++)
+        {
+            const double angle = -2 * M_PI * i / 32;
+            round_hole.emplace_back(8000 + std::llrint(3000 * std::cos(angle)), 11000 + std::llrint(3000 * std::sin(angle)));
+        }
+        PolygonRef square_hole = shape.newPoly();
+        square_hole.emplace_back(13000, 4000);
+        square_hole.emplace_back(13000, 6000);
+        square_hole.emplace_back(15000, 6000);
+        square_hole.emplace_back(15000, 4000);
+
+        const std::vector<PolygonsPart> parts = shape.splitIntoParts();
+        ASSERT_EQ(parts.size(), 1);
+        boundary = parts[0];
+        boundary_copy = boundary;
+
+        other_parts = boundary;
+        PolygonRef other_part = other_parts.newPoly();
+        other_part.emplace_back(30000, 0);
+        other_part.emplace_back(35000, 0);
+        other_part.emplace_back(35000, 5000);
+        other_part.emplace_back(30000, 5000);
+
+        points.clear();
+        for (coord_t x = 500; x < 20000; x += 1700)
+        {
+            for (coord_t y = 300; y < 20000; y += 1700)
+            {
+                if (boundary.inside(Point(x, y)))
+                {
+                    points.emplace_back(x, y);
+                }
+            }
+        }
+    }
+
+    /*!
+     * Comb every pair of points and check that the grid of \p polygons gives
+     * the same paths as the grid of the boundary.
+     */
+    void expectSameAsGridOfBoundary(const Polygons& polygons, const coord_t cell_size)
+    {
+        const std::unique_ptr<LocToLineGrid> boundary_grid(PolygonUtils::createLocToLineGrid(boundary, cell_size));
+        const std::unique_ptr<LocToLineGrid> polygons_grid(PolygonUtils::createLocToLineGrid(polygons, cell_size));
+        constexpr coord_t dist_to_move_boundary_point_outside = -40; //Like combing inside.
+        constexpr coord_t max_comb_distance_ignored = 0;
+        size_t collisions = 0;
+        for (const Point& start : points)
+        {
+            for (const Point& end : points)
+            {
+                if (start == end)
+                {
+                    continue;
+                }
+                const bool collides = LinePolygonsCrossings::collidesWithBoundary(boundary, *boundary_grid, start, end);
+                ASSERT_EQ(collides, LinePolygonsCrossings::collidesWithBoundary(boundary, *polygons_grid, start, end)) << "From " << start << " to " << end << ", cells of " << cell_size << ".";
+                collisions += collides;
+
+                for (const bool fail_on_unavoidable_obstacles : {false, true})
+                {
+                    CombPath filtered;
+                    const bool filtered_success = LinePolygonsCrossings::comb(boundary, *boundary_grid, start, end, filtered, dist_to_move_boundary_point_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+                    CombPath scanned;
+                    const bool scanned_success = LinePolygonsCrossings::comb(boundary, *polygons_grid, start, end, scanned, dist_to_move_boundary_point_outside, max_comb_distance_ignored, fail_on_unavoidable_obstacles);
+                    ASSERT_EQ(filtered_success, scanned_success) << "From " << start << " to " << end << ", cells of " << cell_size << ".";
+                    ASSERT_EQ(filtered, scanned) << "From " << start << " to " << end << ", cells of " << cell_size << ".";
+                    ASSERT_EQ(filtered.cross_boundary, scanned.cross_boundary) << "From " << start << " to " << end << ", cells of " << cell_size << ".";
+                }
+            }
+        }
+        EXPECT_GT(collisions, 0) << "Some travels must go around the holes, or the combing isn't tested.";
+    }
+};
+
+TEST_F(LinePolygonsCrossingsTest, GridOfCopyScansAllSegments)
+{
+    for (const coord_t cell_size : {200, 1000, 50000})
+    {
+        expectSameAsGridOfBoundary(boundary_copy, cell_size);
+    }
+}
+
+TEST_F(LinePolygonsCrossingsTest, GridOfOtherPartsScansAllSegments)
+{
+    for (const coord_t cell_size : {200, 1000, 50000})
+    {
+        expectSameAsGridOfBoundary(other_parts, cell_size);
+    }
+}
+
+TEST_F(LinePolygonsCrossingsTest, StraightWithinPart)
+{
+    const std::unique_ptr<LocToLineGrid> grid(PolygonUtils::createLocToLineGrid(boundary, 200));
+    const Point start(2000, 6000);
+    const Point end(6000, 3000);
+    EXPECT_FALSE(LinePolygonsCrossings::collidesWithBoundary(boundary, *grid, start, end));
+    CombPath path;
+    EXPECT_TRUE(LinePolygonsCrossings::comb(boundary, *grid, start, end, path, -40, 0, false));
+    EXPECT_EQ(static_cast<const std::vector<Point>&>(path), std::vector<Point>({start, end}));
+}
+
+TEST_F(LinePolygonsCrossingsTest, AroundHole)
+{
+    const std::unique_ptr<LocToLineGrid> grid(PolygonUtils::createLocToLineGrid(boundary, 200));
+    const Point start(3000, 11000);
+    const Point end(13000, 11000); //The round hole is in between.
+    EXPECT_TRUE(LinePolygonsCrossings::collidesWithBoundary(boundary, *grid, start, end));
+    CombPath path;
+    EXPECT_TRUE(LinePolygonsCrossings::comb(boundary, *grid, start, end, path, -40, 0, false));
+    ASSERT_GT(path.size(), 2);
+    EXPECT_EQ(path.front(), start);
+    EXPECT_EQ(path.back(), end);
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        EXPECT_FALSE(PolygonUtils::polygonCollidesWithLineSegment(path[i - 1], path[i], *grid)) << "The path must go around the hole.";
+    }
+}
+
+} //namespace cura
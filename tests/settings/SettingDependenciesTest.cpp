@@ -0,0 +1,120 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/Application.h" //To set up a scene with settings.
+#include "../src/ExtruderTrain.h"
+#include "../src/Slice.h"
+#include "../src/settings/SettingDependencies.h" //The class under test.
+#include "../src/settings/SettingsRecorder.h"
+
+namespace cura
+{
+
+class SettingDependenciesTest : public testing::Test
+{
+public:
+    Settings mesh_settings;
+
+    void SetUp()
+    {
+        Application::getInstance().current_slice = new Slice(1);
+        Scene& scene = Application::getInstance().current_slice->scene;
+        scene.settings.add("layer_height", "0.1");
+        scene.settings.add("speed_print", "60");
+        scene.extruders.emplace_back(0, &scene.settings);
+        scene.extruders[0].settings.add("material_diameter", "2.85");
+        scene.current_mesh_group->settings.setParent(&scene.settings);
+        mesh_settings.setParent(&scene.current_mesh_group->settings);
+    }
+
+    void TearDown()
+    {
+        delete Application::getInstance().current_slice;
+        Application::getInstance().current_slice = nullptr;
+    }
+};
+
+TEST_F(SettingDependenciesTest, RecordsReads)
+{
+    const Scene& scene = Application::getInstance().current_slice->scene;
+    mesh_settings.add("infill_sparse_density", "20");
+
+    SettingsRecorder recorder;
+    mesh_settings.get<coord_t>("layer_height");
+    mesh_settings.get<double>("infill_sparse_density");
+    scene.extruders[0].settings.get<double>("material_diameter");
+
+    const std::set<std::pair<const Settings*, size_t>>& reads = recorder.getReads();
+    EXPECT_EQ(reads.size(), 3);
+    EXPECT_EQ(reads.count(std::make_pair(&mesh_settings, SettingKey("layer_height").getId())), 1) << "The read is recorded for the container it was asked from, not where the value was found.";
+    EXPECT_EQ(reads.count(std::make_pair(&mesh_settings, SettingKey("infill_sparse_density").getId())), 1);
+    EXPECT_EQ(reads.count(std::make_pair(&scene.extruders[0].settings, SettingKey("material_diameter").getId())), 1);
+}
+
+TEST_F(SettingDependenciesTest, NoRecordingOutsideRecorder)
+{
+    {
+        SettingsRecorder recorder;
+    }
+    SettingsRecorder recorder;
+    mesh_settings.get<coord_t>("layer_height");
+    EXPECT_EQ(recorder.getReads().size(), 1);
+}
+
+TEST_F(SettingDependenciesTest, MatchUnchanged)
+{
+    SettingDependencies dependencies;
+    {
+        SettingsRecorder recorder;
+        mesh_settings.get<coord_t>("layer_height");
+        ASSERT_TRUE(dependencies.record(recorder, mesh_settings));
+    }
+
+    //A new slice, with the same settings in new containers.
+    Settings new_mesh_settings;
+    new_mesh_settings.setParent(&Application::getInstance().current_slice->scene.current_mesh_group->settings);
+    EXPECT_TRUE(dependencies.match(new_mesh_settings));
+}
+
+TEST_F(SettingDependenciesTest, MatchIgnoresUnreadSettings)
+{
+    SettingDependencies dependencies;
+    {
+        SettingsRecorder recorder;
+        mesh_settings.get<coord_t>("layer_height");
+        ASSERT_TRUE(dependencies.record(recorder, mesh_settings));
+    }
+
+    Application::getInstance().current_slice->scene.settings.add("speed_print", "80");
+    EXPECT_TRUE(dependencies.match(mesh_settings)) << "Only the speed changed, which wasn't read.";
+}
+
+TEST_F(SettingDependenciesTest, MatchDetectsChangedSetting)
+{
+    SettingDependencies dependencies;
+    {
+        SettingsRecorder recorder;
+        mesh_settings.get<coord_t>("layer_height");
+        ASSERT_TRUE(dependencies.record(recorder, mesh_settings));
+    }
+
+    Settings new_mesh_settings;
+    new_mesh_settings.setParent(&Application::getInstance().current_slice->scene.current_mesh_group->settings);
+    new_mesh_settings.add("layer_height", "0.2");
+    EXPECT_FALSE(dependencies.match(new_mesh_settings)) << "The mesh overrides the setting that was read.";
+}
+
+TEST_F(SettingDependenciesTest, UnknownContainer)
+{
+    Settings other_settings;
+    other_settings.add("layer_height", "0.1");
+
+    SettingDependencies dependencies;
+    SettingsRecorder recorder;
+    other_settings.get<coord_t>("layer_height");
+    EXPECT_FALSE(dependencies.record(recorder, mesh_settings)) << "Settings of a container that isn't part of the scene can't be compared with a later slice.";
+}
+
+} //namespace cura
@@ -167,6 +167,12 @@ TEST_F(SettingsTest, AddSettingFlowTempGraph)
     double stored_temperature = flow_temp_graph.getTemp(30.5, 200.0, true);
     EXPECT_DOUBLE_EQ(75.0 + (100.10 - 75.0) * (30.5 - 26.5) / (50.0 - 26.5), stored_temperature) << "Interpolate between low and high value.";
 
+    stored_temperature = flow_temp_graph.getTemp(25.1, 200.0, true);
+    EXPECT_DOUBLE_EQ(40.4, stored_temperature) << "Flow exactly on a point of the graph - Return its temperature.";
+
+    stored_temperature = flow_temp_graph.getTemp(1.5, 200.0, true);
+    EXPECT_DOUBLE_EQ(10.1, stored_temperature) << "Flow exactly on the lowest point of the graph - Return its temperature.";
+
     stored_temperature = flow_temp_graph.getTemp(1, 200.0, true);
     EXPECT_DOUBLE_EQ(10.1, stored_temperature) << "Flow too low - Return lower temperature in the graph.";
 
@@ -213,6 +219,31 @@ TEST_F(SettingsTest, OverwriteSetting)
     ASSERT_EQ(settings.get<std::string>("test_setting"), std::string("NP"));
 }
 
+TEST_F(SettingsTest, OverwriteSettingTyped)
+{
+    settings.add("test_setting", "1.5");
+    ASSERT_DOUBLE_EQ(settings.get<double>("test_setting"), 1.5);
+    ASSERT_TRUE(settings.get<bool>("test_setting"));
+
+    settings.add("test_setting", "0");
+    EXPECT_DOUBLE_EQ(settings.get<double>("test_setting"), 0.0) << "The parsed value must be updated along with the string value.";
+    EXPECT_FALSE(settings.get<bool>("test_setting")) << "The parsed value must be updated along with the string value.";
+}
+
+TEST_F(SettingsTest, RuntimeSettingKey)
+{
+    const std::string name = std::string("test_") + "setting"; //Only known at runtime.
+    settings.add(name, "42");
+    EXPECT_EQ(SettingKey(name).getId(), SettingKey("test_setting").getId()) << "The same name must get the same ID, regardless of how the key was made.";
+    EXPECT_TRUE(settings.has("test_setting"));
+    EXPECT_EQ(size_t(42), settings.get<size_t>("test_setting"));
+    EXPECT_FALSE(settings.has(name + "_other"));
+
+    settings.add("test_setting_other", "3");
+    EXPECT_EQ(std::string("test_setting_other"), SettingKey::getName(SettingKey(name + "_other").getId()));
+    EXPECT_EQ(size_t(3), settings.get<size_t>(name + "_other"));
+}
+
 TEST_F(SettingsTest, Inheritance)
 {
     std::shared_ptr<Slice> current_slice = std::make_shared<Slice>(0);
@@ -241,7 +272,7 @@ TEST_F(SettingsTest, LimitToExtruder)
     //Add a setting to the extruder this is limiting to.
     const std::string limit_extruder_value = "I was gonna tell a time travelling joke but you didn't like it.";
     current_slice->scene.extruders[2].settings.add("test_setting", limit_extruder_value);
-    current_slice->scene.limit_to_extruder.emplace("test_setting", &current_slice->scene.extruders[2]);
+    current_slice->scene.limit_to_extruder.emplace(SettingKey("test_setting").getId(), &current_slice->scene.extruders[2]);
 
     //Add a decoy setting to the main scene to make sure that we aren't getting the global setting instead.
     current_slice->scene.settings.add("test_setting", "Sting has been kidnapped. The Police have no lead.");
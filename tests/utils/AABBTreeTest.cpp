@@ -0,0 +1,80 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/AABBTree.h"
+
+namespace cura
+{
+
+TEST(AABBTreeTest, Empty)
+{
+    const AABBTree tree;
+    EXPECT_EQ(0, tree.size());
+
+    std::vector<size_t> result = {3};
+    tree.findOverlapping(AABB(Point(0, 0), Point(100, 100)), result);
+    EXPECT_TRUE(result.empty()) << "The result is cleared first.";
+}
+
+TEST(AABBTreeTest, FewBoxes)
+{
+    const std::vector<AABB> boxes = {
+        AABB(Point(0, 0), Point(10, 10)),
+        AABB(Point(20, 0), Point(30, 10)),
+        AABB(Point(5, 5), Point(25, 25))
+    };
+    const AABBTree tree(boxes);
+    EXPECT_EQ(3, tree.size());
+
+    std::vector<size_t> result;
+    tree.findOverlapping(AABB(Point(8, 8), Point(9, 9)), result);
+    EXPECT_EQ(std::vector<size_t>({0, 2}), result);
+
+    tree.findOverlapping(AABB(Point(100, 100), Point(200, 200)), result);
+    EXPECT_TRUE(result.empty());
+
+    tree.findOverlapping(AABB(Point(-10, -10), Point(100, 100)), result);
+    EXPECT_EQ(std::vector<size_t>({0, 1, 2}), result);
+}
+
+TEST(AABBTreeTest, ManyBoxesLikeBruteForce)
+{
+    std::vector<AABB> boxes;
+    for (coord_t x = 0; x < 20; x++)
+    {
+        for (coord_t y = 0; y < 20; y++)
+        {
+            const coord_t size = 50 + (x * 7 + y * 13) % 200; //Boxes of different sizes that partly overlap.
+            boxes.emplace_back(Point(x * 100, y * 100), Point(x * 100 + size, y * 100 + size));
+        }
+    }
+    const AABBTree tree(boxes);
+    ASSERT_EQ(boxes.size(), tree.size());
+
+    const std::vector<AABB> queries = {
+        AABB(Point(0, 0), Point(0, 0)),
+        AABB(Point(450, 450), Point(460, 460)),
+        AABB(Point(-100, 1000), Point(3000, 1010)),
+        AABB(Point(1234, 567), Point(1789, 1345)),
+        AABB(Point(5000, 5000), Point(6000, 6000))
+    };
+    for (const AABB& query : queries)
+    {
+        std::vector<size_t> expected;
+        for (size_t box_idx = 0; box_idx < boxes.size(); box_idx++)
+        {
+            if (boxes[box_idx].hit(query))
+            {
+                expected.push_back(box_idx);
+            }
+        }
+        std::vector<size_t> result;
+        tree.findOverlapping(query, result);
+        EXPECT_EQ(expected, result) << "The tree must find the same boxes as checking each of them, in the same order.";
+    }
+}
+
+}
@@ -0,0 +1,101 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For remove.
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+#include "../src/utils/AsyncFileStream.h"
+
+namespace cura
+{
+
+class AsyncFileStreamTest : public ::testing::Test
+{
+public:
+    std::string filename;
+
+    void SetUp() override
+    {
+        filename = "AsyncFileStreamTest.gcode"; //In the working directory of the test.
+    }
+
+    void TearDown() override
+    {
+        std::remove(filename.c_str());
+    }
+
+    /*!
+     * Read the file that was written.
+     */
+    std::string read() const
+    {
+        std::ifstream file(filename);
+        std::ostringstream result;
+        result << file.rdbuf();
+        return result.str();
+    }
+};
+
+TEST_F(AsyncFileStreamTest, Empty)
+{
+    AsyncFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    EXPECT_TRUE(stream.close());
+
+    EXPECT_EQ(std::string(""), read());
+}
+
+TEST_F(AsyncFileStreamTest, MultipleBlocks)
+{
+    // Much more data than fits in all blocks together, so that writing to the stream has to wait for the file.
+    std::ostringstream expected;
+    AsyncFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    for (int line_idx = 0; line_idx < 500000; line_idx++)
+    {
+        expected << "G1 X" << line_idx % 1000 << " Y" << line_idx / 1000 << " E" << line_idx << "\n";
+        stream << "G1 X" << line_idx % 1000 << " Y" << line_idx / 1000 << " E" << line_idx << "\n";
+    }
+    EXPECT_TRUE(stream.close());
+
+    EXPECT_EQ(expected.str(), read());
+}
+
+TEST_F(AsyncFileStreamTest, FlushWritesData)
+{
+    AsyncFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    stream << ";FLAVOR:Marlin\n";
+    stream.flush();
+
+    EXPECT_EQ(std::string(";FLAVOR:Marlin\n"), read()) << "Everything written before the flush should be in the file, even though the file isn't closed yet.";
+
+    stream << "M107\n";
+    EXPECT_TRUE(stream.close());
+    EXPECT_EQ(std::string(";FLAVOR:Marlin\nM107\n"), read());
+}
+
+TEST_F(AsyncFileStreamTest, SeekBackToOverwrite)
+{
+    AsyncFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    stream << ";TIME:6666\n";
+    const std::streampos end_of_header = stream.tellp();
+    ASSERT_NE(std::streampos(-1), end_of_header);
+    stream << "M107\n";
+
+    const std::streampos end = stream.tellp();
+    ASSERT_TRUE(static_cast<bool>(stream.seekp(0)));
+    stream << ";TIME:1337\n";
+    EXPECT_EQ(end_of_header, stream.tellp());
+    ASSERT_TRUE(static_cast<bool>(stream.seekp(end)));
+    stream << "M84\n";
+    EXPECT_TRUE(stream.close());
+
+    EXPECT_EQ(std::string(";TIME:1337\nM107\nM84\n"), read());
+}
+
+} //namespace cura
@@ -0,0 +1,74 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <limits>
+
+#include "../src/utils/BinaryBuffer.h"
+
+namespace cura
+{
+
+TEST(BinaryBufferTest, RoundTrip)
+{
+    BinaryWriter writer;
+    writer.writeUnsigned(0);
+    writer.writeUnsigned(127);
+    writer.writeUnsigned(128);
+    writer.writeUnsigned(std::numeric_limits<uint64_t>::max());
+    writer.writeSigned(-1);
+    writer.writeSigned(std::numeric_limits<int64_t>::min());
+    writer.writeSigned(std::numeric_limits<int64_t>::max());
+    writer.writeString("layer_height");
+    writer.writeString("");
+
+    BinaryReader reader(writer.getData());
+    uint64_t unsigned_value;
+    int64_t signed_value;
+    std::string string_value;
+    ASSERT_TRUE(reader.readUnsigned(unsigned_value));
+    EXPECT_EQ(unsigned_value, 0);
+    ASSERT_TRUE(reader.readUnsigned(unsigned_value));
+    EXPECT_EQ(unsigned_value, 127);
+    ASSERT_TRUE(reader.readUnsigned(unsigned_value));
+    EXPECT_EQ(unsigned_value, 128);
+    ASSERT_TRUE(reader.readUnsigned(unsigned_value));
+    EXPECT_EQ(unsigned_value, std::numeric_limits<uint64_t>::max());
+    ASSERT_TRUE(reader.readSigned(signed_value));
+    EXPECT_EQ(signed_value, -1);
+    ASSERT_TRUE(reader.readSigned(signed_value));
+    EXPECT_EQ(signed_value, std::numeric_limits<int64_t>::min());
+    ASSERT_TRUE(reader.readSigned(signed_value));
+    EXPECT_EQ(signed_value, std::numeric_limits<int64_t>::max());
+    ASSERT_TRUE(reader.readString(string_value));
+    EXPECT_EQ(string_value, "layer_height");
+    ASSERT_TRUE(reader.readString(string_value));
+    EXPECT_EQ(string_value, "");
+    EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(BinaryBufferTest, SmallNumbersAreShort)
+{
+    BinaryWriter writer;
+    writer.writeUnsigned(100);
+    writer.writeSigned(-50);
+    EXPECT_EQ(writer.getData().size(), 2);
+}
+
+TEST(BinaryBufferTest, TruncatedData)
+{
+    BinaryWriter writer;
+    writer.writeString("meshfix_maximum_resolution");
+    const std::string truncated = writer.getData().substr(0, 10);
+
+    BinaryReader reader(truncated);
+    std::string value;
+    EXPECT_FALSE(reader.readString(value));
+
+    const std::string unfinished_number(1, static_cast<char>(0x80));
+    BinaryReader number_reader(unfinished_number);
+    uint64_t number;
+    EXPECT_FALSE(number_reader.readUnsigned(number));
+}
+
+} //namespace cura
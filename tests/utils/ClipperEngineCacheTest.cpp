@@ -0,0 +1,58 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/ClipperEngineCache.h"
+
+namespace cura
+{
+
+TEST(ClipperEngineCacheTest, ReusesEngineOfThread)
+{
+    ClipperLib::Clipper* first;
+    {
+        CachedClipper clipper;
+        first = &*clipper;
+    }
+    CachedClipper clipper;
+    EXPECT_EQ(first, &*clipper) << "After the engine is released, the next operation on the same thread should get it again.";
+}
+
+TEST(ClipperEngineCacheTest, NestedUseGetsSeparateEngine)
+{
+    CachedClipper outer;
+    CachedClipper inner;
+    EXPECT_NE(&*outer, &*inner) << "An engine that is still in use must not be handed out again.";
+}
+
+TEST(ClipperEngineCacheTest, ReusedEngineIsCleared)
+{
+    const ClipperLib::Path square = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+    {
+        CachedClipper clipper;
+        clipper->AddPath(square, ClipperLib::ptSubject, true);
+        clipper->ReverseSolution(true);
+    }
+    CachedClipper clipper;
+    EXPECT_FALSE(clipper->ReverseSolution()) << "Options of the previous operation must be reset.";
+    ClipperLib::Paths result;
+    clipper->Execute(ClipperLib::ctUnion, result);
+    EXPECT_TRUE(result.empty()) << "Paths of the previous operation must have been cleared.";
+}
+
+TEST(ClipperEngineCacheTest, OffsetEngineUsesGivenLimits)
+{
+    {
+        CachedClipperOffset clipper(3.0, 5.0);
+        clipper->AddPath({{0, 0}, {100, 0}, {100, 100}, {0, 100}}, ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+    }
+    CachedClipperOffset clipper(1.2, 10.0);
+    EXPECT_EQ(clipper->MiterLimit, 1.2);
+    EXPECT_EQ(clipper->ArcTolerance, 10.0);
+    ClipperLib::Paths result;
+    clipper->Execute(result, 10);
+    EXPECT_TRUE(result.empty()) << "Paths of the previous operation must have been cleared.";
+}
+
+}
@@ -0,0 +1,110 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/ConcurrentLRUCache.h"
+
+namespace cura
+{
+
+TEST(ConcurrentLRUCacheTest, ComputesOnce)
+{
+    ConcurrentLRUCache<int, int> cache(1000, [](const int&) { return size_t(1); });
+    int computed = 0;
+    const std::function<int ()> compute = [&computed]()
+    {
+        computed++;
+        return 42;
+    };
+    EXPECT_EQ(*cache.get(5, compute), 42);
+    EXPECT_EQ(*cache.get(5, compute), 42);
+    EXPECT_EQ(computed, 1) << "The second lookup must come from the cache.";
+    EXPECT_TRUE(cache.contains(5));
+    EXPECT_FALSE(cache.contains(6));
+}
+
+TEST(ConcurrentLRUCacheTest, EvictsLeastRecentlyUsed)
+{
+    constexpr size_t shard_count = 1;
+    ConcurrentLRUCache<int, int> cache(2, [](const int&) { return size_t(1); }, shard_count); //Only two values fit.
+    cache.get(1, []() { return 1; });
+    cache.get(2, []() { return 2; });
+    cache.get(1, []() { return 1; }); //Now 2 is the least recently used.
+    const std::shared_ptr<const int> three = cache.get(3, []() { return 3; });
+
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2)) << "The least recently used value must be dropped.";
+    EXPECT_TRUE(cache.contains(3)) << "The value that was just computed must stay.";
+    EXPECT_EQ(*three, 3);
+}
+
+TEST(ConcurrentLRUCacheTest, EvictedValueStaysAlive)
+{
+    constexpr size_t shard_count = 1;
+    ConcurrentLRUCache<int, int> cache(1, [](const int&) { return size_t(1); }, shard_count);
+    const std::shared_ptr<const int> one = cache.get(1, []() { return 1; });
+    cache.get(2, []() { return 2; });
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_EQ(*one, 1) << "Whoever holds on to a value can keep using it after it's dropped.";
+}
+
+TEST(ConcurrentLRUCacheTest, EvictsWhenMemoryBudgetIsExceeded)
+{
+    MemoryBudget& budget = MemoryBudget::getInstance();
+    budget.setLimit(250);
+    {
+        constexpr size_t shard_count = 1;
+        ConcurrentLRUCache<int, int> cache(1000, [](const int&) { return size_t(100); }, shard_count); //Ten values fit in the cache, but only two in the budget.
+        cache.trackMemory(MemoryAccount::LAYER_OUTLINES);
+        cache.get(1, []() { return 1; });
+        cache.get(2, []() { return 2; });
+        EXPECT_EQ(budget.get(MemoryAccount::LAYER_OUTLINES), 200);
+        cache.get(3, []() { return 3; });
+
+        EXPECT_FALSE(cache.contains(1)) << "The least recently used value must be dropped to stay within the budget.";
+        EXPECT_TRUE(cache.contains(2));
+        EXPECT_TRUE(cache.contains(3));
+        EXPECT_EQ(budget.get(MemoryAccount::LAYER_OUTLINES), 200);
+        EXPECT_EQ(budget.getPeakTotal(), 300) << "The budget was exceeded until the value was dropped.";
+    }
+    EXPECT_EQ(budget.get(MemoryAccount::LAYER_OUTLINES), 0) << "Destroying the cache must give back its memory.";
+    budget.reset();
+}
+
+TEST(ConcurrentLRUCacheTest, ComputationMayLookUpOtherKeys)
+{
+    ConcurrentLRUCache<int, int> cache(1000, [](const int&) { return size_t(1); });
+    std::function<int (int)> sum_to = [&cache, &sum_to](int n) -> int
+    {
+        return *cache.get(n, [&sum_to, n]() { return n == 0 ? 0 : n + sum_to(n - 1); });
+    };
+    EXPECT_EQ(sum_to(50), 1275);
+}
+
+TEST(ConcurrentLRUCacheTest, ConcurrentLookupsComputeOnce)
+{
+    ConcurrentLRUCache<int, int> cache(1000, [](const int&) { return size_t(1); });
+    std::atomic<int> computed(0);
+    std::vector<std::thread> threads;
+    for (int thread_idx = 0; thread_idx < 8; thread_idx++)
+    {
+        threads.emplace_back([&cache, &computed]()
+        {
+            for (int key = 0; key < 100; key++)
+            {
+                EXPECT_EQ(*cache.get(key, [&computed, key]() { computed++; return key * 2; }), key * 2);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(computed, 100) << "Every key must be computed exactly once, regardless of how many threads ask for it.";
+}
+
+} //namespace cura
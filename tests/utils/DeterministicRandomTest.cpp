@@ -0,0 +1,50 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/DeterministicRandom.h"
+
+namespace cura
+{
+
+TEST(DeterministicRandomTest, SameSeedSameSequence)
+{
+    DeterministicRandom first(42);
+    DeterministicRandom second(42);
+    for (size_t i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(first.next(), second.next()) << "Generators with the same seed must give the same numbers.";
+    }
+}
+
+TEST(DeterministicRandomTest, DifferentSeedDifferentSequence)
+{
+    DeterministicRandom first(1);
+    DeterministicRandom second(2);
+    size_t equal_count = 0;
+    for (size_t i = 0; i < 100; i++)
+    {
+        equal_count += first.next() == second.next();
+    }
+    EXPECT_EQ(equal_count, 0) << "Generators with different seeds should give different numbers.";
+}
+
+TEST(DeterministicRandomTest, BelowStaysInRange)
+{
+    DeterministicRandom random(7);
+    bool seen[10] = {};
+    for (size_t i = 0; i < 1000; i++)
+    {
+        const int64_t value = random.below(10);
+        ASSERT_GE(value, 0);
+        ASSERT_LT(value, 10);
+        seen[value] = true;
+    }
+    for (size_t value = 0; value < 10; value++)
+    {
+        EXPECT_TRUE(seen[value]) << "Every value in the range should come up eventually.";
+    }
+}
+
+} //namespace cura
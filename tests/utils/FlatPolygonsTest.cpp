@@ -0,0 +1,86 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/FlatPolygons.h" //The class under test.
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class FlatPolygonsTest : public ::testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        polygons.clear();
+        PolygonRef square = polygons.newPoly();
+        square.emplace_back(0, 0);
+        square.emplace_back(1000, 0);
+        square.emplace_back(1000, 1000);
+        square.emplace_back(0, 1000);
+        polygons.newPoly(); //An empty polygon in between.
+        polygons.addLine(Point(-500, 200), Point(300, -700));
+    }
+};
+
+TEST_F(FlatPolygonsTest, Empty)
+{
+    const FlatPolygons flat;
+    EXPECT_EQ(flat.size(), 0);
+    EXPECT_EQ(flat.pointCount(), 0);
+    EXPECT_EQ(flat.toPolygons().size(), 0);
+}
+
+TEST_F(FlatPolygonsTest, SamePoints)
+{
+    const FlatPolygons flat(polygons);
+    ASSERT_EQ(flat.size(), polygons.size());
+    EXPECT_EQ(flat.pointCount(), polygons.pointCount());
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        ASSERT_EQ(flat[poly_idx].size(), polygons[poly_idx].size()) << "Polygon " << poly_idx << " must have the same number of points.";
+        for (size_t point_idx = 0; point_idx < polygons[poly_idx].size(); point_idx++)
+        {
+            EXPECT_EQ(flat[poly_idx][point_idx], polygons[poly_idx][point_idx]);
+        }
+    }
+    EXPECT_TRUE(flat[1].empty());
+}
+
+TEST_F(FlatPolygonsTest, PointsAreContiguous)
+{
+    const FlatPolygons flat(polygons);
+    EXPECT_EQ(flat[0].end(), flat[1].begin());
+    EXPECT_EQ(flat[1].end(), flat[2].begin()) << "The empty polygon takes no space.";
+    EXPECT_EQ(flat[2].end() - flat[0].begin(), static_cast<long>(polygons.pointCount()));
+}
+
+TEST_F(FlatPolygonsTest, RoundTrip)
+{
+    const Polygons result = FlatPolygons(polygons).toPolygons();
+    ASSERT_EQ(result.size(), polygons.size());
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        EXPECT_EQ(*result[poly_idx], *polygons[poly_idx]) << "Polygon " << poly_idx << " must be the same after converting back.";
+    }
+}
+
+TEST_F(FlatPolygonsTest, AddAfterClear)
+{
+    FlatPolygons flat(polygons);
+    flat.clear();
+    EXPECT_EQ(flat.size(), 0);
+    EXPECT_EQ(flat.pointCount(), 0);
+
+    flat.add(polygons[2]);
+    ASSERT_EQ(flat.size(), 1);
+    ASSERT_EQ(flat[0].size(), 2);
+    EXPECT_EQ(flat[0][0], Point(-500, 200));
+    EXPECT_EQ(flat[0][1], Point(300, -700));
+}
+
+} //namespace cura
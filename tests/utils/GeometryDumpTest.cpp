@@ -0,0 +1,92 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For remove.
+#include <gtest/gtest.h>
+
+#include "../src/utils/GeometryDump.h" //The unit under test.
+
+namespace cura
+{
+
+class GeometryDumpTest : public ::testing::Test
+{
+public:
+    std::string filename;
+
+    void SetUp() override
+    {
+        filename = "GeometryDumpTest.dump"; //In the working directory of the test.
+    }
+
+    void TearDown() override
+    {
+        GeometryDump::getInstance().finish();
+        std::remove(filename.c_str());
+    }
+};
+
+TEST_F(GeometryDumpTest, RoundTrip)
+{
+    GeometryDump& dump = GeometryDump::getInstance();
+    ASSERT_TRUE(dump.start(filename, "", ""));
+    Polygons square;
+    PolygonRef square_poly = square.newPoly();
+    square_poly.add(Point(-100, -100));
+    square_poly.add(Point(100, -100));
+    square_poly.add(Point(100, 100));
+    square_poly.add(Point(-100, 100));
+    Polygons empty;
+    dump.dump("walls", -2, "wall_0", square);
+    dump.dump("infill", 5, "", empty);
+    ASSERT_TRUE(dump.finish());
+
+    std::vector<GeometryDump::Record> records;
+    ASSERT_TRUE(GeometryDump::read(filename, records));
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].stage, "walls");
+    EXPECT_EQ(records[0].layer_nr, -2);
+    EXPECT_EQ(records[0].name, "wall_0");
+    ASSERT_EQ(records[0].polygons.size(), 1);
+    EXPECT_EQ(records[0].polygons[0].size(), 4);
+    for (size_t point_idx = 0; point_idx < 4; point_idx++)
+    {
+        EXPECT_EQ(records[0].polygons[0][point_idx], square[0][point_idx]);
+    }
+    EXPECT_EQ(records[1].stage, "infill");
+    EXPECT_EQ(records[1].layer_nr, 5);
+    EXPECT_EQ(records[1].polygons.size(), 0);
+}
+
+TEST_F(GeometryDumpTest, Selection)
+{
+    GeometryDump& dump = GeometryDump::getInstance();
+    EXPECT_FALSE(dump.isDumping("walls", 0)) << "Nothing is dumped before the dump is started.";
+    ASSERT_TRUE(dump.start(filename, "0, 10-12", "walls,skin"));
+
+    EXPECT_TRUE(dump.isDumping("walls", 0));
+    EXPECT_TRUE(dump.isDumping("skin", 11));
+    EXPECT_TRUE(dump.isDumping("skin", 12));
+    EXPECT_FALSE(dump.isDumping("walls", 1)) << "Layer 1 isn't selected.";
+    EXPECT_FALSE(dump.isDumping("walls", 13)) << "Layer 13 is after the selected range.";
+    EXPECT_FALSE(dump.isDumping("infill", 0)) << "The infill stage isn't selected.";
+
+    ASSERT_TRUE(dump.finish());
+    EXPECT_FALSE(dump.isDumping("walls", 0)) << "Nothing is dumped after the dump is finished.";
+}
+
+TEST_F(GeometryDumpTest, ParseLayers)
+{
+    std::vector<std::pair<LayerIndex, LayerIndex>> ranges;
+    ASSERT_TRUE(GeometryDump::parseLayers("-1,3, 5-7", ranges));
+    ASSERT_EQ(ranges.size(), 3);
+    EXPECT_EQ(ranges[0], std::make_pair(LayerIndex(-1), LayerIndex(-1))) << "A dash at the start is a negative layer, such as a raft layer.";
+    EXPECT_EQ(ranges[1], std::make_pair(LayerIndex(3), LayerIndex(3)));
+    EXPECT_EQ(ranges[2], std::make_pair(LayerIndex(5), LayerIndex(7)));
+
+    EXPECT_FALSE(GeometryDump::parseLayers("walls", ranges));
+    EXPECT_FALSE(GeometryDump::parseLayers("3x", ranges));
+    EXPECT_FALSE(GeometryDump::parseLayers("7-5", ranges)) << "The range ends before it starts.";
+}
+
+} //namespace cura
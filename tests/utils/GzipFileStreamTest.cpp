@@ -0,0 +1,95 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#ifdef GZIP
+
+#include <cstdio> //For remove.
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <zlib.h>
+
+#include "../src/utils/GzipFileStream.h"
+
+namespace cura
+{
+
+class GzipFileStreamTest : public ::testing::Test
+{
+public:
+    std::string filename;
+
+    void SetUp() override
+    {
+        filename = "GzipFileStreamTest.gcode.gz"; //In the working directory of the test.
+    }
+
+    void TearDown() override
+    {
+        std::remove(filename.c_str());
+    }
+
+    /*!
+     * Decompress the file that was written.
+     */
+    std::string decompress() const
+    {
+        gzFile file = gzopen(filename.c_str(), "rb");
+        if (!file)
+        {
+            return "";
+        }
+        std::string result;
+        char buffer[4096];
+        int read_count;
+        while ((read_count = gzread(file, buffer, sizeof(buffer))) > 0)
+        {
+            result.append(buffer, read_count);
+        }
+        gzclose(file);
+        return result;
+    }
+};
+
+TEST_F(GzipFileStreamTest, Empty)
+{
+    GzipFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    EXPECT_TRUE(stream.close());
+
+    EXPECT_EQ(std::string(""), decompress());
+}
+
+TEST_F(GzipFileStreamTest, MultipleBuffers)
+{
+    // Much more data than fits in one buffer, so that it's compressed while more data is being written.
+    std::ostringstream expected;
+    GzipFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    for (int line_idx = 0; line_idx < 300000; line_idx++)
+    {
+        expected << "G1 X" << line_idx % 1000 << " Y" << line_idx / 1000 << " E" << line_idx << "\n";
+        stream << "G1 X" << line_idx % 1000 << " Y" << line_idx / 1000 << " E" << line_idx << "\n";
+    }
+    EXPECT_TRUE(stream.close());
+
+    EXPECT_EQ(expected.str(), decompress());
+}
+
+TEST_F(GzipFileStreamTest, FlushMakesDataReadable)
+{
+    GzipFileStream stream;
+    ASSERT_TRUE(stream.open(filename.c_str()));
+    stream << ";FLAVOR:Marlin\n";
+    stream.flush();
+
+    EXPECT_EQ(std::string(";FLAVOR:Marlin\n"), decompress()) << "Everything written before the flush should be readable, even though the file isn't closed yet.";
+
+    stream << "M107\n";
+    EXPECT_TRUE(stream.close());
+    EXPECT_EQ(std::string(";FLAVOR:Marlin\nM107\n"), decompress());
+}
+
+} //namespace cura
+
+#endif //GZIP
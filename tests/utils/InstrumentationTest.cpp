@@ -0,0 +1,155 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+
+#include "../src/utils/Instrumentation.h" //The class under test.
+#include "../src/utils/polygon.h" //To count the operations on polygons.
+
+namespace cura
+{
+
+#ifdef INSTRUMENTATION
+
+/*!
+ * A sink that keeps the events, so that they can be checked.
+ */
+class KeepingSink : public InstrumentationSink
+{
+public:
+    KeepingSink(std::vector<Instrumentation::Event>& kept_events)
+    : kept_events(kept_events)
+    {
+    }
+
+    void write(const std::vector<Instrumentation::Event>& events) override
+    {
+        kept_events = events;
+    }
+
+    std::vector<Instrumentation::Event>& kept_events;
+};
+
+TEST(InstrumentationTest, DisabledRecordsNothing)
+{
+    EXPECT_FALSE(Instrumentation::getInstance().isEnabled()) << "Nothing should be recorded without sinks.";
+    {
+        const ScopedTimer timer("stage");
+        ScopedTimer::count("things");
+    }
+
+    std::vector<Instrumentation::Event> events;
+    Instrumentation::getInstance().addSink(std::unique_ptr<InstrumentationSink>(new KeepingSink(events)));
+    Instrumentation::getInstance().finish();
+    EXPECT_TRUE(events.empty()) << "The stage was timed before there was a sink.";
+}
+
+TEST(InstrumentationTest, NestedStages)
+{
+    std::vector<Instrumentation::Event> events;
+    Instrumentation::getInstance().addSink(std::unique_ptr<InstrumentationSink>(new KeepingSink(events)));
+    {
+        const ScopedTimer outer_timer("outer");
+        ScopedTimer::count("things", 2);
+        for (int layer_nr = 0; layer_nr < 3; layer_nr++)
+        {
+            const ScopedTimer inner_timer("inner", layer_nr);
+            ScopedTimer::count("things");
+            ScopedTimer::count("other_things", 5);
+        }
+        ScopedTimer::count("things");
+    }
+    Instrumentation::getInstance().finish();
+    EXPECT_FALSE(Instrumentation::getInstance().isEnabled()) << "Finishing should stop recording.";
+
+    ASSERT_EQ(events.size(), 4) << "Three inner stages and one outer stage.";
+    for (int layer_nr = 0; layer_nr < 3; layer_nr++)
+    {
+        const Instrumentation::Event& inner = events[layer_nr];
+        EXPECT_EQ(std::string(inner.name), "inner");
+        EXPECT_EQ(inner.layer_nr, layer_nr);
+        ASSERT_EQ(inner.counters.size(), 2);
+        EXPECT_EQ(inner.counters[0].second, 1);
+        EXPECT_EQ(inner.counters[1].second, 5);
+        EXPECT_GE(inner.wall_time, 0);
+    }
+    const Instrumentation::Event& outer = events.back();
+    EXPECT_EQ(std::string(outer.name), "outer");
+    EXPECT_EQ(outer.layer_nr, -1);
+    ASSERT_EQ(outer.counters.size(), 1) << "The work counted in the inner stages only counts for them.";
+    EXPECT_EQ(outer.counters[0].second, 3);
+    EXPECT_LE(outer.start, events[0].start) << "The outer stage started before the inner stages.";
+}
+
+TEST(InstrumentationTest, ClipperOperations)
+{
+    Polygon square_polygon;
+    square_polygon.add(Point(0, 0));
+    square_polygon.add(Point(1000, 0));
+    square_polygon.add(Point(1000, 1000));
+    square_polygon.add(Point(0, 1000));
+    Polygons square;
+    square.add(square_polygon);
+    Polygons shifted = square;
+    shifted.translate(Point(500, 500));
+
+    std::vector<Instrumentation::Event> events;
+    Instrumentation::getInstance().addSink(std::unique_ptr<InstrumentationSink>(new KeepingSink(events)));
+    {
+        const ScopedTimer timer("stage", 3);
+        const Polygons difference = square.difference(shifted);
+        EXPECT_EQ(difference.pointCount(), 6);
+    }
+    Instrumentation::getInstance().finish();
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events[0].layer_nr, 3) << "The operations are counted in the layer of the stage.";
+    std::map<std::string, int64_t> counters;
+    for (const std::pair<const char*, int64_t>& counter : events[0].counters)
+    {
+        counters[counter.first] += counter.second;
+    }
+    EXPECT_EQ(counters["clipper_difference"], 1);
+    EXPECT_EQ(counters["clipper_points_in"], 8) << "Both squares go in.";
+    EXPECT_EQ(counters["clipper_points_out"], 6) << "An L-shape comes out.";
+    EXPECT_GE(counters["clipper_microseconds"], 0);
+}
+
+#endif //INSTRUMENTATION
+
+TEST(InstrumentationTest, SlowestLayers)
+{
+    std::vector<Instrumentation::Event> events;
+    const auto add_event = [&events](const char* name, const int layer_nr, const double cpu_time, const int64_t things)
+    {
+        events.emplace_back();
+        events.back().name = name;
+        events.back().layer_nr = layer_nr;
+        events.back().wall_time = 1.0; //Ignored in favour of the CPU time.
+        events.back().cpu_time = cpu_time;
+        events.back().counters.emplace_back("things", things);
+    };
+    add_event("walls", 0, 0.1, 1);
+    add_event("walls", 1, 0.3, 2);
+    add_event("skin", 1, 0.2, 3);
+    add_event("walls", 2, 0.4, 4);
+    add_event("walls", 1, 0.1, 5);
+    add_event("whole_slice", -1, 10.0, 6);
+
+    const std::vector<SlowestLayersSink::LayerCost> layers = SlowestLayersSink::getSlowestLayers(events, 2);
+    ASSERT_EQ(layers.size(), 2);
+    EXPECT_EQ(layers[0].layer_nr, 1) << "The stages of a layer add up, and stages that aren't about a layer don't count.";
+    EXPECT_NEAR(layers[0].time, 0.6, 1e-9);
+    ASSERT_EQ(layers[0].stage_times.size(), 2);
+    EXPECT_EQ(layers[0].stage_times[0].first, "walls");
+    EXPECT_NEAR(layers[0].stage_times[0].second, 0.4, 1e-9);
+    ASSERT_EQ(layers[0].counters.size(), 1);
+    EXPECT_EQ(layers[0].counters[0].second, 10);
+    EXPECT_EQ(layers[1].layer_nr, 2);
+
+    EXPECT_EQ(SlowestLayersSink::getSlowestLayers(events, 10).size(), 3) << "There are only three layers.";
+}
+
+} //namespace cura
@@ -0,0 +1,62 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "../src/utils/LazyInitialization.h"
+
+namespace cura
+{
+
+TEST(LazyInitializationMapTest, InitializesOnce)
+{
+    LazyInitializationMap<int, int> map;
+    int initialized = 0;
+    const std::function<int ()> initialize = [&initialized]()
+    {
+        initialized++;
+        return 42;
+    };
+    const int& first = map.get(5, initialize);
+    const int& second = map.get(5, initialize);
+    EXPECT_EQ(first, 42);
+    EXPECT_EQ(&first, &second) << "Both lookups must refer to the same value.";
+    EXPECT_EQ(initialized, 1) << "The second lookup must not initialize the value again.";
+    EXPECT_EQ(map.get(6, []() { return 6; }), 6) << "Other keys have their own value.";
+}
+
+TEST(LazyInitializationMapTest, CopyIsEmpty)
+{
+    LazyInitializationMap<int, int> map;
+    map.get(1, []() { return 1; });
+    LazyInitializationMap<int, int> copy(map);
+    EXPECT_EQ(copy.get(1, []() { return 2; }), 2) << "The copy must initialize its values by itself.";
+    EXPECT_EQ(map.get(1, []() { return 3; }), 1) << "The original must keep its values.";
+}
+
+TEST(LazyInitializationMapTest, ConcurrentLookupsInitializeOnce)
+{
+    LazyInitializationMap<int, int> map;
+    std::atomic<int> initialized(0);
+    std::vector<std::thread> threads;
+    for (int thread_idx = 0; thread_idx < 8; thread_idx++)
+    {
+        threads.emplace_back([&map, &initialized]()
+        {
+            for (int key = 0; key < 100; key++)
+            {
+                EXPECT_EQ(map.get(key, [&initialized, key]() { initialized++; return key * 2; }), key * 2);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(initialized, 100) << "Every key must be initialized exactly once, regardless of how many threads ask for it.";
+}
+
+} //namespace cura
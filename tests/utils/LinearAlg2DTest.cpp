@@ -94,10 +94,23 @@ INSTANTIATE_TEST_CASE_P(GetDist2FromLineSegmentInstantiation, GetDist2FromLineSe
     GetDist2FromLineSegmentParameters(Point(0, 0), Point(100, 50), Point(-3, 0), 9, -1), //In a corner near a diagonal line.
     GetDist2FromLineSegmentParameters(Point(0, 0), Point(100, 50), Point(-2, 4), 20, 0), //Perpendicular to a diagonal line.
     GetDist2FromLineSegmentParameters(Point(0, 0), Point(10000, 5000), Point(2000, 3000), 3200000, 0), //Longer distances.
+    GetDist2FromLineSegmentParameters(Point(-3000000, 0), Point(3000000, 3000000), Point(1000000, 1000000), 800000000000, 0), //Lengths whose squares overflow 64 bits when multiplied.
     GetDist2FromLineSegmentParameters(Point(0, 0), Point(0, 0), Point(20, 0), 400, 0), //Near a line of length 0.
     GetDist2FromLineSegmentParameters(Point(0, 0), Point(0, 0), Point(0, 0), 0, 0) //On a line of length 0.
 ));
 
+TEST(GetClosestOnLineSegmentTest, LongDiagonalLine)
+{
+    //The product of the projected length and the direction doesn't fit in 64 bits here.
+    const Point closest = LinearAlg2D::getClosestOnLineSegment(Point(1000000, 1000000), Point(-3000000, 0), Point(3000000, 3000000));
+    EXPECT_EQ(closest, Point(600000, 1800000));
+}
+
+TEST(GetDist2FromLineTest, LongDiagonalLine)
+{
+    EXPECT_EQ(LinearAlg2D::getDist2FromLine(Point(1000000, 1000000), Point(-3000000, 0), Point(3000000, 3000000)), 800000000000);
+}
+
 struct GetAngleParameters
 {
     Point a;
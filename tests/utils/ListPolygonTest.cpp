@@ -0,0 +1,79 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/ListPolygon.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * \brief Get the points of a list polygon in order, to compare them at once.
+ */
+static std::vector<Point> points(const ListPolygon& polygon)
+{
+    return std::vector<Point>(polygon.begin(), polygon.end());
+}
+
+TEST(ListPolygonTest, Empty)
+{
+    const ListPolygon polygon;
+    EXPECT_TRUE(polygon.empty());
+    EXPECT_EQ(size_t(0), polygon.size());
+    EXPECT_TRUE(polygon.begin() == polygon.end());
+}
+
+TEST(ListPolygonTest, InsertAndErase)
+{
+    ListPolygon polygon;
+    polygon.push_back(Point(0, 0));
+    polygon.push_back(Point(100, 0));
+    polygon.push_back(Point(100, 100));
+    ListPolygon::iterator second = ++polygon.begin();
+    ListPolygon::iterator last = --polygon.end();
+
+    const ListPolygon::iterator inserted = polygon.insert(last, Point(200, 50));
+    EXPECT_EQ(Point(200, 50), *inserted);
+    EXPECT_EQ(Point(100, 0), *second) << "Inserting keeps the other iterators valid.";
+    EXPECT_EQ(Point(100, 100), *last);
+    EXPECT_EQ(std::vector<Point>({Point(0, 0), Point(100, 0), Point(200, 50), Point(100, 100)}), points(polygon));
+
+    const ListPolygon::iterator after = polygon.erase(second);
+    EXPECT_TRUE(after == inserted) << "Erasing returns the point after the erased point.";
+    EXPECT_EQ(std::vector<Point>({Point(0, 0), Point(200, 50), Point(100, 100)}), points(polygon));
+    EXPECT_EQ(size_t(3), polygon.size());
+
+    polygon.erase(polygon.begin());
+    EXPECT_EQ(Point(200, 50), *polygon.begin());
+    EXPECT_EQ(Point(100, 100), *--polygon.end()) << "Going back from the end gives the last point.";
+    EXPECT_EQ(std::vector<Point>({Point(200, 50), Point(100, 100)}), points(polygon));
+}
+
+TEST(ListPolygonTest, ReuseErased)
+{
+    ListPolygon polygon;
+    for (coord_t x = 0; x < 10; x++)
+    {
+        polygon.push_back(Point(x, 0));
+    }
+    //Erase and insert many times, which would fail if the nodes weren't linked up properly again.
+    for (size_t round = 0; round < 100; round++)
+    {
+        ListPolygon::iterator it = polygon.erase(++polygon.begin());
+        polygon.insert(it, Point(1, round));
+    }
+    ASSERT_EQ(size_t(10), polygon.size());
+    std::vector<Point> expected;
+    for (coord_t x = 0; x < 10; x++)
+    {
+        expected.emplace_back(x, x == 1 ? 99 : 0);
+    }
+    EXPECT_EQ(expected, points(polygon));
+
+    polygon.clear();
+    EXPECT_TRUE(polygon.empty());
+    EXPECT_TRUE(polygon.begin() == polygon.end());
+}
+
+} //namespace cura
@@ -4,6 +4,8 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <cmath> //For sqrt.
+#include <limits>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -142,4 +144,60 @@ namespace cura
             EXPECT_EQ(should_be_leave[i_pt], has(pts[i_pt], leaves)) << "Leaf-'status' of point #" << i_pt << " (start @0) should be the expected one.";
         }
     }
+
+    TEST(SimpleMinimumSpanningTreeTest, TestTotalLengthRandom)
+    {
+        //Scattered points on a coarse grid, so that there are many edges of the same length.
+        std::vector<Point> points;
+        unsigned int seed = 12345;
+        for (size_t i = 0; i < 500; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            const coord_t x = (seed >> 8) % 60;
+            seed = seed * 1103515245 + 12345;
+            const coord_t y = (seed >> 8) % 60;
+            points.emplace_back(x * 10, y * 10);
+        }
+        const std::unordered_set<Point> vertices(points.begin(), points.end());
+        points.assign(vertices.begin(), vertices.end());
+        MinimumSpanningTree mst(vertices);
+
+        //The total length of a minimum spanning tree, computed with the plain version of Prim's algorithm.
+        std::vector<coord_t> distance_to_tree(points.size(), std::numeric_limits<coord_t>::max());
+        std::vector<bool> in_tree(points.size(), false);
+        distance_to_tree[0] = 0;
+        double expected_total_length = 0;
+        for (size_t iteration = 0; iteration < points.size(); iteration++)
+        {
+            size_t closest = points.size();
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                if (!in_tree[i] && (closest == points.size() || distance_to_tree[i] < distance_to_tree[closest]))
+                {
+                    closest = i;
+                }
+            }
+            in_tree[closest] = true;
+            expected_total_length += std::sqrt(static_cast<double>(distance_to_tree[closest]));
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                distance_to_tree[i] = std::min(distance_to_tree[i], vSize2(points[i] - points[closest]));
+            }
+        }
+
+        double total_length = 0;
+        size_t edge_ends = 0;
+        for (const Point& point : points)
+        {
+            const std::vector<Point> adjacent = mst.adjacentNodes(point);
+            EXPECT_FALSE(adjacent.empty()) << "Every point should be connected to the tree.";
+            for (const Point& other : adjacent)
+            {
+                total_length += vSizeMM(point - other);
+                edge_ends++;
+            }
+        }
+        EXPECT_EQ(edge_ends, (points.size() - 1) * 2) << "A tree has one edge less than it has vertices.";
+        EXPECT_NEAR(total_length / 2, INT2MM(expected_total_length), 0.0001) << "The tree should be as short as possible.";
+    }
 }
@@ -0,0 +1,110 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/PointKDTree.h"
+
+namespace cura
+{
+
+class PointKDTreeTest : public ::testing::Test
+{
+public:
+    std::vector<std::pair<Point, unsigned int>> points;
+
+    void SetUp() override
+    {
+        //A grid of items, each with two points: one on the grid and one just to the right of it.
+        points.clear();
+        for (unsigned int item_idx = 0; item_idx < 100; item_idx++)
+        {
+            const Point location((item_idx % 10) * 1000, (item_idx / 10) * 1000);
+            points.emplace_back(location, item_idx);
+            points.emplace_back(location + Point(100, 0), item_idx);
+        }
+    }
+
+    /*!
+     * The squared distance to the nearest point of the items that are left,
+     * by going over all points.
+     */
+    coord_t bruteForceNearestDist2(const Point from, const std::vector<bool>& removed) const
+    {
+        coord_t nearest_dist2 = std::numeric_limits<coord_t>::max();
+        for (const std::pair<Point, unsigned int>& point : points)
+        {
+            if (!removed[point.second])
+            {
+                nearest_dist2 = std::min(nearest_dist2, vSize2(point.first - from));
+            }
+        }
+        return nearest_dist2;
+    }
+
+    /*!
+     * The squared distance to the nearest point of an item.
+     */
+    coord_t itemDist2(const Point from, const unsigned int item_idx) const
+    {
+        return std::min(vSize2(points[item_idx * 2].first - from), vSize2(points[item_idx * 2 + 1].first - from));
+    }
+};
+
+TEST_F(PointKDTreeTest, FindNearest)
+{
+    const PointKDTree tree(points);
+    unsigned int nearest;
+    ASSERT_TRUE(tree.findNearest(Point(5050, 3020), nearest));
+    EXPECT_EQ(nearest, 35u);
+    ASSERT_TRUE(tree.findNearest(Point(-10000, -10000), nearest));
+    EXPECT_EQ(nearest, 0u) << "Far outside of the points, the nearest one must still be found.";
+}
+
+TEST_F(PointKDTreeTest, FindNearestSkipsRemoved)
+{
+    PointKDTree tree(points);
+    std::vector<bool> removed(100, false);
+    const Point from(4321, 5678);
+    for (unsigned int step = 0; step < 100; step++)
+    {
+        unsigned int nearest;
+        ASSERT_TRUE(tree.findNearest(from, nearest));
+        EXPECT_FALSE(removed[nearest]) << "A removed item must never be found.";
+        EXPECT_EQ(itemDist2(from, nearest), bruteForceNearestDist2(from, removed));
+        tree.remove(nearest);
+        tree.remove(nearest); //Removing twice does nothing.
+        removed[nearest] = true;
+    }
+    unsigned int nearest;
+    EXPECT_FALSE(tree.findNearest(from, nearest)) << "All items were removed.";
+}
+
+TEST_F(PointKDTreeTest, FindWithin)
+{
+    PointKDTree tree(points);
+    tree.remove(11);
+
+    std::vector<unsigned int> found;
+    tree.findWithin(Point(1000, 1000), 1000, found);
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    const std::vector<unsigned int> expected = {1, 10, 12, 21}; //The neighbours of item 11, but not item 11 itself.
+    EXPECT_EQ(found, expected);
+}
+
+TEST_F(PointKDTreeTest, Empty)
+{
+    PointKDTree tree(std::vector<std::pair<Point, unsigned int>>{});
+    tree.remove(5);
+    unsigned int nearest;
+    EXPECT_FALSE(tree.findNearest(Point(0, 0), nearest));
+    std::vector<unsigned int> found;
+    tree.findWithin(Point(0, 0), 1000, found);
+    EXPECT_TRUE(found.empty());
+}
+
+} //namespace cura
@@ -0,0 +1,102 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/PolygonBooleanBackend.h" //The class under test.
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+/*
+ * The bundled backend, but counting how often it is used.
+ */
+class CountingBooleanBackend : public ClipperBooleanBackend
+{
+public:
+    size_t operation_count = 0;
+
+    void offset(const ClipperLib::Paths& paths, const coord_t distance, const ClipperLib::JoinType join_type, const ClipperLib::EndType end_type, const double miter_limit, ClipperLib::Paths& result) override
+    {
+        operation_count++;
+        ClipperBooleanBackend::offset(paths, distance, join_type, end_type, miter_limit, result);
+    }
+
+    void unionPolygons(const ClipperLib::Paths& subject, const ClipperLib::Paths& other, const ClipperLib::PolyFillType fill_type, ClipperLib::Paths& result) override
+    {
+        operation_count++;
+        ClipperBooleanBackend::unionPolygons(subject, other, fill_type, result);
+    }
+
+    void difference(const ClipperLib::Paths& subject, const ClipperLib::Paths& clip, ClipperLib::Paths& result) override
+    {
+        operation_count++;
+        ClipperBooleanBackend::difference(subject, clip, result);
+    }
+
+    void unionTree(const ClipperLib::Paths& paths, const ClipperLib::PolyFillType fill_type, ClipperLib::PolyTree& result) override
+    {
+        operation_count++;
+        ClipperBooleanBackend::unionTree(paths, fill_type, result);
+    }
+};
+
+class PolygonBooleanBackendTest : public testing::Test
+{
+public:
+    Polygons square;
+    Polygons other_square;
+    CountingBooleanBackend backend;
+
+    void SetUp()
+    {
+        square.clear();
+        PolygonRef poly = square.newPoly();
+        poly.emplace_back(0, 0);
+        poly.emplace_back(1000, 0);
+        poly.emplace_back(1000, 1000);
+        poly.emplace_back(0, 1000);
+        other_square = square;
+        other_square.translate(Point(500, 0));
+    }
+
+    void TearDown()
+    {
+        PolygonBooleanBackend::setInstance(nullptr);
+    }
+};
+
+TEST_F(PolygonBooleanBackendTest, OperationsUseBackend)
+{
+    PolygonBooleanBackend::setInstance(&backend);
+
+    const Polygons united = square.unionPolygons(other_square);
+    EXPECT_EQ(backend.operation_count, 1);
+    EXPECT_EQ(united.area(), 1500 * 1000);
+
+    const Polygons difference = square.difference(other_square);
+    EXPECT_EQ(backend.operation_count, 2);
+    EXPECT_EQ(difference.area(), 500 * 1000);
+
+    const Polygons offset = square.offset(-100);
+    EXPECT_EQ(backend.operation_count, 4) << "The offset unions its input first.";
+    EXPECT_EQ(offset.area(), 800 * 800);
+
+    const std::vector<PolygonsPart> parts = united.splitIntoParts();
+    EXPECT_EQ(backend.operation_count, 5);
+    EXPECT_EQ(parts.size(), 1);
+}
+
+TEST_F(PolygonBooleanBackendTest, ResetToDefault)
+{
+    PolygonBooleanBackend::setInstance(&backend);
+    PolygonBooleanBackend::setInstance(nullptr);
+
+    const Polygons united = square.unionPolygons(other_square);
+    EXPECT_EQ(backend.operation_count, 0);
+    EXPECT_NE(dynamic_cast<ClipperBooleanBackend*>(&PolygonBooleanBackend::getInstance()), nullptr) << "Without a backend, the bundled Clipper is used.";
+    EXPECT_EQ(united.area(), 1500 * 1000);
+}
+
+} //namespace cura
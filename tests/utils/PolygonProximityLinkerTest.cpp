@@ -0,0 +1,136 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/PolygonProximityLinker.h" //The class under test.
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class PolygonProximityLinkerTest : public ::testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        //A long thin rectangle, of which the long sides are 300 apart, and a square far away from it.
+        polygons.clear();
+        PolygonRef thin = polygons.newPoly();
+        thin.emplace_back(0, 0);
+        thin.emplace_back(10000, 0);
+        thin.emplace_back(10000, 300);
+        thin.emplace_back(0, 300);
+        PolygonRef square = polygons.newPoly();
+        square.emplace_back(20000, 0);
+        square.emplace_back(30000, 0);
+        square.emplace_back(30000, 10000);
+        square.emplace_back(20000, 10000);
+    }
+};
+
+TEST_F(PolygonProximityLinkerTest, Empty)
+{
+    const PolygonProximityLinker linker(Polygons(), 400);
+    EXPECT_TRUE(linker.getPolygons().empty());
+    EXPECT_FALSE(linker.isLinked(Point(0, 0)));
+    const PolygonProximityLinker::LinkRange links = linker.getLinks(Point(0, 0));
+    EXPECT_EQ(links.first, links.second);
+}
+
+TEST_F(PolygonProximityLinkerTest, KeepsPolygons)
+{
+    const PolygonProximityLinker linker(polygons, 400);
+    const Polygons& result = linker.getPolygons();
+    ASSERT_EQ(result.size(), polygons.size());
+    EXPECT_EQ(linker.getProximityDistance(), 400);
+    for (size_t poly_idx = 0; poly_idx < polygons.size(); poly_idx++)
+    {
+        EXPECT_GE(result[poly_idx].size(), polygons[poly_idx].size());
+        EXPECT_EQ(result[poly_idx].area(), polygons[poly_idx].area()) << "Inserted points lie on the original line segments.";
+    }
+    EXPECT_EQ(result[1].size(), polygons[1].size()) << "Nothing is close to the big square.";
+}
+
+TEST_F(PolygonProximityLinkerTest, LinksCloseLines)
+{
+    const PolygonProximityLinker linker(polygons, 400);
+    ASSERT_TRUE(linker.isLinked(Point(0, 0)));
+    ASSERT_TRUE(linker.isLinked(Point(10000, 300)));
+    const PolygonProximityLinker::LinkRange links = linker.getLinks(Point(0, 0));
+    bool linked_across = false;
+    for (std::vector<size_t>::const_iterator link_it = links.first; link_it != links.second; ++link_it)
+    {
+        const Point a = linker.getPoint(linker.getLinkA(*link_it));
+        const Point b = linker.getPoint(linker.getLinkB(*link_it));
+        EXPECT_TRUE(a == Point(0, 0) || b == Point(0, 0)) << "Every link of a point contains that point.";
+        const Point other = (a == Point(0, 0)) ? b : a;
+        if (other == Point(0, 300))
+        {
+            linked_across = true;
+            EXPECT_EQ(linker.getLinkDist(*link_it), 300);
+            EXPECT_EQ(linker.getLink(linker.getLinkA(*link_it), linker.getLinkB(*link_it)), *link_it);
+            EXPECT_EQ(linker.getLink(linker.getLinkB(*link_it), linker.getLinkA(*link_it)), *link_it);
+        }
+    }
+    EXPECT_TRUE(linked_across) << "The corner is linked to the corner on the other side.";
+}
+
+TEST_F(PolygonProximityLinkerTest, FarLinesNotLinked)
+{
+    const PolygonProximityLinker linker(polygons, 200);
+    EXPECT_FALSE(linker.isLinked(Point(0, 0))) << "The long sides are further apart than the proximity distance.";
+    for (const Point& p : polygons[1])
+    {
+        EXPECT_FALSE(linker.isLinked(p));
+    }
+}
+
+TEST_F(PolygonProximityLinkerTest, TraversesPolygons)
+{
+    const PolygonProximityLinker linker(polygons, 400);
+    const PolygonProximityLinker::LinkRange links = linker.getLinks(Point(20000, 0));
+    EXPECT_EQ(links.first, links.second);
+    const PolygonProximityLinker::LinkRange thin_links = linker.getLinks(Point(0, 0));
+    ASSERT_NE(thin_links.first, thin_links.second);
+    size_t vertex = linker.getLinkA(*thin_links.first);
+    if (linker.getPoint(vertex) != Point(0, 0))
+    {
+        vertex = linker.getLinkB(*thin_links.first);
+    }
+    //Walking around the polygon gets back to the start in as many steps as it has points.
+    size_t steps = 0;
+    size_t current = vertex;
+    do
+    {
+        EXPECT_EQ(linker.getPrev(linker.getNext(current)), current);
+        current = linker.getNext(current);
+        steps++;
+    }
+    while (current != vertex && steps <= linker.getPolygons()[0].size());
+    EXPECT_EQ(steps, linker.getPolygons()[0].size());
+}
+
+TEST_F(PolygonProximityLinkerTest, InsertsBeforeFirstVertex)
+{
+    //A thin polygon of which the line segment from the last vertex to the first gets a point across from the vertex at (2000, 0).
+    Polygons thin_polygons;
+    PolygonRef thin = thin_polygons.newPoly();
+    thin.emplace_back(0, 300);
+    thin.emplace_back(0, 0);
+    thin.emplace_back(2000, 0);
+    thin.emplace_back(10000, 0);
+    thin.emplace_back(10000, 300);
+
+    const PolygonProximityLinker linker(thin_polygons, 400);
+    const ConstPolygonRef result = linker.getPolygons()[0];
+    ASSERT_GT(result.size(), thin.size());
+    EXPECT_EQ(result.back(), Point(10000, 300)) << "The points on the closing line segment are inserted before the first vertex, not after the last one.";
+    EXPECT_EQ(result[0], Point(2000, 300));
+    EXPECT_EQ(result[1], Point(0, 300));
+    EXPECT_TRUE(linker.isLinked(Point(2000, 300)));
+}
+
+} //namespace cura
@@ -102,6 +102,70 @@ TEST_F(PolygonTest, polygonOffsetBugTest)
     }
 }
 
+TEST_F(PolygonTest, offsetLadderTest)
+{
+    Polygons test_squares;
+    test_squares.add(test_square);
+    const std::vector<Polygons> insets = test_squares.offsetLadder(-10, -15);
+
+    ASSERT_EQ(insets.size(), 3) << "Insets at 10, 25 and 40 fit in the square, but the one at 55 doesn't.";
+    Polygons expected = test_squares;
+    for (size_t inset_idx = 0; inset_idx < insets.size(); inset_idx++)
+    {
+        expected = expected.offset((inset_idx == 0) ? -10 : -15);
+        EXPECT_EQ(insets[inset_idx].area(), expected.area()) << "Each inset should be the same as offsetting the previous one.";
+    }
+
+    const std::vector<Polygons> outsets = test_squares.offsetLadder(10, 10, 4);
+    EXPECT_EQ(outsets.size(), 4) << "An outward ladder is limited by the maximum count.";
+}
+
+TEST_F(PolygonTest, offsetEachTest)
+{
+    Polygons square;
+    square.add(test_square);
+    Polygons triangles;
+    triangles.add(triangle);
+    triangles.add(pointy_square);
+    const Polygons empty;
+    const std::vector<const Polygons*> inputs = {&square, &triangles, &empty, &clockwise_donut};
+
+    const std::vector<Polygons> results = Polygons::offsetEach(inputs, -10);
+    ASSERT_EQ(results.size(), inputs.size());
+    for (size_t input_idx = 0; input_idx < inputs.size(); input_idx++)
+    {
+        const Polygons expected = inputs[input_idx]->offset(-10);
+        EXPECT_EQ(results[input_idx].size(), expected.size()) << "Input " << input_idx << " should give the same as offsetting it alone.";
+        EXPECT_EQ(results[input_idx].area(), expected.area()) << "Input " << input_idx << " should give the same as offsetting it alone.";
+    }
+}
+
+TEST_F(PolygonTest, convexHullTest)
+{
+    Polygons polys;
+    polys.add(pointy_square);
+    polys.add(triangle);
+    const Polygon hull = polys.convexHull();
+
+    ASSERT_EQ(hull.size(), 5) << "The hull consists of (0,0), (300,0), (100,100), (50,180) and (0,100).";
+    EXPECT_GT(hull.area(), 0) << "The hull must be counter-clockwise.";
+    Polygons hull_polys;
+    hull_polys.add(hull);
+    EXPECT_EQ(polys.difference(hull_polys).area(), 0) << "All polygons must be inside the hull.";
+
+    Polygons collinear;
+    collinear.add(test_square);
+    PolygonRef with_midpoints = collinear.newPoly();
+    with_midpoints.emplace_back(50, 0);
+    with_midpoints.emplace_back(100, 50);
+    with_midpoints.emplace_back(50, 50);
+    EXPECT_EQ(collinear.convexHull().size(), 4) << "Vertices on the edges of the hull aren't part of it.";
+
+    Polygons lines;
+    lines.add(line);
+    EXPECT_LT(lines.convexHull().size(), 3) << "The hull of a line has no area.";
+}
+
 TEST_F(PolygonTest, isOutsideTest)
 {
     Polygons test_triangle;
@@ -162,6 +226,64 @@ TEST_F(PolygonTest, splitIntoPartsWithHoleTest)
     EXPECT_EQ(parts.size(), 1) << "Difference between two polygons should be one PolygonsPart!";
 }
 
+/*!
+ * Parts in the holes of other parts must know which part they lie in, also if
+ * they are nested several levels deep.
+ */
+TEST_F(PolygonTest, splitIntoPartsEnclosingPartsTest)
+{
+    Polygons nested; //Squares inside each other, alternating between filled and hole with the even-odd rule.
+    for (const coord_t radius : {100, 50, 30, 20, 10})
+    {
+        PolygonRef square = nested.newPoly();
+        square.emplace_back(-radius, -radius);
+        square.emplace_back(radius, -radius);
+        square.emplace_back(radius, radius);
+        square.emplace_back(-radius, radius);
+    }
+    PolygonRef separate = nested.newPoly();
+    separate.emplace_back(300, 0);
+    separate.emplace_back(400, 0);
+    separate.emplace_back(400, 100);
+    separate.emplace_back(300, 100);
+
+    std::vector<unsigned int> enclosing_parts;
+    const std::vector<PolygonsPart> parts = nested.splitIntoParts(false, enclosing_parts);
+
+    ASSERT_EQ(parts.size(), 4);
+    ASSERT_EQ(enclosing_parts.size(), parts.size()) << "Every part must know whether it's enclosed.";
+    const auto find_part = [&parts](const coord_t radius)
+    {
+        for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+        {
+            if (parts[part_idx].outerPolygon().area() == static_cast<double>(4 * radius * radius))
+            {
+                return static_cast<unsigned int>(part_idx);
+            }
+        }
+        return static_cast<unsigned int>(NO_INDEX);
+    };
+    const unsigned int outer_part = find_part(100);
+    const unsigned int middle_part = find_part(30);
+    const unsigned int inner_part = find_part(10);
+    const unsigned int separate_part = find_part(50); //The separate square is as large as a square with radius 50, which is only a hole in the nested squares.
+    ASSERT_NE(outer_part, NO_INDEX);
+    ASSERT_NE(middle_part, NO_INDEX);
+    ASSERT_NE(inner_part, NO_INDEX);
+    ASSERT_NE(separate_part, NO_INDEX);
+    EXPECT_EQ(enclosing_parts[outer_part], NO_INDEX) << "The outer part isn't in any hole.";
+    EXPECT_EQ(enclosing_parts[middle_part], outer_part) << "The middle part is in the hole of the outer part.";
+    EXPECT_EQ(enclosing_parts[inner_part], middle_part) << "The inner part is in the hole of the middle part, not of the outer part.";
+    EXPECT_EQ(enclosing_parts[separate_part], NO_INDEX) << "The separate square isn't in any hole.";
+
+    const std::vector<PolygonsPart> plain_parts = nested.splitIntoParts();
+    ASSERT_EQ(plain_parts.size(), parts.size()) << "Keeping the nesting must not change the parts.";
+    for (size_t part_idx = 0; part_idx < parts.size(); part_idx++)
+    {
+        EXPECT_EQ(plain_parts[part_idx].size(), parts[part_idx].size());
+    }
+}
+
 TEST_F(PolygonTest, differenceContainsOriginalPointTest)
 {
     const PolygonsPart part = clockwise_donut.splitIntoParts()[0];
@@ -211,6 +333,92 @@ TEST_F(PolygonTest, getEmptyHolesTest)
     }
 }
 
+/*!
+ * The in-place variants of the Clipper operations must give the same result as
+ * the ones that make a copy.
+ */
+TEST_F(PolygonTest, inPlaceMatchesCopyTest)
+{
+    Polygons squares;
+    squares.add(test_square);
+    squares.add(triangle);
+    Polygons other;
+    other.add(clockwise_large);
+
+    const auto expect_same = [](const Polygons& expected, const Polygons& actual, const char* operation)
+    {
+        ASSERT_EQ(actual.size(), expected.size()) << operation;
+        for (size_t poly_idx = 0; poly_idx < expected.size(); poly_idx++)
+        {
+            EXPECT_EQ(*actual[poly_idx], *expected[poly_idx]) << operation;
+        }
+    };
+
+    Polygons result = squares;
+    result.differenceInPlace(other);
+    expect_same(squares.difference(other), result, "difference");
+
+    result = squares;
+    result.intersectionInPlace(other);
+    expect_same(squares.intersection(other), result, "intersection");
+
+    result = squares;
+    result.unionInPlace(other);
+    expect_same(squares.unionPolygons(other), result, "union");
+
+    result = squares;
+    result.unionInPlace();
+    expect_same(squares.unionPolygons(), result, "union with itself");
+
+    result = squares;
+    result.offsetInPlace(20);
+    expect_same(squares.offset(20), result, "offset");
+
+    result = squares;
+    result.differenceInPlace(result);
+    EXPECT_TRUE(result.empty()) << "Subtracting polygons from themselves in place leaves nothing.";
+}
+
+TEST_F(PolygonTest, addMovedPolygonsTest)
+{
+    Polygons destination;
+    destination.add(test_square);
+    Polygons moved;
+    moved.add(triangle);
+    moved.add(line);
+
+    destination.add(std::move(moved));
+    ASSERT_EQ(destination.size(), 3);
+    EXPECT_EQ(*destination[0], *test_square);
+    EXPECT_EQ(*destination[1], *triangle);
+    EXPECT_EQ(*destination[2], *line);
+
+    Polygons empty_destination;
+    empty_destination.add(std::move(destination));
+    EXPECT_EQ(empty_destination.size(), 3) << "Moving into empty polygons takes over all polygons.";
+}
+
+TEST_F(PolygonTest, smoothKeepsOrderTest)
+{
+    Polygons polys;
+    polys.add(test_square);
+    polys.add(line); //Too small to smooth, so it's left out.
+    polys.add(triangle);
+    Polygons moved_square;
+    moved_square.add(test_square);
+    moved_square.translate(Point(1000, 0));
+    polys.add(moved_square);
+
+    for (const Polygons& smoothed : {polys.smooth_outward(135, 50), polys.smooth(5)})
+    {
+        ASSERT_EQ(size_t(3), smoothed.size());
+        EXPECT_EQ(test_square.size(), smoothed[0].size()) << "The square has no corners to smooth.";
+        EXPECT_EQ(test_square[0], smoothed[0][0]);
+        EXPECT_EQ(triangle[0], smoothed[1][0]);
+        EXPECT_EQ(moved_square[0][0], smoothed[2][0]);
+    }
+}
+
 TEST_F(PolygonTest, simplifyCircle)
 {
     Polygons circle_polygons;
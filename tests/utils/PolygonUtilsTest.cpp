@@ -239,7 +239,7 @@ TEST_P(FindCloseTest, FindClose)
     const FindCloseParameters parameters = GetParam();
     Polygons polygons;
     polygons.add(test_square);
-    SparseLineGrid<PolygonsPointIndex, PolygonsPointIndexSegmentLocator>* loc_to_line = PolygonUtils::createLocToLineGrid(polygons, parameters.cell_size);
+    LocToLineGrid* loc_to_line = PolygonUtils::createLocToLineGrid(polygons, parameters.cell_size);
 
     std::optional<ClosestPolygonPoint> cpp;
     if (parameters.penalty_function)
@@ -405,6 +405,43 @@ INSTANTIATE_TEST_CASE_P(GetNextParallelIntersectionInstantiation, GetNextParalle
     GetNextParallelIntersectionParameters(Point(0, 45), Point(5, 100), Point(105, 200), true, 35)
 ));
 
+/*!
+ * Without a penalty, findClosest skips segments that are too far away. It must
+ * still find the same point as when every segment is checked, which happens
+ * with any other penalty function.
+ */
+TEST_F(PolygonUtilsTest, findClosestSkipsSameAsFullSearch)
+{
+    Polygons polygons = test_squares;
+    Polygon circle;
+    for (size_t i = 0; i < 37; i++)
+    {
+        const double angle = i * 2 * M_PI / 37;
+        circle.emplace_back(300 + std::cos(angle) * 150, 50 + std::sin(angle) * 150);
+    }
+    polygons.add(circle);
+    polygons.add(test_line_extra_vertices[0]);
+    const std::function<int(Point)> zero_penalty = [](Point) { return 0; };
+
+    for (coord_t x = -200; x <= 600; x += 25)
+    {
+        for (coord_t y = -200; y <= 300; y += 25)
+        {
+            const Point from(x, y);
+            const ClosestPolygonPoint skipped = PolygonUtils::findClosest(from, polygons);
+            const ClosestPolygonPoint full = PolygonUtils::findClosest(from, polygons, zero_penalty);
+            ASSERT_EQ(skipped.location, full.location) << "From " << from << ".";
+            ASSERT_EQ(skipped.point_idx, full.point_idx) << "From " << from << ".";
+            ASSERT_EQ(skipped.poly_idx, full.poly_idx) << "From " << from << ".";
+
+            const ClosestPolygonPoint skipped_single = PolygonUtils::findClosest(from, polygons[1]);
+            const ClosestPolygonPoint full_single = PolygonUtils::findClosest(from, polygons[1], zero_penalty);
+            ASSERT_EQ(skipped_single.location, full_single.location) << "From " << from << ".";
+            ASSERT_EQ(skipped_single.point_idx, full_single.point_idx) << "From " << from << ".";
+        }
+    }
+}
+
 TEST_F(PolygonUtilsTest, RelativeHammingSquaresOverlap)
 {
     ASSERT_EQ(PolygonUtils::relativeHammingDistance(test_squares, test_squares), 0);
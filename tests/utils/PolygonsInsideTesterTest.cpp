@@ -0,0 +1,125 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/PolygonsInsideTester.h" //The class under test.
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class PolygonsInsideTesterTest : public ::testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        //Shapes of which many vertices lie on the same horizontal lines, since a horizontal ray through a vertex is the hard case of counting crossings.
+        polygons.clear();
+        //A diamond, with vertices at its top, bottom, left and right.
+        PolygonRef diamond = polygons.newPoly();
+        diamond.emplace_back(500, 0);
+        diamond.emplace_back(1000, 500);
+        diamond.emplace_back(500, 1000);
+        diamond.emplace_back(0, 500);
+        //A hole in the diamond, with a horizontal edge.
+        PolygonRef hole = polygons.newPoly();
+        hole.emplace_back(400, 400);
+        hole.emplace_back(500, 600);
+        hole.emplace_back(600, 400);
+        //A square with a notch in its top, of which the bottom of the notch is level with the left and right of the diamond, and with a superfluous vertex on its bottom edge.
+        PolygonRef notched = polygons.newPoly();
+        notched.emplace_back(1200, 0);
+        notched.emplace_back(1500, 0);
+        notched.emplace_back(1800, 0);
+        notched.emplace_back(1800, 1000);
+        notched.emplace_back(1500, 500);
+        notched.emplace_back(1200, 1000);
+        //Two squares that only touch at a corner, which is level with the left and right of the diamond too.
+        PolygonRef lower_square = polygons.newPoly();
+        lower_square.emplace_back(2000, 0);
+        lower_square.emplace_back(2500, 0);
+        lower_square.emplace_back(2500, 500);
+        lower_square.emplace_back(2000, 500);
+        PolygonRef upper_square = polygons.newPoly();
+        upper_square.emplace_back(2500, 500);
+        upper_square.emplace_back(3000, 500);
+        upper_square.emplace_back(3000, 1000);
+        upper_square.emplace_back(2500, 1000);
+    }
+};
+
+TEST_F(PolygonsInsideTesterTest, Empty)
+{
+    const PolygonsInsideTester tester;
+    EXPECT_TRUE(tester.empty());
+    EXPECT_FALSE(tester.inside(Point(0, 0), true));
+
+    Polygons lines;
+    lines.addLine(Point(0, 0), Point(1000, 1000));
+    const PolygonsInsideTester lines_tester(lines);
+    EXPECT_FALSE(lines_tester.inside(Point(500, 500), true)) << "Polygons with fewer than three points are skipped, like in Polygons::inside.";
+}
+
+TEST_F(PolygonsInsideTesterTest, OnVertices)
+{
+    const PolygonsInsideTester tester(polygons);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        for (const Point& vertex : polygon)
+        {
+            EXPECT_TRUE(tester.inside(vertex, true)) << "Vertex " << vertex.X << ", " << vertex.Y << " is on the border.";
+            EXPECT_FALSE(tester.inside(vertex, false)) << "Vertex " << vertex.X << ", " << vertex.Y << " is on the border.";
+        }
+    }
+}
+
+TEST_F(PolygonsInsideTesterTest, NextToVertices)
+{
+    const PolygonsInsideTester tester(polygons);
+    for (ConstPolygonRef polygon : polygons)
+    {
+        for (const Point& vertex : polygon)
+        {
+            for (coord_t dx = -1; dx <= 1; dx++)
+            {
+                for (coord_t dy = -1; dy <= 1; dy++)
+                {
+                    const Point p = vertex + Point(dx, dy);
+                    ASSERT_EQ(tester.inside(p, false), polygons.inside(p, false)) << "Point " << p.X << ", " << p.Y << " with the border outside.";
+                    ASSERT_EQ(tester.inside(p, true), polygons.inside(p, true)) << "Point " << p.X << ", " << p.Y << " with the border inside.";
+                }
+            }
+        }
+    }
+}
+
+TEST_F(PolygonsInsideTesterTest, LevelWithVertices)
+{
+    const PolygonsInsideTester tester(polygons);
+    //Points on the horizontal lines through the vertices, from left of all polygons to right of them.
+    for (const coord_t y : {0, 400, 500, 600, 1000})
+    {
+        for (coord_t x = -100; x <= 3100; x += 10)
+        {
+            const Point p(x, y);
+            ASSERT_EQ(tester.inside(p, false), polygons.inside(p, false)) << "Point " << x << ", " << y << " with the border outside.";
+            ASSERT_EQ(tester.inside(p, true), polygons.inside(p, true)) << "Point " << x << ", " << y << " with the border inside.";
+        }
+    }
+    EXPECT_TRUE(tester.inside(Point(1300, 500))) << "Left of the bottom of the notch.";
+    EXPECT_FALSE(tester.inside(Point(1500, 600))) << "In the notch.";
+    EXPECT_FALSE(tester.inside(Point(500, 500))) << "In the hole.";
+    EXPECT_TRUE(tester.inside(Point(500, 200)));
+}
+
+TEST_F(PolygonsInsideTesterTest, KeepsCopy)
+{
+    const PolygonsInsideTester tester(polygons);
+    polygons.clear();
+    EXPECT_TRUE(tester.inside(Point(500, 200)));
+}
+
+} //namespace cura
@@ -0,0 +1,123 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/PolygonsOccupancyGrid.h" //The class under test.
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class PolygonsOccupancyGridTest : public ::testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        //Shapes of which the edges lie on the sides of cells of 100, go through their corners or fit in a single cell.
+        //The cells start at the lowest coordinates of the polygons minus a cell, so here at multiples of the cell size.
+        polygons.clear();
+        //A square with a square hole, of which all edges lie on the sides of cells.
+        PolygonRef outer = polygons.newPoly();
+        outer.emplace_back(0, 0);
+        outer.emplace_back(1000, 0);
+        outer.emplace_back(1000, 1000);
+        outer.emplace_back(0, 1000);
+        PolygonRef hole = polygons.newPoly();
+        hole.emplace_back(300, 300);
+        hole.emplace_back(300, 600);
+        hole.emplace_back(600, 600);
+        hole.emplace_back(600, 300);
+        //A triangle with a diagonal edge through the corners of cells.
+        PolygonRef triangle = polygons.newPoly();
+        triangle.emplace_back(1200, 0);
+        triangle.emplace_back(1800, 600);
+        triangle.emplace_back(1200, 600);
+        //A triangle that fits in a single cell, with its bottom on the line through the middle of the row.
+        PolygonRef speck = polygons.newPoly();
+        speck.emplace_back(1550, 850);
+        speck.emplace_back(1570, 850);
+        speck.emplace_back(1560, 870);
+    }
+};
+
+TEST_F(PolygonsOccupancyGridTest, Empty)
+{
+    const PolygonsOccupancyGrid grid(Polygons(), 100);
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::OUTSIDE, grid.getOccupancy(Point(0, 0)));
+    EXPECT_FALSE(grid.inside(Point(0, 0), true));
+}
+
+TEST_F(PolygonsOccupancyGridTest, EdgesOnCellSides)
+{
+    const PolygonsOccupancyGrid grid(polygons, 100);
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::INSIDE, grid.getOccupancy(Point(150, 150)));
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::OUTSIDE, grid.getOccupancy(Point(450, 450))) << "The cell in the middle of the hole touches none of its sides.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(300, 450))) << "On the side of the hole.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(250, 450))) << "The cell left of the side of the hole touches it.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(350, 450))) << "The cell right of the side of the hole touches it.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(950, 950))) << "The cell in the corner of the square.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(1050, 500))) << "The cell right of the side of the square touches it.";
+}
+
+TEST_F(PolygonsOccupancyGridTest, EdgeThroughCellCorners)
+{
+    const PolygonsOccupancyGrid grid(polygons, 100);
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(1350, 150))) << "The diagonal goes through this cell from corner to corner.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(1450, 150))) << "The diagonal only touches this cell at its corner.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(1350, 250))) << "The diagonal only touches this cell at its corner.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::INSIDE, grid.getOccupancy(Point(1350, 450)));
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::OUTSIDE, grid.getOccupancy(Point(1650, 150)));
+}
+
+TEST_F(PolygonsOccupancyGridTest, PolygonWithinCell)
+{
+    const PolygonsOccupancyGrid grid(polygons, 100);
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(1510, 810))) << "The cell of the speck is near its border, even where the speck isn't.";
+    EXPECT_FALSE(grid.inside(Point(1510, 810), true));
+    EXPECT_TRUE(grid.inside(Point(1560, 855)));
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::OUTSIDE, grid.getOccupancy(Point(1450, 850)));
+}
+
+TEST_F(PolygonsOccupancyGridTest, SameAsPolygonsForCellSizes)
+{
+    //Cells that line up with the edges, that don't, of a single unit and larger than the polygons.
+    for (const coord_t cell_size : {100, 50, 77, 1, 5000})
+    {
+        const PolygonsOccupancyGrid grid(polygons, cell_size);
+        //Points on the sides of the cells of 100 and a unit next to them.
+        for (coord_t x = -100; x <= 1900; x += 50)
+        {
+            for (coord_t y = -100; y <= 1100; y += 50)
+            {
+                for (const coord_t offset : {-1, 0, 1})
+                {
+                    const Point p(x + offset, y + offset);
+                    ASSERT_EQ(grid.inside(p, false), polygons.inside(p, false)) << "Point " << p.X << ", " << p.Y << " with the border outside, cells of " << cell_size << ".";
+                    ASSERT_EQ(grid.inside(p, true), polygons.inside(p, true)) << "Point " << p.X << ", " << p.Y << " with the border inside, cells of " << cell_size << ".";
+                }
+            }
+        }
+    }
+}
+
+TEST_F(PolygonsOccupancyGridTest, Region)
+{
+    const PolygonsOccupancyGrid grid(polygons, 100, AABB(Point(0, 0), Point(500, 500)));
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::INSIDE, grid.getOccupancy(Point(150, 150)));
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::NEAR_BORDER, grid.getOccupancy(Point(850, 850))) << "Nothing is known about the points beyond the region.";
+    EXPECT_EQ(PolygonsOccupancyGrid::Occupancy::OUTSIDE, grid.getOccupancy(Point(-10000, 500))) << "The point is beyond the polygons.";
+    for (coord_t x = -100; x <= 1900; x += 50)
+    {
+        for (coord_t y = -100; y <= 1100; y += 50)
+        {
+            const Point p(x, y);
+            ASSERT_EQ(grid.inside(p, false), polygons.inside(p, false)) << "Point " << x << ", " << y << " with the border outside.";
+            ASSERT_EQ(grid.inside(p, true), polygons.inside(p, true)) << "Point " << x << ", " << y << " with the border inside.";
+        }
+    }
+}
+
+} //namespace cura
@@ -0,0 +1,102 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+
+#include "../src/utils/PolygonsScanlines.h" //The class under test.
+#include "../src/utils/linearAlg2D.h"
+#include "../src/utils/polygon.h"
+
+namespace cura
+{
+
+class PolygonsScanlinesTest : public ::testing::Test
+{
+public:
+    Polygons polygons;
+
+    void SetUp() override
+    {
+        //Shapes with vertices and horizontal edges on the scanlines at every 100 and halfway between them.
+        polygons.clear();
+        //A staircase, with a horizontal edge on the scanline at 200, one halfway the band above it and one on the scanline at 700.
+        PolygonRef staircase = polygons.newPoly();
+        staircase.emplace_back(0, 200);
+        staircase.emplace_back(400, 200);
+        staircase.emplace_back(400, 250);
+        staircase.emplace_back(800, 250);
+        staircase.emplace_back(800, 700);
+        staircase.emplace_back(0, 700);
+        //A triangle pointing down, which only touches the scanline at 300 with its lowest vertex.
+        PolygonRef triangle = polygons.newPoly();
+        triangle.emplace_back(1000, 600);
+        triangle.emplace_back(1200, 300);
+        triangle.emplace_back(1400, 600);
+        //A sliver that goes through many bands, some of them below zero.
+        PolygonRef sliver = polygons.newPoly();
+        sliver.emplace_back(1600, -150);
+        sliver.emplace_back(1650, -150);
+        sliver.emplace_back(1700, 850);
+    }
+};
+
+TEST_F(PolygonsScanlinesTest, Empty)
+{
+    const PolygonsScanlines scanlines(Polygons(), 0, 100);
+    EXPECT_FALSE(scanlines.inside(Point(0, 0), true));
+    Point crossing;
+    EXPECT_FALSE(scanlines.findFirstCrossing(Point(-100, -100), Point(100, 100), crossing));
+}
+
+TEST_F(PolygonsScanlinesTest, InsideAtBandEdges)
+{
+    //Scanlines on the horizontal edges and vertices, between them, and far apart.
+    for (const coord_t first_y : {0, 50, -30})
+    {
+        for (const coord_t spacing : {100, 7, 5000})
+        {
+            const PolygonsScanlines scanlines(polygons, first_y, spacing);
+            //Steps of 25 put points on all horizontal edges and on the vertices.
+            for (coord_t x = -100; x <= 1800; x += 25)
+            {
+                for (coord_t y = -200; y <= 900; y += 25)
+                {
+                    const Point p(x, y);
+                    ASSERT_EQ(scanlines.inside(p, false), polygons.inside(p, false)) << "Point " << x << ", " << y << " with the border outside, scanlines at " << first_y << " every " << spacing << ".";
+                    ASSERT_EQ(scanlines.inside(p, true), polygons.inside(p, true)) << "Point " << x << ", " << y << " with the border inside, scanlines at " << first_y << " every " << spacing << ".";
+                }
+            }
+        }
+    }
+}
+
+TEST_F(PolygonsScanlinesTest, CrossingsAtBandEdges)
+{
+    const PolygonsScanlines scanlines(polygons, 0, 100);
+    Point crossing;
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(600, 225), Point(600, 275), crossing));
+    EXPECT_EQ(crossing, Point(600, 250)) << "The horizontal edge halfway the band is crossed.";
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(200, 650), Point(200, 750), crossing));
+    EXPECT_EQ(crossing, Point(200, 700)) << "The horizontal edge on the scanline is crossed.";
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(200, 150), Point(200, 200), crossing));
+    EXPECT_EQ(crossing, Point(200, 200)) << "The end of the segment counts.";
+    EXPECT_FALSE(scanlines.findFirstCrossing(Point(100, 200), Point(300, 200), crossing)) << "Overlapping with the edge on the scanline is not crossing it.";
+    EXPECT_FALSE(scanlines.findFirstCrossing(Point(0, 450), Point(-100, 460), crossing)) << "The segment only touches the border at its start.";
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(-100, 450), Point(1500, 450), crossing));
+    EXPECT_EQ(crossing, Point(0, 450)) << "The closest of the crossings with the staircase and the triangle.";
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(1500, 450), Point(-100, 450), crossing));
+    EXPECT_EQ(crossing, Point(1300, 450)) << "The closest crossing in the other direction.";
+    EXPECT_FALSE(scanlines.findFirstCrossing(Point(300, 400), Point(700, 600), crossing)) << "Within the staircase, over several bands.";
+}
+
+TEST_F(PolygonsScanlinesTest, RoundedCrossingOverManyBands)
+{
+    const PolygonsScanlines scanlines(polygons, 0, 100);
+    Point crossing;
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(1500, 500), Point(1800, 503), crossing));
+    EXPECT_LT(LinearAlg2D::getDist2FromLineSegment(Point(1700, 850), crossing, Point(1600, -150)), 10) << "The crossing is rounded to a point right next to the left side of the sliver.";
+    ASSERT_TRUE(scanlines.findFirstCrossing(Point(1620, -200), Point(1620, 0), crossing));
+    EXPECT_EQ(crossing, Point(1620, -150)) << "The bands below zero have their edges too.";
+}
+
+} //namespace cura
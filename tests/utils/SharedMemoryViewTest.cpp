@@ -0,0 +1,49 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h> //For O_CREAT.
+#include <sys/mman.h> //shm_open, shm_unlink.
+#include <unistd.h> //ftruncate, write, close.
+#endif
+
+#include "../src/utils/SharedMemoryView.h"
+
+namespace cura
+{
+
+TEST(SharedMemoryViewTest, Missing)
+{
+    SharedMemoryView view("/CuraEngineSharedMemoryViewTestMissing");
+
+    EXPECT_FALSE(view.isValid());
+    EXPECT_EQ(nullptr, view.data());
+    EXPECT_EQ(size_t(0), view.size());
+}
+
+#ifndef _WIN32 //Creating a segment is different on Windows. The engine only ever reads them.
+TEST(SharedMemoryViewTest, ReadSegment)
+{
+    const std::string name = "/CuraEngineSharedMemoryViewTest";
+    const std::string content = "Vertices of a mesh.";
+    const int file_descriptor = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    ASSERT_GE(file_descriptor, 0) << "The test needs to be able to create shared memory.";
+    ASSERT_EQ(0, ftruncate(file_descriptor, content.size()));
+    ASSERT_EQ(static_cast<ssize_t>(content.size()), write(file_descriptor, content.data(), content.size()));
+    close(file_descriptor);
+
+    {
+        SharedMemoryView view(name);
+        ASSERT_TRUE(view.isValid());
+        ASSERT_EQ(content.size(), view.size());
+        EXPECT_EQ(content, std::string(view.data(), view.size()));
+    }
+
+    shm_unlink(name.c_str());
+}
+#endif
+
+}
@@ -0,0 +1,92 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/IntPoint.h"
+#include "../src/utils/SmallVector.h" //The unit under test.
+
+namespace cura
+{
+
+TEST(SmallVectorTest, StaysInline)
+{
+    SmallVector<Point, 2> points;
+    EXPECT_TRUE(points.empty());
+    points.push_back(Point(1, 2));
+    points.emplace_back(3, 4);
+
+    EXPECT_TRUE(points.isInline()) << "Two points fit inline.";
+    ASSERT_EQ(points.size(), 2);
+    EXPECT_EQ(points.front(), Point(1, 2));
+    EXPECT_EQ(points.back(), Point(3, 4));
+}
+
+TEST(SmallVectorTest, GrowsOntoHeap)
+{
+    SmallVector<Point, 2> points;
+    for (coord_t i = 0; i < 100; i++)
+    {
+        points.push_back(Point(i, -i));
+    }
+
+    EXPECT_FALSE(points.isInline());
+    EXPECT_GE(points.capacity(), 100);
+    ASSERT_EQ(points.size(), 100);
+    coord_t i = 0;
+    for (const Point& point : points)
+    {
+        EXPECT_EQ(point, Point(i, -i)) << "The points that were inline must have been moved along.";
+        i++;
+    }
+}
+
+TEST(SmallVectorTest, Insert)
+{
+    const std::vector<Point> inserted = {Point(2, 0), Point(3, 0), Point(4, 0)};
+    SmallVector<Point, 2> points;
+    points.push_back(Point(1, 0));
+    points.push_back(Point(5, 0));
+    points.insert(points.begin() + 1, inserted.begin(), inserted.end());
+    points.insert(points.end(), inserted.begin(), inserted.begin()); //Nothing.
+
+    ASSERT_EQ(points.size(), 5);
+    for (size_t point_idx = 0; point_idx < points.size(); point_idx++)
+    {
+        EXPECT_EQ(points[point_idx], Point(point_idx + 1, 0));
+    }
+}
+
+TEST(SmallVectorTest, CopyAndMove)
+{
+    SmallVector<Point, 2> short_points;
+    short_points.push_back(Point(1, 1));
+    SmallVector<Point, 2> long_points;
+    for (coord_t i = 0; i < 10; i++)
+    {
+        long_points.push_back(Point(i, i));
+    }
+
+    SmallVector<Point, 2> copy(long_points);
+    ASSERT_EQ(copy.size(), 10);
+    EXPECT_NE(copy.begin(), long_points.begin()) << "A copy must have its own elements.";
+    EXPECT_EQ(copy.back(), Point(9, 9));
+
+    const Point* heap_data = long_points.data();
+    SmallVector<Point, 2> moved(std::move(long_points));
+    EXPECT_EQ(moved.data(), heap_data) << "Moving must take over the memory on the heap.";
+    EXPECT_TRUE(long_points.empty());
+    EXPECT_TRUE(long_points.isInline());
+
+    moved = short_points;
+    ASSERT_EQ(moved.size(), 1);
+    EXPECT_EQ(moved[0], Point(1, 1));
+
+    copy = std::move(short_points);
+    ASSERT_EQ(copy.size(), 1);
+    EXPECT_TRUE(copy.isInline());
+    EXPECT_EQ(copy[0], Point(1, 1));
+}
+
+} //namespace cura
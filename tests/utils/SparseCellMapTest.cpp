@@ -0,0 +1,111 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <algorithm> //For find.
+#include <map>
+#include <vector>
+
+#include "../src/utils/SparseCellMap.h" //The class under test.
+
+namespace cura
+{
+
+/*!
+ * Get the elements of a cell in the order in which they are visited.
+ */
+std::vector<int> getCell(const SparseCellMap<int>& map, const Point& cell)
+{
+    std::vector<int> result;
+    map.processCell(cell, [&result](const int elem)
+    {
+        result.push_back(elem);
+        return true;
+    });
+    return result;
+}
+
+TEST(SparseCellMapTest, Empty)
+{
+    const SparseCellMap<int> map;
+    EXPECT_EQ(map.size(), 0);
+    EXPECT_TRUE(getCell(map, Point(0, 0)).empty());
+    EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(SparseCellMapTest, LastAddedFirst)
+{
+    SparseCellMap<int> map;
+    map.emplace(Point(1, 2), 10);
+    map.emplace(Point(3, 4), 20);
+    map.emplace(Point(1, 2), 11);
+    map.emplace(Point(1, 2), 12);
+
+    EXPECT_EQ(getCell(map, Point(1, 2)), std::vector<int>({12, 11, 10})) << "Like an unordered_multimap, the last added element comes first.";
+    EXPECT_EQ(getCell(map, Point(3, 4)), std::vector<int>({20}));
+    EXPECT_TRUE(getCell(map, Point(2, 1)).empty());
+    EXPECT_EQ(map.size(), 4);
+}
+
+TEST(SparseCellMapTest, StopProcessing)
+{
+    SparseCellMap<int> map;
+    for (int i = 0; i < 5; i++)
+    {
+        map.emplace(Point(0, 0), i);
+    }
+    size_t visited = 0;
+    const bool completed = map.processCell(Point(0, 0), [&visited](const int)
+    {
+        visited++;
+        return visited < 2;
+    });
+    EXPECT_FALSE(completed);
+    EXPECT_EQ(visited, 2);
+}
+
+TEST(SparseCellMapTest, ManyCells)
+{
+    //Enough cells to grow the table several times, including negative coordinates.
+    SparseCellMap<int> map;
+    std::map<std::pair<coord_t, coord_t>, std::vector<int>> expected;
+    int elem = 0;
+    for (coord_t x = -40; x < 40; x++)
+    {
+        for (coord_t y = -30; y < 30; y += 3)
+        {
+            for (int repeat = 0; repeat < (x + y + 100) % 3; repeat++)
+            {
+                map.emplace(Point(x, y), elem);
+                expected[std::make_pair(x, y)].insert(expected[std::make_pair(x, y)].begin(), elem);
+                elem++;
+            }
+        }
+    }
+    EXPECT_EQ(map.size(), static_cast<size_t>(elem));
+    for (const std::pair<const std::pair<coord_t, coord_t>, std::vector<int>>& cell : expected)
+    {
+        ASSERT_EQ(getCell(map, Point(cell.first.first, cell.first.second)), cell.second);
+    }
+
+    size_t iterated = 0;
+    for (const std::pair<Point, int> cell_elem : map)
+    {
+        const std::vector<int>& cell = expected[std::make_pair(cell_elem.first.X, cell_elem.first.Y)];
+        EXPECT_NE(std::find(cell.begin(), cell.end(), cell_elem.second), cell.end()) << "Each element is iterated with its own cell.";
+        iterated++;
+    }
+    EXPECT_EQ(iterated, map.size());
+}
+
+TEST(SparseCellMapTest, Reserve)
+{
+    SparseCellMap<int> map;
+    map.emplace(Point(5, 5), 1);
+    map.reserve(1000);
+    map.emplace(Point(6, 5), 2);
+    EXPECT_EQ(getCell(map, Point(5, 5)), std::vector<int>({1})) << "Reserving keeps the cells that were already added.";
+    EXPECT_EQ(getCell(map, Point(6, 5)), std::vector<int>({2}));
+}
+
+} //namespace cura
@@ -1,6 +1,7 @@
 //Copyright (c) 2019 Ultimaker B.V.
 //CuraEngine is released under the terms of the AGPLv3 or higher.
 
+#include <algorithm> //For find_if.
 #include <gtest/gtest.h>
 #include <unordered_set>
 #include <vector>
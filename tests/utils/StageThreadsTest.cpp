@@ -0,0 +1,87 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <cstdio> //For remove.
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+
+#include "../src/utils/StageThreads.h"
+
+namespace cura
+{
+
+TEST(StageThreadsTest, ParseLimits)
+{
+    std::map<std::string, size_t> thread_counts;
+    ASSERT_TRUE(StageThreads::parseLimits("support=4, gcode=2,", thread_counts));
+    EXPECT_EQ((std::map<std::string, size_t>({{"gcode", 2}, {"support", 4}})), thread_counts);
+
+    ASSERT_TRUE(StageThreads::parseLimits("", thread_counts));
+    EXPECT_TRUE(thread_counts.empty());
+}
+
+TEST(StageThreadsTest, ParseInvalidLimits)
+{
+    std::map<std::string, size_t> thread_counts;
+    EXPECT_FALSE(StageThreads::parseLimits("support", thread_counts)) << "No thread count.";
+    EXPECT_FALSE(StageThreads::parseLimits("=4", thread_counts)) << "No stage.";
+    EXPECT_FALSE(StageThreads::parseLimits("support=0", thread_counts)) << "A stage needs at least one thread.";
+    EXPECT_FALSE(StageThreads::parseLimits("support=4x", thread_counts)) << "Trailing characters.";
+}
+
+TEST(StageThreadsTest, ChooseThreadCountWhileTuning)
+{
+    bool is_tuned = true;
+    EXPECT_EQ(8, StageThreads::chooseThreadCount({}, 8, is_tuned)) << "All threads are tried first.";
+    EXPECT_FALSE(is_tuned);
+
+    EXPECT_EQ(4, StageThreads::chooseThreadCount({{8, 2.0}}, 8, is_tuned)) << "Then half of them.";
+    EXPECT_FALSE(is_tuned);
+
+    EXPECT_EQ(2, StageThreads::chooseThreadCount({{8, 2.0}, {4, 1.5}}, 8, is_tuned)) << "As long as fewer threads are faster, the thread count is halved.";
+    EXPECT_FALSE(is_tuned);
+}
+
+TEST(StageThreadsTest, ChooseThreadCountWhenTuned)
+{
+    bool is_tuned = false;
+    EXPECT_EQ(4, StageThreads::chooseThreadCount({{8, 2.0}, {4, 1.5}, {2, 1.8}}, 8, is_tuned)) << "Two threads were slower, so there's no point in trying one.";
+    EXPECT_TRUE(is_tuned);
+
+    EXPECT_EQ(1, StageThreads::chooseThreadCount({{4, 2.0}, {2, 1.5}, {1, 1.0}}, 4, is_tuned)) << "The stage doesn't scale at all.";
+    EXPECT_TRUE(is_tuned);
+
+    EXPECT_EQ(1, StageThreads::chooseThreadCount({{1, 1.0}}, 1, is_tuned));
+    EXPECT_TRUE(is_tuned);
+}
+
+TEST(StageThreadsTest, LimitsAndTuning)
+{
+    const std::string tuning_file = "StageThreadsTest_tuning.txt";
+    std::remove(tuning_file.c_str());
+    StageThreads& stage_threads = StageThreads::getInstance();
+
+    ASSERT_TRUE(stage_threads.start("support=2", tuning_file));
+    EXPECT_EQ(2, stage_threads.getThreadCount("support", 8)) << "Stages with a limit aren't tuned.";
+    EXPECT_EQ(1, stage_threads.getThreadCount("support", 1)) << "The limit doesn't add threads.";
+    EXPECT_EQ(8, stage_threads.getThreadCount("gcode", 8));
+    stage_threads.recordTime("gcode", 8, 2.0);
+    stage_threads.recordTime("support", 2, 2.0);
+    stage_threads.finish();
+
+    ASSERT_TRUE(stage_threads.start("", tuning_file));
+    EXPECT_EQ(4, stage_threads.getThreadCount("gcode", 8)) << "The time of the previous slice was read back.";
+    EXPECT_EQ(8, stage_threads.getThreadCount("support", 8)) << "The stage with a limit wasn't timed.";
+    stage_threads.recordTime("gcode", 4, 3.0);
+    stage_threads.finish();
+
+    ASSERT_TRUE(stage_threads.start("", tuning_file));
+    EXPECT_EQ(8, stage_threads.getThreadCount("gcode", 8)) << "Four threads were slower, so the stage is tuned to eight.";
+    stage_threads.finish();
+
+    EXPECT_EQ(8, stage_threads.getThreadCount("gcode", 8)) << "Without a slice there are no limits.";
+    std::remove(tuning_file.c_str());
+}
+
+}
@@ -0,0 +1,102 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/StaticLineGrid.h" //The class under test.
+#include "../src/utils/SparseLineGrid.h" //To compare with.
+
+namespace cura
+{
+
+struct PairLocator
+{
+    std::pair<Point, Point> operator()(const std::pair<Point, Point>& val) const
+    {
+        return val;
+    }
+};
+
+using Line = std::pair<Point, Point>;
+
+/*!
+ * Get the lines that a grid visits along a query line, in the order in which
+ * they are visited.
+ */
+template<class Grid>
+std::vector<Line> getAlongLine(const Grid& grid, const Line& query)
+{
+    std::vector<Line> result;
+    grid.processLine(query, [&result](const Line& line)
+    {
+        result.push_back(line);
+        return true;
+    });
+    return result;
+}
+
+class StaticLineGridTest : public ::testing::Test
+{
+public:
+    std::vector<Line> lines;
+
+    void SetUp() override
+    {
+        //Lines of all directions and lengths, some of them crossing the axes and some of them sharing cells.
+        lines.clear();
+        for (coord_t i = -20; i < 20; i++)
+        {
+            const Point start(i * 37, (i * i * 13) % 700 - 350);
+            const Point end(start.X + (i % 7) * 45, start.Y - (i % 5) * 60);
+            lines.emplace_back(start, end);
+        }
+        lines.emplace_back(Point(20, -20), Point(-20, 20)); //Around the origin.
+        lines.emplace_back(Point(203, 213), Point(203, 213)); //A single point.
+    }
+};
+
+TEST_F(StaticLineGridTest, Empty)
+{
+    const StaticLineGrid<Line, PairLocator> grid(100, std::vector<Line>());
+    EXPECT_TRUE(grid.getNearby(Point(0, 0), 1000).empty());
+    EXPECT_TRUE(getAlongLine(grid, Line(Point(-1000, 0), Point(1000, 0))).empty());
+}
+
+TEST_F(StaticLineGridTest, SameAsSparseLineGrid)
+{
+    constexpr coord_t cell_size = 100;
+    const StaticLineGrid<Line, PairLocator> static_grid(cell_size, lines);
+    SparseLineGrid<Line, PairLocator> sparse_grid(cell_size);
+    for (const Line& line : lines)
+    {
+        sparse_grid.insert(line);
+    }
+
+    for (coord_t x = -900; x <= 900; x += 75)
+    {
+        for (coord_t y = -500; y <= 500; y += 75)
+        {
+            const Point query(x, y);
+            ASSERT_EQ(static_grid.getNearby(query, cell_size), sparse_grid.getNearby(query, cell_size)) << "Around " << x << ", " << y << ".";
+            const Line query_line(query, Point(-y, x));
+            ASSERT_EQ(getAlongLine(static_grid, query_line), getAlongLine(sparse_grid, query_line)) << "Along the line from " << x << ", " << y << ".";
+        }
+    }
+}
+
+TEST_F(StaticLineGridTest, StopProcessing)
+{
+    std::vector<Line> same_cell(5, Line(Point(10, 10), Point(20, 20)));
+    const StaticLineGrid<Line, PairLocator> grid(100, same_cell);
+    size_t visited = 0;
+    const bool completed = grid.processLine(Line(Point(0, 0), Point(50, 50)), [&visited](const Line&)
+    {
+        visited++;
+        return visited < 2;
+    });
+    EXPECT_FALSE(completed);
+    EXPECT_EQ(visited, 2);
+}
+
+} //namespace cura
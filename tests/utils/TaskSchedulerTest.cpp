@@ -0,0 +1,144 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory> //For unique_ptr.
+#include <vector>
+
+#include "../src/GcodeLayerThreader.h"
+#include "../src/utils/TaskScheduler.h"
+
+namespace cura
+{
+
+TEST(TaskSchedulerTest, RunsScheduledTasks)
+{
+    TaskScheduler scheduler;
+    std::atomic<int> executed(0);
+    for (int task_idx = 0; task_idx < 100; task_idx++)
+    {
+        scheduler.schedule([&executed]() { executed++; });
+    }
+    scheduler.run();
+    EXPECT_EQ(executed, 100);
+}
+
+TEST(TaskSchedulerTest, RunsTasksScheduledByTasks)
+{
+    TaskScheduler scheduler;
+    std::atomic<int> executed(0);
+    for (int task_idx = 0; task_idx < 10; task_idx++)
+    {
+        scheduler.schedule([&scheduler, &executed]()
+        {
+            for (int subtask_idx = 0; subtask_idx < 10; subtask_idx++)
+            {
+                scheduler.schedule([&executed]() { executed++; });
+            }
+            executed++;
+        });
+    }
+    scheduler.run();
+    EXPECT_EQ(executed, 110) << "run() must only return when the tasks scheduled from within tasks are done too.";
+}
+
+TEST(TaskSchedulerTest, RunWithoutTasks)
+{
+    TaskScheduler scheduler;
+    scheduler.run(); //Must return immediately.
+}
+
+TEST(TaskSchedulerTest, ProcessSharedWithinTasks)
+{
+    TaskScheduler scheduler;
+    constexpr size_t item_count = 50;
+    std::vector<std::unique_ptr<std::atomic<int>>> processed; //How often each item of each task was processed.
+    for (size_t item_idx = 0; item_idx < 4 * item_count; item_idx++)
+    {
+        processed.emplace_back(new std::atomic<int>(0));
+    }
+    for (size_t task_idx = 0; task_idx < 4; task_idx++)
+    {
+        scheduler.schedule([&scheduler, &processed, task_idx, item_count]()
+        {
+            TaskScheduler::processShared(&scheduler, item_count, [&processed, task_idx, item_count](const size_t item_idx)
+            {
+                (*processed[task_idx * item_count + item_idx])++;
+            });
+            for (size_t item_idx = 0; item_idx < item_count; item_idx++)
+            {
+                EXPECT_EQ(*processed[task_idx * item_count + item_idx], 1) << "All items must be processed exactly once when processShared returns.";
+            }
+        });
+    }
+    scheduler.run();
+
+    std::atomic<int> processed_without_scheduler(0);
+    TaskScheduler::processShared(nullptr, 10, [&processed_without_scheduler](const size_t) { processed_without_scheduler++; });
+    EXPECT_EQ(processed_without_scheduler, 10);
+}
+
+TEST(TaskSchedulerTest, GcodeLayerThreaderConsumesInOrder)
+{
+    std::vector<std::unique_ptr<int>> items;
+    for (int item_idx = -3; item_idx < 200; item_idx++)
+    {
+        items.emplace_back(new int(item_idx));
+    }
+    const std::function<int* (int)> produce = [&items](int item_idx)
+    {
+        return items[item_idx + 3].get();
+    };
+    std::vector<int> consumed;
+    const std::function<void (int*)> consume = [&consumed](int* item)
+    {
+        consumed.push_back(*item);
+    };
+
+    GcodeLayerThreader<int> threader(-3, 200, produce, consume, 5);
+    threader.run();
+
+    ASSERT_EQ(consumed.size(), size_t(203));
+    for (size_t consumed_idx = 0; consumed_idx < consumed.size(); consumed_idx++)
+    {
+        EXPECT_EQ(consumed[consumed_idx], static_cast<int>(consumed_idx) - 3);
+    }
+}
+
+TEST(TaskSchedulerTest, GcodeLayerThreaderMemoryLimit)
+{
+    std::vector<std::unique_ptr<int>> items;
+    for (int item_idx = 0; item_idx < 100; item_idx++)
+    {
+        items.emplace_back(new int(item_idx));
+    }
+    std::atomic<int> active_count(0);
+    std::atomic<int> max_active_count(0);
+    const std::function<int* (int)> produce = [&items, &active_count, &max_active_count](int item_idx)
+    {
+        const int active = ++active_count;
+        int previous_max = max_active_count;
+        while (active > previous_max && !max_active_count.compare_exchange_weak(previous_max, active)) {}
+        return items[item_idx].get();
+    };
+    std::vector<int> consumed;
+    const std::function<void (int*)> consume = [&consumed, &active_count](int* item)
+    {
+        consumed.push_back(*item);
+        active_count--;
+    };
+
+    GcodeLayerThreader<int> threader(0, 100, produce, consume, 0);
+    threader.setMemoryLimit(2000, [](const int*) { return size_t(1000); }); //Only two items fit.
+    threader.run();
+
+    ASSERT_EQ(consumed.size(), size_t(100));
+    for (size_t consumed_idx = 0; consumed_idx < consumed.size(); consumed_idx++)
+    {
+        EXPECT_EQ(consumed[consumed_idx], static_cast<int>(consumed_idx));
+    }
+    EXPECT_LE(max_active_count, std::max(3, static_cast<int>(threader.getThreadCount()))) << "Apart from the first item of each thread, only two items fit in memory, plus the one being consumed.";
+}
+
+} //namespace cura
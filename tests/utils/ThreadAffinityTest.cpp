@@ -0,0 +1,65 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/utils/ThreadAffinity.h"
+
+namespace cura
+{
+
+TEST(ThreadAffinityTest, ParseProcessorList)
+{
+    std::vector<int> processors;
+    ASSERT_TRUE(ThreadAffinity::parseProcessorList("0-3,8,10-11\n", processors));
+    EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 8, 10, 11}), processors);
+
+    ASSERT_TRUE(ThreadAffinity::parseProcessorList("", processors));
+    EXPECT_TRUE(processors.empty());
+}
+
+TEST(ThreadAffinityTest, ParseInvalidProcessorList)
+{
+    std::vector<int> processors;
+    EXPECT_FALSE(ThreadAffinity::parseProcessorList("3-1", processors)) << "The range is reversed.";
+    EXPECT_FALSE(ThreadAffinity::parseProcessorList("1-", processors)) << "The range has no end.";
+    EXPECT_FALSE(ThreadAffinity::parseProcessorList("one", processors)) << "Not a number.";
+    EXPECT_FALSE(ThreadAffinity::parseProcessorList("1x", processors)) << "Trailing characters.";
+}
+
+TEST(ThreadAffinityTest, PlaceCompact)
+{
+    const std::vector<std::vector<int>> node_processors = {{0, 1, 2}, {8, 9}};
+    const std::vector<std::pair<int, size_t>> expected = {{0, 0}, {1, 0}, {2, 0}, {8, 1}, {9, 1}, {0, 0}};
+    for (size_t thread_idx = 0; thread_idx < expected.size(); thread_idx++)
+    {
+        EXPECT_EQ(expected[thread_idx], ThreadAffinity::place(node_processors, ThreadAffinity::Placement::COMPACT, thread_idx)) << "Thread " << thread_idx;
+    }
+}
+
+TEST(ThreadAffinityTest, PlaceSpread)
+{
+    const std::vector<std::vector<int>> node_processors = {{0, 1, 2}, {8, 9}};
+    const std::vector<std::pair<int, size_t>> expected = {{0, 0}, {8, 1}, {1, 0}, {9, 1}, {2, 0}, {8, 1}};
+    for (size_t thread_idx = 0; thread_idx < expected.size(); thread_idx++)
+    {
+        EXPECT_EQ(expected[thread_idx], ThreadAffinity::place(node_processors, ThreadAffinity::Placement::SPREAD, thread_idx)) << "Thread " << thread_idx;
+    }
+}
+
+TEST(ThreadAffinityTest, SetPlacement)
+{
+    EXPECT_FALSE(ThreadAffinity::setPlacement("scattered"));
+    EXPECT_EQ(ThreadAffinity::Placement::NONE, ThreadAffinity::getPlacement());
+
+    ASSERT_TRUE(ThreadAffinity::setPlacement("spread"));
+    EXPECT_EQ(ThreadAffinity::Placement::SPREAD, ThreadAffinity::getPlacement());
+    ThreadAffinity::pinThread(0); //Pinning must not get in the way of the thread, even if the platform doesn't support it.
+
+    ASSERT_TRUE(ThreadAffinity::setPlacement("none"));
+    EXPECT_EQ(ThreadAffinity::Placement::NONE, ThreadAffinity::getPlacement());
+    EXPECT_EQ(size_t(0), ThreadAffinity::getNode(1));
+}
+
+}
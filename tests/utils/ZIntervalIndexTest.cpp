@@ -0,0 +1,62 @@
+//Copyright (c) 2019 Ultimaker B.V.
+//CuraEngine is released under the terms of the AGPLv3 or higher.
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "../src/utils/ZIntervalIndex.h"
+
+namespace cura
+{
+
+class ZIntervalIndexTest : public testing::Test
+{
+public:
+    ZIntervalIndex index;
+
+    void SetUp()
+    {
+        index.insert(0, 100, 0);
+        index.insert(50, 60, 1);
+        index.insert(200, 300, 2);
+        index.insert(-10, 250, 3);
+        index.finalize();
+    }
+
+    std::vector<size_t> sorted(std::vector<size_t> ids)
+    {
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+};
+
+TEST_F(ZIntervalIndexTest, SweepUpward)
+{
+    ZIntervalIndex::Sweep sweep(index);
+
+    EXPECT_EQ(sorted(sweep.advance(-20, -15)), std::vector<size_t>({})) << "Nothing is below the lowest interval.";
+    EXPECT_EQ(sorted(sweep.advance(0, 0)), std::vector<size_t>({0, 3})) << "Intervals are inclusive at their lower end.";
+    EXPECT_EQ(sorted(sweep.advance(55, 55)), std::vector<size_t>({0, 1, 3}));
+    EXPECT_EQ(sorted(sweep.advance(60, 100)), std::vector<size_t>({0, 1, 3})) << "Intervals are inclusive at their upper end.";
+    EXPECT_EQ(sorted(sweep.advance(150, 200)), std::vector<size_t>({2, 3})) << "A range partially overlapping an interval finds it.";
+    EXPECT_EQ(sorted(sweep.advance(301, 400)), std::vector<size_t>({})) << "Nothing is above the highest interval.";
+}
+
+TEST_F(ZIntervalIndexTest, SweepDownward)
+{
+    ZIntervalIndex::Sweep sweep(index);
+
+    EXPECT_EQ(sorted(sweep.advance(280, 280)), std::vector<size_t>({2}));
+    EXPECT_EQ(sorted(sweep.advance(55, 55)), std::vector<size_t>({0, 1, 3})) << "Going down restarts the sweep, so the dropped intervals are found again.";
+}
+
+TEST_F(ZIntervalIndexTest, Empty)
+{
+    ZIntervalIndex empty;
+    empty.finalize();
+    ZIntervalIndex::Sweep sweep(empty);
+
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT_TRUE(sweep.advance(0, 1000).empty());
+}
+
+} // namespace cura